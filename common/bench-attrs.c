@@ -0,0 +1,127 @@
+/*
+ * Copyright (c) 2016 Red Hat Inc
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *     * Redistributions of source code must retain the above
+ *       copyright notice, this list of conditions and the
+ *       following disclaimer.
+ *     * Redistributions in binary form must reproduce the
+ *       above copyright notice, this list of conditions and
+ *       the following disclaimer in the documentation and/or
+ *       other materials provided with the distribution.
+ *     * The names of contributors to this software may not be
+ *       used to endorse or promote products derived from this
+ *       software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+#include "config.h"
+#include "test.h"
+
+#include "attrs.h"
+#include "pkcs11x.h"
+
+#include <stdlib.h>
+
+static CK_OBJECT_CLASS certificate = CKO_CERTIFICATE;
+static CK_CERTIFICATE_TYPE x509 = CKC_X_509;
+static CK_BBOOL truev = CK_TRUE;
+static CK_BBOOL falsev = CK_FALSE;
+
+static CK_ATTRIBUTE cacert[] = {
+	{ CKA_CLASS, &certificate, sizeof (certificate) },
+	{ CKA_CERTIFICATE_TYPE, &x509, sizeof (x509) },
+	{ CKA_TOKEN, &truev, sizeof (truev) },
+	{ CKA_PRIVATE, &falsev, sizeof (falsev) },
+	{ CKA_MODIFIABLE, &falsev, sizeof (falsev) },
+	{ CKA_TRUSTED, &truev, sizeof (truev) },
+	{ CKA_LABEL, "Example Certificate Authority", 29 },
+	{ CKA_ID, "\x12\x34\x56\x78\x9a\xbc\xde\xf0\x12\x34\x56\x78\x9a\xbc\xde\xf0\x12\x34\x56\x78", 20 },
+	{ CKA_SUBJECT, "subject", 7 },
+	{ CKA_ISSUER, "issuer", 6 },
+	{ CKA_SERIAL_NUMBER, "\x02\x01\x01", 3 },
+	{ CKA_VALUE, "value", 5 },
+	{ CKA_INVALID },
+};
+
+static CK_ATTRIBUTE match[] = {
+	{ CKA_CLASS, &certificate, sizeof (certificate) },
+	{ CKA_LABEL, "Example Certificate Authority", 29 },
+	{ CKA_VALUE, "value", 5 },
+	{ CKA_INVALID },
+};
+
+static void
+bench_find (void *unused)
+{
+	CK_ATTRIBUTE *attr;
+
+	attr = p11_attrs_find (cacert, CKA_VALUE);
+	assert_ptr_eq (cacert + 11, attr);
+}
+
+static void
+bench_find_missing (void *unused)
+{
+	CK_ATTRIBUTE *attr;
+
+	attr = p11_attrs_find (cacert, CKA_START_DATE);
+	assert_ptr_eq (NULL, attr);
+}
+
+static void
+bench_build (void *unused)
+{
+	CK_ATTRIBUTE label = { CKA_LABEL, "Replaced", 8 };
+	CK_ATTRIBUTE trusted = { CKA_X_DISTRUSTED, &falsev, sizeof (falsev) };
+	CK_ATTRIBUTE *attrs;
+
+	attrs = p11_attrs_buildn (NULL, cacert, 12);
+	attrs = p11_attrs_build (attrs, &label, &trusted, NULL);
+	assert_num_eq (13, p11_attrs_count (attrs));
+	p11_attrs_free (attrs);
+}
+
+static void
+bench_dup (void *unused)
+{
+	CK_ATTRIBUTE *attrs;
+
+	attrs = p11_attrs_dup (cacert);
+	assert_ptr_not_null (attrs);
+	p11_attrs_free (attrs);
+}
+
+static void
+bench_match (void *unused)
+{
+	assert_true (p11_attrs_match (cacert, match));
+}
+
+int
+main (int argc,
+      char *argv[])
+{
+	p11_bench (bench_find, NULL, "/attrs/find");
+	p11_bench (bench_find_missing, NULL, "/attrs/find-missing");
+	p11_bench (bench_build, NULL, "/attrs/build");
+	p11_bench (bench_dup, NULL, "/attrs/dup");
+	p11_bench (bench_match, NULL, "/attrs/match");
+
+	return p11_test_run (argc, argv);
+}
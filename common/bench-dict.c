@@ -0,0 +1,130 @@
+/*
+ * Copyright (c) 2016 Red Hat Inc
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *     * Redistributions of source code must retain the above
+ *       copyright notice, this list of conditions and the
+ *       following disclaimer.
+ *     * Redistributions in binary form must reproduce the
+ *       above copyright notice, this list of conditions and
+ *       the following disclaimer in the documentation and/or
+ *       other materials provided with the distribution.
+ *     * The names of contributors to this software may not be
+ *       used to endorse or promote products derived from this
+ *       software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+#include "config.h"
+#include "test.h"
+
+#include "dict.h"
+
+#include <stdlib.h>
+
+#define NUM_KEYS 4096
+
+static struct {
+	p11_dict *dict;
+	unsigned long keys[NUM_KEYS];
+	unsigned long missing[NUM_KEYS];
+	int at;
+} test;
+
+static void
+setup (void *unused)
+{
+	int i;
+
+	test.dict = p11_dict_new (p11_dict_ulongptr_hash, p11_dict_ulongptr_equal, NULL, NULL);
+	assert_ptr_not_null (test.dict);
+
+	for (i = 0; i < NUM_KEYS; i++) {
+		test.keys[i] = i * 7919UL;
+		test.missing[i] = i * 7919UL + 1;
+		if (!p11_dict_set (test.dict, test.keys + i, test.keys + i))
+			assert_not_reached ();
+	}
+
+	test.at = 0;
+}
+
+static void
+teardown (void *unused)
+{
+	p11_dict_free (test.dict);
+}
+
+static void
+bench_get_hit (void *unused)
+{
+	void *value;
+
+	value = p11_dict_get (test.dict, test.keys + test.at);
+	assert_ptr_eq (test.keys + test.at, value);
+	test.at = (test.at + 1) % NUM_KEYS;
+}
+
+static void
+bench_get_miss (void *unused)
+{
+	void *value;
+
+	value = p11_dict_get (test.dict, test.missing + test.at);
+	assert_ptr_eq (NULL, value);
+	test.at = (test.at + 1) % NUM_KEYS;
+}
+
+static void
+bench_set_remove (void *unused)
+{
+	unsigned long *key = test.missing + test.at;
+
+	if (!p11_dict_set (test.dict, key, key))
+		assert_not_reached ();
+	if (!p11_dict_remove (test.dict, key))
+		assert_not_reached ();
+	test.at = (test.at + 1) % NUM_KEYS;
+}
+
+static void
+bench_iterate (void *unused)
+{
+	p11_dictiter iter;
+	void *key;
+	int count = 0;
+
+	p11_dict_iterate (test.dict, &iter);
+	while (p11_dict_next (&iter, &key, NULL))
+		count++;
+
+	assert_num_eq (NUM_KEYS, count);
+}
+
+int
+main (int argc,
+      char *argv[])
+{
+	p11_fixture (setup, teardown);
+	p11_bench (bench_get_hit, NULL, "/dict/get-hit");
+	p11_bench (bench_get_miss, NULL, "/dict/get-miss");
+	p11_bench (bench_set_remove, NULL, "/dict/set-remove");
+	p11_bench (bench_iterate, NULL, "/dict/iterate");
+
+	return p11_test_run (argc, argv);
+}
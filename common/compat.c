@@ -922,3 +922,50 @@ fdwalk (int (* cb) (void *data, int fd),
 #endif /* HAVE_FDWALK */
 
 #endif /* OS_UNIX */
+
+#if defined(OS_UNIX) && !defined(HAVE_CLOCK_GETTIME)
+#include <sys/time.h>
+#endif
+
+uint64_t
+p11_clock_ns (void)
+{
+#if defined(HAVE_CLOCK_GETTIME)
+	struct timespec ts;
+	clock_gettime (CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+#elif defined(OS_UNIX)
+	struct timeval tv;
+	gettimeofday (&tv, NULL);
+	return tv.tv_sec * 1000000000ULL + tv.tv_usec * 1000ULL;
+#else /* OS_WIN32 */
+	LARGE_INTEGER count;
+	static LARGE_INTEGER frequency = { { 0, } };
+	if (frequency.QuadPart == 0)
+		QueryPerformanceFrequency (&frequency);
+	QueryPerformanceCounter (&count);
+	return count.QuadPart * (1000000000.0 / frequency.QuadPart);
+#endif
+}
+
+#ifndef HAVE___BUILTIN_CLZLL
+
+int
+p11_clz64 (uint64_t value)
+{
+	int count = 0;
+	int shift;
+
+	assert (value != 0);
+
+	for (shift = 32; shift > 0; shift >>= 1) {
+		if ((value >> (64 - shift)) == 0) {
+			count += shift;
+			value <<= shift;
+		}
+	}
+
+	return count;
+}
+
+#endif /* HAVE___BUILTIN_CLZLL */
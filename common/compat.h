@@ -39,6 +39,7 @@
 
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <stdint.h>
 
 #ifdef _GNU_SOURCE
 #error Make the crap stop. _GNU_SOURCE is completely unportable and breaks all sorts of behavior
@@ -95,6 +96,17 @@ char *       mkdtemp     (char *template);
 
 char *       strdup_path_mangle (const char *template);
 
+/* Nanoseconds from a clock that's monotonic where possible */
+uint64_t     p11_clock_ns       (void);
+
+/* The leading zero bits of a value that isn't zero */
+#ifdef HAVE___BUILTIN_CLZLL
+#define p11_clz64(v) \
+	(__builtin_clzll (v))
+#else
+int          p11_clz64          (uint64_t value);
+#endif
+
 /* -----------------------------------------------------------------------------
  * WIN32
  */
@@ -132,6 +144,36 @@ typedef DWORD p11_thread_id_t;
 #define p11_mutex_uninit(m) \
 	(DeleteCriticalSection (m))
 
+/* Slim reader/writer locks need Vista, so readers exclude each other here */
+typedef CRITICAL_SECTION p11_rwlock_t;
+
+#define p11_rwlock_init(l) \
+	(InitializeCriticalSection (l))
+#define p11_rwlock_read(l) \
+	(EnterCriticalSection (l))
+#define p11_rwlock_write(l) \
+	(EnterCriticalSection (l))
+#define p11_rwlock_unlock(l) \
+	(LeaveCriticalSection (l))
+#define p11_rwlock_uninit(l) \
+	(DeleteCriticalSection (l))
+
+/* Condition variables need Vista, so waiters poll here */
+typedef int p11_cond_t;
+
+#define p11_cond_init(c) \
+	(*(c) = 0)
+#define p11_cond_wait(c, m) \
+	do { (void)(c); LeaveCriticalSection (m); \
+	Sleep (1); EnterCriticalSection (m); \
+	} while (0)
+#define p11_cond_signal(c) \
+	((void)(c))
+#define p11_cond_broadcast(c) \
+	((void)(c))
+#define p11_cond_uninit(c) \
+	((void)(c))
+
 typedef void * (*p11_thread_routine) (void *arg);
 
 int p11_thread_create (p11_thread_t *thread, p11_thread_routine, void *arg);
@@ -193,6 +235,32 @@ void        p11_mutex_init          (p11_mutex_t *mutex);
 #define p11_mutex_uninit(m) \
 	(pthread_mutex_destroy(m))
 
+typedef pthread_rwlock_t p11_rwlock_t;
+
+#define p11_rwlock_init(l) \
+	(pthread_rwlock_init ((l), NULL))
+#define p11_rwlock_read(l) \
+	(pthread_rwlock_rdlock (l))
+#define p11_rwlock_write(l) \
+	(pthread_rwlock_wrlock (l))
+#define p11_rwlock_unlock(l) \
+	(pthread_rwlock_unlock (l))
+#define p11_rwlock_uninit(l) \
+	(pthread_rwlock_destroy (l))
+
+typedef pthread_cond_t p11_cond_t;
+
+#define p11_cond_init(c) \
+	(pthread_cond_init ((c), NULL))
+#define p11_cond_wait(c, m) \
+	(pthread_cond_wait ((c), (m)))
+#define p11_cond_signal(c) \
+	(pthread_cond_signal (c))
+#define p11_cond_broadcast(c) \
+	(pthread_cond_broadcast (c))
+#define p11_cond_uninit(c) \
+	(pthread_cond_destroy (c))
+
 typedef pthread_t p11_thread_t;
 
 typedef pthread_t p11_thread_id_t;
@@ -338,4 +406,41 @@ int        fdwalk           (int (* cb) (void *data, int fd),
 
 #endif
 
+/*
+ * Atomic operations. The older __sync builtins are all full barriers,
+ * so the memory order is ignored when falling back to them.
+ */
+
+#ifdef HAVE___ATOMIC
+
+#define p11_atomic_load(p, order) \
+	(__atomic_load_n ((p), __ATOMIC_ ## order))
+#define p11_atomic_store(p, v, order) \
+	(__atomic_store_n ((p), (v), __ATOMIC_ ## order))
+#define p11_atomic_add(p, v, order) \
+	(__atomic_add_fetch ((p), (v), __ATOMIC_ ## order))
+#define p11_atomic_sub(p, v, order) \
+	(__atomic_sub_fetch ((p), (v), __ATOMIC_ ## order))
+#define p11_atomic_compare_exchange(p, expected, v) \
+	(__atomic_compare_exchange_n ((p), (expected), (v), 1, \
+	                              __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+
+#else /* !HAVE___ATOMIC */
+
+#define p11_atomic_load(p, order) \
+	({ __typeof__ (*(p) + 0) _v; __sync_synchronize (); \
+	   _v = *(volatile __typeof__ (*(p)) *)(p); __sync_synchronize (); _v; })
+#define p11_atomic_store(p, v, order) \
+	do { __sync_synchronize (); *(volatile __typeof__ (*(p)) *)(p) = (v); \
+	     __sync_synchronize (); } while (0)
+#define p11_atomic_add(p, v, order) \
+	(__sync_add_and_fetch ((p), (v)))
+#define p11_atomic_sub(p, v, order) \
+	(__sync_sub_and_fetch ((p), (v)))
+#define p11_atomic_compare_exchange(p, expected, v) \
+	({ __typeof__ (*(p)) _e = *(expected); \
+	   *(expected) = __sync_val_compare_and_swap ((p), _e, (v)); *(expected) == _e; })
+
+#endif /* !HAVE___ATOMIC */
+
 #endif /* __COMPAT_H__ */
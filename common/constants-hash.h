@@ -0,0 +1,699 @@
+/* This file is generated by frob-constants, do not edit */
+
+static const unsigned short name_displace[128] = {
+	2, 2, 7, 7, 3, 1, 2, 3, 4, 2,
+	1, 1, 5, 2, 1, 5, 1, 1, 2, 5,
+	3, 4, 7, 1, 1, 2, 2, 6, 1, 9,
+	4, 1, 1, 3, 2, 4, 3, 2, 13, 3,
+	1, 1, 2, 1, 1, 2, 1, 4, 1, 4,
+	1, 1, 1, 4, 2, 2, 3, 5, 4, 1,
+	5, 1, 3, 1, 2, 4, 1, 7, 5, 5,
+	3, 1, 1, 14, 7, 8, 4, 4, 1, 1,
+	3, 2, 2, 5, 1, 4, 1, 1, 3, 8,
+	2, 1, 3, 3, 3, 1, 3, 1, 6, 0,
+	1, 6, 3, 1, 13, 3, 2, 4, 3, 4,
+	6, 8, 14, 7, 2, 3, 0, 2, 1, 13,
+	2, 1, 1, 1, 4, 3, 7, 1,
+};
+
+static const constant_slot name_slots[1024] = {
+	{ CONSTANT_SLOT_EMPTY }, { 0, 0, 61 }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY },
+	{ 7, 0, 194 }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY },
+	{ 2, 0, 0 }, { 6, 0, 0 }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY },
+	{ CONSTANT_SLOT_EMPTY }, { 7, 0, 49 }, { 7, 0, 161 }, { CONSTANT_SLOT_EMPTY },
+	{ CONSTANT_SLOT_EMPTY }, { 0, 0, 42 }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY },
+	{ CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { 1, 0, 15 },
+	{ CONSTANT_SLOT_EMPTY }, { 7, 0, 7 }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY },
+	{ 1, 0, 8 }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { 4, 0, 11 },
+	{ 5, 0, 2 }, { 7, 0, 119 }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY },
+	{ 7, 0, 26 }, { 10, 0, 5 }, { 10, 0, 38 }, { 10, 0, 67 },
+	{ CONSTANT_SLOT_EMPTY }, { 0, 0, 36 }, { CONSTANT_SLOT_EMPTY }, { 7, 0, 172 },
+	{ CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { 0, 0, 60 },
+	{ CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { 0, 0, 73 }, { CONSTANT_SLOT_EMPTY },
+	{ CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY },
+	{ CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { 7, 0, 82 }, { CONSTANT_SLOT_EMPTY },
+	{ CONSTANT_SLOT_EMPTY }, { 7, 0, 100 }, { CONSTANT_SLOT_EMPTY }, { 10, 0, 57 },
+	{ 7, 0, 124 }, { 7, 0, 46 }, { 7, 0, 8 }, { CONSTANT_SLOT_EMPTY },
+	{ 7, 0, 27 }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { 0, 0, 31 },
+	{ CONSTANT_SLOT_EMPTY }, { 0, 0, 92 }, { CONSTANT_SLOT_EMPTY }, { 10, 0, 18 },
+	{ CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { 7, 0, 55 },
+	{ CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { 7, 0, 86 }, { 7, 0, 171 },
+	{ 0, 0, 70 }, { CONSTANT_SLOT_EMPTY }, { 7, 0, 177 }, { 7, 0, 111 },
+	{ CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY },
+	{ CONSTANT_SLOT_EMPTY }, { 7, 0, 105 }, { CONSTANT_SLOT_EMPTY }, { 0, 0, 82 },
+	{ 0, 0, 26 }, { 0, 0, 79 }, { CONSTANT_SLOT_EMPTY }, { 7, 0, 145 },
+	{ CONSTANT_SLOT_EMPTY }, { 0, 0, 8 }, { 0, 0, 96 }, { 1, 0, 5 },
+	{ CONSTANT_SLOT_EMPTY }, { 0, 0, 83 }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY },
+	{ 0, 0, 25 }, { CONSTANT_SLOT_EMPTY }, { 7, 0, 23 }, { CONSTANT_SLOT_EMPTY },
+	{ CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { 7, 0, 20 },
+	{ CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY },
+	{ CONSTANT_SLOT_EMPTY }, { 0, 0, 28 }, { 4, 0, 5 }, { CONSTANT_SLOT_EMPTY },
+	{ 9, 0, 2 }, { 1, 0, 0 }, { 10, 0, 0 }, { CONSTANT_SLOT_EMPTY },
+	{ 10, 0, 80 }, { 7, 0, 209 }, { CONSTANT_SLOT_EMPTY }, { 0, 0, 102 },
+	{ 7, 0, 53 }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { 7, 0, 131 },
+	{ 10, 0, 34 }, { 7, 0, 135 }, { 7, 0, 92 }, { CONSTANT_SLOT_EMPTY },
+	{ 7, 0, 36 }, { 7, 0, 33 }, { CONSTANT_SLOT_EMPTY }, { 10, 0, 79 },
+	{ 10, 0, 12 }, { CONSTANT_SLOT_EMPTY }, { 7, 0, 17 }, { CONSTANT_SLOT_EMPTY },
+	{ CONSTANT_SLOT_EMPTY }, { 7, 0, 97 }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY },
+	{ CONSTANT_SLOT_EMPTY }, { 0, 0, 114 }, { 7, 0, 44 }, { 3, 0, 2 },
+	{ CONSTANT_SLOT_EMPTY }, { 5, 0, 1 }, { CONSTANT_SLOT_EMPTY }, { 4, 0, 23 },
+	{ CONSTANT_SLOT_EMPTY }, { 7, 0, 144 }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY },
+	{ CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { 7, 0, 1 },
+	{ CONSTANT_SLOT_EMPTY }, { 0, 0, 35 }, { 7, 0, 109 }, { CONSTANT_SLOT_EMPTY },
+	{ 4, 0, 4 }, { 0, 0, 45 }, { CONSTANT_SLOT_EMPTY }, { 0, 0, 12 },
+	{ CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { 6, 0, 3 },
+	{ 1, 0, 1 }, { CONSTANT_SLOT_EMPTY }, { 10, 0, 48 }, { 0, 0, 81 },
+	{ CONSTANT_SLOT_EMPTY }, { 7, 0, 91 }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY },
+	{ CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { 0, 0, 101 },
+	{ CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY },
+	{ CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { 4, 0, 24 },
+	{ 10, 0, 44 }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY },
+	{ 0, 0, 5 }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY },
+	{ CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { 7, 0, 24 }, { 0, 0, 16 },
+	{ 8, 0, 4 }, { 7, 0, 50 }, { 10, 0, 8 }, { CONSTANT_SLOT_EMPTY },
+	{ 7, 0, 15 }, { CONSTANT_SLOT_EMPTY }, { 0, 0, 14 }, { CONSTANT_SLOT_EMPTY },
+	{ CONSTANT_SLOT_EMPTY }, { 0, 0, 29 }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY },
+	{ 7, 0, 198 }, { 10, 0, 63 }, { CONSTANT_SLOT_EMPTY }, { 0, 0, 72 },
+	{ 7, 0, 84 }, { 1, 0, 13 }, { 4, 0, 7 }, { CONSTANT_SLOT_EMPTY },
+	{ CONSTANT_SLOT_EMPTY }, { 10, 0, 7 }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY },
+	{ CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY },
+	{ CONSTANT_SLOT_EMPTY }, { 4, 0, 2 }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY },
+	{ CONSTANT_SLOT_EMPTY }, { 7, 0, 101 }, { 4, 0, 6 }, { CONSTANT_SLOT_EMPTY },
+	{ 10, 0, 37 }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { 7, 0, 180 },
+	{ CONSTANT_SLOT_EMPTY }, { 10, 0, 71 }, { CONSTANT_SLOT_EMPTY }, { 7, 0, 77 },
+	{ CONSTANT_SLOT_EMPTY }, { 7, 0, 48 }, { CONSTANT_SLOT_EMPTY }, { 7, 0, 71 },
+	{ CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { 0, 0, 40 },
+	{ 10, 0, 31 }, { CONSTANT_SLOT_EMPTY }, { 7, 0, 78 }, { CONSTANT_SLOT_EMPTY },
+	{ CONSTANT_SLOT_EMPTY }, { 7, 0, 163 }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY },
+	{ 7, 0, 162 }, { 7, 0, 181 }, { CONSTANT_SLOT_EMPTY }, { 6, 0, 1 },
+	{ 10, 0, 78 }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { 0, 0, 59 },
+	{ 7, 0, 102 }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { 7, 0, 170 },
+	{ 10, 0, 24 }, { CONSTANT_SLOT_EMPTY }, { 7, 0, 153 }, { CONSTANT_SLOT_EMPTY },
+	{ 0, 0, 103 }, { 10, 0, 47 }, { 7, 0, 130 }, { CONSTANT_SLOT_EMPTY },
+	{ CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY },
+	{ 7, 0, 51 }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { 7, 0, 66 },
+	{ CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { 7, 0, 95 },
+	{ CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { 0, 0, 27 },
+	{ CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { 10, 0, 16 },
+	{ 10, 0, 58 }, { CONSTANT_SLOT_EMPTY }, { 7, 0, 88 }, { CONSTANT_SLOT_EMPTY },
+	{ 7, 0, 175 }, { CONSTANT_SLOT_EMPTY }, { 0, 0, 4 }, { CONSTANT_SLOT_EMPTY },
+	{ 0, 0, 100 }, { CONSTANT_SLOT_EMPTY }, { 0, 0, 22 }, { CONSTANT_SLOT_EMPTY },
+	{ CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { 10, 0, 62 },
+	{ CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY },
+	{ CONSTANT_SLOT_EMPTY }, { 10, 0, 50 }, { 7, 0, 140 }, { CONSTANT_SLOT_EMPTY },
+	{ CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY },
+	{ CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY },
+	{ CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { 1, 0, 11 }, { CONSTANT_SLOT_EMPTY },
+	{ CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { 0, 0, 104 },
+	{ 7, 0, 45 }, { CONSTANT_SLOT_EMPTY }, { 0, 0, 76 }, { CONSTANT_SLOT_EMPTY },
+	{ CONSTANT_SLOT_EMPTY }, { 0, 0, 43 }, { 0, 0, 24 }, { CONSTANT_SLOT_EMPTY },
+	{ CONSTANT_SLOT_EMPTY }, { 7, 0, 108 }, { 10, 0, 70 }, { 7, 0, 10 },
+	{ 7, 0, 155 }, { 0, 0, 56 }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY },
+	{ CONSTANT_SLOT_EMPTY }, { 4, 0, 3 }, { CONSTANT_SLOT_EMPTY }, { 7, 0, 38 },
+	{ 4, 0, 17 }, { CONSTANT_SLOT_EMPTY }, { 10, 0, 81 }, { 0, 0, 38 },
+	{ CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { 10, 0, 25 }, { 1, 0, 6 },
+	{ CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { 10, 0, 83 }, { 7, 0, 70 },
+	{ CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY },
+	{ CONSTANT_SLOT_EMPTY }, { 0, 0, 0 }, { 6, 0, 2 }, { CONSTANT_SLOT_EMPTY },
+	{ CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { 0, 0, 107 }, { CONSTANT_SLOT_EMPTY },
+	{ CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { 10, 0, 27 }, { CONSTANT_SLOT_EMPTY },
+	{ CONSTANT_SLOT_EMPTY }, { 0, 0, 11 }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY },
+	{ CONSTANT_SLOT_EMPTY }, { 10, 0, 30 }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY },
+	{ CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { 7, 0, 63 },
+	{ CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY },
+	{ 0, 0, 44 }, { CONSTANT_SLOT_EMPTY }, { 10, 0, 17 }, { CONSTANT_SLOT_EMPTY },
+	{ CONSTANT_SLOT_EMPTY }, { 7, 0, 137 }, { 7, 0, 156 }, { 7, 0, 118 },
+	{ CONSTANT_SLOT_EMPTY }, { 0, 0, 48 }, { 7, 0, 21 }, { 7, 0, 57 },
+	{ 7, 0, 12 }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { 0, 0, 3 },
+	{ 7, 0, 149 }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY },
+	{ CONSTANT_SLOT_EMPTY }, { 7, 0, 134 }, { CONSTANT_SLOT_EMPTY }, { 0, 0, 80 },
+	{ 10, 0, 1 }, { 0, 0, 63 }, { 7, 0, 34 }, { 10, 0, 14 },
+	{ CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { 0, 0, 85 }, { 7, 0, 192 },
+	{ 0, 0, 105 }, { 7, 0, 110 }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY },
+	{ 7, 0, 169 }, { 7, 0, 112 }, { 10, 0, 41 }, { 7, 0, 22 },
+	{ 7, 0, 2 }, { 0, 0, 86 }, { CONSTANT_SLOT_EMPTY }, { 0, 0, 6 },
+	{ CONSTANT_SLOT_EMPTY }, { 5, 0, 0 }, { 0, 0, 110 }, { CONSTANT_SLOT_EMPTY },
+	{ CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { 8, 0, 0 }, { CONSTANT_SLOT_EMPTY },
+	{ CONSTANT_SLOT_EMPTY }, { 10, 0, 82 }, { CONSTANT_SLOT_EMPTY }, { 4, 0, 20 },
+	{ 7, 0, 61 }, { 8, 0, 2 }, { 1, 0, 12 }, { 7, 0, 28 },
+	{ CONSTANT_SLOT_EMPTY }, { 10, 0, 19 }, { 0, 0, 99 }, { CONSTANT_SLOT_EMPTY },
+	{ CONSTANT_SLOT_EMPTY }, { 10, 0, 23 }, { 4, 0, 18 }, { 7, 0, 96 },
+	{ CONSTANT_SLOT_EMPTY }, { 0, 0, 89 }, { 3, 0, 0 }, { CONSTANT_SLOT_EMPTY },
+	{ CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { 8, 0, 3 }, { 7, 0, 42 },
+	{ 0, 0, 120 }, { 0, 0, 118 }, { 10, 0, 73 }, { 0, 0, 97 },
+	{ CONSTANT_SLOT_EMPTY }, { 7, 0, 98 }, { 0, 0, 95 }, { 0, 0, 109 },
+	{ 7, 0, 0 }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY },
+	{ 7, 0, 204 }, { 0, 0, 98 }, { CONSTANT_SLOT_EMPTY }, { 1, 0, 10 },
+	{ 7, 0, 179 }, { 7, 0, 133 }, { 4, 0, 16 }, { 0, 0, 91 },
+	{ CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { 10, 0, 13 }, { 0, 0, 111 },
+	{ 7, 0, 67 }, { CONSTANT_SLOT_EMPTY }, { 10, 0, 11 }, { CONSTANT_SLOT_EMPTY },
+	{ 0, 0, 19 }, { 7, 0, 197 }, { 7, 0, 106 }, { CONSTANT_SLOT_EMPTY },
+	{ 10, 0, 21 }, { 7, 0, 202 }, { CONSTANT_SLOT_EMPTY }, { 10, 0, 15 },
+	{ 7, 0, 72 }, { 7, 0, 199 }, { CONSTANT_SLOT_EMPTY }, { 7, 0, 150 },
+	{ CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { 10, 0, 9 }, { CONSTANT_SLOT_EMPTY },
+	{ CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { 7, 0, 59 },
+	{ CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { 10, 0, 72 }, { 7, 0, 185 },
+	{ CONSTANT_SLOT_EMPTY }, { 0, 0, 67 }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY },
+	{ CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { 10, 0, 69 }, { CONSTANT_SLOT_EMPTY },
+	{ CONSTANT_SLOT_EMPTY }, { 2, 0, 3 }, { 10, 0, 28 }, { 10, 0, 6 },
+	{ 7, 0, 14 }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY },
+	{ CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY },
+	{ 7, 0, 165 }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY },
+	{ 7, 0, 205 }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY },
+	{ CONSTANT_SLOT_EMPTY }, { 0, 0, 18 }, { CONSTANT_SLOT_EMPTY }, { 7, 0, 104 },
+	{ 7, 0, 31 }, { CONSTANT_SLOT_EMPTY }, { 0, 0, 74 }, { 7, 0, 62 },
+	{ 7, 0, 5 }, { CONSTANT_SLOT_EMPTY }, { 0, 0, 116 }, { CONSTANT_SLOT_EMPTY },
+	{ 7, 0, 143 }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY },
+	{ CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { 7, 0, 60 },
+	{ CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY },
+	{ 0, 0, 66 }, { 4, 0, 1 }, { 10, 0, 65 }, { CONSTANT_SLOT_EMPTY },
+	{ 4, 0, 19 }, { CONSTANT_SLOT_EMPTY }, { 0, 0, 41 }, { 7, 0, 54 },
+	{ CONSTANT_SLOT_EMPTY }, { 7, 0, 190 }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY },
+	{ 7, 0, 41 }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY },
+	{ CONSTANT_SLOT_EMPTY }, { 9, 0, 0 }, { 7, 0, 203 }, { CONSTANT_SLOT_EMPTY },
+	{ 7, 0, 13 }, { CONSTANT_SLOT_EMPTY }, { 0, 0, 113 }, { 7, 0, 115 },
+	{ 7, 0, 79 }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY },
+	{ CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { 7, 0, 68 }, { CONSTANT_SLOT_EMPTY },
+	{ CONSTANT_SLOT_EMPTY }, { 0, 0, 20 }, { 0, 0, 13 }, { CONSTANT_SLOT_EMPTY },
+	{ 7, 0, 30 }, { 0, 0, 37 }, { 0, 0, 115 }, { CONSTANT_SLOT_EMPTY },
+	{ CONSTANT_SLOT_EMPTY }, { 7, 0, 186 }, { 7, 0, 206 }, { 10, 0, 56 },
+	{ 0, 0, 90 }, { CONSTANT_SLOT_EMPTY }, { 0, 0, 65 }, { 0, 0, 10 },
+	{ CONSTANT_SLOT_EMPTY }, { 7, 0, 56 }, { 10, 0, 29 }, { 7, 0, 120 },
+	{ CONSTANT_SLOT_EMPTY }, { 0, 0, 112 }, { 10, 0, 66 }, { CONSTANT_SLOT_EMPTY },
+	{ CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { 7, 0, 90 },
+	{ CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { 10, 0, 49 }, { CONSTANT_SLOT_EMPTY },
+	{ CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { 7, 0, 85 },
+	{ 7, 0, 99 }, { 0, 0, 39 }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY },
+	{ 10, 0, 61 }, { 0, 0, 32 }, { 7, 0, 151 }, { 0, 0, 57 },
+	{ CONSTANT_SLOT_EMPTY }, { 7, 0, 40 }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY },
+	{ 7, 0, 158 }, { 0, 0, 117 }, { 1, 0, 2 }, { 7, 0, 188 },
+	{ 10, 0, 36 }, { 7, 0, 11 }, { 7, 0, 93 }, { 7, 0, 65 },
+	{ CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { 4, 0, 0 }, { CONSTANT_SLOT_EMPTY },
+	{ CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { 0, 0, 7 }, { 0, 0, 77 },
+	{ CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { 7, 0, 117 }, { 10, 0, 55 },
+	{ CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { 10, 0, 74 }, { 0, 0, 68 },
+	{ CONSTANT_SLOT_EMPTY }, { 4, 0, 21 }, { 0, 0, 46 }, { 1, 0, 3 },
+	{ CONSTANT_SLOT_EMPTY }, { 7, 0, 168 }, { 0, 0, 62 }, { CONSTANT_SLOT_EMPTY },
+	{ 7, 0, 152 }, { 7, 0, 16 }, { CONSTANT_SLOT_EMPTY }, { 10, 0, 40 },
+	{ 7, 0, 122 }, { CONSTANT_SLOT_EMPTY }, { 7, 0, 18 }, { 0, 0, 15 },
+	{ 7, 0, 200 }, { CONSTANT_SLOT_EMPTY }, { 0, 0, 71 }, { 7, 0, 141 },
+	{ CONSTANT_SLOT_EMPTY }, { 0, 0, 108 }, { 2, 0, 1 }, { 0, 0, 47 },
+	{ CONSTANT_SLOT_EMPTY }, { 7, 0, 191 }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY },
+	{ 7, 0, 47 }, { CONSTANT_SLOT_EMPTY }, { 10, 0, 35 }, { CONSTANT_SLOT_EMPTY },
+	{ CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { 4, 0, 8 }, { CONSTANT_SLOT_EMPTY },
+	{ 7, 0, 94 }, { 0, 0, 23 }, { CONSTANT_SLOT_EMPTY }, { 10, 0, 32 },
+	{ 4, 0, 12 }, { 10, 0, 54 }, { 7, 0, 52 }, { CONSTANT_SLOT_EMPTY },
+	{ 0, 0, 88 }, { 0, 0, 93 }, { CONSTANT_SLOT_EMPTY }, { 7, 0, 35 },
+	{ CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { 7, 0, 157 },
+	{ CONSTANT_SLOT_EMPTY }, { 7, 0, 211 }, { CONSTANT_SLOT_EMPTY }, { 7, 0, 193 },
+	{ CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY },
+	{ CONSTANT_SLOT_EMPTY }, { 0, 0, 119 }, { 7, 0, 196 }, { 7, 0, 25 },
+	{ CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY },
+	{ 4, 0, 14 }, { 7, 0, 29 }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY },
+	{ CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { 7, 0, 148 }, { CONSTANT_SLOT_EMPTY },
+	{ CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { 10, 0, 51 }, { CONSTANT_SLOT_EMPTY },
+	{ 3, 0, 1 }, { 0, 0, 50 }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY },
+	{ CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { 2, 0, 2 }, { 7, 0, 142 },
+	{ 7, 0, 138 }, { CONSTANT_SLOT_EMPTY }, { 10, 0, 53 }, { CONSTANT_SLOT_EMPTY },
+	{ 4, 0, 9 }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { 7, 0, 89 },
+	{ CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY },
+	{ 7, 0, 19 }, { 2, 0, 5 }, { 7, 0, 116 }, { 7, 0, 75 },
+	{ 0, 0, 58 }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { 7, 0, 195 },
+	{ CONSTANT_SLOT_EMPTY }, { 10, 0, 59 }, { 7, 0, 173 }, { CONSTANT_SLOT_EMPTY },
+	{ CONSTANT_SLOT_EMPTY }, { 0, 0, 17 }, { 7, 0, 58 }, { CONSTANT_SLOT_EMPTY },
+	{ CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { 7, 0, 207 },
+	{ CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY },
+	{ 0, 0, 55 }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { 10, 0, 60 },
+	{ CONSTANT_SLOT_EMPTY }, { 0, 0, 33 }, { 0, 0, 64 }, { CONSTANT_SLOT_EMPTY },
+	{ 7, 0, 176 }, { 7, 0, 132 }, { CONSTANT_SLOT_EMPTY }, { 7, 0, 32 },
+	{ 0, 0, 84 }, { 0, 0, 21 }, { 7, 0, 114 }, { CONSTANT_SLOT_EMPTY },
+	{ 10, 0, 43 }, { 7, 0, 107 }, { 1, 0, 7 }, { CONSTANT_SLOT_EMPTY },
+	{ 0, 0, 94 }, { 7, 0, 184 }, { 7, 0, 178 }, { CONSTANT_SLOT_EMPTY },
+	{ 0, 0, 52 }, { CONSTANT_SLOT_EMPTY }, { 10, 0, 68 }, { 10, 0, 64 },
+	{ 0, 0, 106 }, { CONSTANT_SLOT_EMPTY }, { 7, 0, 81 }, { CONSTANT_SLOT_EMPTY },
+	{ CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { 7, 0, 103 }, { CONSTANT_SLOT_EMPTY },
+	{ 10, 0, 20 }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY },
+	{ 7, 0, 37 }, { CONSTANT_SLOT_EMPTY }, { 7, 0, 201 }, { 7, 0, 187 },
+	{ 7, 0, 183 }, { 0, 0, 2 }, { CONSTANT_SLOT_EMPTY }, { 0, 0, 51 },
+	{ 7, 0, 6 }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY },
+	{ 10, 0, 84 }, { CONSTANT_SLOT_EMPTY }, { 10, 0, 4 }, { CONSTANT_SLOT_EMPTY },
+	{ 8, 0, 1 }, { CONSTANT_SLOT_EMPTY }, { 0, 0, 53 }, { 7, 0, 147 },
+	{ CONSTANT_SLOT_EMPTY }, { 10, 0, 76 }, { CONSTANT_SLOT_EMPTY }, { 10, 0, 2 },
+	{ CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { 7, 0, 210 },
+	{ CONSTANT_SLOT_EMPTY }, { 0, 0, 34 }, { 7, 0, 69 }, { CONSTANT_SLOT_EMPTY },
+	{ CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { 10, 0, 77 },
+	{ 7, 0, 128 }, { CONSTANT_SLOT_EMPTY }, { 10, 0, 75 }, { CONSTANT_SLOT_EMPTY },
+	{ 7, 0, 127 }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { 0, 0, 1 },
+	{ 7, 0, 126 }, { 0, 0, 54 }, { 7, 0, 113 }, { CONSTANT_SLOT_EMPTY },
+	{ CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY },
+	{ CONSTANT_SLOT_EMPTY }, { 7, 0, 159 }, { 9, 0, 1 }, { 7, 0, 208 },
+	{ CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { 0, 0, 30 }, { CONSTANT_SLOT_EMPTY },
+	{ 7, 0, 212 }, { 4, 0, 10 }, { 7, 0, 129 }, { CONSTANT_SLOT_EMPTY },
+	{ CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { 10, 0, 33 },
+	{ 7, 0, 139 }, { CONSTANT_SLOT_EMPTY }, { 1, 0, 9 }, { 7, 0, 160 },
+	{ CONSTANT_SLOT_EMPTY }, { 0, 0, 69 }, { CONSTANT_SLOT_EMPTY }, { 10, 0, 46 },
+	{ CONSTANT_SLOT_EMPTY }, { 7, 0, 166 }, { 7, 0, 146 }, { 2, 0, 4 },
+	{ CONSTANT_SLOT_EMPTY }, { 10, 0, 26 }, { CONSTANT_SLOT_EMPTY }, { 4, 0, 13 },
+	{ 10, 0, 45 }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY },
+	{ 4, 0, 15 }, { 7, 0, 182 }, { CONSTANT_SLOT_EMPTY }, { 1, 0, 4 },
+	{ CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { 7, 0, 76 },
+	{ 10, 0, 39 }, { CONSTANT_SLOT_EMPTY }, { 7, 0, 167 }, { CONSTANT_SLOT_EMPTY },
+	{ CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { 0, 0, 78 }, { CONSTANT_SLOT_EMPTY },
+	{ 7, 0, 121 }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY },
+	{ 7, 0, 125 }, { CONSTANT_SLOT_EMPTY }, { 4, 0, 22 }, { CONSTANT_SLOT_EMPTY },
+	{ 7, 0, 39 }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { 10, 0, 42 },
+	{ CONSTANT_SLOT_EMPTY }, { 10, 0, 52 }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY },
+	{ 7, 0, 87 }, { 0, 0, 75 }, { 7, 0, 4 }, { 7, 0, 9 },
+	{ CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY },
+	{ CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { 7, 0, 136 }, { 0, 0, 87 },
+	{ 7, 0, 3 }, { 10, 0, 22 }, { 7, 0, 74 }, { CONSTANT_SLOT_EMPTY },
+	{ CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { 7, 0, 174 }, { CONSTANT_SLOT_EMPTY },
+	{ 0, 0, 9 }, { 7, 0, 73 }, { 1, 0, 14 }, { CONSTANT_SLOT_EMPTY },
+	{ 7, 0, 164 }, { 7, 0, 83 }, { 7, 0, 189 }, { 0, 0, 49 },
+	{ CONSTANT_SLOT_EMPTY }, { 7, 0, 64 }, { 10, 0, 10 }, { CONSTANT_SLOT_EMPTY },
+	{ CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { 10, 0, 3 }, { 7, 0, 43 },
+	{ 7, 0, 80 }, { CONSTANT_SLOT_EMPTY }, { 7, 0, 154 }, { 7, 0, 123 },
+};
+
+static const unsigned short nick_displace[128] = {
+	3, 1, 8, 1, 5, 6, 3, 2, 18, 1,
+	17, 1, 1, 7, 2, 1, 4, 12, 4, 14,
+	6, 3, 3, 0, 4, 1, 1, 2, 9, 4,
+	14, 1, 15, 2, 3, 2, 2, 3, 10, 2,
+	19, 23, 1, 3, 1, 5, 2, 2, 30, 19,
+	1, 1, 1, 5, 1, 5, 7, 12, 10, 1,
+	11, 5, 4, 1, 21, 5, 1, 6, 23, 41,
+	3, 8, 3, 4, 3, 5, 25, 27, 1, 1,
+	10, 1, 1, 4, 1, 4, 2, 6, 1, 26,
+	7, 4, 15, 3, 16, 5, 4, 16, 1, 5,
+	8, 5, 9, 16, 32, 14, 6, 4, 29, 1,
+	1, 4, 7, 27, 1, 18, 3, 5, 6, 2,
+	16, 1, 34, 8, 0, 20, 3, 7,
+};
+
+static const constant_slot nick_slots[512] = {
+	{ 0, 0, 94 }, { CONSTANT_SLOT_EMPTY }, { 0, 0, 2 }, { 7, 0, 10 },
+	{ 0, 0, 72 }, { 7, 0, 183 }, { 4, 0, 7 }, { 0, 0, 27 },
+	{ 0, 0, 11 }, { 7, 0, 153 }, { 7, 0, 149 }, { CONSTANT_SLOT_EMPTY },
+	{ 7, 0, 81 }, { 7, 0, 69 }, { 7, 0, 58 }, { 0, 0, 17 },
+	{ 0, 0, 58 }, { 0, 0, 53 }, { 7, 0, 28 }, { 7, 0, 112 },
+	{ 7, 0, 42 }, { 7, 0, 127 }, { CONSTANT_SLOT_EMPTY }, { 0, 0, 108 },
+	{ 0, 0, 30 }, { 0, 0, 29 }, { 7, 0, 188 }, { 0, 0, 13 },
+	{ 6, 0, 0 }, { 0, 0, 118 }, { 7, 0, 47 }, { 7, 0, 26 },
+	{ 7, 0, 146 }, { 7, 0, 136 }, { 7, 0, 53 }, { 7, 0, 90 },
+	{ 0, 0, 60 }, { 7, 0, 57 }, { 7, 0, 89 }, { 0, 0, 45 },
+	{ 7, 0, 82 }, { 7, 0, 61 }, { 7, 0, 14 }, { 7, 0, 17 },
+	{ 0, 0, 31 }, { 0, 0, 96 }, { CONSTANT_SLOT_EMPTY }, { 0, 0, 0 },
+	{ 0, 0, 73 }, { CONSTANT_SLOT_EMPTY }, { 0, 0, 8 }, { CONSTANT_SLOT_EMPTY },
+	{ CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { 7, 0, 73 }, { 0, 0, 98 },
+	{ CONSTANT_SLOT_EMPTY }, { 4, 0, 8 }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY },
+	{ 7, 0, 138 }, { 7, 0, 1 }, { 7, 0, 105 }, { CONSTANT_SLOT_EMPTY },
+	{ CONSTANT_SLOT_EMPTY }, { 4, 0, 16 }, { 0, 0, 57 }, { CONSTANT_SLOT_EMPTY },
+	{ 7, 0, 64 }, { 7, 0, 7 }, { 7, 0, 189 }, { CONSTANT_SLOT_EMPTY },
+	{ 0, 0, 116 }, { 1, 0, 7 }, { CONSTANT_SLOT_EMPTY }, { 7, 0, 184 },
+	{ 7, 0, 171 }, { CONSTANT_SLOT_EMPTY }, { 7, 0, 203 }, { 0, 0, 25 },
+	{ 0, 0, 101 }, { 7, 0, 31 }, { CONSTANT_SLOT_EMPTY }, { 0, 0, 26 },
+	{ 0, 0, 79 }, { 5, 0, 1 }, { CONSTANT_SLOT_EMPTY }, { 7, 0, 192 },
+	{ 4, 0, 22 }, { 7, 0, 34 }, { 7, 0, 163 }, { 0, 0, 33 },
+	{ CONSTANT_SLOT_EMPTY }, { 7, 0, 84 }, { 0, 0, 93 }, { CONSTANT_SLOT_EMPTY },
+	{ 7, 0, 142 }, { CONSTANT_SLOT_EMPTY }, { 0, 0, 55 }, { 0, 0, 62 },
+	{ CONSTANT_SLOT_EMPTY }, { 7, 0, 0 }, { 7, 0, 154 }, { 4, 0, 6 },
+	{ 7, 0, 92 }, { 7, 0, 29 }, { 7, 0, 182 }, { 0, 0, 99 },
+	{ 0, 0, 82 }, { 7, 0, 101 }, { 0, 0, 97 }, { 7, 0, 156 },
+	{ 7, 0, 65 }, { 7, 0, 86 }, { 0, 0, 115 }, { 0, 0, 75 },
+	{ 0, 0, 35 }, { 0, 0, 110 }, { 0, 0, 104 }, { 4, 0, 24 },
+	{ 7, 0, 205 }, { 7, 0, 9 }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY },
+	{ 4, 0, 11 }, { 4, 0, 21 }, { CONSTANT_SLOT_EMPTY }, { 0, 0, 5 },
+	{ CONSTANT_SLOT_EMPTY }, { 7, 0, 91 }, { 0, 0, 21 }, { 0, 0, 16 },
+	{ 1, 0, 9 }, { 0, 0, 107 }, { 1, 0, 11 }, { 0, 0, 20 },
+	{ 7, 0, 181 }, { 0, 0, 1 }, { CONSTANT_SLOT_EMPTY }, { 7, 0, 155 },
+	{ 6, 0, 3 }, { 0, 0, 6 }, { 7, 0, 159 }, { 3, 0, 1 },
+	{ 7, 0, 162 }, { 0, 0, 12 }, { 1, 0, 6 }, { 7, 0, 120 },
+	{ 0, 0, 59 }, { 0, 0, 74 }, { CONSTANT_SLOT_EMPTY }, { 0, 0, 41 },
+	{ CONSTANT_SLOT_EMPTY }, { 1, 0, 3 }, { 7, 0, 27 }, { 4, 0, 2 },
+	{ 7, 0, 174 }, { 7, 0, 115 }, { 7, 0, 151 }, { 7, 0, 208 },
+	{ CONSTANT_SLOT_EMPTY }, { 2, 0, 5 }, { 0, 0, 37 }, { CONSTANT_SLOT_EMPTY },
+	{ 7, 0, 130 }, { 7, 0, 54 }, { CONSTANT_SLOT_EMPTY }, { 7, 0, 63 },
+	{ CONSTANT_SLOT_EMPTY }, { 7, 0, 212 }, { 7, 0, 118 }, { 7, 0, 83 },
+	{ 7, 0, 199 }, { CONSTANT_SLOT_EMPTY }, { 7, 0, 36 }, { 7, 0, 5 },
+	{ 7, 0, 144 }, { 7, 0, 198 }, { 0, 0, 61 }, { 7, 0, 67 },
+	{ CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { 1, 0, 12 }, { 7, 0, 48 },
+	{ CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { 3, 0, 0 }, { 7, 0, 166 },
+	{ CONSTANT_SLOT_EMPTY }, { 7, 0, 196 }, { 7, 0, 77 }, { 0, 0, 120 },
+	{ 2, 0, 1 }, { 0, 0, 49 }, { CONSTANT_SLOT_EMPTY }, { 0, 0, 81 },
+	{ CONSTANT_SLOT_EMPTY }, { 7, 0, 193 }, { 0, 0, 28 }, { 7, 0, 139 },
+	{ 1, 0, 14 }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { 0, 0, 63 },
+	{ 7, 0, 152 }, { CONSTANT_SLOT_EMPTY }, { 0, 0, 70 }, { 7, 0, 2 },
+	{ 7, 0, 177 }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { 7, 0, 147 },
+	{ CONSTANT_SLOT_EMPTY }, { 7, 0, 170 }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY },
+	{ 7, 0, 52 }, { 0, 0, 77 }, { 7, 0, 93 }, { 7, 0, 6 },
+	{ 1, 0, 0 }, { 7, 0, 211 }, { CONSTANT_SLOT_EMPTY }, { 4, 0, 18 },
+	{ CONSTANT_SLOT_EMPTY }, { 7, 0, 50 }, { CONSTANT_SLOT_EMPTY }, { 7, 0, 104 },
+	{ 4, 0, 20 }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY },
+	{ 0, 0, 76 }, { CONSTANT_SLOT_EMPTY }, { 4, 0, 9 }, { 7, 0, 185 },
+	{ 7, 0, 96 }, { 0, 0, 109 }, { CONSTANT_SLOT_EMPTY }, { 0, 0, 69 },
+	{ 7, 0, 45 }, { CONSTANT_SLOT_EMPTY }, { 7, 0, 30 }, { 7, 0, 186 },
+	{ 7, 0, 56 }, { 0, 0, 86 }, { 0, 0, 92 }, { 0, 0, 78 },
+	{ CONSTANT_SLOT_EMPTY }, { 0, 0, 119 }, { 0, 0, 90 }, { 7, 0, 25 },
+	{ 7, 0, 8 }, { CONSTANT_SLOT_EMPTY }, { 0, 0, 89 }, { CONSTANT_SLOT_EMPTY },
+	{ 7, 0, 55 }, { 7, 0, 40 }, { CONSTANT_SLOT_EMPTY }, { 0, 0, 14 },
+	{ 7, 0, 59 }, { 7, 0, 117 }, { CONSTANT_SLOT_EMPTY }, { 7, 0, 18 },
+	{ CONSTANT_SLOT_EMPTY }, { 0, 0, 84 }, { CONSTANT_SLOT_EMPTY }, { 0, 0, 7 },
+	{ CONSTANT_SLOT_EMPTY }, { 3, 0, 2 }, { 7, 0, 180 }, { CONSTANT_SLOT_EMPTY },
+	{ 6, 0, 1 }, { 0, 0, 52 }, { 7, 0, 78 }, { CONSTANT_SLOT_EMPTY },
+	{ 7, 0, 99 }, { 0, 0, 88 }, { 7, 0, 3 }, { 7, 0, 15 },
+	{ CONSTANT_SLOT_EMPTY }, { 1, 0, 5 }, { CONSTANT_SLOT_EMPTY }, { 0, 0, 64 },
+	{ 7, 0, 13 }, { 7, 0, 201 }, { CONSTANT_SLOT_EMPTY }, { 0, 0, 106 },
+	{ 0, 0, 18 }, { 7, 0, 158 }, { 0, 0, 22 }, { 0, 0, 46 },
+	{ 7, 0, 137 }, { CONSTANT_SLOT_EMPTY }, { 7, 0, 35 }, { 7, 0, 150 },
+	{ 7, 0, 102 }, { 0, 0, 15 }, { 7, 0, 4 }, { 7, 0, 178 },
+	{ 7, 0, 116 }, { 7, 0, 133 }, { 0, 0, 66 }, { CONSTANT_SLOT_EMPTY },
+	{ 0, 0, 80 }, { 7, 0, 145 }, { 0, 1, 44 }, { 4, 0, 14 },
+	{ CONSTANT_SLOT_EMPTY }, { 7, 0, 38 }, { 7, 0, 204 }, { 7, 0, 108 },
+	{ 7, 0, 132 }, { 0, 0, 112 }, { 7, 0, 46 }, { 7, 0, 107 },
+	{ 7, 0, 72 }, { 7, 0, 43 }, { 0, 0, 87 }, { CONSTANT_SLOT_EMPTY },
+	{ 7, 0, 21 }, { 7, 0, 202 }, { 0, 0, 102 }, { 7, 0, 68 },
+	{ 7, 0, 135 }, { CONSTANT_SLOT_EMPTY }, { 4, 0, 19 }, { 7, 0, 32 },
+	{ 7, 0, 98 }, { 0, 0, 40 }, { CONSTANT_SLOT_EMPTY }, { 7, 0, 207 },
+	{ 0, 0, 43 }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { 4, 0, 12 },
+	{ 7, 0, 12 }, { 7, 0, 49 }, { 0, 0, 105 }, { 7, 0, 95 },
+	{ CONSTANT_SLOT_EMPTY }, { 1, 0, 15 }, { 7, 0, 66 }, { 0, 0, 38 },
+	{ CONSTANT_SLOT_EMPTY }, { 7, 0, 206 }, { 0, 0, 24 }, { CONSTANT_SLOT_EMPTY },
+	{ 7, 0, 51 }, { 7, 0, 200 }, { 7, 0, 33 }, { 7, 0, 44 },
+	{ CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { 7, 0, 167 }, { 7, 0, 85 },
+	{ 2, 0, 2 }, { 7, 0, 41 }, { CONSTANT_SLOT_EMPTY }, { 7, 0, 75 },
+	{ 0, 0, 51 }, { 7, 0, 164 }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY },
+	{ CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { 7, 0, 19 },
+	{ CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { 0, 0, 114 }, { 4, 0, 0 },
+	{ 7, 0, 88 }, { 7, 0, 22 }, { CONSTANT_SLOT_EMPTY }, { 7, 0, 176 },
+	{ 7, 0, 131 }, { 7, 0, 39 }, { 0, 0, 54 }, { 7, 0, 80 },
+	{ 7, 0, 62 }, { 0, 0, 19 }, { CONSTANT_SLOT_EMPTY }, { 0, 0, 65 },
+	{ 7, 0, 128 }, { 7, 0, 100 }, { 4, 0, 1 }, { 0, 0, 9 },
+	{ 7, 0, 134 }, { 7, 0, 109 }, { 6, 0, 2 }, { 7, 0, 74 },
+	{ 7, 0, 190 }, { 7, 0, 168 }, { 0, 0, 100 }, { 0, 0, 3 },
+	{ 7, 0, 195 }, { 4, 0, 5 }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY },
+	{ 7, 0, 23 }, { 7, 0, 169 }, { 7, 0, 187 }, { 7, 0, 194 },
+	{ 0, 0, 103 }, { 0, 0, 39 }, { 7, 0, 113 }, { 7, 0, 141 },
+	{ 7, 0, 197 }, { CONSTANT_SLOT_EMPTY }, { 7, 0, 126 }, { 4, 0, 13 },
+	{ 7, 0, 71 }, { CONSTANT_SLOT_EMPTY }, { 0, 0, 117 }, { 0, 0, 85 },
+	{ 5, 0, 0 }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { 5, 0, 2 },
+	{ 0, 0, 47 }, { CONSTANT_SLOT_EMPTY }, { 7, 0, 111 }, { CONSTANT_SLOT_EMPTY },
+	{ CONSTANT_SLOT_EMPTY }, { 0, 0, 36 }, { 7, 0, 76 }, { CONSTANT_SLOT_EMPTY },
+	{ CONSTANT_SLOT_EMPTY }, { 0, 0, 50 }, { 7, 0, 191 }, { 7, 0, 161 },
+	{ 4, 0, 4 }, { 4, 0, 17 }, { CONSTANT_SLOT_EMPTY }, { 1, 0, 1 },
+	{ 1, 0, 10 }, { 0, 0, 56 }, { 7, 0, 20 }, { 7, 0, 119 },
+	{ 7, 0, 24 }, { CONSTANT_SLOT_EMPTY }, { 7, 0, 129 }, { 7, 0, 160 },
+	{ 0, 0, 48 }, { CONSTANT_SLOT_EMPTY }, { 7, 0, 124 }, { 0, 0, 83 },
+	{ CONSTANT_SLOT_EMPTY }, { 0, 0, 10 }, { 7, 0, 103 }, { 0, 0, 4 },
+	{ 7, 0, 165 }, { 1, 0, 4 }, { CONSTANT_SLOT_EMPTY }, { 7, 0, 125 },
+	{ 2, 0, 3 }, { 7, 0, 210 }, { 0, 0, 44 }, { 7, 0, 79 },
+	{ 0, 0, 67 }, { 7, 0, 60 }, { CONSTANT_SLOT_EMPTY }, { 7, 0, 179 },
+	{ 7, 0, 70 }, { 1, 0, 2 }, { 0, 0, 113 }, { CONSTANT_SLOT_EMPTY },
+	{ 0, 0, 95 }, { 0, 0, 91 }, { CONSTANT_SLOT_EMPTY }, { 7, 0, 148 },
+	{ 7, 0, 173 }, { 7, 0, 143 }, { 2, 0, 4 }, { 7, 0, 97 },
+	{ CONSTANT_SLOT_EMPTY }, { 7, 0, 157 }, { 7, 0, 87 }, { 7, 0, 114 },
+	{ 7, 0, 123 }, { 0, 0, 111 }, { CONSTANT_SLOT_EMPTY }, { 7, 0, 175 },
+	{ 0, 0, 42 }, { 7, 0, 122 }, { 0, 0, 34 }, { 0, 0, 71 },
+	{ 2, 0, 0 }, { 7, 0, 11 }, { 0, 0, 32 }, { 0, 0, 68 },
+	{ CONSTANT_SLOT_EMPTY }, { 7, 0, 110 }, { 7, 0, 106 }, { 7, 0, 140 },
+	{ 7, 0, 209 }, { 1, 0, 8 }, { CONSTANT_SLOT_EMPTY }, { 7, 0, 172 },
+	{ 0, 0, 23 }, { CONSTANT_SLOT_EMPTY }, { 4, 0, 10 }, { CONSTANT_SLOT_EMPTY },
+	{ 4, 0, 3 }, { 7, 0, 94 }, { CONSTANT_SLOT_EMPTY }, { 7, 0, 121 },
+	{ 4, 0, 23 }, { 4, 0, 15 }, { 1, 0, 13 }, { CONSTANT_SLOT_EMPTY },
+};
+
+static const unsigned short value_displace[128] = {
+	5, 2, 2, 1, 2, 5, 1, 1, 3, 1,
+	1, 4, 1, 7, 1, 1, 1, 3, 1, 1,
+	1, 1, 2, 1, 1, 7, 2, 2, 2, 2,
+	1, 5, 1, 1, 3, 3, 1, 14, 1, 3,
+	1, 2, 1, 2, 2, 2, 2, 1, 2, 0,
+	1, 1, 2, 6, 1, 2, 1, 4, 3, 3,
+	4, 20, 1, 6, 6, 1, 3, 1, 2, 4,
+	1, 11, 1, 3, 1, 8, 1, 6, 1, 4,
+	3, 3, 1, 18, 2, 1, 8, 3, 16, 2,
+	4, 1, 3, 1, 9, 3, 10, 13, 1, 2,
+	2, 13, 25, 3, 1, 2, 1, 1, 2, 1,
+	3, 2, 2, 3, 4, 8, 9, 1, 1, 11,
+	4, 3, 1, 1, 1, 1, 4, 2,
+};
+
+static const constant_slot value_slots[1024] = {
+	{ CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY },
+	{ 1, 0, 11 }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { 7, 0, 34 },
+	{ 6, 0, 2 }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY },
+	{ CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { 10, 0, 27 }, { CONSTANT_SLOT_EMPTY },
+	{ 0, 0, 35 }, { CONSTANT_SLOT_EMPTY }, { 0, 0, 111 }, { 4, 0, 19 },
+	{ 7, 0, 201 }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { 0, 0, 26 },
+	{ CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY },
+	{ CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { 0, 0, 108 },
+	{ 0, 0, 55 }, { CONSTANT_SLOT_EMPTY }, { 7, 0, 161 }, { 7, 0, 192 },
+	{ CONSTANT_SLOT_EMPTY }, { 4, 0, 6 }, { 7, 0, 115 }, { 0, 0, 17 },
+	{ CONSTANT_SLOT_EMPTY }, { 0, 0, 30 }, { 0, 0, 101 }, { 7, 0, 134 },
+	{ 7, 0, 193 }, { 7, 0, 205 }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY },
+	{ 10, 0, 10 }, { 0, 0, 120 }, { 0, 0, 89 }, { 7, 0, 68 },
+	{ 10, 0, 44 }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY },
+	{ CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { 0, 0, 113 },
+	{ CONSTANT_SLOT_EMPTY }, { 7, 0, 109 }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY },
+	{ 0, 0, 83 }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { 0, 0, 64 },
+	{ CONSTANT_SLOT_EMPTY }, { 10, 0, 34 }, { CONSTANT_SLOT_EMPTY }, { 7, 0, 29 },
+	{ CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY },
+	{ CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY },
+	{ CONSTANT_SLOT_EMPTY }, { 8, 0, 3 }, { 7, 0, 164 }, { 0, 0, 110 },
+	{ 7, 0, 104 }, { CONSTANT_SLOT_EMPTY }, { 0, 0, 74 }, { 7, 0, 82 },
+	{ CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { 0, 0, 1 },
+	{ 7, 0, 2 }, { 0, 0, 65 }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY },
+	{ 0, 0, 107 }, { 7, 0, 106 }, { CONSTANT_SLOT_EMPTY }, { 0, 0, 51 },
+	{ CONSTANT_SLOT_EMPTY }, { 7, 0, 198 }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY },
+	{ 10, 0, 67 }, { 0, 0, 116 }, { 7, 0, 110 }, { CONSTANT_SLOT_EMPTY },
+	{ 7, 0, 51 }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY },
+	{ 10, 0, 17 }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { 7, 0, 6 },
+	{ 7, 0, 5 }, { 7, 0, 124 }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY },
+	{ CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY },
+	{ CONSTANT_SLOT_EMPTY }, { 0, 0, 7 }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY },
+	{ CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY },
+	{ CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { 4, 0, 12 }, { CONSTANT_SLOT_EMPTY },
+	{ CONSTANT_SLOT_EMPTY }, { 7, 0, 180 }, { 10, 0, 54 }, { 0, 0, 8 },
+	{ CONSTANT_SLOT_EMPTY }, { 7, 0, 196 }, { CONSTANT_SLOT_EMPTY }, { 7, 0, 32 },
+	{ 10, 0, 26 }, { 7, 0, 197 }, { 10, 0, 76 }, { CONSTANT_SLOT_EMPTY },
+	{ CONSTANT_SLOT_EMPTY }, { 0, 0, 10 }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY },
+	{ 0, 0, 81 }, { 7, 0, 102 }, { 7, 0, 4 }, { CONSTANT_SLOT_EMPTY },
+	{ 0, 0, 72 }, { 7, 0, 76 }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY },
+	{ CONSTANT_SLOT_EMPTY }, { 7, 0, 58 }, { 7, 0, 7 }, { CONSTANT_SLOT_EMPTY },
+	{ CONSTANT_SLOT_EMPTY }, { 7, 0, 66 }, { 0, 0, 98 }, { 0, 0, 39 },
+	{ 7, 0, 72 }, { 0, 0, 119 }, { 9, 0, 2 }, { 7, 0, 56 },
+	{ CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { 7, 0, 114 }, { 7, 0, 3 },
+	{ 7, 0, 45 }, { 0, 0, 79 }, { CONSTANT_SLOT_EMPTY }, { 10, 0, 32 },
+	{ CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { 0, 0, 69 },
+	{ 0, 0, 106 }, { 0, 0, 56 }, { CONSTANT_SLOT_EMPTY }, { 7, 0, 47 },
+	{ 7, 0, 52 }, { 10, 0, 77 }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY },
+	{ 7, 0, 37 }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY },
+	{ 0, 0, 3 }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY },
+	{ CONSTANT_SLOT_EMPTY }, { 10, 0, 42 }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY },
+	{ CONSTANT_SLOT_EMPTY }, { 7, 0, 96 }, { 7, 0, 177 }, { 7, 0, 143 },
+	{ 7, 0, 125 }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { 7, 0, 79 },
+	{ CONSTANT_SLOT_EMPTY }, { 10, 0, 69 }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY },
+	{ 7, 0, 28 }, { 10, 0, 70 }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY },
+	{ 0, 0, 103 }, { 7, 0, 185 }, { 0, 0, 95 }, { 5, 0, 0 },
+	{ CONSTANT_SLOT_EMPTY }, { 7, 0, 40 }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY },
+	{ 7, 0, 0 }, { 0, 0, 71 }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY },
+	{ CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { 10, 0, 58 }, { 7, 0, 81 },
+	{ 10, 0, 62 }, { CONSTANT_SLOT_EMPTY }, { 9, 0, 0 }, { CONSTANT_SLOT_EMPTY },
+	{ 1, 0, 8 }, { CONSTANT_SLOT_EMPTY }, { 0, 0, 6 }, { CONSTANT_SLOT_EMPTY },
+	{ CONSTANT_SLOT_EMPTY }, { 7, 0, 80 }, { CONSTANT_SLOT_EMPTY }, { 10, 0, 66 },
+	{ CONSTANT_SLOT_EMPTY }, { 0, 0, 22 }, { 7, 0, 42 }, { 10, 0, 3 },
+	{ 7, 0, 190 }, { CONSTANT_SLOT_EMPTY }, { 10, 0, 63 }, { CONSTANT_SLOT_EMPTY },
+	{ CONSTANT_SLOT_EMPTY }, { 7, 0, 38 }, { CONSTANT_SLOT_EMPTY }, { 7, 0, 133 },
+	{ CONSTANT_SLOT_EMPTY }, { 8, 0, 2 }, { 4, 0, 13 }, { 7, 0, 165 },
+	{ 10, 0, 2 }, { 4, 0, 22 }, { 7, 0, 93 }, { CONSTANT_SLOT_EMPTY },
+	{ CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { 0, 0, 54 }, { CONSTANT_SLOT_EMPTY },
+	{ CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { 7, 0, 128 }, { CONSTANT_SLOT_EMPTY },
+	{ CONSTANT_SLOT_EMPTY }, { 10, 0, 57 }, { 0, 0, 59 }, { 0, 0, 31 },
+	{ CONSTANT_SLOT_EMPTY }, { 0, 0, 27 }, { CONSTANT_SLOT_EMPTY }, { 7, 0, 121 },
+	{ CONSTANT_SLOT_EMPTY }, { 7, 0, 210 }, { 7, 0, 174 }, { 4, 0, 24 },
+	{ 7, 0, 158 }, { 10, 0, 41 }, { 0, 0, 70 }, { 8, 0, 4 },
+	{ CONSTANT_SLOT_EMPTY }, { 7, 0, 122 }, { 7, 0, 119 }, { 10, 0, 84 },
+	{ CONSTANT_SLOT_EMPTY }, { 8, 0, 1 }, { CONSTANT_SLOT_EMPTY }, { 7, 0, 1 },
+	{ CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { 2, 0, 0 },
+	{ CONSTANT_SLOT_EMPTY }, { 10, 0, 71 }, { 7, 0, 13 }, { 10, 0, 36 },
+	{ CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { 7, 0, 64 },
+	{ CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY },
+	{ 7, 0, 202 }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { 1, 0, 4 },
+	{ CONSTANT_SLOT_EMPTY }, { 10, 0, 51 }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY },
+	{ CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { 10, 0, 5 }, { 1, 0, 9 },
+	{ 7, 0, 14 }, { 10, 0, 16 }, { 0, 0, 104 }, { 0, 0, 21 },
+	{ CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { 7, 0, 103 }, { CONSTANT_SLOT_EMPTY },
+	{ CONSTANT_SLOT_EMPTY }, { 10, 0, 39 }, { 7, 0, 176 }, { 7, 0, 208 },
+	{ 0, 0, 36 }, { CONSTANT_SLOT_EMPTY }, { 1, 0, 1 }, { 1, 0, 3 },
+	{ CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { 0, 0, 115 },
+	{ CONSTANT_SLOT_EMPTY }, { 0, 0, 90 }, { 7, 0, 160 }, { 4, 0, 10 },
+	{ CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { 7, 0, 118 },
+	{ CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { 7, 0, 123 },
+	{ CONSTANT_SLOT_EMPTY }, { 7, 0, 77 }, { 7, 0, 137 }, { 0, 0, 80 },
+	{ 1, 0, 15 }, { 4, 0, 16 }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY },
+	{ CONSTANT_SLOT_EMPTY }, { 10, 0, 9 }, { CONSTANT_SLOT_EMPTY }, { 0, 0, 77 },
+	{ CONSTANT_SLOT_EMPTY }, { 7, 0, 11 }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY },
+	{ 7, 0, 98 }, { CONSTANT_SLOT_EMPTY }, { 7, 0, 157 }, { 0, 0, 28 },
+	{ CONSTANT_SLOT_EMPTY }, { 0, 0, 75 }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY },
+	{ CONSTANT_SLOT_EMPTY }, { 10, 0, 6 }, { CONSTANT_SLOT_EMPTY }, { 7, 0, 203 },
+	{ 7, 0, 92 }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { 7, 0, 20 },
+	{ CONSTANT_SLOT_EMPTY }, { 4, 0, 3 }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY },
+	{ CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY },
+	{ 7, 0, 146 }, { 6, 0, 0 }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY },
+	{ CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY },
+	{ 7, 0, 147 }, { 10, 0, 1 }, { 10, 0, 24 }, { 4, 0, 11 },
+	{ CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY },
+	{ CONSTANT_SLOT_EMPTY }, { 7, 0, 163 }, { 0, 0, 40 }, { CONSTANT_SLOT_EMPTY },
+	{ 7, 0, 85 }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { 0, 0, 82 },
+	{ 7, 0, 184 }, { 7, 0, 101 }, { CONSTANT_SLOT_EMPTY }, { 0, 0, 32 },
+	{ CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { 10, 0, 28 }, { 7, 0, 60 },
+	{ CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY },
+	{ CONSTANT_SLOT_EMPTY }, { 10, 0, 73 }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY },
+	{ CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { 1, 0, 10 },
+	{ CONSTANT_SLOT_EMPTY }, { 7, 0, 191 }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY },
+	{ CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY },
+	{ CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { 10, 0, 25 }, { 7, 0, 12 },
+	{ 0, 0, 48 }, { CONSTANT_SLOT_EMPTY }, { 7, 0, 169 }, { 7, 0, 139 },
+	{ 7, 0, 84 }, { CONSTANT_SLOT_EMPTY }, { 0, 0, 19 }, { CONSTANT_SLOT_EMPTY },
+	{ 10, 0, 55 }, { 10, 0, 20 }, { 7, 0, 63 }, { 10, 0, 83 },
+	{ 4, 0, 9 }, { 7, 0, 188 }, { CONSTANT_SLOT_EMPTY }, { 7, 0, 186 },
+	{ CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY },
+	{ 7, 0, 10 }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { 7, 0, 100 },
+	{ CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { 0, 0, 109 },
+	{ CONSTANT_SLOT_EMPTY }, { 10, 0, 11 }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY },
+	{ CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { 7, 0, 189 }, { CONSTANT_SLOT_EMPTY },
+	{ 7, 0, 86 }, { 10, 0, 13 }, { 4, 0, 0 }, { 0, 0, 47 },
+	{ 0, 0, 91 }, { 7, 0, 44 }, { CONSTANT_SLOT_EMPTY }, { 0, 0, 14 },
+	{ 10, 0, 81 }, { CONSTANT_SLOT_EMPTY }, { 7, 0, 25 }, { 0, 0, 66 },
+	{ 10, 0, 31 }, { CONSTANT_SLOT_EMPTY }, { 7, 0, 70 }, { 7, 0, 27 },
+	{ CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { 4, 0, 23 }, { CONSTANT_SLOT_EMPTY },
+	{ 7, 0, 73 }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY },
+	{ CONSTANT_SLOT_EMPTY }, { 2, 0, 4 }, { 10, 0, 49 }, { 7, 0, 75 },
+	{ CONSTANT_SLOT_EMPTY }, { 2, 0, 1 }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY },
+	{ CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { 7, 0, 16 }, { CONSTANT_SLOT_EMPTY },
+	{ 1, 0, 2 }, { 7, 0, 108 }, { 10, 0, 43 }, { CONSTANT_SLOT_EMPTY },
+	{ 7, 0, 65 }, { CONSTANT_SLOT_EMPTY }, { 0, 0, 84 }, { 7, 0, 112 },
+	{ 0, 0, 78 }, { CONSTANT_SLOT_EMPTY }, { 0, 0, 105 }, { CONSTANT_SLOT_EMPTY },
+	{ CONSTANT_SLOT_EMPTY }, { 4, 0, 4 }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY },
+	{ CONSTANT_SLOT_EMPTY }, { 10, 0, 33 }, { CONSTANT_SLOT_EMPTY }, { 0, 0, 67 },
+	{ CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY },
+	{ 10, 0, 18 }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY },
+	{ CONSTANT_SLOT_EMPTY }, { 4, 0, 8 }, { 7, 0, 131 }, { 7, 0, 36 },
+	{ CONSTANT_SLOT_EMPTY }, { 7, 0, 136 }, { 7, 0, 181 }, { 7, 0, 71 },
+	{ 0, 0, 114 }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY },
+	{ CONSTANT_SLOT_EMPTY }, { 3, 0, 1 }, { 7, 0, 120 }, { CONSTANT_SLOT_EMPTY },
+	{ CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY },
+	{ CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { 0, 0, 60 }, { 0, 0, 5 },
+	{ CONSTANT_SLOT_EMPTY }, { 0, 0, 76 }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY },
+	{ 0, 0, 85 }, { 7, 0, 150 }, { 7, 0, 62 }, { CONSTANT_SLOT_EMPTY },
+	{ CONSTANT_SLOT_EMPTY }, { 7, 0, 145 }, { 7, 0, 107 }, { CONSTANT_SLOT_EMPTY },
+	{ 7, 0, 59 }, { 0, 0, 50 }, { CONSTANT_SLOT_EMPTY }, { 0, 0, 11 },
+	{ 7, 0, 105 }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY },
+	{ 4, 0, 15 }, { 0, 0, 118 }, { 7, 0, 83 }, { 0, 0, 102 },
+	{ CONSTANT_SLOT_EMPTY }, { 7, 0, 132 }, { 7, 0, 90 }, { CONSTANT_SLOT_EMPTY },
+	{ 4, 0, 21 }, { 7, 0, 94 }, { 0, 0, 57 }, { 8, 0, 0 },
+	{ 7, 0, 182 }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY },
+	{ CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { 10, 0, 61 }, { 2, 0, 2 },
+	{ CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY },
+	{ 7, 0, 142 }, { 10, 0, 78 }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY },
+	{ 0, 0, 53 }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { 10, 0, 21 },
+	{ CONSTANT_SLOT_EMPTY }, { 7, 0, 48 }, { 10, 0, 38 }, { 7, 0, 30 },
+	{ CONSTANT_SLOT_EMPTY }, { 1, 0, 0 }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY },
+	{ CONSTANT_SLOT_EMPTY }, { 0, 0, 18 }, { 9, 0, 1 }, { CONSTANT_SLOT_EMPTY },
+	{ 0, 0, 61 }, { 7, 0, 126 }, { 4, 0, 17 }, { CONSTANT_SLOT_EMPTY },
+	{ CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { 7, 0, 61 },
+	{ 7, 0, 116 }, { CONSTANT_SLOT_EMPTY }, { 7, 0, 144 }, { CONSTANT_SLOT_EMPTY },
+	{ 0, 0, 38 }, { 0, 0, 62 }, { CONSTANT_SLOT_EMPTY }, { 4, 0, 14 },
+	{ CONSTANT_SLOT_EMPTY }, { 5, 0, 1 }, { 0, 0, 15 }, { 7, 0, 168 },
+	{ 10, 0, 60 }, { CONSTANT_SLOT_EMPTY }, { 7, 0, 99 }, { CONSTANT_SLOT_EMPTY },
+	{ 0, 0, 29 }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { 10, 0, 68 },
+	{ 7, 0, 95 }, { 0, 0, 117 }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY },
+	{ CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY },
+	{ CONSTANT_SLOT_EMPTY }, { 7, 0, 162 }, { 7, 0, 127 }, { CONSTANT_SLOT_EMPTY },
+	{ 7, 0, 206 }, { CONSTANT_SLOT_EMPTY }, { 7, 0, 113 }, { 10, 0, 7 },
+	{ CONSTANT_SLOT_EMPTY }, { 0, 0, 16 }, { 7, 0, 89 }, { CONSTANT_SLOT_EMPTY },
+	{ CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { 7, 0, 155 }, { CONSTANT_SLOT_EMPTY },
+	{ CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { 4, 0, 2 }, { 10, 0, 53 },
+	{ 0, 0, 13 }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { 10, 0, 72 },
+	{ 7, 0, 156 }, { 7, 0, 179 }, { 7, 0, 55 }, { 1, 0, 13 },
+	{ 4, 0, 20 }, { 1, 0, 7 }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY },
+	{ 7, 0, 172 }, { CONSTANT_SLOT_EMPTY }, { 0, 0, 86 }, { 10, 0, 19 },
+	{ CONSTANT_SLOT_EMPTY }, { 0, 0, 46 }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY },
+	{ CONSTANT_SLOT_EMPTY }, { 1, 0, 14 }, { CONSTANT_SLOT_EMPTY }, { 7, 0, 33 },
+	{ CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY },
+	{ 7, 0, 152 }, { CONSTANT_SLOT_EMPTY }, { 7, 0, 8 }, { CONSTANT_SLOT_EMPTY },
+	{ CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY },
+	{ 7, 0, 194 }, { 7, 0, 15 }, { CONSTANT_SLOT_EMPTY }, { 7, 0, 91 },
+	{ 7, 0, 178 }, { 7, 0, 69 }, { 0, 0, 12 }, { CONSTANT_SLOT_EMPTY },
+	{ CONSTANT_SLOT_EMPTY }, { 7, 0, 153 }, { CONSTANT_SLOT_EMPTY }, { 10, 0, 23 },
+	{ CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { 10, 0, 65 },
+	{ CONSTANT_SLOT_EMPTY }, { 3, 0, 0 }, { CONSTANT_SLOT_EMPTY }, { 10, 0, 80 },
+	{ CONSTANT_SLOT_EMPTY }, { 7, 0, 204 }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY },
+	{ 7, 0, 43 }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY },
+	{ CONSTANT_SLOT_EMPTY }, { 0, 0, 25 }, { CONSTANT_SLOT_EMPTY }, { 7, 0, 117 },
+	{ 0, 0, 45 }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { 5, 0, 2 },
+	{ 10, 0, 52 }, { 7, 0, 9 }, { 7, 0, 31 }, { CONSTANT_SLOT_EMPTY },
+	{ CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { 7, 0, 35 }, { CONSTANT_SLOT_EMPTY },
+	{ CONSTANT_SLOT_EMPTY }, { 10, 0, 75 }, { CONSTANT_SLOT_EMPTY }, { 7, 0, 154 },
+	{ 0, 0, 41 }, { CONSTANT_SLOT_EMPTY }, { 7, 0, 49 }, { 0, 0, 23 },
+	{ CONSTANT_SLOT_EMPTY }, { 10, 0, 0 }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY },
+	{ 4, 0, 18 }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY },
+	{ CONSTANT_SLOT_EMPTY }, { 10, 0, 40 }, { 0, 0, 93 }, { CONSTANT_SLOT_EMPTY },
+	{ CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { 7, 0, 24 }, { 4, 0, 1 },
+	{ CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { 10, 0, 30 }, { CONSTANT_SLOT_EMPTY },
+	{ CONSTANT_SLOT_EMPTY }, { 7, 0, 46 }, { CONSTANT_SLOT_EMPTY }, { 0, 0, 43 },
+	{ CONSTANT_SLOT_EMPTY }, { 0, 0, 96 }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY },
+	{ 0, 0, 33 }, { CONSTANT_SLOT_EMPTY }, { 0, 0, 37 }, { 0, 0, 24 },
+	{ CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { 10, 0, 35 }, { CONSTANT_SLOT_EMPTY },
+	{ CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { 10, 0, 56 },
+	{ CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY },
+	{ 4, 0, 5 }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { 0, 0, 34 },
+	{ CONSTANT_SLOT_EMPTY }, { 6, 0, 3 }, { 10, 0, 12 }, { 7, 0, 74 },
+	{ 0, 0, 99 }, { CONSTANT_SLOT_EMPTY }, { 10, 0, 22 }, { CONSTANT_SLOT_EMPTY },
+	{ 10, 0, 45 }, { 0, 0, 88 }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY },
+	{ CONSTANT_SLOT_EMPTY }, { 7, 0, 212 }, { 0, 0, 49 }, { 7, 0, 167 },
+	{ 7, 0, 21 }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY },
+	{ 7, 0, 148 }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY },
+	{ CONSTANT_SLOT_EMPTY }, { 7, 0, 141 }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY },
+	{ 10, 0, 74 }, { 7, 0, 170 }, { 7, 0, 173 }, { 10, 0, 15 },
+	{ CONSTANT_SLOT_EMPTY }, { 7, 0, 149 }, { 7, 0, 187 }, { CONSTANT_SLOT_EMPTY },
+	{ CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY },
+	{ CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { 7, 0, 87 },
+	{ CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { 1, 0, 6 }, { CONSTANT_SLOT_EMPTY },
+	{ 10, 0, 50 }, { CONSTANT_SLOT_EMPTY }, { 0, 0, 63 }, { CONSTANT_SLOT_EMPTY },
+	{ 7, 0, 200 }, { CONSTANT_SLOT_EMPTY }, { 0, 0, 58 }, { CONSTANT_SLOT_EMPTY },
+	{ 2, 0, 3 }, { CONSTANT_SLOT_EMPTY }, { 7, 0, 183 }, { 7, 0, 67 },
+	{ 7, 0, 22 }, { 0, 0, 9 }, { 10, 0, 37 }, { CONSTANT_SLOT_EMPTY },
+	{ CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { 7, 0, 17 },
+	{ CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { 7, 0, 53 }, { 1, 0, 5 },
+	{ CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY },
+	{ 1, 0, 12 }, { 7, 0, 138 }, { CONSTANT_SLOT_EMPTY }, { 7, 0, 166 },
+	{ 7, 0, 130 }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { 0, 0, 42 },
+	{ CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { 7, 0, 195 }, { CONSTANT_SLOT_EMPTY },
+	{ 0, 0, 94 }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY },
+	{ 0, 0, 4 }, { CONSTANT_SLOT_EMPTY }, { 6, 0, 1 }, { 7, 0, 88 },
+	{ 7, 0, 26 }, { CONSTANT_SLOT_EMPTY }, { 7, 0, 57 }, { 7, 0, 207 },
+	{ 2, 0, 5 }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY },
+	{ 7, 0, 41 }, { 10, 0, 14 }, { 7, 0, 175 }, { CONSTANT_SLOT_EMPTY },
+	{ CONSTANT_SLOT_EMPTY }, { 10, 0, 64 }, { 10, 0, 29 }, { CONSTANT_SLOT_EMPTY },
+	{ CONSTANT_SLOT_EMPTY }, { 7, 0, 135 }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY },
+	{ CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { 10, 0, 8 }, { 7, 0, 54 },
+	{ 7, 0, 97 }, { 0, 0, 2 }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY },
+	{ 7, 0, 199 }, { 7, 0, 111 }, { CONSTANT_SLOT_EMPTY }, { 0, 0, 68 },
+	{ 10, 0, 79 }, { 10, 0, 46 }, { CONSTANT_SLOT_EMPTY }, { 7, 0, 171 },
+	{ 0, 0, 87 }, { 7, 0, 151 }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY },
+	{ CONSTANT_SLOT_EMPTY }, { 7, 0, 23 }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY },
+	{ CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { 0, 0, 20 }, { CONSTANT_SLOT_EMPTY },
+	{ CONSTANT_SLOT_EMPTY }, { 10, 0, 4 }, { 7, 0, 159 }, { CONSTANT_SLOT_EMPTY },
+	{ 7, 0, 18 }, { CONSTANT_SLOT_EMPTY }, { 0, 0, 92 }, { 3, 0, 2 },
+	{ 10, 0, 48 }, { 7, 0, 39 }, { 7, 0, 78 }, { 10, 0, 82 },
+	{ 0, 0, 52 }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { 4, 0, 7 },
+	{ 7, 0, 129 }, { 0, 0, 112 }, { CONSTANT_SLOT_EMPTY }, { 7, 0, 140 },
+	{ CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { 10, 0, 47 },
+	{ 7, 0, 50 }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY },
+	{ 0, 0, 44 }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY },
+	{ 7, 0, 211 }, { 7, 0, 209 }, { 0, 0, 97 }, { 0, 0, 100 },
+	{ CONSTANT_SLOT_EMPTY }, { 0, 0, 0 }, { CONSTANT_SLOT_EMPTY }, { CONSTANT_SLOT_EMPTY },
+	{ 7, 0, 19 }, { 10, 0, 59 }, { 0, 0, 73 }, { CONSTANT_SLOT_EMPTY },
+};
+
@@ -42,6 +42,7 @@
 #include "pkcs11x.h"
 
 #include <stdlib.h>
+#include <string.h>
 
 #define ELEMS(x) (sizeof (x) / sizeof (x[0]))
 
@@ -597,7 +598,11 @@ const p11_constant p11_constant_mechanisms[] = {
 
 #undef CT
 
-struct {
+/*
+ * The order of these tables is used in constants-hash.h. When changing
+ * them, or the constants above, regenerate it with 'make constants'.
+ */
+static const struct {
 	const p11_constant *table;
 	int length;
 } tables[] = {
@@ -614,38 +619,97 @@ struct {
 	{ p11_constant_returns, ELEMS (p11_constant_returns) - 1 },
 };
 
-static int
-compar_attr_info (const void *one,
-                  const void *two)
+typedef struct {
+	unsigned char table;
+	unsigned char nick;
+	unsigned short index;
+} constant_slot;
+
+#define CONSTANT_SLOT_EMPTY 0xff
+
+#include "constants-hash.h"
+
+/*
+ * FNV-1a, which unlike the other hashes we have gives the same result
+ * regardless of byte order, so the generated tables work everywhere.
+ */
+uint32_t
+p11_constant_hash (const void *data,
+                   size_t length)
+{
+	const unsigned char *p = data;
+	uint32_t hash = 2166136261U;
+	size_t i;
+
+	for (i = 0; i < length; i++) {
+		hash ^= p[i];
+		hash *= 16777619U;
+	}
+
+	return hash;
+}
+
+/* Picks the slot for a hash, given the displacement of its bucket */
+uint32_t
+p11_constant_mix (uint32_t hash,
+                  uint32_t displace)
+{
+	hash ^= displace * 0x9e3779b9U;
+	hash ^= hash >> 16;
+	hash *= 0x7feb352dU;
+	hash ^= hash >> 15;
+	hash *= 0x846ca68bU;
+	hash ^= hash >> 16;
+	return hash;
+}
+
+uint32_t
+p11_constant_hash_value (int table,
+                         CK_ULONG value)
+{
+	uint64_t val = value;
+	return p11_constant_mix ((uint32_t)val ^ ((uint32_t)(val >> 32) * 0x85ebca6bU) ^
+	                         ((uint32_t)table * 0xc2b2ae35U), 0);
+}
+
+static const constant_slot *
+lookup_slot (const constant_slot *slots,
+             unsigned int n_slots,
+             const unsigned short *displace,
+             unsigned int n_buckets,
+             uint32_t hash)
 {
-	const p11_constant *a1 = one;
-	const p11_constant *a2 = two;
-	if (a1->value == a2->value)
-		return 0;
-	if (a1->value < a2->value)
-		return -1;
-	return 1;
+	uint32_t slot;
+
+	/* The generator makes both of these powers of two */
+	slot = p11_constant_mix (hash, displace[hash & (n_buckets - 1)]) & (n_slots - 1);
+	if (slots[slot].table == CONSTANT_SLOT_EMPTY)
+		return NULL;
+	return slots + slot;
 }
 
 static const p11_constant *
 lookup_info (const p11_constant *table,
              CK_ATTRIBUTE_TYPE type)
 {
-	p11_constant match = { type, NULL, { NULL } };
-	int length = -1;
+	const constant_slot *slot;
 	int i;
 
 	for (i = 0; i < ELEMS (tables); i++) {
-		if (table == tables[i].table) {
-			length = tables[i].length;
+		if (table == tables[i].table)
 			break;
-		}
 	}
 
-	return_val_if_fail (length != -1, NULL);
-	return bsearch (&match, table, length, sizeof (p11_constant), compar_attr_info);
+	return_val_if_fail (i != ELEMS (tables), NULL);
 
+	slot = lookup_slot (value_slots, ELEMS (value_slots),
+	                    value_displace, ELEMS (value_displace),
+	                    p11_constant_hash_value (i, type));
+	if (slot == NULL || slot->table != i || table[slot->index].value != type)
+		return NULL;
+	return table + slot->index;
 }
+
 const char *
 p11_constant_name (const p11_constant *constants,
                    CK_ULONG type)
@@ -694,6 +758,38 @@ p11_constant_reverse (bool nick)
 	return lookups;
 }
 
+CK_ULONG
+p11_constant_lookup (bool nick,
+                     const char *string,
+                     size_t length)
+{
+	const p11_constant *constant;
+	const constant_slot *slot;
+	const char *match;
+	uint32_t hash;
+
+	return_val_if_fail (string != NULL, CKA_INVALID);
+
+	hash = p11_constant_hash (string, length);
+	if (nick) {
+		slot = lookup_slot (nick_slots, ELEMS (nick_slots),
+		                    nick_displace, ELEMS (nick_displace), hash);
+	} else {
+		slot = lookup_slot (name_slots, ELEMS (name_slots),
+		                    name_displace, ELEMS (name_displace), hash);
+	}
+
+	if (slot == NULL)
+		return CKA_INVALID;
+
+	constant = tables[slot->table].table + slot->index;
+	match = nick ? constant->nicks[slot->nick] : constant->name;
+	if (strncmp (match, string, length) != 0 || match[length] != '\0')
+		return CKA_INVALID;
+
+	return constant->value;
+}
+
 CK_ULONG
 p11_constant_resolve (p11_dict *reversed,
                      const char *string)
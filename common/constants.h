@@ -57,6 +57,19 @@ p11_dict *          p11_constant_reverse   (bool nick);
 CK_ULONG            p11_constant_resolve   (p11_dict *table,
                                             const char *string);
 
+CK_ULONG            p11_constant_lookup    (bool nick,
+                                            const char *string,
+                                            size_t length);
+
+uint32_t            p11_constant_hash      (const void *data,
+                                            size_t length);
+
+uint32_t            p11_constant_mix       (uint32_t hash,
+                                            uint32_t displace);
+
+uint32_t            p11_constant_hash_value (int table,
+                                             CK_ULONG value);
+
 extern const p11_constant    p11_constant_types[];
 
 extern const p11_constant    p11_constant_classes[];
@@ -0,0 +1,263 @@
+/*
+ * Copyright (c) 2016 Red Hat Inc
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *     * Redistributions of source code must retain the above
+ *       copyright notice, this list of conditions and the
+ *       following disclaimer.
+ *     * Redistributions in binary form must reproduce the
+ *       above copyright notice, this list of conditions and
+ *       the following disclaimer in the documentation and/or
+ *       other materials provided with the distribution.
+ *     * The names of contributors to this software may not be
+ *       used to endorse or promote products derived from this
+ *       software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+#include "config.h"
+
+#include "attrs.h"
+#include "constants.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * Generates the perfect hash tables in common/constants-hash.h, used to
+ * look up constants by name, nick or value. Run 'make constants' after
+ * changing the constants.
+ *
+ * Each key is hashed into a bucket, and each bucket gets a displacement
+ * that is mixed into the hash, chosen so that the keys of all buckets
+ * end up in different slots.
+ */
+
+#define ELEMS(x) (sizeof (x) / sizeof (x[0]))
+
+/* Same order as in constants.c */
+static const p11_constant *tables[] = {
+	p11_constant_types,
+	p11_constant_classes,
+	p11_constant_trusts,
+	p11_constant_certs,
+	p11_constant_keys,
+	p11_constant_asserts,
+	p11_constant_categories,
+	p11_constant_mechanisms,
+	p11_constant_states,
+	p11_constant_users,
+	p11_constant_returns,
+};
+
+typedef struct {
+	unsigned char data[64];
+	size_t length;
+	int table;
+	int nick;
+	int index;
+	uint32_t hash;
+	unsigned int bucket;
+} key;
+
+typedef struct {
+	key *keys;
+	int n_keys;
+	unsigned int n_buckets;
+	unsigned int n_slots;
+	unsigned short *displace;
+	key **slots;
+} hash;
+
+static void
+add_key (hash *hash,
+         const void *data,
+         size_t length,
+         uint32_t value,
+         int table,
+         int nick,
+         int index)
+{
+	key *k = NULL;
+	int i;
+
+	assert (length <= sizeof (k->data));
+
+	/* Later tables win, as in p11_constant_reverse() */
+	for (i = 0; i < hash->n_keys; i++) {
+		k = hash->keys + i;
+		if (k->length == length && memcmp (k->data, data, length) == 0)
+			break;
+	}
+
+	if (i == hash->n_keys) {
+		hash->keys = realloc (hash->keys, (hash->n_keys + 1) * sizeof (key));
+		assert (hash->keys != NULL);
+		k = hash->keys + hash->n_keys++;
+	}
+
+	memcpy (k->data, data, length);
+	k->length = length;
+	k->hash = value;
+	k->table = table;
+	k->nick = nick;
+	k->index = index;
+}
+
+static bool
+place_bucket (hash *hash,
+              unsigned int bucket,
+              unsigned short displace)
+{
+	unsigned int slot;
+	int placed = 0;
+	int i;
+
+	for (i = 0; i < hash->n_keys; i++) {
+		if (hash->keys[i].bucket != bucket)
+			continue;
+		slot = p11_constant_mix (hash->keys[i].hash, displace) & (hash->n_slots - 1);
+		if (hash->slots[slot] != NULL)
+			break;
+		hash->slots[slot] = hash->keys + i;
+		placed++;
+	}
+
+	if (i == hash->n_keys)
+		return true;
+
+	/* Undo what was placed */
+	for (slot = 0; slot < hash->n_slots && placed > 0; slot++) {
+		if (hash->slots[slot] && hash->slots[slot]->bucket == bucket) {
+			hash->slots[slot] = NULL;
+			placed--;
+		}
+	}
+
+	return false;
+}
+
+static void
+build_hash (hash *hash)
+{
+	unsigned int *sizes;
+	unsigned int bucket;
+	unsigned int size;
+	unsigned int displace;
+	int i;
+
+	/* Powers of two, so that lookups can mask rather than divide */
+	for (hash->n_buckets = 1; hash->n_buckets < hash->n_keys / 4; )
+		hash->n_buckets <<= 1;
+	for (hash->n_slots = 1; hash->n_slots < hash->n_keys + hash->n_keys / 8; )
+		hash->n_slots <<= 1;
+
+	hash->displace = calloc (hash->n_buckets, sizeof (unsigned short));
+	hash->slots = calloc (hash->n_slots, sizeof (key *));
+	sizes = calloc (hash->n_buckets, sizeof (unsigned int));
+	assert (hash->displace && hash->slots && sizes);
+
+	for (i = 0; i < hash->n_keys; i++) {
+		bucket = hash->keys[i].hash & (hash->n_buckets - 1);
+		hash->keys[i].bucket = bucket;
+		sizes[bucket]++;
+	}
+
+	/* Place the largest buckets first, while there's lots of room */
+	for (size = hash->n_keys; size > 0; size--) {
+		for (bucket = 0; bucket < hash->n_buckets; bucket++) {
+			if (sizes[bucket] != size)
+				continue;
+			for (displace = 1; displace <= 0xffff; displace++) {
+				if (place_bucket (hash, bucket, displace))
+					break;
+			}
+			assert (displace <= 0xffff);
+			hash->displace[bucket] = displace;
+		}
+	}
+
+	free (sizes);
+}
+
+static void
+print_hash (hash *hash,
+            const char *name)
+{
+	key *k;
+	int i;
+
+	printf ("static const unsigned short %s_displace[%u] = {", name, hash->n_buckets);
+	for (i = 0; i < hash->n_buckets; i++)
+		printf ("%s%u,", i % 10 == 0 ? "\n\t" : " ", hash->displace[i]);
+	printf ("\n};\n\n");
+
+	printf ("static const constant_slot %s_slots[%u] = {", name, hash->n_slots);
+	for (i = 0; i < hash->n_slots; i++) {
+		k = hash->slots[i];
+		if (k)
+			printf ("%s{ %d, %d, %d },", i % 4 == 0 ? "\n\t" : " ", k->table, k->nick, k->index);
+		else
+			printf ("%s{ CONSTANT_SLOT_EMPTY },", i % 4 == 0 ? "\n\t" : " ");
+	}
+	printf ("\n};\n\n");
+}
+
+int
+main (int argc,
+      char *argv[])
+{
+	hash names = { 0, };
+	hash nicks = { 0, };
+	hash values = { 0, };
+	const p11_constant *table;
+	const char *string;
+	CK_ULONG value[2];
+	int i, j, k;
+
+	for (i = 0; i < ELEMS (tables); i++) {
+		table = tables[i];
+		for (j = 0; table[j].value != CKA_INVALID; j++) {
+			string = table[j].name;
+			add_key (&names, string, strlen (string),
+			         p11_constant_hash (string, strlen (string)), i, 0, j);
+			for (k = 0; table[j].nicks[k] != NULL; k++) {
+				string = table[j].nicks[k];
+				add_key (&nicks, string, strlen (string),
+				         p11_constant_hash (string, strlen (string)), i, k, j);
+			}
+			value[0] = i;
+			value[1] = table[j].value;
+			add_key (&values, value, sizeof (value),
+			         p11_constant_hash_value (i, value[1]), i, 0, j);
+		}
+	}
+
+	build_hash (&names);
+	build_hash (&nicks);
+	build_hash (&values);
+
+	printf ("/* This file is generated by frob-constants, do not edit */\n\n");
+	print_hash (&names, "name");
+	print_hash (&nicks, "nick");
+	print_hash (&values, "value");
+
+	return 0;
+}
@@ -55,12 +55,28 @@ p11_lexer_init (p11_lexer *lexer,
                 const char *filename,
                 const char *data,
                 size_t length)
+{
+	p11_lexer_init_full (lexer, filename, data, length, 0);
+}
+
+/*
+ * With P11_LEXER_SLICES the section and field names and values point
+ * into the data, which must remain valid while the tokens are in use.
+ * They are not null terminated, so callers use the lengths.
+ */
+void
+p11_lexer_init_full (p11_lexer *lexer,
+                     const char *filename,
+                     const char *data,
+                     size_t length,
+                     int flags)
 {
 	return_if_fail (lexer != NULL);
 
 	memset (lexer, 0, sizeof (p11_lexer));
 	lexer->at = data;
 	lexer->remaining = length;
+	lexer->flags = flags;
 
 	return_if_fail (filename != NULL);
 	lexer->filename = strdup (filename);
@@ -70,7 +86,8 @@ p11_lexer_init (p11_lexer *lexer,
 static void
 clear_state (p11_lexer *lexer)
 {
-	switch (lexer->tok_type) {
+	/* Slices point into the input and are not freed */
+	switch (lexer->flags & P11_LEXER_SLICES ? TOK_EOF : lexer->tok_type) {
 	case TOK_FIELD:
 		free (lexer->tok.field.name);
 		free (lexer->tok.field.value);
@@ -88,6 +105,16 @@ clear_state (p11_lexer *lexer)
 	lexer->complained = false;
 }
 
+static char *
+token_string (p11_lexer *lexer,
+              const char *data,
+              size_t length)
+{
+	if (lexer->flags & P11_LEXER_SLICES)
+		return (char *)data;
+	return strndup (data, length);
+}
+
 bool
 p11_lexer_next (p11_lexer *lexer,
                 bool *failed)
@@ -167,7 +194,8 @@ p11_lexer_next (p11_lexer *lexer,
 			}
 
 			lexer->tok_type = TOK_SECTION;
-			lexer->tok.section.name = strndup (line + 1, (end - line) - 2);
+			lexer->tok.section.name = token_string (lexer, line + 1, (end - line) - 2);
+			lexer->tok.section.name_len = (end - line) - 2;
 			return_val_if_fail (lexer->tok.section.name != NULL, false);
 			return true;
 		}
@@ -191,8 +219,10 @@ p11_lexer_next (p11_lexer *lexer,
 			--colon;
 
 		lexer->tok_type = TOK_FIELD;
-		lexer->tok.field.name = strndup (line, colon - line);
-		lexer->tok.field.value = strndup (value, end - value);
+		lexer->tok.field.name = token_string (lexer, line, colon - line);
+		lexer->tok.field.name_len = colon - line;
+		lexer->tok.field.value = token_string (lexer, value, end - value);
+		lexer->tok.field.value_len = end - value;
 		return_val_if_fail (lexer->tok.field.name && lexer->tok.field.value, false);
 		return true;
 	}
@@ -220,11 +250,13 @@ p11_lexer_msg (p11_lexer *lexer,
 
 	switch (lexer->tok_type) {
 	case TOK_FIELD:
-		p11_message ("%s: %s: %s", lexer->filename,
+		p11_message ("%s: %.*s: %s", lexer->filename,
+		             (int)lexer->tok.field.name_len,
 		             lexer->tok.field.name, msg);
 		break;
 	case TOK_SECTION:
-		p11_message ("%s: [%s]: %s", lexer->filename,
+		p11_message ("%s: [%.*s]: %s", lexer->filename,
+		             (int)lexer->tok.section.name_len,
 		             lexer->tok.section.name, msg);
 		break;
 	case TOK_PEM:
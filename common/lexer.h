@@ -39,6 +39,11 @@
 
 #include "compat.h"
 
+enum {
+	/* Names and values point into the input, and aren't terminated */
+	P11_LEXER_SLICES = 1 << 0,
+};
+
 enum {
 	TOK_EOF = 0,
 	TOK_SECTION = 1,
@@ -51,15 +56,19 @@ typedef struct {
 	const char *at;
 	int remaining;
 	int complained;
+	int flags;
 
 	int tok_type;
 	union {
 		struct {
 			char *name;
+			size_t name_len;
 		} section;
 		struct {
 			char *name;
+			size_t name_len;
 			char *value;
+			size_t value_len;
 		} field;
 		struct {
 			const char *begin;
@@ -73,6 +82,12 @@ void             p11_lexer_init               (p11_lexer *lexer,
                                                const char *data,
                                                size_t length);
 
+void             p11_lexer_init_full          (p11_lexer *lexer,
+                                               const char *filename,
+                                               const char *data,
+                                               size_t length,
+                                               int flags);
+
 bool             p11_lexer_next               (p11_lexer *lexer,
                                                bool *failed);
 
@@ -51,9 +51,12 @@
 #include <assert.h>
 #include <ctype.h>
 #include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 #include <unistd.h>
 
 /* -------------------------------------------------------------------
@@ -62,6 +65,7 @@
 
 /* Various mutexes */
 static p11_mutex_t init_mutex;
+static p11_mutex_t entry_mutex;
 
 /* Whether we've been initialized, and on what process id it happened */
 static bool pkcs11_initialized = false;
@@ -108,6 +112,21 @@ static unsigned int unique_identifier = 100;
 static p11_dict *the_sessions = NULL;
 static p11_dict *the_objects = NULL;
 
+/* The requested scale, and the generated tokens that are current */
+static mock_scale the_scale = { 0, };
+static struct {
+	CK_ULONG slots;
+	CK_ULONG objects;
+	CK_ULONG value_len;
+	CK_ATTRIBUTE **attrs;
+	CK_ULONG count;
+} generated = { 0, };
+
+#define MOCK_FUNCTIONS \
+	((sizeof (CK_FUNCTION_LIST) - offsetof (CK_FUNCTION_LIST, C_Initialize)) / sizeof (void *))
+
+static unsigned long the_calls[MOCK_FUNCTIONS];
+
 #define SIGNED_PREFIX "signed-prefix:"
 
 #define handle_to_pointer(handle) \
@@ -127,6 +146,32 @@ free_session (void *data)
 	free (sess);
 }
 
+static bool
+is_generated_slot (CK_SLOT_ID slot_id)
+{
+	return slot_id >= MOCK_SLOT_SCALE_ID &&
+	       slot_id - MOCK_SLOT_SCALE_ID < generated.slots;
+}
+
+static bool
+is_token_slot (CK_SLOT_ID slot_id)
+{
+	return slot_id == MOCK_SLOT_ONE_ID || is_generated_slot (slot_id);
+}
+
+static CK_ATTRIBUTE *
+lookup_generated (CK_SLOT_ID slot_id,
+                  CK_OBJECT_HANDLE object)
+{
+	CK_ULONG first = (slot_id - MOCK_SLOT_SCALE_ID) * generated.objects;
+
+	if (object < MOCK_SCALE_OBJECT ||
+	    object - MOCK_SCALE_OBJECT < first ||
+	    object - MOCK_SCALE_OBJECT >= first + generated.objects)
+		return NULL;
+	return generated.attrs[object - MOCK_SCALE_OBJECT];
+}
+
 static CK_RV
 lookup_object (Session *sess,
                CK_OBJECT_HANDLE object,
@@ -135,10 +180,14 @@ lookup_object (Session *sess,
 {
 	CK_BBOOL priv;
 
-	*attrs = p11_dict_get (the_objects, handle_to_pointer (object));
+	/* Generated tokens are read-only, and have no table */
+	if (is_generated_slot (sess->info.slotID))
+		*attrs = lookup_generated (sess->info.slotID, object);
+	else
+		*attrs = p11_dict_get (the_objects, handle_to_pointer (object));
 	if (*attrs) {
 		if (table)
-			*table = the_objects;
+			*table = is_generated_slot (sess->info.slotID) ? NULL : the_objects;
 	} else {
 		*attrs = p11_dict_get (sess->objects, handle_to_pointer (object));
 		if (*attrs) {
@@ -184,6 +233,240 @@ mock_module_take_object (CK_SLOT_ID slot_id,
 		return_if_reached ();
 }
 
+void
+mock_module_scale (const mock_scale *scale)
+{
+	if (scale)
+		memcpy (&the_scale, scale, sizeof (the_scale));
+	else
+		memset (&the_scale, 0, sizeof (the_scale));
+}
+
+bool
+mock_module_scale_parse (const char *string,
+                         mock_scale *scale)
+{
+	const char *name;
+	const char *end;
+	char *endp;
+	unsigned long value;
+	size_t length;
+
+	return_val_if_fail (string != NULL, false);
+	return_val_if_fail (scale != NULL, false);
+
+	/* For example: slots=4,objects=1000,value=1280,latency=50 */
+	memset (scale, 0, sizeof (*scale));
+	while (*string) {
+		name = string;
+		end = string + strcspn (string, ",");
+		string = memchr (name, '=', end - name);
+		if (string == NULL || string + 1 == end)
+			return false;
+		length = string - name;
+
+		value = strtoul (string + 1, &endp, 10);
+		if (endp != end)
+			return false;
+
+		if (length == 5 && strncmp (name, "slots", 5) == 0)
+			scale->slots = value;
+		else if (length == 7 && strncmp (name, "objects", 7) == 0)
+			scale->objects = value;
+		else if (length == 5 && strncmp (name, "value", 5) == 0)
+			scale->value_len = value;
+		else if (length == 7 && strncmp (name, "latency", 7) == 0)
+			scale->latency = value;
+		else
+			return false;
+
+		string = *end ? end + 1 : end;
+	}
+
+	return true;
+}
+
+static void
+mock_called (size_t offset)
+{
+	size_t index = (offset - offsetof (CK_FUNCTION_LIST, C_Initialize)) / sizeof (void *);
+	unsigned int latency;
+
+	p11_atomic_add (the_calls + index, 1, RELAXED);
+
+	latency = the_scale.latency;
+	if (latency > 0) {
+#ifdef OS_UNIX
+		struct timespec ts = { latency / 1000000, (latency % 1000000) * 1000 };
+		nanosleep (&ts, NULL);
+#else
+		p11_sleep_ms ((latency + 999) / 1000);
+#endif
+	}
+
+	/* The mock state isn't thread safe, so calls take turns after any latency */
+	p11_mutex_lock (&entry_mutex);
+}
+
+static CK_RV
+mock_returned (CK_RV rv)
+{
+	p11_mutex_unlock (&entry_mutex);
+	return rv;
+}
+
+unsigned long
+mock_module_calls (size_t offset)
+{
+	size_t index;
+
+	return_val_if_fail (offset >= offsetof (CK_FUNCTION_LIST, C_Initialize), 0);
+	index = (offset - offsetof (CK_FUNCTION_LIST, C_Initialize)) / sizeof (void *);
+	return_val_if_fail (index < MOCK_FUNCTIONS, 0);
+
+	return p11_atomic_load (the_calls + index, RELAXED);
+}
+
+void
+mock_module_reset_calls (void)
+{
+	size_t i;
+
+	for (i = 0; i < MOCK_FUNCTIONS; i++)
+		p11_atomic_store (the_calls + i, 0, RELAXED);
+}
+
+static void
+generate_bytes (unsigned char *data,
+                size_t length,
+                unsigned long seed)
+{
+	uint32_t x = (seed * 2654435761U) | 1;
+	size_t i;
+
+	/* Reproducible, but not all alike */
+	for (i = 0; i < length; i++) {
+		x ^= x << 13;
+		x ^= x >> 17;
+		x ^= x << 5;
+		data[i] = x & 0xff;
+	}
+}
+
+static CK_ATTRIBUTE *
+generate_object (CK_ULONG slot,
+                 CK_ULONG index)
+{
+	CK_OBJECT_CLASS klass = (index % 2) ? CKO_PUBLIC_KEY : CKO_CERTIFICATE;
+	CK_CERTIFICATE_TYPE x509 = CKC_X_509;
+	CK_KEY_TYPE rsa = CKK_RSA;
+	CK_BBOOL btrue = CK_TRUE;
+	CK_BBOOL bfalse = CK_FALSE;
+	unsigned long seed = slot * 1000003UL + index / 2;
+	unsigned char subject[96];
+	unsigned char issuer[96];
+	unsigned char serial[18];
+	unsigned char id[20];
+	unsigned char *value;
+	char label[64];
+	CK_ATTRIBUTE *attrs;
+
+	CK_ATTRIBUTE common[] = {
+		{ CKA_CLASS, &klass, sizeof (klass) },
+		{ CKA_TOKEN, &btrue, sizeof (btrue) },
+		{ CKA_PRIVATE, &bfalse, sizeof (bfalse) },
+		{ CKA_MODIFIABLE, &bfalse, sizeof (bfalse) },
+		{ CKA_LABEL, label, 0 },
+		{ CKA_ID, id, sizeof (id) },
+		{ CKA_SUBJECT, subject, sizeof (subject) },
+		{ CKA_INVALID },
+	};
+
+	/* A certificate and its public key share a label, id and subject */
+	snprintf (label, sizeof (label), "Generated %lu.%lu", slot, index / 2);
+	common[4].ulValueLen = strlen (label);
+	generate_bytes (id, sizeof (id), seed);
+	generate_bytes (subject, sizeof (subject), ~seed);
+
+	value = malloc (generated.value_len);
+	return_val_if_fail (value != NULL, NULL);
+	generate_bytes (value, generated.value_len, seed ^ 0xc3c3c3);
+
+	attrs = p11_attrs_buildn (NULL, common, 7);
+
+	if (klass == CKO_CERTIFICATE) {
+		CK_ATTRIBUTE certificate[] = {
+			{ CKA_CERTIFICATE_TYPE, &x509, sizeof (x509) },
+			{ CKA_TRUSTED, &btrue, sizeof (btrue) },
+			{ CKA_ISSUER, issuer, sizeof (issuer) },
+			{ CKA_SERIAL_NUMBER, serial, sizeof (serial) },
+			{ CKA_VALUE, value, generated.value_len },
+		};
+
+		/* The first certificate on each token is the issuer of all of them */
+		generate_bytes (issuer, sizeof (issuer), ~(slot * 1000003UL));
+		generate_bytes (serial, sizeof (serial), seed ^ 0x3c3c3c);
+		attrs = p11_attrs_buildn (attrs, certificate, 5);
+
+	} else {
+		CK_ATTRIBUTE key[] = {
+			{ CKA_KEY_TYPE, &rsa, sizeof (rsa) },
+			{ CKA_ENCRYPT, &btrue, sizeof (btrue) },
+			{ CKA_VERIFY, &btrue, sizeof (btrue) },
+			{ CKA_MODULUS, value, generated.value_len < 256 ? generated.value_len : 256 },
+			{ CKA_PUBLIC_EXPONENT, "\x01\x00\x01", 3 },
+		};
+
+		attrs = p11_attrs_buildn (attrs, key, 5);
+	}
+
+	free (value);
+	return attrs;
+}
+
+static void
+module_free_generated (void)
+{
+	CK_ULONG i;
+
+	for (i = 0; i < generated.count; i++)
+		p11_attrs_free (generated.attrs[i]);
+	free (generated.attrs);
+	memset (&generated, 0, sizeof (generated));
+}
+
+static void
+module_reset_generated (void)
+{
+	CK_ULONG count;
+	CK_ULONG i;
+
+	module_free_generated ();
+
+	count = the_scale.slots * the_scale.objects;
+	if (count == 0)
+		return;
+
+	return_if_fail (count / the_scale.objects == the_scale.slots);
+	return_if_fail (count < (CK_ULONG)0x7fffffff - MOCK_SCALE_OBJECT);
+
+	generated.attrs = calloc (count, sizeof (CK_ATTRIBUTE *));
+	return_if_fail (generated.attrs != NULL);
+	generated.count = count;
+
+	generated.value_len = the_scale.value_len ? the_scale.value_len : 1280;
+	for (i = 0; i < count; i++) {
+		generated.attrs[i] = generate_object (i / the_scale.objects, i % the_scale.objects);
+		if (generated.attrs[i] == NULL) {
+			module_free_generated ();
+			return_if_reached ();
+		}
+	}
+
+	generated.slots = the_scale.slots;
+	generated.objects = the_scale.objects;
+}
+
 static void
 module_reset_objects (CK_SLOT_ID slot_id)
 {
@@ -307,6 +590,7 @@ module_finalize (void)
 		if (the_objects)
 			p11_dict_free (the_objects);
 		the_objects = NULL;
+		module_free_generated ();
 
 		if (the_sessions)
 			p11_dict_free (the_sessions);
@@ -331,6 +615,7 @@ mock_module_reset (void)
 {
 	module_finalize ();
 	module_reset_objects (MOCK_SLOT_ONE_ID);
+	module_reset_generated ();
 
 }
 
@@ -340,29 +625,41 @@ mock_module_enumerate_objects (CK_SESSION_HANDLE handle,
                                void *user_data)
 {
 	p11_dictiter iter;
+	CK_ULONG first;
+	CK_ULONG i;
 	void *key;
 	void *value;
-	Session *sess;
+	Session *sess = NULL;
 
 	assert (the_objects != NULL);
 	assert (func != NULL);
 
+	if (handle)
+		sess = p11_dict_get (the_sessions, handle_to_pointer (handle));
+
+	/* Generated token objects */
+	if (sess && is_generated_slot (sess->info.slotID)) {
+		first = (sess->info.slotID - MOCK_SLOT_SCALE_ID) * generated.objects;
+		for (i = first; i < first + generated.objects; i++) {
+			if (!(func) (MOCK_SCALE_OBJECT + i, generated.attrs[i], user_data))
+				return;
+		}
+
 	/* Token objects */
-	p11_dict_iterate (the_objects, &iter);
-	while (p11_dict_next (&iter, &key, &value)) {
-		if (!(func) (pointer_to_handle (key), value, user_data))
-			return;
+	} else {
+		p11_dict_iterate (the_objects, &iter);
+		while (p11_dict_next (&iter, &key, &value)) {
+			if (!(func) (pointer_to_handle (key), value, user_data))
+				return;
+		}
 	}
 
 	/* session objects */
-	if (handle) {
-		sess = p11_dict_get (the_sessions, handle_to_pointer (handle));
-		if (sess) {
-			p11_dict_iterate (sess->objects, &iter);
-			while (p11_dict_next (&iter, &key, &value)) {
-				if (!(func) (pointer_to_handle (key), value, user_data))
-					return;
-			}
+	if (sess) {
+		p11_dict_iterate (sess->objects, &iter);
+		while (p11_dict_next (&iter, &key, &value)) {
+			if (!(func) (pointer_to_handle (key), value, user_data))
+				return;
 		}
 	}
 }
@@ -433,6 +730,7 @@ mock_C_Initialize (CK_VOID_PTR init_args)
 		                             NULL, free_session);
 
 		module_reset_objects (MOCK_SLOT_ONE_ID);
+		module_reset_generated ();
 
 done:
 		/* Mark us as officially initialized */
@@ -515,10 +813,12 @@ mock_C_GetSlotList (CK_BBOOL token_present,
                     CK_ULONG_PTR count)
 {
 	CK_ULONG num;
+	CK_ULONG at;
+	CK_ULONG i;
 
 	return_val_if_fail (count, CKR_ARGUMENTS_BAD);
 
-	num = token_present ? 1 : 2;
+	num = (token_present ? 1 : 2) + generated.slots;
 
 	/* Application only wants to know the number of slots. */
 	if (slot_list == NULL) {
@@ -530,9 +830,12 @@ mock_C_GetSlotList (CK_BBOOL token_present,
 		return_val_if_reached (CKR_BUFFER_TOO_SMALL);
 
 	*count = num;
-	slot_list[0] = MOCK_SLOT_ONE_ID;
+	at = 0;
+	slot_list[at++] = MOCK_SLOT_ONE_ID;
 	if (!token_present)
-		slot_list[1] = MOCK_SLOT_TWO_ID;
+		slot_list[at++] = MOCK_SLOT_TWO_ID;
+	for (i = 0; i < generated.slots; i++)
+		slot_list[at++] = MOCK_SLOT_SCALE_ID + i;
 
 	return CKR_OK;
 
@@ -588,7 +891,7 @@ mock_C_GetSlotInfo (CK_SLOT_ID slot_id,
 {
 	return_val_if_fail (info, CKR_ARGUMENTS_BAD);
 
-	if (slot_id == MOCK_SLOT_ONE_ID) {
+	if (is_token_slot (slot_id)) {
 		memcpy (info, &MOCK_INFO_ONE, sizeof (*info));
 		return CKR_OK;
 	} else if (slot_id == MOCK_SLOT_TWO_ID) {
@@ -659,6 +962,21 @@ static const CK_TOKEN_INFO MOCK_TOKEN_ONE = {
 	{ '1', '9', '9', '9', '0', '5', '2', '5', '0', '9', '1', '9', '5', '9', '0', '0' }
 };
 
+static void
+pad_string (CK_UTF8CHAR *field,
+            size_t length,
+            const char *prefix,
+            unsigned long number)
+{
+	char buffer[64];
+	int ret;
+
+	ret = snprintf (buffer, sizeof (buffer), "%s%lu", prefix, number);
+	return_if_fail (ret >= 0);
+	memset (field, ' ', length);
+	memcpy (field, buffer, (size_t)ret < length ? (size_t)ret : length);
+}
+
 CK_RV
 mock_C_GetTokenInfo (CK_SLOT_ID slot_id,
                      CK_TOKEN_INFO_PTR info)
@@ -668,6 +986,14 @@ mock_C_GetTokenInfo (CK_SLOT_ID slot_id,
 	if (slot_id == MOCK_SLOT_ONE_ID) {
 		memcpy (info, &MOCK_TOKEN_ONE, sizeof (*info));
 		return CKR_OK;
+	} else if (is_generated_slot (slot_id)) {
+		memcpy (info, &MOCK_TOKEN_ONE, sizeof (*info));
+		info->flags |= CKF_WRITE_PROTECTED;
+		pad_string (info->label, sizeof (info->label), "GENERATED TOKEN ",
+		            slot_id - MOCK_SLOT_SCALE_ID);
+		pad_string (info->serialNumber, sizeof (info->serialNumber), "GEN",
+		            slot_id - MOCK_SLOT_SCALE_ID);
+		return CKR_OK;
 	} else if (slot_id == MOCK_SLOT_TWO_ID) {
 		return CKR_TOKEN_NOT_PRESENT;
 	} else {
@@ -709,7 +1035,7 @@ mock_C_GetMechanismList (CK_SLOT_ID slot_id,
 
 	if (slot_id == MOCK_SLOT_TWO_ID)
 		return CKR_TOKEN_NOT_PRESENT;
-	else if (slot_id != MOCK_SLOT_ONE_ID)
+	else if (!is_token_slot (slot_id))
 		return CKR_SLOT_ID_INVALID;
 
 	/* Application only wants to know the number of slots. */
@@ -784,7 +1110,7 @@ mock_C_GetMechanismInfo (CK_SLOT_ID slot_id,
 
 	if (slot_id == MOCK_SLOT_TWO_ID)
 		return CKR_TOKEN_NOT_PRESENT;
-	else if (slot_id != MOCK_SLOT_ONE_ID)
+	else if (!is_token_slot (slot_id))
 		return CKR_SLOT_ID_INVALID;
 
 	if (type == CKM_MOCK_CAPITALIZE) {
@@ -913,7 +1239,7 @@ mock_C_OpenSession (CK_SLOT_ID slot_id,
 
 	if (slot_id == MOCK_SLOT_TWO_ID)
 		return CKR_TOKEN_NOT_PRESENT;
-	else if (slot_id != MOCK_SLOT_ONE_ID)
+	else if (!is_token_slot (slot_id))
 		return CKR_SLOT_ID_INVALID;
 	if ((flags & CKF_SERIAL_SESSION) != CKF_SERIAL_SESSION)
 		return CKR_SESSION_PARALLEL_NOT_SUPPORTED;
@@ -1001,12 +1327,22 @@ mock_X_CloseSession__invalid_handle (CK_X_FUNCTION_LIST *self,
 CK_RV
 mock_C_CloseAllSessions (CK_SLOT_ID slot_id)
 {
+	p11_dictiter iter;
+	Session *sess;
+
 	if (slot_id == MOCK_SLOT_TWO_ID)
 		return CKR_TOKEN_NOT_PRESENT;
-	else if (slot_id != MOCK_SLOT_ONE_ID)
+	else if (!is_token_slot (slot_id))
 		return CKR_SLOT_ID_INVALID;
 
-	p11_dict_clear (the_sessions);
+	p11_dict_iterate (the_sessions, &iter);
+	while (p11_dict_next (&iter, NULL, (void **)&sess)) {
+		if (sess->info.slotID == slot_id) {
+			p11_dict_remove (the_sessions, handle_to_pointer (sess->handle));
+			p11_dict_iterate (the_sessions, &iter);
+		}
+	}
+
 	return CKR_OK;
 }
 
@@ -1388,6 +1724,12 @@ mock_C_CreateObject (CK_SESSION_HANDLE session,
 		}
 	}
 
+	if (p11_attrs_find_bool (attrs, CKA_TOKEN, &token) && token &&
+	    is_generated_slot (sess->info.slotID)) {
+		p11_attrs_free (attrs);
+		return CKR_TOKEN_WRITE_PROTECTED;
+	}
+
 	*object = ++unique_identifier;
 	if (p11_attrs_find_bool (attrs, CKA_TOKEN, &token) && token)
 		p11_dict_set (the_objects, handle_to_pointer (*object), attrs);
@@ -1449,6 +1791,12 @@ mock_C_CopyObject (CK_SESSION_HANDLE session,
 
 	attrs = p11_attrs_buildn (p11_attrs_dup (attrs), template, count);
 
+	if (p11_attrs_find_bool (attrs, CKA_TOKEN, &token) && token &&
+	    is_generated_slot (sess->info.slotID)) {
+		p11_attrs_free (attrs);
+		return CKR_TOKEN_WRITE_PROTECTED;
+	}
+
 	*new_object = ++unique_identifier;
 	if (p11_attrs_find_bool (attrs, CKA_TOKEN, &token) && token)
 		p11_dict_set (the_objects, handle_to_pointer (*new_object), attrs);
@@ -1500,6 +1848,8 @@ mock_C_DestroyObject (CK_SESSION_HANDLE session,
 	rv = lookup_object (sess, object, &attrs, &table);
 	if (rv != CKR_OK)
 		return rv;
+	if (table == NULL)
+		return CKR_TOKEN_WRITE_PROTECTED;
 
 	p11_dict_remove (table, handle_to_pointer (object));
 	return CKR_OK;
@@ -1680,6 +2030,8 @@ mock_C_SetAttributeValue (CK_SESSION_HANDLE session,
 	rv = lookup_object (sess, object, &attrs, &table);
 	if (rv != CKR_OK)
 		return rv;
+	if (table == NULL)
+		return CKR_TOKEN_WRITE_PROTECTED;
 
 	p11_dict_steal (table, handle_to_pointer (object), NULL, (void **)&attrs);
 	attrs = p11_attrs_buildn (attrs, template, count);
@@ -3892,76 +4244,719 @@ CK_X_FUNCTION_LIST mock_x_module_no_slots = {
 	mock_X_WaitForSlotEvent__no_event,
 };
 
+/*
+ * The entry points of mock_module count their calls, add any latency
+ * requested with mock_module_scale(), and take turns with each other.
+ * Internal calls aren't counted.
+ */
+
+static CK_RV
+entry_Initialize (CK_VOID_PTR init_args)
+{
+	mock_called (offsetof (CK_FUNCTION_LIST, C_Initialize));
+	return mock_returned (mock_C_Initialize (init_args));
+}
+
+static CK_RV
+entry_Finalize (CK_VOID_PTR reserved)
+{
+	mock_called (offsetof (CK_FUNCTION_LIST, C_Finalize));
+	return mock_returned (mock_C_Finalize (reserved));
+}
+
+static CK_RV
+entry_GetInfo (CK_INFO_PTR info)
+{
+	mock_called (offsetof (CK_FUNCTION_LIST, C_GetInfo));
+	return mock_returned (mock_C_GetInfo (info));
+}
+
+static CK_RV
+entry_GetSlotList (CK_BBOOL token_present,
+                   CK_SLOT_ID_PTR slot_list,
+                   CK_ULONG_PTR count)
+{
+	mock_called (offsetof (CK_FUNCTION_LIST, C_GetSlotList));
+	return mock_returned (mock_C_GetSlotList (token_present, slot_list, count));
+}
+
+static CK_RV
+entry_GetSlotInfo (CK_SLOT_ID slot_id,
+                   CK_SLOT_INFO_PTR info)
+{
+	mock_called (offsetof (CK_FUNCTION_LIST, C_GetSlotInfo));
+	return mock_returned (mock_C_GetSlotInfo (slot_id, info));
+}
+
+static CK_RV
+entry_GetTokenInfo (CK_SLOT_ID slot_id,
+                    CK_TOKEN_INFO_PTR info)
+{
+	mock_called (offsetof (CK_FUNCTION_LIST, C_GetTokenInfo));
+	return mock_returned (mock_C_GetTokenInfo (slot_id, info));
+}
+
+static CK_RV
+entry_GetMechanismList (CK_SLOT_ID slot_id,
+                        CK_MECHANISM_TYPE_PTR mechanism_list,
+                        CK_ULONG_PTR count)
+{
+	mock_called (offsetof (CK_FUNCTION_LIST, C_GetMechanismList));
+	return mock_returned (mock_C_GetMechanismList (slot_id, mechanism_list, count));
+}
+
+static CK_RV
+entry_GetMechanismInfo (CK_SLOT_ID slot_id,
+                        CK_MECHANISM_TYPE type,
+                        CK_MECHANISM_INFO_PTR info)
+{
+	mock_called (offsetof (CK_FUNCTION_LIST, C_GetMechanismInfo));
+	return mock_returned (mock_C_GetMechanismInfo (slot_id, type, info));
+}
+
+static CK_RV
+entry_InitToken (CK_SLOT_ID slot_id,
+                 CK_UTF8CHAR_PTR pin,
+                 CK_ULONG pin_len,
+                 CK_UTF8CHAR_PTR label)
+{
+	mock_called (offsetof (CK_FUNCTION_LIST, C_InitToken));
+	return mock_returned (mock_C_InitToken__specific_args (slot_id, pin, pin_len, label));
+}
+
+static CK_RV
+entry_InitPIN (CK_SESSION_HANDLE session,
+               CK_UTF8CHAR_PTR pin,
+               CK_ULONG pin_len)
+{
+	mock_called (offsetof (CK_FUNCTION_LIST, C_InitPIN));
+	return mock_returned (mock_C_InitPIN__specific_args (session, pin, pin_len));
+}
+
+static CK_RV
+entry_SetPIN (CK_SESSION_HANDLE session,
+              CK_UTF8CHAR_PTR old_pin,
+              CK_ULONG old_pin_len,
+              CK_UTF8CHAR_PTR new_pin,
+              CK_ULONG new_pin_len)
+{
+	mock_called (offsetof (CK_FUNCTION_LIST, C_SetPIN));
+	return mock_returned (mock_C_SetPIN__specific_args (session, old_pin, old_pin_len, new_pin, new_pin_len));
+}
+
+static CK_RV
+entry_OpenSession (CK_SLOT_ID slot_id,
+                   CK_FLAGS flags,
+                   CK_VOID_PTR user_data,
+                   CK_NOTIFY callback,
+                   CK_SESSION_HANDLE_PTR session)
+{
+	mock_called (offsetof (CK_FUNCTION_LIST, C_OpenSession));
+	return mock_returned (mock_C_OpenSession (slot_id, flags, user_data, callback, session));
+}
+
+static CK_RV
+entry_CloseSession (CK_SESSION_HANDLE session)
+{
+	mock_called (offsetof (CK_FUNCTION_LIST, C_CloseSession));
+	return mock_returned (mock_C_CloseSession (session));
+}
+
+static CK_RV
+entry_CloseAllSessions (CK_SLOT_ID slot_id)
+{
+	mock_called (offsetof (CK_FUNCTION_LIST, C_CloseAllSessions));
+	return mock_returned (mock_C_CloseAllSessions (slot_id));
+}
+
+static CK_RV
+entry_GetSessionInfo (CK_SESSION_HANDLE session,
+                      CK_SESSION_INFO_PTR info)
+{
+	mock_called (offsetof (CK_FUNCTION_LIST, C_GetSessionInfo));
+	return mock_returned (mock_C_GetSessionInfo (session, info));
+}
+
+static CK_RV
+entry_GetOperationState (CK_SESSION_HANDLE session,
+                         CK_BYTE_PTR operation_state,
+                         CK_ULONG_PTR operation_state_len)
+{
+	mock_called (offsetof (CK_FUNCTION_LIST, C_GetOperationState));
+	return mock_returned (mock_C_GetOperationState (session, operation_state, operation_state_len));
+}
+
+static CK_RV
+entry_SetOperationState (CK_SESSION_HANDLE session,
+                         CK_BYTE_PTR operation_state,
+                         CK_ULONG operation_state_len,
+                         CK_OBJECT_HANDLE encryption_key,
+                         CK_OBJECT_HANDLE authentication_key)
+{
+	mock_called (offsetof (CK_FUNCTION_LIST, C_SetOperationState));
+	return mock_returned (mock_C_SetOperationState (session, operation_state, operation_state_len, encryption_key, authentication_key));
+}
+
+static CK_RV
+entry_Login (CK_SESSION_HANDLE session,
+             CK_USER_TYPE user_type,
+             CK_UTF8CHAR_PTR pin,
+             CK_ULONG pin_len)
+{
+	mock_called (offsetof (CK_FUNCTION_LIST, C_Login));
+	return mock_returned (mock_C_Login (session, user_type, pin, pin_len));
+}
+
+static CK_RV
+entry_Logout (CK_SESSION_HANDLE session)
+{
+	mock_called (offsetof (CK_FUNCTION_LIST, C_Logout));
+	return mock_returned (mock_C_Logout (session));
+}
+
+static CK_RV
+entry_CreateObject (CK_SESSION_HANDLE session,
+                    CK_ATTRIBUTE_PTR template,
+                    CK_ULONG count,
+                    CK_OBJECT_HANDLE_PTR object)
+{
+	mock_called (offsetof (CK_FUNCTION_LIST, C_CreateObject));
+	return mock_returned (mock_C_CreateObject (session, template, count, object));
+}
+
+static CK_RV
+entry_CopyObject (CK_SESSION_HANDLE session,
+                  CK_OBJECT_HANDLE object,
+                  CK_ATTRIBUTE_PTR template,
+                  CK_ULONG count,
+                  CK_OBJECT_HANDLE_PTR new_object)
+{
+	mock_called (offsetof (CK_FUNCTION_LIST, C_CopyObject));
+	return mock_returned (mock_C_CopyObject (session, object, template, count, new_object));
+}
+
+static CK_RV
+entry_DestroyObject (CK_SESSION_HANDLE session,
+                     CK_OBJECT_HANDLE object)
+{
+	mock_called (offsetof (CK_FUNCTION_LIST, C_DestroyObject));
+	return mock_returned (mock_C_DestroyObject (session, object));
+}
+
+static CK_RV
+entry_GetObjectSize (CK_SESSION_HANDLE session,
+                     CK_OBJECT_HANDLE object,
+                     CK_ULONG_PTR size)
+{
+	mock_called (offsetof (CK_FUNCTION_LIST, C_GetObjectSize));
+	return mock_returned (mock_C_GetObjectSize (session, object, size));
+}
+
+static CK_RV
+entry_GetAttributeValue (CK_SESSION_HANDLE session,
+                         CK_OBJECT_HANDLE object,
+                         CK_ATTRIBUTE_PTR template,
+                         CK_ULONG count)
+{
+	mock_called (offsetof (CK_FUNCTION_LIST, C_GetAttributeValue));
+	return mock_returned (mock_C_GetAttributeValue (session, object, template, count));
+}
+
+static CK_RV
+entry_SetAttributeValue (CK_SESSION_HANDLE session,
+                         CK_OBJECT_HANDLE object,
+                         CK_ATTRIBUTE_PTR template,
+                         CK_ULONG count)
+{
+	mock_called (offsetof (CK_FUNCTION_LIST, C_SetAttributeValue));
+	return mock_returned (mock_C_SetAttributeValue (session, object, template, count));
+}
+
+static CK_RV
+entry_FindObjectsInit (CK_SESSION_HANDLE session,
+                       CK_ATTRIBUTE_PTR template,
+                       CK_ULONG count)
+{
+	mock_called (offsetof (CK_FUNCTION_LIST, C_FindObjectsInit));
+	return mock_returned (mock_C_FindObjectsInit (session, template, count));
+}
+
+static CK_RV
+entry_FindObjects (CK_SESSION_HANDLE session,
+                   CK_OBJECT_HANDLE_PTR objects,
+                   CK_ULONG max_object_count,
+                   CK_ULONG_PTR object_count)
+{
+	mock_called (offsetof (CK_FUNCTION_LIST, C_FindObjects));
+	return mock_returned (mock_C_FindObjects (session, objects, max_object_count, object_count));
+}
+
+static CK_RV
+entry_FindObjectsFinal (CK_SESSION_HANDLE session)
+{
+	mock_called (offsetof (CK_FUNCTION_LIST, C_FindObjectsFinal));
+	return mock_returned (mock_C_FindObjectsFinal (session));
+}
+
+static CK_RV
+entry_EncryptInit (CK_SESSION_HANDLE session,
+                   CK_MECHANISM_PTR mechanism,
+                   CK_OBJECT_HANDLE key)
+{
+	mock_called (offsetof (CK_FUNCTION_LIST, C_EncryptInit));
+	return mock_returned (mock_C_EncryptInit (session, mechanism, key));
+}
+
+static CK_RV
+entry_Encrypt (CK_SESSION_HANDLE session,
+               CK_BYTE_PTR data,
+               CK_ULONG data_len,
+               CK_BYTE_PTR encrypted_data,
+               CK_ULONG_PTR encrypted_data_len)
+{
+	mock_called (offsetof (CK_FUNCTION_LIST, C_Encrypt));
+	return mock_returned (mock_C_Encrypt (session, data, data_len, encrypted_data, encrypted_data_len));
+}
+
+static CK_RV
+entry_EncryptUpdate (CK_SESSION_HANDLE session,
+                     CK_BYTE_PTR part,
+                     CK_ULONG part_len,
+                     CK_BYTE_PTR encrypted_part,
+                     CK_ULONG_PTR encrypted_part_len)
+{
+	mock_called (offsetof (CK_FUNCTION_LIST, C_EncryptUpdate));
+	return mock_returned (mock_C_EncryptUpdate (session, part, part_len, encrypted_part, encrypted_part_len));
+}
+
+static CK_RV
+entry_EncryptFinal (CK_SESSION_HANDLE session,
+                    CK_BYTE_PTR last_encrypted_part,
+                    CK_ULONG_PTR last_encrypted_part_len)
+{
+	mock_called (offsetof (CK_FUNCTION_LIST, C_EncryptFinal));
+	return mock_returned (mock_C_EncryptFinal (session, last_encrypted_part, last_encrypted_part_len));
+}
+
+static CK_RV
+entry_DecryptInit (CK_SESSION_HANDLE session,
+                   CK_MECHANISM_PTR mechanism,
+                   CK_OBJECT_HANDLE key)
+{
+	mock_called (offsetof (CK_FUNCTION_LIST, C_DecryptInit));
+	return mock_returned (mock_C_DecryptInit (session, mechanism, key));
+}
+
+static CK_RV
+entry_Decrypt (CK_SESSION_HANDLE session,
+               CK_BYTE_PTR encrypted_data,
+               CK_ULONG encrypted_data_len,
+               CK_BYTE_PTR data,
+               CK_ULONG_PTR data_len)
+{
+	mock_called (offsetof (CK_FUNCTION_LIST, C_Decrypt));
+	return mock_returned (mock_C_Decrypt (session, encrypted_data, encrypted_data_len, data, data_len));
+}
+
+static CK_RV
+entry_DecryptUpdate (CK_SESSION_HANDLE session,
+                     CK_BYTE_PTR encrypted_part,
+                     CK_ULONG encrypted_part_len,
+                     CK_BYTE_PTR part,
+                     CK_ULONG_PTR part_len)
+{
+	mock_called (offsetof (CK_FUNCTION_LIST, C_DecryptUpdate));
+	return mock_returned (mock_C_DecryptUpdate (session, encrypted_part, encrypted_part_len, part, part_len));
+}
+
+static CK_RV
+entry_DecryptFinal (CK_SESSION_HANDLE session,
+                    CK_BYTE_PTR last_part,
+                    CK_ULONG_PTR last_part_len)
+{
+	mock_called (offsetof (CK_FUNCTION_LIST, C_DecryptFinal));
+	return mock_returned (mock_C_DecryptFinal (session, last_part, last_part_len));
+}
+
+static CK_RV
+entry_DigestInit (CK_SESSION_HANDLE session,
+                  CK_MECHANISM_PTR mechanism)
+{
+	mock_called (offsetof (CK_FUNCTION_LIST, C_DigestInit));
+	return mock_returned (mock_C_DigestInit (session, mechanism));
+}
+
+static CK_RV
+entry_Digest (CK_SESSION_HANDLE session,
+              CK_BYTE_PTR data,
+              CK_ULONG data_len,
+              CK_BYTE_PTR digest,
+              CK_ULONG_PTR digest_len)
+{
+	mock_called (offsetof (CK_FUNCTION_LIST, C_Digest));
+	return mock_returned (mock_C_Digest (session, data, data_len, digest, digest_len));
+}
+
+static CK_RV
+entry_DigestUpdate (CK_SESSION_HANDLE session,
+                    CK_BYTE_PTR part,
+                    CK_ULONG part_len)
+{
+	mock_called (offsetof (CK_FUNCTION_LIST, C_DigestUpdate));
+	return mock_returned (mock_C_DigestUpdate (session, part, part_len));
+}
+
+static CK_RV
+entry_DigestKey (CK_SESSION_HANDLE session,
+                 CK_OBJECT_HANDLE key)
+{
+	mock_called (offsetof (CK_FUNCTION_LIST, C_DigestKey));
+	return mock_returned (mock_C_DigestKey (session, key));
+}
+
+static CK_RV
+entry_DigestFinal (CK_SESSION_HANDLE session,
+                   CK_BYTE_PTR digest,
+                   CK_ULONG_PTR digest_len)
+{
+	mock_called (offsetof (CK_FUNCTION_LIST, C_DigestFinal));
+	return mock_returned (mock_C_DigestFinal (session, digest, digest_len));
+}
+
+static CK_RV
+entry_SignInit (CK_SESSION_HANDLE session,
+                CK_MECHANISM_PTR mechanism,
+                CK_OBJECT_HANDLE key)
+{
+	mock_called (offsetof (CK_FUNCTION_LIST, C_SignInit));
+	return mock_returned (mock_C_SignInit (session, mechanism, key));
+}
+
+static CK_RV
+entry_Sign (CK_SESSION_HANDLE session,
+            CK_BYTE_PTR data,
+            CK_ULONG data_len,
+            CK_BYTE_PTR signature,
+            CK_ULONG_PTR signature_len)
+{
+	mock_called (offsetof (CK_FUNCTION_LIST, C_Sign));
+	return mock_returned (mock_C_Sign (session, data, data_len, signature, signature_len));
+}
+
+static CK_RV
+entry_SignUpdate (CK_SESSION_HANDLE session,
+                  CK_BYTE_PTR part,
+                  CK_ULONG part_len)
+{
+	mock_called (offsetof (CK_FUNCTION_LIST, C_SignUpdate));
+	return mock_returned (mock_C_SignUpdate (session, part, part_len));
+}
+
+static CK_RV
+entry_SignFinal (CK_SESSION_HANDLE session,
+                 CK_BYTE_PTR signature,
+                 CK_ULONG_PTR signature_len)
+{
+	mock_called (offsetof (CK_FUNCTION_LIST, C_SignFinal));
+	return mock_returned (mock_C_SignFinal (session, signature, signature_len));
+}
+
+static CK_RV
+entry_SignRecoverInit (CK_SESSION_HANDLE session,
+                       CK_MECHANISM_PTR mechanism,
+                       CK_OBJECT_HANDLE key)
+{
+	mock_called (offsetof (CK_FUNCTION_LIST, C_SignRecoverInit));
+	return mock_returned (mock_C_SignRecoverInit (session, mechanism, key));
+}
+
+static CK_RV
+entry_SignRecover (CK_SESSION_HANDLE session,
+                   CK_BYTE_PTR data,
+                   CK_ULONG data_len,
+                   CK_BYTE_PTR signature,
+                   CK_ULONG_PTR signature_len)
+{
+	mock_called (offsetof (CK_FUNCTION_LIST, C_SignRecover));
+	return mock_returned (mock_C_SignRecover (session, data, data_len, signature, signature_len));
+}
+
+static CK_RV
+entry_VerifyInit (CK_SESSION_HANDLE session,
+                  CK_MECHANISM_PTR mechanism,
+                  CK_OBJECT_HANDLE key)
+{
+	mock_called (offsetof (CK_FUNCTION_LIST, C_VerifyInit));
+	return mock_returned (mock_C_VerifyInit (session, mechanism, key));
+}
+
+static CK_RV
+entry_Verify (CK_SESSION_HANDLE session,
+              CK_BYTE_PTR data,
+              CK_ULONG data_len,
+              CK_BYTE_PTR signature,
+              CK_ULONG signature_len)
+{
+	mock_called (offsetof (CK_FUNCTION_LIST, C_Verify));
+	return mock_returned (mock_C_Verify (session, data, data_len, signature, signature_len));
+}
+
+static CK_RV
+entry_VerifyUpdate (CK_SESSION_HANDLE session,
+                    CK_BYTE_PTR part,
+                    CK_ULONG part_len)
+{
+	mock_called (offsetof (CK_FUNCTION_LIST, C_VerifyUpdate));
+	return mock_returned (mock_C_VerifyUpdate (session, part, part_len));
+}
+
+static CK_RV
+entry_VerifyFinal (CK_SESSION_HANDLE session,
+                   CK_BYTE_PTR signature,
+                   CK_ULONG signature_len)
+{
+	mock_called (offsetof (CK_FUNCTION_LIST, C_VerifyFinal));
+	return mock_returned (mock_C_VerifyFinal (session, signature, signature_len));
+}
+
+static CK_RV
+entry_VerifyRecoverInit (CK_SESSION_HANDLE session,
+                         CK_MECHANISM_PTR mechanism,
+                         CK_OBJECT_HANDLE key)
+{
+	mock_called (offsetof (CK_FUNCTION_LIST, C_VerifyRecoverInit));
+	return mock_returned (mock_C_VerifyRecoverInit (session, mechanism, key));
+}
+
+static CK_RV
+entry_VerifyRecover (CK_SESSION_HANDLE session,
+                     CK_BYTE_PTR signature,
+                     CK_ULONG signature_len,
+                     CK_BYTE_PTR data,
+                     CK_ULONG_PTR data_len)
+{
+	mock_called (offsetof (CK_FUNCTION_LIST, C_VerifyRecover));
+	return mock_returned (mock_C_VerifyRecover (session, signature, signature_len, data, data_len));
+}
+
+static CK_RV
+entry_DigestEncryptUpdate (CK_SESSION_HANDLE session,
+                           CK_BYTE_PTR part,
+                           CK_ULONG part_len,
+                           CK_BYTE_PTR encrypted_part,
+                           CK_ULONG_PTR encrypted_part_len)
+{
+	mock_called (offsetof (CK_FUNCTION_LIST, C_DigestEncryptUpdate));
+	return mock_returned (mock_C_DigestEncryptUpdate (session, part, part_len, encrypted_part, encrypted_part_len));
+}
+
+static CK_RV
+entry_DecryptDigestUpdate (CK_SESSION_HANDLE session,
+                           CK_BYTE_PTR encrypted_part,
+                           CK_ULONG encrypted_part_len,
+                           CK_BYTE_PTR part,
+                           CK_ULONG_PTR part_len)
+{
+	mock_called (offsetof (CK_FUNCTION_LIST, C_DecryptDigestUpdate));
+	return mock_returned (mock_C_DecryptDigestUpdate (session, encrypted_part, encrypted_part_len, part, part_len));
+}
+
+static CK_RV
+entry_SignEncryptUpdate (CK_SESSION_HANDLE session,
+                         CK_BYTE_PTR part,
+                         CK_ULONG part_len,
+                         CK_BYTE_PTR encrypted_part,
+                         CK_ULONG_PTR encrypted_part_len)
+{
+	mock_called (offsetof (CK_FUNCTION_LIST, C_SignEncryptUpdate));
+	return mock_returned (mock_C_SignEncryptUpdate (session, part, part_len, encrypted_part, encrypted_part_len));
+}
+
+static CK_RV
+entry_DecryptVerifyUpdate (CK_SESSION_HANDLE session,
+                           CK_BYTE_PTR encrypted_part,
+                           CK_ULONG encrypted_part_len,
+                           CK_BYTE_PTR part,
+                           CK_ULONG_PTR part_len)
+{
+	mock_called (offsetof (CK_FUNCTION_LIST, C_DecryptVerifyUpdate));
+	return mock_returned (mock_C_DecryptVerifyUpdate (session, encrypted_part, encrypted_part_len, part, part_len));
+}
+
+static CK_RV
+entry_GenerateKey (CK_SESSION_HANDLE session,
+                   CK_MECHANISM_PTR mechanism,
+                   CK_ATTRIBUTE_PTR template,
+                   CK_ULONG count,
+                   CK_OBJECT_HANDLE_PTR key)
+{
+	mock_called (offsetof (CK_FUNCTION_LIST, C_GenerateKey));
+	return mock_returned (mock_C_GenerateKey (session, mechanism, template, count, key));
+}
+
+static CK_RV
+entry_GenerateKeyPair (CK_SESSION_HANDLE session,
+                       CK_MECHANISM_PTR mechanism,
+                       CK_ATTRIBUTE_PTR public_key_template,
+                       CK_ULONG public_key_count,
+                       CK_ATTRIBUTE_PTR private_key_template,
+                       CK_ULONG private_key_count,
+                       CK_OBJECT_HANDLE_PTR public_key,
+                       CK_OBJECT_HANDLE_PTR private_key)
+{
+	mock_called (offsetof (CK_FUNCTION_LIST, C_GenerateKeyPair));
+	return mock_returned (mock_C_GenerateKeyPair (session, mechanism, public_key_template, public_key_count, private_key_template, private_key_count, public_key, private_key));
+}
+
+static CK_RV
+entry_WrapKey (CK_SESSION_HANDLE session,
+               CK_MECHANISM_PTR mechanism,
+               CK_OBJECT_HANDLE wrapping_key,
+               CK_OBJECT_HANDLE key,
+               CK_BYTE_PTR wrapped_key,
+               CK_ULONG_PTR wrapped_key_len)
+{
+	mock_called (offsetof (CK_FUNCTION_LIST, C_WrapKey));
+	return mock_returned (mock_C_WrapKey (session, mechanism, wrapping_key, key, wrapped_key, wrapped_key_len));
+}
+
+static CK_RV
+entry_UnwrapKey (CK_SESSION_HANDLE session,
+                 CK_MECHANISM_PTR mechanism,
+                 CK_OBJECT_HANDLE unwrapping_key,
+                 CK_BYTE_PTR wrapped_key,
+                 CK_ULONG wrapped_key_len,
+                 CK_ATTRIBUTE_PTR template,
+                 CK_ULONG count,
+                 CK_OBJECT_HANDLE_PTR key)
+{
+	mock_called (offsetof (CK_FUNCTION_LIST, C_UnwrapKey));
+	return mock_returned (mock_C_UnwrapKey (session, mechanism, unwrapping_key, wrapped_key, wrapped_key_len, template, count, key));
+}
+
+static CK_RV
+entry_DeriveKey (CK_SESSION_HANDLE session,
+                 CK_MECHANISM_PTR mechanism,
+                 CK_OBJECT_HANDLE base_key,
+                 CK_ATTRIBUTE_PTR template,
+                 CK_ULONG count,
+                 CK_OBJECT_HANDLE_PTR key)
+{
+	mock_called (offsetof (CK_FUNCTION_LIST, C_DeriveKey));
+	return mock_returned (mock_C_DeriveKey (session, mechanism, base_key, template, count, key));
+}
+
+static CK_RV
+entry_SeedRandom (CK_SESSION_HANDLE session,
+                  CK_BYTE_PTR seed,
+                  CK_ULONG seed_len)
+{
+	mock_called (offsetof (CK_FUNCTION_LIST, C_SeedRandom));
+	return mock_returned (mock_C_SeedRandom (session, seed, seed_len));
+}
+
+static CK_RV
+entry_GenerateRandom (CK_SESSION_HANDLE session,
+                      CK_BYTE_PTR random_data,
+                      CK_ULONG random_len)
+{
+	mock_called (offsetof (CK_FUNCTION_LIST, C_GenerateRandom));
+	return mock_returned (mock_C_GenerateRandom (session, random_data, random_len));
+}
+
+static CK_RV
+entry_GetFunctionStatus (CK_SESSION_HANDLE session)
+{
+	mock_called (offsetof (CK_FUNCTION_LIST, C_GetFunctionStatus));
+	return mock_returned (mock_C_GetFunctionStatus (session));
+}
+
+static CK_RV
+entry_CancelFunction (CK_SESSION_HANDLE session)
+{
+	mock_called (offsetof (CK_FUNCTION_LIST, C_CancelFunction));
+	return mock_returned (mock_C_CancelFunction (session));
+}
+
+static CK_RV
+entry_WaitForSlotEvent (CK_FLAGS flags,
+                        CK_SLOT_ID_PTR slot,
+                        CK_VOID_PTR reserved)
+{
+	mock_called (offsetof (CK_FUNCTION_LIST, C_WaitForSlotEvent));
+	return mock_returned (mock_C_WaitForSlotEvent (flags, slot, reserved));
+}
+
 CK_FUNCTION_LIST mock_module = {
 	{ CRYPTOKI_VERSION_MAJOR, CRYPTOKI_VERSION_MINOR },  /* version */
-	mock_C_Initialize,
-	mock_C_Finalize,
-	mock_C_GetInfo,
+	entry_Initialize,
+	entry_Finalize,
+	entry_GetInfo,
 	mock_C_GetFunctionList_not_supported,
-	mock_C_GetSlotList,
-	mock_C_GetSlotInfo,
-	mock_C_GetTokenInfo,
-	mock_C_GetMechanismList,
-	mock_C_GetMechanismInfo,
-	mock_C_InitToken__specific_args,
-	mock_C_InitPIN__specific_args,
-	mock_C_SetPIN__specific_args,
-	mock_C_OpenSession,
-	mock_C_CloseSession,
-	mock_C_CloseAllSessions,
-	mock_C_GetSessionInfo,
-	mock_C_GetOperationState,
-	mock_C_SetOperationState,
-	mock_C_Login,
-	mock_C_Logout,
-	mock_C_CreateObject,
-	mock_C_CopyObject,
-	mock_C_DestroyObject,
-	mock_C_GetObjectSize,
-	mock_C_GetAttributeValue,
-	mock_C_SetAttributeValue,
-	mock_C_FindObjectsInit,
-	mock_C_FindObjects,
-	mock_C_FindObjectsFinal,
-	mock_C_EncryptInit,
-	mock_C_Encrypt,
-	mock_C_EncryptUpdate,
-	mock_C_EncryptFinal,
-	mock_C_DecryptInit,
-	mock_C_Decrypt,
-	mock_C_DecryptUpdate,
-	mock_C_DecryptFinal,
-	mock_C_DigestInit,
-	mock_C_Digest,
-	mock_C_DigestUpdate,
-	mock_C_DigestKey,
-	mock_C_DigestFinal,
-	mock_C_SignInit,
-	mock_C_Sign,
-	mock_C_SignUpdate,
-	mock_C_SignFinal,
-	mock_C_SignRecoverInit,
-	mock_C_SignRecover,
-	mock_C_VerifyInit,
-	mock_C_Verify,
-	mock_C_VerifyUpdate,
-	mock_C_VerifyFinal,
-	mock_C_VerifyRecoverInit,
-	mock_C_VerifyRecover,
-	mock_C_DigestEncryptUpdate,
-	mock_C_DecryptDigestUpdate,
-	mock_C_SignEncryptUpdate,
-	mock_C_DecryptVerifyUpdate,
-	mock_C_GenerateKey,
-	mock_C_GenerateKeyPair,
-	mock_C_WrapKey,
-	mock_C_UnwrapKey,
-	mock_C_DeriveKey,
-	mock_C_SeedRandom,
-	mock_C_GenerateRandom,
-	mock_C_GetFunctionStatus,
-	mock_C_CancelFunction,
-	mock_C_WaitForSlotEvent,
+	entry_GetSlotList,
+	entry_GetSlotInfo,
+	entry_GetTokenInfo,
+	entry_GetMechanismList,
+	entry_GetMechanismInfo,
+	entry_InitToken,
+	entry_InitPIN,
+	entry_SetPIN,
+	entry_OpenSession,
+	entry_CloseSession,
+	entry_CloseAllSessions,
+	entry_GetSessionInfo,
+	entry_GetOperationState,
+	entry_SetOperationState,
+	entry_Login,
+	entry_Logout,
+	entry_CreateObject,
+	entry_CopyObject,
+	entry_DestroyObject,
+	entry_GetObjectSize,
+	entry_GetAttributeValue,
+	entry_SetAttributeValue,
+	entry_FindObjectsInit,
+	entry_FindObjects,
+	entry_FindObjectsFinal,
+	entry_EncryptInit,
+	entry_Encrypt,
+	entry_EncryptUpdate,
+	entry_EncryptFinal,
+	entry_DecryptInit,
+	entry_Decrypt,
+	entry_DecryptUpdate,
+	entry_DecryptFinal,
+	entry_DigestInit,
+	entry_Digest,
+	entry_DigestUpdate,
+	entry_DigestKey,
+	entry_DigestFinal,
+	entry_SignInit,
+	entry_Sign,
+	entry_SignUpdate,
+	entry_SignFinal,
+	entry_SignRecoverInit,
+	entry_SignRecover,
+	entry_VerifyInit,
+	entry_Verify,
+	entry_VerifyUpdate,
+	entry_VerifyFinal,
+	entry_VerifyRecoverInit,
+	entry_VerifyRecover,
+	entry_DigestEncryptUpdate,
+	entry_DecryptDigestUpdate,
+	entry_SignEncryptUpdate,
+	entry_DecryptVerifyUpdate,
+	entry_GenerateKey,
+	entry_GenerateKeyPair,
+	entry_WrapKey,
+	entry_UnwrapKey,
+	entry_DeriveKey,
+	entry_SeedRandom,
+	entry_GenerateRandom,
+	entry_GetFunctionStatus,
+	entry_CancelFunction,
+	entry_WaitForSlotEvent,
 };
 
 void
@@ -3970,6 +4965,7 @@ mock_module_init (void)
 	static bool initialized = false;
 	if (!initialized) {
 		p11_mutex_init (&init_mutex);
+		p11_mutex_init (&entry_mutex);
 		initialized = true;
 	}
 }
@@ -90,8 +90,26 @@ enum {
 
 	MOCK_SLOTS_PRESENT = 1,
 	MOCK_SLOTS_ALL = 2,
+
+	/* The first of the generated slots, see mock_module_scale() */
+	MOCK_SLOT_SCALE_ID = 1000,
+	MOCK_SCALE_OBJECT = 0x10000000,
 };
 
+typedef struct {
+	/* Extra slots, each with a generated read-only token */
+	CK_ULONG slots;
+
+	/* Objects generated on each token, certificate and public key pairs */
+	CK_ULONG objects;
+
+	/* Length of each generated CKA_VALUE, or zero for a typical certificate */
+	CK_ULONG value_len;
+
+	/* Microseconds added to each call through mock_module */
+	unsigned int latency;
+} mock_scale;
+
 static const CK_INFO MOCK_INFO = {
 	{ CRYPTOKI_VERSION_MAJOR, CRYPTOKI_VERSION_MINOR },
 	"MOCK MANUFACTURER               ",
@@ -126,6 +144,15 @@ bool         mock_module_initialized                     (void);
 void         mock_module_take_object                     (CK_SLOT_ID slot_id,
                                                           CK_ATTRIBUTE *attrs);
 
+void         mock_module_scale                           (const mock_scale *scale);
+
+bool         mock_module_scale_parse                     (const char *string,
+                                                          mock_scale *scale);
+
+unsigned long mock_module_calls                          (size_t offset);
+
+void         mock_module_reset_calls                     (void);
+
 CK_RV        mock_C_Initialize                           (CK_VOID_PTR init_args);
 
 CK_RV        mock_C_Initialize__fails                    (CK_VOID_PTR init_args);
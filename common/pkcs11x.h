@@ -135,6 +135,15 @@ typedef CK_ULONG                        CK_TRUST;
 
 #define CKO_X_CERTIFICATE_EXTENSION                  (CKO_X_VENDOR + 200)
 
+/* -------------------------------------------------------------------
+ * SESSIONS
+ *
+ * A read/write session opened with this flag writes changes to the
+ * token out when it is closed, rather than as they are made.
+ */
+
+#define CKF_X_BATCH_SESSION                          (1UL << 31)
+
 /* From the 2.40 draft */
 #ifndef CKA_PUBLIC_KEY_INFO
 #define CKA_PUBLIC_KEY_INFO                          0x00000129UL
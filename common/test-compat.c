@@ -57,6 +57,29 @@ test_strndup (void)
 	free (res);
 }
 
+static void
+test_clz64 (void)
+{
+	int i;
+
+	for (i = 0; i < 64; i++)
+		assert_num_eq (63 - i, p11_clz64 ((uint64_t)1 << i));
+
+	assert_num_eq (0, p11_clz64 (UINT64_MAX));
+	assert_num_eq (32, p11_clz64 (0xFFFFFFFFULL));
+	assert_num_eq (59, p11_clz64 (17));
+}
+
+static void
+test_clock_ns (void)
+{
+	uint64_t start;
+
+	start = p11_clock_ns ();
+	p11_sleep_ms (2);
+	assert_num_cmp (p11_clock_ns () - start, >=, 1000000);
+}
+
 #ifdef OS_UNIX
 
 static void
@@ -133,6 +156,8 @@ main (int argc,
       char *argv[])
 {
 	p11_test (test_strndup, "/compat/strndup");
+	p11_test (test_clz64, "/compat/clz64");
+	p11_test (test_clock_ns, "/compat/clock_ns");
 #ifdef OS_UNIX
 	/* Don't run this test when under fakeroot */
 	if (!getenv ("FAKED_MODE")) {
@@ -76,12 +76,39 @@ test_constants (void *arg)
 
 		check = p11_constant_resolve (names, constant[i].name);
 		assert_num_eq (constant[i].value, check);
+
+		for (j = 0; constant[i].nicks[j] != NULL; j++) {
+			check = p11_constant_lookup (true, constant[i].nicks[j],
+			                             strlen (constant[i].nicks[j]));
+			assert_num_eq (constant[i].value, check);
+		}
+
+		check = p11_constant_lookup (false, constant[i].name, strlen (constant[i].name));
+		assert_num_eq (constant[i].value, check);
 	}
 
 	p11_dict_free (names);
 	p11_dict_free (nicks);
 }
 
+static void
+test_lookup_invalid (void)
+{
+	assert_num_eq (CKA_INVALID, p11_constant_lookup (true, "", 0));
+	assert_num_eq (CKA_INVALID, p11_constant_lookup (false, "", 0));
+	assert_num_eq (CKA_INVALID, p11_constant_lookup (true, "not-a-constant", 14));
+	assert_num_eq (CKA_INVALID, p11_constant_lookup (false, "CKA_NOT_A_CONSTANT", 18));
+
+	/* Names are not nicks */
+	assert_num_eq (CKA_INVALID, p11_constant_lookup (true, "CKA_LABEL", 9));
+	assert_num_eq (CKA_INVALID, p11_constant_lookup (false, "label", 5));
+
+	/* Only the given length is used */
+	assert_num_eq (CKA_LABEL, p11_constant_lookup (true, "label: value", 5));
+	assert_num_eq (CKA_INVALID, p11_constant_lookup (true, "labe", 4));
+	assert_num_eq (CKA_INVALID, p11_constant_lookup (true, "labels", 6));
+}
+
 int
 main (int argc,
       char *argv[])
@@ -98,5 +125,7 @@ main (int argc,
 	p11_testx (test_constants, (void *)p11_constant_states, "/constants/states");
 	p11_testx (test_constants, (void *)p11_constant_returns, "/constants/returns");
 
+	p11_test (test_lookup_invalid, "/constants/lookup-invalid");
+
 	return p11_test_run (argc, argv);
 }
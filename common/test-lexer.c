@@ -136,6 +136,42 @@ test_basic (void)
 	check_lex_success (expected, input);
 }
 
+static void
+test_slices (void)
+{
+	const char *input = "[the header]\n"
+	                    "  field: value  \r\n"
+	                    "number    :3\n";
+	p11_lexer lexer;
+	bool failed;
+
+	p11_lexer_init_full (&lexer, "test", input, strlen (input), P11_LEXER_SLICES);
+
+	assert (p11_lexer_next (&lexer, &failed));
+	assert_num_eq (TOK_SECTION, lexer.tok_type);
+	assert_ptr_eq (input + 1, lexer.tok.section.name);
+	assert_num_eq (10, lexer.tok.section.name_len);
+
+	assert (p11_lexer_next (&lexer, &failed));
+	assert_num_eq (TOK_FIELD, lexer.tok_type);
+	assert_ptr_eq (input + 15, lexer.tok.field.name);
+	assert_num_eq (5, lexer.tok.field.name_len);
+	assert_ptr_eq (input + 22, lexer.tok.field.value);
+	assert_num_eq (5, lexer.tok.field.value_len);
+
+	assert (p11_lexer_next (&lexer, &failed));
+	assert_num_eq (TOK_FIELD, lexer.tok_type);
+	assert (strncmp ("number", lexer.tok.field.name, lexer.tok.field.name_len) == 0);
+	assert_num_eq (6, lexer.tok.field.name_len);
+	assert (strncmp ("3", lexer.tok.field.value, lexer.tok.field.value_len) == 0);
+	assert_num_eq (1, lexer.tok.field.value_len);
+
+	assert (!p11_lexer_next (&lexer, &failed));
+	assert (!failed);
+
+	p11_lexer_done (&lexer);
+}
+
 static void
 test_corners (void)
 {
@@ -244,6 +280,7 @@ main (int argc,
       char *argv[])
 {
 	p11_test (test_basic, "/lexer/basic");
+	p11_test (test_slices, "/lexer/slices");
 	p11_test (test_corners, "/lexer/corners");
 	p11_test (test_following, "/lexer/following");
 	p11_test (test_bad_pem, "/lexer/bad-pem");
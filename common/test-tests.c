@@ -79,11 +79,21 @@ test_leak (void)
 	}
 }
 
+static void
+bench_counter (void *data)
+{
+	int *counter = data;
+	(*counter)++;
+}
+
 int
 main (int argc,
       char *argv[])
 {
+	static int counter = 0;
+
 	p11_test (test_success, "/test/success");
+	p11_bench (bench_counter, &counter, "/test/bench");
 
 	if (getenv ("TEST_FAIL")) {
 		p11_test (test_failure, "/test/failure");
@@ -116,6 +116,56 @@ test_decode_failure (void)
 	check_decode_failure ("%54%XX%53%54%00", -1);
 }
 
+static void
+test_decode_to (void)
+{
+	const char *input = "%54 %45 %53 %54";
+	unsigned char result[8];
+	size_t length;
+
+	length = sizeof (result);
+	if (!p11_url_decode_to (input, input + strlen (input), P11_URL_WHITESPACE, result, &length))
+		assert_not_reached ();
+	assert_num_eq (4, length);
+	assert (memcmp (result, "TEST", 4) == 0);
+
+	/* Reports the full length when the result doesn't fit */
+	memset (result, 'X', sizeof (result));
+	length = 2;
+	if (!p11_url_decode_to (input, input + strlen (input), P11_URL_WHITESPACE, result, &length))
+		assert_not_reached ();
+	assert_num_eq (4, length);
+	assert (memcmp (result, "TEXX", 4) == 0);
+
+	length = sizeof (result);
+	input = "%5";
+	assert (!p11_url_decode_to (input, input + 2, "", result, &length));
+	input = "%G4";
+	assert (!p11_url_decode_to (input, input + 3, "", result, &length));
+}
+
+static void
+test_encode_long (void)
+{
+	unsigned char input[1000];
+	p11_buffer buf;
+	size_t i;
+
+	for (i = 0; i < sizeof (input); i++)
+		input[i] = (i % 2) ? 'a' : ' ';
+
+	if (!p11_buffer_init_null (&buf, 5))
+		assert_not_reached ();
+
+	p11_url_encode (input, input + sizeof (input), P11_URL_VERBATIM, &buf);
+	assert (p11_buffer_ok (&buf));
+	assert_num_eq (2000, buf.len);
+	assert (strncmp ("%20a%20a", buf.data, 8) == 0);
+	assert (strcmp ("%20a", (char *)buf.data + 1996) == 0);
+
+	p11_buffer_uninit (&buf);
+}
+
 static void
 test_encode (void)
 {
@@ -157,8 +207,10 @@ main (int argc,
 	p11_test (test_decode_success, "/url/decode-success");
 	p11_test (test_decode_skip, "/url/decode-skip");
 	p11_test (test_decode_failure, "/url/decode-failure");
+	p11_test (test_decode_to, "/url/decode-to");
 
 	p11_test (test_encode, "/url/encode");
 	p11_test (test_encode_verbatim, "/url/encode-verbatim");
+	p11_test (test_encode_long, "/url/encode-long");
 	return p11_test_run (argc, argv);
 }
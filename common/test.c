@@ -59,8 +59,18 @@
 enum {
 	FIXTURE,
 	TEST,
+	BENCH,
 };
 
+enum {
+	FORMAT_TAP,
+	FORMAT_JSON,
+	FORMAT_CSV,
+};
+
+/* A sample runs a benchmark at least this long, in nanoseconds */
+#define BENCH_SAMPLE_NS 200000.0
+
 typedef void (*func_with_arg) (void *);
 
 typedef struct _test_item {
@@ -87,6 +97,13 @@ struct {
 	test_item *last;
 	int number;
 	jmp_buf jump;
+
+	/* Benchmark options */
+	bool bench;
+	int format;
+	int samples;
+	int warmup;
+	FILE *tap;
 } gl = { NULL, NULL, 0, };
 
 void
@@ -103,10 +120,10 @@ p11_test_fail (const char *filename,
 	va_list va;
 
 	assert (gl.last != NULL);
-	assert (gl.last->type == TEST);
+	assert (gl.last->type == TEST || gl.last->type == BENCH);
 	gl.last->x.test.failed = 1;
 
-	printf ("not ok %d %s\n", gl.number, gl.last->x.test.name);
+	fprintf (gl.tap, "not ok %d %s\n", gl.number, gl.last->x.test.name);
 
 	va_start (va, message);
 	if (vasprintf (&output, message, va) < 0)
@@ -120,7 +137,7 @@ p11_test_fail (const char *filename,
 			next += 1;
 		}
 
-		printf ("# %s\n", from);
+		fprintf (gl.tap, "# %s\n", from);
 		from = next;
 	}
 
@@ -128,7 +145,7 @@ p11_test_fail (const char *filename,
 	if (pos != NULL && pos[1] != '\0')
 		filename = pos + 1;
 
-	printf ("# in %s() at %s:%d\n", function, filename, line);
+	fprintf (gl.tap, "# in %s() at %s:%d\n", function, filename, line);
 
 	free (output);
 
@@ -193,6 +210,25 @@ p11_testx (void (* function) (void *),
 	test_push (&item);
 }
 
+void
+p11_bench (void (* function) (void *),
+           void *argument,
+           const char *name,
+           ...)
+{
+	test_item item = { BENCH, };
+	va_list va;
+
+	item.x.test.func = function;
+	item.x.test.argument = argument;
+
+	va_start (va, name);
+	vsnprintf (item.x.test.name, sizeof (item.x.test.name), name, va);
+	va_end (va);
+
+	test_push (&item);
+}
+
 void
 p11_fixture (void (* setup) (void *),
              void (* teardown) (void *))
@@ -212,6 +248,10 @@ should_run_test (int argc,
                  test_item *item)
 {
 	int i;
+
+	/* When benchmarking, only run the benchmarks */
+	if (item->type == FIXTURE || (gl.bench && item->type != BENCH))
+		return 0;
 	if (argc == 0)
 		return 1;
 	for (i = 0; i < argc; i++) {
@@ -222,6 +262,96 @@ should_run_test (int argc,
 	return 0;
 }
 
+static double
+bench_batch (test_item *item,
+             unsigned long batch)
+{
+	func_with_arg func = item->x.test.func;
+	void *argument = item->x.test.argument;
+	unsigned long i;
+	double start;
+
+	start = (double)p11_clock_ns ();
+	for (i = 0; i < batch; i++)
+		(func) (argument);
+	return (double)p11_clock_ns () - start;
+}
+
+static int
+compar_double (const void *one,
+               const void *two)
+{
+	double a = *(const double *)one;
+	double b = *(const double *)two;
+	return (a > b) - (a < b);
+}
+
+static double
+percentile (double *sorted,
+            int count,
+            int percent)
+{
+	int at = (count * percent + 99) / 100;
+	if (at < 1)
+		at = 1;
+	return sorted[at - 1];
+}
+
+static void
+bench_run (test_item *item)
+{
+	unsigned long batch = 1;
+	double *samples;
+	double elapsed;
+	double total;
+	int i;
+
+	/* Find a batch size that runs long enough to time, this warms up too */
+	while ((elapsed = bench_batch (item, batch)) < BENCH_SAMPLE_NS && batch < (1UL << 30))
+		batch = elapsed <= 0 ? batch * 16 : batch * (BENCH_SAMPLE_NS / elapsed) + 1;
+
+	for (i = 0; i < gl.warmup; i++)
+		bench_batch (item, batch);
+
+	samples = calloc (gl.samples, sizeof (double));
+	assert (samples != NULL);
+
+	for (i = 0, total = 0; i < gl.samples; i++) {
+		samples[i] = bench_batch (item, batch) / batch;
+		total += samples[i];
+	}
+
+	qsort (samples, gl.samples, sizeof (double), compar_double);
+
+	switch (gl.format) {
+	case FORMAT_JSON:
+		printf ("{\"name\": \"%s\", \"iterations\": %lu, \"mean_ns\": %.2f, "
+		        "\"min_ns\": %.2f, \"p50_ns\": %.2f, \"p90_ns\": %.2f, "
+		        "\"p99_ns\": %.2f, \"max_ns\": %.2f}\n",
+		        item->x.test.name, batch * gl.samples, total / gl.samples,
+		        samples[0], percentile (samples, gl.samples, 50),
+		        percentile (samples, gl.samples, 90),
+		        percentile (samples, gl.samples, 99), samples[gl.samples - 1]);
+		break;
+	case FORMAT_CSV:
+		printf ("%s,%lu,%.2f,%.2f,%.2f,%.2f,%.2f,%.2f\n",
+		        item->x.test.name, batch * gl.samples, total / gl.samples,
+		        samples[0], percentile (samples, gl.samples, 50),
+		        percentile (samples, gl.samples, 90),
+		        percentile (samples, gl.samples, 99), samples[gl.samples - 1]);
+		break;
+	default:
+		printf ("# %s: %.1f ns/op, p50 %.1f, p90 %.1f, p99 %.1f (%lu iterations)\n",
+		        item->x.test.name, total / gl.samples,
+		        percentile (samples, gl.samples, 50),
+		        percentile (samples, gl.samples, 90),
+		        percentile (samples, gl.samples, 99), batch * gl.samples);
+		break;
+	}
+
+	free (samples);
+}
+
 int
 p11_test_run (int argc,
               char **argv)
@@ -238,14 +368,51 @@ p11_test_run (int argc,
 	putenv ("P11_KIT_STRICT=1");
 	p11_debug_init ();
 
-	while ((opt = getopt (argc, argv, "")) != -1) {
+	gl.bench = false;
+	gl.format = FORMAT_TAP;
+	gl.samples = 30;
+	gl.warmup = 3;
+	gl.tap = stdout;
+
+	while ((opt = getopt (argc, argv, "bf:s:w:")) != -1) {
 		switch (opt) {
+		case 'b':
+			gl.bench = true;
+			break;
+		case 'f':
+			if (strcmp (optarg, "json") == 0)
+				gl.format = FORMAT_JSON;
+			else if (strcmp (optarg, "csv") == 0)
+				gl.format = FORMAT_CSV;
+			else if (strcmp (optarg, "tap") == 0)
+				gl.format = FORMAT_TAP;
+			else {
+				fprintf (stderr, "unknown benchmark format: %s\n", optarg);
+				return 2;
+			}
+			break;
+		case 's':
+			gl.samples = atoi (optarg);
+			break;
+		case 'w':
+			gl.warmup = atoi (optarg);
+			break;
 		default:
-			fprintf (stderr, "specify only test names on the command line\n");
+			fprintf (stderr, "usage: %s [-b] [-f tap|json|csv] [-s samples] [-w warmup] [test ...]\n",
+			         argv[0]);
 			return 2;
 		}
 	}
 
+	if (gl.samples < 1 || gl.warmup < 0) {
+		fprintf (stderr, "invalid number of benchmark samples\n");
+		return 2;
+	}
+
+	/* Machine readable benchmark results get stdout to themselves */
+	if (gl.bench && gl.format != FORMAT_TAP)
+		gl.tap = stderr;
+
 	argc -= optind;
 	argv += optind;
 
@@ -253,16 +420,19 @@ p11_test_run (int argc,
 	gl.last = NULL;
 
 	for (item = gl.suite, count = 0; item != NULL; item = item->next) {
-		if (item->type == TEST && should_run_test (argc, argv, item))
+		if (should_run_test (argc, argv, item))
 			count++;
 	}
 
 	if (count == 0) {
-		printf ("1..0 # No tests\n");
+		fprintf (gl.tap, "1..0 # No tests\n");
 		return 0;
 	}
 
-	printf ("1..%d\n", count);
+	fprintf (gl.tap, "1..%d\n", count);
+
+	if (gl.bench && gl.format == FORMAT_CSV)
+		printf ("name,iterations,mean_ns,min_ns,p50_ns,p90_ns,p99_ns,max_ns\n");
 
 	for (item = gl.suite, gl.number = 0; item != NULL; item = item->next) {
 		if (item->type == FIXTURE) {
@@ -270,8 +440,6 @@ p11_test_run (int argc,
 			continue;
 		}
 
-		assert (item->type == TEST);
-
 		if (!should_run_test (argc, argv, item))
 			continue;
 
@@ -288,7 +456,11 @@ p11_test_run (int argc,
 			assert (item->x.test.func);
 			(item->x.test.func)(item->x.test.argument);
 
-			printf ("ok %d %s\n", gl.number, item->x.test.name);
+			/* Otherwise a benchmark runs once as a test */
+			if (gl.bench)
+				bench_run (item);
+
+			fprintf (gl.tap, "ok %d %s\n", gl.number, item->x.test.name);
 		}
 
 		if (setup) {
@@ -302,7 +474,7 @@ p11_test_run (int argc,
 	}
 
 	for (item = gl.suite; item != NULL; item = next) {
-		if (item->type == TEST) {
+		if (item->type != FIXTURE) {
 			if (item->x.test.failed)
 				ret++;
 		}
@@ -122,6 +122,11 @@ void        p11_testx               (void (* function) (void *),
                                      const char *name,
                                      ...) GNUC_PRINTF(3, 4);
 
+void        p11_bench               (void (* function) (void *),
+                                     void *argument,
+                                     const char *name,
+                                     ...) GNUC_PRINTF(3, 4);
+
 void        p11_fixture             (void (* setup) (void *),
                                      void (* teardown) (void *));
 
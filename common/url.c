@@ -39,31 +39,84 @@
 #include "url.h"
 
 #include <assert.h>
-#include <ctype.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
 
 const static char HEX_CHARS[] = "0123456789abcdef";
 
-unsigned char *
-p11_url_decode (const char *value,
-                const char *end,
-                const char *skip,
-                size_t *length)
+/* Value of each hex digit, or -1 */
+static const signed char HEX_VALUES[256] = {
+	-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+	-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+	-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+	 0,  1,  2,  3,  4,  5,  6,  7,  8,  9, -1, -1, -1, -1, -1, -1,
+	-1, 10, 11, 12, 13, 14, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+	-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+	-1, 10, 11, 12, 13, 14, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+	-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+	-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+	-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+	-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+	-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+	-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+	-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+	-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+	-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+};
+
+/* Characters in P11_URL_VERBATIM */
+static const bool VERBATIM[256] = {
+	['a'] = 1, ['b'] = 1, ['c'] = 1, ['d'] = 1, ['e'] = 1, ['f'] = 1,
+	['g'] = 1, ['h'] = 1, ['i'] = 1, ['j'] = 1, ['k'] = 1, ['l'] = 1,
+	['m'] = 1, ['n'] = 1, ['o'] = 1, ['p'] = 1, ['q'] = 1, ['r'] = 1,
+	['s'] = 1, ['t'] = 1, ['u'] = 1, ['v'] = 1, ['w'] = 1, ['x'] = 1,
+	['y'] = 1, ['z'] = 1,
+	['A'] = 1, ['B'] = 1, ['C'] = 1, ['D'] = 1, ['E'] = 1, ['F'] = 1,
+	['G'] = 1, ['H'] = 1, ['I'] = 1, ['J'] = 1, ['K'] = 1, ['L'] = 1,
+	['M'] = 1, ['N'] = 1, ['O'] = 1, ['P'] = 1, ['Q'] = 1, ['R'] = 1,
+	['S'] = 1, ['T'] = 1, ['U'] = 1, ['V'] = 1, ['W'] = 1, ['X'] = 1,
+	['Y'] = 1, ['Z'] = 1,
+	['0'] = 1, ['1'] = 1, ['2'] = 1, ['3'] = 1, ['4'] = 1, ['5'] = 1,
+	['6'] = 1, ['7'] = 1, ['8'] = 1, ['9'] = 1,
+	['_'] = 1, ['-'] = 1, ['.'] = 1,
+};
+
+static const bool *
+character_table (const char *chars,
+                 bool *table)
+{
+	if (strcmp (chars, P11_URL_VERBATIM) == 0)
+		return VERBATIM;
+
+	memset (table, 0, 256 * sizeof (bool));
+	while (*chars)
+		table[(unsigned char)*(chars++)] = true;
+	return table;
+}
+
+bool
+p11_url_decode_to (const char *value,
+                   const char *end,
+                   const char *skip,
+                   unsigned char *result,
+                   size_t *length)
 {
-	char *a, *b;
-	unsigned char *result, *p;
+	bool skip_table[256];
+	const bool *skipping;
+	size_t max;
+	size_t len;
+	int a, b;
 
 	assert (value <= end);
 	assert (skip != NULL);
+	assert (length != NULL);
 
-	/* String can only get shorter */
-	result = malloc ((end - value) + 1);
-	return_val_if_fail (result != NULL, NULL);
+	skipping = character_table (skip, skip_table);
+	max = *length;
+	len = 0;
 
 	/* Now loop through looking for escapes */
-	p = result;
 	while (value != end) {
 		/*
 		 * A percent sign followed by two hex digits means
@@ -71,35 +124,61 @@ p11_url_decode (const char *value,
 		 */
 		if (*value == '%') {
 			value++;
-			if (value + 2 > end) {
-				free (result);
-				return NULL;
-			}
-			a = strchr (HEX_CHARS, tolower (value[0]));
-			b = strchr (HEX_CHARS, tolower (value[1]));
-			if (!a || !b) {
-				free (result);
-				return NULL;
-			}
-			*p = (a - HEX_CHARS) << 4;
-			*(p++) |= (b - HEX_CHARS);
+			if (value + 2 > end)
+				return false;
+			a = HEX_VALUES[(unsigned char)value[0]];
+			b = HEX_VALUES[(unsigned char)value[1]];
+			if (a < 0 || b < 0)
+				return false;
+			if (len < max)
+				result[len] = (a << 4) | b;
+			len++;
 			value += 2;
 
 		/* Ignore whitespace characters */
-		} else if (strchr (skip, *value)) {
+		} else if (*value == '\0' || skipping[(unsigned char)*value]) {
 			value++;
 
 		/* A different character */
 		} else {
-			*(p++) = *(value++);
+			if (len < max)
+				result[len] = *value;
+			len++;
+			value++;
 		}
 	}
 
+	*length = len;
+	return true;
+}
+
+unsigned char *
+p11_url_decode (const char *value,
+                const char *end,
+                const char *skip,
+                size_t *length)
+{
+	unsigned char *result;
+	size_t len;
+
+	assert (value <= end);
+	assert (skip != NULL);
+
+	/* String can only get shorter */
+	len = end - value;
+	result = malloc (len + 1);
+	return_val_if_fail (result != NULL, NULL);
+
+	if (!p11_url_decode_to (value, end, skip, result, &len)) {
+		free (result);
+		return NULL;
+	}
+
 	/* Null terminate string, in case its a string */
-	*p = 0;
+	result[len] = 0;
 
 	if (length)
-		*length = p - result;
+		*length = len;
 	return result;
 }
 
@@ -109,25 +188,36 @@ p11_url_encode (const unsigned char *value,
                 const char *verbatim,
                 p11_buffer *buf)
 {
-	char hex[3];
+	bool verbatim_table[256];
+	const bool *passing;
+	char chunk[256];
+	size_t at = 0;
 
 	assert (value <= end);
 
-	/* Now loop through looking for escapes */
+	passing = character_table (verbatim, verbatim_table);
+
+	/* Encode into a chunk at a time, rather than a character at a time */
 	while (value != end) {
+		if (at > sizeof (chunk) - 3) {
+			p11_buffer_add (buf, chunk, at);
+			at = 0;
+		}
 
 		/* These characters we let through verbatim */
-		if (*value && strchr (verbatim, *value) != NULL) {
-			p11_buffer_add (buf, value, 1);
+		if (passing[*value]) {
+			chunk[at++] = *value;
 
 		/* All others get encoded */
 		} else {
-			hex[0] = '%';
-			hex[1] = HEX_CHARS[((unsigned char)*value) >> 4];
-			hex[2] = HEX_CHARS[((unsigned char)*value) & 0x0F];
-			p11_buffer_add (buf, hex, 3);
+			chunk[at++] = '%';
+			chunk[at++] = HEX_CHARS[*value >> 4];
+			chunk[at++] = HEX_CHARS[*value & 0x0F];
 		}
 
 		++value;
 	}
+
+	if (at > 0)
+		p11_buffer_add (buf, chunk, at);
 }
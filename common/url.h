@@ -52,6 +52,12 @@ unsigned char *       p11_url_decode        (const char *value,
                                              const char *skip,
                                              size_t *length);
 
+bool                  p11_url_decode_to     (const char *value,
+                                             const char *end,
+                                             const char *skip,
+                                             unsigned char *result,
+                                             size_t *length);
+
 void                  p11_url_encode        (const unsigned char *value,
                                              const unsigned char *end,
                                              const char *verbatim,
@@ -0,0 +1,136 @@
+/*
+ * Copyright (c) 2016 Red Hat Inc
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *     * Redistributions of source code must retain the above
+ *       copyright notice, this list of conditions and the
+ *       following disclaimer.
+ *     * Redistributions in binary form must reproduce the
+ *       above copyright notice, this list of conditions and
+ *       the following disclaimer in the documentation and/or
+ *       other materials provided with the distribution.
+ *     * The names of contributors to this software may not be
+ *       used to endorse or promote products derived from this
+ *       software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+#include "config.h"
+#include "test.h"
+
+#include "library.h"
+#include "mock.h"
+#include "p11-kit.h"
+#include "pkcs11.h"
+#include "proxy.h"
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* This is the proxy module entry point in proxy.c, and linked to this program */
+CK_RV C_GetFunctionList (CK_FUNCTION_LIST_PTR_PTR list);
+
+static struct {
+	CK_FUNCTION_LIST_PTR proxy;
+	CK_SLOT_ID slot;
+	CK_SESSION_HANDLE session;
+} test;
+
+static void
+setup (void *unused)
+{
+	CK_SLOT_ID slots[32];
+	CK_ULONG count = 32;
+	CK_RV rv;
+
+	rv = C_GetFunctionList (&test.proxy);
+	assert (rv == CKR_OK);
+
+	rv = test.proxy->C_Initialize (NULL);
+	assert (rv == CKR_OK);
+
+	rv = test.proxy->C_GetSlotList (CK_TRUE, slots, &count);
+	assert (rv == CKR_OK);
+	assert_num_cmp (count, >=, 1);
+	test.slot = slots[0];
+
+	rv = test.proxy->C_OpenSession (test.slot, CKF_SERIAL_SESSION, NULL, NULL, &test.session);
+	assert (rv == CKR_OK);
+}
+
+static void
+teardown (void *unused)
+{
+	CK_RV rv;
+
+	rv = test.proxy->C_Finalize (NULL);
+	assert (rv == CKR_OK);
+	memset (&test, 0, sizeof (test));
+}
+
+static void
+bench_get_slot_list (void *unused)
+{
+	CK_SLOT_ID slots[32];
+	CK_ULONG count = 32;
+	CK_RV rv;
+
+	rv = test.proxy->C_GetSlotList (CK_TRUE, slots, &count);
+	assert (rv == CKR_OK);
+}
+
+static void
+bench_get_token_info (void *unused)
+{
+	CK_TOKEN_INFO info;
+	CK_RV rv;
+
+	rv = test.proxy->C_GetTokenInfo (test.slot, &info);
+	assert (rv == CKR_OK);
+}
+
+static void
+bench_get_attribute_value (void *unused)
+{
+	CK_OBJECT_CLASS klass;
+	char label[32];
+	CK_ATTRIBUTE attrs[] = {
+		{ CKA_CLASS, &klass, sizeof (klass) },
+		{ CKA_LABEL, label, sizeof (label) },
+	};
+	CK_RV rv;
+
+	rv = test.proxy->C_GetAttributeValue (test.session, MOCK_DATA_OBJECT, attrs, 2);
+	assert (rv == CKR_OK);
+}
+
+int
+main (int argc,
+      char *argv[])
+{
+	p11_library_init ();
+	p11_kit_be_quiet ();
+
+	p11_fixture (setup, teardown);
+	p11_bench (bench_get_slot_list, NULL, "/proxy/get-slot-list");
+	p11_bench (bench_get_token_info, NULL, "/proxy/get-token-info");
+	p11_bench (bench_get_attribute_value, NULL, "/proxy/get-attribute-value");
+
+	return p11_test_run (argc, argv);
+}
@@ -0,0 +1,218 @@
+/*
+ * Copyright (c) 2016 Red Hat Inc
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *     * Redistributions of source code must retain the above
+ *       copyright notice, this list of conditions and the
+ *       following disclaimer.
+ *     * Redistributions in binary form must reproduce the
+ *       above copyright notice, this list of conditions and
+ *       the following disclaimer in the documentation and/or
+ *       other materials provided with the distribution.
+ *     * The names of contributors to this software may not be
+ *       used to endorse or promote products derived from this
+ *       software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+#include "config.h"
+#include "test.h"
+
+#include "attrs.h"
+#include "iter.h"
+#include "library.h"
+#include "mock.h"
+#include "p11-kit.h"
+#include "rpc.h"
+#include "virtual.h"
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+static struct {
+	p11_virtual base;
+	CK_FUNCTION_LIST *module;
+	CK_SESSION_HANDLE session;
+} test;
+
+static CK_RV
+rpc_initialize (p11_rpc_client_vtable *vtable,
+                void *init_reserved)
+{
+	return CKR_OK;
+}
+
+static CK_RV
+rpc_transport (p11_rpc_client_vtable *vtable,
+               p11_buffer *request,
+               p11_buffer *response)
+{
+	/* In process, so this measures the marshalling alone */
+	if (!p11_rpc_server_handle (&test.base.funcs, request, response))
+		assert_not_reached ();
+	return CKR_OK;
+}
+
+static void
+rpc_finalize (p11_rpc_client_vtable *vtable,
+              void *fini_reserved)
+{
+}
+
+static p11_rpc_client_vtable vtable = {
+	"bench-rpc", rpc_initialize, rpc_transport, rpc_finalize
+};
+
+static void
+mixin_free (void *data)
+{
+	p11_virtual *mixin = data;
+	p11_virtual_uninit (mixin);
+	free (mixin);
+}
+
+static void
+setup (void *unused)
+{
+	mock_scale scale = { 1, 1000, 0, 0 };
+	p11_virtual *mixin;
+	CK_RV rv;
+
+	/* A generated token to iterate over, as well as the usual ones */
+	mock_module_scale (&scale);
+
+	p11_virtual_init (&test.base, &p11_virtual_base, &mock_module, NULL);
+
+	mixin = calloc (1, sizeof (p11_virtual));
+	assert (mixin != NULL);
+	if (!p11_rpc_client_init (mixin, &vtable))
+		assert_not_reached ();
+
+	test.module = p11_virtual_wrap (mixin, mixin_free);
+	assert_ptr_not_null (test.module);
+
+	rv = p11_kit_module_initialize (test.module);
+	mock_module_scale (NULL);
+	assert (rv == CKR_OK);
+
+	rv = (test.module->C_OpenSession) (MOCK_SLOT_ONE_ID, CKF_SERIAL_SESSION,
+	                                   NULL, NULL, &test.session);
+	assert (rv == CKR_OK);
+}
+
+static void
+teardown (void *unused)
+{
+	p11_kit_module_finalize (test.module);
+	p11_virtual_unwrap (test.module);
+	memset (&test, 0, sizeof (test));
+}
+
+static void
+bench_get_info (void *unused)
+{
+	CK_INFO info;
+	CK_RV rv;
+
+	rv = (test.module->C_GetInfo) (&info);
+	assert (rv == CKR_OK);
+}
+
+static void
+bench_get_attribute_value (void *unused)
+{
+	CK_OBJECT_CLASS klass;
+	char label[32];
+	CK_ATTRIBUTE attrs[] = {
+		{ CKA_CLASS, &klass, sizeof (klass) },
+		{ CKA_LABEL, label, sizeof (label) },
+	};
+	CK_RV rv;
+
+	rv = (test.module->C_GetAttributeValue) (test.session, MOCK_DATA_OBJECT, attrs, 2);
+	assert (rv == CKR_OK);
+}
+
+static void
+bench_find_objects (void *unused)
+{
+	CK_OBJECT_HANDLE objects[16];
+	CK_ULONG count;
+	CK_RV rv;
+
+	rv = (test.module->C_FindObjectsInit) (test.session, NULL, 0);
+	assert (rv == CKR_OK);
+	rv = (test.module->C_FindObjects) (test.session, objects, 16, &count);
+	assert (rv == CKR_OK);
+	rv = (test.module->C_FindObjectsFinal) (test.session);
+	assert (rv == CKR_OK);
+}
+
+static void
+bench_iterate (void *data)
+{
+	P11KitIterBehavior *behavior = data;
+	CK_ATTRIBUTE attrs[] = {
+		{ CKA_CLASS, NULL, 0 },
+		{ CKA_LABEL, NULL, 0 },
+		{ CKA_ID, NULL, 0 },
+	};
+	CK_ATTRIBUTE *template;
+	P11KitIter *iter;
+	int count = 0;
+	CK_RV rv;
+
+	template = p11_attrs_buildn (NULL, attrs, 3);
+	iter = p11_kit_iter_new (NULL, *behavior);
+	p11_kit_iter_begin_with (iter, test.module, MOCK_SLOT_SCALE_ID, 0);
+
+	while ((rv = p11_kit_iter_next (iter)) == CKR_OK) {
+		rv = p11_kit_iter_load_attributes (iter, template, 3);
+		assert (rv == CKR_OK);
+		count++;
+	}
+
+	assert (rv == CKR_CANCEL);
+	assert_num_eq (1000, count);
+
+	p11_kit_iter_free (iter);
+	p11_attrs_free (template);
+}
+
+int
+main (int argc,
+      char *argv[])
+{
+	P11KitIterBehavior preload = 0;
+	P11KitIterBehavior stream = P11_KIT_ITER_STREAM;
+	P11KitIterBehavior prefetch = P11_KIT_ITER_PREFETCH;
+
+	mock_module_init ();
+	p11_library_init ();
+
+	p11_fixture (setup, teardown);
+	p11_bench (bench_get_info, NULL, "/rpc/get-info");
+	p11_bench (bench_get_attribute_value, NULL, "/rpc/get-attribute-value");
+	p11_bench (bench_find_objects, NULL, "/rpc/find-objects");
+	p11_bench (bench_iterate, &preload, "/rpc/iterate-1000");
+	p11_bench (bench_iterate, &stream, "/rpc/iterate-1000-stream");
+	p11_bench (bench_iterate, &prefetch, "/rpc/iterate-1000-prefetch");
+
+	return p11_test_run (argc, argv);
+}
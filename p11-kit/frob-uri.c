@@ -0,0 +1,201 @@
+/*
+ * Copyright (c) 2016 Red Hat Inc
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *     * Redistributions of source code must retain the above
+ *       copyright notice, this list of conditions and the
+ *       following disclaimer.
+ *     * Redistributions in binary form must reproduce the
+ *       above copyright notice, this list of conditions and
+ *       the following disclaimer in the documentation and/or
+ *       other materials provided with the distribution.
+ *     * The names of contributors to this software may not be
+ *       used to endorse or promote products derived from this
+ *       software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+#include "config.h"
+
+#include "attrs.h"
+#include "compat.h"
+#include "library.h"
+#include "private.h"
+#include "uri.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * Measures parsing and formatting URIs, and matching a URI against
+ * many slots, tokens and objects the way the iterator does while it
+ * walks modules.
+ */
+
+static const char *sample =
+	"pkcs11:library-description=The%20Library;library-manufacturer=Snake%20Oil,%20Inc.;"
+	"model=1.0;manufacturer=Snake%20Oil,%20Inc.;serial=0123456789abcdef;"
+	"token=My%20Software%20Token;id=%69%95%3e%5c%f4%bd%ec%91;"
+	"object=my-certificate;type=cert";
+
+static double
+time_now (void)
+{
+	return p11_clock_ns ();
+}
+
+static void
+set_space_string (CK_UTF8CHAR_PTR buffer,
+                  CK_ULONG length,
+                  const char *string)
+{
+	size_t len = strlen (string);
+	assert (len <= length);
+	memset (buffer, ' ', length);
+	memcpy (buffer, string, len);
+}
+
+int
+main (int argc,
+      char *argv[])
+{
+	CK_OBJECT_CLASS klass = CKO_CERTIFICATE;
+	CK_TOKEN_INFO *tokens;
+	CK_SLOT_INFO *slots;
+	CK_ATTRIBUTE *objects;
+	p11_uri_match *match;
+	P11KitUri *uri;
+	char *formatted;
+	char string[256];
+	char label[32];
+	char *ids;
+	double start;
+	int matched;
+	int ret;
+	int count;
+	int rounds;
+	int i, j;
+
+	count = argc > 1 ? atoi (argv[1]) : 1000;
+	rounds = argc > 2 ? atoi (argv[2]) : 1000;
+	assert (count > 0 && rounds > 0);
+
+	p11_library_init ();
+
+	uri = p11_kit_uri_new ();
+	start = time_now ();
+	for (j = 0; j < rounds * 10; j++) {
+		ret = p11_kit_uri_parse (sample, P11_KIT_URI_FOR_ANY, uri);
+		assert (ret == P11_KIT_URI_OK);
+	}
+	printf ("%-24s %8.1f ns/uri\n", "parse", (time_now () - start) / rounds / 10);
+
+	start = time_now ();
+	for (j = 0; j < rounds * 10; j++) {
+		ret = p11_kit_uri_format (uri, P11_KIT_URI_FOR_ANY, &formatted);
+		assert (ret == P11_KIT_URI_OK);
+		free (formatted);
+	}
+	printf ("%-24s %8.1f ns/uri\n", "format", (time_now () - start) / rounds / 10);
+	p11_kit_uri_free (uri);
+
+	tokens = calloc (count, sizeof (CK_TOKEN_INFO));
+	slots = calloc (count, sizeof (CK_SLOT_INFO));
+	objects = calloc (count * 3, sizeof (CK_ATTRIBUTE));
+	ids = calloc (count, 16);
+	assert (tokens && slots && objects && ids);
+
+	/* Tokens from the same vendor, told apart by label and serial */
+	for (i = 0; i < count; i++) {
+		snprintf (label, sizeof (label), "Token %d", i);
+		set_space_string (tokens[i].label, sizeof (tokens[i].label), label);
+		set_space_string (tokens[i].manufacturerID, sizeof (tokens[i].manufacturerID), "Snake Oil, Inc.");
+		set_space_string (tokens[i].model, sizeof (tokens[i].model), "1.0");
+		snprintf (label, sizeof (label), "%016d", i);
+		memcpy (tokens[i].serialNumber, label, sizeof (tokens[i].serialNumber));
+		snprintf (label, sizeof (label), "Slot %d", i);
+		set_space_string (slots[i].slotDescription, sizeof (slots[i].slotDescription), label);
+		set_space_string (slots[i].manufacturerID, sizeof (slots[i].manufacturerID), "Snake Oil, Inc.");
+
+		snprintf (ids + i * 16, 16, "%07d", i);
+		objects[i * 3].type = CKA_CLASS;
+		objects[i * 3].pValue = &klass;
+		objects[i * 3].ulValueLen = sizeof (klass);
+		objects[i * 3 + 1].type = CKA_LABEL;
+		objects[i * 3 + 1].pValue = "My certificate";
+		objects[i * 3 + 1].ulValueLen = 14;
+		objects[i * 3 + 2].type = CKA_ID;
+		objects[i * 3 + 2].pValue = ids + i * 16;
+		objects[i * 3 + 2].ulValueLen = 7;
+	}
+
+	uri = p11_kit_uri_new ();
+	snprintf (string, sizeof (string), "pkcs11:token=Token%%20%d;manufacturer=Snake%%20Oil,%%20Inc.;"
+	          "object=My%%20certificate;type=cert;id=%07d", count - 1, count - 1);
+	ret = p11_kit_uri_parse (string, P11_KIT_URI_FOR_ANY, uri);
+	assert (ret == P11_KIT_URI_OK);
+
+	start = time_now ();
+	for (j = 0, matched = 0; j < rounds; j++) {
+		for (i = 0; i < count; i++) {
+			matched += p11_kit_uri_match_slot_info (uri, slots + i) &&
+			           p11_kit_uri_match_token_info (uri, tokens + i);
+		}
+	}
+	assert (matched == rounds);
+	printf ("%-24s %8.1f ns/token\n", "uri tokens", (time_now () - start) / rounds / count);
+
+	start = time_now ();
+	for (j = 0, matched = 0; j < rounds; j++) {
+		match = p11_uri_match_new (uri);
+		for (i = 0; i < count; i++) {
+			matched += p11_uri_match_slot (match, slots + i) &&
+			           p11_uri_match_token (match, tokens + i);
+		}
+		p11_uri_match_free (match);
+	}
+	assert (matched == rounds);
+	printf ("%-24s %8.1f ns/token\n", "compiled tokens", (time_now () - start) / rounds / count);
+
+	start = time_now ();
+	for (j = 0, matched = 0; j < rounds; j++) {
+		for (i = 0; i < count; i++)
+			matched += p11_kit_uri_match_attributes (uri, objects + i * 3, 3);
+	}
+	assert (matched == rounds);
+	printf ("%-24s %8.1f ns/object\n", "uri objects", (time_now () - start) / rounds / count);
+
+	start = time_now ();
+	for (j = 0, matched = 0; j < rounds; j++) {
+		match = p11_uri_match_new (uri);
+		for (i = 0; i < count; i++)
+			matched += p11_uri_match_attributes (match, objects + i * 3, 3);
+		p11_uri_match_free (match);
+	}
+	assert (matched == rounds);
+	printf ("%-24s %8.1f ns/object\n", "compiled objects", (time_now () - start) / rounds / count);
+
+	p11_kit_uri_free (uri);
+	free (tokens);
+	free (slots);
+	free (objects);
+	free (ids);
+	return 0;
+}
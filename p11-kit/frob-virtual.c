@@ -0,0 +1,179 @@
+/*
+ * Copyright (c) 2016 Red Hat Inc
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *     * Redistributions of source code must retain the above
+ *       copyright notice, this list of conditions and the
+ *       following disclaimer.
+ *     * Redistributions in binary form must reproduce the
+ *       above copyright notice, this list of conditions and
+ *       the following disclaimer in the documentation and/or
+ *       other materials provided with the distribution.
+ *     * The names of contributors to this software may not be
+ *       used to endorse or promote products derived from this
+ *       software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+#include "config.h"
+
+#include "compat.h"
+#include "library.h"
+#include "log.h"
+#include "mock.h"
+#include "modules.h"
+#include "p11-kit.h"
+#include "virtual.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+/*
+ * Measures the cost of a C_GetAttributeValue call through the
+ * various ways that a module can be stacked.
+ */
+
+static double
+time_now (void)
+{
+	return p11_clock_ns ();
+}
+
+static void
+bench_module (const char *name,
+              CK_FUNCTION_LIST *module,
+              int iterations)
+{
+	CK_OBJECT_CLASS klass;
+	CK_ATTRIBUTE attr = { CKA_CLASS, &klass, sizeof (klass) };
+	CK_SESSION_HANDLE session;
+	double start;
+	CK_RV rv;
+	int i;
+
+	rv = (module->C_OpenSession) (MOCK_SLOT_ONE_ID, CKF_SERIAL_SESSION, NULL, NULL, &session);
+	assert (rv == CKR_OK);
+
+	start = time_now ();
+	for (i = 0; i < iterations; i++) {
+		rv = (module->C_GetAttributeValue) (session, MOCK_PUBLIC_KEY_CAPITALIZE, &attr, 1);
+		assert (rv == CKR_OK);
+	}
+
+	printf ("%-24s %8.1f ns/call\n", name, (time_now () - start) / iterations);
+
+	rv = (module->C_CloseSession) (session);
+	assert (rv == CKR_OK);
+}
+
+static void
+bench_virtual (const char *name,
+               p11_virtual *virt,
+               int iterations)
+{
+	CK_OBJECT_CLASS klass;
+	CK_ATTRIBUTE attr = { CKA_CLASS, &klass, sizeof (klass) };
+	CK_X_FUNCTION_LIST *funcs = &virt->funcs;
+	CK_SESSION_HANDLE session;
+	double start;
+	CK_RV rv;
+	int i;
+
+	rv = (funcs->C_OpenSession) (funcs, MOCK_SLOT_ONE_ID, CKF_SERIAL_SESSION, NULL, NULL, &session);
+	assert (rv == CKR_OK);
+
+	start = time_now ();
+	for (i = 0; i < iterations; i++) {
+		rv = (funcs->C_GetAttributeValue) (funcs, session, MOCK_PUBLIC_KEY_CAPITALIZE, &attr, 1);
+		assert (rv == CKR_OK);
+	}
+
+	printf ("%-24s %8.1f ns/call\n", name, (time_now () - start) / iterations);
+
+	rv = (funcs->C_CloseSession) (funcs, session);
+	assert (rv == CKR_OK);
+}
+
+static void
+bench_managed (const char *name,
+               int iterations)
+{
+	CK_FUNCTION_LIST *module;
+	CK_RV rv;
+
+	p11_lock ();
+	rv = p11_module_load_inlock_reentrant (&mock_module, 0, &module);
+	assert (rv == CKR_OK);
+	p11_unlock ();
+
+	rv = p11_kit_module_initialize (module);
+	assert (rv == CKR_OK);
+
+	bench_module (name, module, iterations);
+
+	rv = p11_kit_module_finalize (module);
+	assert (rv == CKR_OK);
+
+	p11_lock ();
+	rv = p11_module_release_inlock_reentrant (module);
+	assert (rv == CKR_OK);
+	p11_unlock ();
+}
+
+int
+main (int argc,
+      char *argv[])
+{
+	p11_virtual middle;
+	p11_virtual upper;
+	p11_virtual base;
+	int iterations;
+	CK_RV rv;
+
+	iterations = argc > 1 ? atoi (argv[1]) : 1000000;
+	assert (iterations > 0);
+
+	p11_library_init ();
+	mock_module_init ();
+
+	rv = (mock_module.C_Initialize) (NULL);
+	assert (rv == CKR_OK);
+
+	bench_module ("module", &mock_module, iterations);
+
+	p11_virtual_init (&base, &p11_virtual_base, &mock_module, NULL);
+	p11_virtual_init (&middle, &p11_virtual_stack, &base, NULL);
+	p11_virtual_init (&upper, &p11_virtual_stack, &middle, NULL);
+	bench_virtual ("stack", &upper, iterations);
+
+	p11_virtual_compile (&upper);
+	bench_virtual ("stack compiled", &upper, iterations);
+
+	rv = (mock_module.C_Finalize) (NULL);
+	assert (rv == CKR_OK);
+
+	bench_managed ("managed", iterations);
+
+	/* The full stack of a managed module with logging */
+	p11_log_force = true;
+	p11_log_output = false;
+	bench_managed ("managed and logged", iterations);
+
+	return 0;
+}
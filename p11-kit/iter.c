@@ -36,15 +36,21 @@
 
 #include "array.h"
 #include "attrs.h"
+#include "compat.h"
 #include "debug.h"
 #include "iter.h"
+#include "modules.h"
 #include "pin.h"
 #include "private.h"
+#include "rpc.h"
 
 #include <assert.h>
 #include <stdlib.h>
 #include <string.h>
 
+/* How many object handles are held at a time when streaming */
+#define STREAM_WINDOW 256
+
 typedef struct _Callback {
 	p11_kit_iter_callback func;
 	void *callback_data;
@@ -52,6 +58,31 @@ typedef struct _Callback {
 	struct _Callback *next;
 } Callback;
 
+/* The objects found on one slot by a Worker */
+typedef struct {
+	CK_FUNCTION_LIST_PTR module;
+	CK_SLOT_ID slot;
+	CK_SLOT_INFO slot_info;
+	CK_TOKEN_INFO token_info;
+	CK_SESSION_HANDLE session;
+	CK_OBJECT_HANDLE *objects;
+	CK_ULONG num_objects;
+} Found;
+
+/* Searches the slots of one module, see P11_KIT_ITER_PARALLEL */
+typedef struct {
+	P11KitIter *iter;
+	CK_FUNCTION_LIST_PTR module;
+	p11_thread_t thread;
+	p11_array *found;         /* Slots searched, not yet taken */
+	CK_RV rv;
+	int done;
+	unsigned int running : 1;
+} Worker;
+
+/* How many searched slots a worker holds on to, with their sessions */
+#define WORKER_AHEAD 2
+
 /**
  * P11KitIter:
  *
@@ -60,11 +91,8 @@ typedef struct _Callback {
 struct p11_kit_iter {
 
 	/* Iterator matching data */
-	CK_INFO match_module;
-	CK_SLOT_INFO match_slot;
-	CK_TOKEN_INFO match_token;
+	p11_uri_match *match;
 	CK_ATTRIBUTE *match_attrs;
-	CK_SLOT_ID match_slot_id;
 	Callback *callbacks;
 
 	/* The input modules */
@@ -81,10 +109,29 @@ struct p11_kit_iter {
 	CK_ULONG num_objects;
 	CK_ULONG saw_objects;
 
+	/* The next C_FindObjects results, found on a thread kept for the iterator */
+	CK_OBJECT_HANDLE *prefetched;
+	CK_ULONG num_prefetched;
+	CK_RV prefetch_rv;
+	p11_thread_t prefetch_thread;
+	p11_mutex_t prefetch_lock;   /* Held while using the flags below */
+	p11_cond_t prefetch_cond;    /* A window handed over or done, or quit */
+	int prefetch_window;
+	int prefetch_quit;
+
+	/* A worker for each module, when iterating in parallel */
+	Worker **workers;
+	int num_workers;
+	int saw_workers;
+	int cancel;
+	p11_mutex_t found_lock;   /* Held while using found or done of workers */
+	p11_cond_t found_cond;    /* Slot found or taken, worker done, or cancel */
+
 	/* The current iteration */
 	CK_FUNCTION_LIST_PTR module;
 	CK_SLOT_ID slot;
 	CK_SESSION_HANDLE session;
+	CK_SESSION_HANDLE search;
 	CK_OBJECT_HANDLE object;
 	CK_SLOT_INFO slot_info;
 	CK_TOKEN_INFO token_info;
@@ -97,6 +144,12 @@ struct p11_kit_iter {
 	unsigned int keep_session : 1;
 	unsigned int preload_results : 1;
 	unsigned int want_writable : 1;
+	unsigned int stream : 1;
+	unsigned int prefetch : 1;
+	unsigned int prefetching : 1;
+	unsigned int prefetch_running : 1;
+	unsigned int parallel : 1;
+	unsigned int unordered : 1;
 };
 
 /**
@@ -105,6 +158,22 @@ struct p11_kit_iter {
  *   in a busy state when the iterator returns an object.
  * @P11_KIT_ITER_WANT_WRITABLE: Try to open read-write sessions when
  *   iterating over obojects.
+ * @P11_KIT_ITER_STREAM: Return objects as they are found, holding a fixed
+ *   number of object handles at a time. Unless
+ *   %P11_KIT_ITER_BUSY_SESSIONS is set, the search runs on a second session,
+ *   so that the session returned with each object is not busy.
+ * @P11_KIT_ITER_PREFETCH: Stream objects as %P11_KIT_ITER_STREAM does, and
+ *   find the next objects on another thread while the current ones are
+ *   returned. The modules must allow calls from several threads.
+ * @P11_KIT_ITER_PARALLEL: Search all the modules at the same time, each on
+ *   its own thread. The objects on a slot are returned once all of them are
+ *   found, in the same order as without this flag, while the next slots are
+ *   searched. Callbacks are still called on the thread calling
+ *   p11_kit_iter_next(). The modules must allow calls from several threads.
+ *   %P11_KIT_ITER_STREAM and %P11_KIT_ITER_PREFETCH have no effect along
+ *   with this flag.
+ * @P11_KIT_ITER_UNORDERED: Search in parallel as %P11_KIT_ITER_PARALLEL
+ *   does, but return the objects of whichever slot is searched first.
  *
  * Various flags controlling the behavior of the iterator.
  */
@@ -137,8 +206,17 @@ p11_kit_iter_new (P11KitUri *uri,
 	iter->modules = p11_array_new (NULL);
 	return_val_if_fail (iter->modules != NULL, NULL);
 
+	p11_mutex_init (&iter->found_lock);
+	p11_cond_init (&iter->found_cond);
+	p11_mutex_init (&iter->prefetch_lock);
+	p11_cond_init (&iter->prefetch_cond);
+
 	iter->want_writable = !!(behavior & P11_KIT_ITER_WANT_WRITABLE);
 	iter->preload_results = !(behavior & P11_KIT_ITER_BUSY_SESSIONS);
+	iter->prefetch = !!(behavior & P11_KIT_ITER_PREFETCH);
+	iter->stream = iter->prefetch || (behavior & P11_KIT_ITER_STREAM);
+	iter->unordered = !!(behavior & P11_KIT_ITER_UNORDERED);
+	iter->parallel = iter->unordered || (behavior & P11_KIT_ITER_PARALLEL);
 
 	p11_kit_iter_set_uri (iter, uri);
 	return iter;
@@ -166,42 +244,20 @@ p11_kit_iter_set_uri (P11KitIter *iter,
                       P11KitUri *uri)
 {
 	CK_ATTRIBUTE *attrs;
-	CK_TOKEN_INFO *tinfo;
-	CK_SLOT_INFO *sinfo;
-	CK_INFO *minfo;
 	CK_ULONG count;
 
 	return_if_fail (iter != NULL);
 
-	if (uri != NULL) {
-
-		if (p11_kit_uri_any_unrecognized (uri)) {
-			iter->match_nothing = 1;
-
-		} else {
-			attrs = p11_kit_uri_get_attributes (uri, &count);
-			iter->match_attrs = p11_attrs_buildn (NULL, attrs, count);
-
-			iter->match_slot_id = p11_kit_uri_get_slot_id (uri);
-
-			minfo = p11_kit_uri_get_module_info (uri);
-			if (minfo != NULL)
-				memcpy (&iter->match_module, minfo, sizeof (CK_INFO));
+	p11_uri_match_free (iter->match);
+	iter->match = p11_uri_match_new (uri);
+	return_if_fail (iter->match != NULL);
 
-			sinfo = p11_kit_uri_get_slot_info (uri);
-			if (sinfo != NULL)
-				memcpy (&iter->match_slot, sinfo, sizeof (CK_SLOT_INFO));
+	if (p11_uri_match_nothing (iter->match)) {
+		iter->match_nothing = 1;
 
-			tinfo = p11_kit_uri_get_token_info (uri);
-			if (tinfo != NULL)
-				memcpy (&iter->match_token, tinfo, sizeof (CK_TOKEN_INFO));
-		}
-	} else {
-		/* Match any module version number and slot ID */
-		memset (&iter->match_module, 0, sizeof (iter->match_module));
-		iter->match_module.libraryVersion.major = (CK_BYTE)-1;
-		iter->match_module.libraryVersion.minor = (CK_BYTE)-1;
-		iter->match_slot_id = (CK_SLOT_ID)-1;
+	} else if (uri != NULL) {
+		attrs = p11_kit_uri_get_attributes (uri, &count);
+		iter->match_attrs = p11_attrs_buildn (NULL, attrs, count);
 	}
 }
 
@@ -301,9 +357,42 @@ finish_object (P11KitIter *iter)
 	iter->object = 0;
 }
 
+/* Waits until the window handed to the prefetch thread is done */
+static void
+finish_prefetch (P11KitIter *iter)
+{
+	if (iter->prefetching) {
+		p11_mutex_lock (&iter->prefetch_lock);
+		while (iter->prefetch_window)
+			p11_cond_wait (&iter->prefetch_cond, &iter->prefetch_lock);
+		p11_mutex_unlock (&iter->prefetch_lock);
+		iter->prefetching = 0;
+	}
+}
+
+static void
+stop_prefetch (P11KitIter *iter)
+{
+	if (iter->prefetch_running) {
+		p11_mutex_lock (&iter->prefetch_lock);
+		iter->prefetch_quit = 1;
+		p11_cond_broadcast (&iter->prefetch_cond);
+		p11_mutex_unlock (&iter->prefetch_lock);
+		p11_thread_join (iter->prefetch_thread);
+		iter->prefetch_running = 0;
+	}
+}
+
 static void
 finish_slot (P11KitIter *iter)
 {
+	finish_prefetch (iter);
+
+	if (iter->search && iter->search != iter->session) {
+		assert (iter->module != NULL);
+		(iter->module->C_CloseSession) (iter->search);
+	}
+
 	if (iter->session && !iter->keep_session) {
 		assert (iter->module != NULL);
 		(iter->module->C_CloseSession) (iter->session);
@@ -311,6 +400,9 @@ finish_slot (P11KitIter *iter)
 
 	iter->keep_session = 0;
 	iter->session = 0;
+	iter->search = 0;
+	iter->num_objects = 0;
+	iter->saw_objects = 0;
 	iter->searched = 0;
 	iter->searching = 0;
 	iter->slot = 0;
@@ -324,6 +416,33 @@ finish_module (P11KitIter *iter)
 	iter->module = NULL;
 }
 
+static void
+finish_workers (P11KitIter *iter)
+{
+	Worker *worker;
+	int i;
+
+	/* Workers stop at the next slot, or the next batch of objects */
+	p11_mutex_lock (&iter->found_lock);
+	p11_atomic_store (&iter->cancel, 1, RELAXED);
+	p11_cond_broadcast (&iter->found_cond);
+	p11_mutex_unlock (&iter->found_lock);
+
+	for (i = 0; i < iter->num_workers; i++) {
+		worker = iter->workers[i];
+		if (worker->running)
+			p11_thread_join (worker->thread);
+		p11_array_free (worker->found);
+		free (worker);
+	}
+
+	free (iter->workers);
+	iter->workers = NULL;
+	iter->num_workers = 0;
+	iter->saw_workers = 0;
+	iter->cancel = 0;
+}
+
 static CK_RV
 finish_iterating (P11KitIter *iter,
                   CK_RV rv)
@@ -331,6 +450,7 @@ finish_iterating (P11KitIter *iter,
 	finish_object (iter);
 	finish_slot (iter);
 	finish_module (iter);
+	finish_workers (iter);
 	p11_array_clear (iter->modules);
 
 	iter->iterating = 0;
@@ -417,6 +537,7 @@ p11_kit_iter_begin_with (P11KitIter *iter,
 
 		/* So initialize as if we're ready to search */
 		iter->session = session;
+		iter->search = session;
 		iter->slot = slot;
 		iter->module = module;
 		iter->keep_session = 1;
@@ -470,79 +591,606 @@ call_all_filters (P11KitIter *iter,
 	return CKR_OK;
 }
 
+static void
+open_search_session (P11KitIter *iter)
+{
+	CK_RV rv;
+
+	iter->search = iter->session;
+
+	/*
+	 * Without busy sessions the objects are all found before any are
+	 * returned. When streaming, search on a second session instead, so
+	 * the one returned with the objects stays free for the caller.
+	 */
+	if (!iter->stream || !iter->preload_results)
+		return;
+
+	rv = (iter->module->C_OpenSession) (iter->slot, CKF_SERIAL_SESSION,
+	                                    NULL, NULL, &iter->search);
+	if (rv != CKR_OK || iter->search == 0)
+		iter->search = iter->session;
+}
+
+static bool
+match_module (P11KitIter *iter,
+              CK_FUNCTION_LIST_PTR module)
+{
+	CK_INFO minfo;
+	CK_RV rv;
+
+	if (p11_uri_match_any_module (iter->match))
+		return true;
+
+	rv = (module->C_GetInfo) (&minfo);
+	return rv == CKR_OK && p11_uri_match_module (iter->match, &minfo);
+}
+
+/*
+ * Open a session on the slot, if it matches. Otherwise the session is
+ * set to zero, and the slot should be skipped.
+ */
 static CK_RV
-move_next_session (P11KitIter *iter)
+open_slot_session (P11KitIter *iter,
+                   CK_FUNCTION_LIST_PTR module,
+                   CK_SLOT_ID slot,
+                   CK_SLOT_INFO *slot_info,
+                   CK_TOKEN_INFO *token_info,
+                   CK_SESSION_HANDLE *session)
 {
 	CK_ULONG session_flags;
-	CK_ULONG num_slots;
-	CK_INFO minfo;
 	CK_RV rv;
 
-	finish_slot (iter);
+	*session = 0;
 
-	/* If we have no more slots, then move to next module */
-	while (iter->saw_slots >= iter->num_slots) {
-		finish_module (iter);
+	if (!p11_uri_match_slot_id (iter->match, slot))
+		return CKR_OK;
+	rv = (module->C_GetSlotInfo) (slot, slot_info);
+	if (rv != CKR_OK || !p11_uri_match_slot (iter->match, slot_info))
+		return CKR_OK;
+	rv = (module->C_GetTokenInfo) (slot, token_info);
+	if (rv != CKR_OK || !p11_uri_match_token (iter->match, token_info))
+		return CKR_OK;
 
-		/* Iter is finished */
-		if (iter->modules->num == 0)
-			return finish_iterating (iter, CKR_CANCEL);
+	session_flags = CKF_SERIAL_SESSION;
 
-		iter->module = iter->modules->elem[0];
-		p11_array_remove (iter->modules, 0);
+	/* Skip if the read/write on a read-only token */
+	if (iter->want_writable && (token_info->flags & CKF_WRITE_PROTECTED) == 0)
+		session_flags |= CKF_RW_SESSION;
 
-		/* Skip module if it doesn't match uri */
-		assert (iter->module != NULL);
-		rv = (iter->module->C_GetInfo) (&minfo);
-		if (rv != CKR_OK || !p11_match_uri_module_info (&iter->match_module, &minfo))
-			continue;
+	return (module->C_OpenSession) (slot, session_flags, NULL, NULL, session);
+}
 
-		rv = (iter->module->C_GetSlotList) (CK_TRUE, NULL, &num_slots);
-		if (rv != CKR_OK)
-			return finish_iterating (iter, rv);
+static bool
+cancelled (P11KitIter *iter)
+{
+	return p11_atomic_load (&iter->cancel, RELAXED);
+}
 
-		iter->slots = realloc (iter->slots, sizeof (CK_SLOT_ID) * (num_slots + 1));
-		return_val_if_fail (iter->slots != NULL, CKR_HOST_MEMORY);
+static CK_RV
+find_all_objects (P11KitIter *iter,
+                  Found *found)
+{
+	CK_FUNCTION_LIST_PTR module = found->module;
+	CK_OBJECT_HANDLE *objects;
+	CK_ULONG max_objects = 0;
+	CK_ULONG count;
+	CK_RV rv;
+
+	rv = (module->C_FindObjectsInit) (found->session, iter->match_attrs,
+	                                  p11_attrs_count (iter->match_attrs));
+	if (rv != CKR_OK)
+		return rv;
 
-		rv = (iter->module->C_GetSlotList) (CK_TRUE, iter->slots, &num_slots);
+	do {
+		if (found->num_objects == max_objects) {
+			max_objects = max_objects ? max_objects * 2 : 64;
+			objects = realloc (found->objects, max_objects * sizeof (CK_OBJECT_HANDLE));
+			return_val_if_fail (objects != NULL, CKR_HOST_MEMORY);
+			found->objects = objects;
+		}
+
+		rv = (module->C_FindObjects) (found->session,
+		                              found->objects + found->num_objects,
+		                              max_objects - found->num_objects, &count);
 		if (rv != CKR_OK)
-			return finish_iterating (iter, rv);
+			return rv;
+
+		found->num_objects += count;
+	} while (found->num_objects == max_objects && !cancelled (iter));
 
-		iter->num_slots = num_slots;
-		assert (iter->saw_slots == 0);
+	(module->C_FindObjectsFinal) (found->session);
+	return CKR_OK;
+}
+
+static void
+free_found (void *data)
+{
+	Found *found = data;
+
+	if (!found)
+		return;
+	if (found->session)
+		(found->module->C_CloseSession) (found->session);
+	free (found->objects);
+	free (found);
+}
+
+/*
+ * Runs on its own thread. Only reads the matching data of the iterator,
+ * which doesn't change while iterating.
+ */
+static void *
+search_module (void *data)
+{
+	Worker *worker = data;
+	P11KitIter *iter = worker->iter;
+	CK_FUNCTION_LIST_PTR module = worker->module;
+	CK_SLOT_ID *slots = NULL;
+	CK_ULONG num_slots = 0;
+	Found *found;
+	CK_ULONG i;
+	CK_RV rv = CKR_OK;
+
+	if (match_module (iter, module)) {
+		rv = (module->C_GetSlotList) (CK_TRUE, NULL, &num_slots);
+		if (rv == CKR_OK) {
+			slots = calloc (num_slots + 1, sizeof (CK_SLOT_ID));
+			if (slots == NULL)
+				rv = CKR_HOST_MEMORY;
+			else
+				rv = (module->C_GetSlotList) (CK_TRUE, slots, &num_slots);
+		}
 	}
 
-	/* Move to the next slot, and open a session on it */
-	while (iter->saw_slots < iter->num_slots) {
-		iter->slot = iter->slots[iter->saw_slots++];
+	for (i = 0; rv == CKR_OK && i < num_slots; i++) {
 
-		assert (iter->module != NULL);
-		if (iter->match_slot_id != (CK_SLOT_ID)-1 && iter->slot != iter->match_slot_id)
-			continue;
-		rv = (iter->module->C_GetSlotInfo) (iter->slot, &iter->slot_info);
-		if (rv != CKR_OK || !p11_match_uri_slot_info (&iter->match_slot, &iter->slot_info))
+		/* Wait until the iterator takes a slot, or cancels */
+		p11_mutex_lock (&iter->found_lock);
+		while (worker->running && !cancelled (iter) && worker->found->num >= WORKER_AHEAD)
+			p11_cond_wait (&iter->found_cond, &iter->found_lock);
+		p11_mutex_unlock (&iter->found_lock);
+		if (cancelled (iter))
+			break;
+
+		found = calloc (1, sizeof (Found));
+		if (found == NULL) {
+			rv = CKR_HOST_MEMORY;
+			break;
+		}
+
+		found->module = module;
+		found->slot = slots[i];
+		rv = open_slot_session (iter, module, found->slot, &found->slot_info,
+		                        &found->token_info, &found->session);
+		if (rv == CKR_OK && found->session != 0)
+			rv = find_all_objects (iter, found);
+
+		if (rv != CKR_OK || found->session == 0) {
+			free_found (found);
 			continue;
-		rv = (iter->module->C_GetTokenInfo) (iter->slot, &iter->token_info);
-		if (rv != CKR_OK || !p11_match_uri_token_info (&iter->match_token, &iter->token_info))
+		}
+
+		/* Ready to be returned, while the next slot is searched */
+		p11_mutex_lock (&iter->found_lock);
+		if (!p11_array_push (worker->found, found))
+			rv = CKR_HOST_MEMORY;
+		p11_cond_broadcast (&iter->found_cond);
+		p11_mutex_unlock (&iter->found_lock);
+	}
+
+	free (slots);
+
+	p11_mutex_lock (&iter->found_lock);
+	worker->rv = rv;
+	worker->done = 1;
+	p11_cond_broadcast (&iter->found_cond);
+	p11_mutex_unlock (&iter->found_lock);
+	return NULL;
+}
+
+static CK_RV
+start_workers (P11KitIter *iter)
+{
+	Worker *worker;
+	unsigned int i;
+
+	iter->workers = calloc (iter->modules->num, sizeof (Worker *));
+	return_val_if_fail (iter->workers != NULL, CKR_HOST_MEMORY);
+
+	for (i = 0; i < iter->modules->num; i++) {
+		worker = calloc (1, sizeof (Worker));
+		return_val_if_fail (worker != NULL, CKR_HOST_MEMORY);
+		iter->workers[iter->num_workers++] = worker;
+		worker->iter = iter;
+		worker->module = iter->modules->elem[i];
+		worker->found = p11_array_new (free_found);
+		return_val_if_fail (worker->found != NULL, CKR_HOST_MEMORY);
+
+		/* If there's no thread, search here as the results are needed */
+		worker->running = 1;
+		if (p11_thread_create (&worker->thread, search_module, worker) != 0) {
+			worker->running = 0;
+			search_module (worker);
+		}
+	}
+
+	p11_array_clear (iter->modules);
+	return CKR_OK;
+}
+
+/* Called with found_lock held */
+static Found *
+take_found (P11KitIter *iter,
+            Worker *worker)
+{
+	Found *found = NULL;
+
+	if (worker->found->num > 0) {
+		found = worker->found->elem[0];
+		worker->found->elem[0] = NULL;
+		p11_array_remove (worker->found, 0);
+
+		/* The worker has room to search another slot */
+		p11_cond_broadcast (&iter->found_cond);
+	}
+
+	return found;
+}
+
+/*
+ * Wait for the next searched slot. In order, that comes from the first
+ * worker that isn't finished, otherwise from any worker.
+ */
+static CK_RV
+wait_for_found (P11KitIter *iter,
+                Found **found)
+{
+	Worker *worker = NULL;
+	CK_RV rv = CKR_OK;
+	int last;
+	int i;
+
+	p11_mutex_lock (&iter->found_lock);
+
+	while (rv == CKR_OK) {
+		if (iter->saw_workers >= iter->num_workers) {
+			rv = CKR_CANCEL;
+			break;
+		}
+
+		last = iter->unordered ? iter->num_workers : iter->saw_workers + 1;
+		for (i = iter->saw_workers; i < last; i++) {
+			worker = iter->workers[i];
+			*found = take_found (iter, worker);
+			if (*found || worker->done)
+				break;
+		}
+
+		if (*found)
+			break;
+
+		/* Nothing found yet, and none of these workers finished */
+		if (i == last) {
+			p11_cond_wait (&iter->found_cond, &iter->found_lock);
 			continue;
+		}
+
+		/* This worker is finished, move it out of the way */
+		iter->workers[i] = iter->workers[iter->saw_workers];
+		iter->workers[iter->saw_workers++] = worker;
+		if (worker->running) {
+			p11_thread_join (worker->thread);
+			worker->running = 0;
+		}
+
+		/* Errors come after the slots found before them, as when in sequence */
+		rv = worker->rv;
+	}
 
-		session_flags = CKF_SERIAL_SESSION;
+	p11_mutex_unlock (&iter->found_lock);
+	return rv;
+}
+
+/*
+ * Move on to the objects that a worker found on the next slot.
+ */
+static CK_RV
+move_next_found (P11KitIter *iter)
+{
+	Found *found;
+	CK_RV rv;
 
-		/* Skip if the read/write on a read-only token */
-		if (iter->want_writable && (iter->token_info.flags & CKF_WRITE_PROTECTED) == 0)
-			session_flags |= CKF_RW_SESSION;
+	finish_slot (iter);
 
-		rv = (iter->module->C_OpenSession) (iter->slot, session_flags,
-		                                    NULL, NULL, &iter->session);
+	if (iter->workers == NULL) {
+		rv = start_workers (iter);
 		if (rv != CKR_OK)
 			return finish_iterating (iter, rv);
+	}
 
-		if (iter->session != 0)
-			return CKR_OK;
+	rv = wait_for_found (iter, &found);
+	if (rv != CKR_OK)
+		return finish_iterating (iter, rv);
+
+	iter->module = found->module;
+	iter->slot = found->slot;
+	memcpy (&iter->slot_info, &found->slot_info, sizeof (CK_SLOT_INFO));
+	memcpy (&iter->token_info, &found->token_info, sizeof (CK_TOKEN_INFO));
+
+	/* The iterator owns the session and objects now */
+	iter->session = iter->search = found->session;
+	found->session = 0;
+	free (iter->objects);
+	iter->objects = found->objects;
+	iter->max_objects = iter->num_objects = found->num_objects;
+	found->objects = NULL;
+	free_found (found);
+
+	iter->searched = 1;
+	return CKR_OK;
+}
+
+static CK_RV
+move_next_session (P11KitIter *iter)
+{
+	CK_ULONG num_slots;
+	CK_RV rv;
+
+	if (iter->parallel && iter->saw_slots >= iter->num_slots &&
+	    (iter->workers || iter->modules->num > 0))
+		return move_next_found (iter);
+
+	for (;;) {
+		finish_slot (iter);
+
+		/* If we have no more slots, then move to next module */
+		while (iter->saw_slots >= iter->num_slots) {
+			finish_module (iter);
+
+			/* Iter is finished */
+			if (iter->modules->num == 0)
+				return finish_iterating (iter, CKR_CANCEL);
+
+			iter->module = iter->modules->elem[0];
+			p11_array_remove (iter->modules, 0);
+
+			/* Skip module if it doesn't match uri */
+			assert (iter->module != NULL);
+			if (!match_module (iter, iter->module))
+				continue;
+
+			rv = (iter->module->C_GetSlotList) (CK_TRUE, NULL, &num_slots);
+			if (rv != CKR_OK)
+				return finish_iterating (iter, rv);
+
+			iter->slots = realloc (iter->slots, sizeof (CK_SLOT_ID) * (num_slots + 1));
+			return_val_if_fail (iter->slots != NULL, CKR_HOST_MEMORY);
+
+			rv = (iter->module->C_GetSlotList) (CK_TRUE, iter->slots, &num_slots);
+			if (rv != CKR_OK)
+				return finish_iterating (iter, rv);
+
+			iter->num_slots = num_slots;
+			assert (iter->saw_slots == 0);
+		}
+
+		/* Move to the next slot, and open a session on it */
+		while (iter->saw_slots < iter->num_slots) {
+			iter->slot = iter->slots[iter->saw_slots++];
+
+			assert (iter->module != NULL);
+			rv = open_slot_session (iter, iter->module, iter->slot, &iter->slot_info,
+			                        &iter->token_info, &iter->session);
+			if (rv != CKR_OK)
+				return finish_iterating (iter, rv);
+
+			if (iter->session != 0) {
+				open_search_session (iter);
+				return CKR_OK;
+			}
+		}
+
+		/* Otherwise try again */
+	}
+}
+
+/* Whether all the objects are found before any are returned */
+static bool
+preloading (P11KitIter *iter)
+{
+	return iter->preload_results && iter->search == iter->session;
+}
+
+static CK_RV
+grow_objects (P11KitIter *iter)
+{
+	CK_ULONG initial = iter->stream ? STREAM_WINDOW : 64;
+
+	iter->max_objects = iter->max_objects ? iter->max_objects * 2 : initial;
+	iter->objects = realloc (iter->objects, iter->max_objects * sizeof (CK_ULONG));
+	return_val_if_fail (iter->objects != NULL, CKR_HOST_MEMORY);
+	return CKR_OK;
+}
+
+/*
+ * For remote modules the search is started, the first objects found,
+ * and the search finished if those are all, in a single round trip.
+ */
+static CK_RV
+begin_search (P11KitIter *iter)
+{
+	CK_X_FUNCTION_LIST *remote;
+	p11_rpc_batch *batch = NULL;
+	CK_ULONG count = 0;
+	CK_ULONG window;
+	CK_ULONG n_attrs;
+	int init, find;
+	CK_RV rv;
+
+	assert (iter->module != NULL);
+	assert (iter->search != 0);
+
+	n_attrs = p11_attrs_count (iter->match_attrs);
+	remote = p11_modules_remote_for (iter->module);
+	if (remote)
+		batch = p11_rpc_batch_new (remote);
+
+	if (batch == NULL) {
+		rv = (iter->module->C_FindObjectsInit) (iter->search, iter->match_attrs, n_attrs);
+		if (rv == CKR_OK)
+			iter->searching = 1;
+		return rv;
+	}
+
+	if (iter->max_objects == 0) {
+		rv = grow_objects (iter);
+		if (rv != CKR_OK) {
+			p11_rpc_batch_free (batch);
+			return rv;
+		}
+	}
+
+	window = iter->max_objects;
+	init = p11_rpc_batch_find_objects_init (batch, iter->search, iter->match_attrs, n_attrs);
+	find = p11_rpc_batch_find_objects (batch, iter->search, iter->objects, window, &count);
+	p11_rpc_batch_find_objects_final (batch, iter->search);
+	p11_rpc_batch_unless (batch, find, window - 1);
+
+	rv = p11_rpc_batch_run (batch);
+	if (rv == CKR_OK)
+		rv = p11_rpc_batch_result (batch, init);
+	if (rv == CKR_OK)
+		rv = p11_rpc_batch_result (batch, find);
+	p11_rpc_batch_free (batch);
+
+	if (rv != CKR_OK)
+		return rv;
+
+	iter->num_objects = count;
+
+	/* The search was finished along with the rest of the batch */
+	if (count < window)
+		iter->searched = 1;
+	else
+		iter->searching = 1;
+
+	return CKR_OK;
+}
+
+/* Runs for the life of the iterator, finding objects in the windows handed to it */
+static void *
+prefetch_objects (void *data)
+{
+	P11KitIter *iter = data;
+	CK_RV rv;
+
+	p11_mutex_lock (&iter->prefetch_lock);
+
+	for (;;) {
+		while (!iter->prefetch_window && !iter->prefetch_quit)
+			p11_cond_wait (&iter->prefetch_cond, &iter->prefetch_lock);
+		if (iter->prefetch_quit)
+			break;
+
+		/* Only this thread touches these until the window is done */
+		p11_mutex_unlock (&iter->prefetch_lock);
+		rv = (iter->module->C_FindObjects) (iter->search, iter->prefetched,
+		                                    iter->max_objects, &iter->num_prefetched);
+		p11_mutex_lock (&iter->prefetch_lock);
+
+		iter->prefetch_rv = rv;
+		iter->prefetch_window = 0;
+		p11_cond_broadcast (&iter->prefetch_cond);
+	}
+
+	p11_mutex_unlock (&iter->prefetch_lock);
+	return NULL;
+}
+
+static void
+start_prefetch (P11KitIter *iter)
+{
+	/* Calls on one session mustn't overlap, so needs a search session */
+	if (!iter->prefetch || iter->prefetching || !iter->searching ||
+	    iter->search == iter->session)
+		return;
+
+	iter->prefetched = realloc (iter->prefetched, iter->max_objects * sizeof (CK_OBJECT_HANDLE));
+	return_if_fail (iter->prefetched != NULL);
+
+	/* If no thread, then the next objects are found when needed */
+	if (!iter->prefetch_running) {
+		iter->prefetch_quit = 0;
+		if (p11_thread_create (&iter->prefetch_thread, prefetch_objects, iter) != 0)
+			return;
+		iter->prefetch_running = 1;
 	}
 
-	/* Otherwise try again */
-	return move_next_session (iter);
+	p11_mutex_lock (&iter->prefetch_lock);
+	iter->num_prefetched = 0;
+	iter->prefetch_window = 1;
+	p11_cond_broadcast (&iter->prefetch_cond);
+	p11_mutex_unlock (&iter->prefetch_lock);
+	iter->prefetching = 1;
+}
+
+static CK_RV
+find_objects (P11KitIter *iter)
+{
+	CK_OBJECT_HANDLE *objects;
+	CK_ULONG batch;
+	CK_ULONG count;
+	CK_RV rv;
+
+	assert (iter->module != NULL);
+	assert (iter->search != 0);
+
+	for (;;) {
+		if (iter->max_objects - iter->num_objects == 0) {
+			rv = grow_objects (iter);
+			if (rv != CKR_OK)
+				return rv;
+		}
+
+		batch = iter->max_objects - iter->num_objects;
+
+		/* Take the objects found on the other thread */
+		if (iter->prefetching) {
+			assert (iter->num_objects == 0);
+			finish_prefetch (iter);
+			objects = iter->objects;
+			iter->objects = iter->prefetched;
+			iter->prefetched = objects;
+			count = iter->num_prefetched;
+			rv = iter->prefetch_rv;
+
+		} else {
+			rv = (iter->module->C_FindObjects) (iter->search,
+			                                    iter->objects + iter->num_objects,
+			                                    batch, &count);
+		}
+
+		if (rv != CKR_OK)
+			return rv;
+
+		iter->num_objects += count;
+
+		/*
+		 * Done searching on this session, although there are still
+		 * objects outstanding, which will be returned on next
+		 * iterations.
+		 */
+		if (batch != count) {
+			iter->searching = 0;
+			iter->searched = 1;
+			(iter->module->C_FindObjectsFinal) (iter->search);
+			return CKR_OK;
+		}
+
+		if (!preloading (iter))
+			return CKR_OK;
+	}
 }
 
 /**
@@ -565,8 +1213,6 @@ move_next_session (P11KitIter *iter)
 CK_RV
 p11_kit_iter_next (P11KitIter *iter)
 {
-	CK_ULONG batch;
-	CK_ULONG count;
 	CK_BBOOL matches;
 	CK_RV rv;
 
@@ -577,81 +1223,51 @@ p11_kit_iter_next (P11KitIter *iter)
 	if (iter->match_nothing)
 		return finish_iterating (iter, CKR_CANCEL);
 
-	/*
-	 * If we have outstanding objects, then iterate one through those
-	 * Note that we pass each object through the filters, and only
-	 * assume it's iterated if it matches
-	 */
-	while (iter->saw_objects < iter->num_objects) {
-		iter->object = iter->objects[iter->saw_objects++];
-
-		rv = call_all_filters (iter, &matches);
-		if (rv != CKR_OK)
-			return finish_iterating (iter, rv);
-
-		if (matches)
-			return CKR_OK;
-	}
+	for (;;) {
 
-	/* If we have finished searching then move to next session */
-	if (iter->searched) {
-		rv = move_next_session (iter);
-		if (rv != CKR_OK)
-			return finish_iterating (iter, rv);
-	}
+		/*
+		 * If we have outstanding objects, then iterate one through those
+		 * Note that we pass each object through the filters, and only
+		 * assume it's iterated if it matches
+		 */
+		while (iter->saw_objects < iter->num_objects) {
+			iter->object = iter->objects[iter->saw_objects++];
 
-	/* Ready to start searching */
-	if (!iter->searching && !iter->searched) {
-		count = p11_attrs_count (iter->match_attrs);
-		rv = (iter->module->C_FindObjectsInit) (iter->session, iter->match_attrs, count);
-		if (rv != CKR_OK)
-			return finish_iterating (iter, rv);
-		iter->searching = 1;
-		iter->searched = 0;
-	}
+			rv = call_all_filters (iter, &matches);
+			if (rv != CKR_OK)
+				return finish_iterating (iter, rv);
 
-	/* If we have searched on this session then try to continue */
-	if (iter->searching) {
-		assert (iter->module != NULL);
-		assert (iter->session != 0);
-		iter->num_objects = 0;
-		iter->saw_objects = 0;
-
-		for (;;) {
-			if (iter->max_objects - iter->num_objects == 0) {
-				iter->max_objects = iter->max_objects ? iter->max_objects * 2 : 64;
-				iter->objects = realloc (iter->objects, iter->max_objects * sizeof (CK_ULONG));
-				return_val_if_fail (iter->objects != NULL, CKR_HOST_MEMORY);
-			}
+			if (matches)
+				return CKR_OK;
+		}
 
-			batch = iter->max_objects - iter->num_objects;
-			rv = (iter->module->C_FindObjects) (iter->session,
-			                                    iter->objects + iter->num_objects,
-			                                    batch, &count);
+		/* If we have finished searching then move to next session */
+		if (iter->searched) {
+			rv = move_next_session (iter);
 			if (rv != CKR_OK)
 				return finish_iterating (iter, rv);
+		} else {
+			iter->num_objects = 0;
+			iter->saw_objects = 0;
+		}
 
-			iter->num_objects += count;
-
-			/*
-			 * Done searching on this session, although there are still
-			 * objects outstanding, which will be returned on next
-			 * iterations.
-			 */
-			if (batch != count) {
-				iter->searching = 0;
-				iter->searched = 1;
-				(iter->module->C_FindObjectsFinal) (iter->session);
-				break;
-			}
+		/* Ready to start searching */
+		if (!iter->searching && !iter->searched) {
+			rv = begin_search (iter);
+			if (rv != CKR_OK)
+				return finish_iterating (iter, rv);
+		}
 
-			if (!iter->preload_results)
-				break;
+		/* If we have searched on this session then try to continue */
+		if (iter->searching && (iter->num_objects == 0 || preloading (iter))) {
+			rv = find_objects (iter);
+			if (rv != CKR_OK)
+				return finish_iterating (iter, rv);
 		}
-	}
 
-	/* Try again */
-	return p11_kit_iter_next (iter);
+		/* Find the next objects while these are being returned */
+		start_prefetch (iter);
+	}
 }
 
 /**
@@ -967,10 +1583,17 @@ p11_kit_iter_free (P11KitIter *iter)
 		return;
 
 	finish_iterating (iter, CKR_OK);
+	stop_prefetch (iter);
 	p11_array_free (iter->modules);
+	p11_uri_match_free (iter->match);
 	p11_attrs_free (iter->match_attrs);
 	free (iter->objects);
+	free (iter->prefetched);
 	free (iter->slots);
+	p11_mutex_uninit (&iter->found_lock);
+	p11_cond_uninit (&iter->found_cond);
+	p11_mutex_uninit (&iter->prefetch_lock);
+	p11_cond_uninit (&iter->prefetch_cond);
 
 	for (cb = iter->callbacks; cb != NULL; cb = next) {
 		next = cb->next;
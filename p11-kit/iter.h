@@ -51,6 +51,10 @@ typedef P11KitIter p11_kit_iter;
 typedef enum {
 	P11_KIT_ITER_BUSY_SESSIONS = 1 << 1,
 	P11_KIT_ITER_WANT_WRITABLE = 1 << 2,
+	P11_KIT_ITER_STREAM = 1 << 3,
+	P11_KIT_ITER_PREFETCH = 1 << 4,
+	P11_KIT_ITER_PARALLEL = 1 << 5,
+	P11_KIT_ITER_UNORDERED = 1 << 6,
 } P11KitIterBehavior;
 
 typedef CK_RV      (* p11_kit_iter_callback)                (P11KitIter *iter,
@@ -2016,6 +2016,9 @@ p11_log_subclass (p11_virtual *lower,
 	log = calloc (1, sizeof (LogData));
 	return_val_if_fail (log != NULL, NULL);
 
+	/* Calls that the lower level just passes on should skip it */
+	p11_virtual_compile (lower);
+
 	p11_virtual_init (&log->virt, &log_functions, lower, destroyer);
 	log->lower = &lower->funcs;
 	return &log->virt;
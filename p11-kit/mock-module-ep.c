@@ -39,14 +39,25 @@
 
 #include "mock.h"
 
+#include <stdlib.h>
+
 #ifdef OS_WIN32
 __declspec(dllexport)
 #endif
 CK_RV
 C_GetFunctionList (CK_FUNCTION_LIST_PTR_PTR list)
 {
+	const char *env;
+	mock_scale scale;
+
 	mock_module_init ();
 	mock_module_no_slots.C_GetFunctionList = C_GetFunctionList;
+
+	/* Generated tokens for load testing, see mock_module_scale_parse() */
+	env = getenv ("P11_KIT_MOCK_SCALE");
+	if (env && mock_module_scale_parse (env, &scale))
+		mock_module_scale (&scale);
+
 	if (list == NULL)
 		return CKR_ARGUMENTS_BAD;
 	*list = &mock_module;
@@ -52,6 +52,7 @@
 #include "private.h"
 #include "proxy.h"
 #include "rpc.h"
+#include "stats.h"
 #include "virtual.h"
 
 #include <sys/stat.h>
@@ -161,6 +162,9 @@ typedef struct _Module {
 	p11_mutex_t initialize_mutex;
 	unsigned int initialize_called;
 	p11_thread_id_t initialize_thread;
+
+	/* Call statistics, shared by all managed instances */
+	p11_stats *stats;
 } Module;
 
 /*
@@ -255,6 +259,7 @@ free_module_unlocked (void *data)
 		mod->loaded_destroy (mod->loaded_module);
 
 	p11_mutex_uninit (&mod->initialize_mutex);
+	p11_stats_free (mod->stats);
 	p11_dict_free (mod->config);
 	free (mod->name);
 	free (mod->filename);
@@ -513,6 +518,10 @@ take_config_and_load_module_inlock (char **name,
 		if (rv != CKR_OK)
 			goto out;
 
+		/* Attributes of objects on read-only tokens can be kept on this side */
+		if (_p11_conf_parse_boolean (p11_dict_get (*config, "cache-attributes"), false))
+			p11_rpc_client_set_cache (&mod->virt);
+
 	} else {
 
 		rv = load_module_from_file_inlock (*name, filename, &mod);
@@ -729,6 +738,38 @@ free_modules_when_no_refs_unlocked (void)
 	gl.config = NULL;
 }
 
+static void
+write_stats (Module *mod)
+{
+	p11_buffer buffer;
+	const char *path;
+	FILE *file;
+
+	path = secure_getenv ("P11_KIT_STATS_FILE");
+	if (path == NULL || path[0] == '\0')
+		return;
+
+	if (!p11_buffer_init_null (&buffer, 1024))
+		return_if_reached ();
+
+	p11_stats_format (mod->stats, &buffer);
+	if (p11_buffer_failed (&buffer)) {
+		p11_buffer_uninit (&buffer);
+		return_if_reached ();
+	}
+
+	file = fopen (path, "a");
+	if (file == NULL) {
+		p11_message_err (errno, "couldn't open stats file: %s", path);
+	} else {
+		fprintf (file, "# %s\n%s\n", mod->name ? mod->name :
+		         mod->filename ? mod->filename : "module", (char *)buffer.data);
+		fclose (file);
+	}
+
+	p11_buffer_uninit (&buffer);
+}
+
 static CK_RV
 finalize_module_inlock_reentrant (Module *mod)
 {
@@ -759,6 +800,10 @@ finalize_module_inlock_reentrant (Module *mod)
 	}
 
 	p11_mutex_unlock (&mod->initialize_mutex);
+
+	if (mod->stats)
+		write_stats (mod);
+
 	p11_lock ();
 
 	/* Match the ref increment in initialize_module_inlock_reentrant() */
@@ -1264,6 +1309,90 @@ p11_kit_module_get_flags (CK_FUNCTION_LIST *module)
 	return flags;
 }
 
+/**
+ * p11_kit_module_get_stats:
+ * @module: the module
+ *
+ * Get the call statistics recorded for this module.
+ *
+ * Statistics are recorded for managed modules that have the
+ * <literal>stats</literal> option set in their configuration, or that
+ * were loaded with the %P11_KIT_MODULE_STATS flag. For each PKCS\#11
+ * function called they contain the number of calls, failed calls, and
+ * the mean, median, 90th and 99th percentile and maximum time spent
+ * in the module.
+ *
+ * The result is a table with a header line, and a line for each function
+ * called. Use free() to release the return value when you're done with it.
+ *
+ * When the module is finalized, the same table is also appended to the file
+ * named by the <literal>P11_KIT_STATS_FILE</literal> environment variable,
+ * if it is set.
+ *
+ * Returns: a newly allocated string, or %NULL if no statistics are
+ *     recorded for the module
+ */
+char *
+p11_kit_module_get_stats (CK_FUNCTION_LIST *module)
+{
+	p11_buffer buffer;
+	Module *mod;
+	char *stats = NULL;
+
+	return_val_if_fail (module != NULL, NULL);
+
+	p11_library_init_once ();
+
+	p11_lock ();
+
+		p11_message_clear ();
+
+		if (gl.modules) {
+			mod = module_for_functions_inlock (module);
+			if (mod && mod->stats) {
+				if (p11_buffer_init_null (&buffer, 1024)) {
+					p11_stats_format (mod->stats, &buffer);
+					if (!p11_buffer_failed (&buffer))
+						stats = p11_buffer_steal (&buffer, NULL);
+					p11_buffer_uninit (&buffer);
+				}
+			}
+		}
+
+	p11_unlock ();
+
+	return stats;
+}
+
+/**
+ * p11_kit_module_reset_stats:
+ * @module: the module
+ *
+ * Clear the call statistics recorded for this module, if any. See
+ * p11_kit_module_get_stats().
+ */
+void
+p11_kit_module_reset_stats (CK_FUNCTION_LIST *module)
+{
+	Module *mod;
+
+	return_if_fail (module != NULL);
+
+	p11_library_init_once ();
+
+	p11_lock ();
+
+		p11_message_clear ();
+
+		if (gl.modules) {
+			mod = module_for_functions_inlock (module);
+			if (mod && mod->stats)
+				p11_stats_reset (mod->stats);
+		}
+
+	p11_unlock ();
+}
+
 /**
  * p11_kit_registered_name_to_module:
  * @name: name of a registered module
@@ -1450,19 +1579,57 @@ cleanup:
 	return ret;
 }
 
+/*
+ * Sessions are tracked in separate shards, each with its own lock, so
+ * that threads opening and closing sessions don't contend with each
+ * other, or with the global library lock.
+ */
+#define SESSION_SHARDS 16
+
+typedef struct {
+	p11_mutex_t mutex;
+	p11_dict *sessions;
+} SessionShard;
+
 typedef struct {
 	p11_virtual virt;
 	Module *mod;
 	unsigned int initialized;
-	p11_dict *sessions;
+	SessionShard shards[SESSION_SHARDS];
 } Managed;
 
+static SessionShard *
+managed_session_shard (Managed *managed,
+                       CK_SESSION_HANDLE session)
+{
+	return managed->shards + (session % SESSION_SHARDS);
+}
+
+static void
+managed_reset_sessions (Managed *managed,
+                        bool forked)
+{
+	SessionShard *shard;
+	int i;
+
+	/*
+	 * Nothing else can be tracking sessions until we're initialized.
+	 * But if initialized in a parent process, a shard lock may have been
+	 * held there by a thread which doesn't exist in this process.
+	 */
+	for (i = 0; i < SESSION_SHARDS; i++) {
+		shard = managed->shards + i;
+		if (forked)
+			p11_mutex_init (&shard->mutex);
+		p11_dict_clear (shard->sessions);
+	}
+}
+
 static CK_RV
 managed_C_Initialize (CK_X_FUNCTION_LIST *self,
                       CK_VOID_PTR init_args)
 {
 	Managed *managed = ((Managed *)self);
-	p11_dict *sessions;
 	CK_RV rv;
 
 	p11_debug ("in");
@@ -1472,20 +1639,10 @@ managed_C_Initialize (CK_X_FUNCTION_LIST *self,
 		rv = CKR_CRYPTOKI_ALREADY_INITIALIZED;
 
 	} else {
-		sessions = p11_dict_new (p11_dict_ulongptr_hash,
-		                         p11_dict_ulongptr_equal,
-		                         free, free);
-		if (!sessions)
-			rv = CKR_HOST_MEMORY;
-		else
-			rv = initialize_module_inlock_reentrant (managed->mod);
+		rv = initialize_module_inlock_reentrant (managed->mod);
 		if (rv == CKR_OK) {
-			if (managed->sessions)
-				p11_dict_free (managed->sessions);
-			managed->sessions = sessions;
+			managed_reset_sessions (managed, managed->initialized != 0);
 			managed->initialized = p11_forkid;
-		} else {
-			p11_dict_free (sessions);
 		}
 	}
 
@@ -1496,67 +1653,100 @@ managed_C_Initialize (CK_X_FUNCTION_LIST *self,
 }
 
 static CK_RV
-managed_track_session_inlock (p11_dict *sessions,
-                              CK_SLOT_ID slot_id,
-                              CK_SESSION_HANDLE session)
+managed_track_session (Managed *managed,
+                       CK_SLOT_ID slot_id,
+                       CK_SESSION_HANDLE session)
 {
+	SessionShard *shard;
 	void *key;
 	void *value;
+	bool ret;
 
 	key = memdup (&session, sizeof (CK_SESSION_HANDLE));
 	return_val_if_fail (key != NULL, CKR_HOST_MEMORY);
 
-	value = memdup (&slot_id, sizeof (CK_SESSION_HANDLE));
-	return_val_if_fail (value != NULL, CKR_HOST_MEMORY);
-
-	if (!p11_dict_set (sessions, key, value))
+	value = memdup (&slot_id, sizeof (CK_SLOT_ID));
+	if (value == NULL) {
+		free (key);
 		return_val_if_reached (CKR_HOST_MEMORY);
+	}
+
+	shard = managed_session_shard (managed, session);
 
+	p11_mutex_lock (&shard->mutex);
+	ret = p11_dict_set (shard->sessions, key, value);
+	p11_mutex_unlock (&shard->mutex);
+
+	return_val_if_fail (ret, CKR_HOST_MEMORY);
 	return CKR_OK;
 }
 
 static void
-managed_untrack_session_inlock (p11_dict *sessions,
-                                CK_SESSION_HANDLE session)
+managed_untrack_session (Managed *managed,
+                         CK_SESSION_HANDLE session)
 {
-	p11_dict_remove (sessions, &session);
+	SessionShard *shard;
+
+	shard = managed_session_shard (managed, session);
+
+	p11_mutex_lock (&shard->mutex);
+	p11_dict_remove (shard->sessions, &session);
+	p11_mutex_unlock (&shard->mutex);
 }
 
 static CK_SESSION_HANDLE *
-managed_steal_sessions_inlock (p11_dict *sessions,
+managed_steal_sessions (Managed *managed,
                         bool matching_slot_id,
                         CK_SLOT_ID slot_id,
                         int *count)
 {
-	CK_SESSION_HANDLE *stolen;
+	CK_SESSION_HANDLE *stolen = NULL;
 	CK_SESSION_HANDLE *key;
+	CK_SESSION_HANDLE *memory;
 	CK_SLOT_ID *value;
+	SessionShard *shard;
 	p11_dictiter iter;
-	int at, i;
+	int at, start, i, j;
 
-	assert (sessions != NULL);
 	assert (count != NULL);
-
-	stolen = calloc (p11_dict_size (sessions), sizeof (CK_SESSION_HANDLE));
-	return_val_if_fail (stolen != NULL, NULL);
+	*count = 0;
 
 	at = 0;
-	p11_dict_iterate (sessions, &iter);
-	while (p11_dict_next (&iter, (void **)&key, (void **)&value)) {
-		if (!matching_slot_id || slot_id == *value)
-			stolen[at++] = *key;
-	}
+	for (i = 0; i < SESSION_SHARDS; i++) {
+		shard = managed->shards + i;
+		p11_mutex_lock (&shard->mutex);
+
+		/* Always allocate, so that a NULL return means failure */
+		memory = realloc (stolen, (at + p11_dict_size (shard->sessions) + 1) *
+		                  sizeof (CK_SESSION_HANDLE));
+		if (memory == NULL) {
+			p11_mutex_unlock (&shard->mutex);
+			free (stolen);
+			return_val_if_reached (NULL);
+		}
 
-	/* Removed them all, clear the whole array */
-	if (at == p11_dict_size (sessions)) {
-		p11_dict_clear (sessions);
+		stolen = memory;
+		start = at;
 
-	/* Only removed some, go through and remove those */
-	} else {
-		for (i = 0; i < at; i++) {
-			if (!p11_dict_remove (sessions, stolen + at))
-				assert_not_reached ();
+		p11_dict_iterate (shard->sessions, &iter);
+		while (p11_dict_next (&iter, (void **)&key, (void **)&value)) {
+			if (!matching_slot_id || slot_id == *value)
+				stolen[at++] = *key;
 		}
+
+		/* Removed them all, clear the whole shard */
+		if (at - start == p11_dict_size (shard->sessions)) {
+			p11_dict_clear (shard->sessions);
+
+		/* Only removed some, go through and remove those */
+		} else {
+			for (j = start; j < at; j++) {
+				if (!p11_dict_remove (shard->sessions, stolen + j))
+					assert_not_reached ();
+			}
+		}
+
+		p11_mutex_unlock (&shard->mutex);
 	}
 
 	*count = at;
@@ -1604,7 +1794,7 @@ managed_C_Finalize (CK_X_FUNCTION_LIST *self,
 		rv = CKR_OK;
 
 	} else {
-		sessions = managed_steal_sessions_inlock (managed->sessions, false, 0, &count);
+		sessions = managed_steal_sessions (managed, false, 0, &count);
 
 		if (sessions && count) {
 			/* WARNING: reentrancy can occur here */
@@ -1619,11 +1809,8 @@ managed_C_Finalize (CK_X_FUNCTION_LIST *self,
 		rv = finalize_module_inlock_reentrant (managed->mod);
 	}
 
-	if (rv == CKR_OK) {
+	if (rv == CKR_OK)
 		managed->initialized = 0;
-		p11_dict_free (managed->sessions);
-		managed->sessions = NULL;
-	}
 
 	p11_unlock ();
 	p11_debug ("out: %lu", rv);
@@ -1647,11 +1834,8 @@ managed_C_OpenSession (CK_X_FUNCTION_LIST *self,
 	self = &managed->mod->virt.funcs;
 	rv = self->C_OpenSession (self, slot_id, flags, application, notify, session);
 
-	if (rv == CKR_OK) {
-		p11_lock ();
-		rv = managed_track_session_inlock (managed->sessions, slot_id, *session);
-		p11_unlock ();
-	}
+	if (rv == CKR_OK)
+		rv = managed_track_session (managed, slot_id, *session);
 
 	return rv;
 }
@@ -1666,11 +1850,8 @@ managed_C_CloseSession (CK_X_FUNCTION_LIST *self,
 	self = &managed->mod->virt.funcs;
 	rv = self->C_CloseSession (self, session);
 
-	if (rv == CKR_OK) {
-		p11_lock ();
-		managed_untrack_session_inlock (managed->sessions, session);
-		p11_unlock ();
-	}
+	if (rv == CKR_OK)
+		managed_untrack_session (managed, session);
 
 	return rv;
 }
@@ -1683,9 +1864,7 @@ managed_C_CloseAllSessions (CK_X_FUNCTION_LIST *self,
 	CK_SESSION_HANDLE *stolen;
 	int count;
 
-	p11_lock ();
-	stolen = managed_steal_sessions_inlock (managed->sessions, true, slot_id, &count);
-	p11_unlock ();
+	stolen = managed_steal_sessions (managed, true, slot_id, &count);
 
 	self = &managed->mod->virt.funcs;
 	managed_close_sessions (self, stolen, count);
@@ -1702,6 +1881,13 @@ static void
 managed_free_inlock (void *data)
 {
 	Managed *managed = data;
+	int i;
+
+	for (i = 0; i < SESSION_SHARDS; i++) {
+		p11_dict_free (managed->shards[i].sessions);
+		p11_mutex_uninit (&managed->shards[i].mutex);
+	}
+
 	managed->mod->ref_count--;
 	free (managed);
 }
@@ -1710,10 +1896,26 @@ static p11_virtual *
 managed_create_inlock (Module *mod)
 {
 	Managed *managed;
+	int i;
 
 	managed = calloc (1, sizeof (Managed));
 	return_val_if_fail (managed != NULL, NULL);
 
+	for (i = 0; i < SESSION_SHARDS; i++) {
+		managed->shards[i].sessions = p11_dict_new (p11_dict_ulongptr_hash,
+		                                            p11_dict_ulongptr_equal,
+		                                            free, free);
+		if (managed->shards[i].sessions == NULL) {
+			while (--i >= 0) {
+				p11_dict_free (managed->shards[i].sessions);
+				p11_mutex_uninit (&managed->shards[i].mutex);
+			}
+			free (managed);
+			return_val_if_reached (NULL);
+		}
+		p11_mutex_init (&managed->shards[i].mutex);
+	}
+
 	p11_virtual_init (&managed->virt, &p11_virtual_stack,
 	                  &mod->virt, NULL);
 	managed->virt.funcs.C_Initialize = managed_C_Initialize;
@@ -1769,6 +1971,36 @@ lookup_managed_option (Module *mod,
 	return value;
 }
 
+/*
+ * Returns the RPC client functions below @module, if it's a remote
+ * module, so that callers can batch calls with p11_rpc_batch_new().
+ * Calls made there skip any layers above the managed one, such as the
+ * logger, so only when there are none.
+ */
+CK_X_FUNCTION_LIST *
+p11_modules_remote_for (CK_FUNCTION_LIST *module)
+{
+	CK_X_FUNCTION_LIST *funcs = NULL;
+	p11_virtual *virt;
+	Module *mod;
+
+	return_val_if_fail (module != NULL, NULL);
+
+	p11_lock ();
+
+		if (gl.modules && p11_virtual_is_wrapper (module)) {
+			mod = p11_dict_get (gl.managed_by_closure, module);
+			virt = p11_virtual_wrapped (module);
+			if (mod && mod->loaded_destroy == p11_rpc_transport_free &&
+			    virt->lower_module == &mod->virt)
+				funcs = &mod->virt.funcs;
+		}
+
+	p11_unlock ();
+
+	return funcs;
+}
+
 static CK_RV
 release_module_inlock_rentrant (CK_FUNCTION_LIST *module,
                                 const char *caller_func)
@@ -1831,6 +2063,7 @@ prepare_module_inlock_reentrant (Module *mod,
 	const char *trusted;
 	p11_virtual *virt;
 	bool is_managed;
+	bool with_stats;
 	bool with_log;
 
 	assert (module != NULL);
@@ -1843,9 +2076,12 @@ prepare_module_inlock_reentrant (Module *mod,
 
 	if (flags & P11_KIT_MODULE_UNMANAGED) {
 		is_managed = false;
+		with_stats = false;
 		with_log = false;
 	} else {
 		is_managed = lookup_managed_option (mod, p11_virtual_can_wrap (), "managed", true);
+		with_stats = lookup_managed_option (mod, is_managed, "stats", false) ||
+		             (is_managed && (flags & P11_KIT_MODULE_STATS));
 		with_log = lookup_managed_option (mod, is_managed, "log-calls", false);
 	}
 
@@ -1854,6 +2090,15 @@ prepare_module_inlock_reentrant (Module *mod,
 		return_val_if_fail (virt != NULL, CKR_HOST_MEMORY);
 		destroyer = managed_free_inlock;
 
+		/* Time the calls into the module if configured */
+		if (p11_stats_force || with_stats) {
+			if (mod->stats == NULL)
+				mod->stats = p11_stats_new ();
+			return_val_if_fail (mod->stats != NULL, CKR_HOST_MEMORY);
+			virt = p11_stats_subclass (virt, destroyer, mod->stats);
+			destroyer = p11_stats_release;
+		}
+
 		/* Add the logger if configured */
 		if (p11_log_force || with_log) {
 			virt = p11_log_subclass (virt, destroyer);
@@ -1955,6 +2200,9 @@ p11_modules_load_inlock_reentrant (int flags,
  * configuration. This means that a failure to load any module will
  * cause this function to fail.
  *
+ * If @flags contains the %P11_KIT_MODULE_STATS flag then call statistics
+ * are recorded for the managed modules, see p11_kit_module_get_stats().
+ *
  * For unmanaged modules there is no guarantee to the state of the
  * modules. Other callers may be using the modules. Using unmanaged
  * modules haphazardly is not recommended for this reason. Some
@@ -36,6 +36,7 @@
 #define __P11_MODULES_H__
 
 #include "pkcs11.h"
+#include "pkcs11i.h"
 
 CK_RV      p11_modules_load_inlock_reentrant         (int flags,
                                                       CK_FUNCTION_LIST_PTR **results);
@@ -48,4 +49,7 @@ CK_RV      p11_module_load_inlock_reentrant          (CK_FUNCTION_LIST_PTR modul
 
 CK_RV      p11_module_release_inlock_reentrant       (CK_FUNCTION_LIST_PTR module);
 
+CK_X_FUNCTION_LIST *
+           p11_modules_remote_for                    (CK_FUNCTION_LIST_PTR module);
+
 #endif /* __P11_MODULES_H__ */
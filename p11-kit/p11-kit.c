@@ -54,6 +54,9 @@
 int       p11_kit_list_modules    (int argc,
                                    char *argv[]);
 
+int       p11_kit_stats           (int argc,
+                                   char *argv[]);
+
 int       p11_kit_trust           (int argc,
                                    char *argv[]);
 
@@ -63,6 +66,7 @@ int       p11_kit_external        (int argc,
 static const p11_tool_command commands[] = {
 	{ "list-modules", p11_kit_list_modules, "List modules and tokens" },
 	{ "remote", p11_kit_external, "Run a specific PKCS#11 module remotely" },
+	{ "stats", p11_kit_stats, "Measure calls into modules by listing all objects" },
 	{ P11_TOOL_FALLBACK, p11_kit_external, NULL },
 	{ 0, }
 };
@@ -111,6 +111,14 @@ void                   p11_kit_be_loud                      (void);
 
 void                   p11_kit_set_progname                 (const char *progname);
 
+enum {
+	P11_KIT_MODULE_STATS = 1 << 3,
+};
+
+char *                 p11_kit_module_get_stats             (CK_FUNCTION_LIST *module);
+
+void                   p11_kit_module_reset_stats           (CK_FUNCTION_LIST *module);
+
 #endif
 
 const char *           p11_kit_message                      (void);
@@ -45,13 +45,22 @@
 #include "private.h"
 #include "array.h"
 
+#include <sys/types.h>
+#include <sys/stat.h>
+
 #include <assert.h>
 #include <errno.h>
 #include <fcntl.h>
+#include <stddef.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 #include <unistd.h>
 
+#ifdef OS_UNIX
+#include <sys/mman.h>
+#endif
+
 /**
  * SECTION:p11-kit-pin
  * @title: PIN Callbacks
@@ -132,7 +141,7 @@
  */
 
 typedef struct _PinCallback {
-	/* Only used/modified within the lock */
+	/* Modified atomically */
 	int refs;
 
 	/* Readonly after construct */
@@ -142,18 +151,49 @@ typedef struct _PinCallback {
 } PinCallback;
 
 /*
- * Shared data between threads, protected by the mutex, a structure so
- * we can audit thread safety easier.
+ * The registered callbacks. This is copied on write, and never changed
+ * once published, so p11_kit_pin_request() can use it without holding
+ * the library lock while callbacks run.
  */
-static struct _Shared {
+typedef struct {
+	int refs;
 	p11_dict *pin_sources;
-} gl = { NULL };
+} PinRegistry;
+
+#ifdef OS_UNIX
+
+/* A PIN file cached in locked memory */
+typedef struct {
+	int refs;
+	bool cache;
+	dev_t dev;
+	ino_t ino;
+	off_t size;
+	time_t mtime;
+	time_t ctime;
+	size_t allocated;
+	size_t length;
+	unsigned char value[];
+} PinFile;
+
+#endif /* OS_UNIX */
+
+/*
+ * Shared data between threads, a structure so we can audit thread
+ * safety easier. The registry pointer is protected by the registry
+ * lock, writers and the file cache are protected by the mutex.
+ */
+static struct _Shared {
+	p11_rwlock_t registry_lock;
+	PinRegistry *registry;
+	p11_dict *file_cache;
+} gl;
 
 static void*
 ref_pin_callback (void *pointer)
 {
 	PinCallback *cb = pointer;
-	cb->refs++;
+	p11_atomic_add (&cb->refs, 1, RELAXED);
 	return pointer;
 }
 
@@ -163,37 +203,115 @@ unref_pin_callback (void *pointer)
 	PinCallback *cb = pointer;
 	assert (cb->refs >= 1);
 
-	cb->refs--;
-	if (cb->refs == 0) {
+	if (p11_atomic_sub (&cb->refs, 1, ACQ_REL) == 0) {
 		if (cb->destroy)
 			(cb->destroy) (cb->user_data);
 		free (cb);
 	}
 }
 
+static void
+registry_release (PinRegistry *registry)
+{
+	if (registry == NULL)
+		return;
+
+	if (p11_atomic_sub (&registry->refs, 1, ACQ_REL) == 0) {
+		p11_dict_free (registry->pin_sources);
+		free (registry);
+	}
+}
+
+static PinRegistry *
+registry_acquire (void)
+{
+	PinRegistry *registry;
+
+	/* Only held long enough to take a reference, callbacks run without it */
+	p11_rwlock_read (&gl.registry_lock);
+
+		registry = gl.registry;
+		if (registry != NULL)
+			p11_atomic_add (&registry->refs, 1, RELAXED);
+
+	p11_rwlock_unlock (&gl.registry_lock);
+
+	return registry;
+}
+
+static void
+registry_publish_unlocked (PinRegistry *registry)
+{
+	PinRegistry *old;
+
+	p11_rwlock_write (&gl.registry_lock);
+
+		old = gl.registry;
+		gl.registry = registry;
+
+	p11_rwlock_unlock (&gl.registry_lock);
+
+	/* Requests still using the old registry hold their own reference */
+	registry_release (old);
+}
+
+static PinRegistry *
+registry_copy_unlocked (void)
+{
+	PinRegistry *registry;
+	p11_array *callbacks;
+	p11_array *copy;
+	p11_dictiter iter;
+	char *name;
+	unsigned int i;
+
+	registry = calloc (1, sizeof (PinRegistry));
+	return_val_if_fail (registry != NULL, NULL);
+
+	registry->refs = 1;
+	registry->pin_sources = p11_dict_new (p11_dict_str_hash, p11_dict_str_equal,
+	                                      free, (p11_destroyer)p11_array_free);
+	return_val_if_fail (registry->pin_sources != NULL, NULL);
+
+	if (gl.registry == NULL)
+		return registry;
+
+	p11_dict_iterate (gl.registry->pin_sources, &iter);
+	while (p11_dict_next (&iter, (void **)&name, (void **)&callbacks)) {
+		copy = p11_array_new (unref_pin_callback);
+		return_val_if_fail (copy != NULL, NULL);
+		for (i = 0; i < callbacks->num; i++) {
+			if (!p11_array_push (copy, ref_pin_callback (callbacks->elem[i])))
+				return_val_if_reached (NULL);
+		}
+		name = strdup (name);
+		return_val_if_fail (name != NULL, NULL);
+		if (!p11_dict_set (registry->pin_sources, name, copy))
+			return_val_if_reached (NULL);
+	}
+
+	return registry;
+}
+
 static bool
 register_callback_unlocked (const char *pin_source,
                             PinCallback *cb)
 {
+	PinRegistry *registry;
 	p11_array *callbacks = NULL;
 	char *name;
 
+	registry = registry_copy_unlocked ();
+	return_val_if_fail (registry != NULL, false);
+
 	name = strdup (pin_source);
 	return_val_if_fail (name != NULL, false);
 
-	if (gl.pin_sources == NULL) {
-		gl.pin_sources = p11_dict_new (p11_dict_str_hash, p11_dict_str_equal,
-		                               free, (p11_destroyer)p11_array_free);
-		return_val_if_fail (gl.pin_sources != NULL, false);
-	}
-
-	if (gl.pin_sources != NULL)
-		callbacks = p11_dict_get (gl.pin_sources, name);
-
+	callbacks = p11_dict_get (registry->pin_sources, name);
 	if (callbacks == NULL) {
 		callbacks = p11_array_new (unref_pin_callback);
 		return_val_if_fail (callbacks != NULL, false);
-		if (!p11_dict_set (gl.pin_sources, name, callbacks))
+		if (!p11_dict_set (registry->pin_sources, name, callbacks))
 			return_val_if_reached (false);
 		name = NULL;
 	}
@@ -202,6 +320,7 @@ register_callback_unlocked (const char *pin_source,
 		return_val_if_reached (false);
 
 	free (name);
+	registry_publish_unlocked (registry);
 	return true;
 }
 
@@ -268,6 +387,7 @@ p11_kit_pin_unregister_callback (const char *pin_source,
                                  p11_kit_pin_callback callback,
                                  void *callback_data)
 {
+	PinRegistry *registry;
 	PinCallback *cb;
 	p11_array *callbacks;
 	unsigned int i;
@@ -277,8 +397,11 @@ p11_kit_pin_unregister_callback (const char *pin_source,
 
 	p11_lock ();
 
-		if (gl.pin_sources) {
-			callbacks = p11_dict_get (gl.pin_sources, pin_source);
+		if (gl.registry) {
+			registry = registry_copy_unlocked ();
+			return_if_fail (registry != NULL);
+
+			callbacks = p11_dict_get (registry->pin_sources, pin_source);
 			if (callbacks) {
 				for (i = 0; i < callbacks->num; i++) {
 					cb = callbacks->elem[i];
@@ -289,14 +412,16 @@ p11_kit_pin_unregister_callback (const char *pin_source,
 				}
 
 				if (callbacks->num == 0)
-					p11_dict_remove (gl.pin_sources, pin_source);
+					p11_dict_remove (registry->pin_sources, pin_source);
 			}
 
-			/* When there are no more pin sources, get rid of the hash table */
-			if (p11_dict_size (gl.pin_sources) == 0) {
-				p11_dict_free (gl.pin_sources);
-				gl.pin_sources = NULL;
+			/* When there are no more pin sources, get rid of the registry */
+			if (p11_dict_size (registry->pin_sources) == 0) {
+				registry_release (registry);
+				registry = NULL;
 			}
+
+			registry_publish_unlocked (registry);
 		}
 
 	p11_unlock ();
@@ -339,48 +464,31 @@ p11_kit_pin_request (const char *pin_source,
                      const char *pin_description,
                      P11KitPinFlags pin_flags)
 {
-	PinCallback **snapshot = NULL;
-	unsigned int snapshot_count = 0;
+	PinRegistry *registry;
 	p11_array *callbacks;
-	P11KitPin *pin;
+	P11KitPin *pin = NULL;
+	PinCallback *cb;
 	unsigned int i;
 
 	return_val_if_fail (pin_source != NULL, NULL);
 
-	p11_lock ();
-
-		/* Find and ref the pin source data */
-		if (gl.pin_sources) {
-			callbacks = p11_dict_get (gl.pin_sources, pin_source);
-
-			/* If we didn't find any snapshots try the global ones */
-			if (callbacks == NULL)
-				callbacks = p11_dict_get (gl.pin_sources, P11_KIT_PIN_FALLBACK);
-
-			if (callbacks != NULL && callbacks->num) {
-				snapshot = memdup (callbacks->elem, sizeof (void *) * callbacks->num);
-				snapshot_count = callbacks->num;
-				for (i = 0; snapshot && i < snapshot_count; i++)
-					ref_pin_callback (snapshot[i]);
-			}
-		}
+	registry = registry_acquire ();
+	if (registry == NULL)
+		return NULL;
 
-	p11_unlock ();
+	callbacks = p11_dict_get (registry->pin_sources, pin_source);
 
-	if (snapshot == NULL)
-		return NULL;
+	/* If we didn't find any callbacks try the global ones */
+	if (callbacks == NULL)
+		callbacks = p11_dict_get (registry->pin_sources, P11_KIT_PIN_FALLBACK);
 
-	for (pin = NULL, i = snapshot_count; pin == NULL && i > 0; i--) {
-		pin = (snapshot[i - 1]->func) (pin_source, pin_uri, pin_description, pin_flags,
-		                               snapshot[i - 1]->user_data);
+	for (i = callbacks ? callbacks->num : 0; pin == NULL && i > 0; i--) {
+		cb = callbacks->elem[i - 1];
+		pin = (cb->func) (pin_source, pin_uri, pin_description, pin_flags,
+		                  cb->user_data);
 	}
 
-	p11_lock ();
-		for (i = 0; i < snapshot_count; i++)
-			unref_pin_callback (snapshot[i]);
-		free (snapshot);
-	p11_unlock ();
-
+	registry_release (registry);
 	return pin;
 }
 
@@ -414,6 +522,52 @@ p11_kit_pin_request (const char *pin_source,
  * A function called to free or cleanup @data.
  */
 
+/* Files larger than this aren't PINs */
+#define PIN_FILE_MAX 4096
+
+static int
+read_pin_file (int fd,
+               unsigned char *buffer,
+               size_t *length)
+{
+	const size_t block = 1024;
+	size_t used, allocated;
+	int res;
+
+	used = 0;
+	allocated = 0;
+
+	for (;;) {
+		if (used + block > PIN_FILE_MAX)
+			return EFBIG;
+		if (used + block > allocated)
+			allocated = used + block;
+
+		res = read (fd, buffer + used, allocated - used);
+		if (res < 0) {
+			if (errno == EAGAIN)
+				continue;
+			return errno;
+		} else if (res == 0) {
+			break;
+		} else {
+			used += res;
+		}
+	}
+
+	*length = used;
+	return 0;
+}
+
+static void
+zero_memory (void *data,
+             size_t length)
+{
+	volatile unsigned char *p = data;
+	while (length-- > 0)
+		*(p++) = 0;
+}
+
 /**
  * p11_kit_pin_file_callback:
  * @pin_source: a 'pin-source' attribute string
@@ -452,13 +606,11 @@ p11_kit_pin_file_callback (const char *pin_source,
                            P11KitPinFlags pin_flags,
                            void *callback_data)
 {
-	const size_t block = 1024;
 	unsigned char *buffer;
 	unsigned char *memory;
-	size_t used, allocated;
-	int error = 0;
+	size_t used;
+	int error;
 	int fd;
-	int res;
 
 	return_val_if_fail (pin_source != NULL, NULL);
 
@@ -470,47 +622,272 @@ p11_kit_pin_file_callback (const char *pin_source,
 	if (fd == -1)
 		return NULL;
 
-	buffer = NULL;
-	used = 0;
-	allocated = 0;
+	buffer = malloc (PIN_FILE_MAX);
+	if (buffer == NULL)
+		error = ENOMEM;
+	else
+		error = read_pin_file (fd, buffer, &used);
 
-	for (;;) {
-		if (used + block > 4096) {
-			error = EFBIG;
-			break;
-		}
-		if (used + block > allocated) {
-			memory = realloc (buffer, used + block);
-			if (memory == NULL) {
-				error = ENOMEM;
-				break;
-			}
-			buffer = memory;
-			allocated = used + block;
-		}
+	close (fd);
 
-		res = read (fd, buffer + used, allocated - used);
-		if (res < 0) {
-			if (errno == EAGAIN)
-				continue;
-			error = errno;
-			break;
-		} else if (res == 0) {
-			break;
-		} else {
-			used += res;
-		}
+	if (error != 0) {
+		free (buffer);
+		errno = error;
+		return NULL;
+	}
+
+	memory = realloc (buffer, used ? used : 1);
+	if (memory != NULL)
+		buffer = memory;
+
+	return p11_kit_pin_new_for_buffer (buffer, used, free);
+}
+
+#ifdef OS_UNIX
+
+static PinFile *
+pin_file_new (size_t length)
+{
+	PinFile *file;
+	size_t allocated;
+	long page;
+
+	page = sysconf (_SC_PAGESIZE);
+	if (page <= 0)
+		page = 4096;
+	allocated = sizeof (PinFile) + length;
+	allocated = ((allocated + page - 1) / page) * page;
+
+	file = mmap (NULL, allocated, PROT_READ | PROT_WRITE,
+	             MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (file == MAP_FAILED)
+		return NULL;
+
+	/* Only cache PINs we can keep out of swap */
+	if (mlock (file, allocated) < 0) {
+		munmap (file, allocated);
+		return NULL;
+	}
+
+#ifdef MADV_DONTDUMP
+	madvise (file, allocated, MADV_DONTDUMP);
+#endif
+
+	file->refs = 1;
+	file->allocated = allocated;
+	return file;
+}
+
+static void
+pin_file_unref (void *data)
+{
+	PinFile *file = data;
+	size_t allocated;
+
+	if (p11_atomic_sub (&file->refs, 1, ACQ_REL) != 0)
+		return;
+
+	allocated = file->allocated;
+	zero_memory (file, allocated);
+	munlock (file, allocated);
+	munmap (file, allocated);
+}
+
+static void
+pin_file_unref_value (void *value)
+{
+	pin_file_unref ((unsigned char *)value - offsetof (PinFile, value));
+}
+
+static bool
+pin_file_matches (PinFile *file,
+                  struct stat *sb)
+{
+	return file->dev == sb->st_dev &&
+	       file->ino == sb->st_ino &&
+	       file->size == sb->st_size &&
+	       file->mtime == sb->st_mtime &&
+	       file->ctime == sb->st_ctime;
+}
+
+static PinFile *
+pin_file_read (const char *pin_source)
+{
+	struct stat sb;
+	PinFile *file;
+	time_t now;
+	int error;
+	int fd;
+
+	fd = open (pin_source, O_BINARY | O_RDONLY | O_CLOEXEC);
+	if (fd == -1)
+		return NULL;
+
+	file = NULL;
+	error = 0;
+
+	if (fstat (fd, &sb) < 0) {
+		error = errno;
+	} else {
+		file = pin_file_new (PIN_FILE_MAX);
+		if (file == NULL)
+			error = ENOMEM;
+		else
+			error = read_pin_file (fd, file->value, &file->length);
 	}
 
 	close (fd);
 
 	if (error != 0) {
-		free (buffer);
+		if (file)
+			pin_file_unref (file);
 		errno = error;
 		return NULL;
 	}
 
-	return p11_kit_pin_new_for_buffer (buffer, used, free);
+	file->dev = sb.st_dev;
+	file->ino = sb.st_ino;
+	file->size = sb.st_size;
+	file->mtime = sb.st_mtime;
+	file->ctime = sb.st_ctime;
+
+	/*
+	 * A file written in the same second as we read it could be written
+	 * again without its mtime changing, so it isn't cached.
+	 */
+	now = time (NULL);
+	file->cache = (file->size == file->length && file->mtime < now);
+
+	return file;
+}
+
+#endif /* OS_UNIX */
+
+/**
+ * p11_kit_pin_file_cached_callback:
+ * @pin_source: a 'pin-source' attribute string
+ * @pin_uri: a PKCS\#11 URI that the PIN is for, or %NULL
+ * @pin_description: a descrption of what the PIN is for
+ * @pin_flags: flags describing the PIN request
+ * @callback_data: unused, should be %NULL
+ *
+ * This is a PIN callback function like p11_kit_pin_file_callback(), except
+ * that PINs read from files are kept in memory. The file is read again when
+ * its inode, size, modification or change time differs. Files modified in
+ * the last second are not cached.
+ *
+ * Cached PINs are kept in locked memory, and cleared when they are no longer
+ * used. If memory cannot be locked then PINs are not cached. Use
+ * p11_kit_pin_file_cache_clear() to drop all cached PINs.
+ *
+ * Returns: a referenced PIN with the file contents, or %NULL if the file
+ *          could not be read
+ */
+P11KitPin *
+p11_kit_pin_file_cached_callback (const char *pin_source,
+                                  P11KitUri *pin_uri,
+                                  const char *pin_description,
+                                  P11KitPinFlags pin_flags,
+                                  void *callback_data)
+{
+#ifdef OS_UNIX
+	struct stat sb;
+	PinFile *file = NULL;
+	P11KitPin *pin;
+	char *key;
+
+	return_val_if_fail (pin_source != NULL, NULL);
+
+	/* We don't support retries */
+	if (pin_flags & P11_KIT_PIN_FLAGS_RETRY)
+		return NULL;
+
+	if (stat (pin_source, &sb) < 0)
+		return NULL;
+
+	p11_lock ();
+
+		if (gl.file_cache) {
+			file = p11_dict_get (gl.file_cache, pin_source);
+			if (file && !pin_file_matches (file, &sb)) {
+				p11_dict_remove (gl.file_cache, pin_source);
+				file = NULL;
+			}
+			if (file)
+				p11_atomic_add (&file->refs, 1, RELAXED);
+		}
+
+	p11_unlock ();
+
+	if (file == NULL) {
+		file = pin_file_read (pin_source);
+		if (file == NULL) {
+			/* Memory couldn't be locked, don't cache */
+			if (errno == ENOMEM)
+				return p11_kit_pin_file_callback (pin_source, pin_uri, pin_description,
+				                                  pin_flags, callback_data);
+			return NULL;
+		}
+
+		if (file->cache) {
+			p11_lock ();
+
+				if (gl.file_cache == NULL) {
+					gl.file_cache = p11_dict_new (p11_dict_str_hash, p11_dict_str_equal,
+					                              free, pin_file_unref);
+				}
+				key = strdup (pin_source);
+				if (gl.file_cache && key && p11_dict_set (gl.file_cache, key, file))
+					p11_atomic_add (&file->refs, 1, RELAXED);
+				else
+					free (key);
+
+			p11_unlock ();
+		}
+	}
+
+	pin = p11_kit_pin_new_for_buffer (file->value, file->length, pin_file_unref_value);
+	if (pin == NULL)
+		pin_file_unref (file);
+	return pin;
+
+#else /* !OS_UNIX */
+	return p11_kit_pin_file_callback (pin_source, pin_uri, pin_description,
+	                                  pin_flags, callback_data);
+#endif
+}
+
+/**
+ * p11_kit_pin_file_cache_clear:
+ *
+ * Drop all PINs cached by p11_kit_pin_file_cached_callback(). The memory
+ * they were held in is cleared once the PINs are no longer referenced.
+ */
+void
+p11_kit_pin_file_cache_clear (void)
+{
+	p11_dict *cache;
+
+	p11_lock ();
+
+		cache = gl.file_cache;
+		gl.file_cache = NULL;
+
+	p11_unlock ();
+
+	p11_dict_free (cache);
+}
+
+void
+p11_pin_init (void)
+{
+	p11_rwlock_init (&gl.registry_lock);
+}
+
+void
+p11_pin_uninit (void)
+{
+	p11_rwlock_uninit (&gl.registry_lock);
 }
 
 /**
@@ -668,12 +1045,7 @@ p11_kit_pin_get_length (P11KitPin *pin)
 P11KitPin *
 p11_kit_pin_ref (P11KitPin *pin)
 {
-	p11_lock ();
-
-		pin->ref_count++;
-
-	p11_unlock ();
-
+	p11_atomic_add (&pin->ref_count, 1, RELAXED);
 	return pin;
 }
 
@@ -687,16 +1059,7 @@ p11_kit_pin_ref (P11KitPin *pin)
 void
 p11_kit_pin_unref (P11KitPin *pin)
 {
-	bool last = false;
-
-	p11_lock ();
-
-		last = (pin->ref_count == 1);
-		pin->ref_count--;
-
-	p11_unlock ();
-
-	if (last) {
+	if (p11_atomic_sub (&pin->ref_count, 1, ACQ_REL) == 0) {
 		if (pin->destroy)
 			(pin->destroy) (pin->buffer);
 		free (pin);
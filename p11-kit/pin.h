@@ -100,6 +100,18 @@ P11KitPin*            p11_kit_pin_file_callback             (const char *pin_sou
                                                              P11KitPinFlags pin_flags,
                                                              void *callback_data);
 
+#ifdef P11_KIT_FUTURE_UNSTABLE_API
+
+P11KitPin*            p11_kit_pin_file_cached_callback      (const char *pin_source,
+                                                             P11KitUri *pin_uri,
+                                                             const char *pin_description,
+                                                             P11KitPinFlags pin_flags,
+                                                             void *callback_data);
+
+void                  p11_kit_pin_file_cache_clear          (void);
+
+#endif /* P11_KIT_FUTURE_UNSTABLE_API */
+
 #ifdef __cplusplus
 } /* extern "C" */
 #endif
@@ -37,6 +37,7 @@
 
 #include "compat.h"
 #include "pkcs11.h"
+#include "uri.h"
 
 /* These are global variables to be overridden in tests */
 extern const char *p11_config_system_file;
@@ -53,6 +54,10 @@ void        _p11_kit_default_message                            (CK_RV rv);
 
 const char * _p11_get_progname_unlocked                         (void);
 
+void         p11_pin_init                                       (void);
+
+void         p11_pin_uninit                                     (void);
+
 void        _p11_set_progname_unlocked                          (const char *progname);
 
 int          p11_match_uri_module_info                          (CK_INFO_PTR one,
@@ -64,4 +69,30 @@ int          p11_match_uri_slot_info                            (CK_SLOT_INFO_PT
 int          p11_match_uri_token_info                           (CK_TOKEN_INFO_PTR one,
                                                                  CK_TOKEN_INFO_PTR two);
 
+typedef struct p11_uri_match p11_uri_match;
+
+p11_uri_match * p11_uri_match_new                               (P11KitUri *uri);
+
+void         p11_uri_match_free                                 (p11_uri_match *match);
+
+bool         p11_uri_match_nothing                              (p11_uri_match *match);
+
+bool         p11_uri_match_any_module                           (p11_uri_match *match);
+
+bool         p11_uri_match_module                               (p11_uri_match *match,
+                                                                 CK_INFO *info);
+
+bool         p11_uri_match_slot_id                              (p11_uri_match *match,
+                                                                 CK_SLOT_ID slot_id);
+
+bool         p11_uri_match_slot                                 (p11_uri_match *match,
+                                                                 CK_SLOT_INFO *info);
+
+bool         p11_uri_match_token                                (p11_uri_match *match,
+                                                                 CK_TOKEN_INFO *info);
+
+bool         p11_uri_match_attributes                           (p11_uri_match *match,
+                                                                 CK_ATTRIBUTE *attrs,
+                                                                 CK_ULONG n_attrs);
+
 #endif /* __P11_KIT_PRIVATE_H__ */
@@ -48,27 +48,84 @@
 #include <string.h>
 #include <unistd.h>
 
+#ifdef OS_UNIX
+#include <signal.h>
+#endif
+
+static void
+print_stats (CK_FUNCTION_LIST *module)
+{
+	char *stats;
+
+	/* Standard output is used by the protocol */
+	stats = p11_kit_module_get_stats (module);
+	if (stats) {
+		fputs (stats, stderr);
+		fflush (stderr);
+		free (stats);
+	}
+}
+
+#ifdef OS_UNIX
+
+static void *
+print_stats_on_signal (void *data)
+{
+	CK_FUNCTION_LIST *module = data;
+	sigset_t set;
+	int sig;
+
+	sigemptyset (&set);
+	sigaddset (&set, SIGUSR1);
+
+	while (sigwait (&set, &sig) == 0)
+		print_stats (module);
+
+	return NULL;
+}
+
+static void
+watch_stats_signal (CK_FUNCTION_LIST *module)
+{
+	p11_thread_t thread;
+	sigset_t set;
+
+	/* Blocked here so only the thread above receives it */
+	sigemptyset (&set);
+	sigaddset (&set, SIGUSR1);
+	pthread_sigmask (SIG_BLOCK, &set, NULL);
+
+	if (p11_thread_create (&thread, print_stats_on_signal, module) != 0)
+		p11_message ("couldn't watch for the stats signal");
+}
+
+#endif /* OS_UNIX */
+
 int
 main (int argc,
       char *argv[])
 {
 	CK_FUNCTION_LIST *module;
+	bool stats = false;
 	int opt;
 	int ret;
 
 	enum {
 		opt_verbose = 'v',
+		opt_stats = 's',
 		opt_help = 'h',
 	};
 
 	struct option options[] = {
 		{ "verbose", no_argument, NULL, opt_verbose },
+		{ "stats", no_argument, NULL, opt_stats },
 		{ "help", no_argument, NULL, opt_help },
 		{ 0 },
 	};
 
 	p11_tool_desc usages[] = {
 		{ 0, "usage: p11-kit remote <module>" },
+		{ opt_stats, "print call statistics to stderr on SIGUSR1 and exit" },
 		{ 0 },
 	};
 
@@ -77,6 +134,9 @@ main (int argc,
 		case opt_verbose:
 			p11_kit_be_loud ();
 			break;
+		case opt_stats:
+			stats = true;
+			break;
 		case opt_help:
 		case '?':
 			p11_tool_usage (usages, options);
@@ -100,11 +160,19 @@ main (int argc,
 		return 2;
 	}
 
-	module = p11_kit_module_load (argv[0], 0);
+	module = p11_kit_module_load (argv[0], stats ? P11_KIT_MODULE_STATS : 0);
 	if (module == NULL)
 		return 1;
 
+#ifdef OS_UNIX
+	if (stats)
+		watch_stats_signal (module);
+#endif
+
 	ret = p11_kit_remote_serve_module (module, 0, 1);
+
+	if (stats)
+		print_stats (module);
 	p11_kit_module_release (module);
 
 	return ret;
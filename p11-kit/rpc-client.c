@@ -37,6 +37,9 @@
 
 #define P11_DEBUG_FLAG P11_DEBUG_RPC
 #include "debug.h"
+#include "array.h"
+#include "dict.h"
+#include "hash.h"
 #include "pkcs11.h"
 #include "pkcs11x.h"
 #include "library.h"
@@ -58,6 +61,14 @@ typedef struct {
 	p11_rpc_client_vtable *vtable;
 	unsigned int initialized_forkid;
 	bool initialize_done;
+
+	/* Attribute cache, protected by cache_lock */
+	bool cache_enabled;
+	p11_mutex_t cache_lock;
+	p11_dict *cache_slots;
+	p11_dict *cache_sessions;
+	p11_dict *cache;
+	unsigned int cache_generation;
 } rpc_client;
 
 /* Allocator for call session buffers */
@@ -88,6 +99,10 @@ call_prepare (rpc_client *module,
 	buffer = p11_rpc_buffer_new_full (64, log_allocator, free);
 	return_val_if_fail (buffer != NULL, CKR_GENERAL_ERROR);
 
+	/* Servers that understand the compact encoding answer in kind */
+	if (module->vtable->features & P11_RPC_FEATURE_COMPACT)
+		buffer->flags |= P11_RPC_BUFFER_COMPACT;
+
 	/* We use the same buffer for reading and writing */
 	p11_rpc_message_init (msg, buffer, buffer);
 
@@ -99,35 +114,13 @@ call_prepare (rpc_client *module,
 	return CKR_OK;
 }
 
+/* Parses a response, returning an error code sent by the other side */
 static CK_RV
-call_run (rpc_client *module,
-          p11_rpc_message *msg)
+call_parse (p11_rpc_message *msg,
+            int call_id)
 {
-	CK_RV ret = CKR_OK;
 	CK_ULONG ckerr;
 
-	int call_id;
-
-	assert (module != NULL);
-	assert (msg != NULL);
-
-	/* Did building the call fail? */
-	if (p11_buffer_failed (msg->output))
-		return_val_if_reached (CKR_HOST_MEMORY);
-
-	/* Make sure that the signature is valid */
-	assert (p11_rpc_message_is_verified (msg));
-	call_id = msg->call_id;
-
-	/* Do the transport send and receive */
-	assert (module->vtable->transport != NULL);
-	ret = (module->vtable->transport) (module->vtable,
-	                                   msg->output,
-	                                   msg->input);
-
-	if (ret != CKR_OK)
-		return ret;
-
 	if (!p11_rpc_message_parse (msg, P11_RPC_RESPONSE))
 		return CKR_DEVICE_ERROR;
 
@@ -154,6 +147,40 @@ call_run (rpc_client *module,
 	}
 
 	assert (!p11_buffer_failed (msg->input));
+	return CKR_OK;
+}
+
+static CK_RV
+call_run (rpc_client *module,
+          p11_rpc_message *msg)
+{
+	CK_RV ret = CKR_OK;
+
+	int call_id;
+
+	assert (module != NULL);
+	assert (msg != NULL);
+
+	/* Did building the call fail? */
+	if (p11_buffer_failed (msg->output))
+		return_val_if_reached (CKR_HOST_MEMORY);
+
+	/* Make sure that the signature is valid */
+	assert (p11_rpc_message_is_verified (msg));
+	call_id = msg->call_id;
+
+	/* Do the transport send and receive */
+	assert (module->vtable->transport != NULL);
+	ret = (module->vtable->transport) (module->vtable,
+	                                   msg->output,
+	                                   msg->input);
+
+	if (ret != CKR_OK)
+		return ret;
+
+	ret = call_parse (msg, call_id);
+	if (ret != CKR_OK)
+		return ret;
 
 	p11_debug ("parsing response values");
 	return CKR_OK;
@@ -196,8 +223,9 @@ proto_read_attribute_array (p11_rpc_message *msg,
                             CK_ATTRIBUTE_PTR arr,
                             CK_ULONG len)
 {
-	uint32_t i, num, value, type;
+	uint32_t i, num;
 	CK_ATTRIBUTE_PTR attr;
+	CK_ATTRIBUTE temp;
 	const unsigned char *attrval = NULL;
 	size_t attrlen = 0;
 	unsigned char validity;
@@ -230,32 +258,18 @@ proto_read_attribute_array (p11_rpc_message *msg,
 	/* We need to go ahead and read everything in all cases */
 	for (i = 0; i < num; ++i) {
 
-		/* The attribute type */
-		p11_rpc_buffer_get_uint32 (msg->input, &msg->parsed, &type);
-
-		/* Attribute validity */
-		p11_rpc_buffer_get_byte (msg->input, &msg->parsed, &validity);
-
-		/* And the data itself */
-		if (validity) {
-			if (p11_rpc_buffer_get_uint32 (msg->input, &msg->parsed, &value) &&
-			    p11_rpc_buffer_get_byte_array (msg->input, &msg->parsed, &attrval, &attrlen)) {
-				if (attrval && value != attrlen) {
-					p11_message ("attribute length does not match attribute data");
-					return PARSE_ERROR;
-				}
-				attrlen = value;
-			}
-		}
-
 		/* Don't act on this data unless no errors */
-		if (p11_buffer_failed (msg->input))
+		if (!p11_rpc_buffer_get_attribute (msg->input, &msg->parsed, &temp))
 			break;
 
+		attrval = temp.pValue;
+		attrlen = temp.ulValueLen;
+		validity = (temp.ulValueLen != (CK_ULONG)-1);
+
 		/* Try and stuff it in the output data */
 		if (arr) {
 			attr = &(arr[i]);
-			if (attr->type != type) {
+			if (attr->type != temp.type) {
 				p11_message ("returned attributes in invalid order");
 				return PARSE_ERROR;
 			}
@@ -687,6 +701,295 @@ proto_read_sesssion_info (p11_rpc_message *msg,
 	return CKR_OK;
 }
 
+/* -----------------------------------------------------------------------------
+ * ATTRIBUTE CACHE
+ *
+ * Objects on write protected tokens don't change, so their attributes
+ * can be kept on this side of the connection. Anything that could change
+ * objects, or which objects are visible, clears the cache.
+ */
+
+/* Clear the cache when it holds more attributes than this */
+#define CACHE_MAX_ATTRS 8192
+
+/* Larger templates aren't cached */
+#define CACHE_MAX_TEMPLATE 32
+
+typedef struct {
+	CK_SLOT_ID slot;
+	CK_OBJECT_HANDLE object;
+	CK_ATTRIBUTE_TYPE type;
+} cache_key;
+
+static unsigned int
+cache_key_hash (const void *data)
+{
+	uint32_t hash;
+	p11_hash_murmur3 (&hash, data, sizeof (cache_key), NULL);
+	return hash;
+}
+
+static bool
+cache_key_equal (const void *one,
+                 const void *two)
+{
+	return memcmp (one, two, sizeof (cache_key)) == 0;
+}
+
+static CK_ULONG *
+ulong_dup (CK_ULONG value)
+{
+	CK_ULONG *copy = malloc (sizeof (CK_ULONG));
+	return_val_if_fail (copy != NULL, NULL);
+	*copy = value;
+	return copy;
+}
+
+static void
+cache_reset (rpc_client *module)
+{
+	if (!module->cache_enabled)
+		return;
+
+	p11_mutex_lock (&module->cache_lock);
+	p11_dict_clear (module->cache);
+	p11_dict_clear (module->cache_sessions);
+	p11_dict_clear (module->cache_slots);
+	module->cache_generation++;
+	p11_mutex_unlock (&module->cache_lock);
+}
+
+static void
+cache_invalidate (rpc_client *module)
+{
+	if (!module->cache_enabled)
+		return;
+
+	p11_mutex_lock (&module->cache_lock);
+	p11_dict_clear (module->cache);
+	module->cache_generation++;
+	p11_mutex_unlock (&module->cache_lock);
+}
+
+/* Returns true if the session is on a write protected token */
+static bool
+cache_session_slot (rpc_client *module,
+                    CK_SESSION_HANDLE session,
+                    CK_SLOT_ID *slot)
+{
+	CK_SLOT_ID *value;
+
+	if (!module->cache_enabled)
+		return false;
+
+	p11_mutex_lock (&module->cache_lock);
+	value = p11_dict_get (module->cache_sessions, &session);
+	if (value)
+		*slot = *value;
+	p11_mutex_unlock (&module->cache_lock);
+
+	return value != NULL;
+}
+
+static CK_RV rpc_C_GetTokenInfo (CK_X_FUNCTION_LIST *self,
+                                 CK_SLOT_ID slot_id,
+                                 CK_TOKEN_INFO_PTR info);
+
+static void
+cache_open_session (CK_X_FUNCTION_LIST *self,
+                    CK_SLOT_ID slot,
+                    CK_SESSION_HANDLE session)
+{
+	rpc_client *module = ((p11_virtual *)self)->lower_module;
+	CK_TOKEN_INFO info;
+	CK_FLAGS *flags;
+	CK_FLAGS known;
+	bool have;
+
+	if (!module->cache_enabled)
+		return;
+
+	p11_mutex_lock (&module->cache_lock);
+	flags = p11_dict_get (module->cache_slots, &slot);
+	have = flags != NULL;
+	if (have)
+		known = *flags;
+	p11_mutex_unlock (&module->cache_lock);
+
+	/* Only asked for once for each slot */
+	if (!have) {
+		if (rpc_C_GetTokenInfo (self, slot, &info) != CKR_OK)
+			return;
+		known = info.flags;
+		p11_mutex_lock (&module->cache_lock);
+		if (!p11_dict_set (module->cache_slots, ulong_dup (slot), ulong_dup (known)))
+			warn_if_reached ();
+		p11_mutex_unlock (&module->cache_lock);
+	}
+
+	if (!(known & CKF_WRITE_PROTECTED))
+		return;
+
+	p11_mutex_lock (&module->cache_lock);
+	if (!p11_dict_set (module->cache_sessions, ulong_dup (session), ulong_dup (slot)))
+		warn_if_reached ();
+	p11_mutex_unlock (&module->cache_lock);
+}
+
+static void
+cache_close_session (rpc_client *module,
+                     CK_SESSION_HANDLE session)
+{
+	if (!module->cache_enabled)
+		return;
+
+	p11_mutex_lock (&module->cache_lock);
+	p11_dict_remove (module->cache_sessions, &session);
+	p11_mutex_unlock (&module->cache_lock);
+}
+
+static void
+cache_close_all_sessions (rpc_client *module,
+                          CK_SLOT_ID slot)
+{
+	CK_SESSION_HANDLE *session;
+	p11_dictiter iter;
+	CK_SLOT_ID *value;
+	bool found;
+
+	if (!module->cache_enabled)
+		return;
+
+	p11_mutex_lock (&module->cache_lock);
+	do {
+		found = false;
+		p11_dict_iterate (module->cache_sessions, &iter);
+		while (p11_dict_next (&iter, (void **)&session, (void **)&value)) {
+			if (*value == slot) {
+				p11_dict_remove (module->cache_sessions, session);
+				found = true;
+				break;
+			}
+		}
+	} while (found);
+	p11_mutex_unlock (&module->cache_lock);
+}
+
+/*
+ * Returns true if all the attributes were found in the cache. Otherwise
+ * @generation is what to pass to cache_put() with the retrieved values.
+ */
+static bool
+cache_get (rpc_client *module,
+           CK_SLOT_ID slot,
+           CK_OBJECT_HANDLE object,
+           CK_ATTRIBUTE_PTR template,
+           CK_ULONG count,
+           CK_RV *result,
+           unsigned int *generation)
+{
+	CK_ATTRIBUTE *cached[CACHE_MAX_TEMPLATE];
+	CK_ATTRIBUTE *attr;
+	cache_key key;
+	CK_RV rv = CKR_OK;
+	CK_ULONG i;
+
+	assert (count <= CACHE_MAX_TEMPLATE);
+
+	key.slot = slot;
+	key.object = object;
+
+	p11_mutex_lock (&module->cache_lock);
+
+	for (i = 0; i < count; i++) {
+		key.type = template[i].type;
+		cached[i] = p11_dict_get (module->cache, &key);
+		if (cached[i] == NULL) {
+			*generation = module->cache_generation;
+			p11_mutex_unlock (&module->cache_lock);
+			return false;
+		}
+	}
+
+	for (i = 0; i < count; i++) {
+		attr = template + i;
+		if (!attr->pValue) {
+			attr->ulValueLen = cached[i]->ulValueLen;
+		} else if (attr->ulValueLen < cached[i]->ulValueLen) {
+			attr->ulValueLen = (CK_ULONG)-1;
+			rv = CKR_BUFFER_TOO_SMALL;
+		} else {
+			memcpy (attr->pValue, cached[i]->pValue, cached[i]->ulValueLen);
+			attr->ulValueLen = cached[i]->ulValueLen;
+		}
+	}
+
+	p11_mutex_unlock (&module->cache_lock);
+
+	*result = rv;
+	return true;
+}
+
+/*
+ * Stores the attributes that were retrieved into buffers of @lengths,
+ * unless the cache was invalidated while they were being retrieved.
+ */
+static void
+cache_put (rpc_client *module,
+           CK_SLOT_ID slot,
+           CK_OBJECT_HANDLE object,
+           CK_ATTRIBUTE_PTR template,
+           CK_ULONG count,
+           CK_ULONG *lengths,
+           unsigned int generation)
+{
+	CK_ATTRIBUTE *value;
+	CK_ATTRIBUTE *attr;
+	cache_key *key;
+	CK_ULONG i;
+
+	p11_mutex_lock (&module->cache_lock);
+
+	if (module->cache_generation != generation) {
+		p11_mutex_unlock (&module->cache_lock);
+		return;
+	}
+
+	if (p11_dict_size (module->cache) + count > CACHE_MAX_ATTRS)
+		p11_dict_clear (module->cache);
+
+	for (i = 0; i < count; i++) {
+		attr = template + i;
+
+		/* Sensitive, invalid, not retrieved, or pointing to other attributes */
+		if (!attr->pValue || attr->ulValueLen == (CK_ULONG)-1 ||
+		    attr->ulValueLen > lengths[i] || (attr->type & CKF_ARRAY_ATTRIBUTE))
+			continue;
+
+		key = calloc (1, sizeof (cache_key));
+		value = malloc (sizeof (CK_ATTRIBUTE) + attr->ulValueLen);
+		if (key == NULL || value == NULL) {
+			free (key);
+			free (value);
+			warn_if_reached ();
+			break;
+		}
+
+		key->slot = slot;
+		key->object = object;
+		key->type = attr->type;
+		value->type = attr->type;
+		value->pValue = value + 1;
+		value->ulValueLen = attr->ulValueLen;
+		memcpy (value->pValue, attr->pValue, attr->ulValueLen);
+
+		if (!p11_dict_set (module->cache, key, value))
+			warn_if_reached ();
+	}
+
+	p11_mutex_unlock (&module->cache_lock);
+}
+
 /* -------------------------------------------------------------------
  * CALL MACROS
  */
@@ -714,6 +1017,15 @@ proto_read_sesssion_info (p11_rpc_message *msg,
 		return _ret; \
 	}
 
+/* For calls that could change objects or which are visible */
+#define END_WRITE_CALL \
+	_cleanup: \
+		_ret = call_done (_mod, &_msg, _ret); \
+		cache_invalidate (_mod); \
+		p11_debug ("ret: %lu", _ret); \
+		return _ret; \
+	}
+
 #define IN_BYTE(val) \
 	if (!p11_rpc_message_write_byte (&_msg, val)) \
 		{ _ret = CKR_HOST_MEMORY; goto _cleanup; }
@@ -902,6 +1214,7 @@ rpc_C_Initialize (CK_X_FUNCTION_LIST *self,
 	if (ret == CKR_OK) {
 		module->initialized_forkid = p11_forkid;
 		module->initialize_done = true;
+		cache_reset (module);
 
 	/* Server doesn't exist, initialize but don't call */
 	} else if (ret == CKR_DEVICE_REMOVED) {
@@ -969,6 +1282,7 @@ rpc_C_Finalize (CK_X_FUNCTION_LIST *self,
 	}
 
 	module->initialized_forkid = 0;
+	cache_reset (module);
 
 	p11_mutex_unlock (&module->mutex);
 
@@ -1090,7 +1404,7 @@ rpc_C_InitToken (CK_X_FUNCTION_LIST *self,
 		IN_BYTE_ARRAY (pin, pin_len);
 		IN_STRING (label);
 	PROCESS_CALL;
-	END_CALL;
+	END_WRITE_CALL;
 }
 
 static CK_RV
@@ -1109,15 +1423,11 @@ rpc_C_WaitForSlotEvent (CK_X_FUNCTION_LIST *self,
 }
 
 static CK_RV
-rpc_C_OpenSession (CK_X_FUNCTION_LIST *self,
+call_open_session (CK_X_FUNCTION_LIST *self,
                    CK_SLOT_ID slot_id,
                    CK_FLAGS flags,
-                   CK_VOID_PTR user_data,
-                   CK_NOTIFY callback,
                    CK_SESSION_HANDLE_PTR session)
 {
-	return_val_if_fail (session, CKR_ARGUMENTS_BAD);
-
 	BEGIN_CALL_OR (C_OpenSession, self, CKR_SLOT_ID_INVALID);
 		IN_ULONG (slot_id);
 		IN_ULONG (flags);
@@ -1126,24 +1436,47 @@ rpc_C_OpenSession (CK_X_FUNCTION_LIST *self,
 	END_CALL;
 }
 
+static CK_RV
+rpc_C_OpenSession (CK_X_FUNCTION_LIST *self,
+                   CK_SLOT_ID slot_id,
+                   CK_FLAGS flags,
+                   CK_VOID_PTR user_data,
+                   CK_NOTIFY callback,
+                   CK_SESSION_HANDLE_PTR session)
+{
+	CK_RV rv;
+
+	return_val_if_fail (session, CKR_ARGUMENTS_BAD);
+
+	rv = call_open_session (self, slot_id, flags, session);
+	if (rv == CKR_OK)
+		cache_open_session (self, slot_id, *session);
+
+	return rv;
+}
+
 static CK_RV
 rpc_C_CloseSession (CK_X_FUNCTION_LIST *self,
                     CK_SESSION_HANDLE session)
 {
+	cache_close_session (((p11_virtual *)self)->lower_module, session);
+
 	BEGIN_CALL_OR (C_CloseSession, self, CKR_SESSION_HANDLE_INVALID);
 		IN_ULONG (session);
 	PROCESS_CALL;
-	END_CALL;
+	END_WRITE_CALL;
 }
 
 static CK_RV
 rpc_C_CloseAllSessions (CK_X_FUNCTION_LIST *self,
                         CK_SLOT_ID slot_id)
 {
+	cache_close_all_sessions (((p11_virtual *)self)->lower_module, slot_id);
+
 	BEGIN_CALL_OR (C_CloseAllSessions, self, CKR_SLOT_ID_INVALID);
 		IN_ULONG (slot_id);
 	PROCESS_CALL;
-	END_CALL;
+	END_WRITE_CALL;
 }
 
 static CK_RV
@@ -1170,7 +1503,7 @@ rpc_C_InitPIN (CK_X_FUNCTION_LIST *self,
 		IN_ULONG (session);
 		IN_BYTE_ARRAY (pin, pin_len);
 	PROCESS_CALL;
-	END_CALL;
+	END_WRITE_CALL;
 }
 
 static CK_RV
@@ -1186,7 +1519,7 @@ rpc_C_SetPIN (CK_X_FUNCTION_LIST *self,
 		IN_BYTE_ARRAY (old_pin, old_pin_len);
 		IN_BYTE_ARRAY (new_pin, new_pin_len);
 	PROCESS_CALL;
-	END_CALL;
+	END_WRITE_CALL;
 }
 
 static CK_RV
@@ -1234,7 +1567,7 @@ rpc_C_Login (CK_X_FUNCTION_LIST *self,
 		IN_ULONG (user_type);
 		IN_BYTE_ARRAY (pin, pin_len);
 	PROCESS_CALL;
-	END_CALL;
+	END_WRITE_CALL;
 }
 
 static CK_RV
@@ -1244,7 +1577,7 @@ rpc_C_Logout (CK_X_FUNCTION_LIST *self,
 	BEGIN_CALL_OR (C_Logout, self, CKR_SESSION_HANDLE_INVALID);
 		IN_ULONG (session);
 	PROCESS_CALL;
-	END_CALL;
+	END_WRITE_CALL;
 }
 
 static CK_RV
@@ -1261,7 +1594,7 @@ rpc_C_CreateObject (CK_X_FUNCTION_LIST *self,
 		IN_ATTRIBUTE_ARRAY (template, count);
 	PROCESS_CALL;
 		OUT_ULONG (new_object);
-	END_CALL;
+	END_WRITE_CALL;
 }
 
 static CK_RV
@@ -1280,7 +1613,7 @@ rpc_C_CopyObject (CK_X_FUNCTION_LIST *self,
 		IN_ATTRIBUTE_ARRAY (template, count);
 	PROCESS_CALL;
 		OUT_ULONG (new_object);
-	END_CALL;
+	END_WRITE_CALL;
 }
 
 
@@ -1293,7 +1626,7 @@ rpc_C_DestroyObject (CK_X_FUNCTION_LIST *self,
 		IN_ULONG (session);
 		IN_ULONG (object);
 	PROCESS_CALL;
-	END_CALL;
+	END_WRITE_CALL;
 }
 
 static CK_RV
@@ -1313,11 +1646,11 @@ rpc_C_GetObjectSize (CK_X_FUNCTION_LIST *self,
 }
 
 static CK_RV
-rpc_C_GetAttributeValue (CK_X_FUNCTION_LIST *self,
-                         CK_SESSION_HANDLE session,
-                         CK_OBJECT_HANDLE object,
-                         CK_ATTRIBUTE_PTR template,
-                         CK_ULONG count)
+call_get_attribute_value (CK_X_FUNCTION_LIST *self,
+                          CK_SESSION_HANDLE session,
+                          CK_OBJECT_HANDLE object,
+                          CK_ATTRIBUTE_PTR template,
+                          CK_ULONG count)
 {
 	BEGIN_CALL_OR (C_GetAttributeValue, self, CKR_SESSION_HANDLE_INVALID);
 		IN_ULONG (session);
@@ -1328,6 +1661,46 @@ rpc_C_GetAttributeValue (CK_X_FUNCTION_LIST *self,
 	END_CALL;
 }
 
+static CK_RV
+rpc_C_GetAttributeValue (CK_X_FUNCTION_LIST *self,
+                         CK_SESSION_HANDLE session,
+                         CK_OBJECT_HANDLE object,
+                         CK_ATTRIBUTE_PTR template,
+                         CK_ULONG count)
+{
+	rpc_client *module = ((p11_virtual *)self)->lower_module;
+	CK_ULONG lengths[CACHE_MAX_TEMPLATE];
+	unsigned int generation;
+	CK_SLOT_ID slot;
+	CK_ULONG i;
+	CK_RV rv;
+
+	if (count == 0 || count > CACHE_MAX_TEMPLATE || template == NULL ||
+	    !cache_session_slot (module, session, &slot))
+		return call_get_attribute_value (self, session, object, template, count);
+
+	if (cache_get (module, slot, object, template, count, &rv, &generation))
+		return rv;
+
+	for (i = 0; i < count; i++)
+		lengths[i] = template[i].ulValueLen;
+
+	rv = call_get_attribute_value (self, session, object, template, count);
+
+	switch (rv) {
+	case CKR_OK:
+	case CKR_ATTRIBUTE_SENSITIVE:
+	case CKR_ATTRIBUTE_TYPE_INVALID:
+	case CKR_BUFFER_TOO_SMALL:
+		cache_put (module, slot, object, template, count, lengths, generation);
+		break;
+	default:
+		break;
+	}
+
+	return rv;
+}
+
 static CK_RV
 rpc_C_SetAttributeValue (CK_X_FUNCTION_LIST *self,
                          CK_SESSION_HANDLE session,
@@ -1340,7 +1713,7 @@ rpc_C_SetAttributeValue (CK_X_FUNCTION_LIST *self,
 		IN_ULONG (object);
 		IN_ATTRIBUTE_ARRAY (template, count);
 	PROCESS_CALL;
-	END_CALL;
+	END_WRITE_CALL;
 }
 
 static CK_RV
@@ -1870,7 +2243,7 @@ rpc_C_GenerateKey (CK_X_FUNCTION_LIST *self,
 		IN_ATTRIBUTE_ARRAY (template, count);
 	PROCESS_CALL;
 		OUT_ULONG (key);
-	END_CALL;
+	END_WRITE_CALL;
 }
 
 static CK_RV
@@ -1892,7 +2265,7 @@ rpc_C_GenerateKeyPair (CK_X_FUNCTION_LIST *self,
 	PROCESS_CALL;
 		OUT_ULONG (pub_key);
 		OUT_ULONG (priv_key);
-	END_CALL;
+	END_WRITE_CALL;
 }
 
 static CK_RV
@@ -1936,7 +2309,7 @@ rpc_C_UnwrapKey (CK_X_FUNCTION_LIST *self,
 		IN_ATTRIBUTE_ARRAY (template, count);
 	PROCESS_CALL;
 		OUT_ULONG (key);
-	END_CALL;
+	END_WRITE_CALL;
 }
 
 static CK_RV
@@ -1955,7 +2328,7 @@ rpc_C_DeriveKey (CK_X_FUNCTION_LIST *self,
 		IN_ATTRIBUTE_ARRAY (template, count);
 	PROCESS_CALL;
 		OUT_ULONG (key);
-	END_CALL;
+	END_WRITE_CALL;
 }
 
 static CK_RV
@@ -2060,6 +2433,12 @@ static void
 rpc_client_free (void *data)
 {
 	rpc_client *client = data;
+	if (client->cache_enabled) {
+		p11_dict_free (client->cache);
+		p11_dict_free (client->cache_sessions);
+		p11_dict_free (client->cache_slots);
+		p11_mutex_uninit (&client->cache_lock);
+	}
 	p11_mutex_uninit (&client->mutex);
 	free (client);
 }
@@ -2088,3 +2467,546 @@ p11_rpc_client_init (p11_virtual *virt,
 	p11_virtual_init (virt, &rpc_functions, client, rpc_client_free);
 	return true;
 }
+
+/*
+ * Cache attributes of objects on write protected tokens. This must be
+ * called before the module is initialized.
+ */
+bool
+p11_rpc_client_set_cache (p11_virtual *virt)
+{
+	rpc_client *client;
+
+	return_val_if_fail (virt != NULL, false);
+	return_val_if_fail (virt->funcs.C_GetInfo == rpc_functions.C_GetInfo, false);
+
+	client = virt->lower_module;
+	return_val_if_fail (client->initialized_forkid == 0, false);
+
+	if (client->cache_enabled)
+		return true;
+
+	client->cache = p11_dict_new (cache_key_hash, cache_key_equal, free, free);
+	client->cache_sessions = p11_dict_new (p11_dict_ulongptr_hash, p11_dict_ulongptr_equal, free, free);
+	client->cache_slots = p11_dict_new (p11_dict_ulongptr_hash, p11_dict_ulongptr_equal, free, free);
+	return_val_if_fail (client->cache && client->cache_sessions && client->cache_slots, false);
+
+	p11_mutex_init (&client->cache_lock);
+	client->cache_enabled = true;
+	return true;
+}
+
+/* -----------------------------------------------------------------------------
+ * BATCHED CALLS
+ */
+
+/* The most references a single call in a batch can have */
+#define BATCH_REFS 8
+
+typedef struct {
+	unsigned char argument;
+	unsigned char flags;
+	uint32_t source;
+	uint32_t index;
+} batch_ref;
+
+typedef struct {
+	int call_id;
+	CK_ULONG args[P11_RPC_BATCH_ARGS];
+	CK_ATTRIBUTE *template;
+	CK_ULONG count;
+
+	/* Handles returned by the call, which later calls can use */
+	CK_ULONG *results;
+	CK_ULONG max_results;
+	CK_ULONG *n_results;
+
+	batch_ref refs[BATCH_REFS];
+	unsigned int n_refs;
+	CK_RV rv;
+} batch_call;
+
+struct _p11_rpc_batch {
+	CK_X_FUNCTION_LIST *module;
+	rpc_client *client;
+	p11_array *calls;
+};
+
+p11_rpc_batch *
+p11_rpc_batch_new (CK_X_FUNCTION_LIST *rpc_module)
+{
+	p11_rpc_batch *batch;
+
+	return_val_if_fail (rpc_module != NULL, NULL);
+
+	/* Only works with a module set up by p11_rpc_client_init() */
+	return_val_if_fail (rpc_module->C_GetInfo == rpc_functions.C_GetInfo, NULL);
+
+	batch = calloc (1, sizeof (p11_rpc_batch));
+	return_val_if_fail (batch != NULL, NULL);
+
+	batch->module = rpc_module;
+	batch->client = ((p11_virtual *)rpc_module)->lower_module;
+	batch->calls = p11_array_new (free);
+	return_val_if_fail (batch->calls != NULL, NULL);
+
+	return batch;
+}
+
+static batch_call *
+batch_add (p11_rpc_batch *batch,
+           int call_id,
+           CK_SESSION_HANDLE session)
+{
+	batch_call *call;
+
+	return_val_if_fail (batch->calls->num < P11_RPC_BATCH_MAX, NULL);
+
+	call = calloc (1, sizeof (batch_call));
+	return_val_if_fail (call != NULL, NULL);
+
+	call->call_id = call_id;
+	call->args[0] = session;
+	call->rv = CKR_FUNCTION_CANCELED;
+
+	if (!p11_array_push (batch->calls, call))
+		return_val_if_reached (NULL);
+
+	return call;
+}
+
+int
+p11_rpc_batch_open_session (p11_rpc_batch *batch,
+                            CK_SLOT_ID slot,
+                            CK_FLAGS flags,
+                            CK_SESSION_HANDLE *session)
+{
+	batch_call *call;
+
+	return_val_if_fail (batch != NULL, -1);
+	return_val_if_fail (session != NULL, -1);
+
+	call = batch_add (batch, P11_RPC_CALL_C_OpenSession, slot);
+	return_val_if_fail (call != NULL, -1);
+
+	call->args[1] = flags;
+	call->results = session;
+	call->max_results = 1;
+	return batch->calls->num - 1;
+}
+
+int
+p11_rpc_batch_close_session (p11_rpc_batch *batch,
+                             CK_SESSION_HANDLE session)
+{
+	return_val_if_fail (batch != NULL, -1);
+
+	if (!batch_add (batch, P11_RPC_CALL_C_CloseSession, session))
+		return_val_if_reached (-1);
+	return batch->calls->num - 1;
+}
+
+int
+p11_rpc_batch_find_objects_init (p11_rpc_batch *batch,
+                                 CK_SESSION_HANDLE session,
+                                 CK_ATTRIBUTE *match,
+                                 CK_ULONG count)
+{
+	batch_call *call;
+
+	return_val_if_fail (batch != NULL, -1);
+	return_val_if_fail (match != NULL || count == 0, -1);
+
+	call = batch_add (batch, P11_RPC_CALL_C_FindObjectsInit, session);
+	return_val_if_fail (call != NULL, -1);
+
+	call->template = match;
+	call->count = count;
+	return batch->calls->num - 1;
+}
+
+int
+p11_rpc_batch_find_objects (p11_rpc_batch *batch,
+                            CK_SESSION_HANDLE session,
+                            CK_OBJECT_HANDLE *objects,
+                            CK_ULONG max_count,
+                            CK_ULONG *count)
+{
+	batch_call *call;
+
+	return_val_if_fail (batch != NULL, -1);
+	return_val_if_fail (objects != NULL, -1);
+	return_val_if_fail (count != NULL, -1);
+
+	call = batch_add (batch, P11_RPC_CALL_C_FindObjects, session);
+	return_val_if_fail (call != NULL, -1);
+
+	call->results = objects;
+	call->max_results = max_count;
+	call->n_results = count;
+	return batch->calls->num - 1;
+}
+
+int
+p11_rpc_batch_find_objects_final (p11_rpc_batch *batch,
+                                  CK_SESSION_HANDLE session)
+{
+	return_val_if_fail (batch != NULL, -1);
+
+	if (!batch_add (batch, P11_RPC_CALL_C_FindObjectsFinal, session))
+		return_val_if_reached (-1);
+	return batch->calls->num - 1;
+}
+
+int
+p11_rpc_batch_get_attribute_value (p11_rpc_batch *batch,
+                                   CK_SESSION_HANDLE session,
+                                   CK_OBJECT_HANDLE object,
+                                   CK_ATTRIBUTE *template,
+                                   CK_ULONG count)
+{
+	batch_call *call;
+
+	return_val_if_fail (batch != NULL, -1);
+	return_val_if_fail (template != NULL, -1);
+	return_val_if_fail (count != 0, -1);
+
+	call = batch_add (batch, P11_RPC_CALL_C_GetAttributeValue, session);
+	return_val_if_fail (call != NULL, -1);
+
+	call->args[1] = object;
+	call->template = template;
+	call->count = count;
+	return batch->calls->num - 1;
+}
+
+static void
+batch_refer (p11_rpc_batch *batch,
+             int argument,
+             int flags,
+             int source,
+             CK_ULONG index)
+{
+	batch_call *call;
+	batch_ref *ref;
+
+	return_if_fail (batch->calls->num > 0);
+	call = batch->calls->elem[batch->calls->num - 1];
+
+	/* Only calls that return handles can be referred to */
+	return_if_fail (source >= 0 && source < batch->calls->num - 1);
+	return_if_fail (((batch_call *)batch->calls->elem[source])->results != NULL);
+	return_if_fail (argument >= 0 && argument < P11_RPC_BATCH_ARGS);
+	return_if_fail (index <= UINT32_MAX);
+	return_if_fail (call->n_refs < BATCH_REFS);
+
+	ref = call->refs + call->n_refs++;
+	ref->argument = argument;
+	ref->flags = flags;
+	ref->source = source;
+	ref->index = index;
+}
+
+/*
+ * The last call added uses the handle at @index returned by an earlier
+ * @call, in place of its @argument (counting the handle and number
+ * arguments of the call). The call is skipped if there's no such handle.
+ */
+void
+p11_rpc_batch_use (p11_rpc_batch *batch,
+                   int argument,
+                   int call,
+                   CK_ULONG index)
+{
+	return_if_fail (batch != NULL);
+	batch_refer (batch, argument, P11_RPC_BATCH_SUBSTITUTE, call, index);
+}
+
+/* The last call added is skipped if an earlier @call returned a handle at @index */
+void
+p11_rpc_batch_unless (p11_rpc_batch *batch,
+                      int call,
+                      CK_ULONG index)
+{
+	return_if_fail (batch != NULL);
+	batch_refer (batch, 0, P11_RPC_BATCH_ABSENT, call, index);
+}
+
+static CK_ULONG
+batch_call_outputs (batch_call *call)
+{
+	if (call->rv != CKR_OK || call->results == NULL)
+		return 0;
+	return call->n_results ? *call->n_results : 1;
+}
+
+/* Returns false if the call should be skipped */
+static bool
+batch_resolve (p11_rpc_batch *batch,
+               batch_call *call)
+{
+	batch_call *source;
+	batch_ref *ref;
+	bool present;
+	bool skip = false;
+	unsigned int i;
+
+	for (i = 0; i < call->n_refs; i++) {
+		ref = call->refs + i;
+		source = batch->calls->elem[ref->source];
+		present = ref->index < batch_call_outputs (source);
+
+		if (ref->flags & P11_RPC_BATCH_ABSENT)
+			skip = skip || present;
+		else
+			skip = skip || !present;
+
+		if (present && (ref->flags & P11_RPC_BATCH_SUBSTITUTE))
+			call->args[ref->argument] = source->results[ref->index];
+	}
+
+	return !skip;
+}
+
+static CK_RV
+batch_call_direct (CK_X_FUNCTION_LIST *self,
+                   batch_call *call)
+{
+	switch (call->call_id) {
+	case P11_RPC_CALL_C_OpenSession:
+		return rpc_C_OpenSession (self, call->args[0], call->args[1],
+		                          NULL, NULL, call->results);
+	case P11_RPC_CALL_C_CloseSession:
+		return rpc_C_CloseSession (self, call->args[0]);
+	case P11_RPC_CALL_C_FindObjectsInit:
+		return rpc_C_FindObjectsInit (self, call->args[0],
+		                              call->template, call->count);
+	case P11_RPC_CALL_C_FindObjects:
+		return rpc_C_FindObjects (self, call->args[0], call->results,
+		                          call->max_results, call->n_results);
+	case P11_RPC_CALL_C_FindObjectsFinal:
+		return rpc_C_FindObjectsFinal (self, call->args[0]);
+	case P11_RPC_CALL_C_GetAttributeValue:
+		return rpc_C_GetAttributeValue (self, call->args[0], call->args[1],
+		                                call->template, call->count);
+	default:
+		assert_not_reached ();
+		return CKR_GENERAL_ERROR;
+	}
+}
+
+static void
+batch_write_call (p11_buffer *envelope,
+                  batch_call *call,
+                  unsigned int features)
+{
+	p11_rpc_message msg;
+	p11_buffer request;
+	batch_ref *ref;
+	unsigned int i;
+	bool ok;
+
+	p11_rpc_buffer_add_byte (envelope, call->n_refs);
+	for (i = 0; i < call->n_refs; i++) {
+		ref = call->refs + i;
+		p11_rpc_buffer_add_byte (envelope, ref->argument);
+		p11_rpc_buffer_add_byte (envelope, ref->flags);
+		p11_rpc_buffer_add_uint32 (envelope, ref->source);
+		p11_rpc_buffer_add_uint32 (envelope, ref->index);
+	}
+
+	p11_buffer_init (&request, 64);
+	if (features & P11_RPC_FEATURE_COMPACT)
+		request.flags |= P11_RPC_BUFFER_COMPACT;
+	p11_rpc_message_init (&msg, &request, &request);
+
+	/* Handles that come from earlier calls are filled in by the server */
+	ok = p11_rpc_message_prep (&msg, call->call_id, P11_RPC_REQUEST) &&
+	     p11_rpc_message_write_ulong (&msg, call->args[0]);
+
+	switch (call->call_id) {
+	case P11_RPC_CALL_C_OpenSession:
+		ok = ok && p11_rpc_message_write_ulong (&msg, call->args[1]);
+		break;
+	case P11_RPC_CALL_C_FindObjectsInit:
+		ok = ok && p11_rpc_message_write_attribute_array (&msg, call->template, call->count);
+		break;
+	case P11_RPC_CALL_C_FindObjects:
+		ok = ok && p11_rpc_message_write_ulong_buffer (&msg, call->max_results);
+		break;
+	case P11_RPC_CALL_C_GetAttributeValue:
+		ok = ok && p11_rpc_message_write_ulong (&msg, call->args[1]) &&
+		     p11_rpc_message_write_attribute_buffer (&msg, call->template, call->count);
+		break;
+	default:
+		break;
+	}
+
+	if (ok) {
+		assert (p11_rpc_message_is_verified (&msg));
+		p11_rpc_buffer_add_byte_array (envelope, request.data, request.len);
+	} else {
+		p11_buffer_fail (envelope);
+	}
+
+	p11_rpc_message_clear (&msg);
+	p11_buffer_uninit (&request);
+}
+
+static CK_RV
+batch_read_call (batch_call *call,
+                 const unsigned char *data,
+                 size_t length)
+{
+	p11_rpc_message msg;
+	p11_buffer response;
+	CK_RV ret;
+
+	p11_buffer_init (&response, length);
+	p11_buffer_add (&response, data, length);
+	p11_rpc_message_init (&msg, &response, &response);
+
+	ret = call_parse (&msg, call->call_id);
+	if (ret == CKR_OK) {
+		switch (call->call_id) {
+		case P11_RPC_CALL_C_OpenSession:
+			if (!p11_rpc_message_read_ulong (&msg, call->results))
+				ret = PARSE_ERROR;
+			break;
+		case P11_RPC_CALL_C_FindObjects:
+			ret = proto_read_ulong_array (&msg, call->results, call->n_results,
+			                              call->max_results);
+			break;
+		case P11_RPC_CALL_C_GetAttributeValue:
+			ret = proto_read_attribute_array (&msg, call->template, call->count);
+			break;
+		default:
+			break;
+		}
+	}
+
+	if (ret == CKR_OK && p11_buffer_failed (msg.input))
+		ret = PARSE_ERROR;
+
+	p11_rpc_message_clear (&msg);
+	p11_buffer_uninit (&response);
+	return ret;
+}
+
+static CK_RV
+batch_run_remote (p11_rpc_batch *batch)
+{
+	const unsigned char *data;
+	unsigned char valid;
+	unsigned char ran;
+	p11_rpc_message msg;
+	p11_buffer envelope;
+	p11_buffer reply;
+	batch_call *call;
+	uint32_t n_calls;
+	size_t offset;
+	size_t length;
+	CK_RV ret;
+	int i;
+
+	p11_buffer_init (&envelope, 256);
+	p11_rpc_buffer_add_uint32 (&envelope, batch->calls->num);
+	for (i = 0; i < batch->calls->num; i++)
+		batch_write_call (&envelope, batch->calls->elem[i],
+		                  batch->client->vtable->features);
+
+	if (p11_buffer_failed (&envelope)) {
+		p11_buffer_uninit (&envelope);
+		return_val_if_reached (CKR_HOST_MEMORY);
+	}
+
+	ret = call_prepare (batch->client, &msg, P11_RPC_CALL_X_Batch);
+	if (ret != CKR_OK) {
+		p11_buffer_uninit (&envelope);
+		return ret;
+	}
+
+	if (!p11_rpc_message_write_byte_array (&msg, envelope.data, envelope.len))
+		ret = CKR_HOST_MEMORY;
+	p11_buffer_uninit (&envelope);
+
+	if (ret == CKR_OK)
+		ret = call_run (batch->client, &msg);
+
+	if (ret == CKR_OK) {
+		assert (p11_rpc_message_verify_part (&msg, "ay"));
+		if (!p11_rpc_buffer_get_byte (msg.input, &msg.parsed, &valid) || !valid ||
+		    !p11_rpc_buffer_get_byte_array (msg.input, &msg.parsed, &data, &length))
+			ret = PARSE_ERROR;
+	}
+
+	if (ret == CKR_OK) {
+		p11_buffer_init_full (&reply, (void *)data, length, 0, NULL, NULL);
+		offset = 0;
+
+		if (!p11_rpc_buffer_get_uint32 (&reply, &offset, &n_calls) ||
+		    n_calls != batch->calls->num)
+			ret = PARSE_ERROR;
+
+		for (i = 0; ret == CKR_OK && i < batch->calls->num; i++) {
+			call = batch->calls->elem[i];
+			if (!p11_rpc_buffer_get_byte (&reply, &offset, &ran)) {
+				ret = PARSE_ERROR;
+			} else if (!ran) {
+				call->rv = CKR_FUNCTION_CANCELED;
+			} else if (!p11_rpc_buffer_get_byte_array (&reply, &offset, &data, &length)) {
+				ret = PARSE_ERROR;
+			} else {
+				call->rv = batch_read_call (call, data, length);
+			}
+		}
+	}
+
+	return call_done (batch->client, &msg, ret);
+}
+
+/*
+ * Runs the calls in order, in a single round trip when the server
+ * supports it. The result of each call is available afterwards with
+ * p11_rpc_batch_result(), and skipped calls fail with
+ * CKR_FUNCTION_CANCELED.
+ */
+CK_RV
+p11_rpc_batch_run (p11_rpc_batch *batch)
+{
+	batch_call *call;
+	int i;
+
+	return_val_if_fail (batch != NULL, CKR_ARGUMENTS_BAD);
+
+	if (batch->client->vtable->features & P11_RPC_FEATURE_BATCH)
+		return batch_run_remote (batch);
+
+	for (i = 0; i < batch->calls->num; i++) {
+		call = batch->calls->elem[i];
+		if (batch_resolve (batch, call))
+			call->rv = batch_call_direct (batch->module, call);
+		else
+			call->rv = CKR_FUNCTION_CANCELED;
+	}
+
+	return CKR_OK;
+}
+
+CK_RV
+p11_rpc_batch_result (p11_rpc_batch *batch,
+                      int call)
+{
+	return_val_if_fail (batch != NULL, CKR_ARGUMENTS_BAD);
+	return_val_if_fail (call >= 0 && call < batch->calls->num, CKR_ARGUMENTS_BAD);
+	return ((batch_call *)batch->calls->elem[call])->rv;
+}
+
+void
+p11_rpc_batch_free (p11_rpc_batch *batch)
+{
+	if (batch == NULL)
+		return;
+	p11_array_free (batch->calls);
+	free (batch);
+}
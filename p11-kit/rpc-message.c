@@ -139,6 +139,8 @@ p11_rpc_message_prep (p11_rpc_message *msg,
 	msg->call_type = type;
 
 	/* Encode the two of them */
+	if (msg->output->flags & P11_RPC_BUFFER_COMPACT)
+		p11_rpc_buffer_add_byte (msg->output, P11_RPC_COMPACT_MARK);
 	p11_rpc_buffer_add_uint32 (msg->output, call_id);
 	if (msg->signature) {
 		len = strlen (msg->signature);
@@ -162,6 +164,17 @@ p11_rpc_message_parse (p11_rpc_message *msg,
 
 	msg->parsed = 0;
 
+	/* Responses are encoded the same way as the request */
+	if (msg->input->len > 0 &&
+	    ((unsigned char *)msg->input->data)[0] == P11_RPC_COMPACT_MARK) {
+		msg->input->flags |= P11_RPC_BUFFER_COMPACT;
+		msg->output->flags |= P11_RPC_BUFFER_COMPACT;
+		msg->parsed = 1;
+	} else {
+		msg->input->flags &= ~P11_RPC_BUFFER_COMPACT;
+		msg->output->flags &= ~P11_RPC_BUFFER_COMPACT;
+	}
+
 	/* Pull out the call identifier */
 	if (!p11_rpc_buffer_get_uint32 (msg->input, &msg->parsed, &call_id)) {
 		p11_message ("invalid message: couldn't read call identifier");
@@ -255,7 +268,6 @@ p11_rpc_message_write_attribute_array (p11_rpc_message *msg,
 {
 	CK_ULONG i;
 	CK_ATTRIBUTE_PTR attr;
-	unsigned char validity;
 
 	assert (num == 0 || arr != NULL);
 	assert (msg != NULL);
@@ -270,18 +282,7 @@ p11_rpc_message_write_attribute_array (p11_rpc_message *msg,
 	for (i = 0; i < num; ++i) {
 		attr = &(arr[i]);
 
-		/* The attribute type */
-		p11_rpc_buffer_add_uint32 (msg->output, attr->type);
-
-		/* Write out the attribute validity */
-		validity = (((CK_LONG)attr->ulValueLen) == -1) ? 0 : 1;
-		p11_rpc_buffer_add_byte (msg->output, validity);
-
-		/* The attribute length and value */
-		if (validity) {
-			p11_rpc_buffer_add_uint32 (msg->output, attr->ulValueLen);
-			p11_rpc_buffer_add_byte_array (msg->output, attr->pValue, attr->ulValueLen);
-		}
+		p11_rpc_buffer_add_attribute (msg->output, attr);
 	}
 
 	return !p11_buffer_failed (msg->output);
@@ -326,6 +327,13 @@ p11_rpc_message_read_ulong (p11_rpc_message *msg,
 
 	if (!p11_rpc_buffer_get_uint64 (msg->input, &msg->parsed, &v))
 		return false;
+
+	/* In a batch, arguments can be results of earlier calls */
+	if (msg->substitutes && msg->ulongs_read < P11_RPC_BATCH_ARGS &&
+	    msg->substitute_mask & (1U << msg->ulongs_read))
+		v = msg->substitutes[msg->ulongs_read];
+	msg->ulongs_read++;
+
 	if (val)
 		*val = (CK_ULONG)v;
 	return true;
@@ -341,6 +349,11 @@ p11_rpc_message_write_ulong (p11_rpc_message *msg,
 	/* Make sure this is in the rigth order */
 	assert (!msg->signature || p11_rpc_message_verify_part (msg, "u"));
 	p11_rpc_buffer_add_uint64 (msg->output, val);
+
+	/* In a batch, later calls can use these results */
+	if (msg->outputs)
+		p11_buffer_add (msg->outputs, &val, sizeof (val));
+
 	return !p11_buffer_failed (msg->output);
 }
 
@@ -414,6 +427,8 @@ p11_rpc_message_write_ulong_array (p11_rpc_message *msg,
 	if (array) {
 		for (i = 0; i < n_array; ++i)
 			p11_rpc_buffer_add_uint64 (msg->output, array[i]);
+		if (msg->outputs)
+			p11_buffer_add (msg->outputs, array, n_array * sizeof (CK_ULONG));
 	}
 
 	return !p11_buffer_failed (msg->output);
@@ -633,6 +648,77 @@ p11_rpc_buffer_get_uint16 (p11_buffer *buf,
 	return true;
 }
 
+static void
+buffer_add_varint (p11_buffer *buffer,
+                   uint64_t value)
+{
+	unsigned char data[10];
+	size_t len = 0;
+
+	do {
+		data[len] = value & 0x7f;
+		value >>= 7;
+		if (value)
+			data[len] |= 0x80;
+		len++;
+	} while (value);
+
+	p11_buffer_add (buffer, data, len);
+}
+
+static bool
+buffer_get_varint (p11_buffer *buf,
+                   size_t *offset,
+                   uint64_t *value)
+{
+	const unsigned char *ptr = buf->data;
+	uint64_t result = 0;
+	size_t off = *offset;
+	int shift;
+
+	for (shift = 0; shift < 64 && off < buf->len; shift += 7) {
+		result |= (uint64_t)(ptr[off] & 0x7f) << shift;
+		if ((ptr[off++] & 0x80) == 0) {
+			if (value != NULL)
+				*value = result;
+			*offset = off;
+			return true;
+		}
+	}
+
+	p11_buffer_fail (buf);
+	return false;
+}
+
+/*
+ * In the compact encoding numbers are zigzag encoded, so that values like
+ * (CK_ULONG)-1 and 0xffffffff are as short as small ones.
+ */
+
+static inline uint64_t
+zigzag64 (uint64_t value)
+{
+	return (value << 1) ^ (uint64_t)((int64_t)value >> 63);
+}
+
+static inline uint64_t
+unzigzag64 (uint64_t value)
+{
+	return (value >> 1) ^ (~(value & 1) + 1);
+}
+
+static inline uint32_t
+zigzag32 (uint32_t value)
+{
+	return (value << 1) ^ (uint32_t)((int32_t)value >> 31);
+}
+
+static inline uint32_t
+unzigzag32 (uint32_t value)
+{
+	return (value >> 1) ^ (~(value & 1) + 1);
+}
+
 void
 p11_rpc_buffer_encode_uint32 (unsigned char* data,
                           uint32_t value)
@@ -655,6 +741,10 @@ p11_rpc_buffer_add_uint32 (p11_buffer *buffer,
                            uint32_t value)
 {
 	size_t offset = buffer->len;
+	if (buffer->flags & P11_RPC_BUFFER_COMPACT) {
+		buffer_add_varint (buffer, zigzag32 (value));
+		return;
+	}
 	if (!p11_buffer_append (buffer, 4))
 		return_val_if_reached ();
 	p11_rpc_buffer_set_uint32 (buffer, offset, value);
@@ -681,6 +771,18 @@ p11_rpc_buffer_get_uint32 (p11_buffer *buf,
                            uint32_t *value)
 {
 	unsigned char *ptr;
+	uint64_t val;
+	if (buf->flags & P11_RPC_BUFFER_COMPACT) {
+		if (!buffer_get_varint (buf, offset, &val))
+			return false;
+		if (val > UINT32_MAX) {
+			p11_buffer_fail (buf);
+			return false;
+		}
+		if (value != NULL)
+			*value = unzigzag32 (val);
+		return true;
+	}
 	if (buf->len < 4 || *offset > buf->len - 4) {
 		p11_buffer_fail (buf);
 		return false;
@@ -696,6 +798,10 @@ void
 p11_rpc_buffer_add_uint64 (p11_buffer *buffer,
                            uint64_t value)
 {
+	if (buffer->flags & P11_RPC_BUFFER_COMPACT) {
+		buffer_add_varint (buffer, zigzag64 (value));
+		return;
+	}
 	p11_rpc_buffer_add_uint32 (buffer, ((value >> 32) & 0xffffffff));
 	p11_rpc_buffer_add_uint32 (buffer, (value & 0xffffffff));
 }
@@ -707,6 +813,14 @@ p11_rpc_buffer_get_uint64 (p11_buffer *buf,
 {
 	size_t off = *offset;
 	uint32_t a, b;
+	uint64_t val;
+	if (buf->flags & P11_RPC_BUFFER_COMPACT) {
+		if (!buffer_get_varint (buf, offset, &val))
+			return false;
+		if (value != NULL)
+			*value = unzigzag64 (val);
+		return true;
+	}
 	if (!p11_rpc_buffer_get_uint32 (buf, &off, &a) ||
 	    !p11_rpc_buffer_get_uint32 (buf, &off, &b))
 		return false;
@@ -767,3 +881,113 @@ p11_rpc_buffer_get_byte_array (p11_buffer *buf,
 
 	return true;
 }
+
+/*
+ * An attribute is its type, and whether it's valid. Valid ones have a
+ * length, and a value unless only the length is being passed.
+ *
+ * In the compact encoding the validity, length and whether there's a
+ * value are all in one number: zero if invalid, otherwise the length
+ * times two, plus one if the value follows, plus one.
+ */
+void
+p11_rpc_buffer_add_attribute (p11_buffer *buffer,
+                              const CK_ATTRIBUTE *attr)
+{
+	unsigned char validity;
+
+	/* The attribute type */
+	p11_rpc_buffer_add_uint32 (buffer, attr->type);
+
+	validity = (((CK_LONG)attr->ulValueLen) == -1) ? 0 : 1;
+
+	if (buffer->flags & P11_RPC_BUFFER_COMPACT) {
+		if (!validity) {
+			buffer_add_varint (buffer, 0);
+		} else if (attr->ulValueLen >= 0x7fffffff) {
+			p11_buffer_fail (buffer);
+		} else {
+			buffer_add_varint (buffer, ((uint64_t)attr->ulValueLen << 1 |
+			                            (attr->pValue ? 1 : 0)) + 1);
+			if (attr->pValue)
+				p11_buffer_add (buffer, attr->pValue, attr->ulValueLen);
+		}
+		return;
+	}
+
+	/* Write out the attribute validity */
+	p11_rpc_buffer_add_byte (buffer, validity);
+
+	/* The attribute length and value */
+	if (validity) {
+		p11_rpc_buffer_add_uint32 (buffer, attr->ulValueLen);
+		p11_rpc_buffer_add_byte_array (buffer, attr->pValue, attr->ulValueLen);
+	}
+}
+
+/* The value points into the buffer, and is NULL when not present */
+bool
+p11_rpc_buffer_get_attribute (p11_buffer *buf,
+                              size_t *offset,
+                              CK_ATTRIBUTE *attr)
+{
+	const unsigned char *data;
+	unsigned char validity;
+	size_t off = *offset;
+	uint32_t type;
+	uint32_t length;
+	uint64_t header;
+	size_t n_data;
+
+	if (!p11_rpc_buffer_get_uint32 (buf, &off, &type))
+		return false;
+
+	if (buf->flags & P11_RPC_BUFFER_COMPACT) {
+		if (!buffer_get_varint (buf, &off, &header))
+			return false;
+		if (header == 0) {
+			validity = 0;
+		} else if (--header >> 1 >= 0x7fffffff) {
+			p11_buffer_fail (buf);
+			return false;
+		} else {
+			validity = 1;
+			length = header >> 1;
+			data = NULL;
+			if (header & 1) {
+				if (buf->len < length || off > buf->len - length) {
+					p11_buffer_fail (buf);
+					return false;
+				}
+				data = (unsigned char *)buf->data + off;
+				off += length;
+			}
+		}
+
+	} else {
+		if (!p11_rpc_buffer_get_byte (buf, &off, &validity))
+			return false;
+		if (validity) {
+			if (!p11_rpc_buffer_get_uint32 (buf, &off, &length) ||
+			    !p11_rpc_buffer_get_byte_array (buf, &off, &data, &n_data))
+				return false;
+			if (data != NULL && n_data != length) {
+				p11_message ("attribute length and data do not match");
+				p11_buffer_fail (buf);
+				return false;
+			}
+		}
+	}
+
+	attr->type = type;
+	if (validity) {
+		attr->pValue = (void *)data;
+		attr->ulValueLen = length;
+	} else {
+		attr->pValue = NULL;
+		attr->ulValueLen = (CK_ULONG)-1;
+	}
+
+	*offset = off;
+	return true;
+}
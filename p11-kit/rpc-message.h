@@ -113,6 +113,9 @@ enum {
 	P11_RPC_CALL_C_GenerateRandom,
 	P11_RPC_CALL_C_WaitForSlotEvent,
 
+	/* Only used when the server supports P11_RPC_FEATURE_BATCH */
+	P11_RPC_CALL_X_Batch,
+
 	P11_RPC_CALL_MAX
 };
 
@@ -202,6 +205,7 @@ static const p11_rpc_call p11_rpc_calls[] = {
 	{ P11_RPC_CALL_C_SeedRandom,           "C_SeedRandom",           "uay",     ""                     },
 	{ P11_RPC_CALL_C_GenerateRandom,       "C_GenerateRandom",       "ufy",     "ay"                   },
 	{ P11_RPC_CALL_C_WaitForSlotEvent,     "C_WaitForSlotEvent",     "u",       "u"                    },
+	{ P11_RPC_CALL_X_Batch,                "X_Batch",                "ay",      "ay"                   },
 };
 
 #ifdef _DEBUG
@@ -230,8 +234,36 @@ typedef struct {
 	size_t parsed;
 	const char *sigverify;
 	void *extra;
+
+	/* Used for calls in a batch, see rpc-server.c */
+	const CK_ULONG *substitutes;
+	unsigned int substitute_mask;
+	unsigned int ulongs_read;
+	p11_buffer *outputs;
 } p11_rpc_message;
 
+/*
+ * Set on buffers holding messages in the compact encoding, where numbers
+ * are zigzag varints and attributes have shorter headers. This is above
+ * the generic p11_buffer flags. Only used with P11_RPC_FEATURE_COMPACT.
+ */
+#define P11_RPC_BUFFER_COMPACT (1 << 8)
+
+/* Messages in the compact encoding start with this byte */
+#define P11_RPC_COMPACT_MARK 0xc0
+
+/* Calls in a batch can use up to this many results of earlier calls */
+#define P11_RPC_BATCH_ARGS 4
+
+/* The most calls in a batch */
+#define P11_RPC_BATCH_MAX 4096
+
+/* Flags for each reference to an earlier result in a batch */
+enum {
+	P11_RPC_BATCH_SUBSTITUTE = 1 << 0,
+	P11_RPC_BATCH_ABSENT = 1 << 1,
+};
+
 void             p11_rpc_message_init                    (p11_rpc_message *msg,
                                                           p11_buffer *input,
                                                           p11_buffer *output);
@@ -367,4 +399,11 @@ bool             p11_rpc_buffer_get_uint64               (p11_buffer *buf,
                                                           size_t *offset,
                                                           uint64_t *val);
 
+void             p11_rpc_buffer_add_attribute            (p11_buffer *buffer,
+                                                          const CK_ATTRIBUTE *attr);
+
+bool             p11_rpc_buffer_get_attribute            (p11_buffer *buf,
+                                                          size_t *offset,
+                                                          CK_ATTRIBUTE *attr);
+
 #endif /* _RPC_MESSAGE_H */
@@ -0,0 +1,603 @@
+/*
+ * Copyright (c) 2016 Red Hat Inc
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *     * Redistributions of source code must retain the above
+ *       copyright notice, this list of conditions and the
+ *       following disclaimer.
+ *     * Redistributions in binary form must reproduce the
+ *       above copyright notice, this list of conditions and
+ *       the following disclaimer in the documentation and/or
+ *       other materials provided with the distribution.
+ *     * The names of contributors to this software may not be
+ *       used to endorse or promote products derived from this
+ *       software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+#include "config.h"
+
+#include "compat.h"
+#define P11_DEBUG_FLAG P11_DEBUG_RPC
+#include "debug.h"
+#include "message.h"
+#include "rpc-message.h"
+#include "rpc-ring.h"
+
+#include <sys/types.h>
+
+#include <assert.h>
+#include <errno.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef OS_UNIX
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+#ifdef __linux__
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <linux/futex.h>
+#include <poll.h>
+#include <time.h>
+#if defined (SYS_memfd_create) && defined (SYS_futex) && defined (__GNUC__)
+#define WITH_RING 1
+#endif
+#endif
+
+#ifndef EPROTO
+#define EPROTO EIO
+#endif
+
+bool p11_rpc_ring_disabled = false;
+
+#ifdef WITH_RING
+
+#ifndef MFD_CLOEXEC
+#define MFD_CLOEXEC 0x0001U
+#endif
+#ifndef MFD_ALLOW_SEALING
+#define MFD_ALLOW_SEALING 0x0002U
+#endif
+#ifndef F_ADD_SEALS
+#define F_ADD_SEALS 1033
+#define F_GET_SEALS 1034
+#endif
+#ifndef F_SEAL_SEAL
+#define F_SEAL_SEAL 0x0001
+#define F_SEAL_SHRINK 0x0002
+#define F_SEAL_GROW 0x0004
+#endif
+
+#define RING_MAGIC 0x70313172
+
+/* The shared header takes one page, the two rings follow it */
+#define RING_HEADER 4096
+
+/* Size of each ring, must be a power of two */
+#define RING_SIZE (64 * 1024)
+#define RING_MAX (16 * 1024 * 1024)
+
+/* How many times to check for the peer before sleeping */
+#define RING_SPIN 2048
+
+/* How long to sleep before checking whether the peer is gone */
+#define RING_TIMEOUT_NS (10 * 1000 * 1000)
+
+#if defined (__i386__) || defined (__x86_64__)
+#define ring_pause() __builtin_ia32_pause ()
+#elif defined (__aarch64__)
+#define ring_pause() __asm__ __volatile__ ("yield")
+#else
+#define ring_pause() do { } while (0)
+#endif
+
+/*
+ * The head is only written by the producer, and the tail only by the
+ * consumer. They run freely and wrap around, so head - tail is the
+ * amount of data in the ring. They're on separate cache lines.
+ */
+typedef struct {
+	uint32_t head;
+	uint32_t waiting_data;
+	unsigned char pad1[56];
+	uint32_t tail;
+	uint32_t waiting_space;
+	unsigned char pad2[56];
+} ring_queue;
+
+/* Requests go from the client to the server in queues[0] */
+typedef struct {
+	uint32_t magic;
+	uint32_t size;
+	unsigned char pad[56];
+	ring_queue queues[2];
+} ring_header;
+
+struct _p11_rpc_ring {
+	int fd;
+	int sock;
+	int spin;
+	uint32_t size;
+	void *mapped;
+	size_t length;
+	ring_queue *in;
+	ring_queue *out;
+	unsigned char *in_data;
+	unsigned char *out_data;
+};
+
+static p11_rpc_ring *
+ring_attach (int fd,
+             int sock,
+             bool server)
+{
+	ring_header *header;
+	p11_rpc_ring *ring;
+	struct stat sb;
+	int seals;
+	void *mapped;
+	int side;
+
+	if (fstat (fd, &sb) < 0 || sb.st_size < RING_HEADER) {
+		p11_message ("invalid rpc ring offered");
+		return NULL;
+	}
+
+	/* The other side must not be able to shrink the memory under us */
+	seals = fcntl (fd, F_GET_SEALS);
+	if (seals < 0 || !(seals & F_SEAL_SHRINK)) {
+		p11_message ("rpc ring offered without seals");
+		return NULL;
+	}
+
+	mapped = mmap (NULL, sb.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (mapped == MAP_FAILED) {
+		p11_message_err (errno, "couldn't map rpc ring");
+		return NULL;
+	}
+
+	header = mapped;
+	if (header->magic != RING_MAGIC || header->size < RING_HEADER ||
+	    header->size > RING_MAX || (header->size & (header->size - 1)) != 0 ||
+	    RING_HEADER + (size_t)header->size * 2 > (size_t)sb.st_size) {
+		p11_message ("invalid rpc ring offered");
+		munmap (mapped, sb.st_size);
+		return NULL;
+	}
+
+	ring = calloc (1, sizeof (p11_rpc_ring));
+	return_val_if_fail (ring != NULL, NULL);
+
+	ring->fd = fd;
+	ring->sock = sock;
+	ring->mapped = mapped;
+	ring->length = sb.st_size;
+	ring->size = header->size;
+
+	/* Spinning only helps when the other side runs at the same time */
+	ring->spin = sysconf (_SC_NPROCESSORS_ONLN) > 1 ? RING_SPIN : 0;
+
+	side = server ? 0 : 1;
+	ring->in = header->queues + side;
+	ring->in_data = (unsigned char *)mapped + RING_HEADER + side * ring->size;
+	ring->out = header->queues + !side;
+	ring->out_data = (unsigned char *)mapped + RING_HEADER + !side * ring->size;
+
+	return ring;
+}
+
+p11_rpc_ring *
+p11_rpc_ring_new (int sock)
+{
+	ring_header header;
+	p11_rpc_ring *ring;
+	size_t length;
+	int fd;
+
+	if (p11_rpc_ring_disabled)
+		return NULL;
+
+	fd = syscall (SYS_memfd_create, "p11-kit-rpc", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+	if (fd < 0) {
+		p11_debug ("couldn't create memory for rpc ring: %d", errno);
+		return NULL;
+	}
+
+	memset (&header, 0, sizeof (header));
+	header.magic = RING_MAGIC;
+	header.size = RING_SIZE;
+	length = RING_HEADER + RING_SIZE * 2;
+
+	if (ftruncate (fd, length) < 0 ||
+	    pwrite (fd, &header, sizeof (header), 0) != sizeof (header) ||
+	    fcntl (fd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_SEAL) < 0) {
+		p11_debug ("couldn't prepare memory for rpc ring: %d", errno);
+		close (fd);
+		return NULL;
+	}
+
+	ring = ring_attach (fd, sock, false);
+	if (ring == NULL)
+		close (fd);
+	return ring;
+}
+
+bool
+p11_rpc_ring_send_version (int sock,
+                           unsigned char version,
+                           p11_rpc_ring *ring)
+{
+	union {
+		struct cmsghdr align;
+		unsigned char buf[CMSG_SPACE (sizeof (int))];
+	} control;
+	struct cmsghdr *cmsg;
+	struct msghdr msg;
+	struct iovec iov;
+	ssize_t ret;
+
+	iov.iov_base = &version;
+	iov.iov_len = 1;
+
+	memset (&msg, 0, sizeof (msg));
+	msg.msg_iov = &iov;
+	msg.msg_iovlen = 1;
+
+	/* Servers that don't know about the ring just drop the descriptor */
+	if (ring) {
+		memset (&control, 0, sizeof (control));
+		msg.msg_control = control.buf;
+		msg.msg_controllen = sizeof (control.buf);
+		cmsg = CMSG_FIRSTHDR (&msg);
+		cmsg->cmsg_level = SOL_SOCKET;
+		cmsg->cmsg_type = SCM_RIGHTS;
+		cmsg->cmsg_len = CMSG_LEN (sizeof (int));
+		memcpy (CMSG_DATA (cmsg), &ring->fd, sizeof (int));
+	}
+
+	do {
+		ret = sendmsg (sock, &msg, 0);
+	} while (ret < 0 && (errno == EINTR || errno == EAGAIN));
+
+	if (ret < 0 && errno == ENOTSOCK && !ring)
+		ret = write (sock, &version, 1);
+
+	if (ret != 1) {
+		p11_message_err (errno, "couldn't send credential byte");
+		return false;
+	}
+
+	return true;
+}
+
+int
+p11_rpc_ring_recv_version (int sock,
+                           unsigned char *version,
+                           p11_rpc_ring **ring)
+{
+	union {
+		struct cmsghdr align;
+		unsigned char buf[CMSG_SPACE (sizeof (int) * 4)];
+	} control;
+	struct cmsghdr *cmsg;
+	struct msghdr msg;
+	struct iovec iov;
+	int fds[4];
+	int nfds = 0;
+	ssize_t ret;
+	int i;
+
+	*ring = NULL;
+
+	iov.iov_base = version;
+	iov.iov_len = 1;
+
+	memset (&msg, 0, sizeof (msg));
+	msg.msg_iov = &iov;
+	msg.msg_iovlen = 1;
+	msg.msg_control = control.buf;
+	msg.msg_controllen = sizeof (control.buf);
+
+	ret = recvmsg (sock, &msg, MSG_CMSG_CLOEXEC);
+	if (ret < 0 && errno == ENOTSOCK)
+		return read (sock, version, 1);
+	if (ret <= 0)
+		return ret;
+
+	for (cmsg = CMSG_FIRSTHDR (&msg); cmsg != NULL; cmsg = CMSG_NXTHDR (&msg, cmsg)) {
+		if (cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS)
+			continue;
+		for (i = 0; nfds < 4 && CMSG_LEN (sizeof (int) * (i + 1)) <= cmsg->cmsg_len; i++)
+			memcpy (fds + nfds++, CMSG_DATA (cmsg) + sizeof (int) * i, sizeof (int));
+	}
+
+	if (nfds == 1 && !(msg.msg_flags & MSG_CTRUNC))
+		*ring = ring_attach (fds[0], sock, true);
+	if (*ring == NULL) {
+		for (i = 0; i < nfds; i++)
+			close (fds[i]);
+	}
+
+	return ret;
+}
+
+void
+p11_rpc_ring_free (p11_rpc_ring *ring)
+{
+	if (ring == NULL)
+		return;
+	munmap (ring->mapped, ring->length);
+	close (ring->fd);
+	free (ring);
+}
+
+static bool
+ring_peer_gone (p11_rpc_ring *ring)
+{
+	struct pollfd pfd = { ring->sock, POLLIN, 0 };
+
+	/* Nothing else is sent over the socket, any event means it closed */
+	return poll (&pfd, 1, 0) != 0;
+}
+
+/*
+ * Waits until @word changes from @seen, spinning for a bit first.
+ * While sleeping, the other side is told to wake us via @waiting.
+ */
+static p11_rpc_status
+ring_wait (p11_rpc_ring *ring,
+           uint32_t *word,
+           uint32_t *waiting,
+           uint32_t seen)
+{
+	struct timespec ts = { 0, RING_TIMEOUT_NS };
+	p11_rpc_status status = P11_RPC_OK;
+	int i;
+
+	for (i = 0; i < ring->spin; i++) {
+		if (p11_atomic_load (word, ACQUIRE) != seen)
+			return P11_RPC_OK;
+		ring_pause ();
+	}
+
+	p11_atomic_add (waiting, 1, SEQ_CST);
+
+	while (p11_atomic_load (word, SEQ_CST) == seen) {
+		if (syscall (SYS_futex, word, FUTEX_WAIT, seen, &ts, NULL, 0) < 0 &&
+		    errno == ETIMEDOUT && ring_peer_gone (ring) &&
+		    p11_atomic_load (word, SEQ_CST) == seen) {
+			status = P11_RPC_EOF;
+			break;
+		}
+	}
+
+	p11_atomic_sub (waiting, 1, SEQ_CST);
+	return status;
+}
+
+static void
+ring_publish (uint32_t *word,
+              uint32_t *waiting,
+              uint32_t value)
+{
+	p11_atomic_store (word, value, SEQ_CST);
+	if (p11_atomic_load (waiting, SEQ_CST) != 0)
+		syscall (SYS_futex, word, FUTEX_WAKE, INT_MAX, NULL, NULL, 0);
+}
+
+p11_rpc_status
+p11_rpc_ring_write_frame (p11_rpc_ring *ring,
+                          int call_code,
+                          p11_buffer *options,
+                          p11_buffer *buffer)
+{
+	unsigned char header[12];
+	const unsigned char *parts[3];
+	size_t lengths[3];
+	p11_rpc_status status;
+	uint32_t head, tail;
+	uint32_t used, num;
+	uint32_t offset;
+	size_t left;
+	int i;
+
+	assert (ring != NULL);
+	assert (options != NULL);
+	assert (buffer != NULL);
+
+	p11_rpc_buffer_encode_uint32 (header, call_code);
+	p11_rpc_buffer_encode_uint32 (header + 4, options->len);
+	p11_rpc_buffer_encode_uint32 (header + 8, buffer->len);
+
+	parts[0] = header;
+	lengths[0] = sizeof (header);
+	parts[1] = options->data;
+	lengths[1] = options->len;
+	parts[2] = buffer->data;
+	lengths[2] = buffer->len;
+
+	head = p11_atomic_load (&ring->out->head, RELAXED);
+
+	for (i = 0; i < 3; i++) {
+		left = lengths[i];
+		while (left > 0) {
+			tail = p11_atomic_load (&ring->out->tail, ACQUIRE);
+			used = head - tail;
+			if (used > ring->size) {
+				p11_message ("invalid rpc ring state");
+				errno = EPROTO;
+				return P11_RPC_ERROR;
+			}
+
+			/* Hand over what we have, and wait for space */
+			if (used == ring->size) {
+				ring_publish (&ring->out->head, &ring->out->waiting_data, head);
+				status = ring_wait (ring, &ring->out->tail, &ring->out->waiting_space, tail);
+				if (status != P11_RPC_OK) {
+					errno = EPIPE;
+					return P11_RPC_ERROR;
+				}
+				continue;
+			}
+
+			num = ring->size - used;
+			if (num > left)
+				num = left;
+
+			/* Copy in, wrapping around the end of the ring */
+			offset = head & (ring->size - 1);
+			if (offset + num > ring->size) {
+				memcpy (ring->out_data + offset, parts[i], ring->size - offset);
+				memcpy (ring->out_data, parts[i] + (ring->size - offset),
+				        num - (ring->size - offset));
+			} else {
+				memcpy (ring->out_data + offset, parts[i], num);
+			}
+
+			parts[i] += num;
+			left -= num;
+			head += num;
+		}
+	}
+
+	ring_publish (&ring->out->head, &ring->out->waiting_data, head);
+	return P11_RPC_OK;
+}
+
+p11_rpc_status
+p11_rpc_ring_read (p11_rpc_ring *ring,
+                   void *data,
+                   size_t length)
+{
+	unsigned char *at = data;
+	p11_rpc_status status;
+	uint32_t head, tail;
+	uint32_t avail, num;
+	uint32_t offset;
+
+	assert (ring != NULL);
+
+	tail = p11_atomic_load (&ring->in->tail, RELAXED);
+
+	while (length > 0) {
+		head = p11_atomic_load (&ring->in->head, ACQUIRE);
+		avail = head - tail;
+		if (avail > ring->size) {
+			p11_message ("invalid rpc ring state");
+			errno = EPROTO;
+			return P11_RPC_ERROR;
+		}
+
+		if (avail == 0) {
+			status = ring_wait (ring, &ring->in->head, &ring->in->waiting_data, head);
+			if (status == P11_RPC_OK)
+				continue;
+
+			/* Only valid to go away between frames */
+			if (at != data) {
+				errno = EPROTO;
+				return P11_RPC_ERROR;
+			}
+			return status;
+		}
+
+		num = avail;
+		if (num > length)
+			num = length;
+
+		/* Copy out, wrapping around the end of the ring */
+		offset = tail & (ring->size - 1);
+		if (offset + num > ring->size) {
+			memcpy (at, ring->in_data + offset, ring->size - offset);
+			memcpy (at + (ring->size - offset), ring->in_data,
+			        num - (ring->size - offset));
+		} else {
+			memcpy (at, ring->in_data + offset, num);
+		}
+
+		at += num;
+		length -= num;
+		tail += num;
+
+		ring_publish (&ring->in->tail, &ring->in->waiting_space, tail);
+	}
+
+	return P11_RPC_OK;
+}
+
+#else /* !WITH_RING */
+
+p11_rpc_ring *
+p11_rpc_ring_new (int sock)
+{
+	return NULL;
+}
+
+bool
+p11_rpc_ring_send_version (int sock,
+                           unsigned char version,
+                           p11_rpc_ring *ring)
+{
+	if (write (sock, &version, 1) != 1) {
+		p11_message_err (errno, "couldn't send credential byte");
+		return false;
+	}
+
+	return true;
+}
+
+int
+p11_rpc_ring_recv_version (int sock,
+                           unsigned char *version,
+                           p11_rpc_ring **ring)
+{
+	*ring = NULL;
+	return read (sock, version, 1);
+}
+
+p11_rpc_status
+p11_rpc_ring_write_frame (p11_rpc_ring *ring,
+                          int call_code,
+                          p11_buffer *options,
+                          p11_buffer *buffer)
+{
+	return_val_if_reached (P11_RPC_ERROR);
+}
+
+p11_rpc_status
+p11_rpc_ring_read (p11_rpc_ring *ring,
+                   void *data,
+                   size_t length)
+{
+	return_val_if_reached (P11_RPC_ERROR);
+}
+
+void
+p11_rpc_ring_free (p11_rpc_ring *ring)
+{
+	assert (ring == NULL);
+}
+
+#endif /* !WITH_RING */
@@ -0,0 +1,75 @@
+/*
+ * Copyright (c) 2016 Red Hat Inc
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *     * Redistributions of source code must retain the above
+ *       copyright notice, this list of conditions and the
+ *       following disclaimer.
+ *     * Redistributions in binary form must reproduce the
+ *       above copyright notice, this list of conditions and
+ *       the following disclaimer in the documentation and/or
+ *       other materials provided with the distribution.
+ *     * The names of contributors to this software may not be
+ *       used to endorse or promote products derived from this
+ *       software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+#ifndef P11_RPC_RING_H_
+#define P11_RPC_RING_H_
+
+#include "buffer.h"
+#include "rpc.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/*
+ * A pair of single producer, single consumer rings in memory shared
+ * between an rpc client and the server it executed. The ring is offered
+ * by the client along with the version byte, and used for all frames
+ * once the server accepts it. The socket is only used to notice when
+ * the other side goes away.
+ */
+
+typedef struct _p11_rpc_ring p11_rpc_ring;
+
+p11_rpc_ring *      p11_rpc_ring_new              (int sock);
+
+bool                p11_rpc_ring_send_version     (int sock,
+                                                   unsigned char version,
+                                                   p11_rpc_ring *ring);
+
+int                 p11_rpc_ring_recv_version     (int sock,
+                                                   unsigned char *version,
+                                                   p11_rpc_ring **ring);
+
+p11_rpc_status      p11_rpc_ring_write_frame      (p11_rpc_ring *ring,
+                                                   int call_code,
+                                                   p11_buffer *options,
+                                                   p11_buffer *buffer);
+
+p11_rpc_status      p11_rpc_ring_read             (p11_rpc_ring *ring,
+                                                   void *data,
+                                                   size_t length);
+
+void                p11_rpc_ring_free             (p11_rpc_ring *ring);
+
+extern bool         p11_rpc_ring_disabled;
+
+#endif /* P11_RPC_RING_H_ */
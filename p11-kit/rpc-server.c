@@ -44,6 +44,7 @@
 #include "remote.h"
 #include "rpc.h"
 #include "rpc-message.h"
+#include "rpc-ring.h"
 
 #include <sys/types.h>
 #include <sys/param.h>
@@ -280,11 +281,7 @@ proto_read_attribute_array (p11_rpc_message *msg,
                             CK_ULONG *n_result)
 {
 	CK_ATTRIBUTE_PTR attrs;
-	const unsigned char *data;
-	unsigned char valid;
 	uint32_t n_attrs, i;
-	uint32_t value;
-	size_t n_data;
 
 	assert (msg != NULL);
 	assert (result != NULL);
@@ -306,33 +303,8 @@ proto_read_attribute_array (p11_rpc_message *msg,
 	/* Now go through and fill in each one */
 	for (i = 0; i < n_attrs; ++i) {
 
-		/* The attribute type */
-		if (!p11_rpc_buffer_get_uint32 (msg->input, &msg->parsed, &value))
-			return PARSE_ERROR;
-
-		attrs[i].type = value;
-
-		/* Whether this one is valid or not */
-		if (!p11_rpc_buffer_get_byte (msg->input, &msg->parsed, &valid))
+		if (!p11_rpc_buffer_get_attribute (msg->input, &msg->parsed, attrs + i))
 			return PARSE_ERROR;
-
-		if (valid) {
-			if (!p11_rpc_buffer_get_uint32 (msg->input, &msg->parsed, &value))
-				return PARSE_ERROR;
-			if (!p11_rpc_buffer_get_byte_array (msg->input, &msg->parsed, &data, &n_data))
-				return PARSE_ERROR;
-
-			if (data != NULL && n_data != value) {
-				p11_message ("attribute length and data do not match");
-				return PARSE_ERROR;
-			}
-
-			attrs[i].pValue = (CK_VOID_PTR)data;
-			attrs[i].ulValueLen = value;
-		} else {
-			attrs[i].pValue = NULL;
-			attrs[i].ulValueLen = -1;
-		}
 	}
 
 	*result = attrs;
@@ -1763,38 +1735,231 @@ rpc_C_GenerateRandom (CK_X_FUNCTION_LIST *self,
 	END_CALL;
 }
 
-bool
-p11_rpc_server_handle (CK_X_FUNCTION_LIST *self,
-                       p11_buffer *request,
-                       p11_buffer *response)
+static bool
+server_run (CK_X_FUNCTION_LIST *self,
+            p11_rpc_message *msg,
+            CK_RV *result);
+
+/*
+ * Checks the whole of a batch before any of its calls run, so that an
+ * invalid call doesn't leave the effects of the calls before it.
+ */
+static bool
+batch_validate (p11_buffer *envelope,
+                size_t offset,
+                uint32_t n_calls)
+{
+	p11_rpc_message sub;
+	p11_buffer request;
+	p11_buffer response;
+	const unsigned char *data;
+	unsigned char n_refs;
+	unsigned char argument;
+	unsigned char flags;
+	uint32_t source;
+	uint32_t index;
+	size_t length;
+	uint32_t i, j;
+	bool valid;
+
+	for (i = 0; i < n_calls; i++) {
+		if (!p11_rpc_buffer_get_byte (envelope, &offset, &n_refs))
+			return false;
+
+		for (j = 0; j < n_refs; j++) {
+			if (!p11_rpc_buffer_get_byte (envelope, &offset, &argument) ||
+			    !p11_rpc_buffer_get_byte (envelope, &offset, &flags) ||
+			    !p11_rpc_buffer_get_uint32 (envelope, &offset, &source) ||
+			    !p11_rpc_buffer_get_uint32 (envelope, &offset, &index) ||
+			    source >= i || argument >= P11_RPC_BATCH_ARGS)
+				return false;
+		}
+
+		if (!p11_rpc_buffer_get_byte_array (envelope, &offset, &data, &length))
+			return false;
+
+		p11_buffer_init_full (&request, (void *)data, length, 0, NULL, NULL);
+		p11_buffer_init_null (&response, 0);
+		p11_rpc_message_init (&sub, &request, &response);
+		valid = p11_rpc_message_parse (&sub, P11_RPC_REQUEST) &&
+		        sub.call_id != P11_RPC_CALL_X_Batch;
+		p11_rpc_message_clear (&sub);
+		p11_buffer_uninit (&response);
+
+		if (!valid) {
+			p11_message ("invalid call in rpc batch");
+			return false;
+		}
+	}
+
+	return offset == envelope->len;
+}
+
+/*
+ * A batch holds complete requests, which are run in order. Each call
+ * can refer to results of earlier calls: to use one as an argument, or
+ * to only run when a result is present or absent. The response holds
+ * the response for each call, or nothing if it was skipped.
+ */
+static CK_RV
+rpc_X_Batch (CK_X_FUNCTION_LIST *self,
+             p11_rpc_message *msg)
 {
-	p11_rpc_message msg;
+	CK_ULONG substitutes[P11_RPC_BATCH_ARGS];
+	p11_buffer *outputs = NULL;
+	CK_RV *results = NULL;
+	p11_rpc_message sub;
+	p11_buffer envelope;
+	p11_buffer request;
+	p11_buffer response;
+	p11_buffer reply;
+	const unsigned char *data;
+	unsigned char n_refs;
+	unsigned char argument;
+	unsigned char flags;
+	uint32_t n_calls;
+	uint32_t source;
+	uint32_t index;
+	unsigned int mask;
+	CK_BYTE_PTR array;
+	CK_ULONG n_array;
+	size_t offset = 0;
+	size_t length;
+	bool present;
+	bool skip;
+	uint32_t i, j;
 	CK_RV ret;
-	int req_id;
 
-	return_val_if_fail (self != NULL, false);
-	return_val_if_fail (request != NULL, false);
-	return_val_if_fail (response != NULL, false);
+	p11_debug ("X_Batch: enter");
 
-	p11_message_clear ();
+	assert (msg != NULL);
+	assert (self != NULL);
 
-	p11_rpc_message_init (&msg, request, response);
+	ret = proto_read_byte_array (msg, &array, &n_array);
+	if (ret != CKR_OK)
+		return ret;
 
-	if (!p11_rpc_message_parse (&msg, P11_RPC_REQUEST)) {
-		p11_rpc_message_clear (&msg);
-		p11_message ("couldn't parse pkcs11 rpc message");
-		return false;
+	p11_buffer_init_full (&envelope, array, n_array, 0, NULL, NULL);
+	if (!p11_rpc_buffer_get_uint32 (&envelope, &offset, &n_calls) ||
+	    n_calls > P11_RPC_BATCH_MAX ||
+	    !batch_validate (&envelope, offset, n_calls))
+		return PARSE_ERROR;
+
+	results = calloc (n_calls + 1, sizeof (CK_RV));
+	outputs = calloc (n_calls + 1, sizeof (p11_buffer));
+	if (results == NULL || outputs == NULL) {
+		free (results);
+		free (outputs);
+		return CKR_DEVICE_MEMORY;
 	}
 
+	for (i = 0; i < n_calls; i++)
+		p11_buffer_init (outputs + i, 0);
+
+	p11_buffer_init (&reply, 64);
+	p11_rpc_buffer_add_uint32 (&reply, n_calls);
+
+	for (i = 0; ret == CKR_OK && i < n_calls; i++) {
+		results[i] = CKR_FUNCTION_CANCELED;
+		skip = false;
+		mask = 0;
+
+		if (!p11_rpc_buffer_get_byte (&envelope, &offset, &n_refs)) {
+			ret = PARSE_ERROR;
+			break;
+		}
+
+		for (j = 0; j < n_refs; j++) {
+			if (!p11_rpc_buffer_get_byte (&envelope, &offset, &argument) ||
+			    !p11_rpc_buffer_get_byte (&envelope, &offset, &flags) ||
+			    !p11_rpc_buffer_get_uint32 (&envelope, &offset, &source) ||
+			    !p11_rpc_buffer_get_uint32 (&envelope, &offset, &index) ||
+			    source >= i || argument >= P11_RPC_BATCH_ARGS) {
+				ret = PARSE_ERROR;
+				break;
+			}
+
+			present = results[source] == CKR_OK &&
+			          index < outputs[source].len / sizeof (CK_ULONG);
+			if (flags & P11_RPC_BATCH_ABSENT)
+				skip = skip || present;
+			else
+				skip = skip || !present;
+
+			if (present && (flags & P11_RPC_BATCH_SUBSTITUTE)) {
+				substitutes[argument] = ((CK_ULONG *)outputs[source].data)[index];
+				mask |= 1U << argument;
+			}
+		}
+
+		if (ret != CKR_OK ||
+		    !p11_rpc_buffer_get_byte_array (&envelope, &offset, &data, &length)) {
+			ret = PARSE_ERROR;
+			break;
+		}
+
+		if (skip) {
+			p11_rpc_buffer_add_byte (&reply, 0);
+			continue;
+		}
+
+		p11_buffer_init_full (&request, (void *)data, length, 0, NULL, NULL);
+		p11_buffer_init (&response, 64);
+		p11_rpc_message_init (&sub, &request, &response);
+		sub.substitutes = substitutes;
+		sub.substitute_mask = mask;
+		sub.outputs = outputs + i;
+
+		if (!p11_rpc_message_parse (&sub, P11_RPC_REQUEST) ||
+		    sub.call_id == P11_RPC_CALL_X_Batch) {
+			p11_message ("invalid call in rpc batch");
+			ret = PARSE_ERROR;
+		} else if (!server_run (self, &sub, results + i)) {
+			ret = CKR_DEVICE_MEMORY;
+		} else {
+			p11_rpc_buffer_add_byte (&reply, 1);
+			p11_rpc_buffer_add_byte_array (&reply, response.data, response.len);
+		}
+
+		p11_rpc_message_clear (&sub);
+		p11_buffer_uninit (&response);
+	}
+
+	if (ret == CKR_OK && p11_buffer_failed (&reply))
+		ret = CKR_DEVICE_MEMORY;
+	if (ret == CKR_OK)
+		ret = call_ready (msg);
+	if (ret == CKR_OK)
+		ret = proto_write_byte_array (msg, reply.data, reply.len, ret);
+
+	for (i = 0; i < n_calls; i++)
+		p11_buffer_uninit (outputs + i);
+	p11_buffer_uninit (&reply);
+	free (outputs);
+	free (results);
+
+	p11_debug ("ret: %d", (int)ret);
+	return ret;
+}
+
+/* Runs a parsed request, and fills in its response or an error */
+static bool
+server_run (CK_X_FUNCTION_LIST *self,
+            p11_rpc_message *msg,
+            CK_RV *result)
+{
+	CK_RV ret;
+	int req_id;
+
 	/* This should have been checked by the parsing code */
-	assert (msg.call_id > P11_RPC_CALL_ERROR);
-	assert (msg.call_id < P11_RPC_CALL_MAX);
-	req_id = msg.call_id;
+	assert (msg->call_id > P11_RPC_CALL_ERROR);
+	assert (msg->call_id < P11_RPC_CALL_MAX);
+	req_id = msg->call_id;
 
 	switch(req_id) {
 	#define CASE_CALL(name) \
 	case P11_RPC_CALL_##name: \
-		ret = rpc_##name (self, &msg); \
+		ret = rpc_##name (self, msg); \
 		break;
 	CASE_CALL (C_Initialize)
 	CASE_CALL (C_Finalize)
@@ -1861,6 +2026,7 @@ p11_rpc_server_handle (CK_X_FUNCTION_LIST *self,
 	CASE_CALL (C_SeedRandom)
 	CASE_CALL (C_GenerateRandom)
 	CASE_CALL (C_WaitForSlotEvent)
+	CASE_CALL (X_Batch)
 	#undef CASE_CALL
 	default:
 		/* This should have been caught by the parse code */
@@ -1868,9 +2034,8 @@ p11_rpc_server_handle (CK_X_FUNCTION_LIST *self,
 		break;
 	};
 
-	if (p11_buffer_failed (msg.output)) {
+	if (p11_buffer_failed (msg->output)) {
 		p11_message ("out of memory error putting together message");
-		p11_rpc_message_clear (&msg);
 		return false;
 	}
 
@@ -1882,32 +2047,108 @@ p11_rpc_server_handle (CK_X_FUNCTION_LIST *self,
 		 * these messages we want to make sure each of them actually
 		 * does what it's supposed to.
 		 */
-		assert (p11_rpc_message_is_verified (&msg));
-		assert (msg.call_type == P11_RPC_RESPONSE);
-		assert (msg.call_id == req_id);
-		assert (p11_rpc_calls[msg.call_id].response);
-		assert (strcmp (p11_rpc_calls[msg.call_id].response, msg.signature) == 0);
+		assert (p11_rpc_message_is_verified (msg));
+		assert (msg->call_type == P11_RPC_RESPONSE);
+		assert (msg->call_id == req_id);
+		assert (p11_rpc_calls[msg->call_id].response);
+		assert (strcmp (p11_rpc_calls[msg->call_id].response, msg->signature) == 0);
 
 	/* Fill in an error respnose */
 	} else {
-		if (!p11_rpc_message_prep (&msg, P11_RPC_CALL_ERROR, P11_RPC_RESPONSE) ||
-		    !p11_rpc_message_write_ulong (&msg, (uint32_t)ret) ||
-		    p11_buffer_failed (msg.output)) {
+		if (!p11_rpc_message_prep (msg, P11_RPC_CALL_ERROR, P11_RPC_RESPONSE) ||
+		    !p11_rpc_message_write_ulong (msg, (uint32_t)ret) ||
+		    p11_buffer_failed (msg->output)) {
 			p11_message ("out of memory responding with error");
-			p11_rpc_message_clear (&msg);
 			return false;
 		}
 	}
 
-	p11_rpc_message_clear (&msg);
+	*result = ret;
 	return true;
 }
 
+bool
+p11_rpc_server_handle (CK_X_FUNCTION_LIST *self,
+                       p11_buffer *request,
+                       p11_buffer *response)
+{
+	p11_rpc_message msg;
+	CK_RV ret;
+	bool ok;
+
+	return_val_if_fail (self != NULL, false);
+	return_val_if_fail (request != NULL, false);
+	return_val_if_fail (response != NULL, false);
+
+	p11_message_clear ();
+
+	p11_rpc_message_init (&msg, request, response);
+
+	if (!p11_rpc_message_parse (&msg, P11_RPC_REQUEST)) {
+		p11_rpc_message_clear (&msg);
+		p11_message ("couldn't parse pkcs11 rpc message");
+		return false;
+	}
+
+	ok = server_run (self, &msg, &ret);
+	p11_rpc_message_clear (&msg);
+	return ok;
+}
+
+static int
+serve_ring (p11_virtual *virt,
+            p11_rpc_ring *ring,
+            p11_buffer *options,
+            p11_buffer *buffer)
+{
+	unsigned char header[12];
+	p11_rpc_status status;
+	uint32_t len;
+	int code;
+
+	for (;;) {
+		status = p11_rpc_ring_read (ring, header, sizeof (header));
+		if (status == P11_RPC_EOF)
+			return 0;
+		if (status != P11_RPC_OK)
+			break;
+
+		code = p11_rpc_buffer_decode_uint32 (header);
+		len = p11_rpc_buffer_decode_uint32 (header + 4);
+		if (!p11_buffer_reset (options, len))
+			return_val_if_reached (1);
+		options->len = len;
+		len = p11_rpc_buffer_decode_uint32 (header + 8);
+		if (!p11_buffer_reset (buffer, len))
+			return_val_if_reached (1);
+		buffer->len = len;
+
+		if (p11_rpc_ring_read (ring, options->data, options->len) != P11_RPC_OK ||
+		    p11_rpc_ring_read (ring, buffer->data, buffer->len) != P11_RPC_OK)
+			break;
+
+		if (!p11_rpc_server_handle (&virt->funcs, buffer, buffer)) {
+			p11_message ("unexpected error handling rpc message");
+			return 1;
+		}
+
+		options->len = 0;
+		if (p11_rpc_ring_write_frame (ring, code, options, buffer) != P11_RPC_OK) {
+			p11_message_err (errno, "failed to write rpc message");
+			return 1;
+		}
+	}
+
+	p11_message_err (errno, "failed to read rpc message");
+	return 1;
+}
+
 int
 p11_kit_remote_serve_module (CK_FUNCTION_LIST *module,
                              int in_fd,
                              int out_fd)
 {
+	p11_rpc_ring *ring = NULL;
 	p11_rpc_status status;
 	unsigned char version;
 	p11_virtual virt;
@@ -1924,7 +2165,7 @@ p11_kit_remote_serve_module (CK_FUNCTION_LIST *module,
 
 	p11_virtual_init (&virt, &p11_virtual_base, module, NULL);
 
-	switch (read (in_fd, &version, 1)) {
+	switch (p11_rpc_ring_recv_version (in_fd, &version, &ring)) {
 	case 0:
 		goto out;
 	case 1:
@@ -1938,8 +2179,11 @@ p11_kit_remote_serve_module (CK_FUNCTION_LIST *module,
 		goto out;
 	}
 
-	version = 0;
-	switch (write (out_fd, &version, out_fd)) {
+	/* Tell the client what we support, and whether we use the ring */
+	version = P11_RPC_FEATURE_BATCH | P11_RPC_FEATURE_COMPACT;
+	if (ring)
+		version |= P11_RPC_FEATURE_RING;
+	switch (write (out_fd, &version, 1)) {
 	case 1:
 		break;
 	default:
@@ -1947,6 +2191,11 @@ p11_kit_remote_serve_module (CK_FUNCTION_LIST *module,
 		goto out;
 	}
 
+	if (ring) {
+		ret = serve_ring (&virt, ring, &options, &buffer);
+		goto out;
+	}
+
 	status = P11_RPC_OK;
 	while (status == P11_RPC_OK) {
 		state = 0;
@@ -1995,6 +2244,7 @@ p11_kit_remote_serve_module (CK_FUNCTION_LIST *module,
 	}
 
 out:
+	p11_rpc_ring_free (ring);
 	p11_buffer_uninit (&buffer);
 	p11_buffer_uninit (&options);
 
@@ -44,6 +44,7 @@
 #include "private.h"
 #include "rpc.h"
 #include "rpc-message.h"
+#include "rpc-ring.h"
 
 #include <sys/types.h>
 
@@ -55,8 +56,8 @@
 #include <string.h>
 
 #ifdef OS_UNIX
-#include <sys/select.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 #include <sys/wait.h>
 #include <sys/un.h>
 #include <signal.h>
@@ -74,9 +75,43 @@
 #define EPROTO EIO
 #endif
 
+#ifdef OS_WIN32
+
+struct iovec {
+	void *iov_base;
+	size_t iov_len;
+};
+
+/* Only transfers the first buffer, callers handle partial transfers */
+
+static ssize_t
+writev (int fd,
+        const struct iovec *iov,
+        int count)
+{
+	return write (fd, iov[0].iov_base, iov[0].iov_len);
+}
+
+static ssize_t
+readv (int fd,
+       const struct iovec *iov,
+       int count)
+{
+	return read (fd, iov[0].iov_base, iov[0].iov_len);
+}
+
+#endif /* OS_WIN32 */
+
+/* The most buffers a frame is written or read with */
+#define FRAME_IOVS 4
+
+/* How much we read beyond what we were asked, if available */
+#define READ_AHEAD 4096
+
 typedef struct {
 	/* Never changes */
 	int fd;
+	p11_rpc_ring *ring;
 
 	/* Protected by the lock */
 	p11_mutex_t write_lock;
@@ -86,10 +121,14 @@ typedef struct {
 
 	/* This data is protected by read mutex */
 	p11_mutex_t read_lock;
+	p11_cond_t read_cond;
 	bool read_creds;
 	uint32_t read_code;
 	uint32_t read_olen;
 	uint32_t read_dlen;
+	unsigned char read_ahead[READ_AHEAD];
+	size_t read_start;
+	size_t read_end;
 } rpc_socket;
 
 static rpc_socket *
@@ -108,6 +147,7 @@ rpc_socket_new (int fd)
 
 	p11_mutex_init (&sock->write_lock);
 	p11_mutex_init (&sock->read_lock);
+	p11_cond_init (&sock->read_cond);
 
 	return sock;
 }
@@ -161,46 +201,156 @@ rpc_socket_unref (rpc_socket *sock)
 	assert (sock->refs == 0);
 
 	rpc_socket_close (sock);
+	p11_rpc_ring_free (sock->ring);
+	sock->ring = NULL;
 	p11_mutex_uninit (&sock->write_lock);
 	p11_mutex_uninit (&sock->read_lock);
+	p11_cond_uninit (&sock->read_cond);
 }
 
-static bool
-write_all (int fd,
-           unsigned char* data,
-           size_t len)
+/*
+ * Fills in @out with what remains of the @count buffers in @iov after
+ * skipping @skip bytes. Returns the number of buffers, and the number
+ * of bytes remaining in @remaining.
+ */
+static int
+iov_skip (struct iovec *iov,
+          int count,
+          size_t skip,
+          struct iovec *out,
+          size_t *remaining)
 {
-	int r;
+	int num = 0;
+	int i;
 
-	while (len > 0) {
-		r = write (fd, data, len);
-		if (r == -1) {
-			if (errno == EPIPE) {
-				p11_message ("couldn't send data: closed connection");
-				return false;
-			} else if (errno != EAGAIN && errno != EINTR) {
-				p11_message_err (errno, "couldn't send data");
-				return false;
-			}
-		} else {
-			p11_debug ("wrote %d bytes", r);
-			data += r;
-			len -= r;
+	assert (count <= FRAME_IOVS);
+
+	*remaining = 0;
+	for (i = 0; i < count; i++) {
+		if (skip >= iov[i].iov_len) {
+			skip -= iov[i].iov_len;
+			continue;
 		}
+
+		out[num].iov_base = (unsigned char *)iov[i].iov_base + skip;
+		out[num].iov_len = iov[i].iov_len - skip;
+		*remaining += out[num].iov_len;
+		skip = 0;
+		num++;
 	}
 
-	return true;
+	return num;
+}
+
+static p11_rpc_status
+write_at (int fd,
+          struct iovec *iov,
+          int count,
+          size_t offset,
+          size_t *at)
+{
+	struct iovec out[FRAME_IOVS];
+	p11_rpc_status status;
+	size_t remaining;
+	ssize_t num;
+	int errn;
+
+	assert (*at >= offset);
+
+	count = iov_skip (iov, count, *at - offset, out, &remaining);
+	if (count == 0)
+		return P11_RPC_OK;
+
+	num = writev (fd, out, count);
+	errn = errno;
+
+	/* Update state */
+	if (num > 0)
+		*at += num;
+
+	/* Completely written out these blocks */
+	if (num == remaining) {
+		p11_debug ("ok: wrote block of %d", (int)num);
+		status = P11_RPC_OK;
+
+	/* Partially written out these blocks */
+	} else if (num >= 0) {
+		p11_debug ("again: partial read of %d", (int)num);
+		status = P11_RPC_AGAIN;
+
+	/* Didn't write out block due to transient issue */
+	} else if (errn == EINTR || errn == EAGAIN || errn == EWOULDBLOCK) {
+		p11_debug ("again: due to %d", errn);
+		status = P11_RPC_AGAIN;
+
+	/* Failure */
+	} else {
+		p11_debug ("error: due to %d", errn);
+		status = P11_RPC_ERROR;
+	}
+
+	errno = errn;
+	return status;
 }
 
 static bool
-read_all (int fd,
+write_all (int fd,
+           struct iovec *iov,
+           int count)
+{
+	p11_rpc_status status;
+	size_t at = 0;
+
+	do {
+		status = write_at (fd, iov, count, 0, &at);
+	} while (status == P11_RPC_AGAIN);
+
+	if (status == P11_RPC_OK)
+		return true;
+
+	if (errno == EPIPE)
+		p11_message ("couldn't send data: closed connection");
+	else
+		p11_message_err (errno, "couldn't send data");
+	return false;
+}
+
+/*
+ * Reads data from the socket, reading ahead into a buffer when more
+ * data is available. Usually a whole frame is read with one call.
+ */
+static bool
+read_all (rpc_socket *sock,
           unsigned char* data,
           size_t len)
 {
-	int r;
+	struct iovec iov[2];
+	size_t num;
+	ssize_t r;
+
+	if (sock->ring) {
+		if (p11_rpc_ring_read (sock->ring, data, len) == P11_RPC_OK)
+			return true;
+		p11_message ("couldn't receive data: closed connection");
+		return false;
+	}
+
+	/* Use what we read ahead earlier first */
+	num = sock->read_end - sock->read_start;
+	if (num > len)
+		num = len;
+	memcpy (data, sock->read_ahead + sock->read_start, num);
+	sock->read_start += num;
+	data += num;
+	len -= num;
 
 	while (len > 0) {
-		r = read (fd, data, len);
+		iov[0].iov_base = data;
+		iov[0].iov_len = len;
+		iov[1].iov_base = sock->read_ahead;
+		iov[1].iov_len = sizeof (sock->read_ahead);
+
+		r = readv (sock->fd, iov, 2);
 		if (r == 0) {
 			p11_message ("couldn't receive data: closed connection");
 			return false;
@@ -209,8 +359,13 @@ read_all (int fd,
 				p11_message_err (errno, "couldn't receive data");
 				return false;
 			}
+		} else if (r >= len) {
+			p11_debug ("read %d bytes", (int)r);
+			sock->read_start = 0;
+			sock->read_end = r - len;
+			len = 0;
 		} else {
-			p11_debug ("read %d bytes", r);
+			p11_debug ("read %d bytes", (int)r);
 			data += r;
 			len -= r;
 		}
@@ -225,85 +380,49 @@ rpc_socket_write_inlock (rpc_socket *sock,
                          p11_buffer *options,
                          p11_buffer *buffer)
 {
+	struct iovec iov[FRAME_IOVS];
 	unsigned char header[12];
 	unsigned char dummy = '\0';
+	int count = 0;
 
 	/* The socket is locked and referenced at this point */
 	assert (buffer != NULL);
 
+	if (sock->ring) {
+		if (p11_rpc_ring_write_frame (sock->ring, code, options, buffer) == P11_RPC_OK)
+			return CKR_OK;
+		p11_message ("couldn't send data: closed connection");
+		return CKR_DEVICE_ERROR;
+	}
+
 	/* Place holder byte, will later carry unix credentials (on some systems) */
 	if (!sock->sent_creds) {
-		if (write_all (sock->fd, &dummy, 1) != 1) {
-			p11_message_err (errno, "couldn't send socket credentials");
-			return CKR_DEVICE_ERROR;
-		}
-		sock->sent_creds = true;
+		iov[count].iov_base = &dummy;
+		iov[count].iov_len = 1;
+		count++;
 	}
 
 	p11_rpc_buffer_encode_uint32 (header, code);
 	p11_rpc_buffer_encode_uint32 (header + 4, options->len);
 	p11_rpc_buffer_encode_uint32 (header + 8, buffer->len);
 
-	if (!write_all (sock->fd, header, 12) ||
-	    !write_all (sock->fd, options->data, options->len) ||
-	    !write_all (sock->fd, buffer->data, buffer->len))
+	iov[count].iov_base = header;
+	iov[count].iov_len = 12;
+	count++;
+	iov[count].iov_base = options->data;
+	iov[count].iov_len = options->len;
+	count++;
+	iov[count].iov_base = buffer->data;
+	iov[count].iov_len = buffer->len;
+	count++;
+
+	if (!write_all (sock->fd, iov, count))
 		return CKR_DEVICE_ERROR;
 
+	sock->sent_creds = true;
 	return CKR_OK;
 }
 
-static p11_rpc_status
-write_at (int fd,
-          unsigned char *data,
-          size_t len,
-          size_t offset,
-          size_t *at)
-{
-	p11_rpc_status status;
-	ssize_t num;
-	size_t from;
-	int errn;
-
-	assert (*at >= offset);
-
-	if (*at >= offset + len)
-		return P11_RPC_OK;
-
-	from = *at - offset;
-	assert (from < len);
-
-	num = write (fd, data + from, len - from);
-	errn = errno;
-
-	/* Update state */
-	if (num > 0)
-		*at += num;
-
-	/* Completely written out this block */
-	if (num == len - from) {
-		p11_debug ("ok: wrote block of %d", (int)num);
-		status = P11_RPC_OK;
-
-	/* Partially written out this block */
-	} else if (num >= 0) {
-		p11_debug ("again: partial read of %d", (int)num);
-		status = P11_RPC_AGAIN;
-
-	/* Didn't write out block due to transient issue */
-	} else if (errn == EINTR || errn == EAGAIN || errn == EWOULDBLOCK) {
-		p11_debug ("again: due to %d", errn);
-		status = P11_RPC_AGAIN;
-
-	/* Failure */
-	} else {
-		p11_debug ("error: due to %d", errn);
-		status = P11_RPC_ERROR;
-	}
-
-	errno = errn;
-	return status;
-}
-
 p11_rpc_status
 p11_rpc_transport_write (int fd,
                          size_t *state,
@@ -312,6 +431,7 @@ p11_rpc_transport_write (int fd,
                          p11_buffer *buffer)
 {
 	unsigned char header[12] = { 0, };
+	struct iovec iov[3];
 	p11_rpc_status status;
 
 	assert (state != NULL);
@@ -324,17 +444,15 @@ p11_rpc_transport_write (int fd,
 		p11_rpc_buffer_encode_uint32 (header + 8, buffer->len);
 	}
 
-	status = write_at (fd, header, 12, 0, state);
+	/* The whole frame goes out in one call, if possible */
+	iov[0].iov_base = header;
+	iov[0].iov_len = 12;
+	iov[1].iov_base = options->data;
+	iov[1].iov_len = options->len;
+	iov[2].iov_base = buffer->data;
+	iov[2].iov_len = buffer->len;
 
-	if (status == P11_RPC_OK) {
-		status = write_at (fd, options->data, options->len,
-		                   12, state);
-	}
-
-	if (status == P11_RPC_OK) {
-		status = write_at (fd, buffer->data, buffer->len,
-		                   12 + options->len, state);
-	}
+	status = write_at (fd, iov, 3, 0, state);
 
 	/* All done */
 	if (status == P11_RPC_OK)
@@ -351,7 +469,6 @@ rpc_socket_read (rpc_socket *sock,
 	CK_RV ret = CKR_DEVICE_ERROR;
 	unsigned char header[12];
 	unsigned char dummy;
-	fd_set rfds;
 
 	assert (code != NULL);
 	assert (buffer != NULL);
@@ -364,7 +481,7 @@ rpc_socket_read (rpc_socket *sock,
 	p11_mutex_lock (&sock->read_lock);
 
 	if (!sock->read_creds) {
-		if (read_all (sock->fd, &dummy, 1) != 1) {
+		if (!read_all (sock, &dummy, 1)) {
 			p11_mutex_unlock (&sock->read_lock);
 			return CKR_DEVICE_ERROR;
 		}
@@ -374,7 +491,7 @@ rpc_socket_read (rpc_socket *sock,
 	for (;;) {
 		/* No message header has been read yet? ... read one in */
 		if (sock->read_code == 0) {
-			if (!read_all (sock->fd, header, 12))
+			if (!read_all (sock, header, 12))
 				break;
 
 			/* Decode and check the message header */
@@ -398,8 +515,8 @@ rpc_socket_read (rpc_socket *sock,
 			}
 
 			/* Read in the the options first, and then data */
-			if (!read_all (sock->fd, buffer->data, sock->read_olen) ||
-			    !read_all (sock->fd, buffer->data, sock->read_dlen))
+			if (!read_all (sock, buffer->data, sock->read_olen) ||
+			    !read_all (sock, buffer->data, sock->read_dlen))
 				break;
 
 			buffer->len = sock->read_dlen;
@@ -413,58 +530,53 @@ rpc_socket_read (rpc_socket *sock,
 			break;
 		}
 
-		/* Give another thread the chance to read data for this header */
-		if (sock->read_code != 0) {
-			p11_debug ("received header in wrong thread");
-			p11_mutex_unlock (&sock->read_lock);
-
-			/* Used as a simple wait */
-			FD_ZERO (&rfds);
-			FD_SET (sock->fd, &rfds);
-			if (select (sock->fd + 1, &rfds, NULL, NULL, NULL) < 0)
-				p11_message ("couldn't use select to wait on rpc socket");
-
-			p11_mutex_lock (&sock->read_lock);
-		}
+		/*
+		 * Give another thread the chance to read data for this header.
+		 * Its frame may already be read ahead, or be waiting in the ring,
+		 * so we wait for the header to be consumed rather than for data.
+		 */
+		p11_debug ("received header in wrong thread");
+		p11_cond_broadcast (&sock->read_cond);
+		p11_cond_wait (&sock->read_cond, &sock->read_lock);
 	}
 
+	p11_cond_broadcast (&sock->read_cond);
 	p11_mutex_unlock (&sock->read_lock);
 	return ret;
 }
 
 static p11_rpc_status
 read_at (int fd,
-         unsigned char *data,
-         size_t len,
+         struct iovec *iov,
+         int count,
          size_t offset,
          size_t *at)
 {
+	struct iovec out[FRAME_IOVS];
 	p11_rpc_status status;
+	size_t remaining;
 	int errn;
 	ssize_t num;
-	size_t from;
 
 	assert (*at >= offset);
 
-	if (*at >= offset + len)
+	count = iov_skip (iov, count, *at - offset, out, &remaining);
+	if (count == 0)
 		return P11_RPC_OK;
 
-	from = *at - offset;
-	assert (from < len);
-
-	num = read (fd, data + from, len - from);
+	num = readv (fd, out, count);
 	errn = errno;
 
 	/* Update state */
 	if (num > 0)
 		*at += num;
 
-	/* Completely read out this block */
-	if (num == len - from) {
+	/* Completely read out these blocks */
+	if (num == remaining) {
 		p11_debug ("ok: read block of %d", (int)num);
 		status = P11_RPC_OK;
 
-	/* Partially read out this block */
+	/* Partially read out these blocks */
 	} else if (num > 0) {
 		p11_debug ("again: partial read of %d", (int)num);
 		status = P11_RPC_AGAIN;
@@ -503,6 +615,7 @@ p11_rpc_transport_read (int fd,
                         p11_buffer *buffer)
 {
 	unsigned char *header;
+	struct iovec iov[2];
 	p11_rpc_status status;
 	size_t len;
 
@@ -515,7 +628,9 @@ p11_rpc_transport_read (int fd,
 	if (*state < 12) {
 		if (!p11_buffer_reset (buffer, 12))
 			return_val_if_reached (P11_RPC_ERROR);
-		status = read_at (fd, buffer->data, 12, 0, state);
+		iov[0].iov_base = buffer->data;
+		iov[0].iov_len = 12;
+		status = read_at (fd, iov, 1, 0, state);
 		if (status != P11_RPC_OK)
 			return status;
 
@@ -533,11 +648,11 @@ p11_rpc_transport_read (int fd,
 	}
 
 	/* At this point options has a valid len field */
-	status = read_at (fd, options->data, options->len, 12, state);
-	if (status == P11_RPC_OK) {
-		status = read_at (fd, buffer->data, buffer->len,
-		                  12 + options->len, state);
-	}
+	iov[0].iov_base = options->data;
+	iov[0].iov_len = options->len;
+	iov[1].iov_base = buffer->data;
+	iov[1].iov_len = buffer->len;
+	status = read_at (fd, iov, 2, 12, state);
 
 	if (status == P11_RPC_OK)
 		*state = 0;
@@ -711,6 +826,49 @@ set_cloexec_on_fd (void *data,
 	return 0;
 }
 
+/*
+ * Exchanges the credential bytes up front, offering the server a ring
+ * in shared memory. Newer servers reply with the features they support,
+ * including whether they accepted the ring.
+ */
+static CK_RV
+rpc_socket_negotiate (rpc_socket *sock,
+                      unsigned int *features)
+{
+	p11_rpc_ring *ring;
+	unsigned char version;
+
+	*features = 0;
+	ring = p11_rpc_ring_new (sock->fd);
+
+	if (!p11_rpc_ring_send_version (sock->fd, 0, ring)) {
+		p11_rpc_ring_free (ring);
+		return CKR_DEVICE_ERROR;
+	}
+
+	sock->sent_creds = true;
+
+	p11_mutex_lock (&sock->read_lock);
+	if (!read_all (sock, &version, 1)) {
+		p11_mutex_unlock (&sock->read_lock);
+		p11_rpc_ring_free (ring);
+		return CKR_DEVICE_ERROR;
+	}
+	sock->read_creds = true;
+	p11_mutex_unlock (&sock->read_lock);
+
+	*features = version;
+
+	if (ring && (version & P11_RPC_FEATURE_RING)) {
+		p11_debug ("using shared memory ring for rpc");
+		sock->ring = ring;
+	} else {
+		p11_rpc_ring_free (ring);
+	}
+
+	return CKR_OK;
+}
+
 static CK_RV
 rpc_exec_connect (p11_rpc_client_vtable *vtable,
                   void *init_reserved)
@@ -718,6 +876,7 @@ rpc_exec_connect (p11_rpc_client_vtable *vtable,
 	rpc_exec *rex = (rpc_exec *)vtable;
 	pid_t pid;
 	int max_fd;
+	CK_RV rv;
 	int fds[2];
 	int errn;
 
@@ -767,7 +926,11 @@ rpc_exec_connect (p11_rpc_client_vtable *vtable,
 	rex->base.socket = rpc_socket_new (fds[0]);
 	return_val_if_fail (rex->base.socket != NULL, CKR_GENERAL_ERROR);
 
-	return CKR_OK;
+	rv = rpc_socket_negotiate (rex->base.socket, &vtable->features);
+	if (rv != CKR_OK)
+		rpc_exec_disconnect (vtable, NULL);
+
+	return rv;
 }
 
 static void
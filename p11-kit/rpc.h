@@ -54,17 +54,80 @@ struct _p11_rpc_client_vtable {
 
 	void        (* disconnect)    (p11_rpc_client_vtable *vtable,
 	                               void *fini_reserved);
+
+	/* What the other side supports, set when connecting */
+	unsigned int features;
+};
+
+/* Sent back by the server along with the credential byte */
+enum {
+	P11_RPC_FEATURE_RING = 1 << 0,
+	P11_RPC_FEATURE_BATCH = 1 << 1,
+	P11_RPC_FEATURE_COMPACT = 1 << 2,
 };
 
 bool                   p11_rpc_client_init         (p11_virtual *virt,
                                                     p11_rpc_client_vtable *vtable);
 
+bool                   p11_rpc_client_set_cache    (p11_virtual *virt);
+
 bool                   p11_rpc_server_handle       (CK_X_FUNCTION_LIST *funcs,
                                                     p11_buffer *request,
                                                     p11_buffer *response);
 
 extern CK_MECHANISM_TYPE *  p11_rpc_mechanisms_override_supported;
 
+typedef struct _p11_rpc_batch p11_rpc_batch;
+
+p11_rpc_batch *        p11_rpc_batch_new           (CK_X_FUNCTION_LIST *rpc_module);
+
+int                    p11_rpc_batch_open_session  (p11_rpc_batch *batch,
+                                                    CK_SLOT_ID slot,
+                                                    CK_FLAGS flags,
+                                                    CK_SESSION_HANDLE *session);
+
+int                    p11_rpc_batch_close_session (p11_rpc_batch *batch,
+                                                    CK_SESSION_HANDLE session);
+
+int                    p11_rpc_batch_find_objects_init
+                                                   (p11_rpc_batch *batch,
+                                                    CK_SESSION_HANDLE session,
+                                                    CK_ATTRIBUTE *match,
+                                                    CK_ULONG count);
+
+int                    p11_rpc_batch_find_objects  (p11_rpc_batch *batch,
+                                                    CK_SESSION_HANDLE session,
+                                                    CK_OBJECT_HANDLE *objects,
+                                                    CK_ULONG max_count,
+                                                    CK_ULONG *count);
+
+int                    p11_rpc_batch_find_objects_final
+                                                   (p11_rpc_batch *batch,
+                                                    CK_SESSION_HANDLE session);
+
+int                    p11_rpc_batch_get_attribute_value
+                                                   (p11_rpc_batch *batch,
+                                                    CK_SESSION_HANDLE session,
+                                                    CK_OBJECT_HANDLE object,
+                                                    CK_ATTRIBUTE *template,
+                                                    CK_ULONG count);
+
+void                   p11_rpc_batch_use           (p11_rpc_batch *batch,
+                                                    int argument,
+                                                    int call,
+                                                    CK_ULONG index);
+
+void                   p11_rpc_batch_unless        (p11_rpc_batch *batch,
+                                                    int call,
+                                                    CK_ULONG index);
+
+CK_RV                  p11_rpc_batch_run           (p11_rpc_batch *batch);
+
+CK_RV                  p11_rpc_batch_result        (p11_rpc_batch *batch,
+                                                    int call);
+
+void                   p11_rpc_batch_free          (p11_rpc_batch *batch);
+
 typedef struct _p11_rpc_transport p11_rpc_transport;
 
 p11_rpc_transport *    p11_rpc_transport_new       (p11_virtual *virt,
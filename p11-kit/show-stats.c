@@ -0,0 +1,197 @@
+/*
+ * Copyright (c) 2016 Red Hat Inc
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *     * Redistributions of source code must retain the above
+ *       copyright notice, this list of conditions and the
+ *       following disclaimer.
+ *     * Redistributions in binary form must reproduce the
+ *       above copyright notice, this list of conditions and
+ *       the following disclaimer in the documentation and/or
+ *       other materials provided with the distribution.
+ *     * The names of contributors to this software may not be
+ *       used to endorse or promote products derived from this
+ *       software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+#include "config.h"
+
+#include "compat.h"
+#include "debug.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "iter.h"
+#include "message.h"
+#include "p11-kit.h"
+#include "tool.h"
+
+int p11_kit_stats (int argc,
+                   char *argv[]);
+
+static void
+run_workload (CK_FUNCTION_LIST_PTR *modules)
+{
+	CK_OBJECT_CLASS klass;
+	char label[256];
+	char id[256];
+	P11KitIter *iter;
+	CK_INFO info;
+	CK_RV rv;
+	int i;
+
+	CK_ATTRIBUTE attrs[] = {
+		{ CKA_CLASS, &klass, sizeof (klass) },
+		{ CKA_LABEL, label, sizeof (label) },
+		{ CKA_ID, id, sizeof (id) },
+	};
+
+	for (i = 0; modules[i] != NULL; i++)
+		(modules[i]->C_GetInfo) (&info);
+
+	iter = p11_kit_iter_new (NULL, 0);
+	return_if_fail (iter != NULL);
+
+	p11_kit_iter_begin (iter, modules);
+	while ((rv = p11_kit_iter_next (iter)) == CKR_OK) {
+		attrs[1].ulValueLen = sizeof (label);
+		attrs[2].ulValueLen = sizeof (id);
+		p11_kit_iter_get_attributes (iter, attrs, 3);
+	}
+
+	if (rv != CKR_CANCEL)
+		p11_message ("couldn't list objects: %s", p11_kit_strerror (rv));
+
+	p11_kit_iter_free (iter);
+}
+
+static void
+print_stats (CK_FUNCTION_LIST_PTR module)
+{
+	char *stats;
+	char *line;
+	char *next;
+	char *name;
+
+	name = p11_kit_module_get_name (module);
+	printf ("%s:\n", name ? name : "(null)");
+	free (name);
+
+	stats = p11_kit_module_get_stats (module);
+	if (stats == NULL) {
+		printf ("    (no statistics)\n");
+		return;
+	}
+
+	for (line = stats; *line; line = next) {
+		next = strchr (line, '\n');
+		if (next)
+			*(next++) = 0;
+		else
+			next = line + strlen (line);
+		printf ("    %s\n", line);
+	}
+
+	free (stats);
+}
+
+int
+p11_kit_stats (int argc,
+               char *argv[])
+{
+	CK_FUNCTION_LIST_PTR *module_list;
+	unsigned long iterations = 1;
+	char *end;
+	int opt;
+	int i;
+
+	enum {
+		opt_verbose = 'v',
+		opt_quiet = 'q',
+		opt_iterations = 'n',
+		opt_help = 'h',
+	};
+
+	struct option options[] = {
+		{ "verbose", no_argument, NULL, opt_verbose },
+		{ "quiet", no_argument, NULL, opt_quiet },
+		{ "iterations", required_argument, NULL, opt_iterations },
+		{ "help", no_argument, NULL, opt_help },
+		{ 0 },
+	};
+
+	p11_tool_desc usages[] = {
+		{ 0, "usage: p11-kit stats" },
+		{ opt_iterations, "number of times to list all objects", "count" },
+		{ opt_verbose, "show verbose debug output", },
+		{ opt_quiet, "suppress command output", },
+		{ 0 },
+	};
+
+	while ((opt = p11_tool_getopt (argc, argv, options)) != -1) {
+		switch (opt) {
+
+		case opt_verbose:
+			p11_kit_be_loud ();
+			break;
+
+		case opt_quiet:
+			p11_kit_be_quiet ();
+			break;
+
+		case opt_iterations:
+			iterations = strtoul (optarg, &end, 10);
+			if (*end || iterations == 0) {
+				p11_message ("invalid number of iterations: %s", optarg);
+				return 2;
+			}
+			break;
+
+		case opt_help:
+			p11_tool_usage (usages, options);
+			return 0;
+		case '?':
+			return 2;
+		default:
+			assert_not_reached ();
+			break;
+		}
+	}
+
+	if (argc - optind != 0) {
+		p11_message ("extra arguments specified");
+		return 2;
+	}
+
+	module_list = p11_kit_modules_load_and_initialize (P11_KIT_MODULE_STATS);
+	if (!module_list)
+		return 1;
+
+	while (iterations-- > 0)
+		run_workload (module_list);
+
+	for (i = 0; module_list[i]; i++)
+		print_stats (module_list[i]);
+
+	p11_kit_modules_finalize_and_release (module_list);
+	return 0;
+}
@@ -0,0 +1,1092 @@
+/*
+ * Copyright (c) 2016 Red Hat Inc
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *     * Redistributions of source code must retain the above
+ *       copyright notice, this list of conditions and the
+ *       following disclaimer.
+ *     * Redistributions in binary form must reproduce the
+ *       above copyright notice, this list of conditions and
+ *       the following disclaimer in the documentation and/or
+ *       other materials provided with the distribution.
+ *     * The names of contributors to this software may not be
+ *       used to endorse or promote products derived from this
+ *       software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+#include "config.h"
+
+#include "compat.h"
+#include "debug.h"
+#include "stats.h"
+#include "virtual.h"
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+bool p11_stats_force = false;
+
+#define STATS_INDEX(name) \
+	((offsetof (CK_X_FUNCTION_LIST, C_##name) - offsetof (CK_X_FUNCTION_LIST, C_Initialize)) / \
+	 sizeof (CK_X_Initialize))
+
+#define N_FUNCTIONS \
+	((sizeof (CK_X_FUNCTION_LIST) - offsetof (CK_X_FUNCTION_LIST, C_Initialize)) / \
+	 sizeof (CK_X_Initialize))
+
+#define SUB_MASK ((1 << P11_STATS_SUB_BITS) - 1)
+
+struct _p11_stats {
+	p11_stats_function functions[N_FUNCTIONS];
+};
+
+typedef struct {
+	p11_virtual virt;
+	CK_X_FUNCTION_LIST *lower;
+	p11_stats *stats;
+} StatsLayer;
+
+p11_stats *
+p11_stats_new (void)
+{
+	p11_stats *stats;
+
+	stats = calloc (1, sizeof (p11_stats));
+	return_val_if_fail (stats != NULL, NULL);
+
+	return stats;
+}
+
+void
+p11_stats_free (void *stats)
+{
+	free (stats);
+}
+
+void
+p11_stats_reset (p11_stats *stats)
+{
+	p11_stats_function *func;
+	int i, j;
+
+	return_if_fail (stats != NULL);
+
+	for (i = 0; i < N_FUNCTIONS; i++) {
+		func = stats->functions + i;
+		p11_atomic_store (&func->calls, 0, RELAXED);
+		p11_atomic_store (&func->errors, 0, RELAXED);
+		p11_atomic_store (&func->total, 0, RELAXED);
+		p11_atomic_store (&func->max, 0, RELAXED);
+		for (j = 0; j < P11_STATS_BUCKETS; j++)
+			p11_atomic_store (func->buckets + j, 0, RELAXED);
+	}
+}
+
+/*
+ * Histogram buckets are log-linear, as in HDR histograms: each power of
+ * two is split into 1 << P11_STATS_SUB_BITS equal steps, so a value is
+ * placed within 12.5% of its real size, no matter how large it is.
+ */
+
+int
+p11_stats_bucket (uint64_t value)
+{
+	int msb;
+
+	if (value <= SUB_MASK)
+		return (int)value;
+	if (value >> P11_STATS_MAX_BITS)
+		return P11_STATS_BUCKETS - 1;
+
+	msb = 63 - p11_clz64 (value);
+	return ((msb - P11_STATS_SUB_BITS + 1) << P11_STATS_SUB_BITS) |
+	       (int)((value >> (msb - P11_STATS_SUB_BITS)) & SUB_MASK);
+}
+
+uint64_t
+p11_stats_bucket_limit (int bucket)
+{
+	uint64_t step;
+	int shift;
+
+	return_val_if_fail (bucket >= 0 && bucket < P11_STATS_BUCKETS, 0);
+
+	if (bucket <= SUB_MASK)
+		return bucket;
+
+	/* The largest value that still falls in this bucket */
+	shift = (bucket >> P11_STATS_SUB_BITS) - 1;
+	step = (bucket & SUB_MASK) | (1 << P11_STATS_SUB_BITS);
+	return ((step + 1) << shift) - 1;
+}
+
+uint64_t
+p11_stats_percentile (const p11_stats_function *func,
+                      double percentile)
+{
+	uint64_t count = 0;
+	uint64_t total = 0;
+	uint64_t limit;
+	double target;
+	int i;
+
+	return_val_if_fail (func != NULL, 0);
+	return_val_if_fail (percentile >= 0.0 && percentile <= 100.0, 0);
+
+	for (i = 0; i < P11_STATS_BUCKETS; i++)
+		total += func->buckets[i];
+	if (total == 0)
+		return 0;
+
+	target = total * percentile / 100.0;
+	for (i = 0; i < P11_STATS_BUCKETS; i++) {
+		count += func->buckets[i];
+		if (count > 0 && count >= target)
+			break;
+	}
+
+	assert (i < P11_STATS_BUCKETS);
+	limit = p11_stats_bucket_limit (i);
+	return limit < func->max ? limit : func->max;
+}
+
+static void
+stats_snapshot (const p11_stats_function *func,
+                p11_stats_function *result)
+{
+	int i;
+
+	result->calls = p11_atomic_load (&func->calls, RELAXED);
+	result->errors = p11_atomic_load (&func->errors, RELAXED);
+	result->total = p11_atomic_load (&func->total, RELAXED);
+	result->max = p11_atomic_load (&func->max, RELAXED);
+	for (i = 0; i < P11_STATS_BUCKETS; i++)
+		result->buckets[i] = p11_atomic_load (func->buckets + i, RELAXED);
+}
+
+#define FUNCTION(name) { "C_" #name, STATS_INDEX (name) }
+
+static const struct {
+	const char *name;
+	int index;
+} function_names[] = {
+	FUNCTION (Initialize),
+	FUNCTION (Finalize),
+	FUNCTION (GetInfo),
+	FUNCTION (GetSlotList),
+	FUNCTION (GetSlotInfo),
+	FUNCTION (GetTokenInfo),
+	FUNCTION (GetMechanismList),
+	FUNCTION (GetMechanismInfo),
+	FUNCTION (InitToken),
+	FUNCTION (InitPIN),
+	FUNCTION (SetPIN),
+	FUNCTION (OpenSession),
+	FUNCTION (CloseSession),
+	FUNCTION (CloseAllSessions),
+	FUNCTION (GetSessionInfo),
+	FUNCTION (GetOperationState),
+	FUNCTION (SetOperationState),
+	FUNCTION (Login),
+	FUNCTION (Logout),
+	FUNCTION (CreateObject),
+	FUNCTION (CopyObject),
+	FUNCTION (DestroyObject),
+	FUNCTION (GetObjectSize),
+	FUNCTION (GetAttributeValue),
+	FUNCTION (SetAttributeValue),
+	FUNCTION (FindObjectsInit),
+	FUNCTION (FindObjects),
+	FUNCTION (FindObjectsFinal),
+	FUNCTION (EncryptInit),
+	FUNCTION (Encrypt),
+	FUNCTION (EncryptUpdate),
+	FUNCTION (EncryptFinal),
+	FUNCTION (DecryptInit),
+	FUNCTION (Decrypt),
+	FUNCTION (DecryptUpdate),
+	FUNCTION (DecryptFinal),
+	FUNCTION (DigestInit),
+	FUNCTION (Digest),
+	FUNCTION (DigestUpdate),
+	FUNCTION (DigestKey),
+	FUNCTION (DigestFinal),
+	FUNCTION (SignInit),
+	FUNCTION (Sign),
+	FUNCTION (SignUpdate),
+	FUNCTION (SignFinal),
+	FUNCTION (SignRecoverInit),
+	FUNCTION (SignRecover),
+	FUNCTION (VerifyInit),
+	FUNCTION (Verify),
+	FUNCTION (VerifyUpdate),
+	FUNCTION (VerifyFinal),
+	FUNCTION (VerifyRecoverInit),
+	FUNCTION (VerifyRecover),
+	FUNCTION (DigestEncryptUpdate),
+	FUNCTION (DecryptDigestUpdate),
+	FUNCTION (SignEncryptUpdate),
+	FUNCTION (DecryptVerifyUpdate),
+	FUNCTION (GenerateKey),
+	FUNCTION (GenerateKeyPair),
+	FUNCTION (WrapKey),
+	FUNCTION (UnwrapKey),
+	FUNCTION (DeriveKey),
+	FUNCTION (SeedRandom),
+	FUNCTION (GenerateRandom),
+	FUNCTION (WaitForSlotEvent),
+	{ NULL, }
+};
+
+bool
+p11_stats_lookup (p11_stats *stats,
+                  const char *function,
+                  p11_stats_function *result)
+{
+	int i;
+
+	return_val_if_fail (stats != NULL, false);
+	return_val_if_fail (function != NULL, false);
+	return_val_if_fail (result != NULL, false);
+
+	for (i = 0; function_names[i].name != NULL; i++) {
+		if (strcmp (function_names[i].name, function) == 0) {
+			stats_snapshot (stats->functions + function_names[i].index, result);
+			return true;
+		}
+	}
+
+	return false;
+}
+
+static void
+format_duration (char *buf,
+                 size_t length,
+                 uint64_t nanoseconds)
+{
+	if (nanoseconds < 1000ULL)
+		snprintf (buf, length, "%u ns", (unsigned int)nanoseconds);
+	else if (nanoseconds < 1000000ULL)
+		snprintf (buf, length, "%.1f us", nanoseconds / 1000.0);
+	else if (nanoseconds < 1000000000ULL)
+		snprintf (buf, length, "%.1f ms", nanoseconds / 1000000.0);
+	else
+		snprintf (buf, length, "%.2f s", nanoseconds / 1000000000.0);
+}
+
+void
+p11_stats_format (p11_stats *stats,
+                  p11_buffer *buffer)
+{
+	p11_stats_function func;
+	char line[256];
+	char mean[32];
+	char p50[32];
+	char p90[32];
+	char p99[32];
+	char max[32];
+	int i;
+
+	return_if_fail (stats != NULL);
+	return_if_fail (buffer != NULL);
+
+	snprintf (line, sizeof (line), "%-24s %10s %8s %10s %10s %10s %10s %10s\n",
+	          "function", "calls", "errors", "mean", "p50", "p90", "p99", "max");
+	p11_buffer_add (buffer, line, -1);
+
+	for (i = 0; function_names[i].name != NULL; i++) {
+		stats_snapshot (stats->functions + function_names[i].index, &func);
+		if (func.calls == 0)
+			continue;
+
+		format_duration (mean, sizeof (mean), func.total / func.calls);
+		format_duration (p50, sizeof (p50), p11_stats_percentile (&func, 50.0));
+		format_duration (p90, sizeof (p90), p11_stats_percentile (&func, 90.0));
+		format_duration (p99, sizeof (p99), p11_stats_percentile (&func, 99.0));
+		format_duration (max, sizeof (max), func.max);
+
+		snprintf (line, sizeof (line), "%-24s %10lu %8lu %10s %10s %10s %10s %10s\n",
+		          function_names[i].name, (unsigned long)func.calls,
+		          (unsigned long)func.errors, mean, p50, p90, p99, max);
+		p11_buffer_add (buffer, line, -1);
+	}
+}
+
+/*
+ * Calls from many threads update the same counters. Relaxed atomic adds
+ * keep this cheap, and the counters needn't agree with each other exactly
+ * while calls are in progress.
+ */
+
+static void
+stats_record (p11_stats_function *func,
+              CK_RV rv,
+              uint64_t elapsed)
+{
+	uint64_t max;
+
+	p11_atomic_add (&func->calls, 1, RELAXED);
+	if (rv != CKR_OK)
+		p11_atomic_add (&func->errors, 1, RELAXED);
+	p11_atomic_add (&func->total, elapsed, RELAXED);
+	p11_atomic_add (func->buckets + p11_stats_bucket (elapsed), 1, RELAXED);
+
+	max = p11_atomic_load (&func->max, RELAXED);
+	while (elapsed > max &&
+	       !p11_atomic_compare_exchange (&func->max, &max, elapsed));
+}
+
+#define STATS_CALL(name, args) \
+	StatsLayer *_layer = (StatsLayer *)self; \
+	CK_X_##name _func = _layer->lower->C_##name; \
+	uint64_t _start; \
+	CK_RV _ret; \
+	return_val_if_fail (_func != NULL, CKR_DEVICE_ERROR); \
+	self = _layer->lower; \
+	_start = p11_clock_ns (); \
+	_ret = (_func) args; \
+	stats_record (_layer->stats->functions + STATS_INDEX (name), \
+	              _ret, p11_clock_ns () - _start); \
+	return _ret;
+
+static CK_RV
+stats_C_Initialize (CK_X_FUNCTION_LIST *self,
+                    CK_VOID_PTR pInitArgs)
+{
+	STATS_CALL (Initialize, (self, pInitArgs))
+}
+
+static CK_RV
+stats_C_Finalize (CK_X_FUNCTION_LIST *self,
+                  CK_VOID_PTR pReserved)
+{
+	STATS_CALL (Finalize, (self, pReserved))
+}
+
+static CK_RV
+stats_C_GetInfo (CK_X_FUNCTION_LIST *self,
+                 CK_INFO_PTR pInfo)
+{
+	STATS_CALL (GetInfo, (self, pInfo))
+}
+
+static CK_RV
+stats_C_GetSlotList (CK_X_FUNCTION_LIST *self,
+                     CK_BBOOL tokenPresent,
+                     CK_SLOT_ID_PTR pSlotList,
+                     CK_ULONG_PTR pulCount)
+{
+	STATS_CALL (GetSlotList, (self, tokenPresent, pSlotList, pulCount))
+}
+
+static CK_RV
+stats_C_GetSlotInfo (CK_X_FUNCTION_LIST *self,
+                     CK_SLOT_ID slotID,
+                     CK_SLOT_INFO_PTR pInfo)
+{
+	STATS_CALL (GetSlotInfo, (self, slotID, pInfo))
+}
+
+static CK_RV
+stats_C_GetTokenInfo (CK_X_FUNCTION_LIST *self,
+                      CK_SLOT_ID slotID,
+                      CK_TOKEN_INFO_PTR pInfo)
+{
+	STATS_CALL (GetTokenInfo, (self, slotID, pInfo))
+}
+
+static CK_RV
+stats_C_GetMechanismList (CK_X_FUNCTION_LIST *self,
+                          CK_SLOT_ID slotID,
+                          CK_MECHANISM_TYPE_PTR pMechanismList,
+                          CK_ULONG_PTR pulCount)
+{
+	STATS_CALL (GetMechanismList, (self, slotID, pMechanismList, pulCount))
+}
+
+static CK_RV
+stats_C_GetMechanismInfo (CK_X_FUNCTION_LIST *self,
+                          CK_SLOT_ID slotID,
+                          CK_MECHANISM_TYPE type,
+                          CK_MECHANISM_INFO_PTR pInfo)
+{
+	STATS_CALL (GetMechanismInfo, (self, slotID, type, pInfo))
+}
+
+static CK_RV
+stats_C_InitToken (CK_X_FUNCTION_LIST *self,
+                   CK_SLOT_ID slotID,
+                   CK_UTF8CHAR_PTR pPin,
+                   CK_ULONG ulPinLen,
+                   CK_UTF8CHAR_PTR pLabel)
+{
+	STATS_CALL (InitToken, (self, slotID, pPin, ulPinLen, pLabel))
+}
+
+static CK_RV
+stats_C_WaitForSlotEvent (CK_X_FUNCTION_LIST *self,
+                          CK_FLAGS flags,
+                          CK_SLOT_ID_PTR pSlot,
+                          CK_VOID_PTR pReserved)
+{
+	STATS_CALL (WaitForSlotEvent, (self, flags, pSlot, pReserved))
+}
+
+static CK_RV
+stats_C_OpenSession (CK_X_FUNCTION_LIST *self,
+                     CK_SLOT_ID slotID,
+                     CK_FLAGS flags,
+                     CK_VOID_PTR pApplication,
+                     CK_NOTIFY Notify,
+                     CK_SESSION_HANDLE_PTR phSession)
+{
+	STATS_CALL (OpenSession, (self, slotID, flags, pApplication, Notify, phSession))
+}
+
+static CK_RV
+stats_C_CloseSession (CK_X_FUNCTION_LIST *self,
+                      CK_SESSION_HANDLE hSession)
+{
+	STATS_CALL (CloseSession, (self, hSession))
+}
+
+static CK_RV
+stats_C_CloseAllSessions (CK_X_FUNCTION_LIST *self,
+                          CK_SLOT_ID slotID)
+{
+	STATS_CALL (CloseAllSessions, (self, slotID))
+}
+
+static CK_RV
+stats_C_GetSessionInfo (CK_X_FUNCTION_LIST *self,
+                        CK_SESSION_HANDLE hSession,
+                        CK_SESSION_INFO_PTR pInfo)
+{
+	STATS_CALL (GetSessionInfo, (self, hSession, pInfo))
+}
+
+static CK_RV
+stats_C_InitPIN (CK_X_FUNCTION_LIST *self,
+                 CK_SESSION_HANDLE hSession,
+                 CK_UTF8CHAR_PTR pPin,
+                 CK_ULONG ulPinLen)
+{
+	STATS_CALL (InitPIN, (self, hSession, pPin, ulPinLen))
+}
+
+static CK_RV
+stats_C_SetPIN (CK_X_FUNCTION_LIST *self,
+                CK_SESSION_HANDLE hSession,
+                CK_UTF8CHAR_PTR pOldPin,
+                CK_ULONG ulOldLen,
+                CK_UTF8CHAR_PTR pNewPin,
+                CK_ULONG ulNewLen)
+{
+	STATS_CALL (SetPIN, (self, hSession, pOldPin, ulOldLen, pNewPin, ulNewLen))
+}
+
+static CK_RV
+stats_C_GetOperationState (CK_X_FUNCTION_LIST *self,
+                           CK_SESSION_HANDLE hSession,
+                           CK_BYTE_PTR pOperationState,
+                           CK_ULONG_PTR pulOperationStateLen)
+{
+	STATS_CALL (GetOperationState, (self, hSession, pOperationState, pulOperationStateLen))
+}
+
+static CK_RV
+stats_C_SetOperationState (CK_X_FUNCTION_LIST *self,
+                           CK_SESSION_HANDLE hSession,
+                           CK_BYTE_PTR pOperationState,
+                           CK_ULONG ulOperationStateLen,
+                           CK_OBJECT_HANDLE hEncryptionKey,
+                           CK_OBJECT_HANDLE hAuthenticationKey)
+{
+	STATS_CALL (SetOperationState, (self, hSession, pOperationState, ulOperationStateLen, hEncryptionKey, hAuthenticationKey))
+}
+
+static CK_RV
+stats_C_Login (CK_X_FUNCTION_LIST *self,
+               CK_SESSION_HANDLE hSession,
+               CK_USER_TYPE userType,
+               CK_UTF8CHAR_PTR pPin,
+               CK_ULONG ulPinLen)
+{
+	STATS_CALL (Login, (self, hSession, userType, pPin, ulPinLen))
+}
+
+static CK_RV
+stats_C_Logout (CK_X_FUNCTION_LIST *self,
+                CK_SESSION_HANDLE hSession)
+{
+	STATS_CALL (Logout, (self, hSession))
+}
+
+static CK_RV
+stats_C_CreateObject (CK_X_FUNCTION_LIST *self,
+                      CK_SESSION_HANDLE hSession,
+                      CK_ATTRIBUTE_PTR pTemplate,
+                      CK_ULONG ulCount,
+                      CK_OBJECT_HANDLE_PTR phObject)
+{
+	STATS_CALL (CreateObject, (self, hSession, pTemplate, ulCount, phObject))
+}
+
+static CK_RV
+stats_C_CopyObject (CK_X_FUNCTION_LIST *self,
+                    CK_SESSION_HANDLE hSession,
+                    CK_OBJECT_HANDLE hObject,
+                    CK_ATTRIBUTE_PTR pTemplate,
+                    CK_ULONG ulCount,
+                    CK_OBJECT_HANDLE_PTR phNewObject)
+{
+	STATS_CALL (CopyObject, (self, hSession, hObject, pTemplate, ulCount, phNewObject))
+}
+
+static CK_RV
+stats_C_DestroyObject (CK_X_FUNCTION_LIST *self,
+                       CK_SESSION_HANDLE hSession,
+                       CK_OBJECT_HANDLE hObject)
+{
+	STATS_CALL (DestroyObject, (self, hSession, hObject))
+}
+
+static CK_RV
+stats_C_GetObjectSize (CK_X_FUNCTION_LIST *self,
+                       CK_SESSION_HANDLE hSession,
+                       CK_OBJECT_HANDLE hObject,
+                       CK_ULONG_PTR size)
+{
+	STATS_CALL (GetObjectSize, (self, hSession, hObject, size))
+}
+
+static CK_RV
+stats_C_GetAttributeValue (CK_X_FUNCTION_LIST *self,
+                           CK_SESSION_HANDLE hSession,
+                           CK_OBJECT_HANDLE hObject,
+                           CK_ATTRIBUTE_PTR pTemplate,
+                           CK_ULONG ulCount)
+{
+	STATS_CALL (GetAttributeValue, (self, hSession, hObject, pTemplate, ulCount))
+}
+
+static CK_RV
+stats_C_SetAttributeValue (CK_X_FUNCTION_LIST *self,
+                           CK_SESSION_HANDLE hSession,
+                           CK_OBJECT_HANDLE hObject,
+                           CK_ATTRIBUTE_PTR pTemplate,
+                           CK_ULONG ulCount)
+{
+	STATS_CALL (SetAttributeValue, (self, hSession, hObject, pTemplate, ulCount))
+}
+
+static CK_RV
+stats_C_FindObjectsInit (CK_X_FUNCTION_LIST *self,
+                         CK_SESSION_HANDLE hSession,
+                         CK_ATTRIBUTE_PTR pTemplate,
+                         CK_ULONG ulCount)
+{
+	STATS_CALL (FindObjectsInit, (self, hSession, pTemplate, ulCount))
+}
+
+static CK_RV
+stats_C_FindObjects (CK_X_FUNCTION_LIST *self,
+                     CK_SESSION_HANDLE hSession,
+                     CK_OBJECT_HANDLE_PTR object,
+                     CK_ULONG max_object_count,
+                     CK_ULONG_PTR object_count)
+{
+	STATS_CALL (FindObjects, (self, hSession, object, max_object_count, object_count))
+}
+
+static CK_RV
+stats_C_FindObjectsFinal (CK_X_FUNCTION_LIST *self,
+                          CK_SESSION_HANDLE hSession)
+{
+	STATS_CALL (FindObjectsFinal, (self, hSession))
+}
+
+static CK_RV
+stats_C_EncryptInit (CK_X_FUNCTION_LIST *self,
+                     CK_SESSION_HANDLE hSession,
+                     CK_MECHANISM_PTR pMechanism,
+                     CK_OBJECT_HANDLE hKey)
+{
+	STATS_CALL (EncryptInit, (self, hSession, pMechanism, hKey))
+}
+
+static CK_RV
+stats_C_Encrypt (CK_X_FUNCTION_LIST *self,
+                 CK_SESSION_HANDLE hSession,
+                 CK_BYTE_PTR pData,
+                 CK_ULONG ulDataLen,
+                 CK_BYTE_PTR pEncryptedData,
+                 CK_ULONG_PTR pulEncryptedDataLen)
+{
+	STATS_CALL (Encrypt, (self, hSession, pData, ulDataLen, pEncryptedData, pulEncryptedDataLen))
+}
+
+static CK_RV
+stats_C_EncryptUpdate (CK_X_FUNCTION_LIST *self,
+                       CK_SESSION_HANDLE hSession,
+                       CK_BYTE_PTR pPart,
+                       CK_ULONG ulPartLen,
+                       CK_BYTE_PTR pEncryptedPart,
+                       CK_ULONG_PTR pulEncryptedPartLen)
+{
+	STATS_CALL (EncryptUpdate, (self, hSession, pPart, ulPartLen, pEncryptedPart, pulEncryptedPartLen))
+}
+
+static CK_RV
+stats_C_EncryptFinal (CK_X_FUNCTION_LIST *self,
+                      CK_SESSION_HANDLE hSession,
+                      CK_BYTE_PTR pLastEncryptedPart,
+                      CK_ULONG_PTR pulLastEncryptedPartLen)
+{
+	STATS_CALL (EncryptFinal, (self, hSession, pLastEncryptedPart, pulLastEncryptedPartLen))
+}
+
+static CK_RV
+stats_C_DecryptInit (CK_X_FUNCTION_LIST *self,
+                     CK_SESSION_HANDLE hSession,
+                     CK_MECHANISM_PTR pMechanism,
+                     CK_OBJECT_HANDLE hKey)
+{
+	STATS_CALL (DecryptInit, (self, hSession, pMechanism, hKey))
+}
+
+static CK_RV
+stats_C_Decrypt (CK_X_FUNCTION_LIST *self,
+                 CK_SESSION_HANDLE hSession,
+                 CK_BYTE_PTR pEncryptedData,
+                 CK_ULONG ulEncryptedDataLen,
+                 CK_BYTE_PTR pData,
+                 CK_ULONG_PTR pulDataLen)
+{
+	STATS_CALL (Decrypt, (self, hSession, pEncryptedData, ulEncryptedDataLen, pData, pulDataLen))
+}
+
+static CK_RV
+stats_C_DecryptUpdate (CK_X_FUNCTION_LIST *self,
+                       CK_SESSION_HANDLE hSession,
+                       CK_BYTE_PTR pEncryptedPart,
+                       CK_ULONG ulEncryptedPartLen,
+                       CK_BYTE_PTR pPart,
+                       CK_ULONG_PTR pulPartLen)
+{
+	STATS_CALL (DecryptUpdate, (self, hSession, pEncryptedPart, ulEncryptedPartLen, pPart, pulPartLen))
+}
+
+static CK_RV
+stats_C_DecryptFinal (CK_X_FUNCTION_LIST *self,
+                      CK_SESSION_HANDLE hSession,
+                      CK_BYTE_PTR pLastPart,
+                      CK_ULONG_PTR pulLastPartLen)
+{
+	STATS_CALL (DecryptFinal, (self, hSession, pLastPart, pulLastPartLen))
+}
+
+static CK_RV
+stats_C_DigestInit (CK_X_FUNCTION_LIST *self,
+                    CK_SESSION_HANDLE hSession,
+                    CK_MECHANISM_PTR pMechanism)
+{
+	STATS_CALL (DigestInit, (self, hSession, pMechanism))
+}
+
+static CK_RV
+stats_C_Digest (CK_X_FUNCTION_LIST *self,
+                CK_SESSION_HANDLE hSession,
+                CK_BYTE_PTR pData,
+                CK_ULONG ulDataLen,
+                CK_BYTE_PTR pDigest,
+                CK_ULONG_PTR pulDigestLen)
+{
+	STATS_CALL (Digest, (self, hSession, pData, ulDataLen, pDigest, pulDigestLen))
+}
+
+static CK_RV
+stats_C_DigestUpdate (CK_X_FUNCTION_LIST *self,
+                      CK_SESSION_HANDLE hSession,
+                      CK_BYTE_PTR pPart,
+                      CK_ULONG ulPartLen)
+{
+	STATS_CALL (DigestUpdate, (self, hSession, pPart, ulPartLen))
+}
+
+static CK_RV
+stats_C_DigestKey (CK_X_FUNCTION_LIST *self,
+                   CK_SESSION_HANDLE hSession,
+                   CK_OBJECT_HANDLE hKey)
+{
+	STATS_CALL (DigestKey, (self, hSession, hKey))
+}
+
+static CK_RV
+stats_C_DigestFinal (CK_X_FUNCTION_LIST *self,
+                     CK_SESSION_HANDLE hSession,
+                     CK_BYTE_PTR pDigest,
+                     CK_ULONG_PTR pulDigestLen)
+{
+	STATS_CALL (DigestFinal, (self, hSession, pDigest, pulDigestLen))
+}
+
+static CK_RV
+stats_C_SignInit (CK_X_FUNCTION_LIST *self,
+                  CK_SESSION_HANDLE hSession,
+                  CK_MECHANISM_PTR pMechanism,
+                  CK_OBJECT_HANDLE hKey)
+{
+	STATS_CALL (SignInit, (self, hSession, pMechanism, hKey))
+}
+
+static CK_RV
+stats_C_Sign (CK_X_FUNCTION_LIST *self,
+              CK_SESSION_HANDLE hSession,
+              CK_BYTE_PTR pData,
+              CK_ULONG ulDataLen,
+              CK_BYTE_PTR pSignature,
+              CK_ULONG_PTR pulSignatureLen)
+{
+	STATS_CALL (Sign, (self, hSession, pData, ulDataLen, pSignature, pulSignatureLen))
+}
+
+static CK_RV
+stats_C_SignUpdate (CK_X_FUNCTION_LIST *self,
+                    CK_SESSION_HANDLE hSession,
+                    CK_BYTE_PTR pPart,
+                    CK_ULONG ulPartLen)
+{
+	STATS_CALL (SignUpdate, (self, hSession, pPart, ulPartLen))
+}
+
+static CK_RV
+stats_C_SignFinal (CK_X_FUNCTION_LIST *self,
+                   CK_SESSION_HANDLE hSession,
+                   CK_BYTE_PTR pSignature,
+                   CK_ULONG_PTR pulSignatureLen)
+{
+	STATS_CALL (SignFinal, (self, hSession, pSignature, pulSignatureLen))
+}
+
+static CK_RV
+stats_C_SignRecoverInit (CK_X_FUNCTION_LIST *self,
+                         CK_SESSION_HANDLE hSession,
+                         CK_MECHANISM_PTR pMechanism,
+                         CK_OBJECT_HANDLE hKey)
+{
+	STATS_CALL (SignRecoverInit, (self, hSession, pMechanism, hKey))
+}
+
+static CK_RV
+stats_C_SignRecover (CK_X_FUNCTION_LIST *self,
+                     CK_SESSION_HANDLE hSession,
+                     CK_BYTE_PTR pData,
+                     CK_ULONG ulDataLen,
+                     CK_BYTE_PTR pSignature,
+                     CK_ULONG_PTR pulSignatureLen)
+{
+	STATS_CALL (SignRecover, (self, hSession, pData, ulDataLen, pSignature, pulSignatureLen))
+}
+
+static CK_RV
+stats_C_VerifyInit (CK_X_FUNCTION_LIST *self,
+                    CK_SESSION_HANDLE hSession,
+                    CK_MECHANISM_PTR pMechanism,
+                    CK_OBJECT_HANDLE hKey)
+{
+	STATS_CALL (VerifyInit, (self, hSession, pMechanism, hKey))
+}
+
+static CK_RV
+stats_C_Verify (CK_X_FUNCTION_LIST *self,
+                CK_SESSION_HANDLE hSession,
+                CK_BYTE_PTR pData,
+                CK_ULONG ulDataLen,
+                CK_BYTE_PTR pSignature,
+                CK_ULONG ulSignatureLen)
+{
+	STATS_CALL (Verify, (self, hSession, pData, ulDataLen, pSignature, ulSignatureLen))
+}
+
+static CK_RV
+stats_C_VerifyUpdate (CK_X_FUNCTION_LIST *self,
+                      CK_SESSION_HANDLE hSession,
+                      CK_BYTE_PTR pPart,
+                      CK_ULONG ulPartLen)
+{
+	STATS_CALL (VerifyUpdate, (self, hSession, pPart, ulPartLen))
+}
+
+static CK_RV
+stats_C_VerifyFinal (CK_X_FUNCTION_LIST *self,
+                     CK_SESSION_HANDLE hSession,
+                     CK_BYTE_PTR pSignature,
+                     CK_ULONG ulSignatureLen)
+{
+	STATS_CALL (VerifyFinal, (self, hSession, pSignature, ulSignatureLen))
+}
+
+static CK_RV
+stats_C_VerifyRecoverInit (CK_X_FUNCTION_LIST *self,
+                           CK_SESSION_HANDLE hSession,
+                           CK_MECHANISM_PTR pMechanism,
+                           CK_OBJECT_HANDLE hKey)
+{
+	STATS_CALL (VerifyRecoverInit, (self, hSession, pMechanism, hKey))
+}
+
+static CK_RV
+stats_C_VerifyRecover (CK_X_FUNCTION_LIST *self,
+                       CK_SESSION_HANDLE hSession,
+                       CK_BYTE_PTR pSignature,
+                       CK_ULONG ulSignatureLen,
+                       CK_BYTE_PTR pData,
+                       CK_ULONG_PTR pulDataLen)
+{
+	STATS_CALL (VerifyRecover, (self, hSession, pSignature, ulSignatureLen, pData, pulDataLen))
+}
+
+static CK_RV
+stats_C_DigestEncryptUpdate (CK_X_FUNCTION_LIST *self,
+                             CK_SESSION_HANDLE hSession,
+                             CK_BYTE_PTR pPart,
+                             CK_ULONG ulPartLen,
+                             CK_BYTE_PTR pEncryptedPart,
+                             CK_ULONG_PTR pulEncryptedPartLen)
+{
+	STATS_CALL (DigestEncryptUpdate, (self, hSession, pPart, ulPartLen, pEncryptedPart, pulEncryptedPartLen))
+}
+
+static CK_RV
+stats_C_DecryptDigestUpdate (CK_X_FUNCTION_LIST *self,
+                             CK_SESSION_HANDLE hSession,
+                             CK_BYTE_PTR pEncryptedPart,
+                             CK_ULONG ulEncryptedPartLen,
+                             CK_BYTE_PTR pPart,
+                             CK_ULONG_PTR pulPartLen)
+{
+	STATS_CALL (DecryptDigestUpdate, (self, hSession, pEncryptedPart, ulEncryptedPartLen, pPart, pulPartLen))
+}
+
+static CK_RV
+stats_C_SignEncryptUpdate (CK_X_FUNCTION_LIST *self,
+                           CK_SESSION_HANDLE hSession,
+                           CK_BYTE_PTR pPart,
+                           CK_ULONG ulPartLen,
+                           CK_BYTE_PTR pEncryptedPart,
+                           CK_ULONG_PTR pulEncryptedPartLen)
+{
+	STATS_CALL (SignEncryptUpdate, (self, hSession, pPart, ulPartLen, pEncryptedPart, pulEncryptedPartLen))
+}
+
+static CK_RV
+stats_C_DecryptVerifyUpdate (CK_X_FUNCTION_LIST *self,
+                             CK_SESSION_HANDLE hSession,
+                             CK_BYTE_PTR pEncryptedPart,
+                             CK_ULONG ulEncryptedPartLen,
+                             CK_BYTE_PTR pPart,
+                             CK_ULONG_PTR pulPartLen)
+{
+	STATS_CALL (DecryptVerifyUpdate, (self, hSession, pEncryptedPart, ulEncryptedPartLen, pPart, pulPartLen))
+}
+
+static CK_RV
+stats_C_GenerateKey (CK_X_FUNCTION_LIST *self,
+                     CK_SESSION_HANDLE hSession,
+                     CK_MECHANISM_PTR pMechanism,
+                     CK_ATTRIBUTE_PTR pTemplate,
+                     CK_ULONG ulCount,
+                     CK_OBJECT_HANDLE_PTR phKey)
+{
+	STATS_CALL (GenerateKey, (self, hSession, pMechanism, pTemplate, ulCount, phKey))
+}
+
+static CK_RV
+stats_C_GenerateKeyPair (CK_X_FUNCTION_LIST *self,
+                         CK_SESSION_HANDLE hSession,
+                         CK_MECHANISM_PTR pMechanism,
+                         CK_ATTRIBUTE_PTR pPublicKeyTemplate,
+                         CK_ULONG ulPublicKeyAttributeCount,
+                         CK_ATTRIBUTE_PTR pPrivateKeyTemplate,
+                         CK_ULONG ulPrivateKeyAttributeCount,
+                         CK_OBJECT_HANDLE_PTR phPublicKey,
+                         CK_OBJECT_HANDLE_PTR phPrivateKey)
+{
+	STATS_CALL (GenerateKeyPair, (self, hSession, pMechanism, pPublicKeyTemplate, ulPublicKeyAttributeCount, pPrivateKeyTemplate, ulPrivateKeyAttributeCount, phPublicKey, phPrivateKey))
+}
+
+static CK_RV
+stats_C_WrapKey (CK_X_FUNCTION_LIST *self,
+                 CK_SESSION_HANDLE hSession,
+                 CK_MECHANISM_PTR pMechanism,
+                 CK_OBJECT_HANDLE hWrappingKey,
+                 CK_OBJECT_HANDLE hKey,
+                 CK_BYTE_PTR pWrappedKey,
+                 CK_ULONG_PTR pulWrappedKeyLen)
+{
+	STATS_CALL (WrapKey, (self, hSession, pMechanism, hWrappingKey, hKey, pWrappedKey, pulWrappedKeyLen))
+}
+
+static CK_RV
+stats_C_UnwrapKey (CK_X_FUNCTION_LIST *self,
+                   CK_SESSION_HANDLE hSession,
+                   CK_MECHANISM_PTR pMechanism,
+                   CK_OBJECT_HANDLE hUnwrappingKey,
+                   CK_BYTE_PTR pWrappedKey,
+                   CK_ULONG ulWrappedKeyLen,
+                   CK_ATTRIBUTE_PTR pTemplate,
+                   CK_ULONG ulAttributeCount,
+                   CK_OBJECT_HANDLE_PTR phKey)
+{
+	STATS_CALL (UnwrapKey, (self, hSession, pMechanism, hUnwrappingKey, pWrappedKey, ulWrappedKeyLen, pTemplate, ulAttributeCount, phKey))
+}
+
+static CK_RV
+stats_C_DeriveKey (CK_X_FUNCTION_LIST *self,
+                   CK_SESSION_HANDLE hSession,
+                   CK_MECHANISM_PTR pMechanism,
+                   CK_OBJECT_HANDLE hBaseKey,
+                   CK_ATTRIBUTE_PTR pTemplate,
+                   CK_ULONG ulAttributeCount,
+                   CK_OBJECT_HANDLE_PTR phObject)
+{
+	STATS_CALL (DeriveKey, (self, hSession, pMechanism, hBaseKey, pTemplate, ulAttributeCount, phObject))
+}
+
+static CK_RV
+stats_C_SeedRandom (CK_X_FUNCTION_LIST *self,
+                    CK_SESSION_HANDLE hSession,
+                    CK_BYTE_PTR pSeed,
+                    CK_ULONG ulSeedLen)
+{
+	STATS_CALL (SeedRandom, (self, hSession, pSeed, ulSeedLen))
+}
+
+static CK_RV
+stats_C_GenerateRandom (CK_X_FUNCTION_LIST *self,
+                        CK_SESSION_HANDLE hSession,
+                        CK_BYTE_PTR pRandomData,
+                        CK_ULONG ulRandomLen)
+{
+	STATS_CALL (GenerateRandom, (self, hSession, pRandomData, ulRandomLen))
+}
+
+static CK_X_FUNCTION_LIST stats_functions = {
+	{ -1, -1 },
+	stats_C_Initialize,
+	stats_C_Finalize,
+	stats_C_GetInfo,
+	stats_C_GetSlotList,
+	stats_C_GetSlotInfo,
+	stats_C_GetTokenInfo,
+	stats_C_GetMechanismList,
+	stats_C_GetMechanismInfo,
+	stats_C_InitToken,
+	stats_C_InitPIN,
+	stats_C_SetPIN,
+	stats_C_OpenSession,
+	stats_C_CloseSession,
+	stats_C_CloseAllSessions,
+	stats_C_GetSessionInfo,
+	stats_C_GetOperationState,
+	stats_C_SetOperationState,
+	stats_C_Login,
+	stats_C_Logout,
+	stats_C_CreateObject,
+	stats_C_CopyObject,
+	stats_C_DestroyObject,
+	stats_C_GetObjectSize,
+	stats_C_GetAttributeValue,
+	stats_C_SetAttributeValue,
+	stats_C_FindObjectsInit,
+	stats_C_FindObjects,
+	stats_C_FindObjectsFinal,
+	stats_C_EncryptInit,
+	stats_C_Encrypt,
+	stats_C_EncryptUpdate,
+	stats_C_EncryptFinal,
+	stats_C_DecryptInit,
+	stats_C_Decrypt,
+	stats_C_DecryptUpdate,
+	stats_C_DecryptFinal,
+	stats_C_DigestInit,
+	stats_C_Digest,
+	stats_C_DigestUpdate,
+	stats_C_DigestKey,
+	stats_C_DigestFinal,
+	stats_C_SignInit,
+	stats_C_Sign,
+	stats_C_SignUpdate,
+	stats_C_SignFinal,
+	stats_C_SignRecoverInit,
+	stats_C_SignRecover,
+	stats_C_VerifyInit,
+	stats_C_Verify,
+	stats_C_VerifyUpdate,
+	stats_C_VerifyFinal,
+	stats_C_VerifyRecoverInit,
+	stats_C_VerifyRecover,
+	stats_C_DigestEncryptUpdate,
+	stats_C_DecryptDigestUpdate,
+	stats_C_SignEncryptUpdate,
+	stats_C_DecryptVerifyUpdate,
+	stats_C_GenerateKey,
+	stats_C_GenerateKeyPair,
+	stats_C_WrapKey,
+	stats_C_UnwrapKey,
+	stats_C_DeriveKey,
+	stats_C_SeedRandom,
+	stats_C_GenerateRandom,
+	stats_C_WaitForSlotEvent,
+};
+
+void
+p11_stats_release (void *data)
+{
+	StatsLayer *layer = (StatsLayer *)data;
+
+	return_if_fail (data != NULL);
+	p11_virtual_uninit (&layer->virt);
+	free (layer);
+}
+
+p11_virtual *
+p11_stats_subclass (p11_virtual *lower,
+                    p11_destroyer destroyer,
+                    p11_stats *stats)
+{
+	StatsLayer *layer;
+
+	return_val_if_fail (stats != NULL, NULL);
+
+	layer = calloc (1, sizeof (StatsLayer));
+	return_val_if_fail (layer != NULL, NULL);
+
+	/* Calls that the lower level just passes on should skip it */
+	p11_virtual_compile (lower);
+
+	p11_virtual_init (&layer->virt, &stats_functions, lower, destroyer);
+	layer->lower = &lower->funcs;
+	layer->stats = stats;
+	return &layer->virt;
+}
@@ -0,0 +1,84 @@
+/*
+ * Copyright (c) 2016 Red Hat Inc
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *     * Redistributions of source code must retain the above
+ *       copyright notice, this list of conditions and the
+ *       following disclaimer.
+ *     * Redistributions in binary form must reproduce the
+ *       above copyright notice, this list of conditions and
+ *       the following disclaimer in the documentation and/or
+ *       other materials provided with the distribution.
+ *     * The names of contributors to this software may not be
+ *       used to endorse or promote products derived from this
+ *       software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+#ifndef P11_STATS_H_
+#define P11_STATS_H_
+
+#include "buffer.h"
+#include "virtual.h"
+
+#include <stdint.h>
+
+/* Histogram buckets have 1 << P11_STATS_SUB_BITS steps per power of two */
+#define P11_STATS_SUB_BITS  3
+#define P11_STATS_MAX_BITS  36
+#define P11_STATS_BUCKETS   ((P11_STATS_MAX_BITS - P11_STATS_SUB_BITS + 1) << P11_STATS_SUB_BITS)
+
+typedef struct {
+	uint64_t calls;
+	uint64_t errors;
+	uint64_t total;             /* nanoseconds */
+	uint64_t max;               /* nanoseconds */
+	uint64_t buckets[P11_STATS_BUCKETS];
+} p11_stats_function;
+
+typedef struct _p11_stats p11_stats;
+
+p11_stats *             p11_stats_new            (void);
+
+void                    p11_stats_free           (void *stats);
+
+void                    p11_stats_reset          (p11_stats *stats);
+
+bool                    p11_stats_lookup         (p11_stats *stats,
+                                                  const char *function,
+                                                  p11_stats_function *result);
+
+uint64_t                p11_stats_percentile     (const p11_stats_function *func,
+                                                  double percentile);
+
+void                    p11_stats_format         (p11_stats *stats,
+                                                  p11_buffer *buffer);
+
+int                     p11_stats_bucket         (uint64_t value);
+
+uint64_t                p11_stats_bucket_limit   (int bucket);
+
+p11_virtual *           p11_stats_subclass       (p11_virtual *lower,
+                                                  p11_destroyer destroyer,
+                                                  p11_stats *stats);
+
+void                    p11_stats_release        (void *data);
+
+extern bool             p11_stats_force;
+
+#endif /* P11_STATS_H_ */
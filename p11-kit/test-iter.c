@@ -45,6 +45,7 @@
 #include "mock.h"
 
 #include <assert.h>
+#include <stddef.h>
 #include <string.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -1464,6 +1465,543 @@ test_destroy_object (void)
 	finalize_and_free_modules (modules);
 }
 
+static void
+test_scale_objects (void)
+{
+	mock_scale scale = { 3, 100, 0, 0 };
+	CK_OBJECT_CLASS certificate = CKO_CERTIFICATE;
+	CK_BBOOL vtrue = CK_TRUE;
+	CK_ATTRIBUTE *attrs;
+	CK_ATTRIBUTE *attr;
+	CK_SESSION_HANDLE session;
+	CK_OBJECT_HANDLE object;
+	P11KitIter *iter;
+	CK_SLOT_ID slot;
+	CK_RV rv;
+	int generated;
+	int count;
+
+	CK_ATTRIBUTE match[] = {
+		{ CKA_CLASS, &certificate, sizeof (certificate) },
+		{ CKA_LABEL, "Generated 1.7", 13 },
+	};
+
+	CK_ATTRIBUTE token[] = {
+		{ CKA_TOKEN, &vtrue, sizeof (vtrue) },
+	};
+
+	mock_module_reset ();
+	mock_module_scale (&scale);
+	rv = mock_module.C_Initialize (NULL);
+	mock_module_scale (NULL);
+	assert (rv == CKR_OK);
+
+	iter = p11_kit_iter_new (NULL, 0);
+	p11_kit_iter_begin_with (iter, &mock_module, 0, 0);
+
+	count = generated = 0;
+	while ((rv = p11_kit_iter_next (iter)) == CKR_OK) {
+		slot = p11_kit_iter_get_slot (iter);
+		if (slot >= MOCK_SLOT_SCALE_ID) {
+			assert_num_cmp (slot, <, MOCK_SLOT_SCALE_ID + 3);
+			generated++;
+		}
+		count++;
+	}
+
+	assert (rv == CKR_CANCEL);
+	p11_kit_iter_free (iter);
+
+	/* 3 generated tokens with 100 objects each, and the 3 public objects */
+	assert_num_eq (300, generated);
+	assert_num_eq (303, count);
+
+	/* Each certificate has a matching public key on its token */
+	iter = p11_kit_iter_new (NULL, 0);
+	p11_kit_iter_add_filter (iter, match, 2);
+	p11_kit_iter_begin_with (iter, &mock_module, 0, 0);
+
+	rv = p11_kit_iter_next (iter);
+	assert (rv == CKR_OK);
+	assert_num_eq (MOCK_SLOT_SCALE_ID + 1, p11_kit_iter_get_slot (iter));
+
+	attrs = p11_attrs_build (NULL, &(CK_ATTRIBUTE){ CKA_VALUE, NULL, 0 },
+	                         &(CK_ATTRIBUTE){ CKA_ID, NULL, 0 }, NULL);
+	rv = p11_kit_iter_load_attributes (iter, attrs, 2);
+	assert (rv == CKR_OK);
+	attr = p11_attrs_find (attrs, CKA_VALUE);
+	assert_num_eq (1280, attr->ulValueLen);
+
+	/* The generated tokens are read only */
+	session = p11_kit_iter_get_session (iter);
+	rv = (mock_module.C_CreateObject) (session, token, 1, &object);
+	assert (rv == CKR_TOKEN_WRITE_PROTECTED);
+	rv = (mock_module.C_DestroyObject) (session, p11_kit_iter_get_object (iter));
+	assert (rv == CKR_TOKEN_WRITE_PROTECTED);
+
+	rv = p11_kit_iter_next (iter);
+	assert (rv == CKR_CANCEL);
+	p11_kit_iter_free (iter);
+
+	attr = p11_attrs_find (attrs, CKA_ID);
+	match[0] = *attr;
+	iter = p11_kit_iter_new (NULL, 0);
+	p11_kit_iter_add_filter (iter, match, 2);
+	p11_kit_iter_begin_with (iter, &mock_module, 0, 0);
+
+	rv = p11_kit_iter_next (iter);
+	assert (rv == CKR_OK);
+	assert_num_eq (MOCK_SCALE_OBJECT + 114, p11_kit_iter_get_object (iter));
+	rv = p11_kit_iter_next (iter);
+	assert (rv == CKR_OK);
+	assert_num_eq (MOCK_SCALE_OBJECT + 115, p11_kit_iter_get_object (iter));
+	rv = p11_kit_iter_next (iter);
+	assert (rv == CKR_CANCEL);
+
+	p11_kit_iter_free (iter);
+	p11_attrs_free (attrs);
+
+	rv = mock_module.C_Finalize (NULL);
+	assert (rv == CKR_OK);
+}
+
+static void
+test_scale_calls (void)
+{
+	mock_scale scale = { 3, 10, 0, 0 };
+	P11KitIter *iter;
+	CK_RV rv;
+
+	assert_num_eq (true, mock_module_scale_parse ("slots=3,objects=10", &scale));
+	assert_num_eq (3, scale.slots);
+	assert_num_eq (10, scale.objects);
+	assert_num_eq (0, scale.latency);
+	assert_num_eq (true, mock_module_scale_parse ("value=64,latency=5", &scale));
+	assert_num_eq (64, scale.value_len);
+	assert_num_eq (5, scale.latency);
+	assert_num_eq (false, mock_module_scale_parse ("slots=", &scale));
+	assert_num_eq (false, mock_module_scale_parse ("slots=1,other=2", &scale));
+
+	mock_module_reset ();
+	mock_module_reset_calls ();
+	assert (mock_module_scale_parse ("slots=3,objects=10", &scale));
+	mock_module_scale (&scale);
+	rv = mock_module.C_Initialize (NULL);
+	mock_module_scale (NULL);
+	assert (rv == CKR_OK);
+
+	iter = p11_kit_iter_new (NULL, 0);
+	p11_kit_iter_begin_with (iter, &mock_module, 0, 0);
+	while ((rv = p11_kit_iter_next (iter)) == CKR_OK);
+	assert (rv == CKR_CANCEL);
+	p11_kit_iter_free (iter);
+
+	rv = mock_module.C_Finalize (NULL);
+	assert (rv == CKR_OK);
+
+	/* One session and search on each token, including MOCK_SLOT_ONE_ID */
+	assert_num_eq (1, mock_module_calls (offsetof (CK_FUNCTION_LIST, C_Initialize)));
+	assert_num_eq (1, mock_module_calls (offsetof (CK_FUNCTION_LIST, C_Finalize)));
+	assert_num_eq (4, mock_module_calls (offsetof (CK_FUNCTION_LIST, C_OpenSession)));
+	assert_num_eq (4, mock_module_calls (offsetof (CK_FUNCTION_LIST, C_FindObjectsInit)));
+	assert_num_eq (4, mock_module_calls (offsetof (CK_FUNCTION_LIST, C_FindObjectsFinal)));
+	assert_num_eq (0, mock_module_calls (offsetof (CK_FUNCTION_LIST, C_Login)));
+
+	/* Direct calls to the implementation aren't counted */
+	mock_module_reset_calls ();
+	mock_C_GetInfo (&(CK_INFO){ { 0, } });
+	assert_num_eq (0, mock_module_calls (offsetof (CK_FUNCTION_LIST, C_GetInfo)));
+	mock_module.C_GetInfo (&(CK_INFO){ { 0, } });
+	assert_num_eq (1, mock_module_calls (offsetof (CK_FUNCTION_LIST, C_GetInfo)));
+}
+
+static int
+iterate_scaled (P11KitIterBehavior behavior,
+                CK_OBJECT_HANDLE *objects,
+                unsigned long *first_finds)
+{
+	mock_scale scale = { 1, 1000, 0, 0 };
+	CK_SESSION_HANDLE session;
+	P11KitIter *iter;
+	CK_ULONG size;
+	CK_RV rv;
+	int at;
+
+	mock_module_reset ();
+	mock_module_scale (&scale);
+	rv = mock_module.C_Initialize (NULL);
+	mock_module_scale (NULL);
+	assert (rv == CKR_OK);
+	mock_module_reset_calls ();
+
+	iter = p11_kit_iter_new (NULL, behavior);
+	p11_kit_iter_begin_with (iter, &mock_module, MOCK_SLOT_SCALE_ID, 0);
+
+	at = 0;
+	while ((rv = p11_kit_iter_next (iter)) == CKR_OK) {
+		if (at == 0)
+			*first_finds = mock_module_calls (offsetof (CK_FUNCTION_LIST, C_FindObjects));
+
+		assert (at < 1000);
+		objects[at] = p11_kit_iter_get_object (iter);
+
+		/* The session is usable while the search goes on */
+		session = p11_kit_iter_get_session (iter);
+		size = 0;
+		rv = mock_module.C_GetObjectSize (session, objects[at], &size);
+		assert (rv == CKR_OK);
+		assert (size > 0);
+		at++;
+	}
+
+	assert (rv == CKR_CANCEL);
+	p11_kit_iter_free (iter);
+
+	rv = mock_module.C_Finalize (NULL);
+	assert (rv == CKR_OK);
+
+	return at;
+}
+
+static void
+test_stream (void)
+{
+	CK_OBJECT_HANDLE preloaded[1000];
+	CK_OBJECT_HANDLE streamed[1000];
+	unsigned long finds;
+
+	assert_num_eq (1000, iterate_scaled (0, preloaded, &finds));
+	assert_num_cmp (finds, >, 4);
+
+	/* Results come after the first window, with a second session to search */
+	assert_num_eq (1000, iterate_scaled (P11_KIT_ITER_STREAM, streamed, &finds));
+	assert_num_eq (1, finds);
+	assert_num_eq (2, mock_module_calls (offsetof (CK_FUNCTION_LIST, C_OpenSession)));
+	assert_num_eq (2, mock_module_calls (offsetof (CK_FUNCTION_LIST, C_CloseSession)));
+	assert_num_eq (4, mock_module_calls (offsetof (CK_FUNCTION_LIST, C_FindObjects)));
+	assert_num_eq (1, mock_module_calls (offsetof (CK_FUNCTION_LIST, C_FindObjectsFinal)));
+	assert (memcmp (preloaded, streamed, sizeof (streamed)) == 0);
+
+	/* With busy sessions only the one session is needed */
+	assert_num_eq (1000, iterate_scaled (P11_KIT_ITER_STREAM | P11_KIT_ITER_BUSY_SESSIONS,
+	                                     streamed, &finds));
+	assert_num_eq (1, finds);
+	assert_num_eq (1, mock_module_calls (offsetof (CK_FUNCTION_LIST, C_OpenSession)));
+	assert (memcmp (preloaded, streamed, sizeof (streamed)) == 0);
+}
+
+static void
+test_prefetch (void)
+{
+	CK_OBJECT_HANDLE preloaded[1000];
+	CK_OBJECT_HANDLE prefetched[1000];
+	unsigned long finds;
+
+	assert_num_eq (1000, iterate_scaled (0, preloaded, &finds));
+
+	assert_num_eq (1000, iterate_scaled (P11_KIT_ITER_PREFETCH, prefetched, &finds));
+	assert_num_cmp (finds, <=, 2);
+	assert_num_eq (2, mock_module_calls (offsetof (CK_FUNCTION_LIST, C_OpenSession)));
+	assert_num_eq (4, mock_module_calls (offsetof (CK_FUNCTION_LIST, C_FindObjects)));
+	assert_num_eq (1, mock_module_calls (offsetof (CK_FUNCTION_LIST, C_FindObjectsFinal)));
+	assert (memcmp (preloaded, prefetched, sizeof (prefetched)) == 0);
+}
+
+static void
+test_prefetch_stop (void)
+{
+	mock_scale scale = { 2, 1000, 0, 0 };
+	P11KitIter *iter;
+	CK_RV rv;
+	int i;
+
+	mock_module_reset ();
+	mock_module_scale (&scale);
+	rv = mock_module.C_Initialize (NULL);
+	mock_module_scale (NULL);
+	assert (rv == CKR_OK);
+	mock_module_reset_calls ();
+
+	/* Stop part way through, while the next objects are being found */
+	iter = p11_kit_iter_new (NULL, P11_KIT_ITER_PREFETCH);
+	p11_kit_iter_begin_with (iter, &mock_module, 0, 0);
+	for (i = 0; i < 300; i++) {
+		rv = p11_kit_iter_next (iter);
+		assert (rv == CKR_OK);
+	}
+
+	/* And again on the same iterator */
+	p11_kit_iter_begin_with (iter, &mock_module, 0, 0);
+	for (i = 0; (rv = p11_kit_iter_next (iter)) == CKR_OK; i++);
+	assert (rv == CKR_CANCEL);
+	assert_num_eq (2003, i);
+	p11_kit_iter_free (iter);
+
+	/* Every session opened was closed */
+	assert_num_eq (mock_module_calls (offsetof (CK_FUNCTION_LIST, C_OpenSession)),
+	               mock_module_calls (offsetof (CK_FUNCTION_LIST, C_CloseSession)));
+
+	rv = mock_module.C_Finalize (NULL);
+	assert (rv == CKR_OK);
+}
+
+static int
+iterate_modules (CK_FUNCTION_LIST_PTR *modules,
+                 P11KitIterBehavior behavior,
+                 CK_FUNCTION_LIST_PTR *found_in,
+                 CK_OBJECT_HANDLE *objects)
+{
+	P11KitIter *iter;
+	CK_RV rv;
+	int at;
+
+	iter = p11_kit_iter_new (NULL, behavior);
+	p11_kit_iter_begin (iter, modules);
+
+	at = 0;
+	while ((rv = p11_kit_iter_next (iter)) == CKR_OK) {
+		assert (at < 128);
+		found_in[at] = p11_kit_iter_get_module (iter);
+		objects[at] = p11_kit_iter_get_object (iter);
+		assert (p11_kit_iter_get_session (iter) != 0);
+		at++;
+	}
+
+	assert (rv == CKR_CANCEL);
+	p11_kit_iter_free (iter);
+	return at;
+}
+
+static void
+test_parallel (void)
+{
+	CK_OBJECT_HANDLE objects[128];
+	CK_OBJECT_HANDLE parallel[128];
+	CK_FUNCTION_LIST_PTR found_in[128];
+	CK_FUNCTION_LIST_PTR parallel_in[128];
+	CK_FUNCTION_LIST_PTR *modules;
+	int count;
+	int i;
+
+	modules = initialize_and_get_modules ();
+
+	count = iterate_modules (modules, 0, found_in, objects);
+	assert_num_eq (9, count);
+
+	/* Same objects, in the same order */
+	assert_num_eq (count, iterate_modules (modules, P11_KIT_ITER_PARALLEL, parallel_in, parallel));
+	for (i = 0; i < count; i++) {
+		assert_ptr_eq (found_in[i], parallel_in[i]);
+		assert_num_eq (objects[i], parallel[i]);
+	}
+
+	finalize_and_free_modules (modules);
+}
+
+static void
+test_unordered (void)
+{
+	CK_OBJECT_HANDLE objects[128];
+	CK_OBJECT_HANDLE unordered[128];
+	CK_FUNCTION_LIST_PTR found_in[128];
+	CK_FUNCTION_LIST_PTR unordered_in[128];
+	CK_FUNCTION_LIST_PTR *modules;
+	int count;
+	int i, j;
+
+	modules = initialize_and_get_modules ();
+
+	count = iterate_modules (modules, 0, found_in, objects);
+	assert_num_eq (9, count);
+
+	/* Same objects, in any order */
+	assert_num_eq (count, iterate_modules (modules, P11_KIT_ITER_UNORDERED, unordered_in, unordered));
+	for (i = 0; i < count; i++) {
+		for (j = 0; j < count; j++) {
+			if (found_in[i] == unordered_in[j] && objects[i] == unordered[j])
+				break;
+		}
+		assert (j < count);
+	}
+
+	finalize_and_free_modules (modules);
+}
+
+static void
+test_parallel_fail (void)
+{
+	CK_FUNCTION_LIST module;
+	P11KitIter *iter;
+	CK_RV rv;
+	int at;
+
+	mock_module_reset ();
+	rv = mock_module.C_Initialize (NULL);
+	assert (rv == CKR_OK);
+
+	memcpy (&module, &mock_module, sizeof (CK_FUNCTION_LIST));
+	module.C_GetSlotList = mock_C_GetSlotList__fail_late;
+
+	iter = p11_kit_iter_new (NULL, P11_KIT_ITER_PARALLEL);
+	p11_kit_iter_begin_with (iter, &module, 0, 0);
+
+	at = 0;
+	while ((rv = p11_kit_iter_next (iter)) == CKR_OK)
+		at++;
+
+	/* The error from the worker comes back */
+	assert (rv == CKR_VENDOR_DEFINED);
+	assert_num_eq (0, at);
+
+	p11_kit_iter_free (iter);
+
+	rv = mock_module.C_Finalize (NULL);
+	assert (rv == CKR_OK);
+}
+
+static void
+test_parallel_stop (void)
+{
+	mock_scale scale = { 2, 1000, 0, 0 };
+	P11KitIter *iter;
+	CK_RV rv;
+	int i;
+
+	mock_module_reset ();
+	mock_module_scale (&scale);
+	rv = mock_module.C_Initialize (NULL);
+	mock_module_scale (NULL);
+	assert (rv == CKR_OK);
+	mock_module_reset_calls ();
+
+	/* Stop part way through the objects the worker found */
+	iter = p11_kit_iter_new (NULL, P11_KIT_ITER_UNORDERED);
+	p11_kit_iter_begin_with (iter, &mock_module, 0, 0);
+	for (i = 0; i < 300; i++) {
+		rv = p11_kit_iter_next (iter);
+		assert (rv == CKR_OK);
+	}
+
+	/* And again on the same iterator */
+	p11_kit_iter_begin_with (iter, &mock_module, 0, 0);
+	for (i = 0; (rv = p11_kit_iter_next (iter)) == CKR_OK; i++);
+	assert (rv == CKR_CANCEL);
+	assert_num_eq (2003, i);
+	p11_kit_iter_free (iter);
+
+	/* Every session opened was closed */
+	assert_num_eq (mock_module_calls (offsetof (CK_FUNCTION_LIST, C_OpenSession)),
+	               mock_module_calls (offsetof (CK_FUNCTION_LIST, C_CloseSession)));
+
+	rv = mock_module.C_Finalize (NULL);
+	assert (rv == CKR_OK);
+}
+
+static void
+test_parallel_calls (void)
+{
+	mock_scale scale = { 1, 10, 0, 200 };
+	P11KitIterBehavior behaviors[] = { P11_KIT_ITER_PARALLEL, P11_KIT_ITER_UNORDERED };
+	CK_OBJECT_HANDLE objects[128];
+	CK_OBJECT_HANDLE parallel[128];
+	CK_FUNCTION_LIST_PTR found_in[128];
+	CK_FUNCTION_LIST_PTR parallel_in[128];
+	CK_FUNCTION_LIST modules[4];
+	CK_FUNCTION_LIST_PTR list[5];
+	int count;
+	int b, i, j, k;
+	CK_RV rv;
+
+	mock_module_reset ();
+	mock_module_scale (&scale);
+	rv = mock_module.C_Initialize (NULL);
+	assert (rv == CKR_OK);
+
+	/* The same module several times over, each call taking a while */
+	for (i = 0; i < 4; i++) {
+		memcpy (modules + i, &mock_module, sizeof (CK_FUNCTION_LIST));
+		list[i] = modules + i;
+	}
+	list[i] = NULL;
+
+	count = iterate_modules (list, 0, found_in, objects);
+	assert_num_eq (4 * 13, count);
+
+	for (b = 0; b < 2; b++) {
+		mock_module_reset_calls ();
+		assert_num_eq (count, iterate_modules (list, behaviors[b], parallel_in, parallel));
+
+		/* Each module has its generated slot and the usual one, each searched once */
+		assert_num_eq (4 * 2, mock_module_calls (offsetof (CK_FUNCTION_LIST, C_FindObjectsInit)));
+		assert_num_eq (4 * 2, mock_module_calls (offsetof (CK_FUNCTION_LIST, C_OpenSession)));
+		assert_num_eq (4 * 2, mock_module_calls (offsetof (CK_FUNCTION_LIST, C_CloseSession)));
+
+		/* Each module's objects come in the same order as in sequence */
+		for (i = 0; i < 4; i++) {
+			for (j = 0, k = 0; j < count; j++) {
+				if (found_in[j] != list[i])
+					continue;
+				while (k < count && parallel_in[k] != list[i])
+					k++;
+				assert (k < count);
+				assert_num_eq (objects[j], parallel[k]);
+				k++;
+			}
+		}
+
+		/* And without unordered, so do the modules */
+		if (behaviors[b] == P11_KIT_ITER_PARALLEL) {
+			for (i = 0; i < count; i++)
+				assert_ptr_eq (found_in[i], parallel_in[i]);
+		}
+	}
+
+	mock_module_scale (NULL);
+	rv = mock_module.C_Finalize (NULL);
+	assert (rv == CKR_OK);
+}
+
+static void
+test_parallel_cancel (void)
+{
+	mock_scale scale = { 8, 10, 0, 1000 };
+	CK_FUNCTION_LIST modules[4];
+	CK_FUNCTION_LIST_PTR list[5];
+	P11KitIter *iter;
+	int i;
+	CK_RV rv;
+
+	mock_module_reset ();
+	mock_module_scale (&scale);
+	rv = mock_module.C_Initialize (NULL);
+	assert (rv == CKR_OK);
+	mock_module_reset_calls ();
+
+	for (i = 0; i < 4; i++) {
+		memcpy (modules + i, &mock_module, sizeof (CK_FUNCTION_LIST));
+		list[i] = modules + i;
+	}
+	list[i] = NULL;
+
+	/* Stop after the first object, the workers don't search the rest */
+	iter = p11_kit_iter_new (NULL, P11_KIT_ITER_UNORDERED);
+	p11_kit_iter_begin (iter, list);
+	rv = p11_kit_iter_next (iter);
+	assert (rv == CKR_OK);
+	p11_kit_iter_free (iter);
+
+	/* Each module has its eight generated slots, and the usual one */
+	assert_num_cmp (mock_module_calls (offsetof (CK_FUNCTION_LIST, C_FindObjectsInit)), <, 4 * 9);
+
+	/* Every session opened was closed */
+	assert_num_eq (mock_module_calls (offsetof (CK_FUNCTION_LIST, C_OpenSession)),
+	               mock_module_calls (offsetof (CK_FUNCTION_LIST, C_CloseSession)));
+
+	mock_module_scale (NULL);
+	rv = mock_module.C_Finalize (NULL);
+	assert (rv == CKR_OK);
+}
+
 int
 main (int argc,
       char *argv[])
@@ -1507,6 +2045,17 @@ main (int argc,
 	p11_testx (test_many, "", "/iter/test-many");
 	p11_testx (test_many, "busy-sessions", "/iter/test-many-busy");
 	p11_test (test_destroy_object, "/iter/destroy-object");
+	p11_test (test_scale_objects, "/iter/scale-objects");
+	p11_test (test_scale_calls, "/iter/scale-calls");
+	p11_test (test_stream, "/iter/stream");
+	p11_test (test_prefetch, "/iter/prefetch");
+	p11_test (test_prefetch_stop, "/iter/prefetch-stop");
+	p11_test (test_parallel, "/iter/parallel");
+	p11_test (test_unordered, "/iter/unordered");
+	p11_test (test_parallel_fail, "/iter/parallel-fail");
+	p11_test (test_parallel_stop, "/iter/parallel-stop");
+	p11_test (test_parallel_calls, "/iter/parallel-calls");
+	p11_test (test_parallel_cancel, "/iter/parallel-cancel");
 
 	return p11_test_run (argc, argv);
 }
@@ -198,6 +198,106 @@ test_separate_close_all_sessions (void)
 	teardown_mock_module (second);
 }
 
+static p11_mutex_t stress_mutex;
+static CK_SESSION_HANDLE stress_handle;
+static int stress_open;
+
+static CK_RV
+stress_C_OpenSession (CK_SLOT_ID slot_id,
+                      CK_FLAGS flags,
+                      CK_VOID_PTR user_data,
+                      CK_NOTIFY callback,
+                      CK_SESSION_HANDLE_PTR session)
+{
+	p11_mutex_lock (&stress_mutex);
+	*session = ++stress_handle;
+	stress_open++;
+	p11_mutex_unlock (&stress_mutex);
+
+	return CKR_OK;
+}
+
+static CK_RV
+stress_C_CloseSession (CK_SESSION_HANDLE session)
+{
+	p11_mutex_lock (&stress_mutex);
+	stress_open--;
+	p11_mutex_unlock (&stress_mutex);
+
+	return CKR_OK;
+}
+
+/* Sessions opened and closed by each thread, and left open at the end */
+#define STRESS_THREADS 16
+#define STRESS_SESSIONS 62500
+#define STRESS_LEAKED 16
+
+static void *
+open_close_in_thread (void *data)
+{
+	CK_FUNCTION_LIST *module = data;
+	CK_SESSION_HANDLE sessions[STRESS_LEAKED];
+	CK_RV rv;
+	int i;
+
+	for (i = 0; i < STRESS_SESSIONS; i++) {
+		rv = (module->C_OpenSession) (MOCK_SLOT_ONE_ID, CKF_SERIAL_SESSION,
+		                              NULL, NULL, sessions + (i % STRESS_LEAKED));
+		assert_num_eq (CKR_OK, rv);
+
+		/* Leave the last batch of sessions open */
+		if (i < STRESS_SESSIONS - STRESS_LEAKED) {
+			rv = (module->C_CloseSession) (sessions[i % STRESS_LEAKED]);
+			assert_num_eq (CKR_OK, rv);
+		}
+	}
+
+	return NULL;
+}
+
+static void
+test_sessions_threaded (void)
+{
+	CK_FUNCTION_LIST real_module;
+	CK_FUNCTION_LIST *module;
+	p11_thread_t threads[STRESS_THREADS];
+	int i, ret;
+	CK_RV rv;
+
+	p11_mutex_init (&stress_mutex);
+	stress_handle = 0;
+	stress_open = 0;
+
+	memcpy (&real_module, &mock_module, sizeof (CK_FUNCTION_LIST));
+	real_module.C_OpenSession = stress_C_OpenSession;
+	real_module.C_CloseSession = stress_C_CloseSession;
+
+	p11_lock ();
+	rv = p11_module_load_inlock_reentrant (&real_module, 0, &module);
+	assert_num_eq (CKR_OK, rv);
+	p11_unlock ();
+
+	rv = p11_kit_module_initialize (module);
+	assert_num_eq (CKR_OK, rv);
+
+	for (i = 0; i < STRESS_THREADS; i++) {
+		ret = p11_thread_create (threads + i, open_close_in_thread, module);
+		assert_num_eq (0, ret);
+	}
+
+	for (i = 0; i < STRESS_THREADS; i++)
+		p11_thread_join (threads[i]);
+
+	assert_num_eq (STRESS_THREADS * STRESS_SESSIONS, stress_handle);
+	assert_num_eq (STRESS_THREADS * STRESS_LEAKED, stress_open);
+
+	/* Finalize closes all the sessions still open */
+	teardown_mock_module (module);
+	assert_num_eq (0, stress_open);
+
+	p11_mutex_uninit (&stress_mutex);
+}
+
 #ifdef OS_UNIX
 
 static void
@@ -258,6 +358,7 @@ main (int argc,
 	p11_test (test_initialize_finalize, "/managed/test_initialize_finalize");
 	p11_test (test_initialize_fail, "/managed/test_initialize_fail");
 	p11_test (test_separate_close_all_sessions, "/managed/test_separate_close_all_sessions");
+	p11_test (test_sessions_threaded, "/managed/sessions-threaded");
 
 #ifdef OS_UNIX
 	p11_test (test_fork_and_reinitialize, "/managed/fork-and-reinitialize");
@@ -42,6 +42,11 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include <time.h>
+
+#ifdef OS_UNIX
+#include <utime.h>
+#endif
 
 #include "p11-kit/pin.h"
 #include "p11-kit/private.h"
@@ -279,6 +284,145 @@ test_pin_file_large (void)
 	p11_kit_uri_free (uri);
 }
 
+static void
+test_pin_file_cached (void)
+{
+#ifdef OS_UNIX
+	struct utimbuf times;
+#endif
+	const unsigned char *first;
+	const unsigned char *ptr;
+	P11KitPin *pin;
+	P11KitPin *again;
+	size_t length;
+	char *directory;
+	char *path;
+
+	directory = p11_test_directory ("test-pin");
+	p11_test_file_write (directory, "pinfile", "yogabbagabba", 12);
+	if (asprintf (&path, "%s/pinfile", directory) < 0)
+		assert_not_reached ();
+
+#ifdef OS_UNIX
+	/* Files modified in the last second aren't cached */
+	times.actime = times.modtime = time (NULL) - 60;
+	if (utime (path, &times) < 0)
+		assert_not_reached ();
+#endif
+
+	p11_kit_pin_register_callback (P11_KIT_PIN_FALLBACK, p11_kit_pin_file_cached_callback,
+	                               NULL, NULL);
+
+	pin = p11_kit_pin_request (path, NULL, "The token", P11_KIT_PIN_FLAGS_USER_LOGIN);
+	assert_ptr_not_null (pin);
+	first = p11_kit_pin_get_value (pin, &length);
+	assert_num_eq (12, length);
+	assert (memcmp (first, "yogabbagabba", length) == 0);
+
+	again = p11_kit_pin_request (path, NULL, "The token", P11_KIT_PIN_FLAGS_USER_LOGIN);
+	assert_ptr_not_null (again);
+	ptr = p11_kit_pin_get_value (again, &length);
+	assert_num_eq (12, length);
+	assert (memcmp (ptr, "yogabbagabba", length) == 0);
+#ifdef OS_UNIX
+	/* Both PINs share the memory the file was read into once */
+	assert_ptr_eq (first, ptr);
+#endif
+	p11_kit_pin_unref (again);
+
+	/* A changed file is read again */
+	p11_test_file_write (directory, "pinfile", "booya", 5);
+	again = p11_kit_pin_request (path, NULL, "The token", P11_KIT_PIN_FLAGS_USER_LOGIN);
+	assert_ptr_not_null (again);
+	ptr = p11_kit_pin_get_value (again, &length);
+	assert_num_eq (5, length);
+	assert (memcmp (ptr, "booya", length) == 0);
+	assert (ptr != first);
+	p11_kit_pin_unref (again);
+
+	/* Earlier PINs are still valid after the cache is cleared */
+	p11_kit_pin_file_cache_clear ();
+	ptr = p11_kit_pin_get_value (pin, &length);
+	assert_ptr_eq (first, ptr);
+	assert_num_eq (12, length);
+	assert (memcmp (ptr, "yogabbagabba", length) == 0);
+	p11_kit_pin_unref (pin);
+
+	/* Retries are not supported */
+	pin = p11_kit_pin_request (path, NULL, "The token", P11_KIT_PIN_FLAGS_RETRY);
+	assert_ptr_eq (NULL, pin);
+
+	p11_test_directory_delete (directory);
+	free (directory);
+
+	pin = p11_kit_pin_request (path, NULL, "The token", P11_KIT_PIN_FLAGS_USER_LOGIN);
+	assert_ptr_eq (NULL, pin);
+
+	pin = p11_kit_pin_request (SRCDIR "/p11-kit/fixtures/test-pinfile-large", NULL, "The token",
+	                           P11_KIT_PIN_FLAGS_USER_LOGIN);
+	assert_num_eq (EFBIG, errno);
+	assert_ptr_eq (NULL, pin);
+
+	p11_kit_pin_unregister_callback (P11_KIT_PIN_FALLBACK, p11_kit_pin_file_cached_callback,
+	                                 NULL);
+	p11_kit_pin_file_cache_clear ();
+	free (path);
+}
+
+static int thread_failures = 0;
+
+static void *
+request_thread (void *data)
+{
+	P11KitPin *pin;
+	size_t length;
+	int i;
+
+	for (i = 0; i < 2000; i++) {
+		pin = p11_kit_pin_request ("/the/pin_source", NULL, "The token",
+		                           P11_KIT_PIN_FLAGS_USER_LOGIN);
+		if (pin == NULL)
+			continue;
+		if (memcmp (p11_kit_pin_get_value (pin, &length), "other", 5) != 0 ||
+		    length != 5)
+			p11_atomic_add (&thread_failures, 1, SEQ_CST);
+		p11_kit_pin_unref (p11_kit_pin_ref (pin));
+		p11_kit_pin_unref (pin);
+	}
+
+	return NULL;
+}
+
+static void
+test_pin_request_threads (void)
+{
+	p11_thread_t threads[4];
+	int ret;
+	int i;
+
+	thread_failures = 0;
+
+	for (i = 0; i < 4; i++) {
+		ret = p11_thread_create (threads + i, request_thread, NULL);
+		assert_num_eq (0, ret);
+	}
+
+	/* Register and unregister while the other threads request */
+	for (i = 0; i < 500; i++) {
+		p11_kit_pin_register_callback ("/the/pin_source", callback_other,
+		                               "other", NULL);
+		p11_kit_pin_unregister_callback ("/the/pin_source", callback_other,
+		                                 "other");
+	}
+
+	for (i = 0; i < 4; i++) {
+		ret = p11_thread_join (threads[i]);
+		assert_num_eq (0, ret);
+	}
+
+	assert_num_eq (0, thread_failures);
+}
+
 static void
 test_pin_ref_unref (void)
 {
@@ -308,6 +452,8 @@ main (int argc,
 	p11_test (test_pin_file, "/pin/test_pin_file");
 	p11_test (test_pin_file_large, "/pin/test_pin_file_large");
 	p11_test (test_pin_ref_unref, "/pin/test_pin_ref_unref");
+	p11_test (test_pin_file_cached, "/pin/test_pin_file_cached");
+	p11_test (test_pin_request_threads, "/pin/test_pin_request_threads");
 
 	return p11_test_run (argc, argv);
 }
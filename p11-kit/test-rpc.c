@@ -51,9 +51,11 @@
 #include <sys/wait.h>
 #endif
 #include <assert.h>
+#include <stddef.h>
 #include <string.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <time.h>
 
 static void
 test_new_free (void)
@@ -226,6 +228,128 @@ test_uint64_static (void)
 	assert (0x8967452311223344 == val);
 }
 
+static void
+test_compact_numbers (void)
+{
+	p11_buffer buffer;
+	uint64_t val64;
+	uint32_t val;
+	size_t next;
+	bool ret;
+
+	p11_buffer_init (&buffer, 0);
+	buffer.flags |= P11_RPC_BUFFER_COMPACT;
+
+	/* Small numbers, and minus one, take a single byte */
+	p11_rpc_buffer_add_uint32 (&buffer, 0);
+	p11_rpc_buffer_add_uint32 (&buffer, 0xFFFFFFFF);
+	p11_rpc_buffer_add_uint64 (&buffer, 0xFFFFFFFFFFFFFFFF);
+	p11_rpc_buffer_add_uint32 (&buffer, 63);
+	assert_num_eq (4, buffer.len);
+
+	p11_rpc_buffer_add_uint32 (&buffer, 0x12345678);
+	p11_rpc_buffer_add_uint64 (&buffer, 0x8967452311223344);
+	assert (!p11_buffer_failed (&buffer));
+
+	next = 0;
+	ret = p11_rpc_buffer_get_uint32 (&buffer, &next, &val);
+	assert_num_eq (true, ret);
+	assert_num_eq (0, val);
+	ret = p11_rpc_buffer_get_uint32 (&buffer, &next, &val);
+	assert_num_eq (true, ret);
+	assert_num_eq (0xFFFFFFFF, val);
+	ret = p11_rpc_buffer_get_uint64 (&buffer, &next, &val64);
+	assert_num_eq (true, ret);
+	assert (0xFFFFFFFFFFFFFFFF == val64);
+	ret = p11_rpc_buffer_get_uint32 (&buffer, &next, &val);
+	assert_num_eq (true, ret);
+	assert_num_eq (63, val);
+	ret = p11_rpc_buffer_get_uint32 (&buffer, &next, &val);
+	assert_num_eq (true, ret);
+	assert_num_eq (0x12345678, val);
+	ret = p11_rpc_buffer_get_uint64 (&buffer, &next, &val64);
+	assert_num_eq (true, ret);
+	assert (0x8967452311223344 == val64);
+	assert_num_eq (buffer.len, next);
+
+	/* Truncated */
+	next = 4;
+	buffer.len--;
+	ret = p11_rpc_buffer_get_uint32 (&buffer, &next, &val);
+	assert_num_eq (true, ret);
+	ret = p11_rpc_buffer_get_uint64 (&buffer, &next, &val64);
+	assert_num_eq (false, ret);
+	assert (p11_buffer_failed (&buffer));
+
+	/* Too large for 32 bits */
+	p11_buffer_reset (&buffer, 0);
+	p11_rpc_buffer_add_uint64 (&buffer, 0x100000000);
+	next = 0;
+	ret = p11_rpc_buffer_get_uint32 (&buffer, &next, &val);
+	assert_num_eq (false, ret);
+
+	p11_buffer_uninit (&buffer);
+}
+
+static void
+check_attributes (bool compact,
+                  size_t expected)
+{
+	CK_ATTRIBUTE attrs[] = {
+		{ CKA_LABEL, "Label", 5 },
+		{ CKA_ID, NULL, 20 },
+		{ CKA_VALUE, NULL, (CK_ULONG)-1 },
+		{ CKA_APPLICATION, "", 0 },
+	};
+	CK_ATTRIBUTE attr;
+	p11_buffer buffer;
+	size_t next;
+	int i;
+
+	p11_buffer_init (&buffer, 0);
+	if (compact)
+		buffer.flags |= P11_RPC_BUFFER_COMPACT;
+
+	for (i = 0; i < 4; i++)
+		p11_rpc_buffer_add_attribute (&buffer, attrs + i);
+	assert (!p11_buffer_failed (&buffer));
+	assert_num_eq (expected, buffer.len);
+
+	next = 0;
+	for (i = 0; i < 4; i++) {
+		if (!p11_rpc_buffer_get_attribute (&buffer, &next, &attr))
+			assert_not_reached ();
+		assert_num_eq (attrs[i].type, attr.type);
+		assert_num_eq (attrs[i].ulValueLen, attr.ulValueLen);
+		if (attrs[i].pValue == NULL)
+			assert_ptr_eq (NULL, attr.pValue);
+		else
+			assert (memcmp (attr.pValue, attrs[i].pValue, attr.ulValueLen) == 0);
+	}
+
+	assert_num_eq (buffer.len, next);
+
+	/* Truncated data */
+	buffer.len = 6;
+	next = 0;
+	assert (!p11_rpc_buffer_get_attribute (&buffer, &next, &attr));
+	assert (p11_buffer_failed (&buffer));
+
+	p11_buffer_uninit (&buffer);
+}
+
+static void
+test_attributes (void)
+{
+	check_attributes (false, 49);
+}
+
+static void
+test_attributes_compact (void)
+{
+	check_attributes (true, 14);
+}
+
 static void
 test_byte_array (void)
 {
@@ -956,6 +1080,504 @@ test_simultaneous_functions (void)
 	p11_mutex_uninit (&delay_mutex);
 }
 
+static void
+check_batch (unsigned int features)
+{
+	p11_rpc_client_vtable vtable = { "vtable-data", rpc_initialize, rpc_transport, rpc_finalize, features };
+	CK_OBJECT_CLASS klass = CKO_DATA;
+	CK_ATTRIBUTE match[] = {
+		{ CKA_CLASS, &klass, sizeof (klass) },
+	};
+	char label[32];
+	CK_ATTRIBUTE attr = { CKA_LABEL, label, sizeof (label) };
+	CK_ATTRIBUTE other = { CKA_LABEL, NULL, 0 };
+	CK_OBJECT_HANDLE objects[8];
+	CK_SESSION_HANDLE session = 0;
+	CK_ULONG count = 0;
+	p11_rpc_batch *batch;
+	p11_virtual mixin;
+	int open, init, find, final, get, get_other, close;
+	CK_RV rv;
+
+	rpc_initialized = 0;
+	p11_virtual_init (&base, &p11_virtual_base, &mock_module, NULL);
+	if (!p11_rpc_client_init (&mixin, &vtable))
+		assert_not_reached ();
+
+	rv = mixin.funcs.C_Initialize (&mixin.funcs, NULL);
+	assert_num_eq (CKR_OK, rv);
+
+	batch = p11_rpc_batch_new (&mixin.funcs);
+	assert_ptr_not_null (batch);
+
+	open = p11_rpc_batch_open_session (batch, MOCK_SLOT_ONE_ID, CKF_SERIAL_SESSION, &session);
+	init = p11_rpc_batch_find_objects_init (batch, 0, match, 1);
+	p11_rpc_batch_use (batch, 0, open, 0);
+	find = p11_rpc_batch_find_objects (batch, 0, objects, 8, &count);
+	p11_rpc_batch_use (batch, 0, open, 0);
+	final = p11_rpc_batch_find_objects_final (batch, 0);
+	p11_rpc_batch_use (batch, 0, open, 0);
+	p11_rpc_batch_unless (batch, find, 7);
+	get = p11_rpc_batch_get_attribute_value (batch, 0, 0, &attr, 1);
+	p11_rpc_batch_use (batch, 0, open, 0);
+	p11_rpc_batch_use (batch, 1, find, 0);
+	get_other = p11_rpc_batch_get_attribute_value (batch, 0, 0, &other, 1);
+	p11_rpc_batch_use (batch, 0, open, 0);
+	p11_rpc_batch_use (batch, 1, find, 1);
+	close = p11_rpc_batch_close_session (batch, 0);
+	p11_rpc_batch_use (batch, 0, open, 0);
+
+	rv = p11_rpc_batch_run (batch);
+	assert_num_eq (CKR_OK, rv);
+
+	assert_num_eq (CKR_OK, p11_rpc_batch_result (batch, open));
+	assert_num_cmp (session, !=, 0);
+	assert_num_eq (CKR_OK, p11_rpc_batch_result (batch, init));
+	assert_num_eq (CKR_OK, p11_rpc_batch_result (batch, find));
+	assert_num_eq (1, count);
+	assert_num_eq (MOCK_DATA_OBJECT, objects[0]);
+	assert_num_eq (CKR_OK, p11_rpc_batch_result (batch, final));
+	assert_num_eq (CKR_OK, p11_rpc_batch_result (batch, get));
+	assert_num_eq (10, attr.ulValueLen);
+	assert (memcmp (label, "TEST LABEL", 10) == 0);
+
+	/* There was only one object found */
+	assert_num_eq (CKR_FUNCTION_CANCELED, p11_rpc_batch_result (batch, get_other));
+	assert_num_eq (CKR_OK, p11_rpc_batch_result (batch, close));
+
+	p11_rpc_batch_free (batch);
+
+	/* The session was closed as part of the batch */
+	rv = mixin.funcs.C_CloseSession (&mixin.funcs, session);
+	assert_num_eq (CKR_SESSION_HANDLE_INVALID, rv);
+
+	rv = mixin.funcs.C_Finalize (&mixin.funcs, NULL);
+	assert_num_eq (CKR_OK, rv);
+	p11_virtual_uninit (&mixin);
+}
+
+static void
+test_batch (void)
+{
+	check_batch (P11_RPC_FEATURE_BATCH);
+}
+
+static void
+test_batch_compact (void)
+{
+	check_batch (P11_RPC_FEATURE_BATCH | P11_RPC_FEATURE_COMPACT);
+}
+
+static size_t transport_bytes = 0;
+static size_t transport_calls = 0;
+
+static CK_RV
+rpc_transport_counting (p11_rpc_client_vtable *vtable,
+                        p11_buffer *request,
+                        p11_buffer *response)
+{
+	bool compact;
+	CK_RV rv;
+
+	compact = (vtable->features & P11_RPC_FEATURE_COMPACT) ? true : false;
+	assert_num_eq (compact, ((unsigned char *)request->data)[0] == P11_RPC_COMPACT_MARK);
+
+	transport_bytes += request->len;
+	rv = rpc_transport (vtable, request, response);
+	transport_bytes += response->len;
+	transport_calls++;
+
+	assert_num_eq (compact, ((unsigned char *)response->data)[0] == P11_RPC_COMPACT_MARK);
+	return rv;
+}
+
+static void
+measure_workload (unsigned int features,
+                  bool get_attributes,
+                  double *bytes_per_call)
+{
+	p11_rpc_client_vtable vtable = { "vtable-data", rpc_initialize, rpc_transport_counting, rpc_finalize, features };
+	CK_OBJECT_HANDLE objects[16];
+	CK_SESSION_HANDLE session;
+	CK_OBJECT_CLASS klass;
+	CK_BBOOL token;
+	char label[32];
+	char id[32];
+	CK_ATTRIBUTE attrs[] = {
+		{ CKA_CLASS, &klass, sizeof (klass) },
+		{ CKA_TOKEN, &token, sizeof (token) },
+		{ CKA_LABEL, label, sizeof (label) },
+		{ CKA_ID, id, sizeof (id) },
+	};
+	CK_ULONG count, i;
+	p11_virtual mixin;
+	clock_t start;
+	int round;
+	CK_RV rv;
+
+	rpc_initialized = 0;
+	p11_virtual_init (&base, &p11_virtual_base, &mock_module, NULL);
+	if (!p11_rpc_client_init (&mixin, &vtable))
+		assert_not_reached ();
+
+	rv = mixin.funcs.C_Initialize (&mixin.funcs, NULL);
+	assert_num_eq (CKR_OK, rv);
+	rv = mixin.funcs.C_OpenSession (&mixin.funcs, MOCK_SLOT_ONE_ID, CKF_SERIAL_SESSION, NULL, NULL, &session);
+	assert_num_eq (CKR_OK, rv);
+
+	transport_bytes = 0;
+	transport_calls = 0;
+	start = clock ();
+
+	for (round = 0; round < 200; round++) {
+		rv = mixin.funcs.C_FindObjectsInit (&mixin.funcs, session, NULL, 0);
+		assert_num_eq (CKR_OK, rv);
+		rv = mixin.funcs.C_FindObjects (&mixin.funcs, session, objects, 16, &count);
+		assert_num_eq (CKR_OK, rv);
+		rv = mixin.funcs.C_FindObjectsFinal (&mixin.funcs, session);
+		assert_num_eq (CKR_OK, rv);
+		assert_num_cmp (count, >, 0);
+
+		for (i = 0; get_attributes && i < count; i++) {
+			attrs[0].ulValueLen = sizeof (klass);
+			attrs[1].ulValueLen = sizeof (token);
+			attrs[2].ulValueLen = sizeof (label);
+			attrs[3].ulValueLen = sizeof (id);
+			rv = mixin.funcs.C_GetAttributeValue (&mixin.funcs, session, objects[i], attrs, 4);
+			assert (rv == CKR_OK || rv == CKR_ATTRIBUTE_TYPE_INVALID);
+		}
+	}
+
+	printf ("# %s %s: %.1f bytes per call, %.2f us per call\n",
+	        features & P11_RPC_FEATURE_COMPACT ? "compact" : "fixed",
+	        get_attributes ? "get-attribute" : "find",
+	        (double)transport_bytes / transport_calls,
+	        (double)(clock () - start) * 1000000 / CLOCKS_PER_SEC / transport_calls);
+	*bytes_per_call = (double)transport_bytes / transport_calls;
+
+	rv = mixin.funcs.C_CloseSession (&mixin.funcs, session);
+	assert_num_eq (CKR_OK, rv);
+	rv = mixin.funcs.C_Finalize (&mixin.funcs, NULL);
+	assert_num_eq (CKR_OK, rv);
+	p11_virtual_uninit (&mixin);
+}
+
+static void
+test_compact_smaller (void)
+{
+	double fixed, compact;
+
+	measure_workload (0, false, &fixed);
+	measure_workload (P11_RPC_FEATURE_COMPACT, false, &compact);
+	assert (compact < fixed);
+
+	measure_workload (0, true, &fixed);
+	measure_workload (P11_RPC_FEATURE_COMPACT, true, &compact);
+	assert (compact < fixed);
+}
+
+static void
+test_batch_fallback (void)
+{
+	/* When the server doesn't support batches, calls are made one by one */
+	check_batch (0);
+}
+
+static void
+test_batch_errors (void)
+{
+	p11_rpc_client_vtable vtable = { "vtable-data", rpc_initialize, rpc_transport, rpc_finalize,
+	                                 P11_RPC_FEATURE_BATCH };
+	CK_OBJECT_HANDLE objects[8];
+	CK_ULONG count = 0;
+	p11_rpc_batch *batch;
+	p11_virtual mixin;
+	int find, final, close;
+	CK_RV rv;
+
+	rpc_initialized = 0;
+	p11_virtual_init (&base, &p11_virtual_base, &mock_module, NULL);
+	if (!p11_rpc_client_init (&mixin, &vtable))
+		assert_not_reached ();
+
+	rv = mixin.funcs.C_Initialize (&mixin.funcs, NULL);
+	assert_num_eq (CKR_OK, rv);
+
+	batch = p11_rpc_batch_new (&mixin.funcs);
+	assert_ptr_not_null (batch);
+
+	/* Errors are returned for each call, and calls after them still run */
+	find = p11_rpc_batch_find_objects (batch, 888, objects, 8, &count);
+	final = p11_rpc_batch_find_objects_final (batch, 0);
+	p11_rpc_batch_use (batch, 0, find, 0);
+	close = p11_rpc_batch_close_session (batch, 888);
+	p11_rpc_batch_unless (batch, find, 0);
+
+	rv = p11_rpc_batch_run (batch);
+	assert_num_eq (CKR_OK, rv);
+
+	assert_num_eq (CKR_SESSION_HANDLE_INVALID, p11_rpc_batch_result (batch, find));
+	assert_num_eq (CKR_FUNCTION_CANCELED, p11_rpc_batch_result (batch, final));
+	assert_num_eq (CKR_SESSION_HANDLE_INVALID, p11_rpc_batch_result (batch, close));
+
+	p11_rpc_batch_free (batch);
+
+	rv = mixin.funcs.C_Finalize (&mixin.funcs, NULL);
+	assert_num_eq (CKR_OK, rv);
+	p11_virtual_uninit (&mixin);
+}
+
+static void
+test_batch_invalid (void)
+{
+	p11_buffer envelope;
+	p11_buffer request;
+	p11_buffer response;
+	p11_buffer open;
+	p11_rpc_message msg;
+	CK_RV rv;
+
+	p11_virtual_init (&base, &p11_virtual_base, &mock_module, NULL);
+	rv = mock_module.C_Initialize (NULL);
+	assert_num_eq (CKR_OK, rv);
+	mock_module_reset_calls ();
+
+	p11_buffer_init (&open, 64);
+	p11_rpc_message_init (&msg, &open, &open);
+	if (!p11_rpc_message_prep (&msg, P11_RPC_CALL_C_OpenSession, P11_RPC_REQUEST) ||
+	    !p11_rpc_message_write_ulong (&msg, MOCK_SLOT_ONE_ID) ||
+	    !p11_rpc_message_write_ulong (&msg, CKF_SERIAL_SESSION))
+		assert_not_reached ();
+	p11_rpc_message_clear (&msg);
+
+	/* A valid call, and then one that refers to its own result */
+	p11_buffer_init (&envelope, 64);
+	p11_rpc_buffer_add_uint32 (&envelope, 2);
+	p11_rpc_buffer_add_byte (&envelope, 0);
+	p11_rpc_buffer_add_byte_array (&envelope, open.data, open.len);
+	p11_rpc_buffer_add_byte (&envelope, 1);
+	p11_rpc_buffer_add_byte (&envelope, 0);
+	p11_rpc_buffer_add_byte (&envelope, P11_RPC_BATCH_SUBSTITUTE);
+	p11_rpc_buffer_add_uint32 (&envelope, 1);
+	p11_rpc_buffer_add_uint32 (&envelope, 0);
+	p11_rpc_buffer_add_byte_array (&envelope, open.data, open.len);
+	assert (p11_buffer_ok (&envelope));
+
+	p11_buffer_init (&request, 64);
+	p11_buffer_init (&response, 64);
+	p11_rpc_message_init (&msg, &response, &request);
+	if (!p11_rpc_message_prep (&msg, P11_RPC_CALL_X_Batch, P11_RPC_REQUEST) ||
+	    !p11_rpc_message_write_byte_array (&msg, envelope.data, envelope.len))
+		assert_not_reached ();
+	p11_rpc_message_clear (&msg);
+
+	assert (p11_rpc_server_handle (&base.funcs, &request, &response));
+
+	/* The whole batch is refused, and the valid call didn't run */
+	p11_rpc_message_init (&msg, &response, &request);
+	assert (p11_rpc_message_parse (&msg, P11_RPC_RESPONSE));
+	assert_num_eq (P11_RPC_CALL_ERROR, msg.call_id);
+	p11_rpc_message_clear (&msg);
+	assert_num_eq (0, mock_module_calls (offsetof (CK_FUNCTION_LIST, C_OpenSession)));
+
+	p11_buffer_uninit (&open);
+	p11_buffer_uninit (&envelope);
+	p11_buffer_uninit (&request);
+	p11_buffer_uninit (&response);
+
+	rv = mock_module.C_Finalize (NULL);
+	assert_num_eq (CKR_OK, rv);
+}
+
+static int get_attribute_calls = 0;
+
+static CK_RV
+counting_C_GetAttributeValue (CK_SESSION_HANDLE session,
+                              CK_OBJECT_HANDLE object,
+                              CK_ATTRIBUTE_PTR template,
+                              CK_ULONG count)
+{
+	get_attribute_calls++;
+	return mock_C_GetAttributeValue (session, object, template, count);
+}
+
+static CK_RV
+write_protected_C_GetTokenInfo (CK_SLOT_ID slot_id,
+                                CK_TOKEN_INFO_PTR info)
+{
+	CK_RV rv;
+
+	rv = mock_C_GetTokenInfo (slot_id, info);
+	if (rv == CKR_OK)
+		info->flags |= CKF_WRITE_PROTECTED;
+	return rv;
+}
+
+static void
+check_attribute_cache (bool write_protected,
+                       int expect_calls)
+{
+	p11_rpc_client_vtable vtable = { "vtable-data", rpc_initialize, rpc_transport, rpc_finalize };
+	CK_FUNCTION_LIST real_module;
+	CK_SESSION_HANDLE session;
+	CK_ATTRIBUTE attr;
+	char label[32];
+	p11_virtual mixin;
+	CK_RV rv;
+	int i;
+
+	memcpy (&real_module, &mock_module, sizeof (CK_FUNCTION_LIST));
+	real_module.C_GetAttributeValue = counting_C_GetAttributeValue;
+	if (write_protected)
+		real_module.C_GetTokenInfo = write_protected_C_GetTokenInfo;
+
+	rpc_initialized = 0;
+	get_attribute_calls = 0;
+	p11_virtual_init (&base, &p11_virtual_base, &real_module, NULL);
+	if (!p11_rpc_client_init (&mixin, &vtable))
+		assert_not_reached ();
+	if (!p11_rpc_client_set_cache (&mixin))
+		assert_not_reached ();
+
+	rv = mixin.funcs.C_Initialize (&mixin.funcs, NULL);
+	assert_num_eq (CKR_OK, rv);
+
+	rv = mixin.funcs.C_OpenSession (&mixin.funcs, MOCK_SLOT_ONE_ID, CKF_SERIAL_SESSION, NULL, NULL, &session);
+	assert_num_eq (CKR_OK, rv);
+
+	for (i = 0; i < 3; i++) {
+		attr.type = CKA_LABEL;
+		attr.pValue = label;
+		attr.ulValueLen = sizeof (label);
+		rv = mixin.funcs.C_GetAttributeValue (&mixin.funcs, session, MOCK_DATA_OBJECT, &attr, 1);
+		assert_num_eq (CKR_OK, rv);
+		assert_num_eq (10, attr.ulValueLen);
+		assert (memcmp (label, "TEST LABEL", 10) == 0);
+	}
+
+	/* Length and short buffer come from the cache too */
+	attr.pValue = NULL;
+	attr.ulValueLen = 0;
+	rv = mixin.funcs.C_GetAttributeValue (&mixin.funcs, session, MOCK_DATA_OBJECT, &attr, 1);
+	assert_num_eq (CKR_OK, rv);
+	assert_num_eq (10, attr.ulValueLen);
+
+	attr.pValue = label;
+	attr.ulValueLen = 4;
+	rv = mixin.funcs.C_GetAttributeValue (&mixin.funcs, session, MOCK_DATA_OBJECT, &attr, 1);
+	assert_num_eq (CKR_BUFFER_TOO_SMALL, rv);
+	assert_num_eq ((CK_ULONG)-1, attr.ulValueLen);
+
+	assert_num_eq (expect_calls, get_attribute_calls);
+
+	/* Changing an object clears the cache */
+	attr.pValue = "changed";
+	attr.ulValueLen = 7;
+	rv = mixin.funcs.C_SetAttributeValue (&mixin.funcs, session, MOCK_DATA_OBJECT, &attr, 1);
+	assert_num_eq (CKR_OK, rv);
+
+	attr.pValue = label;
+	attr.ulValueLen = sizeof (label);
+	rv = mixin.funcs.C_GetAttributeValue (&mixin.funcs, session, MOCK_DATA_OBJECT, &attr, 1);
+	assert_num_eq (CKR_OK, rv);
+	assert_num_eq (7, attr.ulValueLen);
+	assert (memcmp (label, "changed", 7) == 0);
+	assert_num_eq (expect_calls + 1, get_attribute_calls);
+
+	rv = mixin.funcs.C_Finalize (&mixin.funcs, NULL);
+	assert_num_eq (CKR_OK, rv);
+	p11_virtual_uninit (&mixin);
+}
+
+static void
+test_attribute_cache (void)
+{
+	check_attribute_cache (true, 1);
+}
+
+static void
+test_attribute_cache_writable (void)
+{
+	/* Objects on tokens that can change aren't cached */
+	check_attribute_cache (false, 5);
+}
+
+static p11_virtual *racing_mixin = NULL;
+
+static CK_RV
+racing_C_GetAttributeValue (CK_SESSION_HANDLE session,
+                            CK_OBJECT_HANDLE object,
+                            CK_ATTRIBUTE_PTR template,
+                            CK_ULONG count)
+{
+	CK_ATTRIBUTE attr = { CKA_LABEL, "changed", 7 };
+	p11_virtual *mixin = racing_mixin;
+	CK_RV rv;
+
+	get_attribute_calls++;
+	rv = mock_C_GetAttributeValue (session, object, template, count);
+
+	/* Another caller changes the object while this response is on its way */
+	if (mixin != NULL) {
+		racing_mixin = NULL;
+		if ((mixin->funcs.C_SetAttributeValue) (&mixin->funcs, session, object, &attr, 1) != CKR_OK)
+			assert_not_reached ();
+	}
+
+	return rv;
+}
+
+static void
+test_attribute_cache_race (void)
+{
+	p11_rpc_client_vtable vtable = { "vtable-data", rpc_initialize, rpc_transport, rpc_finalize };
+	CK_FUNCTION_LIST real_module;
+	CK_SESSION_HANDLE session;
+	CK_ATTRIBUTE attr;
+	char label[32];
+	p11_virtual mixin;
+	CK_RV rv;
+
+	memcpy (&real_module, &mock_module, sizeof (CK_FUNCTION_LIST));
+	real_module.C_GetAttributeValue = racing_C_GetAttributeValue;
+	real_module.C_GetTokenInfo = write_protected_C_GetTokenInfo;
+
+	rpc_initialized = 0;
+	get_attribute_calls = 0;
+	p11_virtual_init (&base, &p11_virtual_base, &real_module, NULL);
+	if (!p11_rpc_client_init (&mixin, &vtable))
+		assert_not_reached ();
+	if (!p11_rpc_client_set_cache (&mixin))
+		assert_not_reached ();
+
+	rv = mixin.funcs.C_Initialize (&mixin.funcs, NULL);
+	assert_num_eq (CKR_OK, rv);
+
+	rv = mixin.funcs.C_OpenSession (&mixin.funcs, MOCK_SLOT_ONE_ID, CKF_SERIAL_SESSION, NULL, NULL, &session);
+	assert_num_eq (CKR_OK, rv);
+
+	/* The old value comes back, but isn't cached */
+	racing_mixin = &mixin;
+	attr.type = CKA_LABEL;
+	attr.pValue = label;
+	attr.ulValueLen = sizeof (label);
+	rv = mixin.funcs.C_GetAttributeValue (&mixin.funcs, session, MOCK_DATA_OBJECT, &attr, 1);
+	assert_num_eq (CKR_OK, rv);
+	assert_num_eq (10, attr.ulValueLen);
+	assert (memcmp (label, "TEST LABEL", 10) == 0);
+
+	attr.ulValueLen = sizeof (label);
+	rv = mixin.funcs.C_GetAttributeValue (&mixin.funcs, session, MOCK_DATA_OBJECT, &attr, 1);
+	assert_num_eq (CKR_OK, rv);
+	assert_num_eq (7, attr.ulValueLen);
+	assert (memcmp (label, "changed", 7) == 0);
+	assert_num_eq (2, get_attribute_calls);
+
+	rv = mixin.funcs.C_Finalize (&mixin.funcs, NULL);
+	assert_num_eq (CKR_OK, rv);
+	p11_virtual_uninit (&mixin);
+}
+
 #ifdef OS_UNIX
 
 static void
@@ -1032,6 +1654,9 @@ main (int argc,
 	p11_test (test_uint32_static, "/rpc/uint32-static");
 	p11_test (test_uint64, "/rpc/uint64");
 	p11_test (test_uint64_static, "/rpc/uint64-static");
+	p11_test (test_compact_numbers, "/rpc/compact-numbers");
+	p11_test (test_attributes, "/rpc/attributes");
+	p11_test (test_attributes_compact, "/rpc/attributes-compact");
 	p11_test (test_byte_array, "/rpc/byte-array");
 	p11_test (test_byte_array_null, "/rpc/byte-array-null");
 	p11_test (test_byte_array_too_long, "/rpc/byte-array-too-long");
@@ -1050,6 +1675,15 @@ main (int argc,
 	p11_test (test_get_info_stand_in, "/rpc/get-info-stand-in");
 	p11_test (test_get_slot_list_no_device, "/rpc/get-slot-list-no-device");
 	p11_test (test_simultaneous_functions, "/rpc/simultaneous-functions");
+	p11_test (test_batch, "/rpc/batch");
+	p11_test (test_batch_compact, "/rpc/batch-compact");
+	p11_test (test_batch_fallback, "/rpc/batch-fallback");
+	p11_test (test_compact_smaller, "/rpc/compact-smaller");
+	p11_test (test_batch_errors, "/rpc/batch-errors");
+	p11_test (test_batch_invalid, "/rpc/batch-invalid");
+	p11_test (test_attribute_cache, "/rpc/attribute-cache");
+	p11_test (test_attribute_cache_writable, "/rpc/attribute-cache-writable");
+	p11_test (test_attribute_cache_race, "/rpc/attribute-cache-race");
 
 #ifdef OS_UNIX
 	p11_test (test_fork_and_reinitialize, "/rpc/fork-and-reinitialize");
@@ -0,0 +1,356 @@
+/*
+ * Copyright (c) 2016 Red Hat Inc
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *     * Redistributions of source code must retain the above
+ *       copyright notice, this list of conditions and the
+ *       following disclaimer.
+ *     * Redistributions in binary form must reproduce the
+ *       above copyright notice, this list of conditions and
+ *       the following disclaimer in the documentation and/or
+ *       other materials provided with the distribution.
+ *     * The names of contributors to this software may not be
+ *       used to endorse or promote products derived from this
+ *       software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+#include "config.h"
+#include "test.h"
+
+#include "library.h"
+#include "mock.h"
+#include "modules.h"
+#include "p11-kit.h"
+#include "stats.h"
+#include "virtual.h"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+static CK_FUNCTION_LIST_PTR
+setup_mock_module (CK_SESSION_HANDLE *session)
+{
+	CK_FUNCTION_LIST_PTR module;
+	CK_RV rv;
+
+	p11_lock ();
+	p11_stats_force = true;
+
+	rv = p11_module_load_inlock_reentrant (&mock_module, 0, &module);
+	assert (rv == CKR_OK);
+	assert_ptr_not_null (module);
+	assert (p11_virtual_is_wrapper (module));
+
+	p11_unlock ();
+
+	rv = p11_kit_module_initialize (module);
+	assert (rv == CKR_OK);
+
+	if (session) {
+		rv = (module->C_OpenSession) (MOCK_SLOT_ONE_ID,
+		                              CKF_RW_SESSION | CKF_SERIAL_SESSION,
+		                              NULL, NULL, session);
+		assert (rv == CKR_OK);
+	}
+
+	return module;
+}
+
+static void
+teardown_mock_module (CK_FUNCTION_LIST_PTR module)
+{
+	CK_RV rv;
+
+	rv = p11_kit_module_finalize (module);
+	assert (rv == CKR_OK);
+
+	p11_lock ();
+
+	rv = p11_module_release_inlock_reentrant (module);
+	assert (rv == CKR_OK);
+
+	p11_unlock ();
+}
+
+/* Bring in all the mock module tests */
+#include "test-mock.c"
+
+static CK_FUNCTION_LIST_PTR
+load_stats_module (CK_FUNCTION_LIST_PTR funcs,
+                   int flags)
+{
+	CK_FUNCTION_LIST_PTR module;
+	CK_RV rv;
+
+	p11_lock ();
+	p11_stats_force = false;
+
+	rv = p11_module_load_inlock_reentrant (funcs, flags, &module);
+	assert (rv == CKR_OK);
+	assert_ptr_not_null (module);
+
+	p11_unlock ();
+
+	/* Statistics last as long as the module, so clear the earlier tests */
+	p11_kit_module_reset_stats (module);
+
+	rv = p11_kit_module_initialize (module);
+	assert (rv == CKR_OK);
+
+	return module;
+}
+
+static bool
+find_stats_line (const char *stats,
+                 const char *function,
+                 unsigned long *calls,
+                 unsigned long *errors,
+                 double *mean,
+                 char *unit)
+{
+	const char *line;
+	char name[64];
+
+	for (line = stats; line && *line; line = strchr (line, '\n')) {
+		if (*line == '\n')
+			line++;
+		if (sscanf (line, "%63s %lu %lu %lf %2s", name, calls, errors, mean, unit) == 5 &&
+		    strcmp (name, function) == 0)
+			return true;
+	}
+
+	return false;
+}
+
+static void
+test_bucket (void)
+{
+	uint64_t value;
+	uint64_t limit;
+	int bucket;
+	int last = -1;
+
+	for (value = 0; value < 100000; value++) {
+		bucket = p11_stats_bucket (value);
+		assert (bucket >= last);
+		assert (bucket <= last + 1);
+		limit = p11_stats_bucket_limit (bucket);
+		assert (limit >= value);
+		assert (limit - value <= value / 8);
+		if (bucket > 0)
+			assert (p11_stats_bucket_limit (bucket - 1) < value);
+		last = bucket;
+	}
+
+	assert_num_eq (P11_STATS_BUCKETS - 1, p11_stats_bucket (1ULL << P11_STATS_MAX_BITS));
+	assert_num_eq (P11_STATS_BUCKETS - 1, p11_stats_bucket (UINT64_MAX));
+	assert_num_eq (P11_STATS_BUCKETS - 2, p11_stats_bucket ((1ULL << P11_STATS_MAX_BITS) - 1 -
+	                                                        (1ULL << (P11_STATS_MAX_BITS - P11_STATS_SUB_BITS - 1))));
+}
+
+static void
+test_percentile (void)
+{
+	p11_stats_function func;
+	uint64_t value;
+	int i;
+
+	memset (&func, 0, sizeof (func));
+	assert_num_eq (0, p11_stats_percentile (&func, 50.0));
+
+	/* 1 to 1000 microseconds, one call each */
+	for (i = 1; i <= 1000; i++) {
+		value = i * 1000;
+		func.buckets[p11_stats_bucket (value)]++;
+		func.calls++;
+		func.total += value;
+		func.max = value;
+	}
+
+	value = p11_stats_percentile (&func, 50.0);
+	assert (value >= 500000 && value <= 500000 + 500000 / 8);
+	value = p11_stats_percentile (&func, 99.0);
+	assert (value >= 990000 && value <= 990000 + 990000 / 8);
+
+	/* Never more than the largest recorded */
+	assert_num_eq (1000000, p11_stats_percentile (&func, 100.0));
+}
+
+static void
+test_counts (void)
+{
+	CK_FUNCTION_LIST_PTR module;
+	CK_SLOT_INFO slot;
+	CK_INFO info;
+	unsigned long calls;
+	unsigned long errors;
+	double mean;
+	char unit[4];
+	char *stats;
+	CK_RV rv;
+	int i;
+
+	module = load_stats_module (&mock_module, P11_KIT_MODULE_STATS);
+
+	for (i = 0; i < 3; i++) {
+		rv = (module->C_GetInfo) (&info);
+		assert_num_eq (CKR_OK, rv);
+	}
+
+	rv = (module->C_GetSlotInfo) (MOCK_SLOT_ONE_ID, &slot);
+	assert_num_eq (CKR_OK, rv);
+	rv = (module->C_GetSlotInfo) (8888, &slot);
+	assert_num_eq (CKR_SLOT_ID_INVALID, rv);
+
+	stats = p11_kit_module_get_stats (module);
+	assert_ptr_not_null (stats);
+	assert (strncmp (stats, "function ", 9) == 0);
+
+	assert (find_stats_line (stats, "C_GetInfo", &calls, &errors, &mean, unit));
+	assert_num_eq (3, calls);
+	assert_num_eq (0, errors);
+	assert (find_stats_line (stats, "C_GetSlotInfo", &calls, &errors, &mean, unit));
+	assert_num_eq (2, calls);
+	assert_num_eq (1, errors);
+	assert (find_stats_line (stats, "C_Initialize", &calls, &errors, &mean, unit));
+	assert_num_eq (1, calls);
+
+	/* Functions not called aren't listed */
+	assert (!find_stats_line (stats, "C_Login", &calls, &errors, &mean, unit));
+	free (stats);
+
+	p11_kit_module_reset_stats (module);
+	stats = p11_kit_module_get_stats (module);
+	assert_ptr_not_null (stats);
+	assert (!find_stats_line (stats, "C_GetInfo", &calls, &errors, &mean, unit));
+	free (stats);
+
+	teardown_mock_module (module);
+}
+
+static void
+test_latency (void)
+{
+	mock_scale scale = { 0, 0, 0, 2000 };
+	CK_FUNCTION_LIST_PTR module;
+	CK_INFO info;
+	unsigned long calls;
+	unsigned long errors;
+	double mean;
+	char unit[4];
+	char *stats;
+	CK_RV rv;
+
+	module = load_stats_module (&mock_module, P11_KIT_MODULE_STATS);
+
+	/* Only calls into mock_module add the latency */
+	mock_module_scale (&scale);
+	rv = (module->C_GetInfo) (&info);
+	assert_num_eq (CKR_OK, rv);
+	mock_module_scale (NULL);
+
+	stats = p11_kit_module_get_stats (module);
+	assert_ptr_not_null (stats);
+	assert (find_stats_line (stats, "C_GetInfo", &calls, &errors, &mean, unit));
+	assert_num_eq (1, calls);
+	assert_str_eq ("ms", unit);
+	assert (mean >= 2.0);
+	free (stats);
+
+	teardown_mock_module (module);
+}
+
+static void
+test_not_recorded (void)
+{
+	CK_FUNCTION_LIST_PTR module;
+
+	module = load_stats_module (&mock_module_no_slots, 0);
+	assert_ptr_eq (NULL, p11_kit_module_get_stats (module));
+
+	/* Doesn't fail */
+	p11_kit_module_reset_stats (module);
+
+	teardown_mock_module (module);
+}
+
+static void
+test_stats_file (void)
+{
+	CK_FUNCTION_LIST_PTR module;
+	CK_INFO info;
+	char data[4096];
+	char *directory;
+	char *path;
+	size_t length;
+	FILE *file;
+	CK_RV rv;
+
+	directory = p11_test_directory ("test-stats");
+	if (asprintf (&path, "%s/stats", directory) < 0)
+		assert_not_reached ();
+	setenv ("P11_KIT_STATS_FILE", path, 1);
+
+	module = load_stats_module (&mock_module, P11_KIT_MODULE_STATS);
+	rv = (module->C_GetInfo) (&info);
+	assert_num_eq (CKR_OK, rv);
+
+	/* Only written when the module is finalized */
+	file = fopen (path, "r");
+	assert_ptr_eq (NULL, file);
+
+	teardown_mock_module (module);
+	setenv ("P11_KIT_STATS_FILE", "", 1);
+
+	file = fopen (path, "r");
+	assert_ptr_not_null (file);
+	length = fread (data, 1, sizeof (data) - 1, file);
+	fclose (file);
+	data[length] = '\0';
+
+	assert (strncmp (data, "# module\nfunction ", 18) == 0);
+	assert (strstr (data, "\nC_GetInfo ") != NULL);
+
+	p11_test_directory_delete (directory);
+	free (directory);
+	free (path);
+}
+
+int
+main (int argc,
+      char *argv[])
+{
+	p11_library_init ();
+	mock_module_init ();
+
+	test_mock_add_tests ("/stats");
+
+	p11_test (test_bucket, "/stats/bucket");
+	p11_test (test_percentile, "/stats/percentile");
+	p11_test (test_counts, "/stats/counts");
+	p11_test (test_latency, "/stats/latency");
+	p11_test (test_not_recorded, "/stats/not-recorded");
+	p11_test (test_stats_file, "/stats/stats-file");
+
+	p11_kit_be_quiet ();
+
+	return p11_test_run (argc, argv);
+}
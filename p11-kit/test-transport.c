@@ -36,12 +36,18 @@
 #include "config.h"
 #include "test.h"
 
+#define P11_KIT_FUTURE_UNSTABLE_API 1
+
+#include "dict.h"
+#include "iter.h"
 #include "library.h"
 #include "mock.h"
+#include "modules.h"
 #include "path.h"
 #include "private.h"
 #include "p11-kit.h"
 #include "rpc.h"
+#include "rpc-ring.h"
 
 #include <sys/types.h>
 #ifdef OS_UNIX
@@ -49,6 +55,7 @@
 #endif
 #include <stdlib.h>
 #include <stdio.h>
+#include <time.h>
 
 struct {
 	char *directory;
@@ -203,6 +210,111 @@ test_simultaneous_functions (void)
 	p11_kit_modules_release (modules);
 }
 
+static void
+check_iterate (P11KitIterBehavior behavior)
+{
+	CK_OBJECT_CLASS klass = CKO_DATA;
+	CK_BBOOL btrue = CK_TRUE;
+	CK_ATTRIBUTE attrs[] = {
+		{ CKA_CLASS, &klass, sizeof (klass) },
+		{ CKA_TOKEN, &btrue, sizeof (btrue) },
+	};
+	CK_FUNCTION_LIST **modules;
+	CK_FUNCTION_LIST *module;
+	CK_FUNCTION_LIST *only[2];
+	CK_SESSION_HANDLE session;
+	CK_OBJECT_HANDLE object;
+	P11KitIter *iter;
+	p11_dict *seen;
+	int count;
+	CK_RV rv;
+	int i;
+
+	modules = p11_kit_modules_load (NULL, 0);
+
+	module = p11_kit_module_for_name (modules, "remote");
+	assert (module != NULL);
+
+	rv = p11_kit_module_initialize (module);
+	assert_num_eq (rv, CKR_OK);
+
+	rv = (module->C_OpenSession) (MOCK_SLOT_ONE_ID, CKF_SERIAL_SESSION, NULL, NULL, &session);
+	assert_num_eq (CKR_OK, rv);
+
+	/* More than the iterator searches for in one go */
+	for (i = 0; i < 150; i++) {
+		rv = (module->C_CreateObject) (session, attrs, 2, &object);
+		assert_num_eq (CKR_OK, rv);
+	}
+
+	only[0] = module;
+	only[1] = NULL;
+
+	seen = p11_dict_new (p11_dict_direct_hash, p11_dict_direct_equal, NULL, NULL);
+	iter = p11_kit_iter_new (NULL, behavior);
+	p11_kit_iter_add_filter (iter, attrs, 1);
+	p11_kit_iter_begin (iter, only);
+
+	count = 0;
+	while ((rv = p11_kit_iter_next (iter)) == CKR_OK) {
+		object = p11_kit_iter_get_object (iter);
+		assert (!p11_dict_get (seen, (void *)object));
+		p11_dict_set (seen, (void *)object, (void *)object);
+		count++;
+	}
+
+	assert_num_eq (CKR_CANCEL, rv);
+
+	/* The ones we created, and the one mock data object */
+	assert_num_eq (151, count);
+
+	p11_kit_iter_free (iter);
+	p11_dict_free (seen);
+
+	rv = p11_kit_module_finalize (module);
+	assert_num_eq (rv, CKR_OK);
+
+	p11_kit_modules_release (modules);
+}
+
+static void
+test_iterate (void)
+{
+	check_iterate (0);
+}
+
+static void
+test_iterate_busy_sessions (void)
+{
+	check_iterate (P11_KIT_ITER_BUSY_SESSIONS);
+}
+
+static void
+test_remote_layers (void)
+{
+	CK_FUNCTION_LIST **modules;
+	CK_FUNCTION_LIST *module;
+
+	modules = p11_kit_modules_load (NULL, 0);
+	module = p11_kit_module_for_name (modules, "remote");
+	assert_ptr_not_null (module);
+	assert_ptr_not_null (p11_modules_remote_for (module));
+	p11_kit_modules_release (modules);
+
+	/* Batched calls would skip the statistics layer */
+	modules = p11_kit_modules_load (NULL, P11_KIT_MODULE_STATS);
+	module = p11_kit_module_for_name (modules, "remote");
+	assert_ptr_not_null (module);
+	assert_ptr_eq (NULL, p11_modules_remote_for (module));
+	p11_kit_modules_release (modules);
+
+	modules = p11_kit_modules_load (NULL, P11_KIT_MODULE_UNMANAGED);
+	module = p11_kit_module_for_name (modules, "remote");
+	if (module != NULL)
+		assert_ptr_eq (NULL, p11_modules_remote_for (module));
+	p11_kit_modules_release (modules);
+}
+
 #ifdef OS_UNIX
 
 static void
@@ -257,8 +369,274 @@ test_fork_and_reinitialize (void)
 	p11_kit_modules_release (modules);
 }
 
+#include "rpc-transport.c"
+
+typedef struct {
+	rpc_socket *sock;
+	int code;
+	p11_buffer buffer;
+	CK_RV rv;
+} socket_reader;
+
+static void *
+read_in_thread (void *data)
+{
+	socket_reader *reader = data;
+	reader->rv = rpc_socket_read (reader->sock, &reader->code, &reader->buffer);
+	return NULL;
+}
+
+static void
+add_frame (p11_buffer *frame,
+           uint32_t code,
+           const char *data)
+{
+	unsigned char header[12];
+
+	p11_rpc_buffer_encode_uint32 (header, code);
+	p11_rpc_buffer_encode_uint32 (header + 4, 0);
+	p11_rpc_buffer_encode_uint32 (header + 8, strlen (data));
+	p11_buffer_add (frame, header, 12);
+	p11_buffer_add (frame, data, strlen (data));
+}
+
+static void
+test_read_wrong_thread (void)
+{
+	const char *expected[] = { "first", "second" };
+	socket_reader readers[2];
+	p11_thread_t threads[2];
+	p11_buffer frames;
+	rpc_socket *sock;
+	int fds[2];
+	int round;
+	int i;
+
+	for (round = 0; round < 20; round++) {
+		assert_num_eq (0, socketpair (AF_UNIX, SOCK_STREAM, 0, fds));
+		sock = rpc_socket_new (fds[0]);
+		sock->read_creds = true;
+
+		for (i = 0; i < 2; i++) {
+			readers[i].sock = sock;
+			readers[i].code = 0x10 + i;
+			p11_buffer_init (&readers[i].buffer, 0);
+		}
+
+		p11_buffer_init (&frames, 0);
+		add_frame (&frames, 0x11, expected[1]);
+		add_frame (&frames, 0x10, expected[0]);
+		assert (p11_buffer_ok (&frames));
+
+		/* The first caller reads the header meant for the second one */
+		assert_num_eq (0, p11_thread_create (threads + 0, read_in_thread, readers + 0));
+		assert_num_eq (12, write (fds[1], frames.data, 12));
+		p11_sleep_ms (5);
+
+		/*
+		 * The second caller then waits for its data, and reads ahead
+		 * the first caller's response, when both arrive in one segment.
+		 */
+		assert_num_eq (0, p11_thread_create (threads + 1, read_in_thread, readers + 1));
+		p11_sleep_ms (5);
+		assert_num_eq (frames.len - 12, write (fds[1], (unsigned char *)frames.data + 12, frames.len - 12));
+
+		for (i = 0; i < 2; i++) {
+			assert_num_eq (0, p11_thread_join (threads[i]));
+			assert_num_eq (CKR_OK, readers[i].rv);
+			assert_num_eq (0x10 + i, readers[i].code);
+			assert_num_eq (strlen (expected[i]), readers[i].buffer.len);
+			assert (memcmp (readers[i].buffer.data, expected[i], readers[i].buffer.len) == 0);
+			p11_buffer_uninit (&readers[i].buffer);
+		}
+
+		p11_buffer_uninit (&frames);
+		rpc_socket_unref (sock);
+		close (fds[1]);
+	}
+}
+
 #endif /* OS_UNIX */
 
+#ifdef __linux__
+
+static bool
+read_syscall_counts (unsigned long *reads,
+                     unsigned long *writes)
+{
+	char line[128];
+	int found = 0;
+	FILE *f;
+
+	f = fopen ("/proc/self/io", "r");
+	if (f == NULL)
+		return false;
+
+	while (fgets (line, sizeof (line), f)) {
+		if (sscanf (line, "syscr: %lu", reads) == 1 ||
+		    sscanf (line, "syscw: %lu", writes) == 1)
+			found++;
+	}
+
+	fclose (f);
+	return found == 2;
+}
+
+/* Returns microseconds per call, or -1 without syscall accounting */
+static double
+measure_get_info (bool use_ring,
+                  int iterations,
+                  unsigned long *syscalls)
+{
+	CK_FUNCTION_LIST **modules;
+	CK_FUNCTION_LIST *module;
+	unsigned long reads[2];
+	unsigned long writes[2];
+	struct timespec ts[2];
+	double taken = -1;
+	CK_INFO info;
+	CK_RV rv;
+	int i;
+
+	p11_rpc_ring_disabled = !use_ring;
+
+	modules = p11_kit_modules_load (NULL, 0);
+
+	module = p11_kit_module_for_name (modules, "remote");
+	assert (module != NULL);
+
+	rv = p11_kit_module_initialize (module);
+	assert_num_eq (rv, CKR_OK);
+
+	rv = (module->C_GetInfo) (&info);
+	assert_num_eq (CKR_OK, rv);
+
+	/* Not all kernels have syscall accounting */
+	if (read_syscall_counts (reads, writes)) {
+		clock_gettime (CLOCK_MONOTONIC, ts);
+		for (i = 0; i < iterations; i++) {
+			rv = (module->C_GetInfo) (&info);
+			assert_num_eq (CKR_OK, rv);
+		}
+		clock_gettime (CLOCK_MONOTONIC, ts + 1);
+
+		if (!read_syscall_counts (reads + 1, writes + 1))
+			assert_not_reached ();
+
+		taken = (ts[1].tv_sec - ts[0].tv_sec) * 1000000.0 + (ts[1].tv_nsec - ts[0].tv_nsec) / 1000.0;
+		printf ("# %s: %.2f reads, %.2f writes, %.1f us per call\n",
+		        use_ring ? "ring" : "socket",
+		        (double)(reads[1] - reads[0]) / iterations,
+		        (double)(writes[1] - writes[0]) / iterations,
+		        taken / iterations);
+
+		*syscalls = (reads[1] - reads[0]) + (writes[1] - writes[0]);
+		taken /= iterations;
+	}
+
+	rv = p11_kit_module_finalize (module);
+	assert_num_eq (rv, CKR_OK);
+
+	p11_kit_modules_release (modules);
+	p11_rpc_ring_disabled = false;
+
+	return taken;
+}
+
+static void
+test_call_syscalls (void)
+{
+	const int iterations = 2000;
+	unsigned long syscalls;
+
+	if (measure_get_info (false, iterations, &syscalls) < 0)
+		return;
+
+	/* Each request and response frame should take one call */
+	assert_num_cmp (syscalls, <=, iterations * 3);
+}
+
+static void
+test_ring_latency (void)
+{
+	const int iterations = 2000;
+	unsigned long syscalls;
+	double socket;
+	double ring;
+
+	socket = measure_get_info (false, iterations, &syscalls);
+	ring = measure_get_info (true, iterations, &syscalls);
+	if (socket < 0 || ring < 0)
+		return;
+
+	/* Frames go through shared memory, not the socket */
+	assert_num_cmp (syscalls, <, iterations / 10);
+}
+
+static void
+test_ring_large (void)
+{
+	CK_OBJECT_CLASS klass = CKO_DATA;
+	CK_FUNCTION_LIST **modules;
+	CK_FUNCTION_LIST *module;
+	CK_SESSION_HANDLE session;
+	CK_OBJECT_HANDLE object;
+	CK_ATTRIBUTE attrs[2];
+	unsigned char *value;
+	unsigned char *check;
+	const size_t length = 300 * 1024;
+	size_t i;
+	CK_RV rv;
+
+	/* Larger than the ring, so it has to stream through */
+	value = malloc (length);
+	check = malloc (length);
+	assert_ptr_not_null (value);
+	assert_ptr_not_null (check);
+	for (i = 0; i < length; i++)
+		value[i] = i * 7 + (i >> 12);
+
+	modules = p11_kit_modules_load (NULL, 0);
+
+	module = p11_kit_module_for_name (modules, "remote");
+	assert (module != NULL);
+
+	rv = p11_kit_module_initialize (module);
+	assert_num_eq (rv, CKR_OK);
+
+	rv = (module->C_OpenSession) (MOCK_SLOT_ONE_ID, CKF_SERIAL_SESSION, NULL, NULL, &session);
+	assert_num_eq (CKR_OK, rv);
+
+	attrs[0].type = CKA_CLASS;
+	attrs[0].pValue = &klass;
+	attrs[0].ulValueLen = sizeof (klass);
+	attrs[1].type = CKA_VALUE;
+	attrs[1].pValue = value;
+	attrs[1].ulValueLen = length;
+
+	rv = (module->C_CreateObject) (session, attrs, 2, &object);
+	assert_num_eq (CKR_OK, rv);
+
+	for (i = 0; i < 3; i++) {
+		memset (check, 0, length);
+		attrs[1].pValue = check;
+		attrs[1].ulValueLen = length;
+		rv = (module->C_GetAttributeValue) (session, object, attrs + 1, 1);
+		assert_num_eq (CKR_OK, rv);
+		assert_num_eq (length, attrs[1].ulValueLen);
+		assert (memcmp (value, check, length) == 0);
+	}
+
+	rv = p11_kit_module_finalize (module);
+	assert_num_eq (rv, CKR_OK);
+
+	p11_kit_modules_release (modules);
+	free (value);
+	free (check);
+}
+
+#endif /* __linux__ */
+
 #include "test-mock.c"
 
 int
@@ -283,9 +661,19 @@ main (int argc,
 	p11_fixture (setup_remote, teardown_remote);
 	p11_test (test_basic_exec, "/transport/basic");
 	p11_test (test_simultaneous_functions, "/transport/simultaneous-functions");
+	p11_test (test_iterate, "/transport/iterate");
+	p11_test (test_iterate_busy_sessions, "/transport/iterate-busy-sessions");
+	p11_test (test_remote_layers, "/transport/remote-layers");
 
 #ifdef OS_UNIX
 	p11_test (test_fork_and_reinitialize, "/transport/fork-and-reinitialize");
+	p11_test (test_read_wrong_thread, "/transport/read-wrong-thread");
+#endif
+
+#ifdef __linux__
+	p11_test (test_call_syscalls, "/transport/call-syscalls");
+	p11_test (test_ring_latency, "/transport/ring-latency");
+	p11_test (test_ring_large, "/transport/ring-large");
 #endif
 
 	test_mock_add_tests ("/transport");
@@ -1158,6 +1158,99 @@ test_uri_match_attributes (void)
 	p11_kit_uri_free (uri);
 }
 
+static void
+test_uri_compiled_match (void)
+{
+	CK_ATTRIBUTE attrs[2];
+	CK_TOKEN_INFO token;
+	CK_SLOT_INFO slot;
+	CK_INFO info;
+	p11_uri_match *match;
+	P11KitUri *uri;
+	int ret;
+
+	memset (&token, 0, sizeof (token));
+	set_space_string (token.label, sizeof (token.label), "A label");
+	set_space_string (token.model, sizeof (token.model), "Giselle");
+	set_space_string (token.serialNumber, sizeof (token.serialNumber), "0001");
+	memset (&slot, 0, sizeof (slot));
+	set_space_string (slot.slotDescription, sizeof (slot.slotDescription), "The slot");
+	memset (&info, 0, sizeof (info));
+	set_space_string (info.libraryDescription, sizeof (info.libraryDescription), "Quiet");
+	info.libraryVersion.major = 1;
+
+	attrs[0].type = CKA_ID;
+	attrs[0].pValue = "Blah";
+	attrs[0].ulValueLen = 4;
+	attrs[1].type = CKA_LABEL;
+	attrs[1].pValue = "Fancy";
+	attrs[1].ulValueLen = 5;
+
+	/* Without a URI everything matches */
+	match = p11_uri_match_new (NULL);
+	assert_ptr_not_null (match);
+	assert (p11_uri_match_any_module (match));
+	assert (p11_uri_match_slot_id (match, 5));
+	assert (p11_uri_match_slot (match, &slot));
+	assert (p11_uri_match_token (match, &token));
+	assert (p11_uri_match_attributes (match, attrs, 2));
+	p11_uri_match_free (match);
+
+	uri = p11_kit_uri_new ();
+	assert_ptr_not_null (uri);
+
+	ret = p11_kit_uri_parse ("pkcs11:token=A%20label;model=Giselle;object=Fancy;"
+	                         "slot-description=The%20slot;slot-id=5;"
+	                         "library-description=Quiet;library-version=1",
+	                         P11_KIT_URI_FOR_ANY, uri);
+	assert_num_eq (P11_KIT_URI_OK, ret);
+
+	match = p11_uri_match_new (uri);
+	assert_ptr_not_null (match);
+	assert (!p11_uri_match_nothing (match));
+	assert (!p11_uri_match_any_module (match));
+
+	assert (p11_uri_match_module (match, &info));
+	assert (p11_uri_match_slot_id (match, 5));
+	assert (!p11_uri_match_slot_id (match, 6));
+	assert (p11_uri_match_slot (match, &slot));
+	assert (p11_uri_match_token (match, &token));
+	assert (p11_uri_match_attributes (match, attrs, 2));
+
+	/* Same prefix, different tail */
+	set_space_string (token.label, sizeof (token.label), "A label too");
+	assert (!p11_uri_match_token (match, &token));
+	set_space_string (token.label, sizeof (token.label), "A label");
+	set_space_string (token.model, sizeof (token.model), "Zoolander");
+	assert (!p11_uri_match_token (match, &token));
+
+	info.libraryVersion.major = 2;
+	assert (!p11_uri_match_module (match, &info));
+	set_space_string (slot.slotDescription, sizeof (slot.slotDescription), "Other slot");
+	assert (!p11_uri_match_slot (match, &slot));
+	attrs[1].pValue = "Junk";
+	attrs[1].ulValueLen = 4;
+	assert (!p11_uri_match_attributes (match, attrs, 2));
+
+	p11_uri_match_free (match);
+
+	/* Changes to the URI don't affect a compiled match */
+	match = p11_uri_match_new (uri);
+	p11_kit_uri_clear_attributes (uri);
+	assert (!p11_uri_match_attributes (match, attrs, 2));
+	p11_uri_match_free (match);
+
+	p11_kit_uri_set_unrecognized (uri, 1);
+	match = p11_uri_match_new (uri);
+	assert (p11_uri_match_nothing (match));
+	assert (!p11_uri_match_any_module (match));
+	assert (!p11_uri_match_slot_id (match, 5));
+	assert (!p11_uri_match_attributes (match, attrs, 0));
+	p11_uri_match_free (match);
+
+	p11_kit_uri_free (uri);
+}
+
 static void
 test_uri_get_set_attribute (void)
 {
@@ -1498,6 +1591,7 @@ main (int argc,
 	p11_test (test_uri_match_module, "/uri/test_uri_match_module");
 	p11_test (test_uri_match_version, "/uri/test_uri_match_version");
 	p11_test (test_uri_match_attributes, "/uri/test_uri_match_attributes");
+	p11_test (test_uri_compiled_match, "/uri/compiled-match");
 	p11_test (test_uri_get_set_attribute, "/uri/test_uri_get_set_attribute");
 	p11_test (test_uri_get_set_attributes, "/uri/test_uri_get_set_attributes");
 	p11_test (test_uri_pin_source, "/uri/test_uri_pin_source");
@@ -130,6 +130,81 @@ test_fall_through (void)
 	p11_virtual_unwrap (module);
 }
 
+static void
+test_compile (void)
+{
+	CK_FUNCTION_LIST_PTR module;
+	p11_virtual middle;
+	p11_virtual base;
+	CK_INFO info;
+	CK_RV rv;
+
+	p11_virtual_init (&base, &p11_virtual_base, &mock_module_no_slots, NULL);
+	p11_virtual_init (&middle, &p11_virtual_stack, &base, NULL);
+
+	p11_virtual_compile (&middle);
+
+	/* Calls from this level go straight to the module */
+	assert_ptr_eq (&mock_module_no_slots, middle.fused_module);
+	assert (middle.funcs.C_Initialize != p11_virtual_stack.C_Initialize);
+	assert (middle.funcs.C_GetInfo != p11_virtual_stack.C_GetInfo);
+
+	rv = (middle.funcs.C_Initialize) (&middle.funcs, NULL);
+	assert_num_eq (CKR_OK, rv);
+
+	rv = (middle.funcs.C_GetInfo) (&middle.funcs, &info);
+	assert_num_eq (CKR_OK, rv);
+	assert (memcmp (&info, &MOCK_INFO, sizeof (CK_INFO)) == 0);
+
+	rv = (middle.funcs.C_Finalize) (&middle.funcs, NULL);
+	assert_num_eq (CKR_OK, rv);
+
+	/* Compiling again changes nothing */
+	p11_virtual_compile (&middle);
+	assert_ptr_eq (&mock_module_no_slots, middle.fused_module);
+
+	/* Wrapping a compiled level still goes directly to the module */
+	module = p11_virtual_wrap (&middle, NULL);
+	assert_ptr_not_null (module);
+	assert_ptr_eq (mock_module_no_slots.C_Finalize, module->C_Finalize);
+	assert_ptr_eq (mock_module_no_slots.C_GetInfo, module->C_GetInfo);
+
+	p11_virtual_unwrap (module);
+}
+
+static void
+test_compile_intercept (void)
+{
+	CK_FUNCTION_LIST_PTR module;
+	Override over = { };
+	p11_virtual upper;
+	p11_virtual base;
+	CK_RV rv;
+
+	p11_virtual_init (&base, &p11_virtual_base, &mock_module_no_slots, NULL);
+	p11_virtual_init (&over.virt, &p11_virtual_stack, &base, NULL);
+	over.virt.funcs.C_Initialize = override_initialize;
+	over.check = "overide-arg";
+	p11_virtual_init (&upper, &p11_virtual_stack, &over.virt, NULL);
+
+	p11_virtual_compile (&upper);
+
+	/* The lower level intercepts this, so it's not fused */
+	assert (upper.funcs.C_Initialize == p11_virtual_stack.C_Initialize);
+	assert (upper.funcs.C_Finalize != p11_virtual_stack.C_Finalize);
+
+	module = p11_virtual_wrap (&upper, NULL);
+	assert_ptr_not_null (module);
+
+	/* The closure calls right into the level that intercepts */
+	rv = (module->C_Initialize) ("initialize-arg");
+	assert_num_eq (CKR_NEED_TO_CREATE_THREADS, rv);
+
+	assert_ptr_eq (mock_module_no_slots.C_Finalize, module->C_Finalize);
+
+	p11_virtual_unwrap (module);
+}
+
 static void
 test_get_function_list (void)
 {
@@ -165,6 +240,8 @@ main (int argc,
 	assert (p11_virtual_can_wrap ());
 	p11_test (test_initialize, "/virtual/test_initialize");
 	p11_test (test_fall_through, "/virtual/test_fall_through");
+	p11_test (test_compile, "/virtual/test_compile");
+	p11_test (test_compile_intercept, "/virtual/test_compile_intercept");
 	p11_test (test_get_function_list, "/virtual/test_get_function_list");
 
 	return p11_test_run (argc, argv);
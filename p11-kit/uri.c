@@ -47,6 +47,7 @@
 
 #include <assert.h>
 #include <ctype.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
@@ -553,6 +554,62 @@ p11_kit_uri_clear_attributes (P11KitUri *uri)
 	uri->attrs = NULL;
 }
 
+/* The attributes that a URI can match, in a direct lookup table */
+enum {
+	MATCH_CLASS,
+	MATCH_LABEL,
+	MATCH_ID,
+	MATCH_ATTRS
+};
+
+static int
+match_attr_slot (CK_ATTRIBUTE_TYPE type)
+{
+	switch (type) {
+	case CKA_CLASS:
+		return MATCH_CLASS;
+	case CKA_LABEL:
+		return MATCH_LABEL;
+	case CKA_ID:
+		return MATCH_ID;
+	default:
+		return -1;
+	}
+}
+
+static void
+lookup_match_attrs (CK_ATTRIBUTE *attrs,
+                    CK_ATTRIBUTE **table)
+{
+	int at;
+
+	memset (table, 0, sizeof (CK_ATTRIBUTE *) * MATCH_ATTRS);
+	for (; !p11_attrs_terminator (attrs); attrs++) {
+		at = match_attr_slot (attrs->type);
+		if (at >= 0 && table[at] == NULL)
+			table[at] = attrs;
+	}
+}
+
+static int
+match_attrs (CK_ATTRIBUTE **table,
+             CK_ATTRIBUTE *attrs,
+             CK_ULONG n_attrs)
+{
+	CK_ULONG i;
+	int at;
+
+	for (i = 0; i < n_attrs; i++) {
+		at = match_attr_slot (attrs[i].type);
+		if (at < 0 || table[at] == NULL)
+			continue;
+		if (!p11_attr_equal (table[at], attrs + i))
+			return 0;
+	}
+
+	return 1;
+}
+
 /**
  * p11_kit_uri_match_attributes:
  * @uri: The URI
@@ -572,8 +629,7 @@ int
 p11_kit_uri_match_attributes (P11KitUri *uri, CK_ATTRIBUTE_PTR attrs,
                               CK_ULONG n_attrs)
 {
-	CK_ATTRIBUTE *attr;
-	CK_ULONG i;
+	CK_ATTRIBUTE *table[MATCH_ATTRS];
 
 	return_val_if_fail (uri != NULL, 0);
 	return_val_if_fail (attrs != NULL || n_attrs == 0, 0);
@@ -581,21 +637,229 @@ p11_kit_uri_match_attributes (P11KitUri *uri, CK_ATTRIBUTE_PTR attrs,
 	if (uri->unrecognized)
 		return 0;
 
-	for (i = 0; i < n_attrs; i++) {
-		if (attrs[i].type != CKA_CLASS &&
-		    attrs[i].type != CKA_LABEL &&
-		    attrs[i].type != CKA_ID)
-			continue;
-		attr = NULL;
-		if (uri->attrs)
-			attr = p11_attrs_find (uri->attrs, attrs[i].type);
-		if (!attr)
-			continue;
-		if (!p11_attr_equal (attr, attrs + i))
-			return 0;
+	if (!uri->attrs)
+		return 1;
+
+	lookup_match_attrs (uri->attrs, table);
+	return match_attrs (table, attrs, n_attrs);
+}
+
+/*
+ * A URI compiled for matching many slots, tokens and objects. Only
+ * the parts that were present in the URI are kept, and each one is
+ * rejected on its first eight bytes before comparing the rest.
+ */
+
+typedef struct {
+	size_t offset;
+	size_t length;
+	uint64_t prefix;
+	const unsigned char *value;
+} MatchField;
+
+struct p11_uri_match {
+	bool nothing;
+	CK_INFO module;
+	CK_SLOT_INFO slot;
+	CK_TOKEN_INFO token;
+	CK_SLOT_ID slot_id;
+	bool any_version;
+
+	MatchField module_fields[2];
+	int n_module_fields;
+	MatchField slot_fields[2];
+	int n_slot_fields;
+	MatchField token_fields[4];
+	int n_token_fields;
+
+	CK_ATTRIBUTE *attrs;
+	CK_ATTRIBUTE *table[MATCH_ATTRS];
+};
+
+static inline uint64_t
+match_prefix (const unsigned char *value)
+{
+	uint64_t prefix;
+	memcpy (&prefix, value, sizeof (prefix));
+	return prefix;
+}
+
+static int
+compile_field (MatchField *fields,
+               int n_fields,
+               const void *info,
+               const unsigned char *value,
+               size_t length)
+{
+	/* Empty parts match anything, and are left out */
+	if (value[0] == 0)
+		return n_fields;
+
+	assert (length >= sizeof (uint64_t));
+	fields[n_fields].offset = value - (const unsigned char *)info;
+	fields[n_fields].length = length;
+	fields[n_fields].prefix = match_prefix (value);
+	fields[n_fields].value = value;
+	return n_fields + 1;
+}
+
+static bool
+match_fields (const MatchField *fields,
+              int n_fields,
+              const void *info)
+{
+	const unsigned char *real;
+	int i;
+
+	for (i = 0; i < n_fields; i++) {
+		real = (const unsigned char *)info + fields[i].offset;
+		if (match_prefix (real) != fields[i].prefix ||
+		    memcmp (real, fields[i].value, fields[i].length) != 0)
+			return false;
 	}
 
-	return 1;
+	return true;
+}
+
+p11_uri_match *
+p11_uri_match_new (P11KitUri *uri)
+{
+	p11_uri_match *match;
+	int n;
+
+	match = calloc (1, sizeof (p11_uri_match));
+	return_val_if_fail (match != NULL, NULL);
+
+	match->slot_id = (CK_SLOT_ID)-1;
+	match->any_version = true;
+
+	if (uri == NULL)
+		return match;
+
+	if (uri->unrecognized) {
+		match->nothing = true;
+		return match;
+	}
+
+	memcpy (&match->module, &uri->module, sizeof (CK_INFO));
+	memcpy (&match->slot, &uri->slot, sizeof (CK_SLOT_INFO));
+	memcpy (&match->token, &uri->token, sizeof (CK_TOKEN_INFO));
+	match->slot_id = uri->slot_id;
+	match->any_version = (uri->module.libraryVersion.major == (CK_BYTE)-1 &&
+	                      uri->module.libraryVersion.minor == (CK_BYTE)-1);
+
+	n = compile_field (match->module_fields, 0, &match->module,
+	                   match->module.libraryDescription,
+	                   sizeof (match->module.libraryDescription));
+	n = compile_field (match->module_fields, n, &match->module,
+	                   match->module.manufacturerID,
+	                   sizeof (match->module.manufacturerID));
+	match->n_module_fields = n;
+
+	n = compile_field (match->slot_fields, 0, &match->slot,
+	                   match->slot.slotDescription,
+	                   sizeof (match->slot.slotDescription));
+	n = compile_field (match->slot_fields, n, &match->slot,
+	                   match->slot.manufacturerID,
+	                   sizeof (match->slot.manufacturerID));
+	match->n_slot_fields = n;
+
+	/* Most selective first: tokens often share a manufacturer and model */
+	n = compile_field (match->token_fields, 0, &match->token,
+	                   match->token.label,
+	                   sizeof (match->token.label));
+	n = compile_field (match->token_fields, n, &match->token,
+	                   match->token.serialNumber,
+	                   sizeof (match->token.serialNumber));
+	n = compile_field (match->token_fields, n, &match->token,
+	                   match->token.manufacturerID,
+	                   sizeof (match->token.manufacturerID));
+	n = compile_field (match->token_fields, n, &match->token,
+	                   match->token.model,
+	                   sizeof (match->token.model));
+	match->n_token_fields = n;
+
+	if (uri->attrs) {
+		match->attrs = p11_attrs_dup (uri->attrs);
+		return_val_if_fail (match->attrs != NULL, NULL);
+		lookup_match_attrs (match->attrs, match->table);
+	}
+
+	return match;
+}
+
+void
+p11_uri_match_free (p11_uri_match *match)
+{
+	if (match == NULL)
+		return;
+	p11_attrs_free (match->attrs);
+	free (match);
+}
+
+bool
+p11_uri_match_nothing (p11_uri_match *match)
+{
+	return match->nothing;
+}
+
+bool
+p11_uri_match_any_module (p11_uri_match *match)
+{
+	return !match->nothing && match->any_version &&
+	       match->n_module_fields == 0;
+}
+
+bool
+p11_uri_match_module (p11_uri_match *match,
+                      CK_INFO *info)
+{
+	if (match->nothing)
+		return false;
+	if (!match->any_version &&
+	    memcmp (&match->module.libraryVersion, &info->libraryVersion,
+	            sizeof (CK_VERSION)) != 0)
+		return false;
+	return match_fields (match->module_fields, match->n_module_fields, info);
+}
+
+bool
+p11_uri_match_slot_id (p11_uri_match *match,
+                       CK_SLOT_ID slot_id)
+{
+	if (match->nothing)
+		return false;
+	return match->slot_id == (CK_SLOT_ID)-1 || match->slot_id == slot_id;
+}
+
+bool
+p11_uri_match_slot (p11_uri_match *match,
+                    CK_SLOT_INFO *info)
+{
+	if (match->nothing)
+		return false;
+	return match_fields (match->slot_fields, match->n_slot_fields, info);
+}
+
+bool
+p11_uri_match_token (p11_uri_match *match,
+                     CK_TOKEN_INFO *info)
+{
+	if (match->nothing)
+		return false;
+	return match_fields (match->token_fields, match->n_token_fields, info);
+}
+
+bool
+p11_uri_match_attributes (p11_uri_match *match,
+                          CK_ATTRIBUTE *attrs,
+                          CK_ULONG n_attrs)
+{
+	if (match->nothing)
+		return false;
+	if (match->attrs == NULL)
+		return true;
+	return match_attrs (match->table, attrs, n_attrs) ? true : false;
 }
 
 /**
@@ -940,7 +1204,7 @@ p11_kit_uri_format (P11KitUri *uri, P11KitUriType uri_type, char **string)
 	return_val_if_fail (uri != NULL, P11_KIT_URI_UNEXPECTED);
 	return_val_if_fail (string != NULL, P11_KIT_URI_UNEXPECTED);
 
-	if (!p11_buffer_init_null (&buffer, 64))
+	if (!p11_buffer_init_null (&buffer, 256))
 		return_val_if_reached (P11_KIT_URI_UNEXPECTED);
 
 	p11_buffer_add (&buffer, P11_KIT_URI_SCHEME, P11_KIT_URI_SCHEME_LEN);
@@ -1031,6 +1295,19 @@ p11_kit_uri_format (P11KitUri *uri, P11KitUriType uri_type, char **string)
 	return P11_KIT_URI_OK;
 }
 
+/*
+ * Whether the URI part name is the same as, or a leading part of, the
+ * given name. This is how the parser has always matched names.
+ */
+static bool
+name_is (const char *name,
+         const char *start,
+         const char *end)
+{
+	size_t length = end - start;
+	return length <= strlen (name) && memcmp (name, start, length) == 0;
+}
+
 static int
 parse_string_attribute (const char *name_start, const char *name_end,
 			const char *start, const char *end,
@@ -1043,9 +1320,9 @@ parse_string_attribute (const char *name_start, const char *name_end,
 	assert (name_start <= name_end);
 	assert (start <= end);
 
-	if (memcmp ("id", name_start, name_end - name_start) == 0)
+	if (name_is ("id", name_start, name_end))
 		type = CKA_ID;
-	else if (memcmp ("object", name_start, name_end - name_start) == 0)
+	else if (name_is ("object", name_start, name_end))
 		type = CKA_LABEL;
 	else
 		return 0;
@@ -1069,22 +1346,22 @@ parse_class_attribute (const char *name_start, const char *name_end,
 	assert (name_start <= name_end);
 	assert (start <= end);
 
-	if (memcmp ("objecttype", name_start, name_end - name_start) != 0 &&
-	    memcmp ("object-type", name_start, name_end - name_start) != 0 &&
-	    memcmp ("type", name_start, name_end - name_start) != 0)
+	if (!name_is ("objecttype", name_start, name_end) &&
+	    !name_is ("object-type", name_start, name_end) &&
+	    !name_is ("type", name_start, name_end))
 		return 0;
 
-	if (memcmp ("cert", start, end - start) == 0)
+	if (name_is ("cert", start, end))
 		klass = CKO_CERTIFICATE;
-	else if (memcmp ("public", start, end - start) == 0)
+	else if (name_is ("public", start, end))
 		klass = CKO_PUBLIC_KEY;
-	else if (memcmp ("private", start, end - start) == 0)
+	else if (name_is ("private", start, end))
 		klass = CKO_PRIVATE_KEY;
-	else if (memcmp ("secretkey", start, end - start) == 0)
+	else if (name_is ("secretkey", start, end))
 		klass = CKO_SECRET_KEY;
-	else if (memcmp ("secret-key", start, end - start) == 0)
+	else if (name_is ("secret-key", start, end))
 		klass = CKO_SECRET_KEY;
-	else if (memcmp ("data", start, end - start) == 0)
+	else if (name_is ("data", start, end))
 		klass = CKO_DATA;
 	else {
 		uri->unrecognized = true;
@@ -1103,26 +1380,24 @@ static int
 parse_struct_info (unsigned char *where, size_t length, const char *start,
                    const char *end, P11KitUri *uri)
 {
-	unsigned char *value;
+	unsigned char value[64];
 	size_t value_length;
 
 	assert (start <= end);
+	assert (length <= sizeof (value));
 
-	value = p11_url_decode (start, end, P11_URL_WHITESPACE, &value_length);
-	if (value == NULL)
+	value_length = length;
+	if (!p11_url_decode_to (start, end, P11_URL_WHITESPACE, value, &value_length))
 		return P11_KIT_URI_BAD_ENCODING;
 
 	/* Too long, shouldn't match anything */
 	if (value_length > length) {
-		free (value);
 		uri->unrecognized = true;
 		return 1;
 	}
 
-	memset (where, ' ', length);
 	memcpy (where, value, value_length);
-
-	free (value);
+	memset (where + value_length, ' ', length - value_length);
 	return 1;
 }
 
@@ -1137,16 +1412,16 @@ parse_token_info (const char *name_start, const char *name_end,
 	assert (name_start <= name_end);
 	assert (start <= end);
 
-	if (memcmp ("model", name_start, name_end - name_start) == 0) {
+	if (name_is ("model", name_start, name_end)) {
 		where = uri->token.model;
 		length = sizeof (uri->token.model);
-	} else if (memcmp ("manufacturer", name_start, name_end - name_start) == 0) {
+	} else if (name_is ("manufacturer", name_start, name_end)) {
 		where = uri->token.manufacturerID;
 		length = sizeof (uri->token.manufacturerID);
-	} else if (memcmp ("serial", name_start, name_end - name_start) == 0) {
+	} else if (name_is ("serial", name_start, name_end)) {
 		where = uri->token.serialNumber;
 		length = sizeof (uri->token.serialNumber);
-	} else if (memcmp ("token", name_start, name_end - name_start) == 0) {
+	} else if (name_is ("token", name_start, name_end)) {
 		where = uri->token.label;
 		length = sizeof (uri->token.label);
 	} else {
@@ -1213,10 +1488,10 @@ parse_slot_info (const char *name_start, const char *name_end,
 	assert (name_start <= name_end);
 	assert (start <= end);
 
-	if (memcmp ("slot-description", name_start, name_end - name_start) == 0) {
+	if (name_is ("slot-description", name_start, name_end)) {
 		where = uri->slot.slotDescription;
 		length = sizeof (uri->slot.slotDescription);
-	} else if (memcmp ("slot-manufacturer", name_start, name_end - name_start) == 0) {
+	} else if (name_is ("slot-manufacturer", name_start, name_end)) {
 		where = uri->slot.manufacturerID;
 		length = sizeof (uri->slot.manufacturerID);
 	} else {
@@ -1234,7 +1509,7 @@ parse_slot_id (const char *name_start, const char *name_end,
 	assert (name_start <= name_end);
 	assert (start <= end);
 
-	if (memcmp ("slot-id", name_start, name_end - name_start) == 0) {
+	if (name_is ("slot-id", name_start, name_end)) {
 		long val;
 		val = atoin (start, end);
 		if (val < 0)
@@ -1253,7 +1528,7 @@ parse_module_version_info (const char *name_start, const char *name_end,
 	assert (name_start <= name_end);
 	assert (start <= end);
 
-	if (memcmp ("library-version", name_start, name_end - name_start) == 0)
+	if (name_is ("library-version", name_start, name_end))
 		return parse_struct_version (start, end,
 		                             &uri->module.libraryVersion);
 
@@ -1271,10 +1546,10 @@ parse_module_info (const char *name_start, const char *name_end,
 	assert (name_start <= name_end);
 	assert (start <= end);
 
-	if (memcmp ("library-description", name_start, name_end - name_start) == 0) {
+	if (name_is ("library-description", name_start, name_end)) {
 		where = uri->module.libraryDescription;
 		length = sizeof (uri->module.libraryDescription);
-	} else if (memcmp ("library-manufacturer", name_start, name_end - name_start) == 0) {
+	} else if (name_is ("library-manufacturer", name_start, name_end)) {
 		where = uri->module.manufacturerID;
 		length = sizeof (uri->module.manufacturerID);
 	} else {
@@ -1294,15 +1569,15 @@ parse_extra_info (const char *name_start, const char *name_end,
 	assert (name_start <= name_end);
 	assert (start <= end);
 
-	if (memcmp ("pinfile", name_start, name_end - name_start) == 0 ||
-	    memcmp ("pin-source", name_start, name_end - name_start) == 0) {
+	if (name_is ("pinfile", name_start, name_end) ||
+	    name_is ("pin-source", name_start, name_end)) {
 		pin_source = p11_url_decode (start, end, P11_URL_WHITESPACE, NULL);
 		if (pin_source == NULL)
 			return P11_KIT_URI_BAD_ENCODING;
 		free (uri->pin_source);
 		uri->pin_source = (char*)pin_source;
 		return 1;
-	} else if (memcmp ("pin-value", name_start, name_end - name_start) == 0) {
+	} else if (name_is ("pin-value", name_start, name_end)) {
 		pin_source = p11_url_decode (start, end, P11_URL_WHITESPACE, NULL);
 		if (pin_source == NULL)
 			return P11_KIT_URI_BAD_ENCODING;
@@ -251,6 +251,7 @@ void
 _p11_kit_init (void)
 {
 	p11_library_init_once ();
+	p11_pin_init ();
 }
 
 #ifdef __GNUC__
@@ -260,6 +261,7 @@ void
 _p11_kit_fini (void)
 {
 	p11_proxy_module_cleanup ();
+	p11_pin_uninit ();
 	p11_library_uninit ();
 }
 
@@ -277,12 +279,14 @@ DllMain (HINSTANCE instance,
 	switch (reason) {
 	case DLL_PROCESS_ATTACH:
 		p11_library_init ();
+		p11_pin_init ();
 		break;
 	case DLL_THREAD_DETACH:
 		p11_library_thread_cleanup ();
 		break;
 	case DLL_PROCESS_DETACH:
 		p11_proxy_module_cleanup ();
+		p11_pin_uninit ();
 		p11_library_uninit ();
 		break;
 	default:
@@ -2485,6 +2485,7 @@ p11_virtual_init (p11_virtual *virt,
 	memcpy (virt, funcs, sizeof (CK_X_FUNCTION_LIST));
 	virt->lower_module = lower_module;
 	virt->lower_destroy = lower_destroy;
+	virt->fused_module = NULL;
 }
 
 void
@@ -2496,12 +2497,204 @@ p11_virtual_uninit (p11_virtual *virt)
 
 #ifdef WITH_FFI
 
+/*
+ * These are installed by p11_virtual_compile() in place of stack functions
+ * whose calls would just fall through all the way to the base module.
+ */
+
+#define FUSED_FUNCTION(name, args, ...) \
+	static CK_RV \
+	fused_C_##name (CK_X_FUNCTION_LIST *self, __VA_ARGS__) \
+	{ \
+		p11_virtual *virt = (p11_virtual *)self; \
+		return virt->fused_module->C_##name args; \
+	}
+
+FUSED_FUNCTION (Initialize, (init_args),
+                CK_VOID_PTR init_args)
+FUSED_FUNCTION (Finalize, (reserved),
+                CK_VOID_PTR reserved)
+FUSED_FUNCTION (GetInfo, (info),
+                CK_INFO_PTR info)
+FUSED_FUNCTION (GetSlotList, (token_present, slot_list, count),
+                CK_BBOOL token_present, CK_SLOT_ID_PTR slot_list, CK_ULONG_PTR count)
+FUSED_FUNCTION (GetSlotInfo, (slot_id, info),
+                CK_SLOT_ID slot_id, CK_SLOT_INFO_PTR info)
+FUSED_FUNCTION (GetTokenInfo, (slot_id, info),
+                CK_SLOT_ID slot_id, CK_TOKEN_INFO_PTR info)
+FUSED_FUNCTION (GetMechanismList, (slot_id, mechanism_list, count),
+                CK_SLOT_ID slot_id, CK_MECHANISM_TYPE_PTR mechanism_list,
+                CK_ULONG_PTR count)
+FUSED_FUNCTION (GetMechanismInfo, (slot_id, type, info),
+                CK_SLOT_ID slot_id, CK_MECHANISM_TYPE type, CK_MECHANISM_INFO_PTR info)
+FUSED_FUNCTION (InitToken, (slot_id, pin, pin_len, label),
+                CK_SLOT_ID slot_id, CK_UTF8CHAR_PTR pin, CK_ULONG pin_len,
+                CK_UTF8CHAR_PTR label)
+FUSED_FUNCTION (OpenSession, (slot_id, flags, application, notify, session),
+                CK_SLOT_ID slot_id, CK_FLAGS flags, CK_VOID_PTR application,
+                CK_NOTIFY notify, CK_SESSION_HANDLE_PTR session)
+FUSED_FUNCTION (CloseSession, (session),
+                CK_SESSION_HANDLE session)
+FUSED_FUNCTION (CloseAllSessions, (slot_id),
+                CK_SLOT_ID slot_id)
+FUSED_FUNCTION (GetSessionInfo, (session, info),
+                CK_SESSION_HANDLE session, CK_SESSION_INFO_PTR info)
+FUSED_FUNCTION (InitPIN, (session, pin, pin_len),
+                CK_SESSION_HANDLE session, CK_UTF8CHAR_PTR pin, CK_ULONG pin_len)
+FUSED_FUNCTION (SetPIN, (session, old_pin, old_len, new_pin, new_len),
+                CK_SESSION_HANDLE session, CK_UTF8CHAR_PTR old_pin, CK_ULONG old_len,
+                CK_UTF8CHAR_PTR new_pin, CK_ULONG new_len)
+FUSED_FUNCTION (GetOperationState, (session, operation_state, operation_state_len),
+                CK_SESSION_HANDLE session, CK_BYTE_PTR operation_state,
+                CK_ULONG_PTR operation_state_len)
+FUSED_FUNCTION (SetOperationState, (session, operation_state, operation_state_len, encryption_key, authentication_key),
+                CK_SESSION_HANDLE session, CK_BYTE_PTR operation_state,
+                CK_ULONG operation_state_len, CK_OBJECT_HANDLE encryption_key,
+                CK_OBJECT_HANDLE authentication_key)
+FUSED_FUNCTION (Login, (session, user_type, pin, pin_len),
+                CK_SESSION_HANDLE session, CK_USER_TYPE user_type, CK_UTF8CHAR_PTR pin,
+                CK_ULONG pin_len)
+FUSED_FUNCTION (Logout, (session),
+                CK_SESSION_HANDLE session)
+FUSED_FUNCTION (CreateObject, (session, template, count, object),
+                CK_SESSION_HANDLE session, CK_ATTRIBUTE_PTR template, CK_ULONG count,
+                CK_OBJECT_HANDLE_PTR object)
+FUSED_FUNCTION (CopyObject, (session, object, template, count, new_object),
+                CK_SESSION_HANDLE session, CK_OBJECT_HANDLE object,
+                CK_ATTRIBUTE_PTR template, CK_ULONG count,
+                CK_OBJECT_HANDLE_PTR new_object)
+FUSED_FUNCTION (DestroyObject, (session, object),
+                CK_SESSION_HANDLE session, CK_OBJECT_HANDLE object)
+FUSED_FUNCTION (GetObjectSize, (session, object, size),
+                CK_SESSION_HANDLE session, CK_OBJECT_HANDLE object, CK_ULONG_PTR size)
+FUSED_FUNCTION (GetAttributeValue, (session, object, template, count),
+                CK_SESSION_HANDLE session, CK_OBJECT_HANDLE object,
+                CK_ATTRIBUTE_PTR template, CK_ULONG count)
+FUSED_FUNCTION (SetAttributeValue, (session, object, template, count),
+                CK_SESSION_HANDLE session, CK_OBJECT_HANDLE object,
+                CK_ATTRIBUTE_PTR template, CK_ULONG count)
+FUSED_FUNCTION (FindObjectsInit, (session, template, count),
+                CK_SESSION_HANDLE session, CK_ATTRIBUTE_PTR template, CK_ULONG count)
+FUSED_FUNCTION (FindObjects, (session, object, max_object_count, object_count),
+                CK_SESSION_HANDLE session, CK_OBJECT_HANDLE_PTR object,
+                CK_ULONG max_object_count, CK_ULONG_PTR object_count)
+FUSED_FUNCTION (FindObjectsFinal, (session),
+                CK_SESSION_HANDLE session)
+FUSED_FUNCTION (EncryptInit, (session, mechanism, key),
+                CK_SESSION_HANDLE session, CK_MECHANISM_PTR mechanism,
+                CK_OBJECT_HANDLE key)
+FUSED_FUNCTION (Encrypt, (session, input, input_len, encrypted_data, encrypted_data_len),
+                CK_SESSION_HANDLE session, CK_BYTE_PTR input, CK_ULONG input_len,
+                CK_BYTE_PTR encrypted_data, CK_ULONG_PTR encrypted_data_len)
+FUSED_FUNCTION (EncryptUpdate, (session, part, part_len, encrypted_part, encrypted_part_len),
+                CK_SESSION_HANDLE session, CK_BYTE_PTR part, CK_ULONG part_len,
+                CK_BYTE_PTR encrypted_part, CK_ULONG_PTR encrypted_part_len)
+FUSED_FUNCTION (EncryptFinal, (session, last_encrypted_part, last_encrypted_part_len),
+                CK_SESSION_HANDLE session, CK_BYTE_PTR last_encrypted_part,
+                CK_ULONG_PTR last_encrypted_part_len)
+FUSED_FUNCTION (DecryptInit, (session, mechanism, key),
+                CK_SESSION_HANDLE session, CK_MECHANISM_PTR mechanism,
+                CK_OBJECT_HANDLE key)
+FUSED_FUNCTION (Decrypt, (session, encrypted_data, encrypted_data_len, output, output_len),
+                CK_SESSION_HANDLE session, CK_BYTE_PTR encrypted_data,
+                CK_ULONG encrypted_data_len, CK_BYTE_PTR output, CK_ULONG_PTR output_len)
+FUSED_FUNCTION (DecryptUpdate, (session, encrypted_part, encrypted_part_len, part, part_len),
+                CK_SESSION_HANDLE session, CK_BYTE_PTR encrypted_part,
+                CK_ULONG encrypted_part_len, CK_BYTE_PTR part, CK_ULONG_PTR part_len)
+FUSED_FUNCTION (DecryptFinal, (session, last_part, last_part_len),
+                CK_SESSION_HANDLE session, CK_BYTE_PTR last_part,
+                CK_ULONG_PTR last_part_len)
+FUSED_FUNCTION (DigestInit, (session, mechanism),
+                CK_SESSION_HANDLE session, CK_MECHANISM_PTR mechanism)
+FUSED_FUNCTION (Digest, (session, input, input_len, digest, digest_len),
+                CK_SESSION_HANDLE session, CK_BYTE_PTR input, CK_ULONG input_len,
+                CK_BYTE_PTR digest, CK_ULONG_PTR digest_len)
+FUSED_FUNCTION (DigestUpdate, (session, part, part_len),
+                CK_SESSION_HANDLE session, CK_BYTE_PTR part, CK_ULONG part_len)
+FUSED_FUNCTION (DigestKey, (session, key),
+                CK_SESSION_HANDLE session, CK_OBJECT_HANDLE key)
+FUSED_FUNCTION (DigestFinal, (session, digest, digest_len),
+                CK_SESSION_HANDLE session, CK_BYTE_PTR digest, CK_ULONG_PTR digest_len)
+FUSED_FUNCTION (SignInit, (session, mechanism, key),
+                CK_SESSION_HANDLE session, CK_MECHANISM_PTR mechanism,
+                CK_OBJECT_HANDLE key)
+FUSED_FUNCTION (Sign, (session, input, input_len, signature, signature_len),
+                CK_SESSION_HANDLE session, CK_BYTE_PTR input, CK_ULONG input_len,
+                CK_BYTE_PTR signature, CK_ULONG_PTR signature_len)
+FUSED_FUNCTION (SignUpdate, (session, part, part_len),
+                CK_SESSION_HANDLE session, CK_BYTE_PTR part, CK_ULONG part_len)
+FUSED_FUNCTION (SignFinal, (session, signature, signature_len),
+                CK_SESSION_HANDLE session, CK_BYTE_PTR signature,
+                CK_ULONG_PTR signature_len)
+FUSED_FUNCTION (SignRecoverInit, (session, mechanism, key),
+                CK_SESSION_HANDLE session, CK_MECHANISM_PTR mechanism,
+                CK_OBJECT_HANDLE key)
+FUSED_FUNCTION (SignRecover, (session, input, input_len, signature, signature_len),
+                CK_SESSION_HANDLE session, CK_BYTE_PTR input, CK_ULONG input_len,
+                CK_BYTE_PTR signature, CK_ULONG_PTR signature_len)
+FUSED_FUNCTION (VerifyInit, (session, mechanism, key),
+                CK_SESSION_HANDLE session, CK_MECHANISM_PTR mechanism,
+                CK_OBJECT_HANDLE key)
+FUSED_FUNCTION (Verify, (session, input, input_len, signature, signature_len),
+                CK_SESSION_HANDLE session, CK_BYTE_PTR input, CK_ULONG input_len,
+                CK_BYTE_PTR signature, CK_ULONG signature_len)
+FUSED_FUNCTION (VerifyUpdate, (session, part, part_len),
+                CK_SESSION_HANDLE session, CK_BYTE_PTR part, CK_ULONG part_len)
+FUSED_FUNCTION (VerifyFinal, (session, signature, signature_len),
+                CK_SESSION_HANDLE session, CK_BYTE_PTR signature, CK_ULONG signature_len)
+FUSED_FUNCTION (VerifyRecoverInit, (session, mechanism, key),
+                CK_SESSION_HANDLE session, CK_MECHANISM_PTR mechanism,
+                CK_OBJECT_HANDLE key)
+FUSED_FUNCTION (VerifyRecover, (session, signature, signature_len, input, input_len),
+                CK_SESSION_HANDLE session, CK_BYTE_PTR signature, CK_ULONG signature_len,
+                CK_BYTE_PTR input, CK_ULONG_PTR input_len)
+FUSED_FUNCTION (DigestEncryptUpdate, (session, part, part_len, encrypted_part, encrypted_part_len),
+                CK_SESSION_HANDLE session, CK_BYTE_PTR part, CK_ULONG part_len,
+                CK_BYTE_PTR encrypted_part, CK_ULONG_PTR encrypted_part_len)
+FUSED_FUNCTION (DecryptDigestUpdate, (session, encrypted_part, encrypted_part_len, part, part_len),
+                CK_SESSION_HANDLE session, CK_BYTE_PTR encrypted_part,
+                CK_ULONG encrypted_part_len, CK_BYTE_PTR part, CK_ULONG_PTR part_len)
+FUSED_FUNCTION (SignEncryptUpdate, (session, part, part_len, encrypted_part, encrypted_part_len),
+                CK_SESSION_HANDLE session, CK_BYTE_PTR part, CK_ULONG part_len,
+                CK_BYTE_PTR encrypted_part, CK_ULONG_PTR encrypted_part_len)
+FUSED_FUNCTION (DecryptVerifyUpdate, (session, encrypted_part, encrypted_part_len, part, part_len),
+                CK_SESSION_HANDLE session, CK_BYTE_PTR encrypted_part,
+                CK_ULONG encrypted_part_len, CK_BYTE_PTR part, CK_ULONG_PTR part_len)
+FUSED_FUNCTION (GenerateKey, (session, mechanism, template, count, key),
+                CK_SESSION_HANDLE session, CK_MECHANISM_PTR mechanism,
+                CK_ATTRIBUTE_PTR template, CK_ULONG count, CK_OBJECT_HANDLE_PTR key)
+FUSED_FUNCTION (GenerateKeyPair, (session, mechanism, public_key_template, public_key_count, private_key_template, private_key_count, public_key, private_key),
+                CK_SESSION_HANDLE session, CK_MECHANISM_PTR mechanism,
+                CK_ATTRIBUTE_PTR public_key_template, CK_ULONG public_key_count,
+                CK_ATTRIBUTE_PTR private_key_template, CK_ULONG private_key_count,
+                CK_OBJECT_HANDLE_PTR public_key, CK_OBJECT_HANDLE_PTR private_key)
+FUSED_FUNCTION (WrapKey, (session, mechanism, wrapping_key, key, wrapped_key, wrapped_key_len),
+                CK_SESSION_HANDLE session, CK_MECHANISM_PTR mechanism,
+                CK_OBJECT_HANDLE wrapping_key, CK_OBJECT_HANDLE key,
+                CK_BYTE_PTR wrapped_key, CK_ULONG_PTR wrapped_key_len)
+FUSED_FUNCTION (UnwrapKey, (session, mechanism, unwrapping_key, wrapped_key, wrapped_key_len, template, count, key),
+                CK_SESSION_HANDLE session, CK_MECHANISM_PTR mechanism,
+                CK_OBJECT_HANDLE unwrapping_key, CK_BYTE_PTR wrapped_key,
+                CK_ULONG wrapped_key_len, CK_ATTRIBUTE_PTR template, CK_ULONG count,
+                CK_OBJECT_HANDLE_PTR key)
+FUSED_FUNCTION (DeriveKey, (session, mechanism, base_key, template, count, key),
+                CK_SESSION_HANDLE session, CK_MECHANISM_PTR mechanism,
+                CK_OBJECT_HANDLE base_key, CK_ATTRIBUTE_PTR template, CK_ULONG count,
+                CK_OBJECT_HANDLE_PTR key)
+FUSED_FUNCTION (SeedRandom, (session, seed, seed_len),
+                CK_SESSION_HANDLE session, CK_BYTE_PTR seed, CK_ULONG seed_len)
+FUSED_FUNCTION (GenerateRandom, (session, random_data, random_len),
+                CK_SESSION_HANDLE session, CK_BYTE_PTR random_data, CK_ULONG random_len)
+FUSED_FUNCTION (WaitForSlotEvent, (flags, slot_id, reserved),
+                CK_FLAGS flags, CK_SLOT_ID_PTR slot_id, CK_VOID_PTR reserved)
+
 typedef struct {
 	const char *name;
 	void *binding_function;
 	void *stack_fallback;
 	size_t virtual_offset;
 	void *base_fallback;
+	void *fused_fallback;
 	size_t module_offset;
 	ffi_type *types[MAX_ARGS];
 } FunctionInfo;
@@ -2516,7 +2709,7 @@ typedef struct {
 #define FUNCTION(name) \
 	#name, binding_C_##name, \
 	stack_C_##name, STRUCT_OFFSET (CK_X_FUNCTION_LIST, C_##name), \
-	base_C_##name, STRUCT_OFFSET (CK_FUNCTION_LIST, C_##name)
+	base_C_##name, fused_C_##name, STRUCT_OFFSET (CK_FUNCTION_LIST, C_##name)
 
 static const FunctionInfo function_info[] = {
 	{ FUNCTION (Initialize), { &ffi_type_pointer, NULL } },
@@ -2616,11 +2809,85 @@ lookup_fall_through (p11_virtual *virt,
 	} else if (func == info->base_fallback) {
 		*bound_func = STRUCT_MEMBER (void *, virt->lower_module, info->module_offset);
 		return true;
+
+	/*
+	 * This level has already been compiled, and we know that the stack
+	 * below it falls all the way through to this module function.
+	 */
+	} else if (func == info->fused_fallback) {
+		*bound_func = STRUCT_MEMBER (void *, virt->fused_module, info->module_offset);
+		return true;
 	}
 
 	return false;
 }
 
+static CK_FUNCTION_LIST *
+lookup_fused_module (p11_virtual *virt,
+                     const FunctionInfo *info)
+{
+	void *func;
+
+	func = STRUCT_MEMBER (void *, virt, info->virtual_offset);
+
+	if (func == info->stack_fallback)
+		return lookup_fused_module (virt->lower_module, info);
+	else if (func == info->base_fallback)
+		return virt->lower_module;
+	else if (func == info->fused_fallback)
+		return virt->fused_module;
+
+	return NULL;
+}
+
+static p11_virtual *
+lookup_intercept (p11_virtual *virt,
+                  const FunctionInfo *info)
+{
+	/* Skip over the levels of the stack that would just fall through */
+	while (STRUCT_MEMBER (void *, virt, info->virtual_offset) == info->stack_fallback)
+		virt = virt->lower_module;
+
+	return virt;
+}
+
+void
+p11_virtual_compile (p11_virtual *virt)
+{
+	CK_FUNCTION_LIST *module;
+	const FunctionInfo *info;
+	void **func;
+	int i;
+
+	return_if_fail (virt != NULL);
+
+	/*
+	 * Each stack function that falls through to the bottom of the stack is
+	 * replaced with one that calls the module directly. This means that a
+	 * call only goes through the levels that actually do something with it.
+	 *
+	 * This must be done after all the overridden functions are in place.
+	 */
+
+	for (i = 0; function_info[i].name != NULL; i++) {
+		info = function_info + i;
+
+		func = &STRUCT_MEMBER (void *, virt, info->virtual_offset);
+		if (*func != info->stack_fallback)
+			continue;
+
+		module = lookup_fused_module (virt->lower_module, info);
+		if (module == NULL)
+			continue;
+
+		/* A stack only has one module at the bottom */
+		return_if_fail (virt->fused_module == NULL || virt->fused_module == module);
+
+		virt->fused_module = module;
+		*func = info->fused_fallback;
+	}
+}
+
 static bool
 bind_ffi_closure (Wrapper *wrapper,
                   void *binding_data,
@@ -2679,12 +2946,11 @@ init_wrapper_funcs (Wrapper *wrapper)
 {
 	static const ffi_type *get_function_list_args[] = { &ffi_type_pointer, NULL };
 	const FunctionInfo *info;
-	CK_X_FUNCTION_LIST *over;
+	p11_virtual *over;
 	void **bound;
 	int i;
 
-	/* Pointer to where our calls go */
-	over = &wrapper->virt->funcs;
+	p11_virtual_compile (wrapper->virt);
 
 	for (i = 0; function_info[i].name != NULL; i++) {
 		info = function_info + i;
@@ -2698,7 +2964,11 @@ init_wrapper_funcs (Wrapper *wrapper)
 		 * fall through, then this returns the original module function.
 		 */
 		if (!lookup_fall_through (wrapper->virt, info, bound)) {
-			if (!bind_ffi_closure (wrapper, over,
+
+			/* Pointer to the first level that handles this call */
+			over = lookup_intercept (wrapper->virt, info);
+
+			if (!bind_ffi_closure (wrapper, &over->funcs,
 			                       info->binding_function,
 			                       (ffi_type **)info->types, bound))
 				return_val_if_reached (false);
@@ -2781,6 +3051,14 @@ p11_virtual_is_wrapper (CK_FUNCTION_LIST_PTR module)
 		module->C_CancelFunction == short_C_CancelFunction);
 }
 
+p11_virtual *
+p11_virtual_wrapped (CK_FUNCTION_LIST_PTR module)
+{
+	return_val_if_fail (p11_virtual_is_wrapper (module), NULL);
+
+	return ((Wrapper *)module)->virt;
+}
+
 void
 p11_virtual_unwrap (CK_FUNCTION_LIST_PTR module)
 {
@@ -2809,6 +3087,12 @@ p11_virtual_unwrap (CK_FUNCTION_LIST_PTR module)
 
 #else /* !WITH_FFI */
 
+void
+p11_virtual_compile (p11_virtual *virt)
+{
+	/* Nothing to do, stacks are only used with wrapping */
+}
+
 CK_FUNCTION_LIST *
 p11_virtual_wrap (p11_virtual *virt,
                   p11_destroyer destroyer)
@@ -2828,6 +3112,12 @@ p11_virtual_is_wrapper (CK_FUNCTION_LIST_PTR module)
 	return FALSE;
 }
 
+p11_virtual *
+p11_virtual_wrapped (CK_FUNCTION_LIST_PTR module)
+{
+	assert_not_reached ();
+}
+
 void
 p11_virtual_unwrap (CK_FUNCTION_LIST_PTR module)
 {
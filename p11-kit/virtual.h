@@ -43,6 +43,7 @@ typedef struct {
 	CK_X_FUNCTION_LIST funcs;
 	void *lower_module;
 	p11_destroyer lower_destroy;
+	CK_FUNCTION_LIST *fused_module;
 } p11_virtual;
 
 extern CK_X_FUNCTION_LIST p11_virtual_base;
@@ -56,6 +57,8 @@ void                    p11_virtual_init       (p11_virtual *virt,
 
 void                    p11_virtual_uninit     (p11_virtual *virt);
 
+void                    p11_virtual_compile    (p11_virtual *virt);
+
 bool                    p11_virtual_can_wrap   (void);
 
 CK_FUNCTION_LIST *      p11_virtual_wrap       (p11_virtual *virt,
@@ -63,6 +66,8 @@ CK_FUNCTION_LIST *      p11_virtual_wrap       (p11_virtual *virt,
 
 bool                    p11_virtual_is_wrapper (CK_FUNCTION_LIST *module);
 
+p11_virtual *           p11_virtual_wrapped    (CK_FUNCTION_LIST *module);
+
 void                    p11_virtual_unwrap     (CK_FUNCTION_LIST *module);
 
 #endif /* __P11_VIRTUAL_H__ */
@@ -0,0 +1,167 @@
+/*
+ * Copyright (c) 2016 Red Hat Inc
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *     * Redistributions of source code must retain the above
+ *       copyright notice, this list of conditions and the
+ *       following disclaimer.
+ *     * Redistributions in binary form must reproduce the
+ *       above copyright notice, this list of conditions and
+ *       the following disclaimer in the documentation and/or
+ *       other materials provided with the distribution.
+ *     * The names of contributors to this software may not be
+ *       used to endorse or promote products derived from this
+ *       software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+#include "config.h"
+#include "test.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "attrs.h"
+#include "index.h"
+
+#define NUM_OBJECTS 10000
+
+static CK_OBJECT_CLASS certificate = CKO_CERTIFICATE;
+static CK_OBJECT_CLASS data = CKO_DATA;
+
+static struct {
+	p11_index *index;
+	CK_OBJECT_HANDLE handles[NUM_OBJECTS];
+	char ids[NUM_OBJECTS][16];
+	int at;
+} test;
+
+static void
+setup (void *unused)
+{
+	CK_ATTRIBUTE attrs[] = {
+		{ CKA_CLASS, &certificate, sizeof (certificate) },
+		{ CKA_ID, NULL, 0 },
+		{ CKA_LABEL, "Certificate", 11 },
+		{ CKA_VALUE, NULL, 0 },
+		{ CKA_INVALID },
+	};
+
+	CK_RV rv;
+	int i;
+
+	test.index = p11_index_new (NULL, NULL, NULL, NULL, NULL);
+	assert_ptr_not_null (test.index);
+
+	p11_index_load (test.index);
+	for (i = 0; i < NUM_OBJECTS; i++) {
+		snprintf (test.ids[i], sizeof (test.ids[i]), "id-%07d", i);
+		attrs[1].pValue = test.ids[i];
+		attrs[1].ulValueLen = strlen (test.ids[i]);
+		attrs[3].pValue = test.ids[i];
+		attrs[3].ulValueLen = attrs[1].ulValueLen;
+		rv = p11_index_add (test.index, attrs, 4, test.handles + i);
+		assert_num_eq (CKR_OK, rv);
+	}
+	p11_index_finish (test.index);
+
+	test.at = 0;
+}
+
+static void
+teardown (void *unused)
+{
+	p11_index_free (test.index);
+	memset (&test, 0, sizeof (test));
+}
+
+static void
+bench_find_indexed (void *unused)
+{
+	CK_ATTRIBUTE match[] = {
+		{ CKA_CLASS, &certificate, sizeof (certificate) },
+		{ CKA_ID, test.ids[test.at], strlen (test.ids[test.at]) },
+		{ CKA_INVALID },
+	};
+
+	CK_OBJECT_HANDLE handle;
+
+	handle = p11_index_find (test.index, match, -1);
+	assert (handle == test.handles[test.at]);
+	test.at = (test.at + 1) % NUM_OBJECTS;
+}
+
+static void
+bench_find_missing (void *unused)
+{
+	CK_ATTRIBUTE match[] = {
+		{ CKA_CLASS, &data, sizeof (data) },
+		{ CKA_ID, test.ids[test.at], strlen (test.ids[test.at]) },
+		{ CKA_INVALID },
+	};
+
+	CK_OBJECT_HANDLE handle;
+
+	handle = p11_index_find (test.index, match, -1);
+	assert (handle == 0);
+	test.at = (test.at + 1) % NUM_OBJECTS;
+}
+
+static void
+bench_lookup (void *unused)
+{
+	CK_ATTRIBUTE *attrs;
+
+	attrs = p11_index_lookup (test.index, test.handles[test.at]);
+	assert_ptr_not_null (attrs);
+	test.at = (test.at + 1) % NUM_OBJECTS;
+}
+
+static void
+bench_add_remove (void *unused)
+{
+	CK_ATTRIBUTE attrs[] = {
+		{ CKA_CLASS, &data, sizeof (data) },
+		{ CKA_ID, test.ids[test.at], strlen (test.ids[test.at]) },
+		{ CKA_LABEL, "Data", 4 },
+		{ CKA_INVALID },
+	};
+
+	CK_OBJECT_HANDLE handle;
+	CK_RV rv;
+
+	rv = p11_index_add (test.index, attrs, 3, &handle);
+	assert (rv == CKR_OK);
+	rv = p11_index_remove (test.index, handle);
+	assert (rv == CKR_OK);
+	test.at = (test.at + 1) % NUM_OBJECTS;
+}
+
+int
+main (int argc,
+      char *argv[])
+{
+	p11_fixture (setup, teardown);
+	p11_bench (bench_find_indexed, NULL, "/index/find-indexed");
+	p11_bench (bench_find_missing, NULL, "/index/find-missing");
+	p11_bench (bench_lookup, NULL, "/index/lookup");
+	p11_bench (bench_add_remove, NULL, "/index/add-remove");
+
+	return p11_test_run (argc, argv);
+}
@@ -0,0 +1,144 @@
+/*
+ * Copyright (c) 2016 Red Hat Inc
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *     * Redistributions of source code must retain the above
+ *       copyright notice, this list of conditions and the
+ *       following disclaimer.
+ *     * Redistributions in binary form must reproduce the
+ *       above copyright notice, this list of conditions and
+ *       the following disclaimer in the documentation and/or
+ *       other materials provided with the distribution.
+ *     * The names of contributors to this software may not be
+ *       used to endorse or promote products derived from this
+ *       software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+#include "config.h"
+#include "test.h"
+#include "test-trust.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "base64.h"
+#include "buffer.h"
+#include "compat.h"
+#include "pem.h"
+
+static struct {
+	p11_buffer pem;
+	char *base64;
+	size_t base64_len;
+	unsigned char *decoded;
+	char *encoded;
+} test;
+
+static void
+setup (void *unused)
+{
+	int ret;
+
+	if (!p11_buffer_init_null (&test.pem, 0) ||
+	    !p11_pem_write (test_cacert3_ca_der, sizeof (test_cacert3_ca_der), "CERTIFICATE", &test.pem))
+		assert_not_reached ();
+
+	test.encoded = malloc (sizeof (test_cacert3_ca_der) * 2);
+	test.decoded = malloc (sizeof (test_cacert3_ca_der) + 3);
+	assert_ptr_not_null (test.encoded);
+	assert_ptr_not_null (test.decoded);
+
+	ret = p11_b64_ntop (test_cacert3_ca_der, sizeof (test_cacert3_ca_der),
+	                    test.encoded, sizeof (test_cacert3_ca_der) * 2, 0);
+	assert (ret > 0);
+	test.base64 = strdup (test.encoded);
+	test.base64_len = ret;
+}
+
+static void
+teardown (void *unused)
+{
+	p11_buffer_uninit (&test.pem);
+	free (test.base64);
+	free (test.decoded);
+	free (test.encoded);
+	memset (&test, 0, sizeof (test));
+}
+
+static void
+on_parse_pem (const char *type,
+              const unsigned char *contents,
+              size_t length,
+              void *user_data)
+{
+	assert_num_eq (sizeof (test_cacert3_ca_der), length);
+}
+
+static void
+bench_pem_parse (void *unused)
+{
+	unsigned int count;
+
+	count = p11_pem_parse (test.pem.data, test.pem.len, on_parse_pem, NULL);
+	assert_num_eq (1, count);
+}
+
+static void
+bench_pem_write (void *unused)
+{
+	p11_buffer buf;
+
+	if (!p11_buffer_init_null (&buf, 0) ||
+	    !p11_pem_write (test_cacert3_ca_der, sizeof (test_cacert3_ca_der), "CERTIFICATE", &buf))
+		assert_not_reached ();
+	assert_num_eq (test.pem.len, buf.len);
+	p11_buffer_uninit (&buf);
+}
+
+static void
+bench_b64_pton (void *unused)
+{
+	int ret;
+
+	ret = p11_b64_pton (test.base64, test.base64_len, test.decoded, sizeof (test_cacert3_ca_der) + 3);
+	assert_num_eq (sizeof (test_cacert3_ca_der), ret);
+}
+
+static void
+bench_b64_ntop (void *unused)
+{
+	int ret;
+
+	ret = p11_b64_ntop (test_cacert3_ca_der, sizeof (test_cacert3_ca_der),
+	                    test.encoded, sizeof (test_cacert3_ca_der) * 2, 0);
+	assert_num_eq (test.base64_len, ret);
+}
+
+int
+main (int argc,
+      char *argv[])
+{
+	p11_fixture (setup, teardown);
+	p11_bench (bench_pem_parse, NULL, "/pem/parse");
+	p11_bench (bench_pem_write, NULL, "/pem/write");
+	p11_bench (bench_b64_pton, NULL, "/base64/pton");
+	p11_bench (bench_b64_ntop, NULL, "/base64/ntop");
+
+	return p11_test_run (argc, argv);
+}
@@ -0,0 +1,158 @@
+/*
+ * Copyright (c) 2016 Red Hat Inc
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *     * Redistributions of source code must retain the above
+ *       copyright notice, this list of conditions and the
+ *       following disclaimer.
+ *     * Redistributions in binary form must reproduce the
+ *       above copyright notice, this list of conditions and
+ *       the following disclaimer in the documentation and/or
+ *       other materials provided with the distribution.
+ *     * The names of contributors to this software may not be
+ *       used to endorse or promote products derived from this
+ *       software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+#include "config.h"
+#include "test.h"
+#include "test-trust.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "array.h"
+#include "attrs.h"
+#include "buffer.h"
+#include "compat.h"
+#include "lexer.h"
+#include "persist.h"
+#include "pkcs11x.h"
+
+#define NUM_OBJECTS 64
+
+static struct {
+	p11_persist *persist;
+	p11_buffer input;
+	int tokens;
+} test;
+
+static void
+setup (void *unused)
+{
+	CK_OBJECT_CLASS certificate = CKO_CERTIFICATE;
+	CK_OBJECT_CLASS data = CKO_DATA;
+	CK_CERTIFICATE_TYPE x509 = CKC_X_509;
+	CK_BBOOL truev = CK_TRUE;
+	CK_ATTRIBUTE *attrs;
+	p11_lexer lexer;
+	char label[32];
+	int i;
+
+	test.persist = p11_persist_new ();
+	assert_ptr_not_null (test.persist);
+
+	if (!p11_buffer_init_null (&test.input, 0))
+		assert_not_reached ();
+
+	/* A mix of certificates and small data objects, like a trust store */
+	for (i = 0; i < NUM_OBJECTS; i++) {
+		snprintf (label, sizeof (label), "Object %d", i);
+		if (i % 4 == 0) {
+			attrs = p11_attrs_build (NULL,
+			                         &(CK_ATTRIBUTE){ CKA_CLASS, &certificate, sizeof (certificate) },
+			                         &(CK_ATTRIBUTE){ CKA_CERTIFICATE_TYPE, &x509, sizeof (x509) },
+			                         &(CK_ATTRIBUTE){ CKA_LABEL, label, strlen (label) },
+			                         &(CK_ATTRIBUTE){ CKA_TRUSTED, &truev, sizeof (truev) },
+			                         &(CK_ATTRIBUTE){ CKA_VALUE, (void *)test_cacert3_ca_der,
+			                                          sizeof (test_cacert3_ca_der) },
+			                         NULL);
+		} else {
+			attrs = p11_attrs_build (NULL,
+			                         &(CK_ATTRIBUTE){ CKA_CLASS, &data, sizeof (data) },
+			                         &(CK_ATTRIBUTE){ CKA_LABEL, label, strlen (label) },
+			                         &(CK_ATTRIBUTE){ CKA_APPLICATION, "bench-persist", 13 },
+			                         &(CK_ATTRIBUTE){ CKA_VALUE, "\x01\x02 value \xff", 10 },
+			                         NULL);
+		}
+
+		if (!p11_persist_write (test.persist, attrs, &test.input))
+			assert_not_reached ();
+		p11_attrs_free (attrs);
+	}
+
+	test.tokens = 0;
+	p11_lexer_init (&lexer, "bench", test.input.data, test.input.len);
+	while (p11_lexer_next (&lexer, NULL))
+		test.tokens++;
+	p11_lexer_done (&lexer);
+}
+
+static void
+teardown (void *unused)
+{
+	p11_persist_free (test.persist);
+	p11_buffer_uninit (&test.input);
+	memset (&test, 0, sizeof (test));
+}
+
+static void
+bench_lexer (void *unused)
+{
+	p11_lexer lexer;
+	bool failed = false;
+	int count = 0;
+
+	p11_lexer_init (&lexer, "bench", test.input.data, test.input.len);
+	while (p11_lexer_next (&lexer, &failed))
+		count++;
+	p11_lexer_done (&lexer);
+
+	assert_num_eq (false, failed);
+	assert_num_eq (test.tokens, count);
+}
+
+static void
+bench_read (void *unused)
+{
+	p11_array *objects;
+	bool ret;
+
+	objects = p11_array_new (p11_attrs_free);
+	assert_ptr_not_null (objects);
+
+	ret = p11_persist_read (test.persist, "bench", (const unsigned char *)test.input.data,
+	                        test.input.len, objects);
+	assert_num_eq (true, ret);
+	assert_num_eq (NUM_OBJECTS, objects->num);
+
+	p11_array_free (objects);
+}
+
+int
+main (int argc,
+      char *argv[])
+{
+	p11_fixture (setup, teardown);
+	p11_bench (bench_lexer, NULL, "/persist/lexer");
+	p11_bench (bench_read, NULL, "/persist/read");
+
+	return p11_test_run (argc, argv);
+}
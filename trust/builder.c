@@ -58,6 +58,7 @@
 struct _p11_builder {
 	p11_asn1_cache *asn1_cache;
 	p11_dict *asn1_defs;
+	p11_dict *pending;
 	int flags;
 };
 
@@ -190,6 +191,12 @@ p11_builder_new (int flags)
 	return_val_if_fail (builder->asn1_cache, NULL);
 	builder->asn1_defs = p11_asn1_cache_defs (builder->asn1_cache);
 
+	/* Certificates to update at the end of an index transaction */
+	builder->pending = p11_dict_new (p11_dict_ulongptr_hash,
+	                                 p11_dict_ulongptr_equal,
+	                                 free, NULL);
+	return_val_if_fail (builder->pending != NULL, NULL);
+
 	builder->flags = flags;
 	return builder;
 }
@@ -1149,6 +1156,7 @@ p11_builder_free (p11_builder *builder)
 	return_if_fail (builder != NULL);
 
 	p11_asn1_cache_free (builder->asn1_cache);
+	p11_dict_free (builder->pending);
 	free (builder);
 }
 
@@ -1704,6 +1712,54 @@ replace_trust_and_assertions (p11_builder *builder,
 	p11_array_free (rejects);
 }
 
+static void
+changed_certificate (p11_builder *builder,
+                     p11_index *index,
+                     CK_OBJECT_HANDLE handle)
+{
+	CK_OBJECT_HANDLE *key;
+	CK_ATTRIBUTE *cert;
+
+	/*
+	 * A certificate and its attached extensions often change in the
+	 * same transaction, so wait until the end and update it only once.
+	 */
+	if (p11_index_committing (index)) {
+		if (!p11_dict_get (builder->pending, &handle)) {
+			key = memdup (&handle, sizeof (handle));
+			return_if_fail (key != NULL);
+			if (!p11_dict_set (builder->pending, key, key))
+				return_if_reached ();
+		}
+		return;
+	}
+
+	cert = p11_index_lookup (index, handle);
+	if (cert != NULL)
+		replace_trust_and_assertions (builder, index, cert);
+}
+
+static void
+update_pending (p11_builder *builder,
+                p11_index *index)
+{
+	CK_OBJECT_HANDLE *handle;
+	CK_ATTRIBUTE *cert;
+	p11_dictiter iter;
+
+	p11_index_load (index);
+
+	p11_dict_iterate (builder->pending, &iter);
+	while (p11_dict_next (&iter, (void **)&handle, NULL)) {
+		cert = p11_index_lookup (index, *handle);
+		if (cert != NULL)
+			replace_trust_and_assertions (builder, index, cert);
+	}
+
+	p11_index_finish (index);
+	p11_dict_clear (builder->pending);
+}
+
 static void
 replace_compat_for_cert (p11_builder *builder,
                          p11_index *index,
@@ -1733,14 +1789,12 @@ replace_compat_for_cert (p11_builder *builder,
 			match[0].ulValueLen = value->ulValueLen;
 			handle = p11_index_find (index, match, -1);
 		}
-		if (handle != 0)
-			attrs = p11_index_lookup (index, handle);
 	}
 
 	if (handle == 0)
 		remove_trust_and_assertions (builder, index, attrs);
 	else
-		replace_trust_and_assertions (builder, index, attrs);
+		changed_certificate (builder, index, handle);
 }
 
 static void
@@ -1759,10 +1813,8 @@ replace_compat_for_ext (p11_builder *builder,
 		return;
 
 	handles = lookup_related (index, CKO_CERTIFICATE, public_key);
-	for (i = 0; handles && handles[i] != 0; i++) {
-		attrs = p11_index_lookup (index, handles[i]);
-		replace_trust_and_assertions (builder, index, attrs);
-	}
+	for (i = 0; handles && handles[i] != 0; i++)
+		changed_certificate (builder, index, handles[i]);
 	free (handles);
 }
 
@@ -1793,12 +1845,15 @@ update_related_category (p11_builder *builder,
 	handles = lookup_related (index, CKO_CERTIFICATE, public_key);
 
 	for (i = 0; handles && handles[i] != 0; i++) {
-		cert = p11_index_lookup (index, handle);
+		cert = p11_index_lookup (index, handles[i]);
 
 		if (calc_certificate_category (builder, index, cert, public_key, &categoryv)) {
 			update = p11_attrs_build (NULL, &category, NULL);
 			rv = p11_index_update (index, handles[i], update);
 			return_if_fail (rv == CKR_OK);
+
+			/* Whether it's an authority affects the trust objects */
+			changed_certificate (builder, index, handles[i]);
 		}
 	}
 
@@ -1846,7 +1901,12 @@ p11_builder_changed (void *bilder,
 
 	return_if_fail (builder != NULL);
 	return_if_fail (index != NULL);
-	return_if_fail (attrs != NULL);
+
+	/* The end of an index transaction */
+	if (attrs == NULL) {
+		update_pending (builder, index);
+		return;
+	}
 
 	/*
 	 * Treat these operations as loading, not modifying/creating, so we get
@@ -32,11 +32,13 @@
 
 #include "config.h"
 
+#include "debug.h"
 #include "digest.h"
 
 #include <assert.h>
 #include <stdarg.h>
 #include <stdint.h>
+#include <stdlib.h>
 #include <string.h>
 
 #ifdef WITH_FREEBL
@@ -77,10 +79,14 @@ void NSSLOWHASH_Destroy(NSSLOWHASHContext *context);
 
 #define SHA1_BLOCK_LENGTH 64U
 
+typedef void (* sha1_transform_func) (uint32_t state[5],
+                                      const unsigned char buffer[64]);
+
 typedef struct {
 	uint32_t state[5];
 	uint32_t count[2];
 	unsigned char buffer[SHA1_BLOCK_LENGTH];
+	sha1_transform_func transform;
 } sha1_t;
 
 #define rol(value, bits) (((value) << (bits)) | ((value) >> (32 - (bits))))
@@ -192,6 +198,172 @@ transform_sha1 (uint32_t state[5],
 }
 
 
+/*
+ * The SHA-1 instructions on x86 and ARMv8 are used when available. Each of
+ * these processes the 80 rounds in 20 groups of four rounds, while
+ * expanding the message schedule four words at a time.
+ */
+
+#ifdef WITH_SHA_NI
+
+#include <cpuid.h>
+#include <immintrin.h>
+
+#define SHA_NI_ROUNDS(g) \
+	if (g > 0) \
+		e[g % 2] = _mm_sha1nexte_epu32 (e[g % 2], msg[g % 4]); \
+	e[(g + 1) % 2] = abcd; \
+	if (g >= 3 && g <= 18) \
+		msg[(g + 1) % 4] = _mm_sha1msg2_epu32 (msg[(g + 1) % 4], msg[g % 4]); \
+	abcd = _mm_sha1rnds4_epu32 (abcd, e[g % 2], g / 5); \
+	if (g >= 1 && g <= 16) \
+		msg[(g + 3) % 4] = _mm_sha1msg1_epu32 (msg[(g + 3) % 4], msg[g % 4]); \
+	if (g >= 2 && g <= 17) \
+		msg[(g + 2) % 4] = _mm_xor_si128 (msg[(g + 2) % 4], msg[g % 4]);
+
+__attribute__((target ("sha,sse4.1")))
+static void
+transform_sha1_hw (uint32_t state[5],
+                   const unsigned char buffer[64])
+{
+	const __m128i swap = _mm_set_epi64x (0x0001020304050607ULL, 0x08090a0b0c0d0e0fULL);
+	__m128i abcd, abcd_saved, e_saved;
+	__m128i msg[4];
+	__m128i e[2];
+	int i;
+
+	abcd = _mm_shuffle_epi32 (_mm_loadu_si128 ((const __m128i *)state), 0x1B);
+	e[0] = _mm_set_epi32 (state[4], 0, 0, 0);
+
+	abcd_saved = abcd;
+	e_saved = e[0];
+
+	for (i = 0; i < 4; i++)
+		msg[i] = _mm_shuffle_epi8 (_mm_loadu_si128 ((const __m128i *)(buffer + i * 16)), swap);
+
+	e[0] = _mm_add_epi32 (e[0], msg[0]);
+
+	SHA_NI_ROUNDS (0);  SHA_NI_ROUNDS (1);  SHA_NI_ROUNDS (2);  SHA_NI_ROUNDS (3);
+	SHA_NI_ROUNDS (4);  SHA_NI_ROUNDS (5);  SHA_NI_ROUNDS (6);  SHA_NI_ROUNDS (7);
+	SHA_NI_ROUNDS (8);  SHA_NI_ROUNDS (9);  SHA_NI_ROUNDS (10); SHA_NI_ROUNDS (11);
+	SHA_NI_ROUNDS (12); SHA_NI_ROUNDS (13); SHA_NI_ROUNDS (14); SHA_NI_ROUNDS (15);
+	SHA_NI_ROUNDS (16); SHA_NI_ROUNDS (17); SHA_NI_ROUNDS (18); SHA_NI_ROUNDS (19);
+
+	e[0] = _mm_sha1nexte_epu32 (e[0], e_saved);
+	abcd = _mm_add_epi32 (abcd, abcd_saved);
+
+	_mm_storeu_si128 ((__m128i *)state, _mm_shuffle_epi32 (abcd, 0x1B));
+	state[4] = _mm_extract_epi32 (e[0], 3);
+}
+
+static bool
+have_sha1_hw (void)
+{
+	unsigned int eax, ebx, ecx, edx;
+
+	/* We need SSSE3 and SSE4.1 along with the SHA extensions */
+	if (!__get_cpuid (1, &eax, &ebx, &ecx, &edx))
+		return false;
+	if (!(ecx & bit_SSSE3) || !(ecx & bit_SSE4_1))
+		return false;
+
+	if (__get_cpuid_max (0, NULL) < 7)
+		return false;
+
+	/* The SHA extensions are bit 29 of EBX in leaf 7 */
+	__cpuid_count (7, 0, eax, ebx, ecx, edx);
+	return (ebx & (1 << 29)) != 0;
+}
+
+#define WITH_SHA1_HW 1
+
+#elif defined (__aarch64__) && defined (__ARM_FEATURE_CRYPTO)
+
+#include <arm_neon.h>
+
+#define ARMV8_ROUNDS(g, func) \
+	e[(g + 1) % 2] = vsha1h_u32 (vgetq_lane_u32 (abcd, 0)); \
+	abcd = func (abcd, e[g % 2], tmp[g % 2]); \
+	if (g < 18) \
+		tmp[g % 2] = vaddq_u32 (msg[(g + 2) % 4], vdupq_n_u32 (k[(g + 2) / 5])); \
+	if (g >= 1 && g <= 16) \
+		msg[(g + 3) % 4] = vsha1su1q_u32 (msg[(g + 3) % 4], msg[(g + 2) % 4]); \
+	if (g <= 15) \
+		msg[g % 4] = vsha1su0q_u32 (msg[g % 4], msg[(g + 1) % 4], msg[(g + 2) % 4]);
+
+static void
+transform_sha1_hw (uint32_t state[5],
+                   const unsigned char buffer[64])
+{
+	static const uint32_t k[] = { 0x5A827999, 0x6ED9EBA1, 0x8F1BBCDC, 0xCA62C1D6 };
+	uint32x4_t abcd, abcd_saved;
+	uint32x4_t msg[4];
+	uint32x4_t tmp[2];
+	uint32_t e[2];
+	uint32_t e_saved;
+	int i;
+
+	abcd = vld1q_u32 (state);
+	e[0] = state[4];
+
+	abcd_saved = abcd;
+	e_saved = e[0];
+
+	for (i = 0; i < 4; i++)
+		msg[i] = vreinterpretq_u32_u8 (vrev32q_u8 (vld1q_u8 (buffer + i * 16)));
+
+	tmp[0] = vaddq_u32 (msg[0], vdupq_n_u32 (k[0]));
+	tmp[1] = vaddq_u32 (msg[1], vdupq_n_u32 (k[0]));
+
+	ARMV8_ROUNDS (0, vsha1cq_u32);  ARMV8_ROUNDS (1, vsha1cq_u32);
+	ARMV8_ROUNDS (2, vsha1cq_u32);  ARMV8_ROUNDS (3, vsha1cq_u32);
+	ARMV8_ROUNDS (4, vsha1cq_u32);  ARMV8_ROUNDS (5, vsha1pq_u32);
+	ARMV8_ROUNDS (6, vsha1pq_u32);  ARMV8_ROUNDS (7, vsha1pq_u32);
+	ARMV8_ROUNDS (8, vsha1pq_u32);  ARMV8_ROUNDS (9, vsha1pq_u32);
+	ARMV8_ROUNDS (10, vsha1mq_u32); ARMV8_ROUNDS (11, vsha1mq_u32);
+	ARMV8_ROUNDS (12, vsha1mq_u32); ARMV8_ROUNDS (13, vsha1mq_u32);
+	ARMV8_ROUNDS (14, vsha1mq_u32); ARMV8_ROUNDS (15, vsha1pq_u32);
+	ARMV8_ROUNDS (16, vsha1pq_u32); ARMV8_ROUNDS (17, vsha1pq_u32);
+	ARMV8_ROUNDS (18, vsha1pq_u32); ARMV8_ROUNDS (19, vsha1pq_u32);
+
+	vst1q_u32 (state, vaddq_u32 (abcd, abcd_saved));
+	state[4] = e[0] + e_saved;
+}
+
+static bool
+have_sha1_hw (void)
+{
+	/* Built for a CPU with the crypto extensions */
+	return true;
+}
+
+#define WITH_SHA1_HW 1
+
+#endif /* __aarch64__ && __ARM_FEATURE_CRYPTO */
+
+/* Overridden in tests, so the portable code runs on any machine */
+bool p11_digest_no_hardware = false;
+
+static sha1_transform_func
+lookup_sha1_transform (void)
+{
+	static sha1_transform_func transform = NULL;
+
+	if (p11_digest_no_hardware)
+		return transform_sha1;
+
+	if (transform == NULL) {
+#ifdef WITH_SHA1_HW
+		if (have_sha1_hw ())
+			transform = transform_sha1_hw;
+		else
+#endif
+			transform = transform_sha1;
+	}
+
+	return transform;
+}
+
 /*!
  * isc_sha1_init - Initialize new context
  */
@@ -208,6 +380,7 @@ sha1_init (sha1_t *context)
 	context->state[4] = 0xC3D2E1F0;
 	context->count[0] = 0;
 	context->count[1] = 0;
+	context->transform = lookup_sha1_transform ();
 }
 
 static void
@@ -235,9 +408,9 @@ sha1_update(sha1_t *context,
 	j = (j >> 3) & 63;
 	if ((j + len) > 63) {
 		(void)memcpy(&context->buffer[j], data, (i = 64 - j));
-		transform_sha1 (context->state, context->buffer);
+		(context->transform) (context->state, context->buffer);
 		for (; i + 63 < len; i += 64)
-			transform_sha1 (context->state, &data[i]);
+			(context->transform) (context->state, &data[i]);
 		j = 0;
 	} else {
 		i = 0;
@@ -251,14 +424,14 @@ sha1_update(sha1_t *context,
  * Add padding and return the message digest.
  */
 
-static const unsigned char final_200 = 128;
-static const unsigned char final_0 = 0;
+static const unsigned char final_pad[64] = { 128, 0, };
 
 static void
 sha1_final (sha1_t *context,
             unsigned char *digest)
 {
 	unsigned int i;
+	unsigned int used;
 	unsigned char finalcount[8];
 
 	assert (digest != 0);
@@ -271,9 +444,9 @@ sha1_final (sha1_t *context,
 			  >> ((3 - (i & 3)) * 8)) & 255);
 	}
 
-	sha1_update(context, &final_200, 1);
-	while ((context->count[0] & 504) != 448)
-		sha1_update(context, &final_0, 1);
+	/* Pad with a single 1 bit and zeros, up to 56 bytes into a block */
+	used = (context->count[0] >> 3) & 63;
+	sha1_update(context, final_pad, used < 56 ? 56 - used : 120 - used);
 	/* The next Update should cause a transform_sha1() */
 	sha1_update(context, finalcount, 8);
 
@@ -354,6 +527,81 @@ p11_digest_sha1 (unsigned char *hash,
 	sha1_invalidate (&sha1);
 }
 
+struct _p11_digest {
+#ifdef WITH_FREEBL
+	NSSLOWHASHContext *nss;
+#endif
+	sha1_t sha1;
+};
+
+p11_digest *
+p11_digest_new_sha1 (void)
+{
+	p11_digest *digest;
+
+	digest = calloc (1, sizeof (p11_digest));
+	return_val_if_fail (digest != NULL, NULL);
+
+#ifdef WITH_FREEBL
+	digest->nss = NSSLOWHASH_NewContext (NSSLOW_Init (), HASH_AlgSHA1);
+	if (digest->nss) {
+		NSSLOWHASH_Begin (digest->nss);
+		return digest;
+	}
+#endif
+
+	sha1_init (&digest->sha1);
+	return digest;
+}
+
+void
+p11_digest_update (p11_digest *digest,
+                   const void *input,
+                   size_t length)
+{
+	const unsigned char *data = input;
+	unsigned int chunk;
+
+	return_if_fail (digest != NULL);
+
+	while (length > 0) {
+		chunk = length > 0x10000000 ? 0x10000000 : length;
+#ifdef WITH_FREEBL
+		if (digest->nss)
+			NSSLOWHASH_Update (digest->nss, data, chunk);
+		else
+#endif
+		sha1_update (&digest->sha1, data, chunk);
+		data += chunk;
+		length -= chunk;
+	}
+}
+
+void
+p11_digest_finish (p11_digest *digest,
+                   unsigned char *hash)
+{
+#ifdef WITH_FREEBL
+	unsigned int len;
+#endif
+
+	return_if_fail (digest != NULL);
+
+#ifdef WITH_FREEBL
+	if (digest->nss) {
+		NSSLOWHASH_End (digest->nss, hash, &len, P11_DIGEST_SHA1_LEN);
+		assert (len == P11_DIGEST_SHA1_LEN);
+		NSSLOWHASH_Destroy (digest->nss);
+		free (digest);
+		return;
+	}
+#endif
+
+	sha1_final (&digest->sha1, hash);
+	sha1_invalidate (&digest->sha1);
+	free (digest);
+}
+
 
 /*! \file
  * This code implements the MD5 message-digest algorithm.
@@ -630,3 +878,275 @@ p11_digest_md5 (unsigned char *hash,
 	md5_final (&md5, hash);
 	md5_invalidate (&md5);
 }
+
+/*
+ * The multi-buffer digests below hash several independent inputs at
+ * once, one in each lane of a vector. When a lane finishes its input it
+ * picks up the next one, so inputs of different length keep all lanes
+ * busy. This is what we want when hashing lots of short things, such as
+ * certificate subjects.
+ */
+
+#if !defined (WITH_FREEBL) && defined (__GNUC__) && \
+    (defined (__SSE2__) || defined (__ARM_NEON))
+
+#define DIGEST_LANES 4
+
+typedef uint32_t lanes_t __attribute__ ((vector_size (DIGEST_LANES * sizeof (uint32_t))));
+
+typedef void (* transform_lanes_func) (lanes_t *state,
+                                       lanes_t *in);
+
+#define rol_lanes(value, bits) (((value) << (bits)) | ((value) >> (32 - (bits))))
+
+static void
+transform_sha1_lanes (lanes_t *state,
+                      lanes_t *w)
+{
+	lanes_t a, b, c, d, e, t;
+	int i;
+
+	a = state[0];
+	b = state[1];
+	c = state[2];
+	d = state[3];
+	e = state[4];
+
+#define SHA1_LANES_ROUND(i, f, k) \
+	if (i >= 16) \
+		w[i & 15] = rol_lanes (w[(i + 13) & 15] ^ w[(i + 8) & 15] ^ \
+		                       w[(i + 2) & 15] ^ w[i & 15], 1); \
+	t = rol_lanes (a, 5) + (f) + e + k + w[i & 15]; \
+	e = d; d = c; c = rol_lanes (b, 30); b = a; a = t;
+
+	for (i = 0; i < 20; i++) {
+		SHA1_LANES_ROUND (i, (b & (c ^ d)) ^ d, 0x5A827999);
+	}
+	for (; i < 40; i++) {
+		SHA1_LANES_ROUND (i, b ^ c ^ d, 0x6ED9EBA1);
+	}
+	for (; i < 60; i++) {
+		SHA1_LANES_ROUND (i, ((b | c) & d) | (b & c), 0x8F1BBCDC);
+	}
+	for (; i < 80; i++) {
+		SHA1_LANES_ROUND (i, b ^ c ^ d, 0xCA62C1D6);
+	}
+
+#undef SHA1_LANES_ROUND
+
+	state[0] += a;
+	state[1] += b;
+	state[2] += c;
+	state[3] += d;
+	state[4] += e;
+}
+
+static const uint32_t md5_constants[64] = {
+	0xd76aa478, 0xe8c7b756, 0x242070db, 0xc1bdceee, 0xf57c0faf, 0x4787c62a, 0xa8304613, 0xfd469501,
+	0x698098d8, 0x8b44f7af, 0xffff5bb1, 0x895cd7be, 0x6b901122, 0xfd987193, 0xa679438e, 0x49b40821,
+	0xf61e2562, 0xc040b340, 0x265e5a51, 0xe9b6c7aa, 0xd62f105d, 0x02441453, 0xd8a1e681, 0xe7d3fbc8,
+	0x21e1cde6, 0xc33707d6, 0xf4d50d87, 0x455a14ed, 0xa9e3e905, 0xfcefa3f8, 0x676f02d9, 0x8d2a4c8a,
+	0xfffa3942, 0x8771f681, 0x6d9d6122, 0xfde5380c, 0xa4beea44, 0x4bdecfa9, 0xf6bb4b60, 0xbebfbc70,
+	0x289b7ec6, 0xeaa127fa, 0xd4ef3085, 0x04881d05, 0xd9d4d039, 0xe6db99e5, 0x1fa27cf8, 0xc4ac5665,
+	0xf4292244, 0x432aff97, 0xab9423a7, 0xfc93a039, 0x655b59c3, 0x8f0ccc92, 0xffeff47d, 0x85845dd1,
+	0x6fa87e4f, 0xfe2ce6e0, 0xa3014314, 0x4e0811a1, 0xf7537e82, 0xbd3af235, 0x2ad7d2bb, 0xeb86d391,
+};
+
+static const int md5_shifts[16] = {
+	7, 12, 17, 22, 5, 9, 14, 20, 4, 11, 16, 23, 6, 10, 15, 21,
+};
+
+static void
+transform_md5_lanes (lanes_t *buf,
+                     lanes_t *in)
+{
+	lanes_t a, b, c, d, t;
+	int i;
+
+	a = buf[0];
+	b = buf[1];
+	c = buf[2];
+	d = buf[3];
+
+#define MD5_LANES_STEP(i, f, x) \
+	t = a + (f) + in[x] + md5_constants[i]; \
+	a = d; d = c; c = b; \
+	b += rol_lanes (t, md5_shifts[(i / 16) * 4 + (i & 3)]);
+
+	for (i = 0; i < 16; i++) {
+		MD5_LANES_STEP (i, F1 (b, c, d), i);
+	}
+	for (; i < 32; i++) {
+		MD5_LANES_STEP (i, F2 (b, c, d), (5 * i + 1) & 15);
+	}
+	for (; i < 48; i++) {
+		MD5_LANES_STEP (i, F3 (b, c, d), (3 * i + 5) & 15);
+	}
+	for (; i < 64; i++) {
+		MD5_LANES_STEP (i, F4 (b, c, d), (7 * i) & 15);
+	}
+
+#undef MD5_LANES_STEP
+
+	buf[0] += a;
+	buf[1] += b;
+	buf[2] += c;
+	buf[3] += d;
+}
+
+static size_t
+padded_blocks (size_t length)
+{
+	/* Room for at least the 0x80 byte and the 64-bit length */
+	return (length + 8) / 64 + 1;
+}
+
+static void
+padded_block (const unsigned char *input,
+              size_t length,
+              size_t block,
+              bool big_endian,
+              uint32_t words[16])
+{
+	unsigned char *data = (unsigned char *)words;
+	size_t offset = block * 64;
+	uint64_t bits;
+	int i;
+
+	if (offset + 64 <= length) {
+		memcpy (data, input + offset, 64);
+	} else {
+		memset (data, 0, 64);
+		if (offset < length)
+			memcpy (data, input + offset, length - offset);
+		if (length >= offset)
+			data[length - offset] = 0x80;
+
+		if (block + 1 == padded_blocks (length)) {
+			bits = (uint64_t)length << 3;
+			for (i = 0; i < 8; i++)
+				data[big_endian ? 63 - i : 56 + i] = (bits >> (i * 8)) & 0xff;
+		}
+	}
+
+#ifdef WORDS_BIGENDIAN
+	if (!big_endian) {
+#else
+	if (big_endian) {
+#endif
+		for (i = 0; i < 16; i++)
+			words[i] = __builtin_bswap32 (words[i]);
+	}
+}
+
+static void
+digest_lanes (p11_digest_input *inputs,
+              size_t count,
+              const uint32_t *initial,
+              int n_words,
+              bool big_endian,
+              transform_lanes_func transform)
+{
+	p11_digest_input *input[DIGEST_LANES];
+	size_t blocks[DIGEST_LANES];
+	size_t block[DIGEST_LANES];
+	uint32_t words[16];
+	lanes_t state[5];
+	lanes_t in[16];
+	size_t next = 0;
+	int active;
+	uint32_t value;
+	int lane;
+	int i;
+
+	active = 0;
+	for (lane = 0; lane < DIGEST_LANES; lane++) {
+		input[lane] = next < count ? inputs + next++ : NULL;
+		if (input[lane] == NULL)
+			continue;
+		blocks[lane] = padded_blocks (input[lane]->length);
+		block[lane] = 0;
+		for (i = 0; i < n_words; i++)
+			state[i][lane] = initial[i];
+		active++;
+	}
+
+	while (active > 0) {
+		for (lane = 0; lane < DIGEST_LANES; lane++) {
+			if (input[lane] == NULL)
+				memset (words, 0, sizeof (words));
+			else
+				padded_block (input[lane]->input, input[lane]->length,
+				              block[lane], big_endian, words);
+			for (i = 0; i < 16; i++)
+				in[i][lane] = words[i];
+		}
+
+		(transform) (state, in);
+
+		for (lane = 0; lane < DIGEST_LANES; lane++) {
+			if (input[lane] == NULL || ++block[lane] < blocks[lane])
+				continue;
+
+			for (i = 0; i < n_words * 4; i++) {
+				value = state[i / 4][lane];
+				input[lane]->hash[i] = value >> ((big_endian ? 3 - (i & 3) : (i & 3)) * 8);
+			}
+
+			/* This lane moves on to the next input */
+			input[lane] = next < count ? inputs + next++ : NULL;
+			if (input[lane] == NULL) {
+				active--;
+				continue;
+			}
+			blocks[lane] = padded_blocks (input[lane]->length);
+			block[lane] = 0;
+			for (i = 0; i < n_words; i++)
+				state[i][lane] = initial[i];
+		}
+	}
+}
+
+#define WITH_DIGEST_LANES 1
+
+#endif /* !WITH_FREEBL && __GNUC__ && (__SSE2__ || __ARM_NEON) */
+
+void
+p11_digest_sha1_multi (p11_digest_input *inputs,
+                       size_t count)
+{
+	size_t i;
+
+#ifdef WITH_DIGEST_LANES
+	static const uint32_t initial[] = {
+		0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0
+	};
+
+	/* The SHA-1 instructions beat hashing several inputs in parallel */
+	if (lookup_sha1_transform () == transform_sha1) {
+		digest_lanes (inputs, count, initial, 5, true, transform_sha1_lanes);
+		return;
+	}
+#endif
+
+	for (i = 0; i < count; i++)
+		p11_digest_sha1 (inputs[i].hash, inputs[i].input, inputs[i].length, NULL);
+}
+
+void
+p11_digest_md5_multi (p11_digest_input *inputs,
+                      size_t count)
+{
+#ifdef WITH_DIGEST_LANES
+	static const uint32_t initial[] = {
+		0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476
+	};
+
+	digest_lanes (inputs, count, initial, 4, false, transform_md5_lanes);
+#else
+	size_t i;
+
+	for (i = 0; i < count; i++)
+		p11_digest_md5 (inputs[i].hash, inputs[i].input, inputs[i].length, NULL);
+#endif
+}
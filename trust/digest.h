@@ -57,4 +57,30 @@ void     p11_digest_sha1    (unsigned char *hash,
                              size_t length,
                              ...) GNUC_NULL_TERMINATED;
 
+/* For input that doesn't fit in memory at once */
+typedef struct _p11_digest p11_digest;
+
+p11_digest *  p11_digest_new_sha1  (void);
+
+void          p11_digest_update    (p11_digest *digest,
+                                    const void *input,
+                                    size_t length);
+
+void          p11_digest_finish    (p11_digest *digest,
+                                    unsigned char *hash);
+
+typedef struct {
+	const void *input;
+	size_t length;
+	unsigned char *hash;
+} p11_digest_input;
+
+void     p11_digest_md5_multi   (p11_digest_input *inputs,
+                                 size_t count);
+
+void     p11_digest_sha1_multi  (p11_digest_input *inputs,
+                                 size_t count);
+
+extern bool p11_digest_no_hardware;
+
 #endif /* P11_DIGEST_H_ */
@@ -523,6 +523,8 @@ p11_enumerate_cleanup (p11_enumerate *ex)
 	ex->blacklist_public_key = NULL;
 	p11_dict_free (ex->blacklist_issuer_serial);
 	ex->blacklist_issuer_serial = NULL;
+	p11_dict_free (ex->subjects);
+	ex->subjects = NULL;
 
 	p11_dict_free (ex->asn1_defs);
 	ex->asn1_defs = NULL;
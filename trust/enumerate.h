@@ -65,6 +65,11 @@ typedef struct {
 	p11_dict *blacklist_issuer_serial;
 	p11_dict *blacklist_public_key;
 
+	/* Raw subject -> canonical subject and hashes, see extract-openssl.c */
+	p11_dict *subjects;
+	unsigned int subjects_hits;
+	unsigned int subjects_misses;
+
 	/*
 	 * Stuff below is parsed info for the current iteration.
 	 * Currently this information is generally all relevant
@@ -204,24 +204,80 @@ add_alias (p11_buffer *buffer,
 		}
 
 		p11_buffer_reset (&buf, 0);
+		convert_alias (input, input_len, &buf);
 	}
 
 	return false;
 }
 
 static bool
-prepare_jks_buffer (p11_enumerate *ex,
-                    p11_buffer *buffer)
+flush_jks_buffer (p11_save_file *file,
+                  p11_buffer *buffer)
+{
+	return_val_if_fail (p11_buffer_ok (buffer), false);
+
+	if (!p11_save_write (file, buffer->data, buffer->len))
+		return false;
+
+	p11_buffer_reset (buffer, P11_EXTRACT_FLUSH_SIZE);
+	return true;
+}
+
+/*
+ * Java keystore reinvents HMAC and uses it to try and "secure" the
+ * cacerts. We fill this in and use the default "changeit" string
+ * as the password for this keyed digest.
+ *
+ * The digest covers the count at the start of the file, which isn't
+ * known until the end. So read back what was written.
+ */
+static bool
+write_jks_digest (p11_save_file *file,
+                  off_t length)
+{
+	unsigned char digest[P11_DIGEST_SHA1_LEN];
+	unsigned char block[P11_EXTRACT_FLUSH_SIZE];
+	p11_digest *sha1;
+	off_t offset;
+	ssize_t res;
+
+	sha1 = p11_digest_new_sha1 ();
+	return_val_if_fail (sha1 != NULL, false);
+
+	p11_digest_update (sha1, "\000c\000h\000a\000n\000g\000e\000i\000t", 16); /* default password */
+	p11_digest_update (sha1, "Mighty Aphrodite", 16); /* go figure */
+
+	for (offset = 0; offset < length; offset += res) {
+		res = p11_save_read_at (file, offset, block,
+		                        length - offset < sizeof (block) ? length - offset : sizeof (block));
+		if (res <= 0) {
+			if (res == 0)
+				p11_message ("couldn't read back file: unexpected end");
+			p11_digest_finish (sha1, digest);
+			return false;
+		}
+		p11_digest_update (sha1, block, res);
+	}
+
+	p11_digest_finish (sha1, digest);
+	return p11_save_write (file, digest, sizeof (digest));
+}
+
+static bool
+write_jks_file (p11_enumerate *ex,
+                p11_save_file *file)
 {
 	const unsigned char magic[] = { 0xfe, 0xed, 0xfe, 0xed };
 	const int version = 2;
+	unsigned char encoded[4];
+	p11_buffer buffer;
 	size_t count_at;
-	unsigned char *digest;
 	CK_ATTRIBUTE *label;
 	p11_dict *aliases;
-	size_t length;
+	off_t length;
 	int64_t now;
 	int count;
+	bool ret;
 	CK_RV rv;
 
 	enum {
@@ -234,10 +290,11 @@ prepare_jks_buffer (p11_enumerate *ex,
 	 * src/share/classes/sun/security/provider/JavaKeyStore.java
 	 */
 
-	p11_buffer_add (buffer, magic, sizeof (magic));
-	add_msb_int (buffer, version);
-	count_at = buffer->len;
-	p11_buffer_append (buffer, 4);
+	p11_buffer_init (&buffer, P11_EXTRACT_FLUSH_SIZE);
+	p11_buffer_add (&buffer, magic, sizeof (magic));
+	add_msb_int (&buffer, version);
+	count_at = buffer.len;
+	add_msb_int (&buffer, 0);
 	count = 0;
 
 	/*
@@ -256,75 +313,76 @@ prepare_jks_buffer (p11_enumerate *ex,
 	aliases = p11_dict_new (p11_dict_str_hash, p11_dict_str_equal, free, NULL);
 	return_val_if_fail (aliases != NULL, false);
 
+	ret = true;
+	length = 0;
+
 	/* For every certificate */
-	while ((rv = p11_kit_iter_next (ex->iter)) == CKR_OK) {
+	while (ret && (rv = p11_kit_iter_next (ex->iter)) == CKR_OK) {
 		count++;
 
 		/* The type of entry */
-		add_msb_int (buffer, trusted_cert);
+		add_msb_int (&buffer, trusted_cert);
 
 		/* The alias */
 		label = p11_attrs_find_valid (ex->attrs, CKA_LABEL);
-		if (!add_alias (buffer, aliases, label)) {
+		if (!add_alias (&buffer, aliases, label)) {
 			p11_message ("could not generate a certificate alias name");
-			p11_dict_free (aliases);
-			return false;
+			ret = false;
+			break;
 		}
 
 		/* The creation date: current time */
-		add_msb_long (buffer, now);
+		add_msb_long (&buffer, now);
 
 		/* The type of the certificate */
-		add_string (buffer, "X.509", 5);
+		add_string (&buffer, "X.509", 5);
 
 		/* The DER encoding of the certificate */
-		add_msb_int (buffer, ex->cert_len);
-		p11_buffer_add (buffer, ex->cert_der, ex->cert_len);
+		add_msb_int (&buffer, ex->cert_len);
+		p11_buffer_add (&buffer, ex->cert_der, ex->cert_len);
+
+		if (buffer.len >= P11_EXTRACT_FLUSH_SIZE) {
+			length += buffer.len;
+			ret = flush_jks_buffer (file, &buffer);
+		}
 	}
 
 	p11_dict_free (aliases);
 
-	if (rv != CKR_OK && rv != CKR_CANCEL) {
+	if (ret && rv != CKR_OK && rv != CKR_CANCEL) {
 		p11_message ("failed to find certificates: %s", p11_kit_strerror (rv));
-		return false;
+		ret = false;
 	}
 
-	/* Place the count in the right place */
-	encode_msb_int ((unsigned char *)buffer->data + count_at, count);
+	if (ret) {
+		length += buffer.len;
+		ret = flush_jks_buffer (file, &buffer);
+	}
 
-	/*
-	 * Java keystore reinvents HMAC and uses it to try and "secure" the
-	 * cacerts. We fill this in and use the default "changeit" string
-	 * as the password for this keyed digest.
-	 */
-	length = buffer->len;
-	digest = p11_buffer_append (buffer, P11_DIGEST_SHA1_LEN);
-	return_val_if_fail (digest != NULL, false);
-	p11_digest_sha1 (digest,
-	                 "\000c\000h\000a\000n\000g\000e\000i\000t", (size_t)16, /* default password */
-	                 "Mighty Aphrodite", (size_t)16, /* go figure */
-	                 buffer->data, length,
-	                 NULL);
+	/* Place the count in the right place */
+	if (ret) {
+		encode_msb_int (encoded, count);
+		ret = p11_save_write_at (file, count_at, encoded, sizeof (encoded)) &&
+		      write_jks_digest (file, length);
+	}
 
-	return_val_if_fail (p11_buffer_ok (buffer), false);
-	return true;
+	p11_buffer_uninit (&buffer);
+	return ret;
 }
 
 bool
 p11_extract_jks_cacerts (p11_enumerate *ex,
                          const char *destination)
 {
-	p11_buffer buffer;
 	p11_save_file *file;
 	bool ret;
 
-	p11_buffer_init (&buffer, 1024 * 10);
-	ret = prepare_jks_buffer (ex, &buffer);
-	if (ret) {
-		file = p11_save_open_file (destination, NULL, ex->flags);
-		ret = p11_save_write_and_finish (file, buffer.data, buffer.len);
-	}
+	file = p11_save_open_file (destination, NULL, ex->flags);
+	if (!file)
+		return false;
 
-	p11_buffer_uninit (&buffer);
+	ret = write_jks_file (ex, file);
+	if (!p11_save_finish_file (file, NULL, ret))
+		ret = false;
 	return ret;
 }
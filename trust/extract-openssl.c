@@ -34,6 +34,8 @@
 
 #include "config.h"
 
+#define P11_DEBUG_FLAG P11_DEBUG_TOOL
+
 #include "asn1.h"
 #include "attrs.h"
 #include "buffer.h"
@@ -331,31 +333,37 @@ p11_extract_openssl_bundle (p11_enumerate *ex,
 		return false;
 
 	first = true;
-	p11_buffer_init (&output, 0);
+	p11_buffer_init (&buf, 1024);
+	p11_buffer_init (&output, P11_EXTRACT_FLUSH_SIZE);
 	while ((rv = p11_kit_iter_next (ex->iter)) == CKR_OK) {
-		p11_buffer_init (&buf, 1024);
-		if (!p11_buffer_reset (&output, 2048))
+		if (!p11_buffer_reset (&buf, 1024))
 			return_val_if_reached (false);
 
 		if (prepare_pem_contents (ex, &buf)) {
-			if (!p11_pem_write (buf.data, buf.len, "TRUSTED CERTIFICATE", &output))
-				return_val_if_reached (false);
-
 			comment = p11_enumerate_comment (ex, first);
 			first = false;
 
-			ret = p11_save_write (file, comment, -1) &&
-			      p11_save_write (file, output.data, output.len);
-
+			if (comment)
+				p11_buffer_add (&output, comment, -1);
 			free (comment);
-		}
 
-		p11_buffer_uninit (&buf);
+			if (!p11_pem_write (buf.data, buf.len, "TRUSTED CERTIFICATE", &output))
+				return_val_if_reached (false);
+		}
 
-		if (!ret)
-			break;
+		/* Don't hold more than a block of certificates in memory */
+		if (output.len >= P11_EXTRACT_FLUSH_SIZE) {
+			ret = p11_save_write (file, output.data, output.len);
+			p11_buffer_reset (&output, P11_EXTRACT_FLUSH_SIZE);
+			if (!ret)
+				break;
+		}
 	}
 
+	if (ret && output.len)
+		ret = p11_save_write (file, output.data, output.len);
+
+	p11_buffer_uninit (&buf);
 	p11_buffer_uninit (&output);
 
 	if (rv != CKR_OK && rv != CKR_CANCEL) {
@@ -525,54 +533,76 @@ p11_openssl_canon_name_der (p11_dict *asn1_defs,
 	return !failed;
 }
 
-#ifdef OS_UNIX
-
-static char *
-symlink_for_subject_hash (p11_enumerate *ex)
-{
-	unsigned char md[P11_DIGEST_SHA1_LEN];
-	p11_buffer der;
-	CK_ATTRIBUTE *subject;
-	unsigned long hash;
-	char *linkname = NULL;
+/*
+ * The OpenSSL style c_rehash stuff
+ *
+ * Different versions of openssl build these hashes differently
+ * so output both of them. Shouldn't cause confusion, because
+ * multiple certificates can hash to the same link anyway,
+ * and this is the reason for the trailing number after the dot.
+ *
+ * The trailing number is incremented p11_save_symlink_in() if it
+ * conflicts with something we've already written out.
+ *
+ * The links are queued up, so that the subjects can be hashed in
+ * batches, and then created in the order they were added. This results
+ * in the same trailing numbers as creating them one by one.
+ *
+ * On Windows no symlinks.
+ */
 
-	subject = p11_attrs_find_valid (ex->attrs, CKA_SUBJECT);
-	if (!subject || !subject->pValue || !subject->ulValueLen)
-		return NULL;
+#define LINKS_BATCH 256
 
-	p11_buffer_init_full (&der, memdup (subject->pValue, subject->ulValueLen),
-	                      subject->ulValueLen, 0, realloc, free);
-	return_val_if_fail (der.data != NULL, NULL);
+/*
+ * Many certificates share the same subject, so the canonical form of a
+ * subject and its hashes are cached by the raw subject DER.
+ */
+typedef struct {
+	CK_ATTRIBUTE raw;
+	p11_buffer canon;
+	bool have_canon;
+	bool hashed;
+	unsigned char hash[P11_DIGEST_SHA1_LEN];
+	unsigned char old_hash[P11_DIGEST_MD5_LEN];
+} openssl_subject;
+
+typedef struct {
+	char *filename;
+	openssl_subject *subject;
+} pending_link;
 
-	if (p11_openssl_canon_name_der (ex->asn1_defs, &der)) {
-		p11_digest_sha1 (md, der.data, der.len, NULL);
+struct _p11_openssl_links {
+	p11_enumerate *ex;
+	p11_save_dir *dir;
+	pending_link pending[LINKS_BATCH];
+	int count;
+	bool failed;
+};
 
-		hash = (
-		        ((unsigned long)md[0]       ) | ((unsigned long)md[1] << 8L) |
-		        ((unsigned long)md[2] << 16L) | ((unsigned long)md[3] << 24L)
-		) & 0xffffffffL;
+p11_openssl_links *
+p11_openssl_links_new (p11_enumerate *ex,
+                       p11_save_dir *dir)
+{
+	p11_openssl_links *links;
 
-		if (asprintf (&linkname, "%08lx", hash) < 0)
-			return_val_if_reached (NULL);
-	}
+	links = calloc (1, sizeof (p11_openssl_links));
+	return_val_if_fail (links != NULL, NULL);
 
-	p11_buffer_uninit (&der);
-	return linkname;
+	links->ex = ex;
+	links->dir = dir;
+	return links;
 }
 
-static char *
-symlink_for_subject_old_hash (p11_enumerate *ex)
+#ifdef OS_UNIX
+
+static bool
+symlink_for_hash (p11_save_dir *dir,
+                  const unsigned char *md,
+                  const char *filename)
 {
-	unsigned char md[P11_DIGEST_MD5_LEN];
-	CK_ATTRIBUTE *subject;
 	unsigned long hash;
 	char *linkname;
-
-	subject = p11_attrs_find_valid (ex->attrs, CKA_SUBJECT);
-	if (!subject)
-		return NULL;
-
-	p11_digest_md5 (md, subject->pValue, (size_t)subject->ulValueLen, NULL);
+	bool ret;
 
 	hash = (
 	         ((unsigned long)md[0]       ) | ((unsigned long)md[1] << 8L) |
@@ -580,50 +610,174 @@ symlink_for_subject_old_hash (p11_enumerate *ex)
 	       ) & 0xffffffffL;
 
 	if (asprintf (&linkname, "%08lx", hash) < 0)
+		return_val_if_reached (false);
+
+	ret = p11_save_symlink_in (dir, linkname, ".0", filename);
+	free (linkname);
+	return ret;
+}
+
+static void
+subject_free (void *data)
+{
+	openssl_subject *subject = data;
+
+	free (subject->raw.pValue);
+	p11_buffer_uninit (&subject->canon);
+	free (subject);
+}
+
+static openssl_subject *
+subject_lookup (p11_enumerate *ex,
+                CK_ATTRIBUTE *raw)
+{
+	openssl_subject *subject;
+
+	if (ex->subjects == NULL) {
+		ex->subjects = p11_dict_new (p11_attr_hash, p11_attr_equal, NULL, subject_free);
+		return_val_if_fail (ex->subjects != NULL, NULL);
+	}
+
+	subject = p11_dict_get (ex->subjects, raw);
+	if (subject != NULL) {
+		ex->subjects_hits++;
+		return subject;
+	}
+
+	ex->subjects_misses++;
+
+	subject = calloc (1, sizeof (openssl_subject));
+	return_val_if_fail (subject != NULL, NULL);
+
+	subject->raw.type = raw->type;
+	subject->raw.ulValueLen = raw->ulValueLen;
+	subject->raw.pValue = memdup (raw->pValue, raw->ulValueLen);
+
+	if (subject->raw.pValue == NULL && raw->ulValueLen != 0) {
+		subject_free (subject);
 		return_val_if_reached (NULL);
+	}
+
+	if (raw->pValue && raw->ulValueLen) {
+		p11_buffer_init_full (&subject->canon, memdup (raw->pValue, raw->ulValueLen),
+		                      raw->ulValueLen, 0, realloc, free);
+		if (subject->canon.data == NULL) {
+			subject_free (subject);
+			return_val_if_reached (NULL);
+		}
+		subject->have_canon = p11_openssl_canon_name_der (ex->asn1_defs, &subject->canon);
+	}
+
+	if (!p11_dict_set (ex->subjects, &subject->raw, subject)) {
+		subject_free (subject);
+		return_val_if_reached (NULL);
+	}
+
+	return subject;
+}
+
+static bool
+links_flush (p11_openssl_links *links)
+{
+	p11_digest_input sha1[LINKS_BATCH];
+	p11_digest_input md5[LINKS_BATCH];
+	openssl_subject *subject;
+	int n_sha1 = 0;
+	int n_md5 = 0;
+	int i;
+
+	/* Hash each subject not yet seen once, even if queued several times */
+	for (i = 0; !links->failed && i < links->count; i++) {
+		subject = links->pending[i].subject;
+		if (subject->hashed)
+			continue;
+		if (subject->have_canon) {
+			sha1[n_sha1].input = subject->canon.data;
+			sha1[n_sha1].length = subject->canon.len;
+			sha1[n_sha1].hash = subject->hash;
+			n_sha1++;
+		}
+		md5[n_md5].input = subject->raw.pValue;
+		md5[n_md5].length = subject->raw.ulValueLen;
+		md5[n_md5].hash = subject->old_hash;
+		n_md5++;
+		subject->hashed = true;
+	}
+
+	p11_digest_sha1_multi (sha1, n_sha1);
+	p11_digest_md5_multi (md5, n_md5);
+
+	for (i = 0; i < links->count; i++) {
+		subject = links->pending[i].subject;
+
+		if (!links->failed && subject->have_canon &&
+		    !symlink_for_hash (links->dir, subject->hash, links->pending[i].filename))
+			links->failed = true;
+		if (!links->failed &&
+		    !symlink_for_hash (links->dir, subject->old_hash, links->pending[i].filename))
+			links->failed = true;
+
+		free (links->pending[i].filename);
+	}
 
-	return linkname;
+	links->count = 0;
+	return !links->failed;
 }
 
 #endif /* OS_UNIX */
 
-/*
- * The OpenSSL style c_rehash stuff
- *
- * Different versions of openssl build these hashes differently
- * so output both of them. Shouldn't cause confusion, because
- * multiple certificates can hash to the same link anyway,
- * and this is the reason for the trailing number after the dot.
- *
- * The trailing number is incremented p11_save_symlink_in() if it
- * conflicts with something we've already written out.
- *
- * On Windows no symlinks.
- */
 bool
-p11_openssl_symlink (p11_enumerate *ex,
-                     p11_save_dir *dir,
-                     const char *filename)
+p11_openssl_links_add (p11_openssl_links *links,
+                       p11_enumerate *ex,
+                       const char *filename)
 {
-	bool ret = true;
 #ifdef OS_UNIX
-	char *linkname;
+	CK_ATTRIBUTE *subject;
+	pending_link *link;
 
-	linkname = symlink_for_subject_hash (ex);
-	if (linkname) {
-		ret = p11_save_symlink_in (dir, linkname, ".0", filename);
-		free (linkname);
-	}
+	return_val_if_fail (links != NULL, false);
+	return_val_if_fail (filename != NULL, false);
 
-	if (ret) {
-		linkname = symlink_for_subject_old_hash (ex);
-		if (linkname) {
-			ret = p11_save_symlink_in (dir, linkname, ".0", filename);
-			free (linkname);
-		}
-	}
+	if (links->failed)
+		return false;
+
+	subject = p11_attrs_find_valid (ex->attrs, CKA_SUBJECT);
+	if (!subject)
+		return true;
+
+	link = links->pending + links->count;
+	link->subject = subject_lookup (ex, subject);
+	return_val_if_fail (link->subject != NULL, false);
+
+	link->filename = strdup (filename);
+	return_val_if_fail (link->filename != NULL, false);
+
+	if (++links->count == LINKS_BATCH)
+		return links_flush (links);
 #endif /* OS_UNIX */
-	return ret;
+
+	return true;
+}
+
+bool
+p11_openssl_links_finish (p11_openssl_links *links,
+                          bool commit)
+{
+	bool ret = true;
+
+	if (!links)
+		return false;
+
+	if (!commit)
+		links->failed = true;
+#ifdef OS_UNIX
+	ret = links_flush (links);
+	p11_debug ("subject cache: %u hits, %u misses",
+	           links->ex->subjects_hits, links->ex->subjects_misses);
+#endif
+
+	free (links);
+	return ret && commit;
 }
 
 bool
@@ -632,6 +786,7 @@ p11_extract_openssl_directory (p11_enumerate *ex,
 {
 	char *filename;
 	p11_save_file *file;
+	p11_openssl_links *links;
 	p11_save_dir *dir;
 	p11_buffer output;
 	p11_buffer buf;
@@ -644,6 +799,9 @@ p11_extract_openssl_directory (p11_enumerate *ex,
 	if (dir == NULL)
 		return false;
 
+	links = p11_openssl_links_new (ex, dir);
+	return_val_if_fail (links != NULL, false);
+
 	p11_buffer_init (&buf, 0);
 	p11_buffer_init (&output, 0);
 
@@ -672,7 +830,8 @@ p11_extract_openssl_directory (p11_enumerate *ex,
 				if (ret)
 					filename = p11_path_base (path);
 			}
-			ret = p11_openssl_symlink(ex, dir, filename);
+			if (ret)
+				ret = p11_openssl_links_add (links, ex, filename);
 
 			free (filename);
 			free (path);
@@ -691,6 +850,8 @@ p11_extract_openssl_directory (p11_enumerate *ex,
 		ret = false;
 	}
 
+	if (!p11_openssl_links_finish (links, ret))
+		ret = false;
 	p11_save_finish_directory (dir, ret);
 	return ret;
 }
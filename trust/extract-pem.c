@@ -61,26 +61,30 @@ p11_extract_pem_bundle (p11_enumerate *ex,
 	if (!file)
 		return false;
 
-	p11_buffer_init (&buf, 0);
+	p11_buffer_init (&buf, P11_EXTRACT_FLUSH_SIZE);
 	while ((rv = p11_kit_iter_next (ex->iter)) == CKR_OK) {
-		if (!p11_buffer_reset (&buf, 2048))
-			return_val_if_reached (false);
-
-		if (!p11_pem_write (ex->cert_der, ex->cert_len, "CERTIFICATE", &buf))
-			return_val_if_reached (false);
-
 		comment = p11_enumerate_comment (ex, first);
 		first = false;
 
-		ret = p11_save_write (file, comment, -1) &&
-		      p11_save_write (file, buf.data, buf.len);
-
+		if (comment)
+			p11_buffer_add (&buf, comment, -1);
 		free (comment);
 
-		if (!ret)
-			break;
+		if (!p11_pem_write (ex->cert_der, ex->cert_len, "CERTIFICATE", &buf))
+			return_val_if_reached (false);
+
+		/* Don't hold more than a block of certificates in memory */
+		if (buf.len >= P11_EXTRACT_FLUSH_SIZE) {
+			ret = p11_save_write (file, buf.data, buf.len);
+			p11_buffer_reset (&buf, P11_EXTRACT_FLUSH_SIZE);
+			if (!ret)
+				break;
+		}
 	}
 
+	if (ret && buf.len)
+		ret = p11_save_write (file, buf.data, buf.len);
+
 	p11_buffer_uninit (&buf);
 
 	if (rv != CKR_OK && rv != CKR_CANCEL) {
@@ -104,6 +108,7 @@ extract_pem_directory (p11_enumerate *ex,
                        const char *destination,
                        bool hash)
 {
+	p11_openssl_links *links;
 	p11_save_file *file;
 	p11_save_dir *dir;
 	p11_buffer buf;
@@ -117,6 +122,12 @@ extract_pem_directory (p11_enumerate *ex,
 	if (dir == NULL)
 		return false;
 
+	links = NULL;
+	if (hash) {
+		links = p11_openssl_links_new (ex, dir);
+		return_val_if_fail (links != NULL, false);
+	}
+
 	p11_buffer_init (&buf, 0);
 	while ((rv = p11_kit_iter_next (ex->iter)) == CKR_OK) {
 		if (!p11_buffer_reset (&buf, 2048))
@@ -138,7 +149,7 @@ extract_pem_directory (p11_enumerate *ex,
 
 		if (ret && hash) {
 			filename = p11_path_base (path);
-			ret = p11_openssl_symlink(ex, dir, filename);
+			ret = p11_openssl_links_add (links, ex, filename);
 			free (filename);
 		}
 
@@ -155,6 +166,8 @@ extract_pem_directory (p11_enumerate *ex,
 		ret = false;
 	}
 
+	if (hash && !p11_openssl_links_finish (links, ret))
+		ret = false;
 	p11_save_finish_directory (dir, ret);
 	return ret;
 }
@@ -46,6 +46,9 @@ enum {
 	P11_EXTRACT_COMMENT = 1 << 10,
 };
 
+/* Bundles are written out whenever this much has been buffered */
+#define P11_EXTRACT_FLUSH_SIZE (64 * 1024)
+
 typedef bool (* p11_extract_func)              (p11_enumerate *ex,
                                                 const char *destination);
 
@@ -80,7 +83,15 @@ int             p11_trust_extract_compat       (int argc,
                                                 char *argv[]);
 
 /* from extract-openssl.c but also used in extract-pem.c */
-bool            p11_openssl_symlink            (p11_enumerate *ex,
-                                                p11_save_dir *dir,
+typedef struct _p11_openssl_links p11_openssl_links;
+
+p11_openssl_links * p11_openssl_links_new      (p11_enumerate *ex,
+                                                p11_save_dir *dir);
+
+bool            p11_openssl_links_add          (p11_openssl_links *links,
+                                                p11_enumerate *ex,
                                                 const char *filename);
+
+bool            p11_openssl_links_finish       (p11_openssl_links *links,
+                                                bool commit);
 #endif /* P11_EXTRACT_H_ */
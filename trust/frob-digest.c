@@ -0,0 +1,146 @@
+/*
+ * Copyright (c) 2016 Red Hat Inc
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *     * Redistributions of source code must retain the above
+ *       copyright notice, this list of conditions and the
+ *       following disclaimer.
+ *     * Redistributions in binary form must reproduce the
+ *       above copyright notice, this list of conditions and
+ *       the following disclaimer in the documentation and/or
+ *       other materials provided with the distribution.
+ *     * The names of contributors to this software may not be
+ *       used to endorse or promote products derived from this
+ *       software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+#include "config.h"
+
+#include "compat.h"
+#include "digest.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+/*
+ * Measures hashing throughput over the inputs that extracting a large
+ * bundle hashes: a subject and a certificate for each certificate.
+ */
+
+#define CERTIFICATES 10000
+
+static double
+time_now (void)
+{
+	return p11_clock_ns ();
+}
+
+static void
+bench_digest (const char *name,
+              p11_digest_input *inputs,
+              bool sha1,
+              bool multi,
+              int rounds)
+{
+	size_t bytes = 0;
+	double start;
+	double taken;
+	int i, j;
+
+	for (i = 0; i < CERTIFICATES; i++)
+		bytes += inputs[i].length;
+
+	start = time_now ();
+	for (j = 0; j < rounds; j++) {
+		if (multi && sha1) {
+			p11_digest_sha1_multi (inputs, CERTIFICATES);
+		} else if (multi) {
+			p11_digest_md5_multi (inputs, CERTIFICATES);
+		} else {
+			for (i = 0; i < CERTIFICATES; i++) {
+				if (sha1)
+					p11_digest_sha1 (inputs[i].hash, inputs[i].input, inputs[i].length, NULL);
+				else
+					p11_digest_md5 (inputs[i].hash, inputs[i].input, inputs[i].length, NULL);
+			}
+		}
+	}
+	taken = (time_now () - start) / rounds;
+
+	printf ("%-24s %8.1f us/%d %8.1f MB/s\n", name, taken / 1000.0,
+	        CERTIFICATES, (bytes / (taken / 1000000000.0)) / (1024 * 1024));
+}
+
+static void
+fill_inputs (p11_digest_input *inputs,
+             unsigned char *data,
+             unsigned char *hashes,
+             size_t min,
+             size_t max)
+{
+	int i;
+
+	for (i = 0; i < CERTIFICATES; i++) {
+		inputs[i].input = data + (i % 64);
+		inputs[i].length = min + (rand () % (max - min));
+		inputs[i].hash = hashes + (i * P11_DIGEST_SHA1_LEN);
+	}
+}
+
+int
+main (int argc,
+      char *argv[])
+{
+	p11_digest_input *inputs;
+	unsigned char *hashes;
+	unsigned char *data;
+	int rounds;
+	int i;
+
+	rounds = argc > 1 ? atoi (argv[1]) : 20;
+	assert (rounds > 0);
+
+	data = malloc (2048);
+	hashes = malloc (CERTIFICATES * P11_DIGEST_SHA1_LEN);
+	inputs = calloc (CERTIFICATES, sizeof (p11_digest_input));
+	assert (data != NULL && hashes != NULL && inputs != NULL);
+
+	for (i = 0; i < 2048; i++)
+		data[i] = rand ();
+
+	/* Canonical subjects are typically around a hundred bytes */
+	fill_inputs (inputs, data, hashes, 60, 200);
+	bench_digest ("sha1 subjects", inputs, true, false, rounds);
+	bench_digest ("sha1 subjects multi", inputs, true, true, rounds);
+	bench_digest ("md5 subjects", inputs, false, false, rounds);
+	bench_digest ("md5 subjects multi", inputs, false, true, rounds);
+
+	/* And the certificates themselves a kilobyte or so */
+	fill_inputs (inputs, data, hashes, 700, 1900);
+	bench_digest ("sha1 certificates", inputs, true, false, rounds);
+	bench_digest ("sha1 certificates multi", inputs, true, true, rounds);
+	bench_digest ("md5 certificates", inputs, false, false, rounds);
+	bench_digest ("md5 certificates multi", inputs, false, true, rounds);
+
+	free (inputs);
+	free (hashes);
+	free (data);
+	return 0;
+}
@@ -0,0 +1,172 @@
+/*
+ * Copyright (c) 2016 Red Hat Inc
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *     * Redistributions of source code must retain the above
+ *       copyright notice, this list of conditions and the
+ *       following disclaimer.
+ *     * Redistributions in binary form must reproduce the
+ *       above copyright notice, this list of conditions and
+ *       the following disclaimer in the documentation and/or
+ *       other materials provided with the distribution.
+ *     * The names of contributors to this software may not be
+ *       used to endorse or promote products derived from this
+ *       software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+#include "config.h"
+
+#include "attrs.h"
+#include "compat.h"
+#include "enumerate.h"
+#include "extract.h"
+#include "mock.h"
+#include "test.h"
+
+#include "test-trust.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+
+/*
+ * Measures the peak memory used while extracting a large number of
+ * certificates, over what the mock module itself holds on to.
+ *
+ * Usage: frob-extract jks|pem|openssl [count]
+ */
+
+static CK_OBJECT_CLASS certificate_class = CKO_CERTIFICATE;
+static CK_CERTIFICATE_TYPE x509_type = CKC_X_509;
+
+static CK_ATTRIBUTE certificate_filter[] = {
+	{ CKA_CLASS, &certificate_class, sizeof (certificate_class) },
+	{ CKA_INVALID },
+};
+
+static long
+peak_rss (void)
+{
+	struct rusage usage;
+	getrusage (RUSAGE_SELF, &usage);
+	return usage.ru_maxrss;
+}
+
+static double
+time_now (void)
+{
+	return p11_clock_ns ();
+}
+
+static void
+setup_objects (int count)
+{
+	CK_ATTRIBUTE *attrs;
+	char label[64];
+	int i;
+
+	for (i = 0; i < count; i++) {
+		/* Unique labels, so the keystore alias isn't the bottleneck */
+		snprintf (label, sizeof (label), "Certificate %d", i);
+		attrs = p11_attrs_build (NULL,
+		                         &(CK_ATTRIBUTE){ CKA_VALUE, (void *)test_cacert3_ca_der, sizeof (test_cacert3_ca_der) },
+		                         &(CK_ATTRIBUTE){ CKA_CLASS, &certificate_class, sizeof (certificate_class) },
+		                         &(CK_ATTRIBUTE){ CKA_CERTIFICATE_TYPE, &x509_type, sizeof (x509_type) },
+		                         &(CK_ATTRIBUTE){ CKA_LABEL, label, strlen (label) },
+		                         NULL);
+		mock_module_take_object (MOCK_SLOT_ONE_ID, attrs);
+	}
+}
+
+int
+main (int argc,
+      char *argv[])
+{
+	CK_FUNCTION_LIST module;
+	p11_extract_func func;
+	p11_enumerate ex;
+	char *destination;
+	char *directory;
+	long before;
+	double start;
+	double taken;
+	int count;
+	bool ret;
+	CK_RV rv;
+
+	if (argc < 2) {
+		fprintf (stderr, "usage: frob-extract jks|pem|openssl [count]\n");
+		return 2;
+	}
+
+	if (strcmp (argv[1], "jks") == 0)
+		func = p11_extract_jks_cacerts;
+	else if (strcmp (argv[1], "pem") == 0)
+		func = p11_extract_pem_bundle;
+	else if (strcmp (argv[1], "openssl") == 0)
+		func = p11_extract_openssl_bundle;
+	else {
+		fprintf (stderr, "unknown format: %s\n", argv[1]);
+		return 2;
+	}
+
+	count = argc > 2 ? atoi (argv[2]) : 100000;
+
+	mock_module_init ();
+	mock_module_reset ();
+	memcpy (&module, &mock_module, sizeof (CK_FUNCTION_LIST));
+	rv = module.C_Initialize (NULL);
+	assert (rv == CKR_OK);
+
+	setup_objects (count);
+
+	p11_enumerate_init (&ex);
+	p11_kit_iter_add_filter (ex.iter, certificate_filter, 1);
+	p11_kit_iter_begin_with (ex.iter, &module, 0, 0);
+
+	directory = p11_test_directory ("frob-extract");
+	if (asprintf (&destination, "%s/%s", directory, "output") < 0)
+		assert (false);
+
+	before = peak_rss ();
+	start = time_now ();
+	ret = func (&ex, destination);
+	taken = time_now () - start;
+	assert (ret);
+
+	printf ("%-8s %8d certificates %8.1f ms %8ld KB peak over %ld KB\n",
+	        argv[1], count, taken / 1000000.0, peak_rss () - before, before);
+
+	free (destination);
+	p11_test_directory_delete (directory);
+	free (directory);
+
+	p11_enumerate_cleanup (&ex);
+	p11_kit_iter_free (ex.iter);
+	module.C_Finalize (NULL);
+	return 0;
+}
+
+#include "enumerate.c"
+#include "extract-jks.c"
+#include "extract-pem.c"
+#include "extract-openssl.c"
+#include "save.c"
@@ -0,0 +1,312 @@
+/*
+ * Copyright (c) 2016 Red Hat Inc
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *     * Redistributions of source code must retain the above
+ *       copyright notice, this list of conditions and the
+ *       following disclaimer.
+ *     * Redistributions in binary form must reproduce the
+ *       above copyright notice, this list of conditions and
+ *       the following disclaimer in the documentation and/or
+ *       other materials provided with the distribution.
+ *     * The names of contributors to this software may not be
+ *       used to endorse or promote products derived from this
+ *       software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+#include "config.h"
+
+#include "attrs.h"
+#include "buffer.h"
+#include "compat.h"
+#include "pem.h"
+#include "pkcs11x.h"
+#include "test.h"
+
+#include "test-trust.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/*
+ * Measures the lookups NSS makes against the trust module, with a
+ * generated set of roots. The roots are copies of one certificate
+ * with different serial numbers and subjects, so the issuer matches
+ * all of them.
+ *
+ * Usage: frob-find [roots] [lookups] [threads]
+ */
+
+static double
+time_now (void)
+{
+	return p11_clock_ns ();
+}
+
+/* The three byte serial number of cacert3, after the INTEGER tag and length */
+#define SERIAL_AT 15
+
+/* The "Class" in the common name of the subject of cacert3 */
+#define SUBJECT_AT 262
+
+static void
+make_serial (unsigned char *serial,
+             int i)
+{
+	serial[0] = 0x0a + (i >> 16);
+	serial[1] = (i >> 8) & 0xff;
+	serial[2] = i & 0xff;
+}
+
+static char *
+generate_roots (const char *directory,
+                int count)
+{
+	unsigned char der[sizeof (test_cacert3_ca_der)];
+	p11_buffer buf;
+	char name[8];
+	char *path;
+	FILE *f;
+	int i;
+
+	assert (memcmp (test_cacert3_ca_der + SERIAL_AT - 2, "\x02\x03", 2) == 0);
+	assert (memcmp (test_cacert3_ca_der + SUBJECT_AT, "Class", 5) == 0);
+	memcpy (der, test_cacert3_ca_der, sizeof (der));
+
+	if (asprintf (&path, "%s/%s", directory, "roots.pem") < 0)
+		assert (false);
+
+	f = fopen (path, "w");
+	assert (f != NULL);
+
+	p11_buffer_init (&buf, 4096);
+	for (i = 0; i < count; i++) {
+		make_serial (der + SERIAL_AT, i);
+		snprintf (name, sizeof (name), "C%04X", i & 0xffff);
+		memcpy (der + SUBJECT_AT, name, 5);
+		p11_buffer_reset (&buf, 4096);
+		if (!p11_pem_write (der, sizeof (der), "CERTIFICATE", &buf))
+			assert (false);
+		fwrite (buf.data, 1, buf.len, f);
+	}
+
+	p11_buffer_uninit (&buf);
+	fclose (f);
+	return path;
+}
+
+static int
+find_serials (CK_FUNCTION_LIST *module,
+              CK_SESSION_HANDLE session,
+              CK_OBJECT_CLASS klass,
+              bool der_serial,
+              int roots,
+              int lookups,
+              int offset)
+{
+	unsigned char serial[5] = { 0x02, 0x03 };
+	unsigned char value[4096];
+	CK_OBJECT_HANDLE objects[8];
+	CK_ULONG count;
+	CK_ULONG i;
+	int found = 0;
+	int n;
+	CK_RV rv;
+
+	CK_ATTRIBUTE match[] = {
+		{ CKA_TOKEN, &(CK_BBOOL){ CK_TRUE }, sizeof (CK_BBOOL) },
+		{ CKA_CLASS, &klass, sizeof (klass) },
+		{ CKA_ISSUER, (void *)test_cacert3_ca_issuer, sizeof (test_cacert3_ca_issuer) },
+		{ CKA_SERIAL_NUMBER, der_serial ? serial : serial + 2, der_serial ? 5 : 3 },
+	};
+
+	CK_ATTRIBUTE attr = { CKA_SUBJECT, value, sizeof (value) };
+
+	for (n = 0; n < lookups; n++) {
+		make_serial (serial + 2, ((n + offset) * 7919) % roots);
+
+		rv = module->C_FindObjectsInit (session, match, 4);
+		assert (rv == CKR_OK);
+		do {
+			rv = module->C_FindObjects (session, objects, 8, &count);
+			assert (rv == CKR_OK);
+			for (i = 0; i < count; i++) {
+				attr.ulValueLen = sizeof (value);
+				rv = module->C_GetAttributeValue (session, objects[i], &attr, 1);
+				assert (rv == CKR_OK);
+			}
+			found += count;
+		} while (count > 0);
+		rv = module->C_FindObjectsFinal (session);
+		assert (rv == CKR_OK);
+	}
+
+	return found;
+}
+
+static void
+bench_lookup (CK_FUNCTION_LIST *module,
+              CK_SESSION_HANDLE session,
+              const char *name,
+              CK_OBJECT_CLASS klass,
+              bool der_serial,
+              int roots,
+              int lookups)
+{
+	double start;
+	double taken;
+	int found;
+
+	start = time_now ();
+	found = find_serials (module, session, klass, der_serial, roots, lookups, 0);
+	taken = time_now () - start;
+
+	printf ("%-28s %8.1f us/lookup %8d found\n", name,
+	        taken / lookups / 1000.0, found);
+}
+
+typedef struct {
+	CK_FUNCTION_LIST *module;
+	CK_SLOT_ID slot;
+	int roots;
+	int lookups;
+	int offset;
+	int found;
+} Lookups;
+
+static void *
+lookup_thread (void *data)
+{
+	Lookups *lookups = data;
+	CK_SESSION_HANDLE session;
+	CK_RV rv;
+
+	rv = lookups->module->C_OpenSession (lookups->slot, CKF_SERIAL_SESSION, NULL, NULL, &session);
+	assert (rv == CKR_OK);
+
+	lookups->found = find_serials (lookups->module, session, CKO_NSS_TRUST, true,
+	                               lookups->roots, lookups->lookups, lookups->offset);
+
+	rv = lookups->module->C_CloseSession (session);
+	assert (rv == CKR_OK);
+	return NULL;
+}
+
+/* Each thread has its own session, as a TLS server would */
+static void
+bench_threads (CK_FUNCTION_LIST *module,
+               CK_SLOT_ID slot,
+               int threads,
+               int roots,
+               int lookups)
+{
+	p11_thread_t thread[threads];
+	Lookups data[threads];
+	double start;
+	double taken;
+	int found = 0;
+	int i;
+
+	start = time_now ();
+	for (i = 0; i < threads; i++) {
+		data[i].module = module;
+		data[i].slot = slot;
+		data[i].roots = roots;
+		data[i].lookups = lookups;
+		data[i].offset = i * lookups;
+		if (p11_thread_create (thread + i, lookup_thread, data + i) != 0)
+			assert (false);
+	}
+	for (i = 0; i < threads; i++) {
+		p11_thread_join (thread[i]);
+		found += data[i].found;
+	}
+	taken = time_now () - start;
+
+	printf ("%2d threads %17s %8.0f lookups/s %8d found\n", threads, "",
+	        (threads * lookups) / (taken / 1000000000.0), found);
+}
+
+int
+main (int argc,
+      char *argv[])
+{
+	CK_C_INITIALIZE_ARGS args;
+	CK_FUNCTION_LIST *module;
+	CK_SESSION_HANDLE session;
+	CK_SLOT_ID slot;
+	CK_ULONG count;
+	char *directory;
+	char *arguments;
+	char *path;
+	int threads;
+	int roots;
+	int lookups;
+	int i;
+	CK_RV rv;
+
+	roots = argc > 1 ? atoi (argv[1]) : 10000;
+	lookups = argc > 2 ? atoi (argv[2]) : 1000;
+	threads = argc > 3 ? atoi (argv[3]) : 8;
+
+	directory = p11_test_directory ("frob-find");
+	path = generate_roots (directory, roots);
+
+	/* This is the entry point of the trust module, linked to this program */
+	rv = C_GetFunctionList (&module);
+	assert (rv == CKR_OK);
+
+	memset (&args, 0, sizeof (args));
+	if (asprintf (&arguments, "paths='%s'", path) < 0)
+		assert (false);
+	args.pReserved = arguments;
+	args.flags = CKF_OS_LOCKING_OK;
+
+	rv = module->C_Initialize (&args);
+	assert (rv == CKR_OK);
+	free (arguments);
+
+	count = 1;
+	rv = module->C_GetSlotList (CK_TRUE, &slot, &count);
+	assert (rv == CKR_OK && count == 1);
+
+	rv = module->C_OpenSession (slot, CKF_SERIAL_SESSION, NULL, NULL, &session);
+	assert (rv == CKR_OK);
+
+	/* Load the token before timing anything */
+	bench_lookup (module, session, "warm up", CKO_CERTIFICATE, true, roots, 1);
+
+	bench_lookup (module, session, "certificate issuer/serial", CKO_CERTIFICATE, true, roots, lookups);
+	bench_lookup (module, session, "nss trust issuer/serial", CKO_NSS_TRUST, true, roots, lookups);
+	bench_lookup (module, session, "nss trust decoded serial", CKO_NSS_TRUST, false, roots, lookups);
+
+	for (i = 1; i <= threads; i *= 2)
+		bench_threads (module, slot, i, roots, lookups);
+
+	rv = module->C_Finalize (NULL);
+	assert (rv == CKR_OK);
+
+	p11_test_directory_delete (directory);
+	free (directory);
+	free (path);
+	return 0;
+}
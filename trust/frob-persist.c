@@ -0,0 +1,168 @@
+/*
+ * Copyright (c) 2016 Red Hat Inc
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *     * Redistributions of source code must retain the above
+ *       copyright notice, this list of conditions and the
+ *       following disclaimer.
+ *     * Redistributions in binary form must reproduce the
+ *       above copyright notice, this list of conditions and
+ *       the following disclaimer in the documentation and/or
+ *       other materials provided with the distribution.
+ *     * The names of contributors to this software may not be
+ *       used to endorse or promote products derived from this
+ *       software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+#include "config.h"
+
+#include "array.h"
+#include "attrs.h"
+#include "buffer.h"
+#include "compat.h"
+#include "lexer.h"
+#include "persist.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * Measures reading a large .p11-kit file, either one given on the
+ * command line or a generated one of about 50 MB.
+ */
+
+#define GENERATED_SIZE (50 * 1024 * 1024)
+
+static double
+time_now (void)
+{
+	return p11_clock_ns ();
+}
+
+static void
+generate (p11_buffer *buf)
+{
+	char line[128];
+	int i, j;
+
+	for (i = 0; buf->len < GENERATED_SIZE; i++) {
+		p11_buffer_add (buf, "[p11-kit-object-v1]\n", -1);
+		p11_buffer_add (buf, "class: x-certificate-extension\n", -1);
+		snprintf (line, sizeof (line), "label: \"Generated extension %d\"\n", i);
+		p11_buffer_add (buf, line, -1);
+		p11_buffer_add (buf, "modifiable: false\n", -1);
+		p11_buffer_add (buf, "x-critical: true\n", -1);
+		p11_buffer_add (buf, "object-id: 2.5.29.37\n", -1);
+		p11_buffer_add (buf, "id: \"", -1);
+		for (j = 0; j < 20; j++) {
+			snprintf (line, sizeof (line), "%%%02X", (i * 31 + j * 7) & 0xff);
+			p11_buffer_add (buf, line, -1);
+		}
+		p11_buffer_add (buf, "\"\n", -1);
+		p11_buffer_add (buf, "value: \"0%14%06%08%2B%06%01%05%05%07%03%01%06%08"
+		                "%2B%06%01%05%05%07%03%02\"\n\n", -1);
+	}
+
+	assert (!p11_buffer_failed (buf));
+}
+
+static void
+bench_lexer (const char *name,
+             const unsigned char *data,
+             size_t length,
+             int flags)
+{
+	p11_lexer lexer;
+	size_t tokens = 0;
+	double start;
+	double taken;
+
+	start = time_now ();
+	p11_lexer_init_full (&lexer, "bench", (const char *)data, length, flags);
+	while (p11_lexer_next (&lexer, NULL))
+		tokens++;
+	p11_lexer_done (&lexer);
+	taken = time_now () - start;
+
+	printf ("%-24s %8.1f ms %8.1f MB/s %8zu tokens\n", name, taken / 1000000.0,
+	        (length / (taken / 1000000000.0)) / (1024 * 1024), tokens);
+}
+
+static void
+bench_persist (const unsigned char *data,
+               size_t length)
+{
+	p11_persist *persist;
+	p11_array *objects;
+	double start;
+	double taken;
+	bool ret;
+
+	objects = p11_array_new (p11_attrs_free);
+	assert (objects != NULL);
+
+	start = time_now ();
+	persist = p11_persist_new ();
+	ret = p11_persist_read (persist, "bench", data, length, objects);
+	p11_persist_free (persist);
+	taken = time_now () - start;
+
+	assert (ret);
+	printf ("%-24s %8.1f ms %8.1f MB/s %8d objects\n", "persist read", taken / 1000000.0,
+	        (length / (taken / 1000000000.0)) / (1024 * 1024), objects->num);
+
+	p11_array_free (objects);
+}
+
+int
+main (int argc,
+      char *argv[])
+{
+	p11_buffer buf;
+	p11_mmap *map = NULL;
+	const unsigned char *data;
+	size_t length;
+	void *mapped;
+
+	if (argc > 1) {
+		map = p11_mmap_open (argv[1], NULL, &mapped, &length);
+		if (map == NULL) {
+			fprintf (stderr, "couldn't open file: %s\n", argv[1]);
+			return 1;
+		}
+		data = mapped;
+	} else {
+		p11_buffer_init (&buf, GENERATED_SIZE + 1024);
+		generate (&buf);
+		data = buf.data;
+		length = buf.len;
+	}
+
+	bench_lexer ("lexer copies", data, length, 0);
+	bench_lexer ("lexer slices", data, length, P11_LEXER_SLICES);
+	bench_persist (data, length);
+
+	if (map)
+		p11_mmap_close (map);
+	else
+		p11_buffer_uninit (&buf);
+	return 0;
+}
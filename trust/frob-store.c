@@ -0,0 +1,266 @@
+/*
+ * Copyright (c) 2016 Red Hat Inc
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *     * Redistributions of source code must retain the above
+ *       copyright notice, this list of conditions and the
+ *       following disclaimer.
+ *     * Redistributions in binary form must reproduce the
+ *       above copyright notice, this list of conditions and
+ *       the following disclaimer in the documentation and/or
+ *       other materials provided with the distribution.
+ *     * The names of contributors to this software may not be
+ *       used to endorse or promote products derived from this
+ *       software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+#include "config.h"
+
+#include "attrs.h"
+#include "buffer.h"
+#include "compat.h"
+#include "persist.h"
+#include "pkcs11x.h"
+#include "test.h"
+
+#include "test-trust.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/*
+ * Measures storing anchors in the trust module the way that
+ * 'trust anchor --store' does: look for each certificate, and either
+ * create it or mark the existing one as trusted. The anchors are
+ * copies of one certificate with different serial numbers.
+ *
+ * Usage: frob-store [anchors] [bundle]
+ */
+
+static double
+time_now (void)
+{
+	return p11_clock_ns ();
+}
+
+/* The three byte serial number of cacert3, after the INTEGER tag and length */
+#define SERIAL_AT 15
+
+static void
+make_anchor (unsigned char *der,
+             int i)
+{
+	memcpy (der, test_cacert3_ca_der, sizeof (test_cacert3_ca_der));
+	der[SERIAL_AT] = 0x0a + (i >> 16);
+	der[SERIAL_AT + 1] = (i >> 8) & 0xff;
+	der[SERIAL_AT + 2] = i & 0xff;
+}
+
+static char *
+generate_bundle (const char *directory,
+                 int count)
+{
+	unsigned char der[sizeof (test_cacert3_ca_der)];
+	CK_OBJECT_CLASS klass = CKO_CERTIFICATE;
+	CK_CERTIFICATE_TYPE x509 = CKC_X_509;
+	CK_BBOOL truev = CK_TRUE;
+	p11_persist *persist;
+	p11_buffer buf;
+	char *path;
+	FILE *f;
+	int i;
+
+	CK_ATTRIBUTE attrs[] = {
+		{ CKA_CLASS, &klass, sizeof (klass) },
+		{ CKA_CERTIFICATE_TYPE, &x509, sizeof (x509) },
+		{ CKA_VALUE, der, sizeof (der) },
+		{ CKA_TRUSTED, &truev, sizeof (truev) },
+		{ CKA_INVALID },
+	};
+
+	if (asprintf (&path, "%s/%s", directory, "bundle.p11-kit") < 0)
+		assert (false);
+
+	f = fopen (path, "w");
+	assert (f != NULL);
+
+	persist = p11_persist_new ();
+	p11_buffer_init (&buf, 4096);
+	for (i = 0; i < count; i++) {
+		make_anchor (der, i);
+		p11_buffer_reset (&buf, 4096);
+		if (!p11_persist_write (persist, attrs, &buf))
+			assert (false);
+		fwrite (buf.data, 1, buf.len, f);
+	}
+
+	p11_buffer_uninit (&buf);
+	p11_persist_free (persist);
+	fclose (f);
+	return path;
+}
+
+static CK_FUNCTION_LIST *
+initialize (const char *directory,
+            CK_SLOT_ID *slot)
+{
+	CK_C_INITIALIZE_ARGS args;
+	CK_FUNCTION_LIST *module;
+	CK_ULONG count;
+	char *arguments;
+	CK_RV rv;
+
+	/* This is the entry point of the trust module, linked to this program */
+	rv = C_GetFunctionList (&module);
+	assert (rv == CKR_OK);
+
+	memset (&args, 0, sizeof (args));
+	if (asprintf (&arguments, "paths='%s'", directory) < 0)
+		assert (false);
+	args.pReserved = arguments;
+	args.flags = CKF_OS_LOCKING_OK;
+
+	rv = module->C_Initialize (&args);
+	assert (rv == CKR_OK);
+	free (arguments);
+
+	count = 1;
+	rv = module->C_GetSlotList (CK_TRUE, slot, &count);
+	assert (rv == CKR_OK && count == 1);
+
+	return module;
+}
+
+static void
+bench_store (const char *name,
+             const char *directory,
+             int anchors)
+{
+	unsigned char der[sizeof (test_cacert3_ca_der)];
+	CK_OBJECT_CLASS klass = CKO_CERTIFICATE;
+	CK_CERTIFICATE_TYPE x509 = CKC_X_509;
+	CK_BBOOL truev = CK_TRUE;
+	CK_FUNCTION_LIST *module;
+	CK_SESSION_HANDLE session;
+	CK_FLAGS flags;
+	CK_OBJECT_HANDLE object;
+	CK_ULONG count;
+	CK_SLOT_ID slot;
+	char label[32];
+	int created = 0;
+	int modified = 0;
+	double start;
+	double taken;
+	int i;
+	CK_RV rv;
+
+	CK_ATTRIBUTE match[] = {
+		{ CKA_CLASS, &klass, sizeof (klass) },
+		{ CKA_VALUE, der, sizeof (der) },
+	};
+
+	CK_ATTRIBUTE create[] = {
+		{ CKA_CLASS, &klass, sizeof (klass) },
+		{ CKA_CERTIFICATE_TYPE, &x509, sizeof (x509) },
+		{ CKA_VALUE, der, sizeof (der) },
+		{ CKA_TOKEN, &truev, sizeof (truev) },
+		{ CKA_TRUSTED, &truev, sizeof (truev) },
+		{ CKA_LABEL, label, 0 },
+	};
+
+	CK_ATTRIBUTE modify[] = {
+		{ CKA_TRUSTED, &truev, sizeof (truev) },
+		{ CKA_LABEL, label, 0 },
+	};
+
+	module = initialize (directory, &slot);
+
+	start = time_now ();
+
+	/* Changes are written out when the session is closed */
+	flags = CKF_SERIAL_SESSION | CKF_RW_SESSION | CKF_X_BATCH_SESSION;
+	rv = module->C_OpenSession (slot, flags, NULL, NULL, &session);
+	assert (rv == CKR_OK);
+
+	for (i = 0; i < anchors; i++) {
+		make_anchor (der, i);
+		snprintf (label, sizeof (label), "Anchor %d", i);
+		create[5].ulValueLen = modify[1].ulValueLen = strlen (label);
+
+		rv = module->C_FindObjectsInit (session, match, 2);
+		assert (rv == CKR_OK);
+		rv = module->C_FindObjects (session, &object, 1, &count);
+		assert (rv == CKR_OK);
+		rv = module->C_FindObjectsFinal (session);
+		assert (rv == CKR_OK);
+
+		if (count == 0) {
+			rv = module->C_CreateObject (session, create, 6, &object);
+			created++;
+		} else {
+			rv = module->C_SetAttributeValue (session, object, modify, 2);
+			modified++;
+		}
+		assert (rv == CKR_OK);
+	}
+
+	/* Includes writing out anything held back */
+	rv = module->C_CloseSession (session);
+	assert (rv == CKR_OK);
+
+	taken = time_now () - start;
+
+	rv = module->C_Finalize (NULL);
+	assert (rv == CKR_OK);
+
+	printf ("%-24s %10.1f ms %8.1f us/anchor %6d created %6d modified\n",
+	        name, taken / 1000000.0, taken / anchors / 1000.0, created, modified);
+}
+
+int
+main (int argc,
+      char *argv[])
+{
+	char *directory;
+	char *path;
+	int anchors;
+	int bundle;
+
+	anchors = argc > 1 ? atoi (argv[1]) : 10000;
+	bundle = argc > 2 ? atoi (argv[2]) : anchors;
+
+	/* One file per anchor, then again with all of them present */
+	directory = p11_test_directory ("frob-store");
+	bench_store ("store new", directory, anchors);
+	bench_store ("store existing", directory, anchors);
+	p11_test_directory_delete (directory);
+	free (directory);
+
+	/* All the anchors in one bundle, each modified in turn */
+	directory = p11_test_directory ("frob-store");
+	path = generate_bundle (directory, bundle);
+	bench_store ("store existing bundle", directory, bundle);
+	p11_test_directory_delete (directory);
+	free (directory);
+	free (path);
+
+	return 0;
+}
@@ -41,6 +41,7 @@
 #include "dict.h"
 #include "index.h"
 #include "module.h"
+#include "pkcs11i.h"
 
 #include <assert.h>
 #include <stdlib.h>
@@ -89,6 +90,10 @@ struct _p11_index {
 	/* Used for queueing changes, when in a batch */
 	p11_dict *changes;
 	bool notifying;
+
+	/* Objects as they were before a transaction, to roll back */
+	p11_dict *undo;
+	bool committing;
 };
 
 typedef struct {
@@ -187,6 +192,7 @@ p11_index_free (p11_index *index)
 
 	p11_dict_free (index->objects);
 	p11_dict_free (index->changes);
+	p11_dict_free (index->undo);
 	for (i = 0; i < NUM_BUCKETS; i++)
 		free (index->buckets[i].elem);
 	free (index->buckets);
@@ -210,6 +216,11 @@ is_indexable (p11_index *index,
 	case CKA_OBJECT_ID:
 	case CKA_ID:
 	case CKA_X_ORIGIN:
+	case CKA_ISSUER:
+	case CKA_SUBJECT:
+	case CKA_SERIAL_NUMBER:
+	case CKA_X_CERTIFICATE_VALUE:
+	case CKA_PUBLIC_KEY_INFO:
 		return true;
 	}
 
@@ -391,6 +402,31 @@ index_build (p11_index *index,
 	return rv;
 }
 
+static void
+index_undo (p11_index *index,
+            CK_OBJECT_HANDLE handle,
+            CK_ATTRIBUTE *attrs)
+{
+	index_object *obj;
+
+	/* Only the state before the first change in a transaction matters */
+	if (!index->undo || p11_dict_get (index->undo, &handle))
+		return;
+
+	obj = calloc (1, sizeof (index_object));
+	return_if_fail (obj != NULL);
+
+	/* No attributes means the object was created in this transaction */
+	obj->handle = handle;
+	if (attrs) {
+		obj->attrs = p11_attrs_dup (attrs);
+		return_if_fail (obj->attrs != NULL);
+	}
+
+	if (!p11_dict_set (index->undo, &obj->handle, obj))
+		return_if_reached ();
+}
+
 static void
 call_notify (p11_index *index,
              CK_OBJECT_HANDLE handle,
@@ -462,7 +498,8 @@ p11_index_finish (p11_index *index)
 
 	return_if_fail (index != NULL);
 
-	if (!index->changes)
+	/* A transaction is only finished by commit or rollback */
+	if (!index->changes || index->undo)
 		return;
 
 	changes = index->changes;
@@ -477,6 +514,111 @@ p11_index_finish (p11_index *index)
 	p11_dict_free (changes);
 }
 
+/*
+ * A transaction is a batch that can be rolled back. When committed the
+ * notify callback is called once for each changed object, and then once
+ * more with NULL attributes, so that work which depends on several of
+ * the changed objects can be done just once.
+ */
+void
+p11_index_begin (p11_index *index)
+{
+	return_if_fail (index != NULL);
+	return_if_fail (index->undo == NULL);
+
+	p11_index_load (index);
+
+	index->undo = p11_dict_new (p11_dict_ulongptr_hash,
+	                            p11_dict_ulongptr_equal,
+	                            NULL, free_object);
+	return_if_fail (index->undo != NULL);
+}
+
+void
+p11_index_commit (p11_index *index)
+{
+	p11_dict *changes;
+	index_object *obj;
+	p11_dictiter iter;
+
+	return_if_fail (index != NULL);
+	return_if_fail (index->undo != NULL);
+
+	p11_dict_free (index->undo);
+	index->undo = NULL;
+
+	changes = index->changes;
+	index->changes = NULL;
+
+	/* Each changed object is notified once, however often it changed */
+	index->committing = true;
+	p11_dict_iterate (changes, &iter);
+	while (p11_dict_next (&iter, NULL, (void **)&obj)) {
+		index_notify (index, obj->handle, obj->attrs);
+		obj->attrs = NULL;
+	}
+
+	/* And then once more to say that the transaction is done */
+	if (!index->notifying) {
+		index->notifying = true;
+		index->notify (index->data, index, 0, NULL);
+		index->notifying = false;
+	}
+
+	index->committing = false;
+	p11_dict_free (changes);
+}
+
+void
+p11_index_rollback (p11_index *index)
+{
+	index_object *obj;
+	index_object *was;
+	p11_dictiter iter;
+
+	return_if_fail (index != NULL);
+	return_if_fail (index->undo != NULL);
+
+	p11_dict_iterate (index->undo, &iter);
+	while (p11_dict_next (&iter, NULL, (void **)&was)) {
+		obj = p11_dict_get (index->objects, &was->handle);
+
+		/* Created during the transaction */
+		if (was->attrs == NULL) {
+			if (obj != NULL)
+				p11_dict_remove (index->objects, &was->handle);
+			continue;
+		}
+
+		/* Modified or removed during the transaction */
+		if (obj == NULL) {
+			obj = calloc (1, sizeof (index_object));
+			return_if_fail (obj != NULL);
+			obj->handle = was->handle;
+			if (!p11_dict_set (index->objects, &obj->handle, obj))
+				return_if_reached ();
+		}
+
+		p11_attrs_free (obj->attrs);
+		obj->attrs = was->attrs;
+		was->attrs = NULL;
+		index_hash (index, obj);
+	}
+
+	/* Nothing happened, so there's nothing to notify */
+	p11_dict_free (index->undo);
+	index->undo = NULL;
+	p11_dict_free (index->changes);
+	index->changes = NULL;
+}
+
+bool
+p11_index_committing (p11_index *index)
+{
+	return_val_if_fail (index != NULL, false);
+	return index->committing;
+}
+
 bool
 p11_index_loading (p11_index *index)
 {
@@ -512,6 +654,7 @@ p11_index_take (p11_index *index,
 	if (!p11_dict_set (index->objects, &obj->handle, obj))
 		return_val_if_reached (CKR_HOST_MEMORY);
 
+	index_undo (index, obj->handle, NULL);
 	index_hash (index, obj);
 
 	if (handle)
@@ -555,6 +698,8 @@ p11_index_update (p11_index *index,
 		return CKR_OBJECT_HANDLE_INVALID;
 	}
 
+	index_undo (index, obj->handle, obj->attrs);
+
 	rv = index_build (index, obj->handle, &obj->attrs, update);
 	if (rv != CKR_OK) {
 		p11_attrs_free (update);
@@ -600,6 +745,8 @@ p11_index_remove (p11_index *index,
 	if (!p11_dict_steal (index->objects, &handle, NULL, (void **)&obj))
 		return CKR_OBJECT_HANDLE_INVALID;
 
+	index_undo (index, obj->handle, obj->attrs);
+
 	rv = (index->remove) (index->data, index, obj->attrs);
 
 	/* If the writer failed the remove, then add it back */
@@ -645,6 +792,7 @@ index_replacev (p11_index *index,
 				if (!replace[j])
 					continue;
 				if (p11_attrs_matchn (replace[j], attr, 1)) {
+					index_undo (index, obj->handle, obj->attrs);
 					attrs = NULL;
 					rv = index_build (index, obj->handle, &attrs, replace[j]);
 					if (rv != CKR_OK)
@@ -754,6 +902,7 @@ index_select (p11_index *index,
               void *data)
 {
 	index_bucket *selected[MAX_SELECT];
+	index_bucket *bucket;
 	CK_OBJECT_HANDLE handle;
 	index_object *obj;
 	unsigned int hash;
@@ -786,6 +935,15 @@ index_select (p11_index *index,
 		return;
 	}
 
+	/* Walk the smallest bucket, and check the others for each candidate */
+	for (i = 1; i < num; i++) {
+		if (selected[i]->num < selected[0]->num) {
+			bucket = selected[0];
+			selected[0] = selected[i];
+			selected[i] = bucket;
+		}
+	}
+
 	for (i = 0; i < selected[0]->num; i++) {
 		/* A candidate match from first bucket */
 		handle = selected[0]->elem[i];
@@ -78,6 +78,14 @@ void               p11_index_finish      (p11_index *index);
 
 bool               p11_index_loading     (p11_index *index);
 
+void               p11_index_begin       (p11_index *index);
+
+void               p11_index_commit      (p11_index *index);
+
+void               p11_index_rollback    (p11_index *index);
+
+bool               p11_index_committing  (p11_index *index);
+
 CK_RV              p11_index_take        (p11_index *index,
                                           CK_ATTRIBUTE *attrs,
                                           CK_OBJECT_HANDLE *handle);
@@ -70,22 +70,29 @@ static struct _Shared {
 	p11_dict *sessions;
 	p11_array *tokens;
 	char *paths;
-} gl = { 0, NULL, NULL, NULL };
+	p11_rwlock_t lock;
+} gl = { 0, NULL, NULL, NULL, };
 
 /* Used during FindObjects */
 typedef struct _FindObjects {
-	CK_ATTRIBUTE *match;
 	CK_OBJECT_HANDLE *snapshot;
 	CK_ULONG iterator;
 } FindObjects;
 
+/* A find template prepared at FindObjectsInit for matching many objects */
+typedef struct {
+	CK_ATTRIBUTE *match;
+	CK_ULONG count;
+	CK_ATTRIBUTE *serial;
+	CK_ATTRIBUTE serial_der;
+} FindPlan;
+
 static CK_FUNCTION_LIST sys_function_list;
 
 static void
 find_objects_free (void *data)
 {
 	FindObjects *find = data;
-	p11_attrs_free (find->match);
 	free (find->snapshot);
 	free (find);
 }
@@ -108,6 +115,62 @@ lookup_session (CK_SESSION_HANDLE handle,
 	return CKR_OK;
 }
 
+/*
+ * Most calls only read the tokens. They take the module lock shared,
+ * along with the lock of their session. Changes to a token, or to the
+ * set of sessions, take the module lock exclusively, which also keeps
+ * everyone else out of the sessions.
+ */
+static CK_RV
+lock_session (CK_SESSION_HANDLE handle,
+              bool exclusive,
+              p11_session **session)
+{
+	CK_RV rv;
+
+	if (exclusive)
+		p11_rwlock_write (&gl.lock);
+	else
+		p11_rwlock_read (&gl.lock);
+
+	rv = lookup_session (handle, session);
+	if (rv != CKR_OK)
+		p11_rwlock_unlock (&gl.lock);
+	else if (!exclusive)
+		p11_mutex_lock (&(*session)->lock);
+
+	return rv;
+}
+
+static void
+unlock_session (p11_session *session,
+                bool exclusive)
+{
+	if (!exclusive)
+		p11_mutex_unlock (&session->lock);
+	p11_rwlock_unlock (&gl.lock);
+}
+
+/* Only takes the module lock exclusively when the object is on the token */
+static CK_RV
+lock_session_for_object (CK_SESSION_HANDLE handle,
+                         CK_OBJECT_HANDLE object,
+                         p11_session **session,
+                         bool *exclusive)
+{
+	CK_RV rv;
+
+	*exclusive = false;
+	rv = lock_session (handle, false, session);
+	if (rv == CKR_OK && !p11_index_lookup ((*session)->index, object)) {
+		unlock_session (*session, false);
+		*exclusive = true;
+		rv = lock_session (handle, true, session);
+	}
+
+	return rv;
+}
+
 static CK_ATTRIBUTE *
 lookup_object_inlock (p11_session *session,
                       CK_OBJECT_HANDLE handle,
@@ -173,9 +236,9 @@ check_slot (CK_SLOT_ID id)
 {
 	bool ret;
 
-	p11_lock ();
+	p11_rwlock_read (&gl.lock);
 	ret = lookup_slot_inlock (id, NULL) == CKR_OK;
-	p11_unlock ();
+	p11_rwlock_unlock (&gl.lock);
 
 	return ret;
 }
@@ -297,7 +360,7 @@ sys_C_Finalize (CK_VOID_PTR reserved)
 		rv = CKR_ARGUMENTS_BAD;
 
 	} else {
-		p11_lock ();
+		p11_rwlock_write (&gl.lock);
 
 			if (gl.initialized == 0) {
 				p11_debug ("trust module is not initialized");
@@ -323,7 +386,7 @@ sys_C_Finalize (CK_VOID_PTR reserved)
 				p11_debug ("trust module still initialized %d times", gl.initialized);
 			}
 
-		p11_unlock ();
+		p11_rwlock_unlock (&gl.lock);
 	}
 
 	p11_debug ("out: 0x%lx", rv);
@@ -345,7 +408,7 @@ sys_C_Initialize (CK_VOID_PTR init_args)
 
 	p11_debug ("in");
 
-	p11_lock ();
+	p11_rwlock_write (&gl.lock);
 
 		rv = CKR_OK;
 
@@ -402,7 +465,7 @@ sys_C_Initialize (CK_VOID_PTR init_args)
 
 		gl.initialized++;
 
-	p11_unlock ();
+	p11_rwlock_unlock (&gl.lock);
 
 	if (rv != CKR_OK)
 		sys_C_Finalize (NULL);
@@ -422,12 +485,12 @@ sys_C_GetInfo (CK_INFO_PTR info)
 
 	return_val_if_fail (info != NULL, CKR_ARGUMENTS_BAD);
 
-	p11_lock ();
+	p11_rwlock_read (&gl.lock);
 
 		if (!gl.sessions)
 			rv = CKR_CRYPTOKI_NOT_INITIALIZED;
 
-	p11_unlock ();
+	p11_rwlock_unlock (&gl.lock);
 
 	if (rv == CKR_OK) {
 		memset (info, 0, sizeof (*info));
@@ -467,12 +530,12 @@ sys_C_GetSlotList (CK_BBOOL token_present,
 
 	p11_debug ("in");
 
-	p11_lock ();
+	p11_rwlock_read (&gl.lock);
 
 		if (!gl.sessions)
 			rv = CKR_CRYPTOKI_NOT_INITIALIZED;
 
-	p11_unlock ();
+	p11_rwlock_unlock (&gl.lock);
 
 	if (rv != CKR_OK) {
 		/* already failed */
@@ -509,7 +572,7 @@ sys_C_GetSlotInfo (CK_SLOT_ID id,
 	return_val_if_fail (info != NULL, CKR_ARGUMENTS_BAD);
 
 	p11_debug ("in");
-	p11_lock ();
+	p11_rwlock_read (&gl.lock);
 
 	rv = lookup_slot_inlock (id, &token);
 	if (rv == CKR_OK) {
@@ -530,7 +593,7 @@ sys_C_GetSlotInfo (CK_SLOT_ID id,
 		memcpy (info->slotDescription, path, length);
 	}
 
-	p11_unlock ();
+	p11_rwlock_unlock (&gl.lock);
 	p11_debug ("out: 0x%lx", rv);
 
 	return rv;
@@ -549,7 +612,8 @@ sys_C_GetTokenInfo (CK_SLOT_ID id,
 
 	p11_debug ("in");
 
-	p11_lock ();
+	/* Exclusive, since the token directory is checked and remembered */
+	p11_rwlock_write (&gl.lock);
 
 	rv = lookup_slot_inlock (id, &token);
 	if (rv == CKR_OK) {
@@ -585,7 +649,7 @@ sys_C_GetTokenInfo (CK_SLOT_ID id,
 			info->flags |= CKF_WRITE_PROTECTED;
 	}
 
-	p11_unlock ();
+	p11_rwlock_unlock (&gl.lock);
 	p11_debug ("out: 0x%lx", rv);
 
 	return rv;
@@ -653,7 +717,7 @@ sys_C_OpenSession (CK_SLOT_ID id,
 
 	p11_debug ("in");
 
-	p11_lock ();
+	p11_rwlock_write (&gl.lock);
 
 		rv = lookup_slot_inlock (id, &token);
 		if (rv != CKR_OK) {
@@ -672,6 +736,10 @@ sys_C_OpenSession (CK_SLOT_ID id,
 				rv = CKR_OK;
 				if (flags & CKF_RW_SESSION)
 					session->read_write = true;
+				if ((flags & CKF_RW_SESSION) && (flags & CKF_X_BATCH_SESSION)) {
+					session->batch = true;
+					p11_token_batch (token);
+				}
 				*handle = session->handle;
 				p11_debug ("session: %lu", *handle);
 			} else {
@@ -680,7 +748,7 @@ sys_C_OpenSession (CK_SLOT_ID id,
 			}
 		}
 
-	p11_unlock ();
+	p11_rwlock_unlock (&gl.lock);
 
 	p11_debug ("out: 0x%lx", rv);
 
@@ -694,7 +762,7 @@ sys_C_CloseSession (CK_SESSION_HANDLE handle)
 
 	p11_debug ("in");
 
-	p11_lock ();
+	p11_rwlock_write (&gl.lock);
 
 		if (!gl.sessions) {
 			rv = CKR_CRYPTOKI_NOT_INITIALIZED;
@@ -706,7 +774,7 @@ sys_C_CloseSession (CK_SESSION_HANDLE handle)
 			rv = CKR_SESSION_HANDLE_INVALID;
 		}
 
-	p11_unlock ();
+	p11_rwlock_unlock (&gl.lock);
 
 	p11_debug ("out: 0x%lx", rv);
 
@@ -724,7 +792,7 @@ sys_C_CloseAllSessions (CK_SLOT_ID id)
 
 	p11_debug ("in");
 
-	p11_lock ();
+	p11_rwlock_write (&gl.lock);
 
 		rv = lookup_slot_inlock (id, &token);
 		if (rv == CKR_OK) {
@@ -735,7 +803,7 @@ sys_C_CloseAllSessions (CK_SLOT_ID id)
 			}
 		}
 
-	p11_unlock ();
+	p11_rwlock_unlock (&gl.lock);
 
 	p11_debug ("out: 0x%lx", rv);
 
@@ -765,18 +833,14 @@ sys_C_GetSessionInfo (CK_SESSION_HANDLE handle,
 
 	p11_debug ("in");
 
-	p11_lock ();
-
-		rv = lookup_session (handle, &session);
-		if (rv == CKR_OK) {
-			info->flags = CKF_SERIAL_SESSION;
-			info->state = CKS_RO_PUBLIC_SESSION;
-			info->slotID = p11_token_get_slot (session->token);
-			info->ulDeviceError = 0;
-		}
-
-
-	p11_unlock ();
+	rv = lock_session (handle, false, &session);
+	if (rv == CKR_OK) {
+		info->flags = CKF_SERIAL_SESSION;
+		info->state = CKS_RO_PUBLIC_SESSION;
+		info->slotID = p11_token_get_slot (session->token);
+		info->ulDeviceError = 0;
+		unlock_session (session, false);
+	}
 
 	p11_debug ("out: 0x%lx", rv);
 
@@ -829,17 +893,16 @@ sys_C_Login (CK_SESSION_HANDLE handle,
              CK_UTF8CHAR_PTR pin,
              CK_ULONG pin_len)
 {
+	p11_session *session;
 	CK_RV rv;
 
 	p11_debug ("in");
 
-	p11_lock ();
-
-		rv = lookup_session (handle, NULL);
-		if (rv == CKR_OK)
-			rv = CKR_USER_TYPE_INVALID;
-
-	p11_unlock ();
+	rv = lock_session (handle, false, &session);
+	if (rv == CKR_OK) {
+		unlock_session (session, false);
+		rv = CKR_USER_TYPE_INVALID;
+	}
 
 	p11_debug ("out: 0x%lx", rv);
 
@@ -849,17 +912,16 @@ sys_C_Login (CK_SESSION_HANDLE handle,
 static CK_RV
 sys_C_Logout (CK_SESSION_HANDLE handle)
 {
+	p11_session *session;
 	CK_RV rv;
 
 	p11_debug ("in");
 
-	p11_lock ();
-
-		rv = lookup_session (handle, NULL);
-		if (rv == CKR_OK)
-			rv = CKR_USER_NOT_LOGGED_IN;
-
-	p11_unlock ();
+	rv = lock_session (handle, false, &session);
+	if (rv == CKR_OK) {
+		unlock_session (session, false);
+		rv = CKR_USER_NOT_LOGGED_IN;
+	}
 
 	p11_debug ("out: 0x%lx", rv);
 
@@ -874,6 +936,7 @@ sys_C_CreateObject (CK_SESSION_HANDLE handle,
 {
 	p11_session *session;
 	p11_index *index;
+	bool exclusive;
 	CK_BBOOL val;
 	CK_RV rv;
 
@@ -881,21 +944,21 @@ sys_C_CreateObject (CK_SESSION_HANDLE handle,
 
 	p11_debug ("in");
 
-	p11_lock ();
+	exclusive = p11_attrs_findn_bool (template, count, CKA_TOKEN, &val) && val;
 
-		rv = lookup_session (handle, &session);
-		if (rv == CKR_OK) {
-			if (p11_attrs_findn_bool (template, count, CKA_TOKEN, &val) && val)
-				index = p11_token_index (session->token);
-			else
-				index = session->index;
-			rv = check_index_writable (session, index);
-		}
+	rv = lock_session (handle, exclusive, &session);
+	if (rv == CKR_OK) {
+		if (exclusive)
+			index = p11_token_index (session->token);
+		else
+			index = session->index;
+		rv = check_index_writable (session, index);
 
 		if (rv == CKR_OK)
 			rv = p11_index_add (index, template, count, new_object);
 
-	p11_unlock ();
+		unlock_session (session, exclusive);
+	}
 
 	p11_debug ("out: 0x%lx", rv);
 
@@ -915,6 +978,7 @@ sys_C_CopyObject (CK_SESSION_HANDLE handle,
 	CK_ATTRIBUTE *original;
 	CK_ATTRIBUTE *attrs;
 	p11_index *index;
+	bool exclusive;
 	CK_BBOOL val;
 	CK_RV rv;
 
@@ -922,14 +986,14 @@ sys_C_CopyObject (CK_SESSION_HANDLE handle,
 
 	p11_debug ("in");
 
-	p11_lock ();
+	/* Unless copying into the session, this may change the token */
+	exclusive = !p11_attrs_findn_bool (template, count, CKA_TOKEN, &val) || val;
 
-		rv = lookup_session (handle, &session);
-		if (rv == CKR_OK) {
-			original = lookup_object_inlock (session, object, &index);
-			if (original == NULL)
-				rv = CKR_OBJECT_HANDLE_INVALID;
-		}
+	rv = lock_session (handle, exclusive, &session);
+	if (rv == CKR_OK) {
+		original = lookup_object_inlock (session, object, &index);
+		if (original == NULL)
+			rv = CKR_OBJECT_HANDLE_INVALID;
 
 		if (rv == CKR_OK) {
 			if (p11_attrs_findn_bool (template, count, CKA_TOKEN, &val))
@@ -944,7 +1008,8 @@ sys_C_CopyObject (CK_SESSION_HANDLE handle,
 			rv = p11_index_take (index, attrs, new_object);
 		}
 
-	p11_unlock ();
+		unlock_session (session, exclusive);
+	}
 
 	p11_debug ("out: 0x%lx", rv);
 
@@ -958,31 +1023,30 @@ sys_C_DestroyObject (CK_SESSION_HANDLE handle,
 	p11_session *session;
 	CK_ATTRIBUTE *attrs;
 	p11_index *index;
+	bool exclusive;
 	CK_BBOOL val;
 	CK_RV rv;
 
 	p11_debug ("in");
 
-	p11_lock ();
-
-		rv = lookup_session (handle, &session);
-		if (rv == CKR_OK) {
-			attrs = lookup_object_inlock (session, object, &index);
-			if (attrs == NULL)
-				rv = CKR_OBJECT_HANDLE_INVALID;
-			else
-				rv = check_index_writable (session, index);
-
-			if (rv == CKR_OK && p11_attrs_find_bool (attrs, CKA_MODIFIABLE, &val) && !val) {
-				/* TODO: This should be replaced with CKR_ACTION_PROHIBITED */
-				rv = CKR_ATTRIBUTE_READ_ONLY;
-			}
+	rv = lock_session_for_object (handle, object, &session, &exclusive);
+	if (rv == CKR_OK) {
+		attrs = lookup_object_inlock (session, object, &index);
+		if (attrs == NULL)
+			rv = CKR_OBJECT_HANDLE_INVALID;
+		else
+			rv = check_index_writable (session, index);
 
-			if (rv == CKR_OK)
-				rv = p11_index_remove (index, object);
+		if (rv == CKR_OK && p11_attrs_find_bool (attrs, CKA_MODIFIABLE, &val) && !val) {
+			/* TODO: This should be replaced with CKR_ACTION_PROHIBITED */
+			rv = CKR_ATTRIBUTE_READ_ONLY;
 		}
 
-	p11_unlock ();
+		if (rv == CKR_OK)
+			rv = p11_index_remove (index, object);
+
+		unlock_session (session, exclusive);
+	}
 
 	p11_debug ("out: 0x%lx", rv);
 
@@ -1001,19 +1065,16 @@ sys_C_GetObjectSize (CK_SESSION_HANDLE handle,
 
 	p11_debug ("in");
 
-	p11_lock ();
-
-		rv = lookup_session (handle, &session);
-		if (rv == CKR_OK) {
-			if (lookup_object_inlock (session, object, NULL)) {
-				*size = CK_UNAVAILABLE_INFORMATION;
-				rv = CKR_OK;
-			} else {
-				rv = CKR_OBJECT_HANDLE_INVALID;
-			}
+	rv = lock_session (handle, false, &session);
+	if (rv == CKR_OK) {
+		if (lookup_object_inlock (session, object, NULL)) {
+			*size = CK_UNAVAILABLE_INFORMATION;
+			rv = CKR_OK;
+		} else {
+			rv = CKR_OBJECT_HANDLE_INVALID;
 		}
-
-	p11_unlock ();
+		unlock_session (session, false);
+	}
 
 	p11_debug ("out: 0x%lx", rv);
 
@@ -1036,14 +1097,11 @@ sys_C_GetAttributeValue (CK_SESSION_HANDLE handle,
 
 	p11_debug ("in: %lu, %lu", handle, object);
 
-	p11_lock ();
-
-		rv = lookup_session (handle, &session);
-		if (rv == CKR_OK) {
-			attrs = lookup_object_inlock (session, object, NULL);
-			if (attrs == NULL)
-				rv = CKR_OBJECT_HANDLE_INVALID;
-		}
+	rv = lock_session (handle, false, &session);
+	if (rv == CKR_OK) {
+		attrs = lookup_object_inlock (session, object, NULL);
+		if (attrs == NULL)
+			rv = CKR_OBJECT_HANDLE_INVALID;
 
 		if (rv == CKR_OK) {
 			for (i = 0; i < count; i++) {
@@ -1071,7 +1129,8 @@ sys_C_GetAttributeValue (CK_SESSION_HANDLE handle,
 			}
 		}
 
-	p11_unlock ();
+		unlock_session (session, false);
+	}
 
 	if (p11_debugging) {
 		string = p11_attrs_to_string (template, count);
@@ -1091,190 +1150,322 @@ sys_C_SetAttributeValue (CK_SESSION_HANDLE handle,
 	p11_session *session;
 	CK_ATTRIBUTE *attrs;
 	p11_index *index;
+	bool exclusive;
 	CK_BBOOL val;
 	CK_RV rv;
 
 	p11_debug ("in");
 
-	p11_lock ();
+	rv = lock_session_for_object (handle, object, &session, &exclusive);
+	if (rv == CKR_OK) {
+		attrs = lookup_object_inlock (session, object, &index);
+		if (attrs == NULL) {
+			rv = CKR_OBJECT_HANDLE_INVALID;
+		} else if (p11_attrs_find_bool (attrs, CKA_MODIFIABLE, &val) && !val) {
+			/* TODO: This should be replaced with CKR_ACTION_PROHIBITED */
+			rv = CKR_ATTRIBUTE_READ_ONLY;
+		}
 
-		rv = lookup_session (handle, &session);
-		if (rv == CKR_OK) {
-			attrs = lookup_object_inlock (session, object, &index);
-			if (attrs == NULL) {
-				rv = CKR_OBJECT_HANDLE_INVALID;
-			} else if (p11_attrs_find_bool (attrs, CKA_MODIFIABLE, &val) && !val) {
-				/* TODO: This should be replaced with CKR_ACTION_PROHIBITED */
-				rv = CKR_ATTRIBUTE_READ_ONLY;
-			}
+		if (rv == CKR_OK)
+			rv = check_index_writable (session, index);
 
-			if (rv == CKR_OK)
-				rv = check_index_writable (session, index);
-
-			/* Reload the item if applicable */
-			if (rv == CKR_OK && index == p11_token_index (session->token)) {
-				if (p11_token_reload (session->token, attrs)) {
-					attrs = p11_index_lookup (index, object);
-					if (p11_attrs_find_bool (attrs, CKA_MODIFIABLE, &val) && !val) {
-						/* TODO: This should be replaced with CKR_ACTION_PROHIBITED */
-						rv = CKR_ATTRIBUTE_READ_ONLY;
-					}
+		/* Reload the item if applicable */
+		if (rv == CKR_OK && index == p11_token_index (session->token)) {
+			if (p11_token_reload (session->token, attrs)) {
+				attrs = p11_index_lookup (index, object);
+				if (p11_attrs_find_bool (attrs, CKA_MODIFIABLE, &val) && !val) {
+					/* TODO: This should be replaced with CKR_ACTION_PROHIBITED */
+					rv = CKR_ATTRIBUTE_READ_ONLY;
 				}
 			}
-
-			if (rv == CKR_OK)
-				rv = p11_index_set (index, object, template, count);
 		}
 
-	p11_unlock ();
+		if (rv == CKR_OK)
+			rv = p11_index_set (index, object, template, count);
+
+		unlock_session (session, exclusive);
+	}
 
 	p11_debug ("out: 0x%lx", rv);
 
 	return rv;
 }
 
-static CK_RV
-sys_C_FindObjectsInit (CK_SESSION_HANDLE handle,
-                       CK_ATTRIBUTE_PTR template,
-                       CK_ULONG count)
+/*
+ * Rough order in which attributes narrow down a search, most unique first.
+ * Matching fails early on these, and the index selects its buckets in this
+ * order too.
+ */
+static int
+match_selectivity (CK_ATTRIBUTE_TYPE type)
+{
+	switch (type) {
+	case CKA_VALUE:
+	case CKA_SERIAL_NUMBER:
+	case CKA_CERT_SHA1_HASH:
+	case CKA_CERT_MD5_HASH:
+	case CKA_ID:
+		return 0;
+	case CKA_ISSUER:
+	case CKA_SUBJECT:
+	case CKA_LABEL:
+	case CKA_OBJECT_ID:
+	case CKA_X_ORIGIN:
+		return 1;
+	case CKA_CLASS:
+	case CKA_CERTIFICATE_TYPE:
+	case CKA_CERTIFICATE_CATEGORY:
+	case CKA_TOKEN:
+	case CKA_PRIVATE:
+	case CKA_MODIFIABLE:
+	case CKA_TRUSTED:
+	case CKA_X_DISTRUSTED:
+		return 3;
+	default:
+		return 2;
+	}
+}
+
+/*
+ * WORKAROUND: NSS calls us asking for CKA_SERIAL_NUMBER items that are
+ * not DER encoded. It shouldn't be doing this. We never return any certificate
+ * serial numbers that are not DER encoded.
+ *
+ * So work around the issue here while the NSS guys fix this issue.
+ * This code should be removed in future versions.
+ *
+ * The DER encoded variant of the serial number is prepared once here,
+ * rather than for each object we try to match.
+ */
+static bool
+prepare_broken_nss_serial_number_lookups (CK_ATTRIBUTE *match,
+                                          CK_ATTRIBUTE *serial_der)
 {
-	p11_index *indices[2] = { NULL, NULL };
-	CK_BBOOL want_token_objects;
-	CK_BBOOL want_session_objects;
-	CK_BBOOL token;
-	FindObjects *find;
-	p11_session *session;
-	char *string;
-	CK_RV rv;
-	int n = 0;
+	unsigned char len[sizeof (CK_ULONG) + 1];
+	unsigned char *der;
+	int len_len;
 
-	if (p11_debugging) {
-		string = p11_attrs_to_string (template, count);
-		p11_debug ("in: %lu, %s", handle, string);
-		free (string);
-	}
+	if (!match->pValue || !match->ulValueLen ||
+	    match->ulValueLen == CKA_INVALID)
+		return true;
 
-	p11_lock ();
+	len_len = sizeof (len);
+	asn1_length_der (match->ulValueLen, len, &len_len);
+	assert (len_len <= sizeof (len));
 
-		/* Are we searching for token objects? */
-		if (p11_attrs_findn_bool (template, count, CKA_TOKEN, &token)) {
-			want_token_objects = token;
-			want_session_objects = !token;
-		} else {
-			want_token_objects = CK_TRUE;
-			want_session_objects = CK_TRUE;
-		}
+	der = malloc (1 + len_len + match->ulValueLen);
+	return_val_if_fail (der != NULL, false);
 
-		rv = lookup_session (handle, &session);
+	der[0] = ASN1_TAG_INTEGER | ASN1_CLASS_UNIVERSAL;
+	memcpy (der + 1, len, len_len);
+	memcpy (der + 1 + len_len, match->pValue, match->ulValueLen);
 
-		/* Refresh from disk if this session hasn't yet */
-		if (rv == CKR_OK) {
-			if (want_session_objects)
-				indices[n++] = session->index;
-			if (want_token_objects) {
-				if (!session->loaded)
-					p11_token_load (session->token);
-				session->loaded = CK_TRUE;
-				indices[n++] = p11_token_index (session->token);
-			}
+	serial_der->type = CKA_SERIAL_NUMBER;
+	serial_der->pValue = der;
+	serial_der->ulValueLen = 1 + len_len + match->ulValueLen;
+	return true;
+}
 
-			find = calloc (1, sizeof (FindObjects));
-			warn_if_fail (find != NULL);
+static void
+find_plan_cleanup (FindPlan *plan)
+{
+	p11_attrs_free (plan->match);
+	free (plan->serial_der.pValue);
+}
 
-			/* Make a snapshot of what we're matching */
-			if (find) {
-				find->match = p11_attrs_buildn (NULL, template, count);
-				warn_if_fail (find->match != NULL);
+static bool
+find_plan_init (FindPlan *plan,
+                CK_ATTRIBUTE *template,
+                CK_ULONG count)
+{
+	CK_ATTRIBUTE attr;
+	CK_ULONG i, j;
+
+	memset (plan, 0, sizeof (FindPlan));
+
+	plan->match = p11_attrs_buildn (NULL, template, count);
+	return_val_if_fail (plan->match != NULL, false);
+
+	/* A stable insertion sort, templates are short */
+	plan->count = p11_attrs_count (plan->match);
+	for (i = 1; i < plan->count; i++) {
+		attr = plan->match[i];
+		for (j = i; j > 0 && match_selectivity (plan->match[j - 1].type) >
+		                     match_selectivity (attr.type); j--)
+			plan->match[j] = plan->match[j - 1];
+		plan->match[j] = attr;
+	}
 
-				/* Build a session snapshot of all objects */
-				find->iterator = 0;
-				find->snapshot = p11_index_snapshot (indices[0], indices[1], template, count);
-				warn_if_fail (find->snapshot != NULL);
-			}
+	plan->serial = p11_attrs_find (plan->match, CKA_SERIAL_NUMBER);
+	if (plan->serial) {
+		if (!prepare_broken_nss_serial_number_lookups (plan->serial, &plan->serial_der)) {
+			find_plan_cleanup (plan);
+			return false;
+		}
+	}
+
+	return true;
+}
+
+static CK_ULONG
+find_plan_filter (FindPlan *plan,
+                  p11_session *session,
+                  CK_OBJECT_HANDLE *snapshot,
+                  bool nss_serial)
+{
+	CK_OBJECT_CLASS klass;
+	CK_ATTRIBUTE *attrs;
+	CK_ATTRIBUTE *match;
+	CK_ATTRIBUTE *attr;
+	CK_ULONG i, n;
 
-			if (!find || !find->snapshot || !find->match)
-				rv = CKR_HOST_MEMORY;
-			else
-				p11_session_set_operation (session, find_objects_free, find);
+	for (i = 0, n = 0; snapshot[i] != 0; i++) {
+		attrs = lookup_object_inlock (session, snapshot[i], NULL);
+		if (attrs == NULL)
+			continue;
+
+		for (match = plan->match; !p11_attrs_terminator (match); match++) {
+			attr = p11_attrs_find (attrs, match->type);
+			if (!attr || !p11_attr_equal (attr, match))
+				break;
 		}
 
-	p11_unlock ();
+		if (!p11_attrs_terminator (match))
+			continue;
 
-	p11_debug ("out: 0x%lx", rv);
+		/* See prepare_broken_nss_serial_number_lookups() */
+		if (nss_serial) {
+			if (!p11_attrs_find_ulong (attrs, CKA_CLASS, &klass) ||
+			    klass != CKO_NSS_TRUST)
+				continue;
+			p11_debug ("worked around serial number lookup that's not DER encoded");
+		}
 
-	return rv;
+		snapshot[n++] = snapshot[i];
+	}
+
+	snapshot[n] = 0;
+	return n;
 }
 
-static bool
-match_for_broken_nss_serial_number_lookups (CK_ATTRIBUTE *attr,
-                                            CK_ATTRIBUTE *match)
+/*
+ * Selects candidates from the indexes, and matches them all up front. This
+ * happens twice for a serial number that might not be DER encoded, the
+ * second time with the DER encoded variant in place.
+ */
+static CK_OBJECT_HANDLE *
+find_plan_snapshot (FindPlan *plan,
+                    p11_session *session,
+                    p11_index **indices)
 {
-	unsigned char der[32];
-	unsigned char *val_val;
-	size_t der_len;
-	size_t val_len;
-	int len_len;
+	CK_OBJECT_HANDLE *snapshot;
+	CK_OBJECT_HANDLE *variant;
+	CK_ATTRIBUTE original;
+	CK_ULONG num, more = 0;
 
-	if (!match->pValue || !match->ulValueLen ||
-	    match->ulValueLen == CKA_INVALID ||
-	    attr->ulValueLen == CKA_INVALID)
-		return false;
+	snapshot = p11_index_snapshot (indices[0], indices[1], plan->match, plan->count);
+	return_val_if_fail (snapshot != NULL, NULL);
+	num = find_plan_filter (plan, session, snapshot, false);
 
-	der_len = sizeof (der);
-	der[0] = ASN1_TAG_INTEGER | ASN1_CLASS_UNIVERSAL;
-	len_len = der_len - 1;
-	asn1_length_der (match->ulValueLen, der + 1, &len_len);
-	assert (len_len < (der_len - 1));
-	der_len = 1 + len_len;
+	if (!plan->serial_der.pValue)
+		return snapshot;
 
-	val_val = attr->pValue;
-	val_len = attr->ulValueLen;
+	memcpy (&original, plan->serial, sizeof (CK_ATTRIBUTE));
+	memcpy (plan->serial, &plan->serial_der, sizeof (CK_ATTRIBUTE));
 
-	if (der_len + match->ulValueLen != val_len)
-		return false;
+	variant = p11_index_snapshot (indices[0], indices[1], plan->match, plan->count);
+	if (variant)
+		more = find_plan_filter (plan, session, variant, true);
 
-	if (memcmp (der, val_val, der_len) != 0 ||
-	    memcmp (match->pValue, val_val + der_len, match->ulValueLen) != 0)
-		return false;
+	memcpy (plan->serial, &original, sizeof (CK_ATTRIBUTE));
 
-	p11_debug ("worked around serial number lookup that's not DER encoded");
-	return true;
+	return_val_if_fail (variant != NULL, snapshot);
+
+	if (more > 0) {
+		snapshot = realloc (snapshot, (num + more + 1) * sizeof (CK_OBJECT_HANDLE));
+		return_val_if_fail (snapshot != NULL, NULL);
+		memcpy (snapshot + num, variant, (more + 1) * sizeof (CK_OBJECT_HANDLE));
+	}
+
+	free (variant);
+	return snapshot;
 }
 
-static bool
-find_objects_match (CK_ATTRIBUTE *attrs,
-                    CK_ATTRIBUTE *match)
+static CK_RV
+sys_C_FindObjectsInit (CK_SESSION_HANDLE handle,
+                       CK_ATTRIBUTE_PTR template,
+                       CK_ULONG count)
 {
-	CK_OBJECT_CLASS klass;
-	CK_ATTRIBUTE *attr;
+	p11_index *indices[2] = { NULL, NULL };
+	CK_BBOOL want_token_objects;
+	CK_BBOOL want_session_objects;
+	CK_BBOOL token;
+	FindObjects *find;
+	p11_session *session;
+	bool exclusive;
+	FindPlan plan;
+	char *string;
+	CK_RV rv;
+	int n = 0;
 
-	for (; !p11_attrs_terminator (match); match++) {
-		attr = p11_attrs_find ((CK_ATTRIBUTE *)attrs, match->type);
-		if (!attr)
-			return false;
-		if (p11_attr_equal (attr, match))
-			continue;
+	if (p11_debugging) {
+		string = p11_attrs_to_string (template, count);
+		p11_debug ("in: %lu, %s", handle, string);
+		free (string);
+	}
 
-		/*
-		 * WORKAROUND: NSS calls us asking for CKA_SERIAL_NUMBER items that are
-		 * not DER encoded. It shouldn't be doing this. We never return any certificate
-		 * serial numbers that are not DER encoded.
-		 *
-		 * So work around the issue here while the NSS guys fix this issue.
-		 * This code should be removed in future versions.
-		 */
+	/* Are we searching for token objects? */
+	if (p11_attrs_findn_bool (template, count, CKA_TOKEN, &token)) {
+		want_token_objects = token;
+		want_session_objects = !token;
+	} else {
+		want_token_objects = CK_TRUE;
+		want_session_objects = CK_TRUE;
+	}
 
-		if (attr->type == CKA_SERIAL_NUMBER &&
-		    p11_attrs_find_ulong (attrs, CKA_CLASS, &klass) &&
-		    klass == CKO_NSS_TRUST) {
-			if (match_for_broken_nss_serial_number_lookups (attr, match))
-				continue;
+	exclusive = false;
+	rv = lock_session (handle, exclusive, &session);
+
+	/* Refresh from disk if this session hasn't yet, which changes the token */
+	if (rv == CKR_OK && want_token_objects && !session->loaded) {
+		unlock_session (session, exclusive);
+		exclusive = true;
+		rv = lock_session (handle, exclusive, &session);
+		if (rv == CKR_OK && !session->loaded) {
+			p11_token_load (session->token);
+			session->loaded = CK_TRUE;
 		}
+	}
 
-		return false;
+	if (rv == CKR_OK) {
+		if (want_session_objects)
+			indices[n++] = session->index;
+		if (want_token_objects)
+			indices[n++] = p11_token_index (session->token);
+
+		find = calloc (1, sizeof (FindObjects));
+		warn_if_fail (find != NULL);
+
+		/* Match everything up front, FindObjects just hands out the handles */
+		if (find && find_plan_init (&plan, template, count)) {
+			find->iterator = 0;
+			find->snapshot = find_plan_snapshot (&plan, session, indices);
+			find_plan_cleanup (&plan);
+		}
+
+		if (!find || !find->snapshot) {
+			free (find);
+			rv = CKR_HOST_MEMORY;
+		} else {
+			p11_session_set_operation (session, find_objects_free, find);
+		}
+
+		unlock_session (session, exclusive);
 	}
 
-	return true;
+	p11_debug ("out: 0x%lx", rv);
+
+	return rv;
 }
 
 static CK_RV
@@ -1284,25 +1475,20 @@ sys_C_FindObjects (CK_SESSION_HANDLE handle,
                    CK_ULONG_PTR count)
 {
 	CK_OBJECT_HANDLE object;
-	CK_ATTRIBUTE *attrs;
 	FindObjects *find = NULL;
 	p11_session *session;
 	CK_ULONG matched;
-	p11_index *index;
 	CK_RV rv;
 
 	return_val_if_fail (count != NULL, CKR_ARGUMENTS_BAD);
 
 	p11_debug ("in: %lu, %lu", handle, max_count);
 
-	p11_lock ();
-
-		rv = lookup_session (handle, &session);
-		if (rv == CKR_OK) {
-			if (session->cleanup != find_objects_free)
-				rv = CKR_OPERATION_NOT_INITIALIZED;
-			find = session->operation;
-		}
+	rv = lock_session (handle, false, &session);
+	if (rv == CKR_OK) {
+		if (session->cleanup != find_objects_free)
+			rv = CKR_OPERATION_NOT_INITIALIZED;
+		find = session->operation;
 
 		if (rv == CKR_OK) {
 			matched = 0;
@@ -1313,20 +1499,19 @@ sys_C_FindObjects (CK_SESSION_HANDLE handle,
 
 				find->iterator++;
 
-				attrs = lookup_object_inlock (session, object, &index);
-				if (attrs == NULL)
+				/* Skip objects destroyed since FindObjectsInit */
+				if (lookup_object_inlock (session, object, NULL) == NULL)
 					continue;
 
-				if (find_objects_match (attrs, find->match)) {
-					objects[matched] = object;
-					matched++;
-				}
+				objects[matched] = object;
+				matched++;
 			}
 
 			*count = matched;
 		}
 
-	p11_unlock ();
+		unlock_session (session, false);
+	}
 
 	p11_debug ("out: 0x%lx, %lu", handle, *count);
 
@@ -1341,17 +1526,14 @@ sys_C_FindObjectsFinal (CK_SESSION_HANDLE handle)
 
 	p11_debug ("in");
 
-	p11_lock ();
-
-		rv = lookup_session (handle, &session);
-		if (rv == CKR_OK) {
-			if (session->cleanup != find_objects_free)
-				rv = CKR_OPERATION_NOT_INITIALIZED;
-			else
-				p11_session_set_operation (session, NULL, NULL);
-		}
-
-	p11_unlock ();
+	rv = lock_session (handle, false, &session);
+	if (rv == CKR_OK) {
+		if (session->cleanup != find_objects_free)
+			rv = CKR_OPERATION_NOT_INITIALIZED;
+		else
+			p11_session_set_operation (session, NULL, NULL);
+		unlock_session (session, false);
+	}
 
 	p11_debug ("out: 0x%lx", rv);
 
@@ -1779,7 +1961,14 @@ CK_ULONG
 p11_module_next_id (void)
 {
 	static CK_ULONG unique = 0x10;
-	return (unique)++;
+	CK_ULONG id;
+
+	/* Session objects are created with the module lock only shared */
+	p11_lock ();
+	id = (unique)++;
+	p11_unlock ();
+
+	return id;
 }
 
 #ifdef OS_UNIX
@@ -1795,6 +1984,7 @@ void
 p11_trust_module_init (void)
 {
 	p11_library_init_once ();
+	p11_rwlock_init (&gl.lock);
 }
 
 #ifdef __GNUC__
@@ -1803,6 +1993,7 @@ __attribute__((destructor))
 void
 p11_trust_module_fini (void)
 {
+	p11_rwlock_uninit (&gl.lock);
 	p11_library_uninit ();
 }
 
@@ -1820,11 +2011,13 @@ DllMain (HINSTANCE instance,
 	switch (reason) {
 	case DLL_PROCESS_ATTACH:
 		p11_library_init ();
+		p11_rwlock_init (&gl.lock);
 		break;
 	case DLL_THREAD_DETACH:
 		p11_library_thread_cleanup ();
 		break;
 	case DLL_PROCESS_DETACH:
+		p11_rwlock_uninit (&gl.lock);
 		p11_library_uninit ();
 		break;
 	default:
@@ -59,7 +59,6 @@
 #define PERSIST_HEADER "p11-kit-object-v1"
 
 struct _p11_persist {
-	p11_dict *constants;
 	node_asn *asn1_defs;
 };
 
@@ -78,9 +77,6 @@ p11_persist_new (void)
 	persist = calloc (1, sizeof (p11_persist));
 	return_val_if_fail (persist != NULL, NULL);
 
-	persist->constants = p11_constant_reverse (true);
-	return_val_if_fail (persist->constants != NULL, NULL);
-
 	return persist;
 }
 
@@ -89,7 +85,6 @@ p11_persist_free (p11_persist *persist)
 {
 	if (!persist)
 		return;
-	p11_dict_free (persist->constants);
 	asn1_delete_structure (&persist->asn1_defs);
 	free (persist);
 }
@@ -99,6 +94,33 @@ struct constant {
 	const char *string;
 };
 
+/*
+ * The lexer hands us slices of the input that aren't null terminated.
+ * Numbers, attribute names and oids are short, and are copied onto the stack
+ * when a terminated string is needed.
+ */
+static bool
+slice_terminate (const char *data,
+                 size_t length,
+                 char *buf,
+                 size_t size)
+{
+	if (length >= size)
+		return false;
+	memcpy (buf, data, length);
+	buf[length] = '\0';
+	return true;
+}
+
+static bool
+slice_equal (const char *data,
+             size_t length,
+             const char *string)
+{
+	return strlen (string) == length &&
+	       memcmp (data, string, length) == 0;
+}
+
 static bool
 parse_string (p11_lexer *lexer,
               CK_ATTRIBUTE *attr)
@@ -109,7 +131,7 @@ parse_string (p11_lexer *lexer,
 	unsigned char *data;
 
 	value = lexer->tok.field.value;
-	end = value + strlen (value);
+	end = value + lexer->tok.field.value_len;
 
 	/* Not a string/binary value */
 	if (value == end || value[0] != '\"' || *(end - 1) != '\"')
@@ -146,12 +168,13 @@ parse_bool (p11_lexer *lexer,
             CK_ATTRIBUTE *attr)
 {
 	const char *value = lexer->tok.field.value;
+	size_t length = lexer->tok.field.value_len;
 	CK_BBOOL boolean;
 
-	if (strcmp (value, "true") == 0) {
+	if (slice_equal (value, length, "true")) {
 		boolean = CK_TRUE;
 
-	} else if (strcmp (value, "false") == 0) {
+	} else if (slice_equal (value, length, "false")) {
 		boolean = CK_FALSE;
 
 	} else {
@@ -220,11 +243,16 @@ static bool
 parse_ulong (p11_lexer *lexer,
              CK_ATTRIBUTE *attr)
 {
+	char string[sizeof (CK_ULONG) * 4];
 	unsigned long value;
 	char *end;
 
+	if (!slice_terminate (lexer->tok.field.value, lexer->tok.field.value_len,
+	                      string, sizeof (string)))
+		return false;
+
 	end = NULL;
-	value = strtoul (lexer->tok.field.value, &end, 10);
+	value = strtoul (string, &end, 10);
 
 	/* Not a valid number value */
 	if (!end || *end != '\0')
@@ -303,7 +331,8 @@ parse_constant (p11_persist *persist,
 {
 	CK_ULONG value;
 
-	value = p11_constant_resolve (persist->constants, lexer->tok.field.value);
+	value = p11_constant_lookup (true, lexer->tok.field.value,
+	                             lexer->tok.field.value_len);
 
 	/* Not a valid constant */
 	if (value == CKA_INVALID)
@@ -386,13 +415,14 @@ parse_oid (p11_persist *persist,
            CK_ATTRIBUTE *attr)
 {
 	char message[ASN1_MAX_ERROR_DESCRIPTION_SIZE] = { 0, };
+	char value[1024];
 	node_asn *asn;
 	size_t length;
-	char *value;
 	int ret;
 
-	value = lexer->tok.field.value;
-	length = strlen (value);
+	length = lexer->tok.field.value_len;
+	if (!slice_terminate (lexer->tok.field.value, length, value, sizeof (value)))
+		return false;
 
 	/* Not an OID value? */
 	if (length < 4 ||
@@ -519,14 +549,21 @@ field_to_attribute (p11_persist *persist,
                     CK_ATTRIBUTE **attrs)
 {
 	CK_ATTRIBUTE attr = { 0, };
+	char name[128];
 	char *end;
 
+	if (!slice_terminate (lexer->tok.field.name, lexer->tok.field.name_len,
+	                      name, sizeof (name))) {
+		p11_lexer_msg (lexer, "invalid or unsupported attribute");
+		return false;
+	}
+
 	end = NULL;
-	attr.type = strtoul (lexer->tok.field.name, &end, 10);
+	attr.type = strtoul (name, &end, 10);
 
 	/* Not a valid number value, probably a constant */
 	if (!end || *end != '\0') {
-		attr.type = p11_constant_resolve (persist->constants, lexer->tok.field.name);
+		attr.type = p11_constant_lookup (true, name, strlen (name));
 		if (attr.type == CKA_INVALID || !p11_constant_name (p11_constant_types, attr.type)) {
 			p11_lexer_msg (lexer, "invalid or unsupported attribute");
 			return false;
@@ -638,14 +675,15 @@ p11_persist_read (p11_persist *persist,
 	attrs = NULL;
 	failed = false;
 
-	p11_lexer_init (&lexer, filename, (const char *)data, length);
+	p11_lexer_init_full (&lexer, filename, (const char *)data, length, P11_LEXER_SLICES);
 	while (p11_lexer_next (&lexer, &failed)) {
 		switch (lexer.tok_type) {
 		case TOK_SECTION:
 			if (attrs && !p11_array_push (objects, attrs))
 				return_val_if_reached (false);
 			attrs = NULL;
-			if (strcmp (lexer.tok.section.name, PERSIST_HEADER) != 0) {
+			if (!slice_equal (lexer.tok.section.name, lexer.tok.section.name_len,
+			                  PERSIST_HEADER)) {
 				p11_lexer_msg (&lexer, "unrecognized or invalid section header");
 				skip = true;
 			} else {
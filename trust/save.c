@@ -45,23 +45,53 @@
 #include <assert.h>
 #include <dirent.h>
 #include <errno.h>
+#include <fcntl.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
 
+/*
+ * Directories are built up in a staging directory next to the
+ * destination, with files created relative to the staging directory.
+ * When finished the staging directory is swapped into place.
+ */
+#if defined (OS_UNIX) && defined (HAVE_OPENAT) && defined (HAVE_FDOPENDIR)
+#define WITH_STAGING 1
+#endif
+
+#ifdef __linux__
+#include <sys/syscall.h>
+#ifdef HAVE_SYS_XATTR_H
+#include <sys/xattr.h>
+#endif
+#ifndef RENAME_EXCHANGE
+#define RENAME_EXCHANGE (1 << 1)
+#endif
+#endif
+
 struct _p11_save_file {
 	char *bare;
 	char *extension;
 	char *temp;
 	int fd;
 	int flags;
+
+	/* When staged in a directory */
+	p11_save_dir *dir;
+	char *name;
 };
 
 struct _p11_save_dir {
 	p11_dict *cache;
 	char *path;
 	int flags;
+
+	/* The staging directory, when staging */
+	char *staging;
+	char *target;
+	int fd;
+	bool exists;
 };
 
 static char *   make_unique_name    (const char *bare,
@@ -157,15 +187,149 @@ p11_save_write (p11_save_file *file,
 	return true;
 }
 
+/*
+ * These don't change where p11_save_write() writes next. They're used to
+ * go back and fill in parts of a file whose values weren't known when
+ * they were written, like counts and checksums.
+ */
+bool
+p11_save_write_at (p11_save_file *file,
+                   off_t offset,
+                   const void *data,
+                   size_t length)
+{
+	const unsigned char *buf = data;
+	size_t written = 0;
+	ssize_t res;
+#ifndef HAVE_PWRITE
+	off_t at;
+#endif
+
+	if (!file)
+		return false;
+
+#ifndef HAVE_PWRITE
+	at = lseek (file->fd, 0, SEEK_CUR);
+	if (at < 0 || lseek (file->fd, offset, SEEK_SET) < 0) {
+		p11_message_err (errno, "couldn't seek in file: %s", file->temp);
+		return false;
+	}
+#endif
+
+	while (written < length) {
+#ifdef HAVE_PWRITE
+		res = pwrite (file->fd, buf + written, length - written, offset + written);
+#else
+		res = write (file->fd, buf + written, length - written);
+#endif
+		if (res <= 0) {
+			if (errno == EAGAIN || errno == EINTR)
+				continue;
+			p11_message_err (errno, "couldn't write to file: %s", file->temp);
+			return false;
+		} else {
+			written += res;
+		}
+	}
+
+#ifndef HAVE_PWRITE
+	if (lseek (file->fd, at, SEEK_SET) < 0) {
+		p11_message_err (errno, "couldn't seek in file: %s", file->temp);
+		return false;
+	}
+#endif
+
+	return true;
+}
+
+ssize_t
+p11_save_read_at (p11_save_file *file,
+                  off_t offset,
+                  void *data,
+                  size_t length)
+{
+	ssize_t res;
+#ifndef HAVE_PREAD
+	off_t at;
+#endif
+
+	if (!file)
+		return -1;
+
+#ifndef HAVE_PREAD
+	at = lseek (file->fd, 0, SEEK_CUR);
+	if (at < 0 || lseek (file->fd, offset, SEEK_SET) < 0) {
+		p11_message_err (errno, "couldn't seek in file: %s", file->temp);
+		return -1;
+	}
+#endif
+
+	for (;;) {
+#ifdef HAVE_PREAD
+		res = pread (file->fd, data, length, offset);
+#else
+		res = read (file->fd, data, length);
+#endif
+		if (res >= 0 || (errno != EAGAIN && errno != EINTR))
+			break;
+	}
+
+	if (res < 0)
+		p11_message_err (errno, "couldn't read from file: %s", file->temp);
+
+#ifndef HAVE_PREAD
+	if (lseek (file->fd, at, SEEK_SET) < 0) {
+		p11_message_err (errno, "couldn't seek in file: %s", file->temp);
+		return -1;
+	}
+#endif
+
+	return res;
+}
+
 static void
 filo_free (p11_save_file *file)
 {
 	free (file->temp);
 	free (file->bare);
 	free (file->extension);
+	free (file->name);
 	free (file);
 }
 
+#ifdef WITH_STAGING
+
+static bool
+finish_staged_file (p11_save_file *file,
+                    char **path_out,
+                    bool commit)
+{
+	bool ret = true;
+
+	if (!commit) {
+		close (file->fd);
+		unlinkat (file->dir->fd, file->name, 0);
+		filo_free (file);
+		return true;
+	}
+
+	/* The file was created in the staging directory with its final name */
+	if (close (file->fd) < 0) {
+		p11_message_err (errno, "couldn't write file: %s", file->temp);
+		ret = false;
+	}
+
+	if (ret && path_out) {
+		*path_out = file->bare;
+		file->bare = NULL;
+	}
+
+	filo_free (file);
+	return ret;
+}
+
+#endif /* WITH_STAGING */
+
 #ifdef OS_UNIX
 
 static int
@@ -215,6 +379,11 @@ p11_save_finish_file (p11_save_file *file,
 	if (!file)
 		return false;
 
+#ifdef WITH_STAGING
+	if (file->dir)
+		return finish_staged_file (file, path_out, commit);
+#endif
+
 	if (!commit) {
 		close (file->fd);
 		unlink (file->temp);
@@ -306,12 +475,26 @@ p11_save_open_directory (const char *path,
 {
 #ifdef OS_UNIX
 	struct stat sb;
+#endif
+#ifdef WITH_STAGING
+	size_t len;
 #endif
 	p11_save_dir *dir;
+	bool exists = false;
 
 	return_val_if_fail (path != NULL, NULL);
 
-#ifdef OS_UNIX
+#ifdef WITH_STAGING
+	/* The directory is created when we finish writing */
+	if (stat (path, &sb) >= 0) {
+		if (!S_ISDIR (sb.st_mode)) {
+			p11_message ("not a directory: %s", path);
+			return NULL;
+		}
+		errno = EEXIST;
+	}
+	if (errno != ENOENT) {
+#elif defined (OS_UNIX)
 	/* We update the permissions when we finish writing */
 	if (mkdir (path, S_IRWXU) < 0) {
 #else /* OS_WIN32 */
@@ -326,6 +509,7 @@ p11_save_open_directory (const char *path,
 			p11_message ("directory already exists: %s", path);
 			return NULL;
 		}
+		exists = true;
 #ifdef OS_UNIX
 		/*
 		 * If the directory exists on unix, we may have restricted
@@ -352,6 +536,46 @@ p11_save_open_directory (const char *path,
 	return_val_if_fail (dir->cache != NULL, NULL);
 
 	dir->flags = flags;
+	dir->exists = exists;
+	dir->fd = -1;
+
+#ifdef WITH_STAGING
+	/* If the path is a symlink, the directory it points to is replaced */
+	if (exists) {
+		dir->target = realpath (path, NULL);
+		if (dir->target == NULL) {
+			p11_message_err (errno, "couldn't resolve directory: %s", path);
+			p11_save_finish_directory (dir, false);
+			return NULL;
+		}
+	} else {
+		dir->target = strdup (path);
+		return_val_if_fail (dir->target != NULL, NULL);
+	}
+
+	/* Staged next to the directory, so without any trailing slashes */
+	len = strlen (dir->target);
+	while (len > 1 && dir->target[len - 1] == '/')
+		dir->target[--len] = '\0';
+
+	if (asprintf (&dir->staging, "%s.XXXXXX", dir->target) < 0)
+		return_val_if_reached (NULL);
+
+	if (!mkdtemp (dir->staging)) {
+		p11_message_err (errno, "couldn't create directory: %s", path);
+		p11_save_finish_directory (dir, false);
+		return NULL;
+	}
+
+	dir->fd = open (dir->staging, O_RDONLY | O_DIRECTORY);
+	if (dir->fd < 0) {
+		p11_message_err (errno, "couldn't open directory: %s", dir->staging);
+		rmdir (dir->staging);
+		p11_save_finish_directory (dir, false);
+		return NULL;
+	}
+#endif /* WITH_STAGING */
+
 	return dir;
 }
 
@@ -432,6 +656,48 @@ on_unique_check_dir (void *data,
 	return 0; /* Keep looking */
 }
 
+#ifdef WITH_STAGING
+
+static p11_save_file *
+open_staged_file (p11_save_dir *dir,
+                  const char *name,
+                  const char *path)
+{
+	p11_save_file *file;
+	int fd;
+
+	/* Nobody else writes to the staging directory, so no temp file */
+	fd = openat (dir->fd, name, O_RDWR | O_CREAT | O_EXCL, S_IRUSR | S_IRGRP | S_IROTH);
+	if (fd < 0) {
+		p11_message_err (errno, "couldn't create file: %s", path);
+		return NULL;
+	}
+
+	/* Set the mode of the file regardless of umask */
+	if (fchmod (fd, S_IRUSR | S_IRGRP | S_IROTH) < 0) {
+		p11_message_err (errno, "couldn't set file permissions: %s", path);
+		close (fd);
+		unlinkat (dir->fd, name, 0);
+		return NULL;
+	}
+
+	file = calloc (1, sizeof (p11_save_file));
+	return_val_if_fail (file != NULL, NULL);
+	file->bare = strdup (path);
+	return_val_if_fail (file->bare != NULL, NULL);
+	file->name = strdup (name);
+	return_val_if_fail (file->name != NULL, NULL);
+	if (asprintf (&file->temp, "%s/%s", dir->staging, name) < 0)
+		return_val_if_reached (NULL);
+	file->flags = dir->flags;
+	file->dir = dir;
+	file->fd = fd;
+
+	return file;
+}
+
+#endif /* WITH_STAGING */
+
 p11_save_file *
 p11_save_open_file_in (p11_save_dir *dir,
                        const char *basename,
@@ -450,7 +716,11 @@ p11_save_open_file_in (p11_save_dir *dir,
 	if (asprintf (&path, "%s/%s", dir->path, name) < 0)
 		return_val_if_reached (NULL);
 
+#ifdef WITH_STAGING
+	file = open_staged_file (dir, name, path);
+#else
 	file = p11_save_open_file (path, NULL, dir->flags);
+#endif
 
 	if (file) {
 		if (!p11_dict_set (dir->cache, name, name))
@@ -486,9 +756,13 @@ p11_save_symlink_in (p11_save_dir *dir,
 	if (asprintf (&path, "%s/%s", dir->path, name) < 0)
 		return_val_if_reached (false);
 
+#ifdef WITH_STAGING
+	if (symlinkat (destination, dir->fd, name) < 0) {
+#else
 	unlink (path);
 
 	if (symlink (destination, path) < 0) {
+#endif
 		p11_message_err (errno, "couldn't create symlink: %s", path);
 		ret = false;
 	} else {
@@ -562,6 +836,283 @@ cleanup_directory (const char *directory,
 	return ret;
 }
 
+#ifdef WITH_STAGING
+
+/* Removes the files in a directory, and the directory if empty */
+static bool
+remove_directory (const char *path,
+                  int fd)
+{
+	struct dirent *dp;
+	DIR *dir;
+	bool ret = true;
+
+	fd = dup (fd);
+	if (fd < 0 || (dir = fdopendir (fd)) == NULL) {
+		p11_message_err (errno, "couldn't list directory: %s", path);
+		if (fd >= 0)
+			close (fd);
+		return false;
+	}
+
+	/* The duplicate shares its offset with the original */
+	rewinddir (dir);
+
+	while ((dp = readdir (dir)) != NULL) {
+		if (strcmp (dp->d_name, ".") == 0 || strcmp (dp->d_name, "..") == 0)
+			continue;
+		if (unlinkat (fd, dp->d_name, 0) < 0 && errno != ENOENT) {
+			p11_message_err (errno, "couldn't remove file: %s/%s", path, dp->d_name);
+			ret = false;
+		}
+	}
+
+	closedir (dir);
+
+	if (ret && rmdir (path) < 0) {
+		p11_message_err (errno, "couldn't remove directory: %s", path);
+		ret = false;
+	}
+
+	return ret;
+}
+
+/* Move subdirectories of the replaced directory into the new one */
+static bool
+move_subdirectories (p11_save_dir *dir,
+                     int fd)
+{
+	struct dirent *dp;
+	struct stat st;
+	DIR *old;
+	bool ret = true;
+
+	fd = dup (fd);
+	if (fd < 0 || (old = fdopendir (fd)) == NULL) {
+		p11_message_err (errno, "couldn't list directory: %s", dir->staging);
+		if (fd >= 0)
+			close (fd);
+		return false;
+	}
+
+	rewinddir (old);
+
+	while ((dp = readdir (old)) != NULL) {
+		if (strcmp (dp->d_name, ".") == 0 || strcmp (dp->d_name, "..") == 0 ||
+		    p11_dict_get (dir->cache, dp->d_name))
+			continue;
+		if (fstatat (fd, dp->d_name, &st, 0) < 0 || !S_ISDIR (st.st_mode))
+			continue;
+		if (renameat (fd, dp->d_name, dir->fd, dp->d_name) < 0) {
+			p11_message_err (errno, "couldn't move directory: %s/%s", dir->path, dp->d_name);
+			ret = false;
+		}
+	}
+
+	closedir (old);
+	return ret;
+}
+
+/* Moves the staged files one by one, when we can't swap directories */
+static bool
+move_staged_files (p11_save_dir *dir)
+{
+	p11_dictiter iter;
+	char *name;
+	int fd;
+	bool ret;
+
+	fd = open (dir->path, O_RDONLY | O_DIRECTORY);
+	if (fd < 0) {
+		p11_message_err (errno, "couldn't open directory: %s", dir->path);
+		return false;
+	}
+
+	ret = true;
+	p11_dict_iterate (dir->cache, &iter);
+	while (ret && p11_dict_next (&iter, (void **)&name, NULL)) {
+		if (renameat (dir->fd, name, fd, name) < 0 && errno != ENOENT) {
+			p11_message_err (errno, "couldn't complete writing file: %s/%s", dir->path, name);
+			ret = false;
+		}
+	}
+
+	close (fd);
+
+	if (ret)
+		ret = cleanup_directory (dir->path, dir->cache);
+	if (ret)
+		ret = remove_directory (dir->staging, dir->fd);
+	return ret;
+}
+
+#ifdef SYS_renameat2
+
+#ifdef HAVE_SYS_XATTR_H
+
+static char *
+list_attributes (const char *path,
+                 int fd,
+                 ssize_t *len)
+{
+	char *names;
+
+	*len = path ? listxattr (path, NULL, 0) : flistxattr (fd, NULL, 0);
+	if (*len < 0)
+		return NULL;
+
+	names = malloc (*len + 1);
+	return_val_if_fail (names != NULL, NULL);
+
+	*len = path ? listxattr (path, names, *len) : flistxattr (fd, names, *len);
+	if (*len < 0) {
+		free (names);
+		return NULL;
+	}
+
+	return names;
+}
+
+static bool
+has_attribute (const char *names,
+               ssize_t len,
+               const char *name)
+{
+	ssize_t at;
+
+	for (at = 0; at < len; at += strlen (names + at) + 1) {
+		if (strcmp (names + at, name) == 0)
+			return true;
+	}
+
+	return false;
+}
+
+/* Extended attributes hold ACLs and security labels, among others */
+static bool
+copy_extended_attributes (p11_save_dir *dir)
+{
+	char *names = NULL;
+	char *staged = NULL;
+	char *value = NULL;
+	ssize_t names_len;
+	ssize_t staged_len;
+	ssize_t len;
+	ssize_t at;
+	bool ret = false;
+
+	names = list_attributes (dir->target, -1, &names_len);
+	staged = list_attributes (NULL, dir->fd, &staged_len);
+	if (names == NULL || staged == NULL)
+		goto out;
+
+	/* Such as a default ACL inherited from the parent */
+	for (at = 0; at < staged_len; at += strlen (staged + at) + 1) {
+		if (!has_attribute (names, names_len, staged + at) &&
+		    fremovexattr (dir->fd, staged + at) < 0)
+			goto out;
+	}
+
+	for (at = 0; at < names_len; at += strlen (names + at) + 1) {
+		len = getxattr (dir->target, names + at, NULL, 0);
+		if (len < 0)
+			goto out;
+		free (value);
+		value = malloc (len + 1);
+		return_val_if_fail (value != NULL, false);
+		len = getxattr (dir->target, names + at, value, len);
+		if (len < 0 || fsetxattr (dir->fd, names + at, value, len, 0) < 0)
+			goto out;
+	}
+
+	ret = true;
+
+out:
+	free (names);
+	free (staged);
+	free (value);
+	return ret;
+}
+
+#endif /* HAVE_SYS_XATTR_H */
+
+/*
+ * Before swapping, make the new directory look like the one it
+ * replaces, apart from its permissions, which are set when finished.
+ * If that isn't possible, the old directory is kept and filled instead.
+ */
+static bool
+copy_directory_attributes (p11_save_dir *dir)
+{
+	struct stat old;
+	struct stat sb;
+
+	if (stat (dir->target, &old) < 0 || fstat (dir->fd, &sb) < 0)
+		return false;
+
+	if ((old.st_uid != sb.st_uid || old.st_gid != sb.st_gid) &&
+	    fchown (dir->fd, old.st_uid, old.st_gid) < 0)
+		return false;
+
+#ifdef HAVE_SYS_XATTR_H
+	if (!copy_extended_attributes (dir))
+		return false;
+#endif
+
+	return true;
+}
+
+#endif /* SYS_renameat2 */
+
+static bool
+finish_staged_directory (p11_save_dir *dir)
+{
+#ifdef SYS_renameat2
+	bool ret;
+	int fd;
+#endif
+
+#ifdef SYS_syncfs
+	/* One pass to flush everything we wrote */
+	syscall (SYS_syncfs, dir->fd);
+#endif
+
+	if (!dir->exists) {
+		if (rename (dir->staging, dir->target) == 0)
+			return true;
+
+		/* Somebody else created it in the meantime */
+		if (errno != EEXIST && errno != ENOTEMPTY) {
+			p11_message_err (errno, "couldn't complete writing directory: %s", dir->path);
+			return false;
+		} else if (!(dir->flags & P11_SAVE_OVERWRITE)) {
+			p11_message ("directory already exists: %s", dir->path);
+			return false;
+		}
+	}
+
+#ifdef SYS_renameat2
+	/* Atomically swap the new directory into place, and remove the old one */
+	if (copy_directory_attributes (dir) &&
+	    syscall (SYS_renameat2, AT_FDCWD, dir->staging,
+	             AT_FDCWD, dir->target, RENAME_EXCHANGE) == 0) {
+		fd = open (dir->staging, O_RDONLY | O_DIRECTORY);
+		if (fd < 0) {
+			p11_message_err (errno, "couldn't open directory: %s", dir->staging);
+			return false;
+		}
+		ret = move_subdirectories (dir, fd) &&
+		      remove_directory (dir->staging, fd);
+		close (fd);
+		return ret;
+	}
+#endif
+
+	return move_staged_files (dir);
+}
+
+#endif /* WITH_STAGING */
+
 bool
 p11_save_finish_directory (p11_save_dir *dir,
                            bool commit)
@@ -571,21 +1122,34 @@ p11_save_finish_directory (p11_save_dir *dir,
 	if (!dir)
 		return false;
 
-	if (commit) {
-		if (dir->flags & P11_SAVE_OVERWRITE)
-			ret = cleanup_directory (dir->path, dir->cache);
+#ifdef WITH_STAGING
+	if (dir->fd >= 0) {
+		if (commit) {
+			ret = finish_staged_directory (dir);
+		} else {
+			remove_directory (dir->staging, dir->fd);
+		}
+		close (dir->fd);
+	} else if (dir->staging && commit) {
+		ret = false;
+	}
+#else
+	if (commit && (dir->flags & P11_SAVE_OVERWRITE))
+		ret = cleanup_directory (dir->path, dir->cache);
+#endif
 
 #ifdef OS_UNIX
-		/* Try to set the mode of the directory to readable */
-		if (ret && chmod (dir->path, S_IRUSR | S_IXUSR | S_IRGRP |
-		                             S_IXGRP | S_IROTH | S_IXOTH) < 0) {
-			p11_message_err (errno, "couldn't set directory permissions: %s", dir->path);
-			ret = false;
-		}
-#endif /* OS_UNIX */
+	/* Try to set the mode of the directory to readable */
+	if (commit && ret && chmod (dir->path, S_IRUSR | S_IXUSR | S_IRGRP |
+	                                       S_IXGRP | S_IROTH | S_IXOTH) < 0) {
+		p11_message_err (errno, "couldn't set directory permissions: %s", dir->path);
+		ret = false;
 	}
+#endif /* OS_UNIX */
 
 	p11_dict_free (dir->cache);
+	free (dir->staging);
+	free (dir->target);
 	free (dir->path);
 	free (dir);
 
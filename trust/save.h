@@ -53,6 +53,16 @@ bool             p11_save_write             (p11_save_file *file,
                                              const void *data,
                                              ssize_t length);
 
+bool             p11_save_write_at          (p11_save_file *file,
+                                             off_t offset,
+                                             const void *data,
+                                             size_t length);
+
+ssize_t          p11_save_read_at           (p11_save_file *file,
+                                             off_t offset,
+                                             void *data,
+                                             size_t length);
+
 bool             p11_save_write_and_finish  (p11_save_file *file,
                                              const void *data,
                                              ssize_t length);
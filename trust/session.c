@@ -57,6 +57,7 @@ p11_session_new (p11_token *token)
 	return_val_if_fail (session != NULL, NULL);
 
 	session->handle = p11_module_next_id ();
+	p11_mutex_init (&session->lock);
 
 	session->builder = p11_builder_new (P11_BUILDER_FLAG_NONE);
 	return_val_if_fail (session->builder, NULL);
@@ -77,8 +78,14 @@ p11_session_free (void *data)
 	p11_session *session = data;
 
 	p11_session_set_operation (session, NULL, NULL);
+
+	/* Changes made through the session are flushed to disk */
+	if (session->batch)
+		p11_token_commit (session->token);
+
 	p11_builder_free (session->builder);
 	p11_index_free (session->index);
+	p11_mutex_uninit (&session->lock);
 
 	free (session);
 }
@@ -33,6 +33,7 @@
  */
 
 #include "builder.h"
+#include "compat.h"
 #include "index.h"
 #include "pkcs11.h"
 #include "token.h"
@@ -44,11 +45,16 @@ typedef void (* p11_session_cleanup) (void *data);
 
 typedef struct {
 	CK_SESSION_HANDLE handle;
+
+	/* Held while using the fields below, along with the module lock shared */
+	p11_mutex_t lock;
+
 	p11_index *index;
 	p11_builder *builder;
 	p11_token *token;
 	CK_BBOOL loaded;
 	bool read_write;
+	bool batch;
 
 	/* Used by various operations */
 	p11_session_cleanup cleanup;
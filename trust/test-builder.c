@@ -2179,6 +2179,90 @@ test_changed_staple_ku (void)
 	test_check_attrs (nss_trust_ds_and_np, attrs);
 }
 
+static void
+test_changed_transaction (void)
+{
+	CK_ATTRIBUTE attached[] = {
+		{ CKA_CLASS, &certificate_extension, sizeof (certificate_extension) },
+		{ CKA_OBJECT_ID, (void *)P11_OID_BASIC_CONSTRAINTS, sizeof (P11_OID_BASIC_CONSTRAINTS) },
+		{ CKA_VALUE, "\x30\x0c\x06\x03\x55\x1d\x13\x04\x05\x30\x03\x01\x01\xff", 14 },
+		{ CKA_PUBLIC_KEY_INFO, (void *)entrust_public_key, sizeof (entrust_public_key) },
+		{ CKA_ID, "the id", 6 },
+		{ CKA_INVALID },
+	};
+
+	CK_ATTRIBUTE input[] = {
+		{ CKA_CLASS, &certificate, sizeof (certificate) },
+		{ CKA_CERTIFICATE_TYPE, &x509, sizeof (x509) },
+		{ CKA_VALUE, (void *)entrust_pretend_ca, sizeof (entrust_pretend_ca) },
+		{ CKA_TRUSTED, &truev, sizeof (truev) },
+		{ CKA_ID, "the id", 6 },
+		{ CKA_INVALID },
+	};
+
+	/* The stapled basic constraints make it an authority */
+	CK_ATTRIBUTE nss_trust_delegator[] = {
+		{ CKA_CLASS, &nss_trust, sizeof (nss_trust), },
+		{ CKA_ID, "the id", 6 },
+		{ CKA_TRUST_SERVER_AUTH, &trusted_delegator, sizeof (trusted_delegator) },
+		{ CKA_INVALID, }
+	};
+
+	CK_ATTRIBUTE nss_trust_match[] = {
+		{ CKA_CLASS, &nss_trust, sizeof (nss_trust), },
+		{ CKA_ID, "the id", 6 },
+		{ CKA_INVALID, }
+	};
+
+	CK_OBJECT_HANDLE *handles;
+	CK_RV rv;
+
+	p11_index_begin (test.index);
+	rv = p11_index_take (test.index, p11_attrs_dup (input), NULL);
+	assert_num_eq (CKR_OK, rv);
+	rv = p11_index_take (test.index, p11_attrs_dup (attached), NULL);
+	assert_num_eq (CKR_OK, rv);
+
+	/* Nothing is generated until the commit */
+	assert_num_eq (0, p11_index_find (test.index, nss_trust_match, -1));
+
+	p11_index_commit (test.index);
+
+	handles = p11_index_find_all (test.index, nss_trust_match, -1);
+	assert_ptr_not_null (handles);
+	assert (handles[0] != 0);
+	assert_num_eq (0, handles[1]);
+	test_check_attrs (nss_trust_delegator, p11_index_lookup (test.index, handles[0]));
+	free (handles);
+}
+
+static void
+test_changed_rollback (void)
+{
+	CK_ATTRIBUTE input[] = {
+		{ CKA_CLASS, &certificate, sizeof (certificate) },
+		{ CKA_CERTIFICATE_TYPE, &x509, sizeof (x509) },
+		{ CKA_VALUE, (void *)entrust_pretend_ca, sizeof (entrust_pretend_ca) },
+		{ CKA_TRUSTED, &truev, sizeof (truev) },
+		{ CKA_ID, "the id", 6 },
+		{ CKA_INVALID },
+	};
+
+	CK_RV rv;
+
+	p11_index_begin (test.index);
+	rv = p11_index_take (test.index, p11_attrs_dup (input), NULL);
+	assert_num_eq (CKR_OK, rv);
+	p11_index_rollback (test.index);
+
+	assert_num_eq (0, p11_index_size (test.index));
+
+	/* A later transaction doesn't see anything left over */
+	p11_index_begin (test.index);
+	p11_index_commit (test.index);
+	assert_num_eq (0, p11_index_size (test.index));
+}
+
 int
 main (int argc,
       char *argv[])
@@ -2233,5 +2317,7 @@ main (int argc,
 	p11_test (test_changed_staple_ca, "/builder/changed_staple_ca");
 	p11_test (test_changed_staple_ku, "/builder/changed_staple_ku");
 	p11_test (test_changed_dup_certificates, "/builder/changed_dup_certificates");
+	p11_test (test_changed_transaction, "/builder/changed_transaction");
+	p11_test (test_changed_rollback, "/builder/changed_rollback");
 	return p11_test_run (argc, argv);
 }
@@ -132,6 +132,133 @@ test_md5 (void)
 	}
 }
 
+static void
+test_sha1_multi (void)
+{
+	unsigned char checksums[301][P11_DIGEST_SHA1_LEN];
+	unsigned char checksum[P11_DIGEST_SHA1_LEN];
+	p11_digest_input inputs[301];
+	unsigned char data[300];
+	int i;
+
+	for (i = 0; i < sizeof (data); i++)
+		data[i] = i * 7;
+
+	/* Every length up to a few blocks, which isn't a multiple of the lanes */
+	for (i = 0; i < 301; i++) {
+		inputs[i].input = data + (i % 13);
+		inputs[i].length = 300 - i - (i < 287 ? (i % 13) : 0);
+		inputs[i].hash = checksums[i];
+	}
+
+	p11_digest_sha1_multi (inputs, 301);
+
+	for (i = 0; i < 301; i++) {
+		p11_digest_sha1 (checksum, inputs[i].input, inputs[i].length, NULL);
+		assert (memcmp (checksum, checksums[i], P11_DIGEST_SHA1_LEN) == 0);
+	}
+
+	for (i = 0; sha1_input[i] != NULL; i++) {
+		inputs[i].input = sha1_input[i];
+		inputs[i].length = strlen (sha1_input[i]);
+		inputs[i].hash = checksums[i];
+	}
+
+	p11_digest_sha1_multi (inputs, i);
+
+	for (i = 0; sha1_input[i] != NULL; i++)
+		assert (memcmp (sha1_checksum[i], checksums[i], P11_DIGEST_SHA1_LEN) == 0);
+
+	p11_digest_sha1_multi (inputs, 0);
+}
+
+static void
+test_sha1_incremental (void)
+{
+	unsigned char checksum[P11_DIGEST_SHA1_LEN];
+	unsigned char expected[P11_DIGEST_SHA1_LEN];
+	unsigned char data[300];
+	p11_digest *sha1;
+	size_t offset;
+	size_t step;
+	int i;
+
+	for (i = 0; i < sizeof (data); i++)
+		data[i] = i * 7;
+
+	p11_digest_sha1 (expected, data, sizeof (data), NULL);
+
+	/* Chunks which straddle the block boundaries in various ways */
+	for (step = 1; step < sizeof (data); step += 17) {
+		sha1 = p11_digest_new_sha1 ();
+		assert_ptr_not_null (sha1);
+		for (offset = 0; offset < sizeof (data); offset += step)
+			p11_digest_update (sha1, data + offset, step < sizeof (data) - offset ? step : sizeof (data) - offset);
+		p11_digest_finish (sha1, checksum);
+		assert (memcmp (expected, checksum, P11_DIGEST_SHA1_LEN) == 0);
+	}
+
+	for (i = 0; sha1_input[i] != NULL; i++) {
+		sha1 = p11_digest_new_sha1 ();
+		p11_digest_update (sha1, sha1_input[i], strlen (sha1_input[i]));
+		p11_digest_finish (sha1, checksum);
+		assert (memcmp (sha1_checksum[i], checksum, P11_DIGEST_SHA1_LEN) == 0);
+	}
+}
+
+static void
+test_md5_multi (void)
+{
+	unsigned char checksums[301][P11_DIGEST_MD5_LEN];
+	unsigned char checksum[P11_DIGEST_MD5_LEN];
+	p11_digest_input inputs[301];
+	unsigned char data[300];
+	int i;
+
+	for (i = 0; i < sizeof (data); i++)
+		data[i] = i * 7;
+
+	for (i = 0; i < 301; i++) {
+		inputs[i].input = data + (i % 13);
+		inputs[i].length = 300 - i - (i < 287 ? (i % 13) : 0);
+		inputs[i].hash = checksums[i];
+	}
+
+	p11_digest_md5_multi (inputs, 301);
+
+	for (i = 0; i < 301; i++) {
+		p11_digest_md5 (checksum, inputs[i].input, inputs[i].length, NULL);
+		assert (memcmp (checksum, checksums[i], P11_DIGEST_MD5_LEN) == 0);
+	}
+
+	for (i = 0; md5_input[i] != NULL; i++) {
+		inputs[i].input = md5_input[i];
+		inputs[i].length = strlen (md5_input[i]);
+		inputs[i].hash = checksums[i];
+	}
+
+	p11_digest_md5_multi (inputs, i);
+
+	for (i = 0; md5_input[i] != NULL; i++)
+		assert (memcmp (md5_checksum[i], checksums[i], P11_DIGEST_MD5_LEN) == 0);
+
+	p11_digest_md5_multi (inputs, 0);
+}
+
+static void
+test_sha1_portable (void)
+{
+	/* Also the only way the lanes are used for SHA-1 with SHA-1 instructions */
+	p11_digest_no_hardware = true;
+
+	test_sha1 ();
+	test_sha1_long ();
+	test_sha1_multi ();
+	test_sha1_incremental ();
+
+	p11_digest_no_hardware = false;
+}
+
 int
 main (int argc,
       char *argv[])
@@ -139,5 +266,9 @@ main (int argc,
 	p11_test (test_sha1, "/digest/sha1");
 	p11_test (test_sha1_long, "/digest/sha1-long");
 	p11_test (test_md5, "/digest/md5");
+	p11_test (test_sha1_multi, "/digest/sha1-multi");
+	p11_test (test_sha1_incremental, "/digest/sha1-incremental");
+	p11_test (test_md5_multi, "/digest/md5-multi");
+	p11_test (test_sha1_portable, "/digest/sha1-portable");
 	return p11_test_run (argc, argv);
 }
@@ -1027,6 +1027,150 @@ test_change_nested (void)
 	p11_index_free (index);
 }
 
+static int on_transaction_changed = 0;
+static int on_transaction_done = 0;
+
+static void
+on_change_transaction (void *data,
+                       p11_index *index,
+                       CK_OBJECT_HANDLE handle,
+                       CK_ATTRIBUTE *attrs)
+{
+	assert_str_eq (data, "transaction");
+
+	if (!p11_index_committing (index))
+		return;
+	if (attrs == NULL)
+		on_transaction_done++;
+	else
+		on_transaction_changed++;
+}
+
+static void
+test_transaction_commit (void)
+{
+	CK_ATTRIBUTE original[] = {
+		{ CKA_LABEL, "yay", 3 },
+		{ CKA_VALUE, "eight", 5 },
+		{ CKA_INVALID }
+	};
+
+	CK_ATTRIBUTE change[] = {
+		{ CKA_VALUE, "nine", 4 },
+		{ CKA_INVALID }
+	};
+
+	CK_OBJECT_HANDLE handle;
+	CK_OBJECT_HANDLE other;
+	p11_index *index;
+	CK_RV rv;
+
+	index = p11_index_new (NULL, NULL, NULL, on_change_transaction, "transaction");
+	assert_ptr_not_null (index);
+
+	on_transaction_changed = 0;
+	on_transaction_done = 0;
+
+	p11_index_begin (index);
+	assert (p11_index_loading (index));
+	assert (!p11_index_committing (index));
+
+	rv = p11_index_add (index, original, 2, &handle);
+	assert_num_eq (CKR_OK, rv);
+	rv = p11_index_set (index, handle, change, 1);
+	assert_num_eq (CKR_OK, rv);
+	rv = p11_index_set (index, handle, original, 2);
+	assert_num_eq (CKR_OK, rv);
+
+	rv = p11_index_add (index, original, 2, &other);
+	assert_num_eq (CKR_OK, rv);
+	rv = p11_index_remove (index, other);
+	assert_num_eq (CKR_OK, rv);
+
+	/* Finishing doesn't end a transaction */
+	p11_index_finish (index);
+	assert (p11_index_loading (index));
+	assert_num_eq (0, on_transaction_changed);
+
+	p11_index_commit (index);
+	assert (!p11_index_loading (index));
+	assert (!p11_index_committing (index));
+
+	/* Once for each handle, and once at the end */
+	assert_num_eq (2, on_transaction_changed);
+	assert_num_eq (1, on_transaction_done);
+
+	test_check_attrs (original, p11_index_lookup (index, handle));
+	assert_ptr_eq (NULL, p11_index_lookup (index, other));
+
+	p11_index_free (index);
+}
+
+static void
+test_transaction_rollback (void)
+{
+	CK_ATTRIBUTE first[] = {
+		{ CKA_LABEL, "first", 5 },
+		{ CKA_VALUE, "1", 1 },
+		{ CKA_INVALID }
+	};
+
+	CK_ATTRIBUTE second[] = {
+		{ CKA_LABEL, "second", 6 },
+		{ CKA_VALUE, "2", 1 },
+		{ CKA_INVALID }
+	};
+
+	CK_ATTRIBUTE change[] = {
+		{ CKA_VALUE, "one", 3 },
+		{ CKA_INVALID }
+	};
+
+	CK_OBJECT_HANDLE handle1;
+	CK_OBJECT_HANDLE handle2;
+	CK_OBJECT_HANDLE added;
+	p11_index *index;
+	CK_RV rv;
+
+	index = p11_index_new (NULL, NULL, NULL, on_change_transaction, "transaction");
+	assert_ptr_not_null (index);
+
+	rv = p11_index_add (index, first, 2, &handle1);
+	assert_num_eq (CKR_OK, rv);
+	rv = p11_index_add (index, second, 2, &handle2);
+	assert_num_eq (CKR_OK, rv);
+
+	on_transaction_changed = 0;
+	on_transaction_done = 0;
+
+	p11_index_begin (index);
+
+	rv = p11_index_set (index, handle1, change, 1);
+	assert_num_eq (CKR_OK, rv);
+	rv = p11_index_remove (index, handle2);
+	assert_num_eq (CKR_OK, rv);
+	rv = p11_index_add (index, change, 1, &added);
+	assert_num_eq (CKR_OK, rv);
+
+	p11_index_rollback (index);
+	assert (!p11_index_loading (index));
+
+	/* Nothing was notified, and everything is as it was */
+	assert_num_eq (0, on_transaction_changed);
+	assert_num_eq (0, on_transaction_done);
+	assert_num_eq (2, p11_index_size (index));
+
+	test_check_attrs (first, p11_index_lookup (index, handle1));
+	test_check_attrs (second, p11_index_lookup (index, handle2));
+	assert_ptr_eq (NULL, p11_index_lookup (index, added));
+
+	assert_num_eq (handle1, p11_index_find (index, first, 2));
+	assert_num_eq (handle2, p11_index_find (index, second, 2));
+	assert_num_eq (0, p11_index_find (index, change, 1));
+
+	p11_index_free (index);
+}
+
 static CK_RV
 on_remove_callback (void *data,
                     p11_index *index,
@@ -1136,6 +1280,8 @@ main (int argc,
 	p11_test (test_change_called, "/index/change_called");
 	p11_test (test_change_batch, "/index/change_batch");
 	p11_test (test_change_nested, "/index/change_nested");
+	p11_test (test_transaction_commit, "/index/transaction-commit");
+	p11_test (test_transaction_rollback, "/index/transaction-rollback");
 	p11_test (test_replace_all_build_fails, "/index/replace-all-build-fails");
 	p11_test (test_remove_callback, "/index/remove-callback");
 	p11_test (test_remove_fail, "/index/remove-fail");
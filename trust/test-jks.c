@@ -0,0 +1,251 @@
+/*
+ * Copyright (c) 2016 Red Hat Inc
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *     * Redistributions of source code must retain the above
+ *       copyright notice, this list of conditions and the
+ *       following disclaimer.
+ *     * Redistributions in binary form must reproduce the
+ *       above copyright notice, this list of conditions and
+ *       the following disclaimer in the documentation and/or
+ *       other materials provided with the distribution.
+ *     * The names of contributors to this software may not be
+ *       used to endorse or promote products derived from this
+ *       software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+#define P11_KIT_DISABLE_DEPRECATED
+
+#include "config.h"
+
+#include "test-trust.h"
+
+#include "attrs.h"
+#include "buffer.h"
+#include "compat.h"
+#include "debug.h"
+#include "dict.h"
+#include "digest.h"
+#include "extract.h"
+#include "message.h"
+#include "mock.h"
+#include "path.h"
+#include "pkcs11.h"
+#include "test.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+struct {
+	CK_FUNCTION_LIST module;
+	p11_enumerate ex;
+	char *directory;
+} test;
+
+static void
+setup (void *unused)
+{
+	CK_RV rv;
+
+	mock_module_reset ();
+	memcpy (&test.module, &mock_module, sizeof (CK_FUNCTION_LIST));
+	rv = test.module.C_Initialize (NULL);
+	assert_num_eq (CKR_OK, rv);
+
+	p11_enumerate_init (&test.ex);
+
+	test.directory = p11_test_directory ("test-extract");
+}
+
+static void
+teardown (void *unused)
+{
+	CK_RV rv;
+
+	if (rmdir (test.directory) < 0)
+		assert_not_reached ();
+	free (test.directory);
+
+	p11_enumerate_cleanup (&test.ex);
+	p11_kit_iter_free (test.ex.iter);
+
+	rv = test.module.C_Finalize (NULL);
+	assert_num_eq (CKR_OK, rv);
+}
+
+static CK_OBJECT_CLASS certificate_class = CKO_CERTIFICATE;
+static CK_CERTIFICATE_TYPE x509_type = CKC_X_509;
+static CK_BBOOL vtrue = CK_TRUE;
+
+static CK_ATTRIBUTE cacert3_authority_attrs[] = {
+	{ CKA_VALUE, (void *)test_cacert3_ca_der, sizeof (test_cacert3_ca_der) },
+	{ CKA_CLASS, &certificate_class, sizeof (certificate_class) },
+	{ CKA_CERTIFICATE_TYPE, &x509_type, sizeof (x509_type) },
+	{ CKA_LABEL, "Custom Label", 12 },
+	{ CKA_SUBJECT, (void *)test_cacert3_ca_subject, sizeof (test_cacert3_ca_subject) },
+	{ CKA_TRUSTED, &vtrue, sizeof (vtrue) },
+	{ CKA_INVALID },
+};
+
+static CK_ATTRIBUTE certificate_filter[] = {
+	{ CKA_CLASS, &certificate_class, sizeof (certificate_class) },
+	{ CKA_INVALID },
+};
+
+static uint32_t
+decode_msb_int (const unsigned char *data)
+{
+	return (uint32_t)data[0] << 24 | data[1] << 16 | data[2] << 8 | data[3];
+}
+
+/* Checks the structure and keyed digest of a keystore of cacert3 entries */
+static void
+check_keystore (const char *filename,
+                int count)
+{
+	unsigned char digest[P11_DIGEST_SHA1_LEN];
+	const unsigned char *data;
+	const unsigned char *at;
+	char alias[64];
+	p11_dict *aliases;
+	p11_mmap *map;
+	size_t length;
+	size_t len;
+	void *mapped;
+	int i;
+
+	map = p11_mmap_open (filename, NULL, &mapped, &length);
+	assert_ptr_not_null (map);
+	data = mapped;
+
+	assert (length >= 12 + P11_DIGEST_SHA1_LEN);
+	assert (memcmp (data, "\xfe\xed\xfe\xed", 4) == 0);
+	assert_num_eq (2, decode_msb_int (data + 4));
+	assert_num_eq (count, decode_msb_int (data + 8));
+
+	aliases = p11_dict_new (p11_dict_str_hash, p11_dict_str_equal, free, NULL);
+
+	at = data + 12;
+	for (i = 0; i < count; i++) {
+		assert_num_eq (2, decode_msb_int (at));
+		at += 4;
+
+		/* The aliases are made unique, in whatever order objects come */
+		len = at[0] << 8 | at[1];
+		assert (len < sizeof (alias));
+		memcpy (alias, at + 2, len);
+		alias[len] = '\0';
+		assert (p11_dict_set (aliases, strdup (alias), alias));
+		assert (strncmp (alias, "customlabel", 11) == 0);
+		at += 2 + len;
+
+		/* The creation date */
+		at += 8;
+
+		assert (memcmp (at, "\x00\x05X.509", 7) == 0);
+		at += 7;
+
+		assert_num_eq (sizeof (test_cacert3_ca_der), decode_msb_int (at));
+		assert (memcmp (at + 4, test_cacert3_ca_der, sizeof (test_cacert3_ca_der)) == 0);
+		at += 4 + sizeof (test_cacert3_ca_der);
+	}
+
+	assert_num_eq (count, p11_dict_size (aliases));
+	p11_dict_free (aliases);
+
+	assert_num_eq (length - P11_DIGEST_SHA1_LEN, at - data);
+
+	p11_digest_sha1 (digest,
+	                 "\000c\000h\000a\000n\000g\000e\000i\000t", (size_t)16,
+	                 "Mighty Aphrodite", (size_t)16,
+	                 data, length - P11_DIGEST_SHA1_LEN,
+	                 NULL);
+	assert (memcmp (digest, at, P11_DIGEST_SHA1_LEN) == 0);
+
+	p11_mmap_close (map);
+}
+
+static void
+check_extract (int count)
+{
+	char *destination;
+	CK_ATTRIBUTE *copy;
+	bool ret;
+	int i;
+
+	for (i = 0; i < count; i++) {
+		copy = p11_attrs_dup (cacert3_authority_attrs);
+		mock_module_take_object (MOCK_SLOT_ONE_ID, copy);
+	}
+
+	p11_kit_iter_add_filter (test.ex.iter, certificate_filter, 1);
+	p11_kit_iter_begin_with (test.ex.iter, &test.module, 0, 0);
+
+	if (asprintf (&destination, "%s/%s", test.directory, "cacerts") < 0)
+		assert_not_reached ();
+
+	ret = p11_extract_jks_cacerts (&test.ex, destination);
+	assert_num_eq (true, ret);
+
+	check_keystore (destination, count);
+
+	if (unlink (destination) < 0)
+		assert_not_reached ();
+	free (destination);
+}
+
+static void
+test_file (void)
+{
+	check_extract (1);
+}
+
+static void
+test_file_without (void)
+{
+	check_extract (0);
+}
+
+static void
+test_file_large (void)
+{
+	/* More than is written out at once */
+	check_extract (100);
+}
+
+int
+main (int argc,
+      char *argv[])
+{
+	mock_module_init ();
+
+	p11_fixture (setup, teardown);
+	p11_test (test_file, "/jks/test_file");
+	p11_test (test_file_without, "/jks/test_file_without");
+	p11_test (test_file_large, "/jks/test_file_large");
+
+	return p11_test_run (argc, argv);
+}
+
+#include "enumerate.c"
+#include "extract-jks.c"
+#include "save.c"
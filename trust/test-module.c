@@ -954,6 +954,62 @@ test_find_serial_der_decoded (void)
 	assert_num_eq (CKR_OK, rv);
 }
 
+static void
+test_find_serial_der_both (void)
+{
+	CK_OBJECT_CLASS nss_trust = CKO_NSS_TRUST;
+
+	CK_ATTRIBUTE encoded[] = {
+		{ CKA_CLASS, &nss_trust, sizeof (nss_trust) },
+		{ CKA_SERIAL_NUMBER, "\x02\x03\x01\x02\x03", 5 },
+		{ CKA_INVALID }
+	};
+
+	CK_ATTRIBUTE decoded[] = {
+		{ CKA_SERIAL_NUMBER, "\x01\x02\x03", 3 },
+		{ CKA_CLASS, &nss_trust, sizeof (nss_trust) },
+		{ CKA_INVALID }
+	};
+
+	CK_SESSION_HANDLE session;
+	CK_OBJECT_HANDLE handles[2];
+	CK_OBJECT_HANDLE check[3];
+	CK_ULONG count;
+	CK_RV rv;
+
+	rv = test.module->C_OpenSession (test.slots[0], CKF_SERIAL_SESSION, NULL, NULL, &session);
+	assert_num_eq (CKR_OK, rv);
+
+	rv = test.module->C_CreateObject (session, encoded, 2, handles + 0);
+	assert_num_eq (CKR_OK, rv);
+	rv = test.module->C_CreateObject (session, decoded, 2, handles + 1);
+	assert_num_eq (CKR_OK, rv);
+
+	/* Both the exact match and the worked around one, each only once */
+	rv = test.module->C_FindObjectsInit (session, decoded, 2);
+	assert_num_eq (CKR_OK, rv);
+	rv = test.module->C_FindObjects (session, check, 3, &count);
+	assert_num_eq (CKR_OK, rv);
+	assert_num_eq (2, count);
+	assert (check[0] != check[1]);
+	assert (check[0] == handles[0] || check[0] == handles[1]);
+	assert (check[1] == handles[0] || check[1] == handles[1]);
+	rv = test.module->C_FindObjectsFinal (session);
+	assert_num_eq (CKR_OK, rv);
+
+	/* A destroyed object is no longer returned */
+	rv = test.module->C_FindObjectsInit (session, decoded, 2);
+	assert_num_eq (CKR_OK, rv);
+	rv = test.module->C_DestroyObject (session, handles[0]);
+	assert_num_eq (CKR_OK, rv);
+	rv = test.module->C_FindObjects (session, check, 3, &count);
+	assert_num_eq (CKR_OK, rv);
+	assert_num_eq (1, count);
+	assert_num_eq (handles[1], check[0]);
+	rv = test.module->C_FindObjectsFinal (session);
+	assert_num_eq (CKR_OK, rv);
+}
+
 static void
 test_find_serial_der_mismatch (void)
 {
@@ -1015,6 +1071,103 @@ test_find_serial_der_mismatch (void)
 	assert_num_eq (CKR_OK, rv);
 }
 
+typedef struct {
+	CK_ULONG expected;
+	int failures;
+} ThreadData;
+
+static void *
+find_and_create_thread (void *arg)
+{
+	CK_OBJECT_CLASS klass = CKO_CERTIFICATE;
+	ThreadData *thread = arg;
+	CK_SESSION_HANDLE session;
+	CK_OBJECT_HANDLE objects[16];
+	CK_OBJECT_HANDLE handle;
+	unsigned char value[4096];
+	CK_ULONG count;
+	CK_ULONG i;
+	int n;
+
+	CK_ATTRIBUTE match[] = {
+		{ CKA_CLASS, &klass, sizeof (klass) },
+	};
+
+	CK_ATTRIBUTE attr = { CKA_VALUE, value, sizeof (value) };
+
+	CK_ATTRIBUTE object[] = {
+		{ CKA_CLASS, &data, sizeof (data) },
+		{ CKA_LABEL, "thread", 6 },
+	};
+
+	if (test.module->C_OpenSession (test.slots[0], CKF_SERIAL_SESSION, NULL, NULL, &session) != CKR_OK) {
+		thread->failures++;
+		return NULL;
+	}
+
+	for (n = 0; n < 50; n++) {
+		if (test.module->C_FindObjectsInit (session, match, 1) != CKR_OK ||
+		    test.module->C_FindObjects (session, objects, 16, &count) != CKR_OK ||
+		    test.module->C_FindObjectsFinal (session) != CKR_OK ||
+		    count != thread->expected)
+			thread->failures++;
+
+		for (i = 0; i < count; i++) {
+			attr.ulValueLen = sizeof (value);
+			if (test.module->C_GetAttributeValue (session, objects[i], &attr, 1) != CKR_OK)
+				thread->failures++;
+		}
+
+		/* Session objects while others look up token objects */
+		if (test.module->C_CreateObject (session, object, 2, &handle) != CKR_OK ||
+		    test.module->C_DestroyObject (session, handle) != CKR_OK)
+			thread->failures++;
+	}
+
+	if (test.module->C_CloseSession (session) != CKR_OK)
+		thread->failures++;
+	return NULL;
+}
+
+static void
+test_threads (void)
+{
+	CK_OBJECT_CLASS klass = CKO_CERTIFICATE;
+	CK_SESSION_HANDLE session;
+	CK_OBJECT_HANDLE objects[16];
+	p11_thread_t threads[4];
+	ThreadData results[4];
+	CK_ULONG count;
+	CK_RV rv;
+	int i;
+
+	CK_ATTRIBUTE match[] = {
+		{ CKA_CLASS, &klass, sizeof (klass) },
+	};
+
+	rv = test.module->C_OpenSession (test.slots[0], CKF_SERIAL_SESSION, NULL, NULL, &session);
+	assert_num_eq (CKR_OK, rv);
+	rv = test.module->C_FindObjectsInit (session, match, 1);
+	assert_num_eq (CKR_OK, rv);
+	rv = test.module->C_FindObjects (session, objects, 16, &count);
+	assert_num_eq (CKR_OK, rv);
+	rv = test.module->C_FindObjectsFinal (session);
+	assert_num_eq (CKR_OK, rv);
+	assert (count > 0);
+
+	for (i = 0; i < 4; i++) {
+		results[i].expected = count;
+		results[i].failures = 0;
+		if (p11_thread_create (threads + i, find_and_create_thread, results + i) != 0)
+			assert_not_reached ();
+	}
+
+	for (i = 0; i < 4; i++) {
+		p11_thread_join (threads[i]);
+		assert_num_eq (0, results[i].failures);
+	}
+}
+
 static void
 test_login_logout (void)
 {
@@ -1206,7 +1359,9 @@ main (int argc,
 	p11_test (test_session_setattr, "/module/session_setattr");
 	p11_test (test_find_serial_der_decoded, "/module/find_serial_der_decoded");
 	p11_test (test_find_serial_der_mismatch, "/module/find_serial_der_mismatch");
+	p11_test (test_find_serial_der_both, "/module/find_serial_der_both");
 	p11_test (test_login_logout, "/module/login_logout");
+	p11_test (test_threads, "/module/threads");
 
 	p11_fixture (setup_writable, teardown);
 	p11_test (test_token_writable, "/module/token-writable");
@@ -608,6 +608,10 @@ test_directory (void)
 	test_check_symlink (test.directory, "e5662767.1", "Custom_Label.1.pem");
 	test_check_symlink (test.directory, "590d426f.0", "Custom_Label.pem");
 	test_check_symlink (test.directory, "590d426f.1", "Custom_Label.1.pem");
+
+	/* Both certificates have the same subject */
+	assert_num_eq (1, test.ex.subjects_misses);
+	assert_num_eq (1, test.ex.subjects_hits);
 #endif
 }
 
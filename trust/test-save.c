@@ -47,6 +47,9 @@
 
 #include <sys/stat.h>
 #include <sys/types.h>
+#ifdef HAVE_SYS_XATTR_H
+#include <sys/xattr.h>
+#endif
 
 #include <dirent.h>
 #include <errno.h>
@@ -242,6 +245,46 @@ test_file_auto_length (void)
 	test_check_file (test.directory, "extract-file", SRCDIR "/trust/fixtures/simple-string");
 }
 
+static void
+test_file_write_at (void)
+{
+	p11_save_file *file;
+	char *filename;
+	char data[32];
+	ssize_t res;
+	bool ret;
+
+	if (asprintf (&filename, "%s/%s", test.directory, "extract-file") < 0)
+		assert_not_reached ();
+
+	file = p11_save_open_file (filename, NULL, 0);
+	assert_ptr_not_null (file);
+
+	ret = p11_save_write (file, "The XXXXXX string", -1);
+	assert_num_eq (true, ret);
+
+	/* Doesn't move where the next write goes */
+	ret = p11_save_write_at (file, 4, "simple", 6);
+	assert_num_eq (true, ret);
+
+	ret = p11_save_write (file, " is hairy", -1);
+	assert_num_eq (true, ret);
+
+	res = p11_save_read_at (file, 4, data, 6);
+	assert_num_eq (6, res);
+	assert (memcmp (data, "simple", 6) == 0);
+
+	res = p11_save_read_at (file, 21, data, sizeof (data));
+	assert_num_eq (5, res);
+	assert (memcmp (data, "hairy", 5) == 0);
+
+	ret = p11_save_finish_file (file, NULL, true);
+	assert_num_eq (true, ret);
+	free (filename);
+
+	test_check_file (test.directory, "extract-file", SRCDIR "/trust/fixtures/simple-string");
+}
+
 static void
 test_write_with_null (void)
 {
@@ -566,6 +609,247 @@ test_directory_overwrite (void)
 	free (subdir);
 }
 
+static void
+test_directory_abort (void)
+{
+	p11_save_dir *dir;
+	char *subdir;
+	bool ret;
+
+	if (asprintf (&subdir, "%s/%s", test.directory, "extract-dir") < 0)
+		assert_not_reached ();
+
+	dir = p11_save_open_directory (subdir, 0);
+	ret = p11_save_write_and_finish (p11_save_open_file_in (dir, "file", ".txt"), "", 0) &&
+	      p11_save_finish_directory (dir, true);
+	assert (ret && dir);
+
+	/* Nothing written here should show up */
+	dir = p11_save_open_directory (subdir, P11_SAVE_OVERWRITE);
+	assert_ptr_not_null (dir);
+	ret = p11_save_write_and_finish (p11_save_open_file_in (dir, "blah", ".cer"),
+	                                 test_text, strlen (test_text));
+	assert_num_eq (true, ret);
+#ifdef OS_UNIX
+	ret = p11_save_symlink_in (dir, "link", ".ext", "/the/destination");
+	assert_num_eq (true, ret);
+#endif
+	ret = p11_save_finish_directory (dir, false);
+	assert_num_eq (true, ret);
+
+	test_check_directory (subdir, ("file.txt", NULL));
+	test_check_directory (test.directory, ("extract-dir", NULL));
+
+	test_check_data (subdir, "file.txt", "", 0);
+
+	assert (rmdir (subdir) >= 0);
+	free (subdir);
+}
+
+static void
+test_directory_overwrite_subdir (void)
+{
+	p11_save_dir *dir;
+	char *subdir;
+	char *nested;
+	bool ret;
+
+	if (asprintf (&subdir, "%s/%s", test.directory, "extract-dir") < 0)
+		assert_not_reached ();
+	if (asprintf (&nested, "%s/%s", subdir, "nested") < 0)
+		assert_not_reached ();
+
+	dir = p11_save_open_directory (subdir, 0);
+	ret = p11_save_write_and_finish (p11_save_open_file_in (dir, "file", ".txt"), "", 0) &&
+	      p11_save_finish_directory (dir, true);
+	assert (ret && dir);
+
+	if (chmod (subdir, S_IRWXU) < 0)
+		assert_not_reached ();
+#ifdef OS_UNIX
+	if (mkdir (nested, S_IRWXU) < 0)
+#else
+	if (mkdir (nested) < 0)
+#endif
+		assert_fail ("mkdir() failed", nested);
+
+	/* Directories are left alone when overwriting */
+	dir = p11_save_open_directory (subdir, P11_SAVE_OVERWRITE);
+	assert_ptr_not_null (dir);
+	ret = p11_save_write_and_finish (p11_save_open_file_in (dir, "blah", ".cer"),
+	                                 test_text, strlen (test_text));
+	assert_num_eq (true, ret);
+	ret = p11_save_finish_directory (dir, true);
+	assert_num_eq (true, ret);
+
+	test_check_directory (subdir, ("blah.cer", "nested", NULL));
+	test_check_directory (test.directory, ("extract-dir", NULL));
+
+	test_check_data (subdir, "blah.cer", test_text, strlen (test_text));
+
+	assert (rmdir (nested) >= 0);
+	assert (rmdir (subdir) >= 0);
+	free (nested);
+	free (subdir);
+}
+
+static void
+test_directory_trailing_slash (void)
+{
+	p11_save_dir *dir;
+	char *subdir;
+	char *slashed;
+	bool ret;
+
+	if (asprintf (&subdir, "%s/%s", test.directory, "extract-dir") < 0)
+		assert_not_reached ();
+	if (asprintf (&slashed, "%s/", subdir) < 0)
+		assert_not_reached ();
+
+	dir = p11_save_open_directory (slashed, 0);
+	assert_ptr_not_null (dir);
+	ret = p11_save_write_and_finish (p11_save_open_file_in (dir, "file", ".txt"),
+	                                 test_text, strlen (test_text));
+	assert_num_eq (true, ret);
+	ret = p11_save_finish_directory (dir, true);
+	assert_num_eq (true, ret);
+
+	test_check_directory (subdir, ("file.txt", NULL));
+	test_check_directory (test.directory, ("extract-dir", NULL));
+	test_check_data (subdir, "file.txt", test_text, strlen (test_text));
+
+	if (chmod (subdir, S_IRWXU) < 0)
+		assert_not_reached ();
+	dir = p11_save_open_directory (slashed, P11_SAVE_OVERWRITE);
+	assert_ptr_not_null (dir);
+	ret = p11_save_write_and_finish (p11_save_open_file_in (dir, "blah", ".cer"), "", 0);
+	assert_num_eq (true, ret);
+	ret = p11_save_finish_directory (dir, true);
+	assert_num_eq (true, ret);
+
+	test_check_directory (subdir, ("blah.cer", NULL));
+	test_check_directory (test.directory, ("extract-dir", NULL));
+	test_check_data (subdir, "blah.cer", "", 0);
+
+	assert (rmdir (subdir) >= 0);
+	free (slashed);
+	free (subdir);
+}
+
+static void
+test_directory_not_directory (void)
+{
+	p11_save_dir *dir;
+	char *subdir;
+
+	if (asprintf (&subdir, "%s/%s", test.directory, "extract-dir") < 0)
+		assert_not_reached ();
+
+	write_zero_file (test.directory, "extract-dir");
+
+	p11_message_quiet ();
+
+	/* A file is never replaced by a directory */
+	dir = p11_save_open_directory (subdir, P11_SAVE_OVERWRITE);
+	assert_ptr_eq (NULL, dir);
+
+	p11_message_loud ();
+
+	test_check_directory (test.directory, ("extract-dir", NULL));
+	test_check_data (test.directory, "extract-dir", "", 0);
+
+	free (subdir);
+}
+
+#ifdef OS_UNIX
+
+static void
+test_directory_symlink (void)
+{
+	p11_save_dir *dir;
+	struct stat sb;
+	char *subdir;
+	char *link;
+	bool ret;
+
+	if (asprintf (&subdir, "%s/%s", test.directory, "extract-dir") < 0)
+		assert_not_reached ();
+	if (asprintf (&link, "%s/%s", test.directory, "extract-link") < 0)
+		assert_not_reached ();
+
+	if (mkdir (subdir, S_IRWXU) < 0)
+		assert_fail ("mkdir() failed", subdir);
+	if (symlink ("extract-dir", link) < 0)
+		assert_fail ("symlink() failed", link);
+
+	/* The directory pointed to is replaced, and the link kept */
+	dir = p11_save_open_directory (link, P11_SAVE_OVERWRITE);
+	assert_ptr_not_null (dir);
+	ret = p11_save_write_and_finish (p11_save_open_file_in (dir, "file", ".txt"),
+	                                 test_text, strlen (test_text));
+	assert_num_eq (true, ret);
+	ret = p11_save_finish_directory (dir, true);
+	assert_num_eq (true, ret);
+
+	test_check_directory (test.directory, ("extract-dir", "extract-link", NULL));
+	assert (lstat (link, &sb) >= 0 && S_ISLNK (sb.st_mode));
+	test_check_directory (subdir, ("file.txt", NULL));
+	test_check_data (subdir, "file.txt", test_text, strlen (test_text));
+
+	assert (unlink (link) >= 0);
+	assert (rmdir (subdir) >= 0);
+	free (link);
+	free (subdir);
+}
+
+#endif /* OS_UNIX */
+
+#ifdef HAVE_SYS_XATTR_H
+
+static void
+test_directory_attributes (void)
+{
+	p11_save_dir *dir;
+	char value[16];
+	char *subdir;
+	ssize_t len;
+	bool ret;
+
+	if (asprintf (&subdir, "%s/%s", test.directory, "extract-dir") < 0)
+		assert_not_reached ();
+
+	if (mkdir (subdir, S_IRWXU) < 0)
+		assert_fail ("mkdir() failed", subdir);
+	if (setxattr (subdir, "user.test", "value", 5, 0) < 0) {
+		fprintf (stderr, "# no extended attributes, skipping test\n");
+		rmdir (subdir);
+		free (subdir);
+		return;
+	}
+
+	/* Attributes of the replaced directory carry over */
+	dir = p11_save_open_directory (subdir, P11_SAVE_OVERWRITE);
+	assert_ptr_not_null (dir);
+	ret = p11_save_write_and_finish (p11_save_open_file_in (dir, "file", ".txt"), "", 0);
+	assert_num_eq (true, ret);
+	ret = p11_save_finish_directory (dir, true);
+	assert_num_eq (true, ret);
+
+	test_check_directory (subdir, ("file.txt", NULL));
+	test_check_directory (test.directory, ("extract-dir", NULL));
+
+	len = getxattr (subdir, "user.test", value, sizeof (value));
+	assert_num_eq (5, len);
+	assert (memcmp (value, "value", 5) == 0);
+
+	test_check_data (subdir, "file.txt", "", 0);
+
+	assert (rmdir (subdir) >= 0);
+	free (subdir);
+}
+
+#endif /* HAVE_SYS_XATTR_H */
+
 int
 main (int argc,
       char *argv[])
@@ -578,6 +862,7 @@ main (int argc,
 	p11_test (test_file_unique, "/save/file-unique");
 	p11_test (test_file_auto_empty, "/save/test_file_auto_empty");
 	p11_test (test_file_auto_length, "/save/test_file_auto_length");
+	p11_test (test_file_write_at, "/save/file-write-at");
 
 	p11_fixture (NULL, NULL);
 	p11_test (test_write_with_null, "/save/test_write_with_null");
@@ -591,5 +876,15 @@ main (int argc,
 	p11_test (test_directory_dups, "/save/test_directory_dups");
 	p11_test (test_directory_exists, "/save/test_directory_exists");
 	p11_test (test_directory_overwrite, "/save/test_directory_overwrite");
+	p11_test (test_directory_abort, "/save/test_directory_abort");
+	p11_test (test_directory_overwrite_subdir, "/save/test_directory_overwrite_subdir");
+	p11_test (test_directory_trailing_slash, "/save/test_directory_trailing_slash");
+	p11_test (test_directory_not_directory, "/save/test_directory_not_directory");
+#ifdef OS_UNIX
+	p11_test (test_directory_symlink, "/save/test_directory_symlink");
+#endif
+#ifdef HAVE_SYS_XATTR_H
+	p11_test (test_directory_attributes, "/save/test_directory_attributes");
+#endif
 	return p11_test_run (argc, argv);
 }
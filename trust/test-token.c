@@ -40,6 +40,11 @@
 #include <stdio.h>
 #include <string.h>
 
+#ifdef OS_UNIX
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
 #include "attrs.h"
 #include "debug.h"
 #include "parser.h"
@@ -759,6 +764,269 @@ test_remove_multiple (void)
 	test_check_attrs (third, parsed->elem[1]);
 }
 
+static void
+test_batch_modify (void)
+{
+	const char *test_data =
+		"[p11-kit-object-v1]\n"
+		"class: data\n"
+		"label: \"first\"\n"
+		"value: \"1\"\n"
+		"\n"
+		"[p11-kit-object-v1]\n"
+		"class: data\n"
+		"label: \"second\"\n"
+		"value: \"2\"\n"
+		"\n"
+		"[p11-kit-object-v1]\n"
+		"class: data\n"
+		"label: \"third\"\n"
+		"value: \"3\"\n";
+
+	CK_ATTRIBUTE second[] = {
+		{ CKA_CLASS, &data, sizeof (data) },
+		{ CKA_LABEL, "zwei", 4 },
+		{ CKA_VALUE, "2", 1 },
+		{ CKA_INVALID },
+	};
+
+	CK_ATTRIBUTE third[] = {
+		{ CKA_CLASS, &data, sizeof (data) },
+		{ CKA_LABEL, "drei", 4 },
+		{ CKA_VALUE, "3", 1 },
+		{ CKA_INVALID },
+	};
+
+	CK_ATTRIBUTE match_first = { CKA_LABEL, "first", 5 };
+	CK_ATTRIBUTE match_second = { CKA_LABEL, "second", 6 };
+	CK_ATTRIBUTE match_third = { CKA_LABEL, "third", 5 };
+
+	CK_OBJECT_HANDLE handle;
+	p11_array *parsed;
+	char *path;
+	int ret;
+	CK_RV rv;
+
+	p11_test_file_write (test.directory, "Test.p11-kit", test_data, strlen (test_data));
+	p11_token_load (test.token);
+
+	p11_token_batch (test.token);
+
+	handle = p11_index_find (test.index, &match_second, 1);
+	rv = p11_index_update (test.index, handle, p11_attrs_buildn (NULL, second + 1, 1));
+	assert_num_eq (rv, CKR_OK);
+
+	handle = p11_index_find (test.index, &match_third, 1);
+	rv = p11_index_update (test.index, handle, p11_attrs_buildn (NULL, third + 1, 1));
+	assert_num_eq (rv, CKR_OK);
+
+	handle = p11_index_find (test.index, &match_first, 1);
+	rv = p11_index_remove (test.index, handle);
+	assert_num_eq (rv, CKR_OK);
+
+	/* Nothing has been rewritten yet, the changes are in the journal */
+	test_check_directory (test.directory, (".p11-kit-journal", "Test.p11-kit", NULL));
+
+	path = p11_path_build (test.directory, "Test.p11-kit", NULL);
+	ret = p11_parse_file (test.parser, path, NULL, 0);
+	assert_num_eq (ret, P11_PARSE_SUCCESS);
+	free (path);
+
+	parsed = p11_parser_parsed (test.parser);
+	assert_num_eq (parsed->num, 3);
+
+	rv = p11_token_commit (test.token);
+	assert_num_eq (rv, CKR_OK);
+
+	test_check_directory (test.directory, ("Test.p11-kit", NULL));
+
+	path = p11_path_build (test.directory, "Test.p11-kit", NULL);
+	ret = p11_parse_file (test.parser, path, NULL, 0);
+	assert_num_eq (ret, P11_PARSE_SUCCESS);
+	free (path);
+
+	/* Objects stay in the order they were in the file */
+	parsed = p11_parser_parsed (test.parser);
+	assert_num_eq (parsed->num, 2);
+	test_check_attrs (second, parsed->elem[0]);
+	test_check_attrs (third, parsed->elem[1]);
+}
+
+static void
+test_batch_remove_all (void)
+{
+	const char *test_data =
+		"[p11-kit-object-v1]\n"
+		"class: data\n"
+		"label: \"first\"\n"
+		"value: \"1\"\n"
+		"\n";
+
+	CK_ATTRIBUTE match = { CKA_LABEL, "first", 5 };
+
+	CK_OBJECT_HANDLE handle;
+	CK_RV rv;
+
+	p11_test_file_write (test.directory, "Test.p11-kit", test_data, strlen (test_data));
+	p11_token_load (test.token);
+
+	p11_token_batch (test.token);
+	p11_token_batch (test.token);
+
+	handle = p11_index_find (test.index, &match, 1);
+	rv = p11_index_remove (test.index, handle);
+	assert_num_eq (rv, CKR_OK);
+
+	/* Only the outermost commit writes */
+	rv = p11_token_commit (test.token);
+	assert_num_eq (rv, CKR_OK);
+	test_check_directory (test.directory, (".p11-kit-journal", "Test.p11-kit", NULL));
+
+	rv = p11_token_commit (test.token);
+	assert_num_eq (rv, CKR_OK);
+	test_check_directory (test.directory, (NULL, NULL));
+}
+
+static void
+test_journal_locked (void)
+{
+	const char *test_data =
+		"[p11-kit-object-v1]\n"
+		"class: data\n"
+		"label: \"first\"\n"
+		"value: \"1\"\n";
+
+	CK_ATTRIBUTE first[] = {
+		{ CKA_LABEL, "eins", 4 },
+		{ CKA_INVALID },
+	};
+
+	CK_ATTRIBUTE match_old = { CKA_LABEL, "first", 5 };
+	CK_ATTRIBUTE match_new = { CKA_LABEL, "eins", 4 };
+
+	CK_OBJECT_HANDLE handle;
+	p11_token *other;
+	p11_index *index;
+	CK_RV rv;
+
+	p11_test_file_write (test.directory, "Test.p11-kit", test_data, strlen (test_data));
+	p11_token_load (test.token);
+
+	p11_token_batch (test.token);
+	handle = p11_index_find (test.index, &match_old, 1);
+	rv = p11_index_update (test.index, handle, p11_attrs_dup (first));
+	assert_num_eq (rv, CKR_OK);
+
+	/* Another token leaves changes alone while they're in progress */
+	other = p11_token_new (333, test.directory, "Other");
+	assert_ptr_not_null (other);
+	p11_token_load (other);
+
+	index = p11_token_index (other);
+	assert_num_cmp (0, !=, p11_index_find (index, &match_old, 1));
+	assert_num_eq (0, p11_index_find (index, &match_new, 1));
+	test_check_directory (test.directory, (".p11-kit-journal", "Test.p11-kit", NULL));
+
+	rv = p11_token_commit (test.token);
+	assert_num_eq (rv, CKR_OK);
+	test_check_directory (test.directory, ("Test.p11-kit", NULL));
+
+	/* And picks them up when they're written */
+	p11_token_load (other);
+	assert_num_eq (0, p11_index_find (index, &match_old, 1));
+	assert_num_cmp (0, !=, p11_index_find (index, &match_new, 1));
+
+	p11_token_free (other);
+}
+
+#ifdef OS_UNIX
+
+static void
+test_journal_replay (void)
+{
+	const char *test_data =
+		"[p11-kit-object-v1]\n"
+		"class: data\n"
+		"label: \"first\"\n"
+		"value: \"1\"\n"
+		"\n"
+		"[p11-kit-object-v1]\n"
+		"class: data\n"
+		"label: \"second\"\n"
+		"value: \"2\"\n";
+
+	CK_ATTRIBUTE first[] = {
+		{ CKA_CLASS, &data, sizeof (data) },
+		{ CKA_LABEL, "first", 5 },
+		{ CKA_VALUE, "1", 1 },
+		{ CKA_INVALID },
+	};
+
+	CK_ATTRIBUTE second[] = {
+		{ CKA_CLASS, &data, sizeof (data) },
+		{ CKA_LABEL, "zwei", 4 },
+		{ CKA_VALUE, "2", 1 },
+		{ CKA_INVALID },
+	};
+
+	CK_ATTRIBUTE match_old = { CKA_LABEL, "second", 6 };
+	CK_ATTRIBUTE match_new = { CKA_LABEL, "zwei", 4 };
+
+	CK_OBJECT_HANDLE handle;
+	p11_token *other;
+	p11_index *index;
+	p11_array *parsed;
+	char *path;
+	int status;
+	pid_t pid;
+	int ret;
+	CK_RV rv;
+
+	p11_test_file_write (test.directory, "Test.p11-kit", test_data, strlen (test_data));
+	p11_token_load (test.token);
+
+	pid = fork ();
+	assert_num_cmp (pid, >=, 0);
+
+	/* The child makes a change, and goes away without committing */
+	if (pid == 0) {
+		p11_token_batch (test.token);
+		handle = p11_index_find (test.index, &match_old, 1);
+		rv = p11_index_update (test.index, handle, p11_attrs_buildn (NULL, second + 1, 1));
+		_exit (rv == CKR_OK ? 0 : 1);
+	}
+
+	assert_num_eq (pid, waitpid (pid, &status, 0));
+	assert_num_eq (0, WEXITSTATUS (status));
+	test_check_directory (test.directory, (".p11-kit-journal", "Test.p11-kit", NULL));
+
+	/* Another token on the same directory picks up the change */
+	other = p11_token_new (333, test.directory, "Other");
+	assert_ptr_not_null (other);
+	p11_token_load (other);
+
+	index = p11_token_index (other);
+	assert_num_eq (0, p11_index_find (index, &match_old, 1));
+	assert_num_cmp (0, !=, p11_index_find (index, &match_new, 1));
+
+	/* And writes it out for good */
+	test_check_directory (test.directory, ("Test.p11-kit", NULL));
+
+	path = p11_path_build (test.directory, "Test.p11-kit", NULL);
+	ret = p11_parse_file (test.parser, path, NULL, 0);
+	assert_num_eq (ret, P11_PARSE_SUCCESS);
+	free (path);
+
+	parsed = p11_parser_parsed (test.parser);
+	assert_num_eq (parsed->num, 2);
+	test_check_attrs (first, parsed->elem[0]);
+	test_check_attrs (second, parsed->elem[1]);
+
+	p11_token_free (other);
+}
+
+#endif /* OS_UNIX */
+
 int
 main (int argc,
       char *argv[])
@@ -788,6 +1056,12 @@ main (int argc,
 	p11_test (test_modify_multiple, "/token/modify-multiple");
 	p11_test (test_remove_one, "/token/remove-one");
 	p11_test (test_remove_multiple, "/token/remove-multiple");
+	p11_test (test_batch_modify, "/token/batch-modify");
+	p11_test (test_batch_remove_all, "/token/batch-remove-all");
+	p11_test (test_journal_locked, "/token/journal-locked");
+#ifdef OS_UNIX
+	p11_test (test_journal_replay, "/token/journal-replay");
+#endif
 
 	return p11_test_run (argc, argv);
 }
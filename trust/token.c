@@ -54,12 +54,17 @@
 
 #include <sys/stat.h>
 #include <sys/types.h>
+#ifdef HAVE_FLOCK
+#include <sys/file.h>
+#endif
 
 #include <assert.h>
 #include <dirent.h>
+#include <fcntl.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 
 struct _p11_token {
 	p11_parser *parser;       /* Parser we use to load files */
@@ -73,11 +78,22 @@ struct _p11_token {
 	char *label;              /* The token label */
 	CK_SLOT_ID slot;          /* The slot id */
 
+	p11_persist *persist;     /* Formats objects written to disk */
+	char *journals;           /* Directory of write-behind journals */
+	char *journal;            /* Path to our journal, while we have one */
+	int journal_fd;           /* Locked while our journal exists */
+	p11_dict *dirty;          /* Origins with changes only in the journal */
+	size_t dirty_size;        /* Size of the dirty origins on disk */
+	size_t journaled;         /* Bytes we've appended to the journal */
+	int batch;                /* Nesting of p11_token_batch() calls */
+
 	bool checked_path;
 	bool is_writable;
 	bool make_directory;
 };
 
+static void     journal_replay     (p11_token *token);
+
 static bool
 loader_is_necessary (p11_token *token,
                      const char *filename,
@@ -206,12 +222,15 @@ loader_load_file (p11_token *token,
 		return_val_if_fail (parsed->elem[i] != NULL, 0);
 	}
 
-	p11_index_load (token->index);
+	/* Now place all of these in the index, either all or none of them */
+	p11_index_begin (token->index);
 
-	/* Now place all of these in the index */
 	rv = p11_index_replace_all (token->index, origin, CKA_CLASS, parsed);
 
-	p11_index_finish (token->index);
+	if (rv == CKR_OK)
+		p11_index_commit (token->index);
+	else
+		p11_index_rollback (token->index);
 
 	if (rv != CKR_OK) {
 		p11_message ("couldn't load file into objects: %s", filename);
@@ -388,6 +407,9 @@ p11_token_load (p11_token *token)
 		ret = loader_load_path (token, token->blacklist, &is_dir);
 		return_val_if_fail (ret >= 0, -1);
 		total += ret;
+
+		/* Changes another process didn't get around to committing */
+		journal_replay (token);
 	}
 
 	return total;
@@ -492,12 +514,25 @@ writer_remove_origin (p11_token *token,
 	if (unlink (path) < 0) {
 		p11_message_err (errno, "couldn't remove file: %s", path);
 		ret = false;
+	} else {
+		loader_not_loaded (token, path);
 	}
 
 	free (path);
 	return ret;
 }
 
+static void
+writer_was_written (p11_token *token,
+                    const char *path)
+{
+	struct stat sb;
+
+	/* The index already has what was written, don't reload it */
+	if (stat (path, &sb) == 0)
+		loader_was_loaded (token, path, &sb);
+}
+
 static p11_save_file *
 writer_overwrite_origin (p11_token *token,
                          CK_ATTRIBUTE *origin)
@@ -638,6 +673,586 @@ on_index_build (void *data,
 	return p11_builder_build (token->builder, index, attrs, merge, extra);
 }
 
+static int
+compar_handle (const void *one,
+               const void *two)
+{
+	CK_OBJECT_HANDLE h1 = *((CK_OBJECT_HANDLE *)one);
+	CK_OBJECT_HANDLE h2 = *((CK_OBJECT_HANDLE *)two);
+	return h1 < h2 ? -1 : (h1 > h2 ? 1 : 0);
+}
+
+/*
+ * Writes out @attrs followed by all the other objects from the
+ * same origin in the index, skipping @handle. If there's nothing
+ * left to write then the origin file is removed.
+ */
+static CK_RV
+writer_rewrite_origin (p11_token *token,
+                       CK_ATTRIBUTE *origin,
+                       CK_OBJECT_HANDLE handle,
+                       CK_ATTRIBUTE *attrs)
+{
+	CK_OBJECT_HANDLE *other;
+	CK_ATTRIBUTE *object;
+	p11_save_file *file;
+	p11_buffer buffer;
+	char *path;
+	CK_RV rv;
+	int count;
+	int i;
+
+	other = p11_index_find_all (token->index, origin, 1);
+	return_val_if_fail (other != NULL, CKR_HOST_MEMORY);
+
+	/* Keep the objects in the order they were loaded */
+	for (count = 0; other[count] != 0; count++);
+	qsort (other, count, sizeof (CK_OBJECT_HANDLE), compar_handle);
+
+	if (attrs == NULL && count == 0) {
+		free (other);
+		if (!writer_remove_origin (token, origin))
+			return CKR_FUNCTION_FAILED;
+		return CKR_OK;
+	}
+
+	file = writer_overwrite_origin (token, origin);
+	if (file == NULL) {
+		free (other);
+		return CKR_GENERAL_ERROR;
+	}
+
+	p11_buffer_init (&buffer, 1024);
+
+	rv = writer_put_header (file);
+	if (rv == CKR_OK && attrs != NULL)
+		rv = writer_put_object (file, token->persist, &buffer, attrs);
+
+	for (i = 0; rv == CKR_OK && i < count; i++) {
+		if (other[i] != handle) {
+			object = p11_index_lookup (token->index, other[i]);
+			if (object != NULL)
+				rv = writer_put_object (file, token->persist, &buffer, object);
+		}
+	}
+
+	p11_buffer_uninit (&buffer);
+	free (other);
+
+	if (rv == CKR_OK) {
+		if (!p11_save_finish_file (file, &path, true)) {
+			rv = CKR_FUNCTION_FAILED;
+		} else {
+			writer_was_written (token, path);
+			free (path);
+		}
+	} else {
+		p11_save_finish_file (file, NULL, false);
+	}
+
+	return rv;
+}
+
+/*
+ * While a batch is in progress, changes to existing origin files are
+ * appended to a journal instead of rewriting the files. Each record
+ * holds the origin, and the object before and after the change in the
+ * persist format:
+ *
+ *   [p11-kit-journal-v1] <origin-len> <before-len> <after-len>\n
+ *   <origin><before><after>
+ *
+ * Each token has its own journal, in a subdirectory of the token
+ * directory, which loading never looks into. The journal is locked for
+ * as long as it exists, so other processes leave it alone.
+ *
+ * The journal is compacted into the origin files when the batch is
+ * committed, or once it has grown as large as the files it stands in
+ * for. If a process goes away without committing, the lock goes with
+ * it, and the next one to load the token replays the journal.
+ */
+#define JOURNAL_HEADER "p11-kit-journal-v1"
+#define JOURNAL_MIN_SIZE (256 * 1024)
+
+#ifdef HAVE_FLOCK
+
+/* Compaction and replay of journals happen one at a time */
+static int
+journal_lock (p11_token *token)
+{
+	int fd;
+
+	fd = open (token->journals, O_RDONLY | O_DIRECTORY);
+	if (fd < 0)
+		return -1;
+
+	while (flock (fd, LOCK_EX) < 0) {
+		if (errno != EINTR) {
+			close (fd);
+			return -1;
+		}
+	}
+
+	return fd;
+}
+
+static void
+journal_unlock (p11_token *token,
+                int fd)
+{
+	/* Gone if this was the last journal */
+	rmdir (token->journals);
+	if (fd >= 0)
+		close (fd);
+}
+
+/* Whether the file is still at the path, after locking it */
+static bool
+journal_is_linked (const char *path,
+                   int fd)
+{
+	struct stat sb;
+	struct stat fsb;
+
+	return stat (path, &sb) == 0 && fstat (fd, &fsb) == 0 &&
+	       sb.st_dev == fsb.st_dev && sb.st_ino == fsb.st_ino;
+}
+
+static bool
+journal_open (p11_token *token)
+{
+	char *path;
+	int fd;
+
+	if (token->journal_fd >= 0)
+		return true;
+
+	for (;;) {
+		if (mkdir (token->journals, S_IRWXU | S_IRGRP | S_IXGRP | S_IROTH | S_IXOTH) < 0 &&
+		    errno != EEXIST) {
+			p11_message_err (errno, "couldn't create directory: %s", token->journals);
+			return false;
+		}
+
+		path = p11_path_build (token->journals, "journal.XXXXXX", NULL);
+		return_val_if_fail (path != NULL, false);
+
+		fd = mkstemp (path);
+		if (fd < 0) {
+			/* Another token removed the directory in the meantime */
+			if (errno == ENOENT) {
+				free (path);
+				continue;
+			}
+			p11_message_err (errno, "couldn't create journal: %s", path);
+			free (path);
+			return false;
+		}
+
+		/* Another token may be replaying it, as it wasn't locked yet */
+		if (flock (fd, LOCK_EX | LOCK_NB) == 0 && journal_is_linked (path, fd))
+			break;
+
+		close (fd);
+		free (path);
+	}
+
+	token->journal = path;
+	token->journal_fd = fd;
+	return true;
+}
+
+static void
+journal_close (p11_token *token)
+{
+	if (token->journal_fd < 0)
+		return;
+
+	if (unlink (token->journal) < 0 && errno != ENOENT)
+		p11_message_err (errno, "couldn't remove journal: %s", token->journal);
+
+	close (token->journal_fd);
+	token->journal_fd = -1;
+	free (token->journal);
+	token->journal = NULL;
+	token->journaled = 0;
+}
+
+#else /* !HAVE_FLOCK */
+
+/* Without locks we can't tell a journal in use, so write straight away */
+
+static int
+journal_lock (p11_token *token)
+{
+	return -1;
+}
+
+static void
+journal_unlock (p11_token *token,
+                int fd)
+{
+}
+
+static bool
+journal_open (p11_token *token)
+{
+	return false;
+}
+
+static void
+journal_close (p11_token *token)
+{
+}
+
+#endif /* !HAVE_FLOCK */
+
+static void
+journal_mark_dirty (p11_token *token,
+                    CK_ATTRIBUTE *origin)
+{
+	struct stat sb;
+	char *path;
+
+	path = strndup (origin->pValue, origin->ulValueLen);
+	return_if_fail (path != NULL);
+
+	if (p11_dict_get (token->dirty, path)) {
+		free (path);
+		return;
+	}
+
+	if (stat (path, &sb) == 0)
+		token->dirty_size += sb.st_size;
+	if (!p11_dict_set (token->dirty, path, path))
+		return_if_reached ();
+}
+
+/* Write out the origin files changed in the journal, and drop it */
+static CK_RV
+journal_flush (p11_token *token)
+{
+	CK_ATTRIBUTE origin = { CKA_X_ORIGIN, };
+	p11_dictiter iter;
+	char *path;
+	CK_RV rv = CKR_OK;
+
+	p11_dict_iterate (token->dirty, &iter);
+	while (rv == CKR_OK && p11_dict_next (&iter, (void **)&path, NULL)) {
+		origin.pValue = path;
+		origin.ulValueLen = strlen (path);
+		rv = writer_rewrite_origin (token, &origin, 0, NULL);
+	}
+
+	/* Leave the journal in place, it still has the changes */
+	if (rv != CKR_OK)
+		return rv;
+
+	p11_dict_clear (token->dirty);
+	token->dirty_size = 0;
+	journal_close (token);
+	return CKR_OK;
+}
+
+static CK_RV
+journal_compact (p11_token *token)
+{
+	CK_RV rv;
+	int lock;
+
+	lock = journal_lock (token);
+	rv = journal_flush (token);
+	journal_unlock (token, lock);
+
+	return rv;
+}
+
+static CK_RV
+journal_write (p11_token *token,
+               CK_ATTRIBUTE *origin,
+               CK_ATTRIBUTE *before,
+               CK_ATTRIBUTE *after)
+{
+	char header[64];
+	p11_buffer body;
+	p11_buffer record;
+	size_t before_len;
+	size_t after_len;
+	ssize_t res;
+	CK_RV rv;
+
+	p11_buffer_init (&body, 1024);
+	if (before && !p11_persist_write (token->persist, before, &body))
+		return_val_if_reached (CKR_GENERAL_ERROR);
+	before_len = body.len;
+	if (after && !p11_persist_write (token->persist, after, &body))
+		return_val_if_reached (CKR_GENERAL_ERROR);
+	after_len = body.len - before_len;
+
+	snprintf (header, sizeof (header), "[" JOURNAL_HEADER "] %lu %lu %lu\n",
+	          (unsigned long)origin->ulValueLen, (unsigned long)before_len,
+	          (unsigned long)after_len);
+
+	/* One write, so that the record goes in as a whole */
+	p11_buffer_init (&record, strlen (header) + origin->ulValueLen + body.len);
+	p11_buffer_add (&record, header, -1);
+	p11_buffer_add (&record, origin->pValue, origin->ulValueLen);
+	p11_buffer_add (&record, body.data, body.len);
+	p11_buffer_uninit (&body);
+	return_val_if_fail (p11_buffer_ok (&record), CKR_HOST_MEMORY);
+
+	do {
+		res = write (token->journal_fd, record.data, record.len);
+	} while (res < 0 && (errno == EINTR || errno == EAGAIN));
+
+	if (res != (ssize_t)record.len) {
+		p11_message_err (res < 0 ? errno : ENOSPC, "couldn't write journal: %s",
+		                 token->journal);
+		p11_buffer_uninit (&record);
+		return CKR_FUNCTION_FAILED;
+	}
+
+	token->journaled += record.len;
+	p11_buffer_uninit (&record);
+
+	journal_mark_dirty (token, origin);
+
+	/*
+	 * Compacting rewrites all the dirty files, so wait until at least
+	 * that much has been appended to the journal. This keeps the cost
+	 * of each change proportional to the size of the change.
+	 */
+	if (token->journaled >= JOURNAL_MIN_SIZE &&
+	    token->journaled >= token->dirty_size) {
+		rv = journal_compact (token);
+		if (rv != CKR_OK)
+			p11_message ("couldn't compact journal: %s", token->journal);
+	}
+
+	return CKR_OK;
+}
+
+static CK_OBJECT_HANDLE
+journal_find (p11_token *token,
+              CK_ATTRIBUTE *origin,
+              const unsigned char *text,
+              size_t length,
+              p11_buffer *buffer)
+{
+	CK_OBJECT_HANDLE *handles;
+	CK_OBJECT_HANDLE found = 0;
+	CK_ATTRIBUTE *attrs;
+	int i;
+
+	handles = p11_index_find_all (token->index, origin, 1);
+	for (i = 0; found == 0 && handles && handles[i] != 0; i++) {
+		attrs = p11_index_lookup (token->index, handles[i]);
+		if (attrs == NULL || !p11_buffer_reset (buffer, 0))
+			continue;
+		if (p11_persist_write (token->persist, attrs, buffer) &&
+		    buffer->len == length && memcmp (buffer->data, text, length) == 0)
+			found = handles[i];
+	}
+
+	free (handles);
+	return found;
+}
+
+static bool
+journal_replay_record (p11_token *token,
+                       const unsigned char *data,
+                       size_t origin_len,
+                       size_t before_len,
+                       size_t after_len,
+                       p11_buffer *buffer)
+{
+	CK_BBOOL modifiablev = CK_TRUE;
+	CK_ATTRIBUTE modifiable = { CKA_MODIFIABLE, &modifiablev, sizeof (modifiablev) };
+	CK_ATTRIBUTE origin = { CKA_X_ORIGIN, (void *)data, origin_len };
+	const unsigned char *before = data + origin_len;
+	const unsigned char *after = before + before_len;
+	CK_OBJECT_HANDLE handle = 0;
+	CK_ATTRIBUTE *replace = NULL;
+	p11_array *objects;
+	char *path;
+	bool ret;
+	CK_RV rv;
+
+	if (before_len > 0)
+		handle = journal_find (token, &origin, before, before_len, buffer);
+
+	/* Already applied, or the file was changed underneath the journal */
+	if (handle == 0 && after_len > 0 &&
+	    journal_find (token, &origin, after, after_len, buffer) != 0)
+		return true;
+	if (handle == 0 && before_len > 0) {
+		p11_debug ("skipping journal record that doesn't match: %.*s",
+		           (int)origin_len, (const char *)data);
+		return true;
+	}
+
+	path = strndup ((const char *)data, origin_len);
+	return_val_if_fail (path != NULL, false);
+
+	if (after_len > 0) {
+		objects = p11_array_new (p11_attrs_free);
+		return_val_if_fail (objects != NULL, false);
+
+		ret = p11_persist_read (token->persist, path, after, after_len, objects);
+		if (ret && objects->num == 1) {
+			replace = p11_attrs_build (objects->elem[0], &modifiable, &origin, NULL);
+			return_val_if_fail (replace != NULL, false);
+			objects->elem[0] = NULL;
+		} else {
+			p11_message ("%s: invalid object in journal", path);
+			ret = false;
+		}
+
+		p11_array_free (objects);
+		if (!ret) {
+			free (path);
+			return false;
+		}
+	}
+
+	free (path);
+
+	p11_index_load (token->index);
+	rv = p11_index_replace (token->index, handle, replace);
+	p11_index_finish (token->index);
+
+	if (rv != CKR_OK)
+		return false;
+
+	if (p11_token_is_writable (token))
+		journal_mark_dirty (token, &origin);
+	return true;
+}
+
+static bool
+journal_replay_file (p11_token *token,
+                     const char *path,
+                     int fd)
+{
+	unsigned long origin_len;
+	unsigned long before_len;
+	unsigned long after_len;
+	unsigned char *data;
+	p11_buffer buffer;
+	char header[64];
+	struct stat sb;
+	p11_mmap *map;
+	size_t length;
+	size_t offset;
+	const unsigned char *line;
+	size_t line_len;
+
+	if (fstat (fd, &sb) < 0)
+		return false;
+	if (sb.st_size == 0)
+		return true;
+
+	map = p11_mmap_open (path, &sb, (void **)&data, &length);
+	if (map == NULL) {
+		p11_message_err (errno, "couldn't read journal: %s", path);
+		return false;
+	}
+
+	p11_debug ("replaying journal: %s", path);
+	p11_buffer_init (&buffer, 1024);
+
+	for (offset = 0; offset < length; ) {
+		line = memchr (data + offset, '\n', length - offset);
+		line_len = line ? line - (data + offset) : 0;
+		if (line == NULL || line_len >= sizeof (header))
+			break;
+
+		memcpy (header, data + offset, line_len);
+		header[line_len] = '\0';
+		if (sscanf (header, "[" JOURNAL_HEADER "] %lu %lu %lu",
+		            &origin_len, &before_len, &after_len) != 3)
+			break;
+
+		offset += line_len + 1;
+		if (origin_len == 0 || origin_len > length - offset ||
+		    before_len > length - offset - origin_len ||
+		    after_len > length - offset - origin_len - before_len)
+			break;
+
+		if (!journal_replay_record (token, data + offset, origin_len,
+		                            before_len, after_len, &buffer))
+			break;
+
+		offset += origin_len + before_len + after_len;
+	}
+
+	/* A torn record at the end just means the change never happened */
+	if (offset < length)
+		p11_debug ("stopped replaying journal at offset %lu", (unsigned long)offset);
+
+	p11_buffer_uninit (&buffer);
+	p11_mmap_close (map);
+	return true;
+}
+
+#ifdef HAVE_FLOCK
+
+static void
+journal_recover (p11_token *token,
+                 const char *path,
+                 int fd)
+{
+	int lock;
+
+	lock = journal_lock (token);
+
+	/* If the token is read-only, the changes are only seen in memory */
+	if (journal_replay_file (token, path, fd) &&
+	    p11_token_is_writable (token) &&
+	    journal_flush (token) == CKR_OK &&
+	    unlink (path) < 0 && errno != ENOENT)
+		p11_message_err (errno, "couldn't remove journal: %s", path);
+
+	journal_unlock (token, lock);
+}
+
+#endif /* HAVE_FLOCK */
+
+static void
+journal_replay (p11_token *token)
+{
+#ifdef HAVE_FLOCK
+	struct dirent *dp;
+	char *path;
+	DIR *dir;
+	int fd;
+
+	dir = opendir (token->journals);
+	if (dir == NULL)
+		return;
+
+	while ((dp = readdir (dir)) != NULL) {
+		if (strncmp (dp->d_name, "journal.", 8) != 0)
+			continue;
+
+		path = p11_path_build (token->journals, dp->d_name, NULL);
+		return_if_fail (path != NULL);
+
+		/* Only the journals of tokens that have gone away aren't locked */
+		fd = open (path, O_RDONLY | O_BINARY);
+		if (fd >= 0) {
+			if (flock (fd, LOCK_EX | LOCK_NB) == 0 && journal_is_linked (path, fd))
+				journal_recover (token, path, fd);
+			close (fd);
+		}
+
+		free (path);
+	}
+
+	closedir (dir);
+#endif /* HAVE_FLOCK */
+}
+
 static CK_RV
 on_index_store (void *data,
                 p11_index *index,
@@ -645,16 +1260,11 @@ on_index_store (void *data,
                 CK_ATTRIBUTE **attrs)
 {
 	p11_token *token = data;
-	CK_OBJECT_HANDLE *other;
-	p11_persist *persist;
-	p11_buffer buffer;
 	CK_ATTRIBUTE *origin;
-	CK_ATTRIBUTE *object;
 	p11_save_file *file;
-	bool creating = false;
+	p11_buffer buffer;
 	char *path;
 	CK_RV rv;
-	int i;
 
 	/* Signifies that data is being loaded, don't write out */
 	if (p11_index_loading (index))
@@ -671,49 +1281,35 @@ on_index_store (void *data,
 
 	/* Do we already have a filename? */
 	origin = p11_attrs_find (*attrs, CKA_X_ORIGIN);
-	if (origin == NULL) {
-		file = writer_create_origin (token, *attrs);
-		creating = true;
-		other = NULL;
+	if (origin != NULL) {
+		if (token->batch > 0 && journal_open (token)) {
+			return journal_write (token, origin,
+			                      p11_index_lookup (index, handle), *attrs);
+		}
 
-	} else {
-		other = p11_index_find_all (index, origin, 1);
-		file = writer_overwrite_origin (token, origin);
-		creating = false;
+		return writer_rewrite_origin (token, origin, handle, *attrs);
 	}
 
-	if (file == NULL) {
-		free (origin);
-		free (other);
+	/* A new file only holds this object, so write it straight away */
+	file = writer_create_origin (token, *attrs);
+	if (file == NULL)
 		return CKR_GENERAL_ERROR;
-	}
 
-	persist = p11_persist_new ();
 	p11_buffer_init (&buffer, 1024);
 
 	rv = writer_put_header (file);
 	if (rv == CKR_OK)
-		rv = writer_put_object (file, persist, &buffer, *attrs);
-
-	for (i = 0; rv == CKR_OK && other && other[i] != 0; i++) {
-		if (other[i] != handle) {
-			object = p11_index_lookup (index, other[i]);
-			if (object != NULL)
-				rv = writer_put_object (file, persist, &buffer, object);
-		}
-	}
+		rv = writer_put_object (file, token->persist, &buffer, *attrs);
 
 	p11_buffer_uninit (&buffer);
-	p11_persist_free (persist);
-	free (other);
 
 	if (rv == CKR_OK) {
-		if (!p11_save_finish_file (file, &path, true))
+		if (!p11_save_finish_file (file, &path, true)) {
 			rv = CKR_FUNCTION_FAILED;
-		else if (creating)
+		} else {
+			writer_was_written (token, path);
 			*attrs = p11_attrs_take (*attrs, CKA_X_ORIGIN, path, strlen (path));
-		else
-			free (path);
+		}
 	} else {
 		p11_save_finish_file (file, NULL, false);
 	}
@@ -727,14 +1323,7 @@ on_index_remove (void *data,
                  CK_ATTRIBUTE *attrs)
 {
 	p11_token *token = data;
-	CK_OBJECT_HANDLE *other;
-	p11_persist *persist;
-	p11_buffer buffer;
 	CK_ATTRIBUTE *origin;
-	CK_ATTRIBUTE *object;
-	p11_save_file *file;
-	CK_RV rv = CKR_OK;
-	int i;
 
 	/* Signifies that data is being loaded, don't write out */
 	if (p11_index_loading (index))
@@ -747,44 +1336,11 @@ on_index_remove (void *data,
 	origin = p11_attrs_find (attrs, CKA_X_ORIGIN);
 	return_val_if_fail (origin != NULL, CKR_GENERAL_ERROR);
 
-	/* If there are other objects in this file, then rewrite it */
-	other = p11_index_find_all (index, origin, 1);
-	if (other && other[0]) {
-		file = writer_overwrite_origin (token, origin);
-		if (file == NULL) {
-			free (other);
-			return CKR_GENERAL_ERROR;
-		}
-
-		persist = p11_persist_new ();
-		p11_buffer_init (&buffer, 1024);
+	if (token->batch > 0 && journal_open (token))
+		return journal_write (token, origin, attrs, NULL);
 
-		rv = writer_put_header (file);
-		for (i = 0; rv == CKR_OK && other && other[i] != 0; i++) {
-			object = p11_index_lookup (index, other[i]);
-			if (object != NULL)
-				rv = writer_put_object (file, persist, &buffer, object);
-		}
-
-		if (rv == CKR_OK) {
-			if (!p11_save_finish_file (file, NULL, true))
-				rv = CKR_FUNCTION_FAILED;
-		} else {
-			p11_save_finish_file (file, NULL, false);
-		}
-
-		p11_persist_free (persist);
-		p11_buffer_uninit (&buffer);
-
-	/* Otherwise just remove the file */
-	} else {
-		if (!writer_remove_origin (token, origin))
-			rv = CKR_FUNCTION_FAILED;
-	}
-
-	free (other);
-
-	return rv;
+	/* Rewrite with the other objects in this file, or remove it */
+	return writer_rewrite_origin (token, origin, 0, NULL);
 }
 
 static void
@@ -803,10 +1359,21 @@ p11_token_free (p11_token *token)
 	if (!token)
 		return;
 
+	if (p11_dict_size (token->dirty) > 0)
+		journal_compact (token);
+
+	/* If that failed, the journal is left for the next token to replay */
+	if (token->journal_fd >= 0)
+		close (token->journal_fd);
+
 	p11_index_free (token->index);
 	p11_parser_free (token->parser);
 	p11_builder_free (token->builder);
 	p11_dict_free (token->loaded);
+	p11_persist_free (token->persist);
+	p11_dict_free (token->dirty);
+	free (token->journal);
+	free (token->journals);
 	free (token->path);
 	free (token->anchors);
 	free (token->blacklist);
@@ -854,6 +1421,16 @@ p11_token_new (CK_SLOT_ID slot,
 	token->blacklist = p11_path_build (token->path, "blacklist", NULL);
 	return_val_if_fail (token->blacklist != NULL, NULL);
 
+	token->journals = p11_path_build (token->path, ".p11-kit-journal", NULL);
+	return_val_if_fail (token->journals != NULL, NULL);
+	token->journal_fd = -1;
+
+	token->persist = p11_persist_new ();
+	return_val_if_fail (token->persist != NULL, NULL);
+
+	token->dirty = p11_dict_new (p11_dict_str_hash, p11_dict_str_equal, free, NULL);
+	return_val_if_fail (token->dirty != NULL, NULL);
+
 	token->label = strdup (label);
 	return_val_if_fail (token->label != NULL, NULL);
 
@@ -907,3 +1484,22 @@ p11_token_is_writable (p11_token *token)
 		return false;
 	return token->is_writable;
 }
+
+void
+p11_token_batch (p11_token *token)
+{
+	return_if_fail (token != NULL);
+	token->batch++;
+}
+
+CK_RV
+p11_token_commit (p11_token *token)
+{
+	return_val_if_fail (token != NULL, CKR_GENERAL_ERROR);
+	return_val_if_fail (token->batch > 0, CKR_GENERAL_ERROR);
+
+	if (--token->batch > 0 || p11_dict_size (token->dirty) == 0)
+		return CKR_OK;
+
+	return journal_compact (token);
+}
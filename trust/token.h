@@ -65,4 +65,8 @@ CK_SLOT_ID      p11_token_get_slot    (p11_token *token);
 
 bool            p11_token_is_writable (p11_token *token);
 
+void            p11_token_batch       (p11_token *token);
+
+CK_RV           p11_token_commit      (p11_token *token);
+
 #endif /* P11_TOKEN_H_ */